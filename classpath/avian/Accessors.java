@@ -0,0 +1,432 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+import static avian.Stream.write1;
+import static avian.Stream.write2;
+import static avian.Stream.write4;
+import static avian.Stream.set4;
+import static avian.Assembler.*;
+
+import avian.ConstantPool.PoolEntry;
+import avian.Assembler.MethodData;
+
+import java.lang.reflect.Modifier;
+import java.lang.reflect.InvocationTargetException;
+import java.util.List;
+import java.util.ArrayList;
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+
+// Generates classes which call a method or access a field directly,
+// for java.lang.reflect.Method and Field to use once they have been
+// used often enough that passing each call through the VM costs more
+// than making a class.
+public class Accessors {
+  private static int nextNumber;
+
+  // called by generated code if unpacking an argument fails
+  public static IllegalArgumentException illegalArgument(Throwable cause) {
+    IllegalArgumentException e = new IllegalArgumentException();
+    e.initCause(cause);
+    return e;
+  }
+
+  // called by generated code if a method it calls throws
+  public static InvocationTargetException invocationTarget(Throwable cause) {
+    return new InvocationTargetException(cause);
+  }
+
+  private static String wrapper(char type) {
+    switch (type) {
+    case 'Z': return "java/lang/Boolean";
+    case 'B': return "java/lang/Byte";
+    case 'C': return "java/lang/Character";
+    case 'S': return "java/lang/Short";
+    case 'I': return "java/lang/Integer";
+    case 'F': return "java/lang/Float";
+    case 'J': return "java/lang/Long";
+    case 'D': return "java/lang/Double";
+    default: return null;
+    }
+  }
+
+  private static String primitiveName(char type) {
+    switch (type) {
+    case 'Z': return "boolean";
+    case 'B': return "byte";
+    case 'C': return "char";
+    case 'S': return "short";
+    case 'I': return "int";
+    case 'F': return "float";
+    case 'J': return "long";
+    case 'D': return "double";
+    default: throw new IllegalArgumentException();
+    }
+  }
+
+  // the index just past the type descriptor starting at start
+  private static int descriptorEnd(String spec, int start) {
+    int i = start;
+    while (spec.charAt(i) == '[') {
+      ++ i;
+    }
+    if (spec.charAt(i) == 'L') {
+      i = spec.indexOf(';', i);
+    }
+    return i + 1;
+  }
+
+  // converts the reference on top of the stack to the type described
+  // by descriptor, unboxing it if the type is primitive
+  private static void unbox(List<PoolEntry> pool, ByteArrayOutputStream out,
+                            String descriptor)
+    throws IOException
+  {
+    char type = descriptor.charAt(0);
+    String wrapper = wrapper(type);
+    if (wrapper == null) {
+      write1(out, checkcast);
+      write2(out, ConstantPool.addClass
+             (pool, type == 'L'
+              ? descriptor.substring(1, descriptor.length() - 1)
+              : descriptor) + 1);
+    } else {
+      write1(out, checkcast);
+      write2(out, ConstantPool.addClass(pool, wrapper) + 1);
+      write1(out, invokevirtual);
+      write2(out, ConstantPool.addMethodRef
+             (pool, wrapper, primitiveName(type) + "Value", "()" + type) + 1);
+    }
+  }
+
+  // boxes the value on top of the stack if the type described by
+  // descriptor is primitive
+  private static void box(List<PoolEntry> pool, ByteArrayOutputStream out,
+                          String descriptor)
+    throws IOException
+  {
+    char type = descriptor.charAt(0);
+    String wrapper = wrapper(type);
+    if (wrapper != null) {
+      write1(out, invokestatic);
+      write2(out, ConstantPool.addMethodRef
+             (pool, wrapper, "valueOf", "(" + type + ")L" + wrapper + ";")
+             + 1);
+    }
+  }
+
+  private static void writeHandler(List<PoolEntry> pool,
+                                   ByteArrayOutputStream out,
+                                   String name,
+                                   String exception)
+    throws IOException
+  {
+    write1(out, invokestatic);
+    write2(out, ConstantPool.addMethodRef
+           (pool, "avian/Accessors", name,
+            "(Ljava/lang/Throwable;)L" + exception + ";") + 1);
+    write1(out, athrow);
+  }
+
+  private static byte[] makeInvokeCode(List<PoolEntry> pool, VMMethod m)
+    throws IOException
+  {
+    String className = Classes.toString(m.class_.name);
+    String spec = Classes.toString(m.spec);
+    boolean isStatic = (m.flags & Modifier.STATIC) != 0;
+
+    ByteArrayOutputStream out = new ByteArrayOutputStream();
+    write2(out, m.parameterFootprint + 2); // max stack
+    write2(out, 3); // max locals
+    write4(out, 0); // length (we'll set the real value later)
+
+    final int start = out.size();
+
+    if (! isStatic) {
+      write1(out, aload_1);
+      write1(out, checkcast);
+      write2(out, ConstantPool.addClass(pool, className) + 1);
+    }
+
+    int index = 0;
+    int si = 1;
+    while (spec.charAt(si) != ')') {
+      int end = descriptorEnd(spec, si);
+
+      write1(out, aload_2);
+      write1(out, ldc_w);
+      write2(out, ConstantPool.addInteger(pool, index++) + 1);
+      write1(out, aaload);
+      unbox(pool, out, spec.substring(si, end));
+
+      si = end;
+    }
+
+    int call = out.size() - start;
+
+    int methodRef = ConstantPool.addMethodRef
+      (pool, className, Classes.toString(m.name), spec) + 1;
+    if (isStatic) {
+      write1(out, invokestatic);
+      write2(out, methodRef);
+    } else if ((m.flags & Modifier.PRIVATE) != 0) {
+      write1(out, invokespecial);
+      write2(out, methodRef);
+    } else if ((m.class_.flags & Modifier.INTERFACE) != 0) {
+      write1(out, invokeinterface);
+      write2(out, methodRef);
+      write2(out, 0); // this will be ignored by the VM
+    } else {
+      write1(out, invokevirtual);
+      write2(out, methodRef);
+    }
+
+    int returned = out.size() - start;
+
+    String returnType = spec.substring(si + 1);
+    if (returnType.equals("V")) {
+      write1(out, aconst_null);
+    } else {
+      box(pool, out, returnType);
+    }
+    write1(out, areturn);
+
+    int argumentHandler = out.size() - start;
+    writeHandler(pool, out, "illegalArgument",
+                 "java/lang/IllegalArgumentException");
+
+    int targetHandler = out.size() - start;
+    writeHandler(pool, out, "invocationTarget",
+                 "java/lang/reflect/InvocationTargetException");
+
+    int length = out.size() - start;
+
+    // anything thrown while unpacking the arguments is the caller's
+    // fault, and anything thrown by the call is the method's
+    if (call > 0) {
+      write2(out, 2); // exception handler table length
+      write2(out, 0);
+      write2(out, call);
+      write2(out, argumentHandler);
+      write2(out, 0); // any exception type
+    } else {
+      write2(out, 1); // exception handler table length
+    }
+    write2(out, call);
+    write2(out, returned);
+    write2(out, targetHandler);
+    write2(out, 0); // any exception type
+
+    write2(out, 0); // attribute count
+
+    byte[] result = out.toByteArray();
+    set4(result, 4, length);
+
+    return result;
+  }
+
+  private static byte[] makeGetCode(List<PoolEntry> pool, VMField f)
+    throws IOException
+  {
+    String className = Classes.toString(f.class_.name);
+    String spec = Classes.toString(f.spec);
+
+    ByteArrayOutputStream out = new ByteArrayOutputStream();
+    write2(out, 2); // max stack
+    write2(out, 2); // max locals
+    write4(out, 0); // length (we'll set the real value later)
+
+    final int start = out.size();
+
+    int fieldRef = ConstantPool.addFieldRef
+      (pool, className, Classes.toString(f.name), spec) + 1;
+    if ((f.flags & Modifier.STATIC) != 0) {
+      write1(out, getstatic);
+      write2(out, fieldRef);
+    } else {
+      write1(out, aload_1);
+      write1(out, checkcast);
+      write2(out, ConstantPool.addClass(pool, className) + 1);
+      write1(out, getfield);
+      write2(out, fieldRef);
+    }
+    box(pool, out, spec);
+    write1(out, areturn);
+
+    int length = out.size() - start;
+
+    write2(out, 0); // exception handler table length
+    write2(out, 0); // attribute count
+
+    byte[] result = out.toByteArray();
+    set4(result, 4, length);
+
+    return result;
+  }
+
+  private static byte[] makeSetCode(List<PoolEntry> pool, VMField f)
+    throws IOException
+  {
+    String className = Classes.toString(f.class_.name);
+    String spec = Classes.toString(f.spec);
+
+    ByteArrayOutputStream out = new ByteArrayOutputStream();
+    write2(out, 3); // max stack
+    write2(out, 3); // max locals
+    write4(out, 0); // length (we'll set the real value later)
+
+    final int start = out.size();
+
+    boolean isStatic = (f.flags & Modifier.STATIC) != 0;
+    if (! isStatic) {
+      write1(out, aload_1);
+      write1(out, checkcast);
+      write2(out, ConstantPool.addClass(pool, className) + 1);
+    }
+    write1(out, aload_2);
+    unbox(pool, out, spec);
+
+    int store = out.size() - start;
+
+    write1(out, isStatic ? putstatic : putfield);
+    write2(out, ConstantPool.addFieldRef
+           (pool, className, Classes.toString(f.name), spec) + 1);
+    write1(out, return_);
+
+    int handler = out.size() - start;
+    writeHandler(pool, out, "illegalArgument",
+                 "java/lang/IllegalArgumentException");
+
+    int length = out.size() - start;
+
+    write2(out, 1); // exception handler table length
+    write2(out, 0);
+    write2(out, store);
+    write2(out, handler);
+    write2(out, 0); // any exception type
+
+    write2(out, 0); // attribute count
+
+    byte[] result = out.toByteArray();
+    set4(result, 4, length);
+
+    return result;
+  }
+
+  private static byte[] makeConstructorCode(List<PoolEntry> pool,
+                                            String superName)
+    throws IOException
+  {
+    ByteArrayOutputStream out = new ByteArrayOutputStream();
+    write2(out, 1); // max stack
+    write2(out, 1); // max locals
+    write4(out, 5); // length
+
+    write1(out, aload_0);
+    write1(out, invokespecial);
+    write2(out, ConstantPool.addMethodRef
+           (pool, superName, "<init>", "()V") + 1);
+    write1(out, return_);
+
+    write2(out, 0); // exception handler table length
+    write2(out, 0); // attribute count
+
+    return out.toByteArray();
+  }
+
+  private static Object make(ClassLoader loader, List<PoolEntry> pool,
+                             String superName, MethodData[] methods)
+  {
+    int number;
+    synchronized (Accessors.class) {
+      number = nextNumber++;
+    }
+
+    try {
+      MethodData[] methodTable = new MethodData[methods.length + 1];
+      System.arraycopy(methods, 0, methodTable, 0, methods.length);
+      methodTable[methods.length] = new MethodData
+        (Modifier.PUBLIC,
+         ConstantPool.addUtf8(pool, "<init>"),
+         ConstantPool.addUtf8(pool, "()V"),
+         makeConstructorCode(pool, superName));
+
+      int nameIndex = ConstantPool.addClass
+        (pool, superName.substring(superName.lastIndexOf('/') + 1)
+         + "-" + number);
+      int superIndex = ConstantPool.addClass(pool, superName);
+
+      ByteArrayOutputStream out = new ByteArrayOutputStream();
+      Assembler.writeClass
+        (out, pool, nameIndex, superIndex, new int[0], methodTable);
+
+      byte[] classData = out.toByteArray();
+      return SystemClassLoader.getClass
+        (Classes.defineVMClass(loader, classData, 0, classData.length))
+        .newInstance();
+    } catch (Exception e) {
+      AssertionError error = new AssertionError();
+      error.initCause(e);
+      throw error;
+    }
+  }
+
+  // returns null if the method can't be called this way
+  public static MethodAccessor makeMethodAccessor(VMMethod m) {
+    if ((m.flags & Modifier.STATIC) != 0
+        && (m.class_.flags & Modifier.INTERFACE) != 0)
+    {
+      return null;
+    }
+
+    List<PoolEntry> pool = new ArrayList();
+    try {
+      return (MethodAccessor) make
+        (m.class_.loader, pool, "avian/MethodAccessor", new MethodData[] {
+          new MethodData
+            (Modifier.PUBLIC,
+             ConstantPool.addUtf8(pool, "invoke"),
+             ConstantPool.addUtf8
+             (pool, "(Ljava/lang/Object;[Ljava/lang/Object;)"
+              + "Ljava/lang/Object;"),
+             makeInvokeCode(pool, m)) });
+    } catch (IOException e) {
+      AssertionError error = new AssertionError();
+      error.initCause(e);
+      throw error;
+    }
+  }
+
+  public static FieldAccessor makeFieldAccessor(VMField f) {
+    List<PoolEntry> pool = new ArrayList();
+    try {
+      return (FieldAccessor) make
+        (f.class_.loader, pool, "avian/FieldAccessor", new MethodData[] {
+          new MethodData
+            (Modifier.PUBLIC,
+             ConstantPool.addUtf8(pool, "get"),
+             ConstantPool.addUtf8
+             (pool, "(Ljava/lang/Object;)Ljava/lang/Object;"),
+             makeGetCode(pool, f)),
+          new MethodData
+            (Modifier.PUBLIC,
+             ConstantPool.addUtf8(pool, "set"),
+             ConstantPool.addUtf8
+             (pool, "(Ljava/lang/Object;Ljava/lang/Object;)V"),
+             makeSetCode(pool, f)) });
+    } catch (IOException e) {
+      AssertionError error = new AssertionError();
+      error.initCause(e);
+      throw error;
+    }
+  }
+}
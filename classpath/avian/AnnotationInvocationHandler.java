@@ -15,14 +15,28 @@ import java.lang.reflect.InvocationHandler;
 
 public class AnnotationInvocationHandler implements InvocationHandler {
   private Object[] data;
+  // the Method found for the value at each index of data.  A proxy
+  // class passes the same Method for every call to a given method, so
+  // once each has been found by name, later calls need only compare
+  // references.
+  private final Method[] methods;
 
   public AnnotationInvocationHandler(Object[] data) {
     this.data = data;
+    this.methods = new Method[data.length];
   }
     
   public Object invoke(Object proxy, Method method, Object[] arguments) {
     for (int i = 2; i < data.length; i += 2) {
-      if (method.getName().equals(data[i])) {
+      if (methods[i] == method) {
+        return data[i + 1];
+      }
+    }
+
+    String name = method.getName();
+    for (int i = 2; i < data.length; i += 2) {
+      if (name.equals(data[i])) {
+        methods[i] = method;
         return data[i + 1];
       }
     }
@@ -0,0 +1,256 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+
+package avian;
+
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.logging.Handler;
+import java.util.logging.LogRecord;
+
+/**
+ * A Handler which queues records for another to publish on a thread of
+ * its own, so that callers don't wait for formatting or I/O.  Records
+ * go into a bounded ring buffer which any number of threads may add to
+ * without locking, using the scheme of Dmitry Vyukov's bounded queue:
+ * each slot holds a sequence number telling producers when it is free
+ * and the consumer when it is full.
+ */
+public class AsyncLogHandler extends Handler {
+  // when the queue is full, publish waits for room
+  public static final int Block = 0;
+  // when the queue is full, publish discards the record
+  public static final int Drop = 1;
+
+  // the most records published between flushes of the target handler
+  private static final int BatchSize = 64;
+
+  private final Handler target;
+  private final int policy;
+  private final Slot[] slots;
+  private final int mask;
+  private final AtomicLong tail = new AtomicLong();
+  // the position of the next record the consumer will take
+  private long head;
+  // the number of records the consumer has finished publishing
+  private volatile long done;
+  private final AtomicLong dropped = new AtomicLong();
+  private final Object lock = new Object();
+  // the number of threads waiting on lock for the consumer to make
+  // progress
+  private volatile int waiters;
+  private volatile boolean sleeping;
+  private volatile boolean closed;
+  private final Thread thread;
+
+  public AsyncLogHandler(Handler target, int capacity, int policy) {
+    if (capacity < 1 || (policy != Block && policy != Drop)) {
+      throw new IllegalArgumentException();
+    }
+
+    int size = 1;
+    while (size < capacity) {
+      size *= 2;
+    }
+
+    this.target = target;
+    this.policy = policy;
+    this.slots = new Slot[size];
+    for (int i = 0; i < size; ++i) {
+      slots[i] = new Slot(i);
+    }
+    this.mask = size - 1;
+
+    thread = new Thread() {
+        public void run() {
+          consume();
+        }
+      };
+    thread.setDaemon(true);
+    thread.start();
+  }
+
+  public AsyncLogHandler(Handler target) {
+    this(target, 1024, Block);
+  }
+
+  // the number of records discarded because the queue was full
+  public long getDroppedCount() {
+    return dropped.get();
+  }
+
+  private boolean offer(LogRecord r) {
+    while (true) {
+      long position = tail.get();
+      Slot s = slots[(int) position & mask];
+      long difference = s.sequence - position;
+      if (difference == 0) {
+        if (tail.compareAndSet(position, position + 1)) {
+          s.record = r;
+          s.sequence = position + 1;
+          return true;
+        }
+      } else if (difference < 0) {
+        // the consumer has yet to empty this slot
+        return false;
+      }
+      // otherwise another producer took this slot first, so try again
+    }
+  }
+
+  public void publish(LogRecord r) {
+    if (closed) {
+      return;
+    }
+
+    if (! offer(r)) {
+      if (policy == Drop) {
+        dropped.incrementAndGet();
+        return;
+      }
+
+      synchronized (lock) {
+        ++ waiters;
+        try {
+          while (! (offer(r) || closed)) {
+            wake();
+            lock.wait(10);
+          }
+        } catch (InterruptedException e) {
+          Thread.currentThread().interrupt();
+        } finally {
+          -- waiters;
+        }
+      }
+    }
+
+    if (sleeping) {
+      synchronized (lock) {
+        lock.notifyAll();
+      }
+    }
+  }
+
+  private void wake() {
+    if (sleeping) {
+      lock.notifyAll();
+    }
+  }
+
+  private LogRecord poll() {
+    long position = head;
+    Slot s = slots[(int) position & mask];
+    if (s.sequence == position + 1) {
+      LogRecord r = s.record;
+      s.record = null;
+      s.sequence = position + slots.length;
+      head = position + 1;
+      return r;
+    } else {
+      return null;
+    }
+  }
+
+  private void consume() {
+    while (true) {
+      int count = 0;
+      LogRecord r;
+      while (count < BatchSize && (r = poll()) != null) {
+        publishSafely(r);
+        ++ count;
+      }
+
+      if (count > 0) {
+        try {
+          target.flush();
+        } catch (RuntimeException e) {
+          // as in publishSafely
+        }
+        done = head;
+        if (waiters > 0) {
+          synchronized (lock) {
+            lock.notifyAll();
+          }
+        }
+      } else {
+        synchronized (lock) {
+          sleeping = true;
+          try {
+            if (head == tail.get()) {
+              if (closed) {
+                lock.notifyAll();
+                return;
+              }
+              lock.wait();
+            }
+          } catch (InterruptedException e) {
+            // keep going until closed
+          } finally {
+            sleeping = false;
+          }
+        }
+      }
+    }
+  }
+
+  private void publishSafely(LogRecord r) {
+    try {
+      target.publish(r);
+    } catch (RuntimeException e) {
+      // nobody is waiting to hear about this, so carry on with the next
+      // record
+    }
+  }
+
+  // waits until every record published so far has been passed to the
+  // target, then flushes it
+  public void flush() {
+    long position = tail.get();
+    synchronized (lock) {
+      ++ waiters;
+      try {
+        while (done < position && thread.isAlive()) {
+          wake();
+          lock.wait(10);
+        }
+      } catch (InterruptedException e) {
+        Thread.currentThread().interrupt();
+      } finally {
+        -- waiters;
+      }
+    }
+    target.flush();
+  }
+
+  // publishes any records still queued, then stops the thread and
+  // closes the target
+  public void close() {
+    closed = true;
+    synchronized (lock) {
+      lock.notifyAll();
+    }
+
+    try {
+      thread.join();
+    } catch (InterruptedException e) {
+      Thread.currentThread().interrupt();
+    }
+    target.close();
+  }
+
+  private static class Slot {
+    public volatile long sequence;
+    public LogRecord record;
+
+    public Slot(long sequence) {
+      this.sequence = sequence;
+    }
+  }
+}
@@ -16,4 +16,7 @@ public class ClassAddendum extends Addendum {
   public Object[] methodTable;
   public Object enclosingClass;
   public Object enclosingMethod;
+  // interface table rearranged as a hash table, for classes with many
+  // interfaces
+  public Object[] interfaceHashTable;
 }
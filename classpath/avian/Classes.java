@@ -31,6 +31,8 @@ public class Classes {
   public static native VMClass primitiveClass(char name);
 
   public static native void initialize(VMClass vmClass);
+
+  private static native void loadReflectionData(VMClass vmClass);
   
   public static native boolean isAssignableFrom(VMClass a, VMClass b);
 
@@ -222,6 +224,8 @@ public class Classes {
           link(c.super_, loader);
         }
 
+        loadReflectionData(c);
+
         parseAnnotationTable(loader, c.addendum);
 
         if (c.interfaceTable != null) {
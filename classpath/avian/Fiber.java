@@ -0,0 +1,152 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.locks.LockSupport;
+
+/**
+ * A lightweight thread run by a {@link FiberScheduler}.
+ */
+public class Fiber {
+  private static final int Running = 0;
+  private static final int Parked = 1;
+  // running, with an unpark pending
+  private static final int Permit = 2;
+  private static final int Done = 3;
+
+  final FiberScheduler.Carrier carrier;
+  private final Runnable task;
+  private final AtomicInteger state = new AtomicInteger(Running);
+  private final ConcurrentLinkedQueue<Fiber> joiners
+    = new ConcurrentLinkedQueue();
+  private Throwable exception;
+
+  // where to pick up again when next resumed, or null if not started
+  Callback<Object> continuation;
+
+  Fiber(FiberScheduler.Carrier carrier, Runnable task) {
+    if (task == null) throw new NullPointerException();
+
+    this.carrier = carrier;
+    this.task = task;
+  }
+
+  /**
+   * Returns the fiber running on the calling thread, or null if it is
+   * not a carrier.
+   */
+  public static Fiber current() {
+    Thread t = Thread.currentThread();
+    if (t instanceof FiberScheduler.Carrier) {
+      return ((FiberScheduler.Carrier) t).current;
+    } else {
+      return null;
+    }
+  }
+
+  /**
+   * Lets the other runnable fibers on this carrier run before
+   * continuing.
+   */
+  public static void yield() {
+    Fiber f = current();
+    if (f == null) {
+      Thread.yield();
+    } else {
+      // the carrier won't take us off its queue until we've suspended
+      f.carrier.schedule(f);
+      f.carrier.suspend();
+    }
+  }
+
+  /**
+   * Suspends the current fiber until it is unparked, unless an unpark
+   * is already pending.  Like {@link LockSupport#park}, this may
+   * return spuriously.
+   */
+  public static void park() {
+    Fiber f = current();
+    if (f == null) {
+      LockSupport.park();
+    } else if (! f.state.compareAndSet(Permit, Running)
+               && f.state.compareAndSet(Running, Parked))
+    {
+      f.carrier.suspend();
+    }
+  }
+
+  public void unpark() {
+    while (true) {
+      int s = state.get();
+      if (s == Permit || s == Done) {
+        return;
+      } else if (s == Running) {
+        if (state.compareAndSet(Running, Permit)) {
+          return;
+        }
+      } else if (state.compareAndSet(Parked, Running)) {
+        carrier.schedule(this);
+        return;
+      }
+    }
+  }
+
+  /**
+   * Waits for this fiber to finish, suspending the current fiber if
+   * called from one, or blocking the calling thread otherwise.
+   */
+  public void join() throws InterruptedException {
+    Fiber f = current();
+    if (f != null) {
+      joiners.add(f);
+      while (state.get() != Done) {
+        park();
+      }
+    } else {
+      synchronized (this) {
+        while (state.get() != Done) {
+          wait();
+        }
+      }
+    }
+  }
+
+  public boolean isAlive() {
+    return state.get() != Done;
+  }
+
+  /**
+   * Returns the exception which ended this fiber, if any.
+   */
+  public Throwable getException() {
+    return exception;
+  }
+
+  void run() {
+    try {
+      task.run();
+    } catch (Throwable e) {
+      exception = e;
+    }
+
+    state.set(Done);
+    synchronized (this) {
+      notifyAll();
+    }
+
+    Fiber joiner;
+    while ((joiner = joiners.poll()) != null) {
+      joiner.unpark();
+    }
+  }
+}
@@ -0,0 +1,155 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.locks.LockSupport;
+
+/**
+ * Multiplexes lightweight fibers over a small pool of carrier
+ * threads, switching between them with continuations.  This requires
+ * a build with continuations enabled.
+ *
+ * <p>A fiber stays on the carrier it was spawned on, and a carrier
+ * only switches fibers when one calls {@link Fiber#yield},
+ * {@link Fiber#park} or {@link Fiber#join}.  Anything else which
+ * blocks, such as I/O, sleeping, or waiting for a monitor, blocks the
+ * carrier and every fiber on it.  Since monitors are owned by
+ * threads, not fibers, a fiber must not suspend while holding one.
+ */
+public class FiberScheduler {
+  private final Carrier[] carriers;
+  private final AtomicInteger nextCarrier = new AtomicInteger();
+  volatile boolean shutdown;
+
+  public FiberScheduler(int carrierCount) {
+    if (carrierCount <= 0) throw new IllegalArgumentException();
+
+    carriers = new Carrier[carrierCount];
+    for (int i = 0; i < carrierCount; ++i) {
+      carriers[i] = new Carrier(this, "fiber-carrier-" + i);
+      carriers[i].start();
+    }
+  }
+
+  public FiberScheduler() {
+    this(Runtime.getRuntime().availableProcessors());
+  }
+
+  public Fiber spawn(Runnable task) {
+    if (shutdown) throw new IllegalStateException();
+
+    Carrier carrier = carriers
+      [(nextCarrier.getAndIncrement() & Integer.MAX_VALUE) % carriers.length];
+    Fiber fiber = new Fiber(carrier, task);
+    carrier.schedule(fiber);
+    return fiber;
+  }
+
+  // carriers exit once they run out of runnable fibers; any fibers
+  // still parked at that point are abandoned
+  public void shutdown() {
+    shutdown = true;
+    for (Carrier c: carriers) {
+      LockSupport.unpark(c);
+    }
+  }
+
+  static class Carrier extends Thread {
+    private final FiberScheduler scheduler;
+    private final ConcurrentLinkedQueue<Fiber> runQueue
+      = new ConcurrentLinkedQueue();
+    private volatile boolean idle;
+
+    // the fiber now running, and the continuation which returns
+    // control from it to the loop in run()
+    Fiber current;
+    private Callback<Object> back;
+
+    public Carrier(FiberScheduler scheduler, String name) {
+      super(name);
+      this.scheduler = scheduler;
+      setDaemon(true);
+    }
+
+    void schedule(Fiber fiber) {
+      runQueue.add(fiber);
+      if (idle && Thread.currentThread() != this) {
+        LockSupport.unpark(this);
+      }
+    }
+
+    // Resuming a fiber restores the whole stack it was captured with,
+    // including older frames of this loop, so a finished fiber may
+    // return into a stale frame.  Hence the loop keeps no state in
+    // locals across resume().
+    public void run() {
+      while (true) {
+        Fiber fiber = runQueue.poll();
+        if (fiber != null) {
+          resume(fiber);
+        } else if (scheduler.shutdown) {
+          return;
+        } else {
+          idle = true;
+          if (runQueue.peek() == null && ! scheduler.shutdown) {
+            LockSupport.park(this);
+          }
+          idle = false;
+        }
+      }
+    }
+
+    private void resume(final Fiber fiber) {
+      current = fiber;
+      try {
+        Continuations.callWithCurrentContinuation
+          (new CallbackReceiver<Object>() {
+            public Object receive(Callback<Object> continuation) {
+              back = continuation;
+
+              Callback<Object> c = fiber.continuation;
+              if (c == null) {
+                fiber.run();
+                return null;
+              } else {
+                fiber.continuation = null;
+                c.handleResult(null);
+                throw new AssertionError();
+              }
+            }
+          });
+      } catch (Exception e) {
+        throw new RuntimeException(e);
+      }
+      current = null;
+    }
+
+    // called by the current fiber to return control to the carrier
+    // until it is next resumed
+    void suspend() {
+      final Fiber fiber = current;
+      try {
+        Continuations.callWithCurrentContinuation
+          (new CallbackReceiver<Object>() {
+            public Object receive(Callback<Object> continuation) {
+              fiber.continuation = continuation;
+              back.handleResult(null);
+              throw new AssertionError();
+            }
+          });
+      } catch (Exception e) {
+        throw new RuntimeException(e);
+      }
+    }
+  }
+}
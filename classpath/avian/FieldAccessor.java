@@ -0,0 +1,19 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+// Reads and writes a particular field on behalf of
+// java.lang.reflect.Field.  Subclasses are generated by Accessors.
+public abstract class FieldAccessor {
+  public abstract Object get(Object instance);
+
+  public abstract void set(Object instance, Object value);
+}
@@ -16,8 +16,200 @@ public abstract class Machine {
 
   private static final Unsafe unsafe = Unsafe.getUnsafe();
 
+  // must match CollectionPauseSubBuckets in machine.h
+  private static final int PauseSubBuckets = 4;
+
+  // replaced rather than changed, so memoryPressure needn't lock it
+  private static volatile Runnable[] pressureHandlers = new Runnable[0];
+
   public static native void dumpHeap(String outputFile);
 
+  // Writes a heap dump in the HPROF format read by tools such as
+  // Eclipse MAT and VisualVM, gzipped if compress is true.  Both this
+  // and dumpHeap are only available in VMs built with heapdump=true.
+  public static native void dumpHprof(String outputFile, boolean compress);
+
+  // Returns, without writing a dump, one line per class of reachable
+  // object, most bytes first: the number of instances, their total
+  // size in bytes, if retained is true an estimate of the bytes they
+  // keep alive, and the class name, followed by a line of totals.  At
+  // most limit classes are listed, or all of them if limit is zero.
+  // Setting avian.heap.histogramOnQuit to a limit prints this to
+  // stderr, with retained sizes, on SIGQUIT.  Also only available in
+  // VMs built with heapdump=true.
+  public static native String classHistogram(int limit, boolean retained);
+
+  // Returns the number of garbage collection pauses seen so far in each
+  // of a series of log-linear buckets, where bucket i covers pauses of
+  // at least collectionPauseBucketStart(i) and less than
+  // collectionPauseBucketStart(i + 1) microseconds.
+  public static native long[] collectionPauseHistogram();
+
+  public static long collectionPauseBucketStart(int bucket) {
+    if (bucket < PauseSubBuckets) {
+      return bucket;
+    }
+
+    int k = (bucket / PauseSubBuckets) + 1;
+    return ((long) (PauseSubBuckets + (bucket % PauseSubBuckets))) << (k - 2);
+  }
+
+  // Returns an upper bound, in microseconds, on the pause time of the
+  // given fraction (e.g. 0.99) of collections so far.
+  public static long collectionPausePercentile(double fraction) {
+    long[] histogram = collectionPauseHistogram();
+
+    long total = 0;
+    for (long n: histogram) {
+      total += n;
+    }
+
+    long threshold = (long) Math.ceil(total * fraction);
+    if (threshold == 0) {
+      return 0;
+    }
+
+    long sum = 0;
+    for (int i = 0; i < histogram.length; ++i) {
+      sum += histogram[i];
+      if (sum >= threshold) {
+        return collectionPauseBucketStart(i + 1);
+      }
+    }
+
+    return collectionPauseBucketStart(histogram.length);
+  }
+
+  // Returns the number of finalizers and cleaners queued to run but not
+  // yet taken by a finalizer thread.  Set avian.finalizer.threads to
+  // let more than one thread run them.
+  public static native int finalizerBacklog();
+
+  // Returns the number of implicit exceptions (e.g. from dereferencing
+  // null or dividing by zero) thrown so far as a shared, preallocated
+  // instance without a stack trace.  This only happens in the JIT
+  // build, once a site has thrown avian.jit.fastThrowLimit times.
+  public static native long fastThrowCount();
+
+  // Starts sampling the stacks of running threads every
+  // avian.profile.interval milliseconds (10 by default), as setting the
+  // avian.profile property to the same spec does at startup.  The spec
+  // has the form "cpu:<file>", where "-" means stderr.  Samples are
+  // only taken in the JIT build, and only of threads running Java code
+  // or code in the VM, not blocked or in JNI native methods.
+  public static native void startProfiler(String spec);
+
+  // Stops sampling and writes one line per stack seen, in the collapsed
+  // form read by flame graph tools ("outer;...;inner count").  This
+  // also happens when the VM exits.
+  public static native void stopProfiler();
+
+  // Writes the events kept by the flight recorder, enabled by setting
+  // avian.events to the file they are written to on a crash or exit,
+  // to the named file, or to that one if file is null.  The file may
+  // be converted to JSON using the event-reader tool.
+  public static native void dumpEvents(String file);
+
+  // Returns the sites at which threads spent the most time blocked on
+  // monitors, enabled by setting avian.contention.profile to the file
+  // the whole report is written to on exit.  Each of the first limit
+  // lines, or all of them if limit is zero, holds the total time in
+  // microseconds, the number of times, the site and the lock.
+  public static native String contentionReport(int limit);
+
+  // Returns a summary of what the JIT compiler has done: the number of
+  // methods compiled, bytes of bytecode in and machine code out, time
+  // spent, the largest zone used, code cache occupancy, thunk and call
+  // table sizes, a histogram of compile times, and the slowest
+  // compiles.  Returns null when interpreting.  Setting
+  // avian.jit.statistics to a number of seconds writes this to the
+  // compile log (avian.jit.log) or stderr that often.
+  public static native String compilationReport();
+
+  // Returns a summary of the native memory the VM is using, one kind
+  // per line.  When avian.memory.tracking is true, this begins with the
+  // bytes allocated, and the most there have been, by the JIT
+  // compiler, the class path finders and JNI references.  It then
+  // gives the bytes of fixed objects, compiled code and thread stacks.
+  // Setting avian.memory.report to a file name, or to "-" for stderr,
+  // writes this there on exit.
+  public static native String memoryReport();
+
+  // Returns a line giving how many times a thread has waited for the
+  // others to stop so it could have the VM to itself, how long that
+  // took in all, the longest wait, and what that was for.  Setting
+  // avian.safepoint.threshold to a number of milliseconds logs each
+  // longer wait to stderr with its reason and the last thread to stop.
+  // When avian.events is set, each wait is also recorded as an
+  // exclusive event.
+  public static native String safepointReport();
+
+  // Returns the number of bytes of objects the specified thread has
+  // allocated since it started, or -1 if it isn't running.  This is
+  // cheap enough to call per request.
+  public static native long threadAllocatedBytes(Thread thread);
+
+  // Returns the CPU time, in nanoseconds, the specified thread has used
+  // since it started, or -1 if it isn't running or the platform can't
+  // tell.
+  public static native long threadCpuTime(Thread thread);
+
+  // Restricts the specified thread to the CPUs listed, numbered from
+  // zero, or lets it run wherever the process may if cpus is null or
+  // empty.  Returns false if it isn't running or the platform can't
+  // pin threads.  Setting avian.heap.numa to true also moves each
+  // chunk of memory a thread allocates objects in to the memory node
+  // it is running on when it takes the chunk, so threads pinned to one
+  // node's CPUs allocate from that node.
+  public static native boolean setThreadAffinity(Thread thread, int[] cpus);
+
+  // Arranges for the specified handler to be run, on the finalizer
+  // thread, after each collection which leaves less of the heap limit
+  // free than avian.heap.freeTarget percent (25 by default).  That is
+  // also when soft references start being cleared, least recently read
+  // first, so caches which shrink themselves here keep more of what
+  // they hold in soft references.  Handlers should be quick, and any
+  // exception one throws is ignored.
+  public static void addMemoryPressureHandler(Runnable handler) {
+    synchronized (Machine.class) {
+      Runnable[] handlers = new Runnable[pressureHandlers.length + 1];
+      System.arraycopy(pressureHandlers, 0, handlers, 0,
+                       pressureHandlers.length);
+      handlers[pressureHandlers.length] = handler;
+      pressureHandlers = handlers;
+    }
+    watchMemoryPressure();
+  }
+
+  public static void removeMemoryPressureHandler(Runnable handler) {
+    synchronized (Machine.class) {
+      for (int i = 0; i < pressureHandlers.length; ++i) {
+        if (pressureHandlers[i] == handler) {
+          Runnable[] handlers = new Runnable[pressureHandlers.length - 1];
+          System.arraycopy(pressureHandlers, 0, handlers, 0, i);
+          System.arraycopy(pressureHandlers, i + 1, handlers, i,
+                           handlers.length - i);
+          pressureHandlers = handlers;
+          return;
+        }
+      }
+    }
+  }
+
+  private static native void watchMemoryPressure();
+
+  // called by the VM
+  private static void memoryPressure() {
+    Runnable[] handlers = pressureHandlers;
+    for (int i = 0; i < handlers.length; ++i) {
+      try {
+        handlers[i].run();
+      } catch (Throwable e) {
+        // ignore, as promised above
+      }
+    }
+  }
+
   public static Unsafe getUnsafe() {
     return unsafe;
   }
@@ -0,0 +1,20 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+import java.lang.reflect.InvocationTargetException;
+
+// Calls a particular method on behalf of java.lang.reflect.Method.
+// Subclasses are generated by Accessors.
+public abstract class MethodAccessor {
+  public abstract Object invoke(Object instance, Object[] arguments)
+    throws InvocationTargetException;
+}
@@ -96,6 +96,128 @@ public class Utf8 {
     }
   }
 
+  // The following decode and encode standard UTF-8, as used by streams,
+  // rather than the modified form above, and work on caller-supplied
+  // arrays so that a reader or writer can reuse its buffers.
+
+  // decodes the complete chars among the specified bytes, writing at
+  // most dstLength of them to dst starting at dstOffset and returning
+  // the number written.  The number of bytes consumed is stored in
+  // consumed[0]; bytes left over begin a char which is incomplete or
+  // which needs more room in dst.  Malformed input decodes as \ufffd.
+  public static int decode(byte[] src, int offset, int length,
+                           char[] dst, int dstOffset, int dstLength,
+                           int[] consumed)
+  {
+    int i = offset;
+    int end = offset + length;
+    int j = dstOffset;
+    int dstEnd = dstOffset + dstLength;
+    while (i < end && j < dstEnd) {
+      int x = src[i];
+      if (x >= 0) {
+        // runs of ASCII are the common case, so copy them with as few
+        // checks as possible
+        do {
+          dst[j++] = (char) x;
+          ++ i;
+        } while (i < end && j < dstEnd && (x = src[i]) >= 0);
+        continue;
+      }
+
+      int need;
+      int c;
+      int min;
+      if ((x & 0xe0) == 0xc0) {
+        need = 1;
+        c = x & 0x1f;
+        min = 0x80;
+      } else if ((x & 0xf0) == 0xe0) {
+        need = 2;
+        c = x & 0x0f;
+        min = 0x800;
+      } else if ((x & 0xf8) == 0xf0) {
+        need = 3;
+        c = x & 0x07;
+        min = 0x10000;
+      } else {
+        dst[j++] = '\ufffd';
+        ++ i;
+        continue;
+      }
+
+      int k = 1;
+      while (k <= need && i + k < end) {
+        int y = src[i + k];
+        if ((y & 0xc0) != 0x80) {
+          break;
+        }
+        c = (c << 6) | (y & 0x3f);
+        ++ k;
+      }
+
+      if (k <= need) {
+        if (i + k == end) {
+          // wait for the rest of this char
+          break;
+        }
+        // a byte which can't continue this char, so the char ends
+        // before it
+        dst[j++] = '\ufffd';
+        i += k;
+      } else if (c < min || c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff)) {
+        dst[j++] = '\ufffd';
+        i += k;
+      } else if (c < 0x10000) {
+        dst[j++] = (char) c;
+        i += k;
+      } else if (j + 1 < dstEnd) {
+        c -= 0x10000;
+        dst[j++] = (char) (0xd800 | (c >>> 10));
+        dst[j++] = (char) (0xdc00 | (c & 0x3ff));
+        i += k;
+      } else {
+        break;
+      }
+    }
+
+    consumed[0] = i - offset;
+    return j - dstOffset;
+  }
+
+  // encodes the specified chars to dst starting at dstOffset, returning
+  // the number of bytes written, which is at most three times the
+  // number of chars.  Surrogate pairs become a single four byte
+  // sequence; unpaired surrogates are encoded as if they were chars.
+  public static int encode(char[] src, int offset, int length,
+                           byte[] dst, int dstOffset)
+  {
+    int j = dstOffset;
+    int end = offset + length;
+    for (int i = offset; i < end; ++i) {
+      int c = src[i];
+      if (c < 0x80) {
+        dst[j++] = (byte) c;
+      } else if (c < 0x800) {
+        dst[j++] = (byte) (0xc0 | (c >>> 6));
+        dst[j++] = (byte) (0x80 | (c & 0x3f));
+      } else if (c >= 0xd800 && c < 0xdc00 && i + 1 < end
+                 && src[i + 1] >= 0xdc00 && src[i + 1] < 0xe000)
+      {
+        c = 0x10000 + ((c & 0x3ff) << 10) + (src[++i] & 0x3ff);
+        dst[j++] = (byte) (0xf0 | (c >>> 18));
+        dst[j++] = (byte) (0x80 | ((c >>> 12) & 0x3f));
+        dst[j++] = (byte) (0x80 | ((c >>> 6) & 0x3f));
+        dst[j++] = (byte) (0x80 | (c & 0x3f));
+      } else {
+        dst[j++] = (byte) (0xe0 | (c >>> 12));
+        dst[j++] = (byte) (0x80 | ((c >>> 6) & 0x3f));
+        dst[j++] = (byte) (0x80 | (c & 0x3f));
+      }
+    }
+    return j - dstOffset;
+  }
+
   private static void cram(Object data, int index, int val) {
     if (data instanceof byte[]) ((byte[])data)[index] = (byte)val;
     else                        ((char[])data)[index] = (char)val;
@@ -29,4 +29,7 @@ public class VMClass {
   public Object staticTable;
   public ClassLoader loader;
   public byte[] source;
+  public VMClass[] display;
+  public VMClass secondarySuper;
+  public VMClass lastStored;
 }
@@ -160,9 +160,8 @@ doClose(JNIEnv* e, jint fd)
 }
 
 inline int
-doRead(JNIEnv* e, jint fd, jbyte* data, jint length)
+readResult(JNIEnv* e, int r)
 {
-  int r = READ(fd, data, length);
   if (r > 0) {
     return r;
   } else if (r == 0) {
@@ -173,15 +172,39 @@ doRead(JNIEnv* e, jint fd, jbyte* data, jint length)
   }  
 }
 
+inline int
+doRead(JNIEnv* e, jint fd, jbyte* data, jint length)
+{
+  return readResult(e, READ(fd, data, length));
+}
+
 inline void
-doWrite(JNIEnv* e, jint fd, const jbyte* data, jint length)
+writeResult(JNIEnv* e, int r, jint length)
 {
-  int r = WRITE(fd, data, length);
   if (r != length) {
     throwNewErrno(e, "java/io/IOException");
   }
 }
 
+inline void
+doWrite(JNIEnv* e, jint fd, const jbyte* data, jint length)
+{
+  writeResult(e, WRITE(fd, data, length), length);
+}
+
+// Returns true if I/O on the specified descriptor is known not to
+// block indefinitely, in which case it is safe to hold a heap array
+// pinned (and thus hold off garbage collection) for the duration of a
+// read or write rather than copying through a temporary buffer.
+// Pipes, sockets, and terminals may wait on another process, so we
+// never pin for those.
+inline bool
+regularFile(jint fd)
+{
+  struct stat s;
+  return ::fstat(fd, &s) == 0 and S_ISREG(s.st_mode);
+}
+
 
 #ifdef PLATFORM_WINDOWS
 
@@ -731,6 +754,15 @@ extern "C" JNIEXPORT jint JNICALL
 Java_java_io_FileInputStream_read__I_3BII
 (JNIEnv* e, jclass, jint fd, jbyteArray b, jint offset, jint length)
 {
+  if (regularFile(fd)) {
+    jbyte* data = static_cast<jbyte*>
+      (e->GetPrimitiveArrayCritical(b, 0));
+    int r = READ(fd, data + offset, length);
+    e->ReleasePrimitiveArrayCritical(b, data, 0);
+
+    return readResult(e, r);
+  }
+
   jbyte* data = static_cast<jbyte*>(malloc(length));
   if (data == 0) {
     throwNew(e, "java/lang/OutOfMemoryError", 0);
@@ -738,8 +770,9 @@ Java_java_io_FileInputStream_read__I_3BII
   }
 
   int r = doRead(e, fd, data, length);
-
-  e->SetByteArrayRegion(b, offset, length, data);
+  if (r > 0) {
+    e->SetByteArrayRegion(b, offset, r, data);
+  }
 
   free(data);
 
@@ -778,6 +811,16 @@ extern "C" JNIEXPORT void JNICALL
 Java_java_io_FileOutputStream_write__I_3BII
 (JNIEnv* e, jclass, jint fd, jbyteArray b, jint offset, jint length)
 {
+  if (regularFile(fd)) {
+    jbyte* data = static_cast<jbyte*>
+      (e->GetPrimitiveArrayCritical(b, 0));
+    int r = WRITE(fd, data + offset, length);
+    e->ReleasePrimitiveArrayCritical(b, data, 0);
+
+    writeResult(e, r, length);
+    return;
+  }
+
   jbyte* data = static_cast<jbyte*>(malloc(length));
 
   if (data == 0) {
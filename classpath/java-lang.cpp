@@ -60,6 +60,15 @@
 # endif
 #  include "sys/utsname.h"
 #  include "sys/wait.h"
+#  if (! defined __ANDROID__) && (! defined AVIAN_IOS)
+#    include "spawn.h"
+#    define AVIAN_POSIX_SPAWN
+#    ifdef __APPLE__
+#      include <crt_externs.h>
+#    else
+extern char** environ;
+#    endif
+#  endif
 
 #endif // not PLATFORM_WINDOWS
 
@@ -136,10 +145,16 @@ namespace {
     return fd;
   }
 #else
+  // both ends are closed on exec, so a child started on another thread
+  // in the meantime doesn't hold them open; dup2 clears the flag for
+  // the descriptors a child is meant to have
   void makePipe(JNIEnv* e, int p[2])
   {
     if(pipe(p) != 0) {
       throwNewErrno(e, "java/io/IOException");
+    } else {
+      fcntl(p[0], F_SETFD, FD_CLOEXEC);
+      fcntl(p[1], F_SETFD, FD_CLOEXEC);
     }
   }
   
@@ -506,7 +521,6 @@ Java_java_lang_Runtime_exec(JNIEnv* e, jclass,
   int in[] = { -1, -1 };
   int out[] = { -1, -1 };
   int err[] = { -1, -1 };
-  int msg[] = { -1, -1 };
   
   makePipe(e, in);
   if(e->ExceptionCheck()) return;
@@ -520,13 +534,50 @@ Java_java_lang_Runtime_exec(JNIEnv* e, jclass,
   if(e->ExceptionCheck()) return;
   jlong errDescriptor = static_cast<jlong>(err[0]);
   e->SetLongArrayRegion(process, 4, 1, &errDescriptor);
-  makePipe(e, msg);
-  if(e->ExceptionCheck()) return;
-  if(fcntl(msg[1], F_SETFD, FD_CLOEXEC) != 0) {
+
+#ifdef AVIAN_POSIX_SPAWN
+  // unlike fork, posix_spawn doesn't copy the page tables of what may
+  // be a large heap, and where the C library allows (glibc since 2.24,
+  // for instance) it reports a failure to exec as its result
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, in[1], 1);
+  posix_spawn_file_actions_adddup2(&actions, out[0], 0);
+  posix_spawn_file_actions_adddup2(&actions, err[1], 2);
+
+  posix_spawnattr_t attributes;
+  posix_spawnattr_init(&attributes);
+#  ifdef POSIX_SPAWN_USEVFORK
+  posix_spawnattr_setflags(&attributes, POSIX_SPAWN_USEVFORK);
+#  endif
+
+  pid_t pid;
+#  ifdef __APPLE__
+  int r = posix_spawnp
+    (&pid, argv[0], &actions, &attributes, argv, *_NSGetEnviron());
+#  else
+  int r = posix_spawnp(&pid, argv[0], &actions, &attributes, argv, environ);
+#  endif
+
+  posix_spawnattr_destroy(&attributes);
+  posix_spawn_file_actions_destroy(&actions);
+
+  safeClose(in[1]);
+  safeClose(out[0]);
+  safeClose(err[1]);
+
+  if (r == 0) {
+    jlong JNIPid = static_cast<jlong>(pid);
+    e->SetLongArrayRegion(process, 0, 1, &JNIPid);
+  } else {
+    errno = r;
     throwNewErrno(e, "java/io/IOException");
-    return;
   }
-  
+#else
+  int msg[] = { -1, -1 };
+  makePipe(e, msg);
+  if(e->ExceptionCheck()) return;
+
 #ifdef __QNX__
   // fork(2) doesn't work in multithreaded QNX programs.  See
   // http://www.qnx.com/developers/docs/6.4.1/neutrino/getting_started/s1_procs.html
@@ -582,11 +633,9 @@ Java_java_lang_Runtime_exec(JNIEnv* e, jclass,
   }
   
   safeClose(msg[0]);
+#endif // not AVIAN_POSIX_SPAWN
+
   clean(e, command, argv);
-  
-  fcntl(in[0], F_SETFD, FD_CLOEXEC);
-  fcntl(out[1], F_SETFD, FD_CLOEXEC);
-  fcntl(err[0], F_SETFD, FD_CLOEXEC);
 }
 
 extern "C" JNIEXPORT jint JNICALL 
@@ -641,6 +690,18 @@ Locale getLocale() {
 }
 #endif
 
+extern "C" JNIEXPORT void JNICALL
+Java_java_lang_Runtime_execAll(JNIEnv* e, jclass c, jobjectArray commands,
+                               jobjectArray processes)
+{
+  jsize count = e->GetArrayLength(commands);
+  for (jsize i = 0; i < count and not e->ExceptionCheck(); ++i) {
+    Java_java_lang_Runtime_exec
+      (e, c, static_cast<jobjectArray>(e->GetObjectArrayElement(commands, i)),
+       static_cast<jlongArray>(e->GetObjectArrayElement(processes, i)));
+  }
+}
+
 extern "C" JNIEXPORT jstring JNICALL
 Java_java_lang_System_getProperty(JNIEnv* e, jclass, jstring name,
                                   jbooleanArray found)
@@ -683,6 +744,8 @@ Java_java_lang_System_getProperty(JNIEnv* e, jclass, jstring name,
       r = e->NewStringUTF("ppc");
 #elif defined ARCH_arm
       r = e->NewStringUTF("arm");
+#elif defined ARCH_arm64
+      r = e->NewStringUTF("aarch64");
 #endif
     } else if (strcmp(chars, "java.io.tmpdir") == 0) {
 #  if !defined(WINAPI_FAMILY) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
@@ -764,6 +827,8 @@ Java_java_lang_System_getProperty(JNIEnv* e, jclass, jstring name,
       r = e->NewStringUTF("ppc");
 #elif defined ARCH_arm
       r = e->NewStringUTF("arm");
+#elif defined ARCH_arm64
+      r = e->NewStringUTF("aarch64");
 #endif
     } else if (strcmp(chars, "java.io.tmpdir") == 0) {
       r = e->NewStringUTF("/tmp");
@@ -17,9 +17,16 @@
 #include "jni-util.h"
 
 #ifdef PLATFORM_WINDOWS
+// the default of 64 sockets per select is far too few for a server,
+// and since a Windows fd_set is a counted array of handles rather than
+// a bitmap, raising it only costs memory in each SelectorState
+#  ifndef FD_SETSIZE
+#    define FD_SETSIZE 1024
+#  endif
 #  include <winsock2.h>
 #  include <ws2tcpip.h>
 #  include <errno.h>
+#  include <io.h>
 #  ifdef _MSC_VER
 #    define snprintf sprintf_s
 #  else
@@ -36,6 +43,20 @@
 #  include <netinet/ip.h>
 #  include <netinet/tcp.h>
 #  include <sys/socket.h>
+#  include <sys/mman.h>
+#  include <sys/uio.h>
+#  ifdef __linux__
+#    include <sys/epoll.h>
+#    include <sys/sendfile.h>
+#    define AVIAN_EPOLL
+#    ifndef __ANDROID__
+#      define AVIAN_MMSG
+#    endif
+#  elif (defined __APPLE__) || (defined __FreeBSD__)
+#    include <sys/event.h>
+#    include <sys/time.h>
+#    define AVIAN_KQUEUE
+#  endif
 #endif
 
 #define java_nio_channels_SelectionKey_OP_READ 1L
@@ -43,6 +64,9 @@
 #define java_nio_channels_SelectionKey_OP_CONNECT 8L
 #define java_nio_channels_SelectionKey_OP_ACCEPT 16L
 
+#define MapReadOnly 0
+#define MapReadWrite 1
+
 #ifdef PLATFORM_WINDOWS
 typedef int socklen_t;
 #endif
@@ -430,12 +454,28 @@ extern "C" JNIEXPORT jint JNICALL
 Java_java_nio_channels_DatagramChannel_bind(JNIEnv *e,
                                             jclass,
                                             jstring host,
-                                            jint port)
+                                            jint port,
+                                            jboolean reusePort)
 {
   int s = makeSocket(e, SOCK_DGRAM, IPPROTO_UDP);
   if (s < 0) return s;
   if (e->ExceptionCheck()) return 0;
-  
+
+  if (reusePort) {
+#ifdef SO_REUSEPORT
+    int opt = 1;
+    int r = ::setsockopt(s, SOL_SOCKET, SO_REUSEPORT,
+                         reinterpret_cast<char*>(&opt), sizeof(int));
+    if (r != 0) {
+      throwIOException(e);
+      return 0;
+    }
+#else
+    throwIOException(e, "SO_REUSEPORT not supported");
+    return 0;
+#endif
+  }
+
   sockaddr_in address;
   init(e, &address, host, port);
   if (e->ExceptionCheck()) return 0;
@@ -656,6 +696,166 @@ Java_java_nio_channels_SocketChannel_natWrite(JNIEnv *e,
   return r;
 }
 
+namespace {
+
+// buffers beyond this many are left for the next call
+const int MaxVectorCount = 64;
+
+// Performs a single readv or writev over the described buffers.
+// Direct buffers are used in place.  In non-blocking mode heap arrays
+// are pinned for the duration of the call; in blocking mode, where we
+// mustn't hold them across a potentially long wait, they are copied
+// through one scratch buffer instead, as natRead and natWrite do.
+jlong
+doVector(JNIEnv* e, jint socket, jobjectArray buffers, jintArray offsets,
+         jintArray lengths, jbooleanArray direct, jint count,
+         jboolean blocking, bool write)
+{
+  if (count > MaxVectorCount) {
+    count = MaxVectorCount;
+  }
+
+  jint offset[MaxVectorCount];
+  jint length[MaxVectorCount];
+  jboolean isDirect[MaxVectorCount];
+  jobject object[MaxVectorCount];
+  uint8_t* data[MaxVectorCount];
+
+  e->GetIntArrayRegion(offsets, 0, count, offset);
+  e->GetIntArrayRegion(lengths, 0, count, length);
+  e->GetBooleanArrayRegion(direct, 0, count, isDirect);
+
+  jlong total = 0;
+  unsigned scratchSize = 0;
+  for (int i = 0; i < count; ++i) {
+    total += length[i];
+    object[i] = e->GetObjectArrayElement(buffers, i);
+    if (isDirect[i]) {
+      data[i] = static_cast<uint8_t*>(e->GetDirectBufferAddress(object[i]))
+        + offset[i];
+    } else {
+      scratchSize += length[i];
+    }
+  }
+
+  if (total == 0) {
+    return 0;
+  }
+
+  uint8_t* scratch = 0;
+  if (blocking and scratchSize) {
+    scratch = static_cast<uint8_t*>(allocate(e, scratchSize));
+    if (scratch == 0) {
+      return 0;
+    }
+
+    uint8_t* p = scratch;
+    for (int i = 0; i < count; ++i) {
+      if (not isDirect[i]) {
+        data[i] = p;
+        if (write) {
+          e->GetByteArrayRegion
+            (static_cast<jbyteArray>(object[i]), offset[i], length[i],
+             reinterpret_cast<jbyte*>(p));
+        }
+        p += length[i];
+      }
+    }
+  } else if (scratchSize) {
+    for (int i = 0; i < count; ++i) {
+      if (not isDirect[i]) {
+        data[i] = static_cast<uint8_t*>
+          (e->GetPrimitiveArrayCritical(static_cast<jarray>(object[i]), 0))
+          + offset[i];
+      }
+    }
+  }
+
+#ifdef PLATFORM_WINDOWS
+  WSABUF vector[MaxVectorCount];
+  for (int i = 0; i < count; ++i) {
+    vector[i].buf = reinterpret_cast<char*>(data[i]);
+    vector[i].len = length[i];
+  }
+
+  DWORD transferred = 0;
+  DWORD flags = 0;
+  int r = write
+    ? WSASend(socket, vector, count, &transferred, 0, 0, 0)
+    : WSARecv(socket, vector, count, &transferred, &flags, 0, 0);
+  jlong result = (r == 0 ? static_cast<jlong>(transferred) : -1);
+#else
+  iovec vector[MaxVectorCount];
+  for (int i = 0; i < count; ++i) {
+    vector[i].iov_base = data[i];
+    vector[i].iov_len = length[i];
+  }
+
+  jlong result = write ? ::writev(socket, vector, count)
+    : ::readv(socket, vector, count);
+#endif
+
+  if (scratch) {
+    if ((not write) and result > 0) {
+      jlong remaining = result;
+      for (int i = 0; remaining > 0 and i < count; ++i) {
+        jint n = remaining < length[i] ? remaining : length[i];
+        if (not isDirect[i]) {
+          e->SetByteArrayRegion
+            (static_cast<jbyteArray>(object[i]), offset[i], n,
+             reinterpret_cast<jbyte*>(data[i]));
+        }
+        remaining -= n;
+      }
+    }
+    free(scratch);
+  } else if (scratchSize) {
+    for (int i = 0; i < count; ++i) {
+      if (not isDirect[i]) {
+        e->ReleasePrimitiveArrayCritical
+          (static_cast<jarray>(object[i]), data[i] - offset[i], 0);
+      }
+    }
+  }
+
+  if (result < 0) {
+    if (eagain()) {
+      return 0;
+    } else {
+      throwIOException(e);
+    }
+  } else if (result == 0 and not write) {
+    return -1;
+  }
+  return result;
+}
+
+} // namespace
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_channels_SocketChannel_natReadv(JNIEnv* e, jclass, jint socket,
+                                              jobjectArray buffers,
+                                              jintArray offsets,
+                                              jintArray lengths,
+                                              jbooleanArray direct,
+                                              jint count, jboolean blocking)
+{
+  return doVector
+    (e, socket, buffers, offsets, lengths, direct, count, blocking, false);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_channels_SocketChannel_natWritev(JNIEnv* e, jclass, jint socket,
+                                               jobjectArray buffers,
+                                               jintArray offsets,
+                                               jintArray lengths,
+                                               jbooleanArray direct,
+                                               jint count, jboolean blocking)
+{
+  return doVector
+    (e, socket, buffers, offsets, lengths, direct, count, blocking, true);
+}
+
 extern "C" JNIEXPORT jint JNICALL
 Java_java_nio_channels_DatagramChannel_write(JNIEnv* e,
                                              jclass c,
@@ -669,6 +869,200 @@ Java_java_nio_channels_DatagramChannel_write(JNIEnv* e,
     (e, c, socket, buffer, offset, length, blocking);
 }
 
+namespace {
+
+const int MaxBatchCount = 64;
+
+#ifdef MSG_DONTWAIT
+const int DontWait = MSG_DONTWAIT;
+#else
+const int DontWait = 0;
+#endif
+
+// finds the data of up to MaxBatchCount direct buffers, returning how
+// many there are
+jint
+batchBuffers(JNIEnv* e, jobjectArray buffers, jintArray offsets,
+             jintArray lengths, jint count, uint8_t** data, jint* length)
+{
+  if (count > MaxBatchCount) {
+    count = MaxBatchCount;
+  }
+
+  jint offset[MaxBatchCount];
+  e->GetIntArrayRegion(offsets, 0, count, offset);
+  e->GetIntArrayRegion(lengths, 0, count, length);
+
+  for (int i = 0; i < count; ++i) {
+    data[i] = static_cast<uint8_t*>
+      (e->GetDirectBufferAddress(e->GetObjectArrayElement(buffers, i)))
+      + offset[i];
+  }
+
+  return count;
+}
+
+} // namespace
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_DatagramChannel_receiveBatch(JNIEnv* e,
+                                                    jclass,
+                                                    jint socket,
+                                                    jobjectArray buffers,
+                                                    jintArray offsets,
+                                                    jintArray lengths,
+                                                    jintArray addresses,
+                                                    jint count,
+                                                    jboolean blocking UNUSED)
+{
+  uint8_t* data[MaxBatchCount];
+  jint length[MaxBatchCount];
+  count = batchBuffers(e, buffers, offsets, lengths, count, data, length);
+  if (count == 0) {
+    return 0;
+  }
+
+  sockaddr_in address[MaxBatchCount];
+  int r;
+
+#ifdef AVIAN_MMSG
+  iovec vector[MaxBatchCount];
+  mmsghdr message[MaxBatchCount];
+  memset(message, 0, count * sizeof(mmsghdr));
+  for (int i = 0; i < count; ++i) {
+    vector[i].iov_base = data[i];
+    vector[i].iov_len = length[i];
+    message[i].msg_hdr.msg_name = address + i;
+    message[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    message[i].msg_hdr.msg_iov = vector + i;
+    message[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  // MSG_WAITFORONE makes a blocking call return once anything has
+  // arrived instead of waiting for every buffer to be filled
+  r = ::recvmmsg(socket, message, count, MSG_WAITFORONE, 0);
+  for (int i = 0; i < r; ++i) {
+    length[i] = message[i].msg_len;
+  }
+#else
+  r = 0;
+  while (r < count) {
+    socklen_t size = sizeof(sockaddr_in);
+    int n = recvfrom
+      (socket, reinterpret_cast<char*>(data[r]), length[r], r ? DontWait : 0,
+       reinterpret_cast<sockaddr*>(address + r), &size);
+    if (n < 0) {
+      if (r == 0) {
+        r = -1;
+      }
+      break;
+    }
+
+    length[r++] = n;
+
+    // without MSG_DONTWAIT, a blocking socket can't be drained without
+    // waiting for more
+    if (blocking and DontWait == 0) {
+      break;
+    }
+  }
+#endif
+
+  if (r < 0) {
+    if (not eagain()) {
+      throwIOException(e);
+    }
+    return 0;
+  }
+
+  jint pairs[MaxBatchCount * 2];
+  for (int i = 0; i < r; ++i) {
+    pairs[i * 2] = ntohl(address[i].sin_addr.s_addr);
+    pairs[(i * 2) + 1] = ntohs(address[i].sin_port);
+  }
+
+  e->SetIntArrayRegion(lengths, 0, r, length);
+  e->SetIntArrayRegion(addresses, 0, r * 2, pairs);
+
+  return r;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_DatagramChannel_sendBatch(JNIEnv* e,
+                                                 jclass,
+                                                 jint socket,
+                                                 jobjectArray buffers,
+                                                 jintArray offsets,
+                                                 jintArray lengths,
+                                                 jobjectArray hosts,
+                                                 jintArray ports,
+                                                 jint count)
+{
+  uint8_t* data[MaxBatchCount];
+  jint length[MaxBatchCount];
+  count = batchBuffers(e, buffers, offsets, lengths, count, data, length);
+  if (count == 0) {
+    return 0;
+  }
+
+  // without hosts, each datagram goes to the connected address
+  sockaddr_in address[MaxBatchCount];
+  socklen_t addressSize = 0;
+  if (hosts) {
+    jint port[MaxBatchCount];
+    e->GetIntArrayRegion(ports, 0, count, port);
+    for (int i = 0; i < count; ++i) {
+      init(e, address + i,
+           static_cast<jstring>(e->GetObjectArrayElement(hosts, i)), port[i]);
+      if (e->ExceptionCheck()) return 0;
+    }
+    addressSize = sizeof(sockaddr_in);
+  }
+
+  int r;
+
+#ifdef AVIAN_MMSG
+  iovec vector[MaxBatchCount];
+  mmsghdr message[MaxBatchCount];
+  memset(message, 0, count * sizeof(mmsghdr));
+  for (int i = 0; i < count; ++i) {
+    vector[i].iov_base = data[i];
+    vector[i].iov_len = length[i];
+    message[i].msg_hdr.msg_name = addressSize ? address + i : 0;
+    message[i].msg_hdr.msg_namelen = addressSize;
+    message[i].msg_hdr.msg_iov = vector + i;
+    message[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  r = ::sendmmsg(socket, message, count, 0);
+#else
+  r = 0;
+  while (r < count) {
+    int n = sendto
+      (socket, reinterpret_cast<char*>(data[r]), length[r], 0,
+       addressSize ? reinterpret_cast<sockaddr*>(address + r) : 0,
+       addressSize);
+    if (n < 0) {
+      if (r == 0) {
+        r = -1;
+      }
+      break;
+    }
+
+    ++ r;
+  }
+#endif
+
+  if (r < 0) {
+    if (not eagain()) {
+      throwIOException(e);
+    }
+    return 0;
+  }
+
+  return r;
+}
+
 extern "C" JNIEXPORT void JNICALL
 Java_java_nio_channels_SocketChannel_natThrowWriteError(JNIEnv *e,
 							jclass,
@@ -811,14 +1205,152 @@ class Pipe {
 #endif
 };
 
+#if (defined AVIAN_EPOLL) || (defined AVIAN_KQUEUE)
+
+// Interest and readiness are tracked per descriptor so that interest
+// changes only reach the kernel when they actually differ from what
+// was last registered, and so natUpdateReadySet can answer without
+// scanning anything.
+
+const uint8_t ReadInterest = 1 << 0;
+const uint8_t WriteInterest = 1 << 1;
+
+const unsigned EventCapacity = 1024;
+
+#ifdef AVIAN_EPOLL
+typedef epoll_event Event;
+#else
+typedef struct kevent Event;
+#endif
+
 struct SelectorState {
-  fd_set read;
-  fd_set write;
-  fd_set except;
+  int queue;
+  uint8_t* interest;
+  uint8_t* ready;
+  unsigned capacity;
+  unsigned eventCount;
+  Event events[EventCapacity];
   Pipe control;
-  SelectorState(JNIEnv* e) : control(e) { }
+  SelectorState(JNIEnv* e):
+    queue(-1), interest(0), ready(0), capacity(0), eventCount(0), control(e)
+  { }
 };
 
+bool
+reserve(SelectorState* s, int socket)
+{
+  unsigned index = static_cast<unsigned>(socket);
+  if (index >= s->capacity) {
+    unsigned capacity = s->capacity ? s->capacity : 256;
+    while (capacity <= index) {
+      capacity *= 2;
+    }
+
+    uint8_t* interest = static_cast<uint8_t*>(realloc(s->interest, capacity));
+    if (interest == 0) {
+      return false;
+    }
+    s->interest = interest;
+
+    uint8_t* ready = static_cast<uint8_t*>(realloc(s->ready, capacity));
+    if (ready == 0) {
+      return false;
+    }
+    s->ready = ready;
+
+    memset(interest + s->capacity, 0, capacity - s->capacity);
+    memset(ready + s->capacity, 0, capacity - s->capacity);
+    s->capacity = capacity;
+  }
+  return true;
+}
+
+inline int
+eventSocket(Event* event)
+{
+#ifdef AVIAN_EPOLL
+  return event->data.fd;
+#else
+  return static_cast<int>(event->ident);
+#endif
+}
+
+#ifdef AVIAN_KQUEUE
+bool
+changeFilter(SelectorState* s, int socket, int filter, bool add)
+{
+  struct kevent change;
+  EV_SET(&change, socket, filter, add ? EV_ADD : EV_DELETE, 0, 0, 0);
+  if (kevent(s->queue, &change, 1, 0, 0, 0) < 0) {
+    // the kernel drops filters for closed descriptors on its own
+    return (not add) and (errno == ENOENT or errno == EBADF);
+  }
+  return true;
+}
+#endif
+
+// returns false with errno set if the kernel rejected the change
+bool
+updateInterest(SelectorState* s, int socket, uint8_t interest)
+{
+  uint8_t old = s->interest[socket];
+  if (old == interest) {
+    return true;
+  }
+
+#ifdef AVIAN_EPOLL
+  epoll_event event;
+  memset(&event, 0, sizeof(event));
+  if (interest & ReadInterest) {
+    event.events |= EPOLLIN;
+  }
+  if (interest & WriteInterest) {
+    event.events |= EPOLLOUT;
+  }
+  event.data.fd = socket;
+
+  int r;
+  if (interest == 0) {
+    r = epoll_ctl(s->queue, EPOLL_CTL_DEL, socket, &event);
+    if (r != 0 and (errno == ENOENT or errno == EBADF)) {
+      // the descriptor was closed, which removed it already
+      r = 0;
+    }
+  } else if (old == 0) {
+    r = epoll_ctl(s->queue, EPOLL_CTL_ADD, socket, &event);
+    if (r != 0 and errno == EEXIST) {
+      r = epoll_ctl(s->queue, EPOLL_CTL_MOD, socket, &event);
+    }
+  } else {
+    r = epoll_ctl(s->queue, EPOLL_CTL_MOD, socket, &event);
+    if (r != 0 and errno == ENOENT) {
+      r = epoll_ctl(s->queue, EPOLL_CTL_ADD, socket, &event);
+    }
+  }
+
+  if (r != 0) {
+    return false;
+  }
+#else
+  if (((old ^ interest) & ReadInterest)
+      and not changeFilter
+      (s, socket, EVFILT_READ, (interest & ReadInterest) != 0))
+  {
+    return false;
+  }
+
+  if (((old ^ interest) & WriteInterest)
+      and not changeFilter
+      (s, socket, EVFILT_WRITE, (interest & WriteInterest) != 0))
+  {
+    return false;
+  }
+#endif
+
+  s->interest[socket] = interest;
+  return true;
+}
+
 } // namespace
 
 extern "C" JNIEXPORT jlong JNICALL
@@ -827,14 +1359,33 @@ Java_java_nio_channels_SocketSelector_natInit(JNIEnv* e, jclass)
   void *mem = malloc(sizeof(SelectorState));
   if (mem) {
     SelectorState *s = new (mem) SelectorState(e);
-    if (e->ExceptionCheck()) return 0;
+    if (e->ExceptionCheck()) {
+      free(s);
+      return 0;
+    }
 
-    if (s) {
-      FD_ZERO(&(s->read));
-      FD_ZERO(&(s->write));
-      FD_ZERO(&(s->except));
-      return reinterpret_cast<jlong>(s);
+#ifdef AVIAN_EPOLL
+    s->queue = epoll_create(EventCapacity);
+#else
+    s->queue = kqueue();
+#endif
+
+    if (s->queue < 0
+        or not reserve(s, s->control.reader())
+        or not updateInterest(s, s->control.reader(), ReadInterest))
+    {
+      throwIOException(e);
+      if (s->queue >= 0) {
+        ::doClose(s->queue);
+      }
+      s->control.dispose();
+      free(s->interest);
+      free(s->ready);
+      free(s);
+      return 0;
     }
+
+    return reinterpret_cast<jlong>(s);
   }
   throwNew(e, "java/lang/OutOfMemoryError", 0);
   return 0;
@@ -858,6 +1409,9 @@ Java_java_nio_channels_SocketSelector_natClose(JNIEnv *, jclass, jlong state)
 {
   SelectorState* s = reinterpret_cast<SelectorState*>(state);
   s->control.dispose();
+  ::doClose(s->queue);
+  free(s->interest);
+  free(s->ready);
   free(s);
 }
 
@@ -867,13 +1421,14 @@ Java_java_nio_channels_SocketSelector_natSelectClearAll(JNIEnv *, jclass,
 							jlong state)
 {
   SelectorState* s = reinterpret_cast<SelectorState*>(state);
-  FD_CLR(static_cast<unsigned>(socket), &(s->read));
-  FD_CLR(static_cast<unsigned>(socket), &(s->write));
-  FD_CLR(static_cast<unsigned>(socket), &(s->except));
+  if (static_cast<unsigned>(socket) < s->capacity) {
+    updateInterest(s, socket, 0);
+    s->ready[socket] = 0;
+  }
 }
 
 extern "C" JNIEXPORT jint JNICALL
-Java_java_nio_channels_SocketSelector_natSelectUpdateInterestSet(JNIEnv *,
+Java_java_nio_channels_SocketSelector_natSelectUpdateInterestSet(JNIEnv *e,
 								 jclass,
 								 jint socket,
 								 jint interest,
@@ -881,21 +1436,23 @@ Java_java_nio_channels_SocketSelector_natSelectUpdateInterestSet(JNIEnv *,
 								 jint max)
 {
   SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  uint8_t events = 0;
   if (interest & (java_nio_channels_SelectionKey_OP_READ |
 		  java_nio_channels_SelectionKey_OP_ACCEPT)) {
-    FD_SET(static_cast<unsigned>(socket), &(s->read));
-    if (max < socket) max = socket;
-  } else {
-    FD_CLR(static_cast<unsigned>(socket), &(s->read));
+    events |= ReadInterest;
   }
-  
+
   if (interest & (java_nio_channels_SelectionKey_OP_WRITE |
 		  java_nio_channels_SelectionKey_OP_CONNECT)) {
-    FD_SET(static_cast<unsigned>(socket), &(s->write));
-    FD_SET(static_cast<unsigned>(socket), &(s->except));
-    if (max < socket) max = socket;
-  } else {
-    FD_CLR(static_cast<unsigned>(socket), &(s->write));
+    events |= WriteInterest;
+  }
+
+  if (not reserve(s, socket)) {
+    throwNew(e, "java/lang/OutOfMemoryError", 0);
+  } else if (not updateInterest(s, socket, events)) {
+    throwIOException(e);
+  } else if (events and max < socket) {
+    max = socket;
   }
   return max;
 }
@@ -903,30 +1460,269 @@ Java_java_nio_channels_SocketSelector_natSelectUpdateInterestSet(JNIEnv *,
 extern "C" JNIEXPORT jint JNICALL
 Java_java_nio_channels_SocketSelector_natDoSocketSelect(JNIEnv *e, jclass,
 							jlong state,
-							jint max,
+							jint,
 							jlong interval)
 {
   SelectorState* s = reinterpret_cast<SelectorState*>(state);
-  if (s->control.reader() >= 0) {
-    int socket = s->control.reader();
-    FD_SET(static_cast<unsigned>(socket), &(s->read));
-    if (max < socket) max = socket;
-  }
 
-#ifdef PLATFORM_WINDOWS
-  if (s->control.listener() >= 0) {
-    int socket = s->control.listener();
-    FD_SET(static_cast<unsigned>(socket), &(s->read));
-    if (max < socket) max = socket;
+  // forget what the previous select reported
+  for (unsigned i = 0; i < s->eventCount; ++i) {
+    unsigned socket = eventSocket(s->events + i);
+    if (socket < s->capacity) {
+      s->ready[socket] = 0;
+    }
   }
+  s->eventCount = 0;
 
-  if (not s->control.connected()) {
-    int socket = s->control.writer();
-    FD_SET(static_cast<unsigned>(socket), &(s->write));
-    FD_SET(static_cast<unsigned>(socket), &(s->except));
-    if (max < socket) max = socket;
-  }
-#endif
+#ifdef AVIAN_EPOLL
+  int timeout;
+  if (interval > 0) {
+    timeout = interval > 0x7FFFFFFF ? 0x7FFFFFFF : interval;
+  } else if (interval < 0) {
+    timeout = 0;
+  } else {
+    timeout = -1;
+  }
+  int r = epoll_wait(s->queue, s->events, EventCapacity, timeout);
+#else
+  timespec time;
+  if (interval > 0) {
+    time.tv_sec = interval / 1000;
+    time.tv_nsec = (interval % 1000) * 1000 * 1000;
+  } else {
+    time.tv_sec = 0;
+    time.tv_nsec = 0;
+  }
+  int r = kevent
+    (s->queue, 0, 0, s->events, EventCapacity, interval == 0 ? 0 : &time);
+#endif
+
+  if (r < 0) {
+    if (errno != EINTR) {
+      throwIOException(e);
+      return 0;
+    }
+    return r;
+  }
+
+  s->eventCount = r;
+
+  for (int i = 0; i < r; ++i) {
+    Event* event = s->events + i;
+    unsigned socket = eventSocket(event);
+
+    if (static_cast<int>(socket) == s->control.reader()) {
+      char c;
+      int r = 1;
+      while (r == 1) {
+        r = ::doRead(s->control.reader(), &c, 1);
+      }
+      if (r < 0 and not eagain()) {
+        throwIOException(e);
+      }
+    } else if (socket < s->capacity) {
+#ifdef AVIAN_EPOLL
+      if (event->events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        s->ready[socket] |= ReadInterest;
+      }
+      if (event->events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+        s->ready[socket] |= WriteInterest;
+      }
+#else
+      if (event->flags & EV_ERROR) {
+        continue;
+      } else if (event->filter == EVFILT_READ) {
+        s->ready[socket] |= ReadInterest;
+      } else if (event->filter == EVFILT_WRITE) {
+        s->ready[socket] |= WriteInterest;
+      }
+#endif
+    }
+  }
+
+  return r;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_SocketSelector_natUpdateReadySet(JNIEnv *, jclass,
+							jint socket,
+							jint interest,
+							jlong state)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  jint ready = 0;
+
+  uint8_t events = static_cast<unsigned>(socket) < s->capacity
+    ? s->ready[socket] : 0;
+
+  if (events & ReadInterest) {
+    if (interest & java_nio_channels_SelectionKey_OP_READ) {
+      ready |= java_nio_channels_SelectionKey_OP_READ;
+    }
+
+    if (interest & java_nio_channels_SelectionKey_OP_ACCEPT) {
+      ready |= java_nio_channels_SelectionKey_OP_ACCEPT;
+    }
+  }
+
+  if (events & WriteInterest) {
+    if (interest & java_nio_channels_SelectionKey_OP_WRITE) {
+      ready |= java_nio_channels_SelectionKey_OP_WRITE;
+    }
+
+    if (interest & java_nio_channels_SelectionKey_OP_CONNECT) {
+      ready |= java_nio_channels_SelectionKey_OP_CONNECT;
+    }
+  }
+
+  return ready;
+}
+
+#else // not AVIAN_EPOLL or AVIAN_KQUEUE
+
+struct SelectorState {
+  fd_set read;
+  fd_set write;
+  fd_set except;
+  Pipe control;
+  SelectorState(JNIEnv* e) : control(e) { }
+};
+
+// FD_SET quietly drops handles on Windows, and overruns the set
+// elsewhere, when there is no room for the socket, so check first.  On
+// Windows, room is kept for the two sockets natDoSocketSelect adds to
+// each set for the control pipe.
+bool
+fits(int socket, fd_set* set UNUSED)
+{
+#ifdef PLATFORM_WINDOWS
+  return set->fd_count + 2 < FD_SETSIZE
+    or FD_ISSET(static_cast<unsigned>(socket), set);
+#else
+  return socket < FD_SETSIZE;
+#endif
+}
+
+} // namespace
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_channels_SocketSelector_natInit(JNIEnv* e, jclass)
+{
+  void *mem = malloc(sizeof(SelectorState));
+  if (mem) {
+    SelectorState *s = new (mem) SelectorState(e);
+    if (e->ExceptionCheck()) return 0;
+
+    if (s) {
+      FD_ZERO(&(s->read));
+      FD_ZERO(&(s->write));
+      FD_ZERO(&(s->except));
+      return reinterpret_cast<jlong>(s);
+    }
+  }
+  throwNew(e, "java/lang/OutOfMemoryError", 0);
+  return 0;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_SocketSelector_natWakeup(JNIEnv *e, jclass, jlong state)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  if (s->control.connected()) {
+    const char c = 1;
+    int r = ::doWrite(s->control.writer(), &c, 1);
+    if (r != 1) {
+      throwIOException(e);
+    }
+  }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_SocketSelector_natClose(JNIEnv *, jclass, jlong state)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  s->control.dispose();
+  free(s);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_SocketSelector_natSelectClearAll(JNIEnv *, jclass,
+							jint socket,
+							jlong state)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  FD_CLR(static_cast<unsigned>(socket), &(s->read));
+  FD_CLR(static_cast<unsigned>(socket), &(s->write));
+  FD_CLR(static_cast<unsigned>(socket), &(s->except));
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_SocketSelector_natSelectUpdateInterestSet(JNIEnv *e,
+								 jclass,
+								 jint socket,
+								 jint interest,
+								 jlong state,
+								 jint max)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  bool reading = interest & (java_nio_channels_SelectionKey_OP_READ |
+                             java_nio_channels_SelectionKey_OP_ACCEPT);
+  bool writing = interest & (java_nio_channels_SelectionKey_OP_WRITE |
+                             java_nio_channels_SelectionKey_OP_CONNECT);
+  if ((reading and not fits(socket, &(s->read)))
+      or (writing and not (fits(socket, &(s->write))
+                           and fits(socket, &(s->except)))))
+  {
+    throwNew(e, "java/io/IOException", "too many sockets for select");
+    return max;
+  }
+
+  if (interest & (java_nio_channels_SelectionKey_OP_READ |
+		  java_nio_channels_SelectionKey_OP_ACCEPT)) {
+    FD_SET(static_cast<unsigned>(socket), &(s->read));
+    if (max < socket) max = socket;
+  } else {
+    FD_CLR(static_cast<unsigned>(socket), &(s->read));
+  }
+  
+  if (interest & (java_nio_channels_SelectionKey_OP_WRITE |
+		  java_nio_channels_SelectionKey_OP_CONNECT)) {
+    FD_SET(static_cast<unsigned>(socket), &(s->write));
+    FD_SET(static_cast<unsigned>(socket), &(s->except));
+    if (max < socket) max = socket;
+  } else {
+    FD_CLR(static_cast<unsigned>(socket), &(s->write));
+  }
+  return max;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_SocketSelector_natDoSocketSelect(JNIEnv *e, jclass,
+							jlong state,
+							jint max,
+							jlong interval)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  if (s->control.reader() >= 0) {
+    int socket = s->control.reader();
+    FD_SET(static_cast<unsigned>(socket), &(s->read));
+    if (max < socket) max = socket;
+  }
+
+#ifdef PLATFORM_WINDOWS
+  if (s->control.listener() >= 0) {
+    int socket = s->control.listener();
+    FD_SET(static_cast<unsigned>(socket), &(s->read));
+    if (max < socket) max = socket;
+  }
+
+  if (not s->control.connected()) {
+    int socket = s->control.writer();
+    FD_SET(static_cast<unsigned>(socket), &(s->write));
+    FD_SET(static_cast<unsigned>(socket), &(s->except));
+    if (max < socket) max = socket;
+  }
+#endif
 
   timeval time;
   if (interval > 0) {
@@ -1029,6 +1825,380 @@ Java_java_nio_channels_SocketSelector_natUpdateReadySet(JNIEnv *, jclass,
 }
 
 
+#endif // not AVIAN_EPOLL or AVIAN_KQUEUE
+
+namespace {
+
+jlong
+seek(JNIEnv* e, jint fd, jlong offset, int whence)
+{
+#ifdef PLATFORM_WINDOWS
+  jlong r = _lseeki64(fd, offset, whence);
+#else
+  jlong r = lseek(fd, offset, whence);
+#endif
+  if (r < 0) {
+    throwIOException(e, errorString(e, errno));
+  }
+  return r;
+}
+
+// reads or writes at the specified position without moving the file
+// pointer, or at the file pointer if the position is negative
+int
+fileTransfer(int fd, void* buffer, unsigned length, jlong position,
+             bool write)
+{
+#ifdef PLATFORM_WINDOWS
+  __int64 saved = -1;
+  if (position >= 0) {
+    saved = _lseeki64(fd, 0, SEEK_CUR);
+    if (saved < 0 or _lseeki64(fd, position, SEEK_SET) < 0) {
+      return -1;
+    }
+  }
+
+  int r = write ? _write(fd, buffer, length) : _read(fd, buffer, length);
+
+  if (saved >= 0) {
+    int error = errno;
+    _lseeki64(fd, saved, SEEK_SET);
+    errno = error;
+  }
+  return r;
+#else
+  if (position >= 0) {
+    return write ? pwrite(fd, buffer, length, position)
+      : pread(fd, buffer, length, position);
+  } else {
+    return write ? ::write(fd, buffer, length) : ::read(fd, buffer, length);
+  }
+#endif
+}
+
+} // namespace
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_channels_FileChannel_natPosition(JNIEnv* e, jclass, jint fd)
+{
+  return seek(e, fd, 0, SEEK_CUR);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_FileChannel_natSetPosition(JNIEnv* e, jclass, jint fd,
+                                                  jlong position)
+{
+  seek(e, fd, position, SEEK_SET);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_channels_FileChannel_natSize(JNIEnv* e, jclass, jint fd)
+{
+#ifdef PLATFORM_WINDOWS
+  struct _stati64 s;
+  int r = _fstati64(fd, &s);
+#else
+  struct stat s;
+  int r = fstat(fd, &s);
+#endif
+  if (r != 0) {
+    throwIOException(e, errorString(e, errno));
+    return 0;
+  }
+  return s.st_size;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_FileChannel_natRead(JNIEnv* e, jclass, jint fd,
+                                           jbyteArray buffer, jint offset,
+                                           jint length, jlong position)
+{
+  uint8_t* buf = static_cast<uint8_t*>(allocate(e, length));
+  if (buf == 0) {
+    return 0;
+  }
+
+  int r = fileTransfer(fd, buf, length, position, false);
+  if (r > 0) {
+    e->SetByteArrayRegion(buffer, offset, r, reinterpret_cast<jbyte*>(buf));
+  }
+  free(buf);
+
+  if (r < 0) {
+    throwIOException(e, errorString(e, errno));
+    return 0;
+  }
+  return r;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_FileChannel_natWrite(JNIEnv* e, jclass, jint fd,
+                                            jbyteArray buffer, jint offset,
+                                            jint length, jlong position)
+{
+  uint8_t* buf = static_cast<uint8_t*>(allocate(e, length));
+  if (buf == 0) {
+    return 0;
+  }
+
+  e->GetByteArrayRegion(buffer, offset, length, reinterpret_cast<jbyte*>(buf));
+
+  int r = fileTransfer(fd, buf, length, position, true);
+  free(buf);
+
+  if (r < 0) {
+    throwIOException(e, errorString(e, errno));
+    return 0;
+  }
+  return r;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_FileChannel_natReadDirect(JNIEnv* e, jclass, jint fd,
+                                                 jobject buffer, jint offset,
+                                                 jint length, jlong position)
+{
+  uint8_t* buf = static_cast<uint8_t*>(e->GetDirectBufferAddress(buffer));
+  if (e->ExceptionCheck()) {
+    return 0;
+  }
+
+  int r = fileTransfer(fd, buf + offset, length, position, false);
+  if (r < 0) {
+    throwIOException(e, errorString(e, errno));
+    return 0;
+  }
+  return r;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_FileChannel_natWriteDirect(JNIEnv* e, jclass, jint fd,
+                                                  jobject buffer, jint offset,
+                                                  jint length, jlong position)
+{
+  uint8_t* buf = static_cast<uint8_t*>(e->GetDirectBufferAddress(buffer));
+  if (e->ExceptionCheck()) {
+    return 0;
+  }
+
+  int r = fileTransfer(fd, buf + offset, length, position, true);
+  if (r < 0) {
+    throwIOException(e, errorString(e, errno));
+    return 0;
+  }
+  return r;
+}
+
+// Returns the number of bytes sent from the file directly to the
+// socket, or -1 if the platform can't do that for this pair of
+// descriptors, in which case the caller copies through a buffer
+// instead.
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_channels_FileChannel_natTransferTo(JNIEnv* e, jclass, jint fd,
+                                                 jlong position, jlong count,
+                                                 jint socket)
+{
+#ifdef __linux__
+  // sendfile transfers at most this much per call
+  const jlong Max = 0x7FFFF000;
+
+  off_t offset = position;
+  ssize_t r = sendfile(socket, fd, &offset, count > Max ? Max : count);
+  if (r < 0) {
+    if (errno == EAGAIN or errno == EINTR) {
+      return 0;
+    } else if (errno == EINVAL or errno == ENOSYS) {
+      return -1;
+    } else {
+      throwIOException(e);
+      return 0;
+    }
+  }
+  return r;
+#elif defined __APPLE__
+  off_t length = count;
+  if (sendfile(fd, socket, position, &length, 0, 0) < 0) {
+    if (errno == EAGAIN or errno == EINTR) {
+      return length;
+    } else if (length == 0
+               and (errno == ENOTSOCK or errno == EOPNOTSUPP
+                    or errno == EINVAL))
+    {
+      return -1;
+    } else {
+      throwIOException(e);
+      return 0;
+    }
+  }
+  return length;
+#elif defined __FreeBSD__
+  off_t sent = 0;
+  if (sendfile(fd, socket, position, count, 0, &sent, 0) < 0) {
+    if (errno == EAGAIN or errno == EBUSY or errno == EINTR) {
+      return sent;
+    } else if (sent == 0
+               and (errno == ENOTSOCK or errno == EOPNOTSUPP
+                    or errno == EINVAL))
+    {
+      return -1;
+    } else {
+      throwIOException(e);
+      return 0;
+    }
+  }
+  return sent;
+#else
+  (void) e;
+  (void) fd;
+  (void) position;
+  (void) count;
+  (void) socket;
+  return -1;
+#endif
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_MappedByteBuffer_natAlignment(JNIEnv*, jclass)
+{
+#ifdef PLATFORM_WINDOWS
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwAllocationGranularity;
+#else
+  return sysconf(_SC_PAGESIZE);
+#endif
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_MappedByteBuffer_natMap(JNIEnv* e, jclass, jint fd, jint mode,
+                                      jlong position, jlong length)
+{
+#ifdef PLATFORM_WINDOWS
+  DWORD protect;
+  DWORD access;
+  switch (mode) {
+  case MapReadOnly:
+    protect = PAGE_READONLY;
+    access = FILE_MAP_READ;
+    break;
+
+  case MapReadWrite:
+    protect = PAGE_READWRITE;
+    access = FILE_MAP_WRITE;
+    break;
+
+  default:
+    protect = PAGE_WRITECOPY;
+    access = FILE_MAP_COPY;
+    break;
+  }
+
+  // a read-write mapping grows the file as needed
+  uint64_t end = mode == MapReadWrite ? position + length : 0;
+
+  HANDLE mapping = CreateFileMapping
+    (reinterpret_cast<HANDLE>(_get_osfhandle(fd)), 0, protect,
+     static_cast<DWORD>(end >> 32), static_cast<DWORD>(end), 0);
+  if (mapping == 0) {
+    throwIOException(e, "unable to map file");
+    return 0;
+  }
+
+  void* p = MapViewOfFile
+    (mapping, access, static_cast<DWORD>(static_cast<uint64_t>(position) >> 32),
+     static_cast<DWORD>(position), length);
+
+  // the view keeps the mapping object alive
+  CloseHandle(mapping);
+
+  if (p == 0) {
+    throwIOException(e, "unable to map file");
+    return 0;
+  }
+  return reinterpret_cast<jlong>(p);
+#else
+  int protect;
+  int flags;
+  switch (mode) {
+  case MapReadOnly:
+    protect = PROT_READ;
+    flags = MAP_SHARED;
+    break;
+
+  case MapReadWrite:
+    protect = PROT_READ | PROT_WRITE;
+    flags = MAP_SHARED;
+    break;
+
+  default:
+    protect = PROT_READ | PROT_WRITE;
+    flags = MAP_PRIVATE;
+    break;
+  }
+
+  if (mode == MapReadWrite) {
+    // a read-write mapping grows the file as needed
+    struct stat s;
+    if (fstat(fd, &s) != 0
+        or (s.st_size < position + length
+            and ftruncate(fd, position + length) != 0))
+    {
+      throwIOException(e);
+      return 0;
+    }
+  }
+
+  void* p = mmap(0, length, protect, flags, fd, position);
+  if (p == MAP_FAILED) {
+    throwIOException(e);
+    return 0;
+  }
+  return reinterpret_cast<jlong>(p);
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_MappedByteBuffer_natUnmap(JNIEnv*, jclass, jlong address,
+                                        jlong length)
+{
+#ifdef PLATFORM_WINDOWS
+  (void) length;
+  UnmapViewOfFile(reinterpret_cast<void*>(address));
+#else
+  munmap(reinterpret_cast<void*>(address), length);
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_MappedByteBuffer_natForce(JNIEnv*, jclass, jlong address,
+                                        jlong length)
+{
+#ifdef PLATFORM_WINDOWS
+  FlushViewOfFile(reinterpret_cast<void*>(address), length);
+#else
+  // msync wants a page-aligned start
+  uintptr_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t start = static_cast<uintptr_t>(address) & ~(page - 1);
+  msync(reinterpret_cast<void*>(start), length + (address - start), MS_SYNC);
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_MappedByteBuffer_natLoad(JNIEnv*, jclass, jlong address,
+                                       jlong length)
+{
+  // touch one byte per page to fault the region in
+  const unsigned Page = 4096;
+
+  volatile const uint8_t* p = reinterpret_cast<uint8_t*>(address);
+  uint8_t sum = 0;
+  for (jlong i = 0; i < length; i += Page) {
+    sum += p[i];
+  }
+  sum += p[length - 1];
+  (void) sum;
+}
+
 extern "C" JNIEXPORT jboolean JNICALL
 Java_java_nio_ByteOrder_isNativeBigEndian(JNIEnv *, jclass)
 {
@@ -15,6 +15,123 @@
 #include "jni.h"
 #include "jni-util.h"
 
+#ifdef __ARM_FEATURE_CRC32
+#  include "arm_acle.h"
+#endif
+
+namespace {
+
+// Runs zlib over input and output which are each given either as a
+// byte array or as a direct buffer, whichever is non-null, with the
+// offset relative to the start of the array or buffer.  Direct buffers
+// are read and written in place, with no copying.
+void
+run(JNIEnv* e, jlong peer, bool deflating, int flush,
+    jbyteArray inputArray, jobject inputBuffer, jint inputOffset,
+    jint inputLength,
+    jbyteArray outputArray, jobject outputBuffer, jint outputOffset,
+    jint outputLength,
+    jintArray results)
+{
+  z_stream* s = reinterpret_cast<z_stream*>(peer);
+
+  // look up the buffer addresses first, since no other JNI calls may
+  // be made while the arrays are pinned below
+  jbyte* in = 0;
+  if (inputBuffer) {
+    in = static_cast<jbyte*>(e->GetDirectBufferAddress(inputBuffer));
+  }
+
+  jbyte* out = 0;
+  if (outputBuffer) {
+    out = static_cast<jbyte*>(e->GetDirectBufferAddress(outputBuffer));
+  }
+
+  if (e->ExceptionCheck()) {
+    return;
+  }
+
+  // zlib never blocks, so we can safely work on the arrays in place
+  // rather than copying them in and out of temporary buffers
+  if (inputArray) {
+    in = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(inputArray, 0));
+  }
+  if (outputArray) {
+    out = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(outputArray, 0));
+  }
+
+  s->next_in = reinterpret_cast<Bytef*>(in + inputOffset);
+  s->avail_in = inputLength;
+  s->next_out = reinterpret_cast<Bytef*>(out + outputOffset);
+  s->avail_out = outputLength;
+
+  int r = deflating ? deflate(s, flush) : inflate(s, flush);
+
+  if (outputArray) {
+    e->ReleasePrimitiveArrayCritical(outputArray, out, 0);
+  }
+  if (inputArray) {
+    e->ReleasePrimitiveArrayCritical(inputArray, in, 0);
+  }
+
+  jint resultArray[3]
+    = { r,
+        static_cast<jint>(inputLength - s->avail_in),
+        static_cast<jint>(outputLength - s->avail_out) };
+
+  e->SetIntArrayRegion(results, 0, 3, resultArray);
+}
+
+uLong
+updateCrc(uLong value, const Bytef* p, uInt length)
+{
+#ifdef __ARM_FEATURE_CRC32
+  // the ARMv8 instructions use the same polynomial as zlib, eight
+  // bytes at a time
+  uint32_t c = ~static_cast<uint32_t>(value);
+  for (; length >= 8; p += 8, length -= 8) {
+    uint64_t v; memcpy(&v, p, 8);
+    c = __crc32d(c, v);
+  }
+  for (; length; ++p, --length) {
+    c = __crc32b(c, *p);
+  }
+  return ~c;
+#else
+  return crc32(value, p, length);
+#endif
+}
+
+// Updates a checksum over bytes given either as a byte array or as a
+// direct buffer, whichever is non-null, in the manner of run above.
+jint
+checksum(JNIEnv* e, bool adler, jint value, jbyteArray array,
+         jobject buffer, jint offset, jint length)
+{
+  jbyte* p;
+  if (buffer) {
+    p = static_cast<jbyte*>(e->GetDirectBufferAddress(buffer));
+    if (p == 0) {
+      return value;
+    }
+  } else {
+    p = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(array, 0));
+  }
+
+  const Bytef* start = reinterpret_cast<Bytef*>(p + offset);
+  uLong v = static_cast<uint32_t>(value);
+  jint result = static_cast<jint>
+    (adler ? adler32(v, start, length) : updateCrc(v, start, length));
+
+  if (array) {
+    e->ReleasePrimitiveArrayCritical(array, p, JNI_ABORT);
+  }
+
+  return result;
+}
+
+} // namespace
+
 extern "C" JNIEXPORT jlong JNICALL
 Java_java_util_zip_Inflater_make
 (JNIEnv* e, jclass, jboolean nowrap)
@@ -45,47 +162,24 @@ Java_java_util_zip_Inflater_dispose(JNIEnv*, jclass, jlong peer)
   free(s);
 }
 
+extern "C" JNIEXPORT void JNICALL
+Java_java_util_zip_Inflater_reset(JNIEnv*, jclass, jlong peer)
+{
+  inflateReset(reinterpret_cast<z_stream*>(peer));
+}
+
 extern "C" JNIEXPORT void JNICALL
 Java_java_util_zip_Inflater_inflate
 (JNIEnv* e, jclass, jlong peer,
- jbyteArray input, jint inputOffset, jint inputLength,
- jbyteArray output, jint outputOffset, jint outputLength,
+ jbyteArray inputArray, jobject inputBuffer, jint inputOffset,
+ jint inputLength,
+ jbyteArray outputArray, jobject outputBuffer, jint outputOffset,
+ jint outputLength,
  jintArray results)
 {
-  z_stream* s = reinterpret_cast<z_stream*>(peer);
-
-  jbyte* in = static_cast<jbyte*>(malloc(inputLength));
-  if (in == 0) {
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;    
-  }
-
-  jbyte* out = static_cast<jbyte*>(malloc(outputLength));
-  if (out == 0) {
-    free(in);
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;    
-  }
-
-  e->GetByteArrayRegion(input, inputOffset, inputLength, in);
-  
-  s->next_in = reinterpret_cast<Bytef*>(in);
-  s->avail_in = inputLength;
-  s->next_out = reinterpret_cast<Bytef*>(out);
-  s->avail_out = outputLength;
-
-  int r = inflate(s, Z_SYNC_FLUSH);
-  jint resultArray[3]
-    = { r,
-        static_cast<jint>(inputLength - s->avail_in),
-        static_cast<jint>(outputLength - s->avail_out) };
-
-  free(in);
-
-  e->SetByteArrayRegion(output, outputOffset, resultArray[2], out);
-  free(out);
-
-  e->SetIntArrayRegion(results, 0, 3, resultArray);
+  run(e, peer, false, Z_SYNC_FLUSH,
+      inputArray, inputBuffer, inputOffset, inputLength,
+      outputArray, outputBuffer, outputOffset, outputLength, results);
 }
 
 extern "C" JNIEXPORT jlong JNICALL
@@ -118,45 +212,38 @@ Java_java_util_zip_Deflater_dispose(JNIEnv*, jclass, jlong peer)
   free(s);
 }
 
+extern "C" JNIEXPORT void JNICALL
+Java_java_util_zip_Deflater_reset(JNIEnv*, jclass, jlong peer)
+{
+  deflateReset(reinterpret_cast<z_stream*>(peer));
+}
+
 extern "C" JNIEXPORT void JNICALL
 Java_java_util_zip_Deflater_deflate
-(JNIEnv* e, jclass, jlong peer, 
- jbyteArray input, jint inputOffset, jint inputLength,
- jbyteArray output, jint outputOffset, jint outputLength,
+(JNIEnv* e, jclass, jlong peer,
+ jbyteArray inputArray, jobject inputBuffer, jint inputOffset,
+ jint inputLength,
+ jbyteArray outputArray, jobject outputBuffer, jint outputOffset,
+ jint outputLength,
  jboolean finish, jintArray results)
 {
-  z_stream* s = reinterpret_cast<z_stream*>(peer);
-
-  jbyte* in = static_cast<jbyte*>(malloc(inputLength));
-  if (in == 0) {
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;    
-  }
-
-  jbyte* out = static_cast<jbyte*>(malloc(outputLength));
-  if (out == 0) {
-    free(in);
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;    
-  }
-
-  e->GetByteArrayRegion(input, inputOffset, inputLength, in);
-  
-  s->next_in = reinterpret_cast<Bytef*>(in);
-  s->avail_in = inputLength;
-  s->next_out = reinterpret_cast<Bytef*>(out);
-  s->avail_out = outputLength;
-
-  int r = deflate(s, finish ? Z_FINISH : Z_NO_FLUSH);
-  jint resultArray[3]
-    = { r,
-        static_cast<jint>(inputLength - s->avail_in),
-        static_cast<jint>(outputLength - s->avail_out) };
-
-  free(in);
+  run(e, peer, true, finish ? Z_FINISH : Z_NO_FLUSH,
+      inputArray, inputBuffer, inputOffset, inputLength,
+      outputArray, outputBuffer, outputOffset, outputLength, results);
+}
 
-  e->SetByteArrayRegion(output, outputOffset, resultArray[2], out);
-  free(out);
+extern "C" JNIEXPORT jint JNICALL
+Java_java_util_zip_CRC32_update
+(JNIEnv* e, jclass, jint crc, jbyteArray array, jobject buffer,
+ jint offset, jint length)
+{
+  return checksum(e, false, crc, array, buffer, offset, length);
+}
 
-  e->SetIntArrayRegion(results, 0, 3, resultArray);
+extern "C" JNIEXPORT jint JNICALL
+Java_java_util_zip_Adler32_update
+(JNIEnv* e, jclass, jint adler, jbyteArray array, jobject buffer,
+ jint offset, jint length)
+{
+  return checksum(e, true, adler, array, buffer, offset, length);
 }
@@ -11,6 +11,9 @@
 package java.io;
 
 public class BufferedInputStream extends InputStream {
+  // a multiple of the block size of most file systems
+  private static final int DefaultBufferSize = 8192;
+
   private final InputStream in;
   private final byte[] buffer;
   private int position;
@@ -22,7 +25,7 @@ public class BufferedInputStream extends InputStream {
   }
   
   public BufferedInputStream(InputStream in) {
-    this(in, 4096);
+    this(in, DefaultBufferSize);
   }
 
   private void fill() throws IOException {
@@ -42,8 +45,20 @@ public class BufferedInputStream extends InputStream {
   }
 
   public int read(byte[] b, int offset, int length) throws IOException {
+    if (length == 0) {
+      return 0;
+    }
+
     int count = 0;
 
+    if (position >= limit && length < buffer.length) {
+      // fill the buffer rather than passing small reads along one by one
+      fill();
+      if (limit == -1) {
+        return -1;
+      }
+    }
+
     if (position < limit) {
       int remaining = limit - position;
       if (remaining > length) {
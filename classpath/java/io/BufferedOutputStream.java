@@ -11,6 +11,8 @@
 package java.io;
 
 public class BufferedOutputStream extends OutputStream {
+  private static final int DefaultBufferSize = 8192;
+
   private final OutputStream out;
   private final byte[] buffer;
   private int position;
@@ -21,7 +23,7 @@ public class BufferedOutputStream extends OutputStream {
   }
   
   public BufferedOutputStream(OutputStream out) {
-    this(out, 4096);
+    this(out, DefaultBufferSize);
   }
   
   private void drain() throws IOException {
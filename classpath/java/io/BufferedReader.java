@@ -11,10 +11,15 @@
 package java.io;
 
 public class BufferedReader extends Reader {
+  private static final int DefaultBufferSize = 8192;
+
   private final Reader in;
   private final char[] buffer;
   private int position;
   private int limit;
+  // true if the last line read ended with '\r', so a '\n' which
+  // follows belongs to it
+  private boolean skipLF;
 
   public BufferedReader(Reader in, int bufferSize) {
     this.in = in;
@@ -22,7 +27,7 @@ public class BufferedReader extends Reader {
   }
 
   public BufferedReader(Reader in) {
-    this(in, 32);
+    this(in, DefaultBufferSize);
   }
   
   private void fill() throws IOException {
@@ -30,41 +35,78 @@ public class BufferedReader extends Reader {
     limit = in.read(buffer);
   }
 
+  // makes sure the buffer holds at least one char unless the end of the
+  // stream has been reached, skipping the '\n' of a "\r\n" split
+  // across reads
+  private boolean ensureAvailable() throws IOException {
+    if (position >= limit) {
+      fill();
+    }
+
+    if (skipLF && position < limit) {
+      skipLF = false;
+      if (buffer[position] == '\n' && ++ position >= limit) {
+        fill();
+      }
+    }
+
+    return position < limit;
+  }
+
   public String readLine() throws IOException {
-    StringBuilder sb = new StringBuilder();
+    StringBuilder sb = null;
     while (true) {
-      if (position >= limit) {
-        fill();
+      if (! ensureAvailable()) {
+        return sb == null ? null : sb.toString();
       }
 
-      if (position >= limit) {
-        return sb.length() == 0 ? null : sb.toString();
+      int start = position;
+      int i = start;
+      char c = 0;
+      while (i < limit && (c = buffer[i]) != '\n' && c != '\r') {
+        ++ i;
       }
 
-      for (int i = position; i < limit; ++i) {
-        if(buffer[i] == '\r') {
-          sb.append(buffer, position, i - position);
-          position = i + 1;
-          if(i+1 < limit && buffer[i+1] == '\n') {
-            position = i + 2;
-          }
-          return sb.toString();
-        } else if (buffer[i] == '\n') {
-          sb.append(buffer, position, i - position);
-          position = i + 1;
+      if (i < limit) {
+        position = i + 1;
+        skipLF = c == '\r';
+
+        if (sb == null) {
+          // the common case of a line which is all in the buffer
+          return new String(buffer, start, i - start);
+        } else {
+          sb.append(buffer, start, i - start);
           return sb.toString();
         }
       }
-      sb.append(buffer, position, limit-position);
+
+      if (sb == null) {
+        sb = new StringBuilder(i - start + 80);
+      }
+      sb.append(buffer, start, i - start);
       position = limit;
     }
   }
 
+  public int read() throws IOException {
+    if (ensureAvailable()) {
+      return buffer[position++];
+    } else {
+      return -1;
+    }
+  }
+
   public int read(char[] b, int offset, int length) throws IOException {
+    if (length == 0) {
+      return 0;
+    }
+
     int count = 0;
 
-    if (position >= limit && length < buffer.length) {
-      fill();
+    if (length < buffer.length || skipLF) {
+      if (! ensureAvailable()) {
+        return -1;
+      }
     }
 
     if (position < limit) {
@@ -81,15 +123,9 @@ public class BufferedReader extends Reader {
       length -= remaining;
     }
 
-    if (length > 0) {
-      int c = in.read(b, offset, length);
-      if (c == -1) {
-        if (count == 0) {
-          count = -1;
-        }
-      } else {
-        count += c;
-      }
+    if (count == 0) {
+      // the buffer would only get in the way of a read this large
+      count = in.read(b, offset, length);
     }
 
     return count;
@@ -11,6 +11,8 @@
 package java.io;
 
 public class BufferedWriter extends Writer {
+  private static final int DefaultBufferSize = 8192;
+
   private final Writer out;
   private final char[] buffer;
   private int position;
@@ -21,7 +23,7 @@ public class BufferedWriter extends Writer {
   }
   
   public BufferedWriter(Writer out) {
-    this(out, 4096);
+    this(out, DefaultBufferSize);
   }
   
   private void drain() throws IOException {
@@ -31,6 +33,31 @@ public class BufferedWriter extends Writer {
     }
   }
 
+  public void write(int c) throws IOException {
+    if (position >= buffer.length) {
+      drain();
+    }
+
+    buffer[position++] = (char) c;
+  }
+
+  public void write(String s, int offset, int length) throws IOException {
+    if (length > buffer.length - position) {
+      drain();
+      if (length > buffer.length) {
+        super.write(s, offset, length);
+        return;
+      }
+    }
+
+    s.getChars(offset, offset + length, buffer, position);
+    position += length;
+  }
+
+  public void write(String s) throws IOException {
+    write(s, 0, s.length());
+  }
+
   public void write(char[] b, int offset, int length) throws IOException {
     if (length > buffer.length - position) {
       drain();
@@ -10,12 +10,15 @@
 
 package java.io;
 
+import java.nio.channels.FileChannel;
+
 public class FileInputStream extends InputStream {
   //   static {
   //     System.loadLibrary("natives");
   //   }
 
   private int fd;
+  private FileChannel channel;
   private int remaining;
 
   public FileInputStream(FileDescriptor fd) {
@@ -31,6 +34,13 @@ public class FileInputStream extends InputStream {
     this(file.getPath());
   }
 
+  public FileChannel getChannel() {
+    if (channel == null) {
+      channel = new FileChannel(fd, this);
+    }
+    return channel;
+  }
+
   public int available() throws IOException {
     return remaining;
   }
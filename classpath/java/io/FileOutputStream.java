@@ -10,12 +10,15 @@
 
 package java.io;
 
+import java.nio.channels.FileChannel;
+
 public class FileOutputStream extends OutputStream {
   //   static {
   //     System.loadLibrary("natives");
   //   }
 
   private int fd;
+  private FileChannel channel;
 
   public FileOutputStream(FileDescriptor fd) {
     this.fd = fd.value;
@@ -34,6 +37,13 @@ public class FileOutputStream extends OutputStream {
     this(file.getPath());
   }
 
+  public FileChannel getChannel() {
+    if (channel == null) {
+      channel = new FileChannel(fd, this);
+    }
+    return channel;
+  }
+
   private static native int open(String path, boolean append) throws IOException;
 
   private static native void write(int fd, int c) throws IOException;
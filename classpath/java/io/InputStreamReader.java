@@ -13,9 +13,16 @@ package java.io;
 import avian.Utf8;
 
 public class InputStreamReader extends Reader {
-  private static final int MultibytePadding = 4;
+  private static final int BufferSize = 8192;
 
   private final InputStream in;
+  private final byte[] buffer = new byte[BufferSize];
+  private final int[] consumed = new int[1];
+  private int position;
+  private int limit;
+  // the second half of a surrogate pair which didn't fit in the
+  // caller's array, or -1 if there is none
+  private int pending = -1;
 
   public InputStreamReader(InputStream in) {
     this.in = in;
@@ -36,53 +43,52 @@ public class InputStreamReader extends Reader {
       return 0;
     }
 
-    byte[] buffer = new byte[length + MultibytePadding];
-    int bufferLength = length;
-    int bufferOffset = 0;
+    if (pending >= 0) {
+      b[offset] = (char) pending;
+      pending = -1;
+      return 1;
+    }
+
     while (true) {
-      int c = in.read(buffer, bufferOffset, bufferLength);
-
-      if (c <= 0) {
-        if (bufferOffset > 0) {
-          // if we've reached the end of the stream while trying to
-          // read a multibyte character, we still need to return any
-          // competely-decoded characters, plus \ufffd to indicate an
-          // unknown character
-          c = 1;
-          while (bufferOffset > 0) {
-            char[] buffer16 = Utf8.decode16(buffer, 0, bufferOffset);
-
-            if (buffer16 != null) {
-              System.arraycopy(buffer16, 0, b, offset, buffer16.length);
-              
-              c = buffer16.length + 1;
-              break;
-            } else {
-              -- bufferOffset;
-            }
-          }
-
-          b[offset + c - 1] = '\ufffd';
+      if (position < limit) {
+        int c = Utf8.decode
+          (buffer, position, limit - position, b, offset, length, consumed);
+        position += consumed[0];
+
+        if (c > 0) {
+          return c;
+        } else if (limit - position >= 4) {
+          // a complete surrogate pair, but the caller only has room for
+          // one half
+          char[] pair = new char[2];
+          Utf8.decode(buffer, position, 4, pair, 0, 2, consumed);
+          position += consumed[0];
+          b[offset] = pair[0];
+          pending = pair[1];
+          return 1;
         }
-
-        return c;
       }
 
-      bufferOffset += c;
-
-      char[] buffer16 = Utf8.decode16(buffer, 0, bufferOffset);
-
-      if (buffer16 != null) {
-        bufferOffset = 0;
-
-        System.arraycopy(buffer16, 0, b, offset, buffer16.length);
-
-        return buffer16.length;
-      } else {
-        // the buffer ended in an incomplete multibyte character, so
-        // we try to read a another byte at a time until it's complete
-        bufferLength = 1;
+      // what remains begins an incomplete char, so keep it and read
+      // more after it
+      int remaining = limit - position;
+      System.arraycopy(buffer, position, buffer, 0, remaining);
+      position = 0;
+      limit = remaining;
+
+      int c = in.read(buffer, remaining, buffer.length - remaining);
+      if (c < 0) {
+        if (remaining > 0) {
+          // the stream ended in the middle of a char
+          position = limit = 0;
+          b[offset] = '\ufffd';
+          return 1;
+        } else {
+          return -1;
+        }
       }
+
+      limit += c;
     }
   }
 
@@ -29,13 +29,29 @@ public class LineNumberReader extends BufferedReader {
     line = v;
   }
   
+  public int read() throws IOException {
+    int c = super.read();
+    if (c == '\n') {
+      ++ line;
+    }
+    return c;
+  }
+
   public int read(char[] b, int offset, int length) throws IOException {
     int c = super.read(b, offset, length);
     for (int i = 0; i < c; ++i) {
-      if (b[i] == '\n') {
+      if (b[offset + i] == '\n') {
         ++ line;
       }
     }
     return c;
   }
+
+  public String readLine() throws IOException {
+    String s = super.readLine();
+    if (s != null) {
+      ++ line;
+    }
+    return s;
+  }
 }
@@ -13,14 +13,61 @@ package java.io;
 import avian.Utf8;
 
 public class OutputStreamWriter extends Writer {
+  private static final int BufferSize = 8192;
+
   private final OutputStream out;
+  private final byte[] buffer = new byte[BufferSize];
+  private final char[] pair = new char[2];
+  // the first half of a surrogate pair whose second half has yet to be
+  // written, or zero if there is none
+  private char pending;
 
   public OutputStreamWriter(OutputStream out) {
     this.out = out;
   }
+
+  private static boolean isHighSurrogate(char c) {
+    return c >= 0xd800 && c < 0xdc00;
+  }
+
+  private void writePending(char next) throws IOException {
+    pair[0] = pending;
+    pair[1] = next;
+    pending = 0;
+    out.write(buffer, 0, Utf8.encode(pair, 0, next == 0 ? 1 : 2, buffer, 0));
+  }
   
   public void write(char[] b, int offset, int length) throws IOException {
-    out.write(Utf8.encode(b, offset, length));
+    if (pending != 0 && length > 0) {
+      char next = b[offset];
+      if (next >= 0xdc00 && next < 0xe000) {
+        ++ offset;
+        -- length;
+        writePending(next);
+      } else {
+        writePending((char) 0);
+      }
+    }
+
+    // each char encodes to at most three bytes
+    int chunk = buffer.length / 3;
+    while (length > 0) {
+      int count = length < chunk ? length : chunk;
+      if (isHighSurrogate(b[offset + count - 1])) {
+        if (count == length) {
+          pending = b[offset + count - 1];
+          -- length;
+        }
+        // don't split a surrogate pair
+        -- count;
+      }
+
+      if (count > 0) {
+        out.write(buffer, 0, Utf8.encode(b, offset, count, buffer, 0));
+      }
+      offset += count;
+      length -= count;
+    }
   }
 
   public void flush() throws IOException {
@@ -28,6 +75,9 @@ public class OutputStreamWriter extends Writer {
   }
 
   public void close() throws IOException {
+    if (pending != 0) {
+      writePending((char) 0);
+    }
     out.close();
   }
 }
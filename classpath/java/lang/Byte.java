@@ -20,7 +20,17 @@ public final class Byte extends Number implements Comparable<Byte> {
   }
 
   public static Byte valueOf(byte value) {
-    return new Byte(value);
+    return Cache.values[value + 128];
+  }
+
+  private static class Cache {
+    static final Byte[] values = new Byte[256];
+
+    static {
+      for (int i = 0; i < values.length; ++i) {
+        values[i] = new Byte((byte) (i - 128));
+      }
+    }
   }
 
   public boolean equals(Object o) {
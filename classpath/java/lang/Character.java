@@ -23,9 +23,22 @@ public final class Character implements Comparable<Character> {
   }
 
   public static Character valueOf(char value) {
+    if (value <= 127) {
+      return Cache.values[value];
+    }
     return new Character(value);
   }
 
+  private static class Cache {
+    static final Character[] values = new Character[128];
+
+    static {
+      for (int i = 0; i < values.length; ++i) {
+        values[i] = new Character((char) i);
+      }
+    }
+  }
+
   public int compareTo(Character o) {
     return value - o.value;
   }
@@ -508,9 +508,10 @@ public final class Class <T> implements Type, AnnotatedElement {
 
   public <T extends Annotation> T getAnnotation(Class<T> class_) {
     for (VMClass c = vmClass; c != null; c = c.super_) {
-      if (c.addendum != null && c.addendum.annotationTable != null) {
-        Classes.link(c, c.loader);
+      // linking reads the annotations of a class loaded lazily
+      Classes.link(c, c.loader);
 
+      if (c.addendum != null && c.addendum.annotationTable != null) {
         Object[] table = (Object[]) c.addendum.annotationTable;
         for (int i = 0; i < table.length; ++i) {
           Object[] a = (Object[]) table[i];
@@ -524,9 +525,11 @@ public final class Class <T> implements Type, AnnotatedElement {
   }
 
   public Annotation[] getDeclaredAnnotations() {
-    if (vmClass.addendum.annotationTable != null) {
-      Classes.link(vmClass);
+    Classes.link(vmClass);
 
+    if (vmClass.addendum != null
+        && vmClass.addendum.annotationTable != null)
+    {
       Object[] table = (Object[]) vmClass.addendum.annotationTable;
       Annotation[] array = new Annotation[table.length];
       for (int i = 0; i < table.length; ++i) {
@@ -541,6 +544,8 @@ public final class Class <T> implements Type, AnnotatedElement {
   private int countAnnotations() {
     int count = 0;
     for (VMClass c = vmClass; c != null; c = c.super_) {
+      Classes.link(c, c.loader);
+
       if (c.addendum != null && c.addendum.annotationTable != null) {
         count += ((Object[]) c.addendum.annotationTable).length;
       }
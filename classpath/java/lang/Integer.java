@@ -27,9 +27,24 @@ public final class Integer extends Number implements Comparable<Integer> {
   }
 
   public static Integer valueOf(int value) {
+    if (value >= -128 && value <= 127) {
+      return Cache.values[value + 128];
+    }
     return new Integer(value);
   }
 
+  // small values are boxed so often (e.g. by autoboxing) that sharing
+  // one instance of each saves a great deal of allocation
+  private static class Cache {
+    static final Integer[] values = new Integer[256];
+
+    static {
+      for (int i = 0; i < values.length; ++i) {
+        values[i] = new Integer(i - 128);
+      }
+    }
+  }
+
   public static Integer valueOf(String value) {
     return valueOf(parseInt(value));
   }
@@ -107,6 +122,30 @@ public final class Integer extends Number implements Comparable<Integer> {
     return ((v + (v >> 4) & 0xF0F0F0F) * 0x1010101) >> 24;
   }
 
+  public static int numberOfLeadingZeros(int v) {
+    if (v == 0) return 32;
+    int n = 0;
+    if ((v >>> 16) == 0) { n += 16; v <<= 16; }
+    if ((v >>> 24) == 0) { n +=  8; v <<=  8; }
+    if ((v >>> 28) == 0) { n +=  4; v <<=  4; }
+    if ((v >>> 30) == 0) { n +=  2; v <<=  2; }
+    if ((v >>> 31) == 0) { n +=  1; }
+    return n;
+  }
+
+  public static int numberOfTrailingZeros(int v) {
+    if (v == 0) return 32;
+    return 31 - numberOfLeadingZeros(v & -v);
+  }
+
+  public static int rotateLeft(int v, int distance) {
+    return (v << distance) | (v >>> -distance);
+  }
+
+  public static int rotateRight(int v, int distance) {
+    return (v >>> distance) | (v << -distance);
+  }
+
   public static int reverseBytes(int v) {
     int byte3 =  v >>> 24;
     int byte2 = (v >>> 8) & 0xFF00;
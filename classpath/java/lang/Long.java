@@ -31,9 +31,22 @@ public final class Long extends Number implements Comparable<Long> {
   }
 
   public static Long valueOf(long value) {
+    if (value >= -128 && value <= 127) {
+      return Cache.values[(int) value + 128];
+    }
     return new Long(value);
   }
 
+  private static class Cache {
+    static final Long[] values = new Long[256];
+
+    static {
+      for (int i = 0; i < values.length; ++i) {
+        values[i] = new Long(i - 128);
+      }
+    }
+  }
+
   public int compareTo(Long o) {
     return value > o.value ? 1 : (value < o.value ? -1 : 0);
   }
@@ -132,6 +145,37 @@ public final class Long extends Number implements Comparable<Long> {
     else            return -1;
   }
 
+  public static int bitCount(long v) {
+    return Integer.bitCount((int) v) + Integer.bitCount((int) (v >>> 32));
+  }
+
+  public static int numberOfLeadingZeros(long v) {
+    int high = (int) (v >>> 32);
+    return high == 0
+      ? 32 + Integer.numberOfLeadingZeros((int) v)
+      : Integer.numberOfLeadingZeros(high);
+  }
+
+  public static int numberOfTrailingZeros(long v) {
+    int low = (int) v;
+    return low == 0
+      ? 32 + Integer.numberOfTrailingZeros((int) (v >>> 32))
+      : Integer.numberOfTrailingZeros(low);
+  }
+
+  public static long rotateLeft(long v, int distance) {
+    return (v << distance) | (v >>> -distance);
+  }
+
+  public static long rotateRight(long v, int distance) {
+    return (v >>> distance) | (v << -distance);
+  }
+
+  public static long reverseBytes(long v) {
+    return (((long) Integer.reverseBytes((int) v)) << 32)
+      | (((long) Integer.reverseBytes((int) (v >>> 32))) & 0xFFFFFFFFL);
+  }
+
   private static long pow(long a, long b) {
     long c = 1;
     for (int i = 0; i < b; ++i) c *= a;
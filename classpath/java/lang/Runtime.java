@@ -75,17 +75,7 @@ public class Runtime {
 
             MyProcess p = process[0];
             if (p != null) {
-              synchronized (p) {
-                try {
-                  if (p.pid != 0) {
-                    p.exitCode = Runtime.waitFor(p.pid, p.tid);
-                    p.pid = 0;
-                    p.tid = 0;
-                  }
-                } finally {
-                  p.notifyAll();
-                }
-              }
+              p.reap();
             }
           }
         };
@@ -113,11 +103,53 @@ public class Runtime {
     return process[0];
   }
 
+  // starts each of the specified commands with a single native call,
+  // which is cheaper than calling exec(String[]) for each.  If one
+  // can't be started, those before it are destroyed.
+  public Process[] exec(String[][] commands) throws IOException {
+    long[][] info = new long[commands.length][5];
+    IOException exception = null;
+    try {
+      execAll(commands, info);
+    } catch (IOException e) {
+      exception = e;
+    }
+
+    MyProcess[] processes = new MyProcess[commands.length];
+    for (int i = 0; i < commands.length && info[i][0] != 0; ++i) {
+      final MyProcess p = new MyProcess
+        (info[i][0], info[i][1], (int) info[i][2], (int) info[i][3],
+         (int) info[i][4]);
+      processes[i] = p;
+
+      Thread t = new Thread() {
+          public void run() {
+            p.reap();
+          }
+        };
+      t.setDaemon(true);
+      t.start();
+
+      if (exception != null) {
+        p.destroy();
+      }
+    }
+
+    if (exception != null) {
+      throw exception;
+    }
+
+    return processes;
+  }
+
   public native void addShutdownHook(Thread t);
 
   private static native void exec(String[] command, long[] process)
     throws IOException;
 
+  private static native void execAll(String[][] commands, long[][] processes)
+    throws IOException;
+
   private static native int waitFor(long pid, long tid);
 
   private static native void load(String name, boolean mapName);
@@ -132,6 +164,8 @@ public class Runtime {
 
   public native long totalMemory();
 
+  public native int availableProcessors();
+
   private static class MyProcess extends Process {
     private long pid;
     private long tid;
@@ -174,6 +208,19 @@ public class Runtime {
       return exitCode;
     }
 
+    // waits for the process to exit and records how it did so
+    synchronized void reap() {
+      try {
+        if (pid != 0) {
+          exitCode = Runtime.waitFor(pid, tid);
+          pid = 0;
+          tid = 0;
+        }
+      } finally {
+        notifyAll();
+      }
+    }
+
     public synchronized int waitFor() throws InterruptedException {
       while (pid != 0) {
         wait();
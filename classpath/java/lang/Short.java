@@ -21,9 +21,22 @@ public final class Short extends Number implements Comparable<Short> {
   }
 
   public static Short valueOf(short value) {
+    if (value >= -128 && value <= 127) {
+      return Cache.values[value + 128];
+    }
     return new Short(value);
   }
 
+  private static class Cache {
+    static final Short[] values = new Short[256];
+
+    static {
+      for (int i = 0; i < values.length; ++i) {
+        values[i] = new Short((short) (i - 128));
+      }
+    }
+  }
+
   public int compareTo(Short o) {
     return value - o.value;
   }
@@ -48,6 +61,10 @@ public final class Short extends Number implements Comparable<Short> {
     return toString(v, 10);
   }
 
+  public static short reverseBytes(short v) {
+    return (short) (((v & 0xFF) << 8) | ((v >> 8) & 0xFF));
+  }
+
   public byte byteValue() {
     return (byte) value;
   }
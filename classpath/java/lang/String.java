@@ -33,6 +33,9 @@ public final class String
     }
   };
 
+  // either a byte[] holding only ASCII characters or a char[]; strings
+  // built by copying characters, and those made by the VM, use the
+  // byte[] form whenever every character fits
   private final Object data;
   private final int offset;
   private final int length;
@@ -122,8 +125,7 @@ public final class String
     if (copy) {
       Object c;
       if (data instanceof char[]) {
-        c = new char[length];
-        System.arraycopy(data, offset, c, 0, length);
+        c = compact((char[]) data, offset, length);
       } else {
         c = Utf8.decode((byte[])data, offset, length);
         if(c instanceof char[]) length = ((char[])c).length;
@@ -144,6 +146,22 @@ public final class String
     }
   }
 
+  private static Object compact(char[] data, int offset, int length) {
+    for (int i = 0; i < length; ++i) {
+      if (data[offset + i] >= 0x80) {
+        char[] c = new char[length];
+        System.arraycopy(data, offset, c, 0, length);
+        return c;
+      }
+    }
+
+    byte[] b = new byte[length];
+    for (int i = 0; i < length; ++i) {
+      b[i] = (byte) data[offset + i];
+    }
+    return b;
+  }
+
   public String toString() {
     return this;
   }
@@ -154,19 +172,94 @@ public final class String
 
   public int hashCode() {
     if (hashCode == 0) {
-      int h = 0;
-      for (int i = 0; i < length; ++i) h = (h * 31) + charAt(i);
-      hashCode = h;
+      if (data instanceof char[]) {
+        hashCode = hash((char[]) data, offset, length);
+      } else {
+        hashCode = hash((byte[]) data, offset, length);
+      }
     }
     return hashCode;
   }
 
+  // These hash four chars per iteration, adding a * 31^3 + b * 31^2 +
+  // c * 31 + d to h * 31^4, which gives the same result as hashing
+  // one at a time but lets the multiplications proceed in parallel.
+
+  private static int hash(char[] a, int offset, int length) {
+    int h = 0;
+    int i = offset;
+    int end = offset + length;
+    for (; i + 4 <= end; i += 4) {
+      h = (h * 923521) + (a[i] * 29791) + (a[i + 1] * 961)
+        + (a[i + 2] * 31) + a[i + 3];
+    }
+    for (; i < end; ++i) {
+      h = (h * 31) + a[i];
+    }
+    return h;
+  }
+
+  private static int hash(byte[] a, int offset, int length) {
+    int h = 0;
+    int i = offset;
+    int end = offset + length;
+    for (; i + 4 <= end; i += 4) {
+      h = (h * 923521) + (a[i] * 29791) + (a[i + 1] * 961)
+        + (a[i + 2] * 31) + a[i + 3];
+    }
+    for (; i < end; ++i) {
+      h = (h * 31) + a[i];
+    }
+    return h;
+  }
+
+  // returns the difference between the first pair of chars which
+  // differ in the ranges of a and b, or zero if none do, choosing a loop
+  // for the representations of a and b once instead of for every char
+  private static int compare(Object a, int ai, Object b, int bi, int count) {
+    if (a instanceof byte[]) {
+      byte[] x = (byte[]) a;
+      if (b instanceof byte[]) {
+        byte[] y = (byte[]) b;
+        for (int i = 0; i < count; ++i) {
+          int d = x[ai + i] - y[bi + i];
+          if (d != 0) return d;
+        }
+      } else {
+        char[] y = (char[]) b;
+        for (int i = 0; i < count; ++i) {
+          int d = x[ai + i] - y[bi + i];
+          if (d != 0) return d;
+        }
+      }
+    } else {
+      char[] x = (char[]) a;
+      if (b instanceof byte[]) {
+        byte[] y = (byte[]) b;
+        for (int i = 0; i < count; ++i) {
+          int d = x[ai + i] - y[bi + i];
+          if (d != 0) return d;
+        }
+      } else {
+        char[] y = (char[]) b;
+        for (int i = 0; i < count; ++i) {
+          int d = x[ai + i] - y[bi + i];
+          if (d != 0) return d;
+        }
+      }
+    }
+    return 0;
+  }
+
   public boolean equals(Object o) {
     if (this == o) {
       return true;
     } else if (o instanceof String) {
       String s = (String) o;
-      return s.length == length && compareTo(s) == 0;
+      // strings whose hash codes are known and differ can't be equal
+      return s.length == length
+        && (hashCode == 0 || s.hashCode == 0 || hashCode == s.hashCode)
+        && compare(data, offset, s.data, s.offset, length) == 0;
     } else {
       return false;
     }
@@ -186,18 +279,9 @@ public final class String
   public int compareTo(String s) {
     if (this == s) return 0;
 
-    int idx = 0;
-    int result;
-
-    int end = (length < s.length ? length : s.length);
-
-    while (idx < end) {
-      if ((result = charAt(idx) - s.charAt(idx)) != 0) {
-        return result;
-      }
-      idx++;
-    }
-    return length - s.length;
+    int result = compare
+      (data, offset, s.data, s.offset, (length < s.length ? length : s.length));
+    return result != 0 ? result : length - s.length;
   }
 
   public int compareToIgnoreCase(String s) {
@@ -382,27 +466,15 @@ public final class String
   }
 
   public boolean startsWith(String s) {
-    if (length >= s.length) {
-      return substring(0, s.length).compareTo(s) == 0;
-    } else {
-      return false;
-    }
+    return regionMatches(0, s, 0, s.length);
   }
 
   public boolean startsWith(String s, int start) {
-    if (length >= s.length + start) {
-      return substring(start, s.length).compareTo(s) == 0;
-    } else {
-      return false;
-    }
+    return regionMatches(start, s, 0, s.length);
   }
   
   public boolean endsWith(String s) {
-    if (length >= s.length) {
-      return substring(length - s.length).compareTo(s) == 0;
-    } else {
-      return false;
-    }
+    return regionMatches(length - s.length, s, 0, s.length);
   }
 
   public String concat(String s) {
@@ -620,13 +692,20 @@ public final class String
   public boolean regionMatches(boolean ignoreCase, int thisOffset,
                                String match, int matchOffset, int length)
   {
+    if (thisOffset < 0 || matchOffset < 0
+        || thisOffset > this.length - length
+        || matchOffset > match.length - length)
+    {
+      return false;
+    } else if (! ignoreCase) {
+      return compare
+        (data, offset + thisOffset, match.data, match.offset + matchOffset,
+         length) == 0;
+    }
+
     String a = substring(thisOffset, thisOffset + length);
     String b = match.substring(matchOffset, matchOffset + length);
-    if (ignoreCase) {
-      return a.equalsIgnoreCase(b);
-    } else {
-      return a.equals(b);
-    }
+    return a.equalsIgnoreCase(b);
   }
 
   public boolean isEmpty() {
@@ -22,7 +22,7 @@ public class StringBuffer implements CharSequence {
   }
 
   public StringBuffer() {
-    this(0);
+    sb = new StringBuilder();
   }
 
   public synchronized StringBuffer append(String s) {
@@ -11,28 +11,42 @@
 package java.lang;
 
 public class StringBuilder implements CharSequence, Appendable {
-  private static final int BufferSize = 32;
+  private static final int DefaultCapacity = 16;
 
-  private Cell chain;
-  private int length;
   private char[] buffer;
-  private int position;
+  private int length;
+  // true if the buffer is shared with a string returned by toString,
+  // in which case it must be copied before it is modified
+  private boolean shared;
 
   public StringBuilder(String s) {
+    this(s.length() + DefaultCapacity);
     append(s);
   }
 
-  public StringBuilder(int capacity) { }
+  public StringBuilder(int capacity) {
+    buffer = new char[capacity];
+  }
 
   public StringBuilder() {
-    this(0);
+    this(DefaultCapacity);
   }
 
-  private void flush() {
-    if (position > 0) {
-      chain = new Cell(new String(buffer, 0, position, false), chain);
-      buffer = null;
-      position = 0;
+  // makes room for count more chars, copying the buffer if it is full
+  // or shared
+  private void reserve(int count) {
+    int capacity = length + count;
+    if (shared || capacity > buffer.length) {
+      if (capacity > buffer.length) {
+        capacity = Math.max(capacity, (buffer.length * 2) + 2);
+      } else {
+        capacity = buffer.length;
+      }
+
+      char[] b = new char[capacity];
+      System.arraycopy(buffer, 0, b, 0, length);
+      buffer = b;
+      shared = false;
     }
   }
 
@@ -40,15 +54,11 @@ public class StringBuilder implements CharSequence, Appendable {
     if (s == null) {
       return append("null");
     } else {
-      if (s.length() > 0) {
-        if (buffer != null && s.length() <= buffer.length - position) {
-          s.getChars(0, s.length(), buffer, position);
-          position += s.length();
-        } else {
-          flush();
-          chain = new Cell(s, chain);
-        }
-        length += s.length();
+      int l = s.length();
+      if (l > 0) {
+        reserve(l);
+        s.getChars(0, l, buffer, length);
+        length += l;
       }
       return this;
     }
@@ -59,15 +69,47 @@ public class StringBuilder implements CharSequence, Appendable {
   }
 
   public StringBuilder append(CharSequence sequence) {
-    return append(sequence.toString());
+    if (sequence instanceof String) {
+      return append((String) sequence);
+    } else if (sequence instanceof StringBuilder) {
+      StringBuilder sb = (StringBuilder) sequence;
+      int l = sb.length;
+      reserve(l);
+      System.arraycopy(sb.buffer, 0, buffer, length, l);
+      length += l;
+      return this;
+    } else if (sequence == null) {
+      return append("null");
+    } else {
+      return append(sequence, 0, sequence.length());
+    }
   }
 
   public Appendable append(CharSequence sequence, int start, int end) {
-    return append(sequence.subSequence(start, end));
+    if (sequence == null) {
+      sequence = "null";
+    }
+
+    if (start < 0 || start > end || end > sequence.length()) {
+      throw new IndexOutOfBoundsException();
+    }
+
+    reserve(end - start);
+    for (int i = start; i < end; ++i) {
+      buffer[length++] = sequence.charAt(i);
+    }
+    return this;
   }
 
   public StringBuilder append(char[] b, int offset, int length) {
-    return append(new String(b, offset, length));
+    if (offset < 0 || length < 0 || offset + length > b.length) {
+      throw new IndexOutOfBoundsException();
+    }
+
+    reserve(length);
+    System.arraycopy(b, offset, buffer, this.length, length);
+    this.length += length;
+    return this;
   }
 
   public StringBuilder append(Object o) {
@@ -75,29 +117,65 @@ public class StringBuilder implements CharSequence, Appendable {
   }
 
   public StringBuilder append(char v) {
-    if (buffer == null) {
-      buffer = new char[BufferSize];
-    } else if (position >= buffer.length) {
-      flush();
-      buffer = new char[BufferSize];
-    }
-
-    buffer[position++] = v;
-    ++ length;
-
+    reserve(1);
+    buffer[length++] = v;
     return this;
   }
 
   public StringBuilder append(boolean v) {
-    return append(String.valueOf(v));
+    return append(v ? "true" : "false");
   }
 
+  // the digits are written from the end, working with the negated
+  // value so that the most negative value needs no special case
+
   public StringBuilder append(int v) {
-    return append(String.valueOf(v));
+    int n = v < 0 ? v : -v;
+    int size = v < 0 ? 2 : 1;
+    for (int m = n / 10; m != 0; m /= 10) {
+      ++ size;
+    }
+
+    reserve(size);
+    int i = length + size;
+    do {
+      buffer[--i] = (char) ('0' - (n % 10));
+      n /= 10;
+    } while (n != 0);
+
+    if (v < 0) {
+      buffer[--i] = '-';
+    }
+
+    length += size;
+    return this;
   }
 
   public StringBuilder append(long v) {
-    return append(String.valueOf(v));
+    if (v == (int) v) {
+      // cheaper on 32-bit systems, where long division is a call
+      return append((int) v);
+    }
+
+    long n = v < 0 ? v : -v;
+    int size = v < 0 ? 2 : 1;
+    for (long m = n / 10; m != 0; m /= 10) {
+      ++ size;
+    }
+
+    reserve(size);
+    int i = length + size;
+    do {
+      buffer[--i] = (char) ('0' - (n % 10));
+      n /= 10;
+    } while (n != 0);
+
+    if (v < 0) {
+      buffer[--i] = '-';
+    }
+
+    length += size;
+    return this;
   }
 
   public StringBuilder append(float v) {
@@ -113,19 +191,7 @@ public class StringBuilder implements CharSequence, Appendable {
       throw new IndexOutOfBoundsException();
     }
 
-    flush();
-
-    int index = length;
-    for (Cell c = chain; c != null; c = c.next) {
-      int start = index - c.value.length();
-      index = start;
-      
-      if (i >= start) {
-        return c.value.charAt(i - start);
-      }
-    }
-
-    throw new RuntimeException();
+    return buffer[i];
   }
 
   public StringBuilder insert(int i, String s) {
@@ -133,31 +199,16 @@ public class StringBuilder implements CharSequence, Appendable {
       throw new IndexOutOfBoundsException();
     }
 
-    if (i == length) {
-      append(s);
-    } else {
-      flush();
-
-      int index = length;
-      for (Cell c = chain; c != null; c = c.next) {
-        int start = index - c.value.length();
-        index = start;
-      
-        if (i >= start) {
-          if (i == start) {
-            c.next = new Cell(s, c.next);
-          } else {
-            String v = c.value;
-            c.value = v.substring(i - start, v.length());
-            c.next = new Cell(s, new Cell(v.substring(0, i - start), c.next));
-          }
-          break;
-        }
-      }
-
-      length += s.length();
+    if (s == null) {
+      s = "null";
     }
 
+    int l = s.length();
+    reserve(l);
+    System.arraycopy(buffer, i, buffer, i + l, length - i);
+    s.getChars(0, l, buffer, i);
+    length += l;
+
     return this;
   }
 
@@ -166,7 +217,16 @@ public class StringBuilder implements CharSequence, Appendable {
   }
 
   public StringBuilder insert(int i, char c) {
-    return insert(i, new String(new char[] { c }, 0, 1, false));
+    if (i < 0 || i > length) {
+      throw new IndexOutOfBoundsException();
+    }
+
+    reserve(1);
+    System.arraycopy(buffer, i, buffer, i + 1, length - i);
+    buffer[i] = c;
+    ++ length;
+
+    return this;
   }
 
   public StringBuilder insert(int i, int v) {
@@ -182,38 +242,8 @@ public class StringBuilder implements CharSequence, Appendable {
       throw new IndexOutOfBoundsException();
     }
 
-    flush();
-
-    int index = length;
-    Cell p = null;
-    for (Cell c = chain; c != null; c = c.next) {
-      int e = index;
-      int s = index - c.value.length();
-      index = s;
-      
-      if (end >= e) {
-        if (start <= s) {
-          if (p == null) {
-            chain = c.next;
-          } else {
-            p.next = c.next;
-          }          
-        } else {
-          c.value = c.value.substring(0, start - s);
-          break;
-        }
-      } else {
-        if (start <= s) {
-          c.value = c.value.substring(end - s, e - s);
-        } else {
-          String v = c.value;
-          c.value = v.substring(end - s, e - s);
-          c.next = new Cell(v.substring(0, start - s), c.next);
-          break;
-        }        
-      }
-    }
-
+    reserve(0);
+    System.arraycopy(buffer, end, buffer, start, length - end);
     length -= (end - start);
 
     return this;
@@ -240,7 +270,7 @@ public class StringBuilder implements CharSequence, Appendable {
     for (int i = start; i < length - slength + 1; ++i) {
       int j = 0;
       for (; j < slength; ++j) {
-        if (charAt(i + j) != s.charAt(j)) {
+        if (buffer[i + j] != s.charAt(j)) {
           break;
         }
       }
@@ -263,7 +293,7 @@ public class StringBuilder implements CharSequence, Appendable {
     for (int i = Math.min(length - slength, lastIndex); i >= 0; --i) {
       int j = 0;
       for (; j < slength && i + j < length; ++j) {
-        if (charAt(i + j) != s.charAt(j)) {
+        if (buffer[i + j] != s.charAt(j)) {
           break;
         }
       }
@@ -284,29 +314,14 @@ public class StringBuilder implements CharSequence, Appendable {
       throw new IndexOutOfBoundsException();
     }
 
-    if (v == 0) {
-      length = 0;
-      chain = null;
-      return;
+    if (v > length) {
+      reserve(v - length);
+      for (int i = length; i < v; ++i) {
+        buffer[i] = 0;
+      }
     }
 
-    flush();
-
-    int index = length;
     length = v;
-    for (Cell c = chain; c != null; c = c.next) {
-      int start = index - c.value.length();
-
-      if (v > start) {
-        if (v < index) {
-          c.value = c.value.substring(0, v - start);
-        }
-        break;
-      }
-
-      chain = c.next;
-      index = start;
-    }
   }
 
   public void getChars(int srcStart, int srcEnd, char[] dst, int dstStart) {
@@ -314,42 +329,19 @@ public class StringBuilder implements CharSequence, Appendable {
       throw new IndexOutOfBoundsException();
     }
 
-    flush();
-
-    int index = length;
-    for (Cell c = chain; c != null; c = c.next) {
-      int start = index - c.value.length();
-      int end = index;
-      index = start;
-
-      if (start < srcStart) {
-        start = srcStart;
-      }
-
-      if (end > srcEnd) {
-        end = srcEnd;
-      }
-
-      if (start < end) {
-        c.value.getChars(start - index, end - index,
-                         dst, dstStart + (start - srcStart));
-      }
-    }
+    System.arraycopy(buffer, srcStart, dst, dstStart, srcEnd - srcStart);
   }
 
   public String toString() {
-    char[] array = new char[length];
-    getChars(0, length, array, 0);
-    return new String(array, 0, length, false);
-  }
-
-  private static class Cell {
-    public String value;
-    public Cell next;
-
-    public Cell(String value, Cell next) {
-      this.value = value;
-      this.next = next;
+    if (length == 0) {
+      return "";
+    } else if (buffer.length - length <= length / 2) {
+      // the buffer is mostly full, so rather than copying it, share it
+      // with the string until this builder is next modified
+      shared = true;
+      return new String(buffer, 0, length, false);
+    } else {
+      return new String(buffer, 0, length);
     }
   }
 
@@ -358,10 +350,11 @@ public class StringBuilder implements CharSequence, Appendable {
   }
 
   public String substring(int start, int end) {
-    int len = end-start;
-    char[] buf = new char[len]; 
-    getChars(start, end, buf, 0);
-    return new String(buf, 0, len, false);
+    if (start < 0 || start > end || end > length) {
+      throw new IndexOutOfBoundsException();
+    }
+
+    return new String(buffer, start, end - start);
   }
         
   public CharSequence subSequence(int start, int end) {
@@ -370,11 +363,17 @@ public class StringBuilder implements CharSequence, Appendable {
 
   public void setCharAt(int index, char ch) {
     if(index < 0 || index >= length) throw new IndexOutOfBoundsException();
-    deleteCharAt(index);
-    insert(index, ch);
+    reserve(0);
+    buffer[index] = ch;
+  }
+
+  public int capacity() {
+    return buffer.length;
   }
 
   public void ensureCapacity(int capacity) {
-    // ignore
+    if (capacity > buffer.length) {
+      reserve(capacity - length);
+    }
   }
 }
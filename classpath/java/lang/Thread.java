@@ -27,6 +27,7 @@ public class Thread implements Runnable {
   private UncaughtExceptionHandler exceptionHandler;
   private String name;
   private ThreadGroup group;
+  private final long stackSize;
 
   private static UncaughtExceptionHandler defaultExceptionHandler;
 
@@ -39,6 +40,7 @@ public class Thread implements Runnable {
     this.group = (group == null ? Thread.currentThread().group : group);
     this.task = task;
     this.name = name;
+    this.stackSize = stackSize;
 
     Thread current = currentThread();
 
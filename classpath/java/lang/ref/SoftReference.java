@@ -11,11 +11,28 @@
 package java.lang.ref;
 
 public class SoftReference<T> extends Reference<T> {
+  // the time, in milliseconds, the last collection ended, set by the
+  // VM after each
+  private static long clock;
+
+  // the clock when this was last read, by which the VM decides, once
+  // memory runs low, which soft references to clear first
+  private long timestamp;
+
   public SoftReference(T target, ReferenceQueue<? super T> queue) {
-    super(target, queue);    
+    super(target, queue);
+    timestamp = clock;
   }
 
   public SoftReference(T target) {
     this(target, null);
   }
+
+  public T get() {
+    T target = super.get();
+    if (timestamp != clock) {
+      timestamp = clock;
+    }
+    return target;
+  }
 }
@@ -11,6 +11,8 @@
 package java.lang.reflect;
 
 import avian.VMField;
+import avian.FieldAccessor;
+import avian.Accessors;
 import avian.AnnotationInvocationHandler;
 import avian.SystemClassLoader;
 import avian.Classes;
@@ -29,8 +31,14 @@ public class Field<T> extends AccessibleObject {
   private static final int BooleanField = 8;
   private static final int ObjectField = 9;
 
+  // the number of accesses to make through the VM before generating an
+  // accessor class to make them directly
+  private static final int AccessorThreshold = 16;
+
   private final VMField vmField;
   private boolean accessible = true;
+  private int accesses;
+  private FieldAccessor accessor;
 
   public Field(VMField vmField) {
     this.vmField = vmField;
@@ -66,6 +74,14 @@ public class Field<T> extends AccessibleObject {
        new String(vmField.spec, 0, vmField.spec.length - 1, false));
   }
 
+  private FieldAccessor accessor() {
+    FieldAccessor a = accessor;
+    if (a == null && ++ accesses == AccessorThreshold) {
+      a = accessor = Accessors.makeFieldAccessor(vmField);
+    }
+    return a;
+  }
+
   public Object get(Object instance) throws IllegalAccessException {
     Object target;
     if ((vmField.flags & Modifier.STATIC) != 0) {
@@ -76,6 +92,11 @@ public class Field<T> extends AccessibleObject {
       throw new IllegalArgumentException();
     }
 
+    FieldAccessor a = accessor();
+    if (a != null) {
+      return a.get(instance);
+    }
+
     switch (vmField.code) {
     case ByteField:
       return Byte.valueOf
@@ -99,7 +120,7 @@ public class Field<T> extends AccessibleObject {
 
     case LongField:
       return Long.valueOf
-        ((int) getPrimitive(target, vmField.code, vmField.offset));
+        (getPrimitive(target, vmField.code, vmField.offset));
 
     case FloatField:
       return Float.valueOf
@@ -163,6 +184,21 @@ public class Field<T> extends AccessibleObject {
       throw new IllegalArgumentException();
     }
 
+    FieldAccessor a = accessor();
+    if (a != null) {
+      a.set(instance, value);
+    } else {
+      try {
+        setDirectly(target, value);
+      } catch (ClassCastException e) {
+        throw Accessors.illegalArgument(e);
+      } catch (NullPointerException e) {
+        throw Accessors.illegalArgument(e);
+      }
+    }
+  }
+
+  private void setDirectly(Object target, Object value) {
     switch (vmField.code) {
     case ByteField:
       setPrimitive(target, vmField.code, vmField.offset, (Byte) value);
@@ -11,6 +11,8 @@
 package java.lang.reflect;
 
 import avian.VMMethod;
+import avian.MethodAccessor;
+import avian.Accessors;
 import avian.AnnotationInvocationHandler;
 import avian.SystemClassLoader;
 import avian.Classes;
@@ -18,8 +20,14 @@ import avian.Classes;
 import java.lang.annotation.Annotation;
 
 public class Method<T> extends AccessibleObject implements Member {
+  // the number of calls to make through the VM before generating an
+  // accessor class to make them directly
+  private static final int AccessorThreshold = 16;
+
   private final VMMethod vmMethod;
   private boolean accessible;
+  private int invocations;
+  private MethodAccessor accessor;
 
   public Method(VMMethod vmMethod) {
     this.vmMethod = vmMethod;
@@ -81,7 +89,16 @@ public class Method<T> extends AccessibleObject implements Member {
       }
 
       if (arguments.length == vmMethod.parameterCount) {
-        return invoke(vmMethod, instance, arguments);        
+        MethodAccessor a = accessor;
+        if (a == null && ++ invocations == AccessorThreshold) {
+          a = accessor = Accessors.makeMethodAccessor(vmMethod);
+        }
+
+        if (a != null) {
+          return a.invoke(instance, arguments);
+        } else {
+          return invoke(vmMethod, instance, arguments);
+        }
       } else {
         throw new ArrayIndexOutOfBoundsException();
       }
@@ -23,12 +23,15 @@ import avian.ConstantPool;
 import avian.ConstantPool.PoolEntry;
 
 import avian.Assembler;
+import avian.Assembler.FieldData;
 import avian.Assembler.MethodData;
 
 import java.util.List;
 import java.util.ArrayList;
 import java.util.Map;
 import java.util.HashMap;
+import java.util.WeakHashMap;
+import java.lang.ref.WeakReference;
 import java.io.OutputStream;
 import java.io.ByteArrayOutputStream;
 import java.io.IOException;
@@ -36,8 +39,50 @@ import java.io.IOException;
 public class Proxy {
   private static int nextNumber;
 
+  // proxy classes by loader and then by the names of their interfaces.
+  // The classes are only weakly referenced since each refers to its
+  // loader, which would otherwise never be collected.
+  private static final Map<ClassLoader, Map<String, WeakReference<Class>>>
+    classes = new WeakHashMap();
+
   protected InvocationHandler h;
 
+  private static String key(Class[] interfaces) {
+    StringBuilder sb = new StringBuilder();
+    for (Class c: interfaces) {
+      sb.append(c.getName()).append(';');
+    }
+    return sb.toString();
+  }
+
+  // true if c implements exactly the specified interfaces, which may
+  // not be so if a loader sees another class with the same name as one
+  // of them
+  private static boolean implementsAll(Class c, Class[] interfaces) {
+    for (Class i: interfaces) {
+      if (! i.isAssignableFrom(c)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  private static Class find(ClassLoader loader, String key,
+                            Class[] interfaces)
+  {
+    Map<String, WeakReference<Class>> map = classes.get(loader);
+    if (map != null) {
+      WeakReference<Class> r = map.get(key);
+      if (r != null) {
+        Class c = r.get();
+        if (c != null && implementsAll(c, interfaces)) {
+          return c;
+        }
+      }
+    }
+    return null;
+  }
+
   public static Class getProxyClass(ClassLoader loader,
                                     Class ... interfaces)
   {
@@ -47,18 +92,43 @@ public class Proxy {
       }
     }
 
+    String key = key(interfaces);
+
     int number;
     synchronized (Proxy.class) {
+      Class c = find(loader, key, interfaces);
+      if (c != null) {
+        return c;
+      }
+
       number = nextNumber++;
     }
 
+    // make the class without holding the lock, since that may load and
+    // link other classes; if another thread gets there first, we use
+    // its class and let ours be collected with the loader
+    Class c;
     try {
-      return makeClass(loader, interfaces, "Proxy-" + number);
+      c = makeClass(loader, interfaces, "Proxy-" + number);
     } catch (IOException e) {
       AssertionError error = new AssertionError();
       error.initCause(e);
       throw error;      
     }
+
+    synchronized (Proxy.class) {
+      Class existing = find(loader, key, interfaces);
+      if (existing != null) {
+        return existing;
+      }
+
+      Map<String, WeakReference<Class>> map = classes.get(loader);
+      if (map == null) {
+        classes.put(loader, map = new HashMap());
+      }
+      map.put(key, new WeakReference(c));
+      return c;
+    }
   }
 
   public static boolean isProxyClass(Class c) {
@@ -70,11 +140,10 @@ public class Proxy {
   }
 
   private static byte[] makeInvokeCode(List<PoolEntry> pool,
-                                       String className,
+                                       int methodField,
                                        byte[] spec,
                                        int parameterCount,
-                                       int parameterFootprint,
-                                       int index)
+                                       int parameterFootprint)
     throws IOException
   {
     ByteArrayOutputStream out = new ByteArrayOutputStream();
@@ -89,21 +158,19 @@ public class Proxy {
             "h", "Ljava/lang/reflect/InvocationHandler;") + 1);
 
     write1(out, aload_0);
-    
-    write1(out, ldc_w);
-    write2(out, ConstantPool.addClass(pool, className) + 1);
-    write1(out, ldc_w);
-    write2(out, ConstantPool.addInteger(pool, index) + 1);
-    write1(out, invokestatic);
-    write2(out, ConstantPool.addMethodRef
-           (pool, "avian/Classes",
-            "makeMethod", "(Ljava/lang/Class;I)Ljava/lang/reflect/Method;")
-           + 1);
 
-    write1(out, ldc_w);
-    write2(out, ConstantPool.addInteger(pool, parameterCount) + 1);
-    write1(out, anewarray);
-    write2(out, ConstantPool.addClass(pool, "java/lang/Object") + 1);
+    write1(out, getstatic);
+    write2(out, methodField + 1);
+
+    // like the JDK, pass null instead of an empty array of arguments
+    if (parameterCount == 0) {
+      write1(out, aconst_null);
+    } else {
+      write1(out, ldc_w);
+      write2(out, ConstantPool.addInteger(pool, parameterCount) + 1);
+      write1(out, anewarray);
+      write2(out, ConstantPool.addClass(pool, "java/lang/Object") + 1);
+    }
 
     int ai = 0;
     int si;
@@ -340,6 +407,42 @@ public class Proxy {
     return out.toByteArray();
   }
 
+  // resolves the Method for each method of the class with a field in
+  // methodFields, storing it there
+  private static byte[] makeStaticInitializerCode(List<PoolEntry> pool,
+                                                  String className,
+                                                  int[] methodFields)
+    throws IOException
+  {
+    ByteArrayOutputStream out = new ByteArrayOutputStream();
+    write2(out, 2); // max stack
+    write2(out, 0); // max locals
+    write4(out, 0); // length (we'll set the real value later)
+
+    for (int i = 0; i < methodFields.length; ++i) {
+      write1(out, ldc_w);
+      write2(out, ConstantPool.addClass(pool, className) + 1);
+      write1(out, ldc_w);
+      write2(out, ConstantPool.addInteger(pool, i) + 1);
+      write1(out, invokestatic);
+      write2(out, ConstantPool.addMethodRef
+             (pool, "avian/Classes",
+              "makeMethod", "(Ljava/lang/Class;I)Ljava/lang/reflect/Method;")
+             + 1);
+      write1(out, putstatic);
+      write2(out, methodFields[i] + 1);
+    }
+    write1(out, return_);
+
+    write2(out, 0); // exception handler table length
+    write2(out, 0); // attribute count
+
+    byte[] result = out.toByteArray();
+    set4(result, 4, result.length - 12);
+
+    return result;
+  }
+
   private static Class makeClass(ClassLoader loader,
                                  Class[] interfaces,
                                  String name)
@@ -364,15 +467,28 @@ public class Proxy {
       }
     }
 
-    MethodData[] methodTable = new MethodData[virtualMap.size() + 1];
+    // each method i is at slot i of the method table, and its Method is
+    // kept in static field "m<i>" so it need only be made once
+    FieldData[] fieldTable = new FieldData[virtualMap.size()];
+    int[] methodFields = new int[fieldTable.length];
+    MethodData[] methodTable = new MethodData[virtualMap.size() + 2];
     { int i = 0;
       for (avian.VMMethod m: virtualMap.values()) {
+        String fieldName = "m" + i;
+        String fieldSpec = "Ljava/lang/reflect/Method;";
+        fieldTable[i] = new FieldData
+          (ACC_PRIVATE | ACC_STATIC,
+           ConstantPool.addUtf8(pool, fieldName),
+           ConstantPool.addUtf8(pool, fieldSpec));
+        methodFields[i] = ConstantPool.addFieldRef
+          (pool, name, fieldName, fieldSpec);
+
         methodTable[i] = new MethodData
           (0,
            ConstantPool.addUtf8(pool, Classes.toString(m.name)),
            ConstantPool.addUtf8(pool, Classes.toString(m.spec)),
-           makeInvokeCode(pool, name, m.spec, m.parameterCount,
-                          m.parameterFootprint, i));
+           makeInvokeCode(pool, methodFields[i], m.spec, m.parameterCount,
+                          m.parameterFootprint));
         ++ i;
       }
       
@@ -382,6 +498,12 @@ public class Proxy {
          ConstantPool.addUtf8
          (pool, "(Ljava/lang/reflect/InvocationHandler;)V"),
          makeConstructorCode(pool));
+
+      methodTable[i++] = new MethodData
+        (ACC_STATIC,
+         ConstantPool.addUtf8(pool, "<clinit>"),
+         ConstantPool.addUtf8(pool, "()V"),
+         makeStaticInitializerCode(pool, name, methodFields));
     }
 
     int nameIndex = ConstantPool.addClass(pool, name);
@@ -389,7 +511,8 @@ public class Proxy {
 
     ByteArrayOutputStream out = new ByteArrayOutputStream();
     Assembler.writeClass
-      (out, pool, nameIndex, superIndex, interfaceIndexes, methodTable);
+      (out, pool, nameIndex, superIndex, interfaceIndexes, fieldTable,
+       methodTable);
 
     byte[] classData = out.toByteArray();
     return avian.SystemClassLoader.getClass
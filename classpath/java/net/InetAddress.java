@@ -11,6 +11,9 @@
 package java.net;
 
 import java.io.IOException;
+import java.util.concurrent.Callable;
+import java.util.concurrent.Future;
+import java.util.concurrent.FutureTask;
 
 public class InetAddress {
   private final String address;
@@ -34,7 +37,7 @@ public class InetAddress {
       throw uhe;
     }
 
-    int address = ipv4AddressForName(name);
+    int address = Resolver.resolve(name);
     if (address == 0) {
       throw new UnknownHostException(name);
     } else {
@@ -42,6 +45,24 @@ public class InetAddress {
     }
   }
 
+  // looks up the specified name on a resolver thread unless the answer
+  // is already known, in which case the result is complete on return
+  public static Future<InetAddress> getByNameAsync(final String name) {
+    FutureTask<InetAddress> task = new FutureTask<InetAddress>
+      (new Callable<InetAddress>() {
+        public InetAddress call() throws UnknownHostException {
+          return getByName(name);
+        }
+      });
+
+    if (Resolver.cached(name)) {
+      task.run();
+    } else {
+      Resolver.pool().execute(task);
+    }
+    return task;
+  }
+
   private static String ipv4AddressToString(int address) {
     return (((address >>> 24)       ) + "." +
             ((address >>> 16) & 0xFF) + "." +
@@ -49,5 +70,5 @@ public class InetAddress {
             ((address       ) & 0xFF));
   }
 
-  private static native int ipv4AddressForName(String name);
+  static native int ipv4AddressForName(String name);
 }
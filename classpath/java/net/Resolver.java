@@ -0,0 +1,208 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.net;
+
+import java.util.HashMap;
+import java.util.Iterator;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.LinkedBlockingQueue;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.ThreadPoolExecutor;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Resolves host names to IPv4 addresses, remembering each answer for
+ * sun.net.inetaddr.ttl seconds (30 by default) and each failure for
+ * sun.net.inetaddr.negative.ttl seconds (10 by default), where a
+ * negative time means forever.  Threads which ask for a name while
+ * it is being looked up wait for that lookup rather than starting
+ * another.
+ */
+class Resolver {
+  private static final long TTL = ttl("sun.net.inetaddr.ttl", 30);
+  private static final long NegativeTTL = ttl
+    ("sun.net.inetaddr.negative.ttl", 10);
+
+  private static final int MaxEntries = 1024;
+  private static final int PoolSize = 4;
+
+  private static final HashMap<String, Entry> cache
+    = new HashMap<String, Entry>();
+
+  private static ExecutorService pool;
+
+  private static long ttl(String property, long seconds) {
+    String value = System.getProperty(property);
+    if (value != null) {
+      try {
+        seconds = Long.parseLong(value);
+      } catch (NumberFormatException e) {
+        // use the default
+      }
+    }
+    return seconds < 0 ? -1 : TimeUnit.SECONDS.toNanos(seconds);
+  }
+
+  // the address of the specified name, or zero if it can't be found
+  public static int resolve(String name) {
+    int literal = parseIpv4(name);
+    if (literal != 0) {
+      return literal;
+    }
+
+    Entry entry;
+    boolean query = false;
+    synchronized (cache) {
+      entry = cache.get(name);
+      if (entry != null && entry.expired(System.nanoTime())) {
+        entry = null;
+      }
+
+      if (entry == null) {
+        if (cache.size() >= MaxEntries) {
+          prune();
+        }
+        entry = new Entry();
+        cache.put(name, entry);
+        query = true;
+      }
+    }
+
+    if (query) {
+      int address = 0;
+      try {
+        address = InetAddress.ipv4AddressForName(name);
+      } finally {
+        synchronized (cache) {
+          entry.address = address;
+          entry.done = true;
+          long ttl = address == 0 ? NegativeTTL : TTL;
+          entry.forever = ttl < 0;
+          entry.expires = System.nanoTime() + ttl;
+          cache.notifyAll();
+        }
+      }
+    } else {
+      boolean interrupted = false;
+      synchronized (cache) {
+        while (! entry.done) {
+          try {
+            cache.wait();
+          } catch (InterruptedException e) {
+            interrupted = true;
+          }
+        }
+      }
+      if (interrupted) {
+        Thread.currentThread().interrupt();
+      }
+    }
+
+    return entry.address;
+  }
+
+  // true if a resolve of the specified name would not wait for a
+  // lookup
+  public static boolean cached(String name) {
+    if (parseIpv4(name) != 0) {
+      return true;
+    }
+
+    synchronized (cache) {
+      Entry entry = cache.get(name);
+      return entry != null && entry.done
+        && ! entry.expired(System.nanoTime());
+    }
+  }
+
+  // a pool of daemon threads for asynchronous lookups, which exit when
+  // idle
+  public static synchronized ExecutorService pool() {
+    if (pool == null) {
+      ThreadPoolExecutor executor = new ThreadPoolExecutor
+        (PoolSize, PoolSize, 30, TimeUnit.SECONDS,
+         new LinkedBlockingQueue<Runnable>(), new ThreadFactory() {
+           public Thread newThread(Runnable task) {
+             Thread t = new Thread(task, "resolver");
+             t.setDaemon(true);
+             return t;
+           }
+         });
+      executor.allowCoreThreadTimeOut(true);
+      pool = executor;
+    }
+    return pool;
+  }
+
+  // removes expired entries, or if there are none, every entry which
+  // isn't being looked up
+  private static void prune() {
+    long now = System.nanoTime();
+    boolean removed = false;
+    for (Iterator<Entry> it = cache.values().iterator(); it.hasNext();) {
+      if (it.next().expired(now)) {
+        it.remove();
+        removed = true;
+      }
+    }
+
+    if (! removed) {
+      for (Iterator<Entry> it = cache.values().iterator(); it.hasNext();) {
+        if (it.next().done) {
+          it.remove();
+        }
+      }
+    }
+  }
+
+  // the address written in dotted decimal notation by the specified
+  // string, or zero if it is not such an address
+  private static int parseIpv4(String s) {
+    int address = 0;
+    int part = 0;
+    int digits = 0;
+    int parts = 0;
+    for (int i = 0; i < s.length(); ++i) {
+      char c = s.charAt(i);
+      if (c >= '0' && c <= '9') {
+        part = (part * 10) + (c - '0');
+        if (++ digits > 3 || part > 255) {
+          return 0;
+        }
+      } else if (c == '.' && digits > 0 && parts < 3) {
+        address = (address << 8) | part;
+        part = 0;
+        digits = 0;
+        ++ parts;
+      } else {
+        return 0;
+      }
+    }
+
+    if (digits == 0 || parts != 3) {
+      return 0;
+    }
+    return (address << 8) | part;
+  }
+
+  private static class Entry {
+    // the address, or zero if the lookup failed
+    public int address;
+    // false while the lookup is in progress
+    public boolean done;
+    public boolean forever;
+    public long expires;
+
+    public boolean expired(long now) {
+      return done && (! forever) && now - expires >= 0;
+    }
+  }
+}
@@ -52,6 +52,10 @@ public abstract class ByteBuffer
     return false;
   }
 
+  public boolean isDirect() {
+    return false;
+  }
+
   public ByteBuffer compact() {
     int remaining = remaining();
 
@@ -242,6 +246,7 @@ public abstract class ByteBuffer
   }
 
   protected void checkGet(int position, int amount) {
-    if (amount > limit-position) throw new IndexOutOfBoundsException();
+    if (position < 0 || amount > limit-position)
+      throw new IndexOutOfBoundsException();
   }
 }
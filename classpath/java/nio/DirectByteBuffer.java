@@ -15,6 +15,8 @@ import sun.misc.Unsafe;
 class DirectByteBuffer extends ByteBuffer {
   private static final Unsafe unsafe = Unsafe.getUnsafe();
   private static final int baseOffset = unsafe.arrayBaseOffset(byte[].class);
+  private static final boolean nativeBigEndian
+    = ByteOrder.nativeOrder() == ByteOrder.BIG_ENDIAN;
 
   protected final long address;
 
@@ -31,6 +33,10 @@ class DirectByteBuffer extends ByteBuffer {
     this(address, capacity, false);
   }
 
+  public boolean isDirect() {
+    return true;
+  }
+
   public ByteBuffer asReadOnlyBuffer() {
     ByteBuffer b = new DirectByteBuffer(address, capacity, true);
     b.position(position());
@@ -89,6 +95,8 @@ class DirectByteBuffer extends ByteBuffer {
     unsafe.copyMemory
       (null, address + position, dst, baseOffset + offset, length);
 
+    position += length;
+
     return this;
   }
 
@@ -96,6 +104,83 @@ class DirectByteBuffer extends ByteBuffer {
     return unsafe.getByte(address + position);
   }
 
+  // The multi-byte accessors below check bounds once and, when the
+  // address is aligned, make a single access, which the JIT compiles to
+  // a plain load or store.  Unaligned addresses take the byte-at-a-time
+  // path, since not every platform supports unaligned accesses.
+
+  public ByteBuffer putLong(int position, long val) {
+    checkPut(position, 8);
+
+    long a = address + position;
+    if ((a & 7) == 0) {
+      unsafe.putLong(a, nativeBigEndian ? val : Long.reverseBytes(val));
+      return this;
+    } else {
+      return super.putLong(position, val);
+    }
+  }
+
+  public ByteBuffer putInt(int position, int val) {
+    checkPut(position, 4);
+
+    long a = address + position;
+    if ((a & 3) == 0) {
+      unsafe.putInt(a, nativeBigEndian ? val : Integer.reverseBytes(val));
+      return this;
+    } else {
+      return super.putInt(position, val);
+    }
+  }
+
+  public ByteBuffer putShort(int position, short val) {
+    checkPut(position, 2);
+
+    long a = address + position;
+    if ((a & 1) == 0) {
+      unsafe.putShort(a, nativeBigEndian ? val : Short.reverseBytes(val));
+      return this;
+    } else {
+      return super.putShort(position, val);
+    }
+  }
+
+  public long getLong(int position) {
+    checkGet(position, 8);
+
+    long a = address + position;
+    if ((a & 7) == 0) {
+      long v = unsafe.getLong(a);
+      return nativeBigEndian ? v : Long.reverseBytes(v);
+    } else {
+      return super.getLong(position);
+    }
+  }
+
+  public int getInt(int position) {
+    checkGet(position, 4);
+
+    long a = address + position;
+    if ((a & 3) == 0) {
+      int v = unsafe.getInt(a);
+      return nativeBigEndian ? v : Integer.reverseBytes(v);
+    } else {
+      return super.getInt(position);
+    }
+  }
+
+  public short getShort(int position) {
+    checkGet(position, 2);
+
+    long a = address + position;
+    if ((a & 1) == 0) {
+      short v = unsafe.getShort(a);
+      return nativeBigEndian ? v : Short.reverseBytes(v);
+    } else {
+      return super.getShort(position);
+    }
+  }
+
   public String toString() {
     return "(DirectByteBuffer with address: " + address
       + " position: " + position
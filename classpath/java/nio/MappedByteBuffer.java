@@ -0,0 +1,113 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.nio;
+
+import java.io.IOException;
+import sun.misc.Cleaner;
+
+public class MappedByteBuffer extends DirectByteBuffer {
+  // modes accepted by map
+  public static final int ReadOnly = 0;
+  public static final int ReadWrite = 1;
+  public static final int Private = 2;
+
+  private static final long alignment = natAlignment();
+
+  // the buffer whose cleaner unmaps the region; views of it refer to
+  // it so that it stays reachable for as long as they do
+  private final MappedByteBuffer owner;
+  private final boolean readOnly;
+
+  private MappedByteBuffer(long address, int capacity, boolean readOnly,
+                           MappedByteBuffer owner)
+  {
+    super(address, capacity, readOnly);
+
+    this.readOnly = readOnly;
+    this.owner = owner == null ? this : owner;
+  }
+
+  // used by FileChannel.map
+  public static MappedByteBuffer map(int fd, int mode, long position,
+                                     int size)
+    throws IOException
+  {
+    if (size == 0) {
+      return new MappedByteBuffer(0, 0, mode == ReadOnly, null);
+    }
+
+    long offset = position % alignment;
+    long length = size + offset;
+    long base = natMap(fd, mode, position - offset, length);
+
+    MappedByteBuffer b = new MappedByteBuffer
+      (base + offset, size, mode == ReadOnly, null);
+
+    Cleaner.create(b, new Unmapper(base, length));
+
+    return b;
+  }
+
+  public ByteBuffer asReadOnlyBuffer() {
+    ByteBuffer b = new MappedByteBuffer(address, capacity, true, owner);
+    b.position(position());
+    b.limit(limit());
+    return b;
+  }
+
+  public ByteBuffer slice() {
+    return new MappedByteBuffer
+      (address + position, remaining(), readOnly, owner);
+  }
+
+  public final MappedByteBuffer force() {
+    if (capacity != 0 && ! readOnly) {
+      natForce(address, capacity);
+    }
+    return this;
+  }
+
+  public final MappedByteBuffer load() {
+    if (capacity != 0) {
+      natLoad(address, capacity);
+    }
+    return this;
+  }
+
+  public String toString() {
+    return "(MappedByteBuffer with address: " + address
+      + " position: " + position
+      + " limit: " + limit
+      + " capacity: " + capacity + ")";
+  }
+
+  private static class Unmapper implements Runnable {
+    private final long base;
+    private final long length;
+
+    public Unmapper(long base, long length) {
+      this.base = base;
+      this.length = length;
+    }
+
+    public void run() {
+      natUnmap(base, length);
+    }
+  }
+
+  private static native long natAlignment();
+  private static native long natMap(int fd, int mode, long position,
+                                    long length)
+    throws IOException;
+  private static native void natUnmap(long address, long length);
+  private static native void natForce(long address, long length);
+  private static native void natLoad(long address, long length);
+}
@@ -0,0 +1,139 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.nio.channels;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.util.LinkedList;
+
+public class AsynchronousFileChannel implements Channel {
+  // number of threads shared by all channels for performing requests;
+  // any number of requests may be outstanding, but at most this many
+  // block in the kernel at once
+  private static final int WorkerCount = 4;
+
+  private static final LinkedList<Request> queue = new LinkedList();
+  private static int idleWorkers;
+  private static int workers;
+
+  private final FileChannel channel;
+
+  private AsynchronousFileChannel(FileChannel channel) {
+    this.channel = channel;
+  }
+
+  public static AsynchronousFileChannel open(FileChannel channel) {
+    return new AsynchronousFileChannel(channel);
+  }
+
+  public boolean isOpen() {
+    return channel.isOpen();
+  }
+
+  public void close() throws IOException {
+    channel.close();
+  }
+
+  public long size() throws IOException {
+    return channel.size();
+  }
+
+  public <A> void read(ByteBuffer dst, long position, A attachment,
+                       CompletionHandler<Integer, ? super A> handler)
+  {
+    submit(new Request(channel, dst, position, false, attachment, handler));
+  }
+
+  public <A> void write(ByteBuffer src, long position, A attachment,
+                        CompletionHandler<Integer, ? super A> handler)
+  {
+    submit(new Request(channel, src, position, true, attachment, handler));
+  }
+
+  private static void submit(Request request) {
+    if (request.position < 0) throw new IllegalArgumentException();
+    if (request.handler == null) throw new NullPointerException();
+
+    synchronized (queue) {
+      queue.addLast(request);
+
+      if (idleWorkers > 0) {
+        queue.notify();
+      } else if (workers < WorkerCount) {
+        ++ workers;
+        Thread t = new Thread(new Worker(), "async file I/O");
+        t.setDaemon(true);
+        t.start();
+      }
+    }
+  }
+
+  private static class Request {
+    public final FileChannel channel;
+    public final ByteBuffer buffer;
+    public final long position;
+    public final boolean write;
+    public final Object attachment;
+    public final CompletionHandler handler;
+
+    public Request(FileChannel channel, ByteBuffer buffer, long position,
+                   boolean write, Object attachment,
+                   CompletionHandler handler)
+    {
+      this.channel = channel;
+      this.buffer = buffer;
+      this.position = position;
+      this.write = write;
+      this.attachment = attachment;
+      this.handler = handler;
+    }
+
+    public void run() {
+      int result;
+      try {
+        result = write
+          ? channel.write(buffer, position)
+          : channel.read(buffer, position);
+      } catch (Throwable e) {
+        handler.failed(e, attachment);
+        return;
+      }
+      handler.completed(result, attachment);
+    }
+  }
+
+  private static class Worker implements Runnable {
+    public void run() {
+      while (true) {
+        Request request;
+        synchronized (queue) {
+          while (queue.isEmpty()) {
+            ++ idleWorkers;
+            try {
+              queue.wait();
+            } catch (InterruptedException e) {
+              // ignore
+            } finally {
+              -- idleWorkers;
+            }
+          }
+          request = queue.removeFirst();
+        }
+
+        try {
+          request.run();
+        } catch (Throwable e) {
+          // a handler threw; keep serving the remaining requests
+        }
+      }
+    }
+  }
+}
@@ -13,6 +13,7 @@ package java.nio.channels;
 import java.io.IOException;
 import java.nio.ByteBuffer;
 import java.net.SocketAddress;
+import java.net.InetAddress;
 import java.net.InetSocketAddress;
 import java.net.ProtocolFamily;
 import java.net.Socket;
@@ -29,6 +30,7 @@ public class DatagramChannel extends SelectableChannel
   private int socket = InvalidSocket;
   private boolean blocking = true;
   private boolean connected = false;
+  private boolean reusePort = false;
 
   public SelectableChannel configureBlocking(boolean v) throws IOException {
     blocking = v;
@@ -72,6 +74,13 @@ public class DatagramChannel extends SelectableChannel
     return new Handle();
   }
 
+  // lets other sockets bind to the same port, so that several readers
+  // may share its datagrams; this must be set before binding
+  public DatagramChannel setReusePort(boolean on) {
+    reusePort = on;
+    return this;
+  }
+
   public DatagramChannel bind(SocketAddress address) throws IOException {
     InetSocketAddress inetAddress;
     try {
@@ -80,7 +89,8 @@ public class DatagramChannel extends SelectableChannel
       throw new UnsupportedAddressTypeException();
     }
 
-    socket = bind(inetAddress.getHostName(), inetAddress.getPort());
+    socket = bind(inetAddress.getHostName(), inetAddress.getPort(),
+                  reusePort);
     configureBlocking();
 
     return this;
@@ -94,7 +104,9 @@ public class DatagramChannel extends SelectableChannel
       throw new UnsupportedAddressTypeException();
     }
 
-    socket = connect(inetAddress.getHostName(), inetAddress.getPort());
+    socket = connect
+      (InetAddress.getByName(inetAddress.getHostName()).getHostAddress(),
+       inetAddress.getPort());
     configureBlocking();
 
     if (socket != 0) connected = true;
@@ -145,6 +157,98 @@ public class DatagramChannel extends SelectableChannel
     }
   }
 
+  // receives a datagram into each of the direct buffers from
+  // dsts[offset] to dsts[offset + length - 1], in order, and stores its
+  // sender in the same element of senders unless that is null.
+  // Returns how many were received, which may be fewer than length
+  // (and, if the channel is non-blocking, zero) when no more have
+  // arrived.
+  public int receive(ByteBuffer[] dsts, int offset, int length,
+                     SocketAddress[] senders)
+    throws IOException
+  {
+    Batch b = new Batch(dsts, offset, length);
+    int[] addresses = new int[length * 2];
+
+    int c = receiveBatch
+      (socket, b.buffers, b.offsets, b.lengths, addresses, length, blocking);
+
+    for (int i = 0; i < c; ++i) {
+      ByteBuffer d = dsts[offset + i];
+      d.position(d.position() + b.lengths[i]);
+      if (senders != null) {
+        senders[offset + i] = new InetSocketAddress
+          (ipv4ToString(addresses[i * 2]), addresses[(i * 2) + 1]);
+      }
+    }
+
+    return c;
+  }
+
+  // sends the remaining contents of each of the direct buffers from
+  // srcs[offset] to srcs[offset + length - 1] as a datagram, to the
+  // same element of targets, or to the connected address if targets
+  // is null.  Returns how many were sent.
+  public int send(ByteBuffer[] srcs, int offset, int length,
+                  SocketAddress[] targets)
+    throws IOException
+  {
+    Batch b = new Batch(srcs, offset, length);
+    String[] hosts = null;
+    int[] ports = null;
+    if (targets != null) {
+      hosts = new String[length];
+      ports = new int[length];
+      for (int i = 0; i < length; ++i) {
+        InetSocketAddress a;
+        try {
+          a = (InetSocketAddress) targets[offset + i];
+        } catch (ClassCastException e) {
+          throw new UnsupportedAddressTypeException();
+        }
+        hosts[i] = InetAddress.getByName(a.getHostName()).getHostAddress();
+        ports[i] = a.getPort();
+      }
+    }
+
+    int c = sendBatch
+      (socket, b.buffers, b.offsets, b.lengths, hosts, ports, length);
+
+    for (int i = 0; i < c; ++i) {
+      ByteBuffer s = srcs[offset + i];
+      s.position(s.limit());
+    }
+
+    return c;
+  }
+
+  // describes the direct buffers of a receiveBatch or sendBatch call
+  private static class Batch {
+    public final Object[] buffers;
+    public final int[] offsets;
+    public final int[] lengths;
+
+    public Batch(ByteBuffer[] array, int offset, int length) {
+      if (offset < 0 || length < 0 || offset + length > array.length) {
+        throw new IndexOutOfBoundsException();
+      }
+
+      buffers = new Object[length];
+      offsets = new int[length];
+      lengths = new int[length];
+
+      for (int i = 0; i < length; ++i) {
+        ByteBuffer b = array[offset + i];
+        if (! b.isDirect()) {
+          throw new IllegalArgumentException("buffer is not direct");
+        }
+        buffers[i] = b;
+        offsets[i] = b.position();
+        lengths[i] = b.remaining();
+      }
+    }
+  }
+
   private static String ipv4ToString(int address) {
     StringBuilder sb = new StringBuilder();
 
@@ -185,7 +289,8 @@ public class DatagramChannel extends SelectableChannel
 
   private static native void configureBlocking(int socket, boolean blocking)
     throws IOException;
-  private static native int bind(String hostname, int port)
+  private static native int bind(String hostname, int port,
+                                 boolean reusePort)
     throws IOException;
   private static native int connect(String hostname, int port)
     throws IOException;
@@ -196,4 +301,13 @@ public class DatagramChannel extends SelectableChannel
                                     int length, boolean blocking,
                                     int[] address)
     throws IOException;
+  private static native int receiveBatch(int socket, Object[] buffers,
+                                         int[] offsets, int[] lengths,
+                                         int[] addresses, int count,
+                                         boolean blocking)
+    throws IOException;
+  private static native int sendBatch(int socket, Object[] buffers,
+                                      int[] offsets, int[] lengths,
+                                      String[] hosts, int[] ports, int count)
+    throws IOException;
 }
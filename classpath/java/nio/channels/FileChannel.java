@@ -0,0 +1,245 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.nio.channels;
+
+import java.io.Closeable;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
+
+public class FileChannel implements ReadableByteChannel, WritableByteChannel {
+  // size of the heap buffer used when a transfer can't be done by the
+  // kernel
+  private static final int TransferBufferSize = 8192;
+
+  public static class MapMode {
+    public static final MapMode READ_ONLY
+      = new MapMode("READ_ONLY", MappedByteBuffer.ReadOnly);
+    public static final MapMode READ_WRITE
+      = new MapMode("READ_WRITE", MappedByteBuffer.ReadWrite);
+    public static final MapMode PRIVATE
+      = new MapMode("PRIVATE", MappedByteBuffer.Private);
+
+    private final String name;
+    private final int value;
+
+    private MapMode(String name, int value) {
+      this.name = name;
+      this.value = value;
+    }
+
+    public String toString() {
+      return name;
+    }
+  }
+
+  private final int fd;
+  private final Closeable owner;
+  private boolean open = true;
+
+  // used by the java.io streams, which own the descriptor
+  public FileChannel(int fd, Closeable owner) {
+    this.fd = fd;
+    this.owner = owner;
+  }
+
+  public boolean isOpen() {
+    return open;
+  }
+
+  public void close() throws IOException {
+    if (open) {
+      open = false;
+      owner.close();
+    }
+  }
+
+  private void checkOpen() throws IOException {
+    if (! open) throw new ClosedChannelException();
+  }
+
+  public long position() throws IOException {
+    checkOpen();
+    return natPosition(fd);
+  }
+
+  public FileChannel position(long position) throws IOException {
+    if (position < 0) throw new IllegalArgumentException();
+
+    checkOpen();
+    natSetPosition(fd, position);
+    return this;
+  }
+
+  public long size() throws IOException {
+    checkOpen();
+    return natSize(fd);
+  }
+
+  public int read(ByteBuffer b) throws IOException {
+    return read(b, -1);
+  }
+
+  public int read(ByteBuffer b, long position) throws IOException {
+    checkOpen();
+    if (b.remaining() == 0) return 0;
+
+    int r;
+    if (b.hasArray()) {
+      r = natRead
+        (fd, b.array(), b.arrayOffset() + b.position(), b.remaining(),
+         position);
+      if (r > 0) {
+        b.position(b.position() + r);
+      }
+    } else if (b.isDirect()) {
+      r = natReadDirect(fd, b, b.position(), b.remaining(), position);
+      if (r > 0) {
+        b.position(b.position() + r);
+      }
+    } else {
+      byte[] array = new byte[Math.min(b.remaining(), TransferBufferSize)];
+      r = natRead(fd, array, 0, array.length, position);
+      if (r > 0) {
+        b.put(array, 0, r);
+      }
+    }
+    return r == 0 ? -1 : r;
+  }
+
+  public int write(ByteBuffer b) throws IOException {
+    return write(b, -1);
+  }
+
+  public int write(ByteBuffer b, long position) throws IOException {
+    checkOpen();
+    if (b.remaining() == 0) return 0;
+
+    int w;
+    if (b.hasArray()) {
+      w = natWrite
+        (fd, b.array(), b.arrayOffset() + b.position(), b.remaining(),
+         position);
+      if (w > 0) {
+        b.position(b.position() + w);
+      }
+    } else if (b.isDirect()) {
+      w = natWriteDirect(fd, b, b.position(), b.remaining(), position);
+      if (w > 0) {
+        b.position(b.position() + w);
+      }
+    } else {
+      byte[] array = new byte[Math.min(b.remaining(), TransferBufferSize)];
+      int p = b.position();
+      b.get(array);
+      w = natWrite(fd, array, 0, array.length, position);
+      b.position(p + Math.max(w, 0));
+    }
+    return w;
+  }
+
+  public MappedByteBuffer map(MapMode mode, long position, long size)
+    throws IOException
+  {
+    if (position < 0 || size < 0 || size > Integer.MAX_VALUE) {
+      throw new IllegalArgumentException();
+    }
+
+    checkOpen();
+    return MappedByteBuffer.map(fd, mode.value, position, (int) size);
+  }
+
+  public long transferTo(long position, long count, WritableByteChannel target)
+    throws IOException
+  {
+    if (position < 0 || count < 0) throw new IllegalArgumentException();
+
+    checkOpen();
+
+    if (target instanceof SocketChannel) {
+      long r = natTransferTo
+        (fd, position, count, ((SocketChannel) target).socketFD());
+      if (r >= 0) {
+        return r;
+      }
+      // otherwise, the platform can't do it for us; fall through
+    }
+
+    ByteBuffer buffer = ByteBuffer.allocate
+      ((int) Math.min(count, TransferBufferSize));
+    long total = 0;
+    while (total < count) {
+      buffer.clear();
+      buffer.limit((int) Math.min(count - total, buffer.capacity()));
+
+      int r = read(buffer, position + total);
+      if (r <= 0) break;
+
+      buffer.flip();
+      while (buffer.hasRemaining()) {
+        if (target.write(buffer) <= 0) {
+          // a non-blocking target is full; report what it took
+          return total + r - buffer.remaining();
+        }
+      }
+      total += r;
+    }
+    return total;
+  }
+
+  public long transferFrom(ReadableByteChannel src, long position, long count)
+    throws IOException
+  {
+    if (position < 0 || count < 0) throw new IllegalArgumentException();
+
+    checkOpen();
+
+    ByteBuffer buffer = ByteBuffer.allocate
+      ((int) Math.min(count, TransferBufferSize));
+    long total = 0;
+    while (total < count) {
+      buffer.clear();
+      buffer.limit((int) Math.min(count - total, buffer.capacity()));
+
+      int r = src.read(buffer);
+      if (r <= 0) break;
+
+      buffer.flip();
+      while (buffer.hasRemaining()) {
+        write(buffer, position + total + buffer.position());
+      }
+      total += r;
+    }
+    return total;
+  }
+
+  private static native long natPosition(int fd) throws IOException;
+  private static native void natSetPosition(int fd, long position)
+    throws IOException;
+  private static native long natSize(int fd) throws IOException;
+  private static native int natRead(int fd, byte[] buffer, int offset,
+                                    int length, long position)
+    throws IOException;
+  private static native int natWrite(int fd, byte[] buffer, int offset,
+                                     int length, long position)
+    throws IOException;
+  private static native int natReadDirect(int fd, ByteBuffer buffer,
+                                          int offset, int length,
+                                          long position)
+    throws IOException;
+  private static native int natWriteDirect(int fd, ByteBuffer buffer,
+                                           int offset, int length,
+                                           long position)
+    throws IOException;
+  private static native long natTransferTo(int fd, long position, long count,
+                                           int socket)
+    throws IOException;
+}
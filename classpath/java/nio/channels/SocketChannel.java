@@ -13,12 +13,13 @@ package java.nio.channels;
 import java.io.IOException;
 import java.net.SocketException;
 import java.net.SocketAddress;
+import java.net.InetAddress;
 import java.net.InetSocketAddress;
 import java.net.Socket;
 import java.nio.ByteBuffer;
 
 public class SocketChannel extends SelectableChannel
-  implements ReadableByteChannel, GatheringByteChannel
+  implements ReadableByteChannel, GatheringByteChannel, ScatteringByteChannel
 {
   public static final int InvalidSocket = -1;
 
@@ -97,6 +98,9 @@ public class SocketChannel extends SelectableChannel
   private int doConnect(String host, int port) throws IOException {
     if (host == null) throw new NullPointerException();
 
+    // resolve through the InetAddress cache rather than natively
+    host = InetAddress.getByName(host).getHostAddress();
+
     boolean b[] = new boolean[1];
     int s = natDoConnect(host, port, blocking, b);
     connected = b[0];
@@ -140,14 +144,80 @@ public class SocketChannel extends SelectableChannel
   public long write(ByteBuffer[] srcs, int offset, int length)
     throws IOException
   {
-    long total = 0;
-    for (int i = offset; i < offset + length; ++i) {
-      total += write(srcs[i]);
-      if (srcs[i].hasRemaining()) {
-        return total;
+    if (! connected) {
+      natThrowWriteError(socket);
+    }
+    if (offset < 0 || length < 0 || offset + length > srcs.length) {
+      throw new IndexOutOfBoundsException();
+    }
+
+    BufferVector v = new BufferVector(srcs, offset, length);
+    long w = natWritev(socket, v.buffers, v.offsets, v.lengths, v.direct,
+                       length, blocking);
+    if (w > 0) {
+      v.advance(srcs, offset, w);
+    }
+    return w;
+  }
+
+  public long read(ByteBuffer[] dsts) throws IOException {
+    return read(dsts, 0, dsts.length);
+  }
+
+  public long read(ByteBuffer[] dsts, int offset, int length)
+    throws IOException
+  {
+    if (! isOpen()) return -1;
+    if (offset < 0 || length < 0 || offset + length > dsts.length) {
+      throw new IndexOutOfBoundsException();
+    }
+
+    BufferVector v = new BufferVector(dsts, offset, length);
+    long r = natReadv(socket, v.buffers, v.offsets, v.lengths, v.direct,
+                      length, blocking);
+    if (r > 0) {
+      v.advance(dsts, offset, r);
+    }
+    return r;
+  }
+
+  // describes a sequence of buffers for a single readv or writev call:
+  // heap buffers are passed as their arrays, direct buffers as
+  // themselves so the native code can use their addresses
+  private static class BufferVector {
+    public final Object[] buffers;
+    public final int[] offsets;
+    public final int[] lengths;
+    public final boolean[] direct;
+
+    public BufferVector(ByteBuffer[] array, int offset, int length) {
+      buffers = new Object[length];
+      offsets = new int[length];
+      lengths = new int[length];
+      direct = new boolean[length];
+
+      for (int i = 0; i < length; ++i) {
+        ByteBuffer b = array[offset + i];
+        if (b.hasArray()) {
+          buffers[i] = b.array();
+          offsets[i] = b.arrayOffset() + b.position();
+        } else {
+          buffers[i] = b;
+          offsets[i] = b.position();
+          direct[i] = true;
+        }
+        lengths[i] = b.remaining();
+      }
+    }
+
+    public void advance(ByteBuffer[] array, int offset, long count) {
+      for (int i = 0; count > 0 && i < lengths.length; ++i) {
+        ByteBuffer b = array[offset + i];
+        int n = (int) Math.min(count, lengths[i]);
+        b.position(b.position() + n);
+        count -= n;
       }
     }
-    return total;
   }
 
   private void closeSocket() {
@@ -184,6 +254,16 @@ public class SocketChannel extends SelectableChannel
     throws IOException;
   private static native int natWrite(int socket, byte[] buffer, int offset, int length, boolean blocking)
     throws IOException;
+  private static native long natReadv(int socket, Object[] buffers,
+                                      int[] offsets, int[] lengths,
+                                      boolean[] direct, int count,
+                                      boolean blocking)
+    throws IOException;
+  private static native long natWritev(int socket, Object[] buffers,
+                                       int[] offsets, int[] lengths,
+                                       boolean[] direct, int count,
+                                       boolean blocking)
+    throws IOException;
   private static native void natThrowWriteError(int socket) throws IOException;
   private static native void natCloseSocket(int socket);
 }
@@ -10,7 +10,16 @@
 
 package java.util;
 
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.RecursiveAction;
+
 public class Arrays {
+  // ranges shorter than this are sorted by insertion
+  private static final int InsertionSortThreshold = 32;
+
+  // parallelSort sorts ranges no longer than this in a single task
+  private static final int ParallelSortThreshold = 8192;
+
   private Arrays() { }
 
   public static String toString(Object[] a) {
@@ -38,24 +47,777 @@ public class Arrays {
     return (a == null && b == null) || (a != null && a.equals(b));
   }
 
+  private static void checkRange(int length, int from, int to) {
+    if (from > to) {
+      throw new IllegalArgumentException(from + " > " + to);
+    }
+    if (from < 0 || to > length) {
+      throw new ArrayIndexOutOfBoundsException();
+    }
+  }
+
+  private static final Comparator NaturalOrder = new Comparator() {
+      public int compare(Object a, Object b) {
+        return ((Comparable) a).compareTo(b);
+      }
+    };
+
   public static void sort(Object[] array) {
-    sort(array, new Comparator() {
-        public int compare(Object a, Object b) {
-          return ((Comparable) a).compareTo(b);
-        }
-      });
+    sort(array, 0, array.length, null);
+  }
+
+  public static void sort(Object[] array, int from, int to) {
+    sort(array, from, to, null);
   }
 
   public static <T> void sort(T[] array, Comparator<? super T> comparator) {
-    // insertion sort
-    for (int j = 1; j < array.length; ++j) {
-      T t = array[j];
-      int i = j - 1;
-      while (i >= 0 && comparator.compare(array[i], t) > 0) {
-        array[i + 1] = array[i];
-        i = i - 1;
-      }
-      array[i + 1] = t;
+    sort(array, 0, array.length, comparator);
+  }
+
+  public static <T> void sort(T[] array, int from, int to,
+                              Comparator<? super T> comparator)
+  {
+    checkRange(array.length, from, to);
+
+    Object[] copy = new Object[to - from];
+    System.arraycopy(array, from, copy, 0, to - from);
+    mergeSort(copy, array, from, to, -from,
+              comparator == null ? NaturalOrder : comparator);
+  }
+
+  // A stable merge sort of dst[low, high) which, like src[low + offset,
+  // high + offset), initially holds the elements to sort.  The two
+  // arrays swap roles at each level, and runs which are already in order
+  // are copied rather than merged.
+  private static void mergeSort(Object[] src, Object[] dst, int low,
+                                int high, int offset, Comparator c)
+  {
+    int length = high - low;
+    if (length < InsertionSortThreshold) {
+      for (int i = low + 1; i < high; ++i) {
+        Object v = dst[i];
+        int j = i - 1;
+        for (; j >= low && c.compare(dst[j], v) > 0; --j) {
+          dst[j + 1] = dst[j];
+        }
+        dst[j + 1] = v;
+      }
+      return;
+    }
+
+    int dstLow = low;
+    low += offset;
+    high += offset;
+    int middle = (low + high) >>> 1;
+    mergeSort(dst, src, low, middle, -offset, c);
+    mergeSort(dst, src, middle, high, -offset, c);
+
+    if (c.compare(src[middle - 1], src[middle]) <= 0) {
+      System.arraycopy(src, low, dst, dstLow, length);
+      return;
+    }
+
+    for (int i = dstLow, p = low, q = middle; i < dstLow + length; ++i) {
+      if (q >= high || (p < middle && c.compare(src[p], src[q]) <= 0)) {
+        dst[i] = src[p++];
+      } else {
+        dst[i] = src[q++];
+      }
+    }
+  }
+
+  public static void sort(int[] array) {
+    quickSort(array, 0, array.length - 1);
+  }
+
+  public static void sort(int[] array, int from, int to) {
+    checkRange(array.length, from, to);
+    quickSort(array, from, to - 1);
+  }
+
+  public static void sort(long[] array) {
+    quickSort(array, 0, array.length - 1);
+  }
+
+  public static void sort(long[] array, int from, int to) {
+    checkRange(array.length, from, to);
+    quickSort(array, from, to - 1);
+  }
+
+  public static void sort(byte[] array) {
+    quickSort(array, 0, array.length - 1);
+  }
+
+  public static void sort(byte[] array, int from, int to) {
+    checkRange(array.length, from, to);
+    quickSort(array, from, to - 1);
+  }
+
+  public static void sort(char[] array) {
+    quickSort(array, 0, array.length - 1);
+  }
+
+  public static void sort(char[] array, int from, int to) {
+    checkRange(array.length, from, to);
+    quickSort(array, from, to - 1);
+  }
+
+  public static void sort(double[] array) {
+    sort(array, 0, array.length);
+  }
+
+  public static void sort(double[] array, int from, int to) {
+    checkRange(array.length, from, to);
+    int end = moveNaNsToEnd(array, from, to);
+    quickSort(array, from, end - 1);
+    orderZeros(array, from, end);
+  }
+
+  // NaN compares false with everything, including itself, so NaNs are
+  // moved out of the way before sorting the rest, which is where they
+  // belong anyway.  Returns the end of the remaining range.
+  private static int moveNaNsToEnd(double[] a, int from, int to) {
+    int end = to;
+    for (int i = from; i < end;) {
+      if (a[i] != a[i]) {
+        swap(a, i, --end);
+      } else {
+        ++ i;
+      }
+    }
+    return end;
+  }
+
+  // -0.0 and 0.0 compare equal, but -0.0 sorts first, so this rewrites
+  // the run of zeros in the sorted range a[from, to) accordingly
+  private static void orderZeros(double[] a, int from, int to) {
+    int low = from;
+    int high = to;
+    while (low < high) {
+      int middle = (low + high) >>> 1;
+      if (a[middle] < 0.0) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+
+    int negatives = 0;
+    int end = low;
+    for (; end < to && a[end] == 0.0; ++end) {
+      if (Double.doubleToRawLongBits(a[end]) < 0) {
+        ++ negatives;
+      }
+    }
+
+    for (int i = low; i < end; ++i) {
+      a[i] = i < low + negatives ? -0.0 : 0.0;
+    }
+  }
+
+  // A dual-pivot quicksort of the inclusive range a[left, right],
+  // falling back to insertion sort for short ranges.
+  private static void quickSort(int[] a, int left, int right) {
+    while (right - left >= InsertionSortThreshold) {
+      // use the elements at one third and two thirds of the way through
+      // the range as pivots, which avoids quadratic behavior for sorted
+      // and reverse-sorted input
+      int third = (right - left) / 3;
+      int m1 = left + third;
+      int m2 = right - third;
+      if (a[m1] > a[m2]) {
+        swap(a, m1, m2);
+      }
+      swap(a, m1, left);
+      swap(a, m2, right);
+
+      int p = a[left];
+      int q = a[right];
+      int less = left + 1;
+      int great = right - 1;
+      for (int k = less; k <= great; ++k) {
+        if (a[k] < p) {
+          swap(a, k, less++);
+        } else if (a[k] > q) {
+          while (k < great && a[great] > q) {
+            -- great;
+          }
+          swap(a, k, great--);
+          if (a[k] < p) {
+            swap(a, k, less++);
+          }
+        }
+      }
+      swap(a, left, less - 1);
+      swap(a, right, great + 1);
+
+      quickSort(a, left, less - 2);
+      quickSort(a, great + 2, right);
+
+      if (p == q) {
+        // everything in the middle part equals both pivots
+        return;
+      }
+
+      // move elements equal to either pivot out of the middle part so
+      // that runs of duplicates don't stop it from shrinking
+      for (int k = less; k <= great; ++k) {
+        if (a[k] == p) {
+          swap(a, k, less++);
+        } else if (a[k] == q) {
+          while (k < great && a[great] == q) {
+            -- great;
+          }
+          swap(a, k, great--);
+          if (a[k] == p) {
+            swap(a, k, less++);
+          }
+        }
+      }
+
+      left = less;
+      right = great;
+    }
+
+    for (int i = left + 1; i <= right; ++i) {
+      int v = a[i];
+      int j = i - 1;
+      for (; j >= left && a[j] > v; --j) {
+        a[j + 1] = a[j];
+      }
+      a[j + 1] = v;
+    }
+  }
+
+  private static void swap(int[] a, int i, int j) {
+    int t = a[i];
+    a[i] = a[j];
+    a[j] = t;
+  }
+
+  private static void quickSort(long[] a, int left, int right) {
+    while (right - left >= InsertionSortThreshold) {
+      int third = (right - left) / 3;
+      int m1 = left + third;
+      int m2 = right - third;
+      if (a[m1] > a[m2]) {
+        swap(a, m1, m2);
+      }
+      swap(a, m1, left);
+      swap(a, m2, right);
+
+      long p = a[left];
+      long q = a[right];
+      int less = left + 1;
+      int great = right - 1;
+      for (int k = less; k <= great; ++k) {
+        if (a[k] < p) {
+          swap(a, k, less++);
+        } else if (a[k] > q) {
+          while (k < great && a[great] > q) {
+            -- great;
+          }
+          swap(a, k, great--);
+          if (a[k] < p) {
+            swap(a, k, less++);
+          }
+        }
+      }
+      swap(a, left, less - 1);
+      swap(a, right, great + 1);
+
+      quickSort(a, left, less - 2);
+      quickSort(a, great + 2, right);
+
+      if (p == q) {
+        return;
+      }
+
+      for (int k = less; k <= great; ++k) {
+        if (a[k] == p) {
+          swap(a, k, less++);
+        } else if (a[k] == q) {
+          while (k < great && a[great] == q) {
+            -- great;
+          }
+          swap(a, k, great--);
+          if (a[k] == p) {
+            swap(a, k, less++);
+          }
+        }
+      }
+
+      left = less;
+      right = great;
+    }
+
+    for (int i = left + 1; i <= right; ++i) {
+      long v = a[i];
+      int j = i - 1;
+      for (; j >= left && a[j] > v; --j) {
+        a[j + 1] = a[j];
+      }
+      a[j + 1] = v;
+    }
+  }
+
+  private static void swap(long[] a, int i, int j) {
+    long t = a[i];
+    a[i] = a[j];
+    a[j] = t;
+  }
+
+  private static void quickSort(double[] a, int left, int right) {
+    while (right - left >= InsertionSortThreshold) {
+      int third = (right - left) / 3;
+      int m1 = left + third;
+      int m2 = right - third;
+      if (a[m1] > a[m2]) {
+        swap(a, m1, m2);
+      }
+      swap(a, m1, left);
+      swap(a, m2, right);
+
+      double p = a[left];
+      double q = a[right];
+      int less = left + 1;
+      int great = right - 1;
+      for (int k = less; k <= great; ++k) {
+        if (a[k] < p) {
+          swap(a, k, less++);
+        } else if (a[k] > q) {
+          while (k < great && a[great] > q) {
+            -- great;
+          }
+          swap(a, k, great--);
+          if (a[k] < p) {
+            swap(a, k, less++);
+          }
+        }
+      }
+      swap(a, left, less - 1);
+      swap(a, right, great + 1);
+
+      quickSort(a, left, less - 2);
+      quickSort(a, great + 2, right);
+
+      if (p == q) {
+        return;
+      }
+
+      for (int k = less; k <= great; ++k) {
+        if (a[k] == p) {
+          swap(a, k, less++);
+        } else if (a[k] == q) {
+          while (k < great && a[great] == q) {
+            -- great;
+          }
+          swap(a, k, great--);
+          if (a[k] == p) {
+            swap(a, k, less++);
+          }
+        }
+      }
+
+      left = less;
+      right = great;
+    }
+
+    for (int i = left + 1; i <= right; ++i) {
+      double v = a[i];
+      int j = i - 1;
+      for (; j >= left && a[j] > v; --j) {
+        a[j + 1] = a[j];
+      }
+      a[j + 1] = v;
+    }
+  }
+
+  private static void swap(double[] a, int i, int j) {
+    double t = a[i];
+    a[i] = a[j];
+    a[j] = t;
+  }
+
+  private static void quickSort(byte[] a, int left, int right) {
+    while (right - left >= InsertionSortThreshold) {
+      int third = (right - left) / 3;
+      int m1 = left + third;
+      int m2 = right - third;
+      if (a[m1] > a[m2]) {
+        swap(a, m1, m2);
+      }
+      swap(a, m1, left);
+      swap(a, m2, right);
+
+      byte p = a[left];
+      byte q = a[right];
+      int less = left + 1;
+      int great = right - 1;
+      for (int k = less; k <= great; ++k) {
+        if (a[k] < p) {
+          swap(a, k, less++);
+        } else if (a[k] > q) {
+          while (k < great && a[great] > q) {
+            -- great;
+          }
+          swap(a, k, great--);
+          if (a[k] < p) {
+            swap(a, k, less++);
+          }
+        }
+      }
+      swap(a, left, less - 1);
+      swap(a, right, great + 1);
+
+      quickSort(a, left, less - 2);
+      quickSort(a, great + 2, right);
+
+      if (p == q) {
+        return;
+      }
+
+      for (int k = less; k <= great; ++k) {
+        if (a[k] == p) {
+          swap(a, k, less++);
+        } else if (a[k] == q) {
+          while (k < great && a[great] == q) {
+            -- great;
+          }
+          swap(a, k, great--);
+          if (a[k] == p) {
+            swap(a, k, less++);
+          }
+        }
+      }
+
+      left = less;
+      right = great;
+    }
+
+    for (int i = left + 1; i <= right; ++i) {
+      byte v = a[i];
+      int j = i - 1;
+      for (; j >= left && a[j] > v; --j) {
+        a[j + 1] = a[j];
+      }
+      a[j + 1] = v;
+    }
+  }
+
+  private static void swap(byte[] a, int i, int j) {
+    byte t = a[i];
+    a[i] = a[j];
+    a[j] = t;
+  }
+
+  private static void quickSort(char[] a, int left, int right) {
+    while (right - left >= InsertionSortThreshold) {
+      int third = (right - left) / 3;
+      int m1 = left + third;
+      int m2 = right - third;
+      if (a[m1] > a[m2]) {
+        swap(a, m1, m2);
+      }
+      swap(a, m1, left);
+      swap(a, m2, right);
+
+      char p = a[left];
+      char q = a[right];
+      int less = left + 1;
+      int great = right - 1;
+      for (int k = less; k <= great; ++k) {
+        if (a[k] < p) {
+          swap(a, k, less++);
+        } else if (a[k] > q) {
+          while (k < great && a[great] > q) {
+            -- great;
+          }
+          swap(a, k, great--);
+          if (a[k] < p) {
+            swap(a, k, less++);
+          }
+        }
+      }
+      swap(a, left, less - 1);
+      swap(a, right, great + 1);
+
+      quickSort(a, left, less - 2);
+      quickSort(a, great + 2, right);
+
+      if (p == q) {
+        return;
+      }
+
+      for (int k = less; k <= great; ++k) {
+        if (a[k] == p) {
+          swap(a, k, less++);
+        } else if (a[k] == q) {
+          while (k < great && a[great] == q) {
+            -- great;
+          }
+          swap(a, k, great--);
+          if (a[k] == p) {
+            swap(a, k, less++);
+          }
+        }
+      }
+
+      left = less;
+      right = great;
+    }
+
+    for (int i = left + 1; i <= right; ++i) {
+      char v = a[i];
+      int j = i - 1;
+      for (; j >= left && a[j] > v; --j) {
+        a[j + 1] = a[j];
+      }
+      a[j + 1] = v;
+    }
+  }
+
+  private static void swap(char[] a, int i, int j) {
+    char t = a[i];
+    a[i] = a[j];
+    a[j] = t;
+  }
+
+  private static boolean useParallelSort(int length) {
+    return length > ParallelSortThreshold
+      && ForkJoinPool.commonPool().getParallelism() > 1;
+  }
+
+  // sorts halves of a range in parallel until they are small enough to
+  // sort sequentially, then merges them
+  private abstract static class ParallelSort extends RecursiveAction {
+    private final int from;
+    private final int to;
+
+    public ParallelSort(int from, int to) {
+      this.from = from;
+      this.to = to;
+    }
+
+    protected abstract ParallelSort split(int from, int to);
+
+    protected abstract void sort(int from, int to);
+
+    protected abstract void merge(int from, int middle, int to);
+
+    protected void compute() {
+      if (to - from <= ParallelSortThreshold) {
+        sort(from, to);
+      } else {
+        int middle = (from + to) >>> 1;
+        invokeAll(split(from, middle), split(middle, to));
+        merge(from, middle, to);
+      }
+    }
+  }
+
+  private static class ParallelIntSort extends ParallelSort {
+    private final int[] array;
+    private final int[] scratch;
+
+    public ParallelIntSort(int[] array, int[] scratch, int from, int to) {
+      super(from, to);
+      this.array = array;
+      this.scratch = scratch;
+    }
+
+    protected ParallelSort split(int from, int to) {
+      return new ParallelIntSort(array, scratch, from, to);
+    }
+
+    protected void sort(int from, int to) {
+      quickSort(array, from, to - 1);
+    }
+
+    protected void merge(int from, int middle, int to) {
+      if (array[middle - 1] > array[middle]) {
+        System.arraycopy(array, from, scratch, from, middle - from);
+        int i = from;
+        int j = middle;
+        int k = from;
+        while (i < middle && j < to) {
+          array[k++] = scratch[i] <= array[j] ? scratch[i++] : array[j++];
+        }
+        System.arraycopy(scratch, i, array, k, middle - i);
+      }
+    }
+  }
+
+  private static class ParallelLongSort extends ParallelSort {
+    private final long[] array;
+    private final long[] scratch;
+
+    public ParallelLongSort(long[] array, long[] scratch, int from, int to) {
+      super(from, to);
+      this.array = array;
+      this.scratch = scratch;
+    }
+
+    protected ParallelSort split(int from, int to) {
+      return new ParallelLongSort(array, scratch, from, to);
+    }
+
+    protected void sort(int from, int to) {
+      quickSort(array, from, to - 1);
+    }
+
+    protected void merge(int from, int middle, int to) {
+      if (array[middle - 1] > array[middle]) {
+        System.arraycopy(array, from, scratch, from, middle - from);
+        int i = from;
+        int j = middle;
+        int k = from;
+        while (i < middle && j < to) {
+          array[k++] = scratch[i] <= array[j] ? scratch[i++] : array[j++];
+        }
+        System.arraycopy(scratch, i, array, k, middle - i);
+      }
+    }
+  }
+
+  private static class ParallelDoubleSort extends ParallelSort {
+    private final double[] array;
+    private final double[] scratch;
+
+    public ParallelDoubleSort(double[] array, double[] scratch, int from,
+                              int to)
+    {
+      super(from, to);
+      this.array = array;
+      this.scratch = scratch;
+    }
+
+    protected ParallelSort split(int from, int to) {
+      return new ParallelDoubleSort(array, scratch, from, to);
+    }
+
+    protected void sort(int from, int to) {
+      quickSort(array, from, to - 1);
+    }
+
+    protected void merge(int from, int middle, int to) {
+      if (array[middle - 1] > array[middle]) {
+        System.arraycopy(array, from, scratch, from, middle - from);
+        int i = from;
+        int j = middle;
+        int k = from;
+        while (i < middle && j < to) {
+          array[k++] = scratch[i] <= array[j] ? scratch[i++] : array[j++];
+        }
+        System.arraycopy(scratch, i, array, k, middle - i);
+      }
+    }
+  }
+
+  private static class ParallelObjectSort extends ParallelSort {
+    private final Object[] array;
+    private final Object[] scratch;
+    private final Comparator comparator;
+
+    public ParallelObjectSort(Object[] array, Object[] scratch,
+                              Comparator comparator, int from, int to)
+    {
+      super(from, to);
+      this.array = array;
+      this.scratch = scratch;
+      this.comparator = comparator;
+    }
+
+    protected ParallelSort split(int from, int to) {
+      return new ParallelObjectSort(array, scratch, comparator, from, to);
+    }
+
+    protected void sort(int from, int to) {
+      Arrays.sort(array, from, to, comparator);
+    }
+
+    protected void merge(int from, int middle, int to) {
+      Comparator c = comparator;
+      if (c.compare(array[middle - 1], array[middle]) > 0) {
+        System.arraycopy(array, from, scratch, from, middle - from);
+        int i = from;
+        int j = middle;
+        int k = from;
+        while (i < middle && j < to) {
+          array[k++] = c.compare(scratch[i], array[j]) <= 0
+            ? scratch[i++] : array[j++];
+        }
+        System.arraycopy(scratch, i, array, k, middle - i);
+      }
+    }
+  }
+
+  public static void parallelSort(int[] array) {
+    parallelSort(array, 0, array.length);
+  }
+
+  public static void parallelSort(int[] array, int from, int to) {
+    checkRange(array.length, from, to);
+    if (useParallelSort(to - from)) {
+      ForkJoinPool.commonPool().invoke
+        (new ParallelIntSort(array, new int[to], from, to));
+    } else {
+      quickSort(array, from, to - 1);
+    }
+  }
+
+  public static void parallelSort(long[] array) {
+    parallelSort(array, 0, array.length);
+  }
+
+  public static void parallelSort(long[] array, int from, int to) {
+    checkRange(array.length, from, to);
+    if (useParallelSort(to - from)) {
+      ForkJoinPool.commonPool().invoke
+        (new ParallelLongSort(array, new long[to], from, to));
+    } else {
+      quickSort(array, from, to - 1);
+    }
+  }
+
+  public static void parallelSort(double[] array) {
+    parallelSort(array, 0, array.length);
+  }
+
+  public static void parallelSort(double[] array, int from, int to) {
+    checkRange(array.length, from, to);
+    int end = moveNaNsToEnd(array, from, to);
+    if (useParallelSort(end - from)) {
+      ForkJoinPool.commonPool().invoke
+        (new ParallelDoubleSort(array, new double[end], from, end));
+    } else {
+      quickSort(array, from, end - 1);
+    }
+    orderZeros(array, from, end);
+  }
+
+  public static <T extends Comparable<? super T>> void parallelSort
+    (T[] array)
+  {
+    parallelSort(array, 0, array.length, null);
+  }
+
+  public static <T> void parallelSort(T[] array,
+                                      Comparator<? super T> comparator)
+  {
+    parallelSort(array, 0, array.length, comparator);
+  }
+
+  public static <T> void parallelSort(T[] array, int from, int to,
+                                      Comparator<? super T> comparator)
+  {
+    checkRange(array.length, from, to);
+    Comparator c = comparator == null ? NaturalOrder : comparator;
+    if (useParallelSort(to - from)) {
+      ForkJoinPool.commonPool().invoke
+        (new ParallelObjectSort(array, new Object[to], c, from, to));
+    } else {
+      sort(array, from, to, c);
     }
   }
 
@@ -183,26 +183,17 @@ public class BitSet implements Serializable, Cloneable {
     if (pos >= bits.length) {
       return -1;
     }
-    int current = fromIndex;
-    do {
-      long currValue = bits[pos];
-      if (currValue == 0) {
-        pos++;
-        current = pos << BITS_PER_LONG_SHIFT;
-      } else {
-        do {
-          long bitPos = bitPosition(current);
-          if (((currValue & bitPos) != 0) ^ bitClear) {
-            return current;
-          } else {
-            current++;
-          }
-        } while (current % BITS_PER_LONG != 0);
+    // look for set bits either way, flipping the words when looking
+    // for clear ones
+    long flip = bitClear ? MASK : 0;
+    long word = (bits[pos] ^ flip) & (MASK << (fromIndex % BITS_PER_LONG));
+    while (word == 0) {
+      if (++ pos >= bits.length) {
+        return -1;
       }
-      pos++;
-    } while (pos < bits.length);
-
-    return -1;
+      word = bits[pos] ^ flip;
+    }
+    return (pos << BITS_PER_LONG_SHIFT) + Long.numberOfTrailingZeros(word);
   }
 
   public int nextClearBit(int fromIndex) {
@@ -211,8 +202,8 @@ public class BitSet implements Serializable, Cloneable {
 
   public int cardinality() {
     int numSetBits = 0;
-    for (int i = nextSetBit(0); i >= 0; i = nextSetBit(i+1)) {
-      ++numSetBits;
+    for (int i = 0; i < bits.length; i++) {
+      numSetBits += Long.bitCount(bits[i]);
     }
     
     return numSetBits;
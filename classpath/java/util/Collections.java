@@ -33,6 +33,21 @@ public class Collections {
     shuffle(list, new Random());
   }
 
+  public static <T extends Comparable<? super T>> void sort(List<T> list) {
+    sort(list, null);
+  }
+
+  public static <T> void sort(List<T> list, Comparator<? super T> comparator)
+  {
+    T[] array = (T[]) list.toArray();
+    Arrays.sort(array, comparator);
+
+    list.clear();
+    for (int i = 0; i < array.length; ++i) {
+      list.add(array[i]);
+    }
+  }
+
   static <T> T[] toArray(Collection collection, T[] array) {
     Class c = array.getClass().getComponentType();
 
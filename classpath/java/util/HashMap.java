@@ -12,16 +12,28 @@ package java.util;
 
 public class HashMap<K, V> implements Map<K, V> {
   private static final int MinimumCapacity = 16;
+  // a bucket holding more cells than this is kept as a red-black tree
+  // as well as a chain, once the array is long enough that growing it
+  // is unlikely to help
+  private static final int TreeThreshold = 8;
+  private static final int MinimumTreeCapacity = 64;
 
   private int size;
   private Cell[] array;
+  // the roots of buckets kept as trees, or null if there are none
+  private TreeCell[] roots;
+  private long sequence;
   private final Helper helper;
+  private final boolean treeable;
 
   public HashMap(int capacity, Helper<K, V> helper) {
     if (capacity > 0) {
-      array = new Cell[nextPowerOfTwo(capacity)];
+      array = new Cell[nextPowerOfTwo(capacity + (capacity / 3))];
     }
     this.helper = helper;
+    // cells made by other helpers, like WeakHashMap's, may lose their
+    // keys, which would change their order in a tree
+    this.treeable = helper.getClass() == MyHelper.class;
   }
 
   public HashMap(int capacity) {
@@ -49,6 +61,11 @@ public class HashMap<K, V> implements Map<K, V> {
     return r;
   }
 
+  private static int index(int hash, int length) {
+    // fold the high bits in, since only the low ones pick a bucket
+    return (hash ^ (hash >>> 16)) & (length - 1);
+  }
+
   public boolean isEmpty() {
     return size() == 0;
   }
@@ -58,13 +75,17 @@ public class HashMap<K, V> implements Map<K, V> {
   }
 
   private void grow() {
-    if (array == null || size >= array.length * 2) {
-      resize(array == null ? MinimumCapacity : array.length * 2);
+    if (array == null) {
+      resize(MinimumCapacity);
+    } else if (size > array.length - (array.length >>> 2)) {
+      resize(array.length * 2);
     }
   }
 
   private void shrink() {
-    if (array.length / 2 >= MinimumCapacity && size <= array.length / 3) {
+    // wait until the array is mostly empty, so a map which shrinks and
+    // grows by a few entries doesn't resize each time
+    if (array.length > MinimumCapacity && size < array.length >>> 3) {
       resize(array.length / 2);
     }
   }
@@ -83,7 +104,7 @@ public class HashMap<K, V> implements Map<K, V> {
           Cell<K, V> next;
           for (Cell<K, V> c = array[i]; c != null; c = next) {
             next = c.next();
-            int index = c.hashCode() & (capacity - 1);
+            int index = index(c.hashCode(), capacity);
             c.setNext(newArray[index]);
             newArray[index] = c;
           }
@@ -91,13 +112,75 @@ public class HashMap<K, V> implements Map<K, V> {
       }
     }
     array = newArray;
+    roots = null;
+
+    if (treeable && capacity >= MinimumTreeCapacity) {
+      for (int i = 0; i < capacity; ++i) {
+        if (crowded(i)) {
+          treeify(i);
+        }
+      }
+    }
+  }
+
+  private boolean crowded(int index) {
+    int length = 0;
+    for (Cell<K, V> c = array[index]; c != null; c = c.next()) {
+      if (++ length > TreeThreshold) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  private TreeCell<K, V> root(int index) {
+    return roots == null ? null : roots[index];
+  }
+
+  private void treeify(int index) {
+    if (roots == null) {
+      roots = new TreeCell[array.length];
+    }
+
+    TreeCell<K, V> root = null;
+    TreeCell<K, V> previous = null;
+    Cell<K, V> next;
+    for (Cell<K, V> c = array[index]; c != null; c = next) {
+      next = c.next();
+
+      TreeCell<K, V> t;
+      if (c instanceof TreeCell) {
+        t = (TreeCell<K, V>) c;
+      } else {
+        t = new TreeCell(c.getKey(), c.getValue(), c.hashCode(), sequence++);
+      }
+
+      t.prev = previous;
+      t.next = null;
+      if (previous == null) {
+        array[index] = t;
+      } else {
+        previous.next = t;
+      }
+      previous = t;
+
+      root = TreeCell.insert(root, t);
+      root.red = false;
+    }
+    roots[index] = root;
   }
 
   private Cell<K, V> find(Object key) {
     if (array != null) {
-      int index = helper.hash(key) & (array.length - 1);
+      int hash = helper.hash(key);
+      int index = index(hash, array.length);
+      TreeCell<K, V> root = root(index);
+      if (root != null) {
+        return findInTree(root, hash, key);
+      }
+
       for (Cell<K, V> c = array[index]; c != null; c = c.next()) {
-        if (helper.equal(key, c.getKey())) {
+        if (c.hashCode() == hash && helper.equal(key, c.getKey())) {
           return c;
         }
       }
@@ -106,38 +189,99 @@ public class HashMap<K, V> implements Map<K, V> {
     return null;
   }
 
-  private void insert(Cell<K, V> cell) {
+  private TreeCell<K, V> findInTree(TreeCell<K, V> n, int hash, Object key)
+  {
+    while (n != null) {
+      int difference = TreeCell.compare(hash, key, n.hashCode, n.key);
+      if (difference < 0) {
+        n = n.left;
+      } else if (difference > 0) {
+        n = n.right;
+      } else if (helper.equal(key, n.key)) {
+        return n;
+      } else {
+        // the order can't tell these keys apart, so look on both sides
+        TreeCell<K, V> found = findInTree(n.left, hash, key);
+        if (found != null) {
+          return found;
+        }
+        n = n.right;
+      }
+    }
+    return null;
+  }
+
+  private void insert(K key, V value, int hash) {
     ++ size;
 
     grow();
 
-    int index = cell.hashCode() & (array.length - 1);
-    cell.setNext(array[index]);
-    array[index] = cell;
-  }
+    int index = index(hash, array.length);
+    TreeCell<K, V> root = root(index);
+    if (root != null) {
+      TreeCell<K, V> cell = new TreeCell(key, value, hash, sequence++);
+      cell.next = array[index];
+      if (cell.next != null) {
+        ((TreeCell<K, V>) cell.next).prev = cell;
+      }
+      array[index] = cell;
 
-  public void remove(Cell<K, V> cell) {
-    int index = cell.hashCode() & (array.length - 1);
-    Cell<K, V> p = null;
-    for (Cell<K, V> c = array[index]; c != null; c = c.next()) {
-      if (c == cell) {
-        if (p == null) {
-          array[index] = c.next();
+      root = TreeCell.insert(root, cell);
+      root.red = false;
+      roots[index] = root;
+    } else {
+      array[index] = helper.make(key, value, array[index]);
+
+      if (treeable && crowded(index)) {
+        if (array.length < MinimumTreeCapacity) {
+          resize(array.length * 2);
         } else {
-          p.setNext(c.next());
+          treeify(index);
         }
-        -- size;
-        break;
       }
     }
+  }
+
+  // unlinks a cell from its bucket, given the cell before it in the
+  // chain, which is ignored if the bucket is a tree
+  private void unlink(int index, Cell<K, V> previous, Cell<K, V> cell) {
+    TreeCell<K, V> root = root(index);
+    if (root != null) {
+      TreeCell<K, V> t = (TreeCell<K, V>) cell;
+      previous = t.prev;
+      if (t.next != null) {
+        ((TreeCell<K, V>) t.next).prev = t.prev;
+      }
+      roots[index] = TreeCell.remove(root, t);
+    }
 
-    shrink();
+    if (previous == null) {
+      array[index] = cell.next();
+    } else {
+      previous.setNext(cell.next());
+    }
+    -- size;
+  }
+
+  public void remove(Cell<K, V> cell) {
+    if (array != null) {
+      int index = index(cell.hashCode(), array.length);
+      Cell<K, V> p = null;
+      for (Cell<K, V> c = array[index]; c != null; c = c.next()) {
+        if (c == cell) {
+          unlink(index, p, c);
+          shrink();
+          break;
+        }
+        p = c;
+      }
+    }
   }
 
   private Cell<K, V> putCell(K key, V value) {
     Cell<K, V> c = find(key);
     if (c == null) {
-      insert(helper.make(key, value, null));
+      insert(key, value, helper.hash(key));
     } else {
       c.setValue(value);
     }
@@ -170,23 +314,29 @@ public class HashMap<K, V> implements Map<K, V> {
   public Cell<K, V> removeCell(Object key) {
     Cell<K, V> old = null;
     if (array != null) {
-      int index = helper.hash(key) & (array.length - 1);
-      Cell<K, V> p = null;
-      for (Cell<K, V> c = array[index]; c != null; c = c.next()) {
-        if (helper.equal(key, c.getKey())) {
-          old = c;
-          if (p == null) {
-            array[index] = c.next();
-          } else {
-            p.setNext(c.next());
+      int hash = helper.hash(key);
+      int index = index(hash, array.length);
+      TreeCell<K, V> root = root(index);
+      if (root != null) {
+        old = findInTree(root, hash, key);
+        if (old != null) {
+          unlink(index, null, old);
+        }
+      } else {
+        Cell<K, V> p = null;
+        for (Cell<K, V> c = array[index]; c != null; c = c.next()) {
+          if (c.hashCode() == hash && helper.equal(key, c.getKey())) {
+            old = c;
+            unlink(index, p, c);
+            break;
           }
-          -- size;
-          break;
+          p = c;
         }
-        p = c;
       }
 
-      shrink();
+      if (old != null) {
+        shrink();
+      }
     }
     return old;
   }
@@ -194,7 +344,7 @@ public class HashMap<K, V> implements Map<K, V> {
   public V put(K key, V value) {
     Cell<K, V> c = find(key);
     if (c == null) {
-      insert(helper.make(key, value, null));
+      insert(key, value, helper.hash(key));
       return null;
     } else {
       V old = c.getValue();
@@ -216,6 +366,7 @@ public class HashMap<K, V> implements Map<K, V> {
 
   public void clear() {
     array = null;
+    roots = null;
     size = 0;
   }
 
@@ -289,6 +440,192 @@ public class HashMap<K, V> implements Map<K, V> {
     }
   }
 
+  // a cell in a bucket kept as a left-leaning red-black tree, ordered
+  // by compare and then by when the cell was added
+  private static class TreeCell<K, V> extends MyCell<K, V> {
+    public final long sequence;
+    public TreeCell<K, V> left;
+    public TreeCell<K, V> right;
+    public TreeCell<K, V> prev;
+    public boolean red;
+
+    public TreeCell(K key, V value, int hashCode, long sequence) {
+      super(key, value, null, hashCode);
+      this.sequence = sequence;
+    }
+
+    // orders keys by hash, then by class name, then naturally if they
+    // are comparable instances of the same class, returning zero if
+    // that doesn't tell them apart
+    public static int compare(int aHash, Object a, int bHash, Object b) {
+      if (aHash != bHash) {
+        return aHash < bHash ? -1 : 1;
+      } else if (a == null || b == null) {
+        return a == b ? 0 : (a == null ? -1 : 1);
+      } else if (a.getClass() != b.getClass()) {
+        return a.getClass().getName().compareTo(b.getClass().getName());
+      } else if (a instanceof Comparable) {
+        try {
+          return ((Comparable) a).compareTo(b);
+        } catch (ClassCastException e) {
+          // the class is only comparable to some other type
+          return 0;
+        }
+      } else {
+        return 0;
+      }
+    }
+
+    private static int order(TreeCell a, TreeCell b) {
+      int difference = compare(a.hashCode, a.key, b.hashCode, b.key);
+      if (difference != 0) {
+        return difference;
+      } else {
+        return a.sequence < b.sequence ? -1
+          : (a.sequence > b.sequence ? 1 : 0);
+      }
+    }
+
+    private static boolean isRed(TreeCell n) {
+      return n != null && n.red;
+    }
+
+    private static TreeCell rotateLeft(TreeCell h) {
+      TreeCell x = h.right;
+      h.right = x.left;
+      x.left = h;
+      x.red = h.red;
+      h.red = true;
+      return x;
+    }
+
+    private static TreeCell rotateRight(TreeCell h) {
+      TreeCell x = h.left;
+      h.left = x.right;
+      x.right = h;
+      x.red = h.red;
+      h.red = true;
+      return x;
+    }
+
+    private static void flip(TreeCell h) {
+      h.red = ! h.red;
+      h.left.red = ! h.left.red;
+      h.right.red = ! h.right.red;
+    }
+
+    private static TreeCell balance(TreeCell h) {
+      if (isRed(h.right) && ! isRed(h.left)) {
+        h = rotateLeft(h);
+      }
+      if (isRed(h.left) && isRed(h.left.left)) {
+        h = rotateRight(h);
+      }
+      if (isRed(h.left) && isRed(h.right)) {
+        flip(h);
+      }
+      return h;
+    }
+
+    private static TreeCell moveRedLeft(TreeCell h) {
+      flip(h);
+      if (isRed(h.right.left)) {
+        h.right = rotateRight(h.right);
+        h = rotateLeft(h);
+        flip(h);
+      }
+      return h;
+    }
+
+    private static TreeCell moveRedRight(TreeCell h) {
+      flip(h);
+      if (isRed(h.left.left)) {
+        h = rotateRight(h);
+        flip(h);
+      }
+      return h;
+    }
+
+    // returns the new root, which the caller must color black
+    public static TreeCell insert(TreeCell h, TreeCell cell) {
+      if (h == null) {
+        cell.left = null;
+        cell.right = null;
+        cell.red = true;
+        return cell;
+      }
+
+      if (order(cell, h) < 0) {
+        h.left = insert(h.left, cell);
+      } else {
+        h.right = insert(h.right, cell);
+      }
+      return balance(h);
+    }
+
+    private static TreeCell minimum(TreeCell h) {
+      while (h.left != null) {
+        h = h.left;
+      }
+      return h;
+    }
+
+    private static TreeCell removeMinimum(TreeCell h) {
+      if (h.left == null) {
+        return null;
+      }
+      if (! isRed(h.left) && ! isRed(h.left.left)) {
+        h = moveRedLeft(h);
+      }
+      h.left = removeMinimum(h.left);
+      return balance(h);
+    }
+
+    private static TreeCell removeCell(TreeCell h, TreeCell cell) {
+      if (order(cell, h) < 0) {
+        if (! isRed(h.left) && ! isRed(h.left.left)) {
+          h = moveRedLeft(h);
+        }
+        h.left = removeCell(h.left, cell);
+      } else {
+        if (isRed(h.left)) {
+          h = rotateRight(h);
+        }
+        if (h == cell && h.right == null) {
+          return null;
+        }
+        if (! isRed(h.right) && ! isRed(h.right.left)) {
+          h = moveRedRight(h);
+        }
+        if (h == cell) {
+          // cells are entries callers may hold, so put the successor
+          // in this one's place rather than copying its contents
+          TreeCell successor = minimum(h.right);
+          successor.right = removeMinimum(h.right);
+          successor.left = h.left;
+          successor.red = h.red;
+          h = successor;
+        } else {
+          h.right = removeCell(h.right, cell);
+        }
+      }
+      return balance(h);
+    }
+
+    // removes a cell from the tree rooted at root, returning the new
+    // root
+    public static TreeCell remove(TreeCell root, TreeCell cell) {
+      if (! isRed(root.left) && ! isRed(root.right)) {
+        root.red = true;
+      }
+      root = removeCell(root, cell);
+      if (root != null) {
+        root.red = false;
+      }
+      return root;
+    }
+  }
+
   static class MyHelper<K, V> implements Helper<K, V> {
     public Cell<K, V> make(K key, V value, Cell<K, V> next) {
       return new MyCell(key, value, next, hash(key));
@@ -491,16 +828,11 @@ public class HashMap<K, V> implements Map<K, V> {
 
     public void remove() {
       if (currentCell != null) {
-        if (previousCell == null) {
-          array[currentIndex] = currentCell.next();
-        } else {
-          previousCell.setNext(currentCell.next());
-          if (previousCell.next() == null) {
-            previousCell = null;
-          }
+        unlink(currentIndex, previousCell, currentCell);
+        if (previousCell != null && previousCell.next() == null) {
+          previousCell = null;
         }
         currentCell = null;
-        -- size;
       } else {
         throw new IllegalStateException();
       }
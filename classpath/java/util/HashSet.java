@@ -11,17 +11,15 @@
 package java.util;
 
 public class HashSet<T> extends AbstractSet<T> implements Set<T> {
-  private static final Object Value = new Object();
-
-  private final HashMap<T, Object> map;
+  private final OpenHashMap<T, Object> map;
 
   public HashSet(Collection<? extends T> c) {
-    map = new HashMap(c.size());
+    map = new OpenHashMap(c.size(), false);
     addAll(c);
   }
 
   public HashSet(int capacity) {
-    map = new HashMap(capacity);
+    map = new OpenHashMap(capacity, false);
   }
 
   public HashSet() {
@@ -41,7 +39,7 @@ public class HashSet<T> extends AbstractSet<T> implements Set<T> {
   }
 
   public boolean add(T element) {
-    return map.put(element, Value) != Value;
+    return map.add(element);
   }
 
   public boolean addAll(Collection<? extends T> collection) {
@@ -51,7 +49,7 @@ public class HashSet<T> extends AbstractSet<T> implements Set<T> {
   }
 
   public boolean remove(Object element) {
-    return map.remove(element) != Value;
+    return map.removeKey(element);
   }
 
   public void clear() {
@@ -59,30 +57,10 @@ public class HashSet<T> extends AbstractSet<T> implements Set<T> {
   }
 
   public Iterator<T> iterator() {
-    return new MyIterator(map.iterator());
+    return map.keyIterator();
   }
 
   public String toString() {
     return Collections.toString(this);
   }
-
-  private static class MyIterator<T> implements Iterator<T> {
-    private final Iterator<Map.Entry<T, Object>> it;
-
-    public MyIterator(Iterator<Map.Entry<T, Object>> it) {
-      this.it = it;
-    }
-
-    public T next() {
-      return it.next().getKey();
-    }
-
-    public boolean hasNext() {
-      return it.hasNext();
-    }
-
-    public void remove() {
-      it.remove();
-    }
-  }
 }
@@ -11,10 +11,10 @@
 package java.util;
 
 public class Hashtable<K, V> implements Map<K, V> {
-  private final HashMap<K, V> map;
+  private final OpenHashMap<K, V> map;
 
   public Hashtable(int capacity) {
-    map = new HashMap(capacity);
+    map = new OpenHashMap(capacity);
   }
 
   public Hashtable() {
@@ -10,74 +10,337 @@
 
 package java.util;
 
+// Keys and values are stored side by side in a single open-addressed
+// array probed linearly, so a lookup touches one or two cache lines
+// and no per-entry cell objects are allocated.
 public class IdentityHashMap<K, V> implements Map<K, V> {
-  private final HashMap<K, V> map;
+  private static final Object NullKey = new Object();
+  private static final int MinimumCapacity = 4;
+
+  private Object[] table;
+  private int size;
 
   public IdentityHashMap(int capacity) {
-    map = new HashMap(capacity, new MyHelper());
+    int n = MinimumCapacity;
+    // keep the table at most two thirds full
+    while (n * 2 < capacity * 3) {
+      n <<= 1;
+    }
+    table = new Object[n * 2];
   }
 
   public IdentityHashMap() {
     this(0);
   }
 
+  private static Object mask(Object key) {
+    return key == null ? NullKey : key;
+  }
+
+  private static Object unmask(Object key) {
+    return key == NullKey ? null : key;
+  }
+
+  private static int index(Object key, int length) {
+    int h = System.identityHashCode(key);
+    // consecutively allocated objects have nearby hashes; spread them so
+    // they don't form long probe runs
+    return ((h << 1) - (h << 8)) & (length - 1);
+  }
+
+  private static int nextIndex(int i, int length) {
+    return i + 2 < length ? i + 2 : 0;
+  }
+
+  private int find(Object key) {
+    Object[] table = this.table;
+    int i = index(key, table.length);
+    while (true) {
+      Object k = table[i];
+      if (k == key) {
+        return i;
+      } else if (k == null) {
+        return -1;
+      }
+      i = nextIndex(i, table.length);
+    }
+  }
+
   public boolean isEmpty() {
-    return map.isEmpty();
+    return size == 0;
   }
 
   public int size() {
-    return map.size();
+    return size;
   }
 
   public boolean containsKey(Object key) {
-    return map.containsKey(key);
+    return find(mask(key)) >= 0;
   }
 
   public boolean containsValue(Object value) {
-    return map.containsValue(value);
+    for (int i = 0; i < table.length; i += 2) {
+      if (table[i] != null && table[i + 1] == value) {
+        return true;
+      }
+    }
+    return false;
   }
 
   public V get(Object key) {
-    return map.get(key);
+    int i = find(mask(key));
+    return i < 0 ? null : (V) table[i + 1];
+  }
+
+  private void grow() {
+    Object[] old = table;
+    table = new Object[old.length * 2];
+    for (int i = 0; i < old.length; i += 2) {
+      Object k = old[i];
+      if (k != null) {
+        int j = index(k, table.length);
+        while (table[j] != null) {
+          j = nextIndex(j, table.length);
+        }
+        table[j] = k;
+        table[j + 1] = old[i + 1];
+      }
+    }
   }
 
   public V put(K key, V value) {
-    return map.put(key, value);
+    Object k = mask(key);
+    int i = index(k, table.length);
+    while (true) {
+      Object existing = table[i];
+      if (existing == k) {
+        V old = (V) table[i + 1];
+        table[i + 1] = value;
+        return old;
+      } else if (existing == null) {
+        break;
+      }
+      i = nextIndex(i, table.length);
+    }
+
+    table[i] = k;
+    table[i + 1] = value;
+    ++ size;
+
+    if (size * 3 > table.length) {
+      grow();
+    }
+    return null;
   }
 
   public void putAll(Map<? extends K,? extends V> elts) {
-    map.putAll(elts);
+    for (Map.Entry<? extends K, ? extends V> entry : elts.entrySet()) {
+      put(entry.getKey(), entry.getValue());
+    }
   }
 
   public V remove(Object key) {
-    return map.remove(key);
+    int i = find(mask(key));
+    if (i < 0) {
+      return null;
+    }
+
+    V old = (V) table[i + 1];
+    -- size;
+
+    // close the gap by moving back any later entry in this probe run
+    // which would no longer be reachable, rather than leaving a marker
+    int hole = i;
+    int j = nextIndex(i, table.length);
+    while (table[j] != null) {
+      int home = index(table[j], table.length);
+      boolean reachable = hole <= j
+        ? hole < home && home <= j
+        : hole < home || home <= j;
+
+      if (! reachable) {
+        table[hole] = table[j];
+        table[hole + 1] = table[j + 1];
+        hole = j;
+      }
+      j = nextIndex(j, table.length);
+    }
+    table[hole] = null;
+    table[hole + 1] = null;
+
+    return old;
   }
 
   public void clear() {
-    map.clear();
+    Arrays.fill(table, null);
+    size = 0;
   }
 
   public Set<Entry<K, V>> entrySet() {
-    return map.entrySet();
+    return new EntrySet();
   }
 
   public Set<K> keySet() {
-    return map.keySet();
+    return new KeySet();
   }
 
   public Collection<V> values() {
-    return map.values();
+    return new Values();
   }
 
-  private static class MyHelper<K, V>
-    extends HashMap.MyHelper<K, V>
-  {
-    public int hash(K a) {
-      return (a == null ? 0 : System.identityHashCode(a));
+  private class MyEntry implements Entry<K, V> {
+    private final K key;
+    private V value;
+
+    public MyEntry(K key, V value) {
+      this.key = key;
+      this.value = value;
     }
 
-    public boolean equal(K a, K b) {
-      return a == b;
-    }    
+    public K getKey() {
+      return key;
+    }
+
+    public V getValue() {
+      return value;
+    }
+
+    public V setValue(V value) {
+      this.value = value;
+      return put(key, value);
+    }
+
+    public boolean equals(Object o) {
+      return o instanceof Entry<?,?>
+        && ((Entry<?,?>) o).getKey() == key
+        && ((Entry<?,?>) o).getValue() == value;
+    }
+
+    public int hashCode() {
+      return System.identityHashCode(key) ^ System.identityHashCode(value);
+    }
+
+    public String toString() {
+      return key + "=" + value;
+    }
+  }
+
+  private class MyIterator implements Iterator<Entry<K, V>> {
+    // removing an entry may move a later one to an earlier slot, so
+    // once the iterator removes anything it finishes over a snapshot
+    private Object[] traversal = table;
+    private int nextIndex = advance(0);
+    private Object currentKey;
+
+    private int advance(int i) {
+      while (i < traversal.length && traversal[i] == null) {
+        i += 2;
+      }
+      return i;
+    }
+
+    public boolean hasNext() {
+      return nextIndex < traversal.length;
+    }
+
+    public Entry<K, V> next() {
+      if (! hasNext()) {
+        throw new NoSuchElementException();
+      }
+
+      currentKey = traversal[nextIndex];
+      Entry<K, V> e = new MyEntry
+        ((K) unmask(currentKey), (V) traversal[nextIndex + 1]);
+      nextIndex = advance(nextIndex + 2);
+      return e;
+    }
+
+    public void remove() {
+      if (currentKey == null) {
+        throw new IllegalStateException();
+      }
+
+      if (traversal == table) {
+        traversal = new Object[table.length];
+        System.arraycopy(table, 0, traversal, 0, table.length);
+      }
+      IdentityHashMap.this.remove(unmask(currentKey));
+      currentKey = null;
+    }
+  }
+
+  private class EntrySet extends AbstractSet<Entry<K, V>> {
+    public int size() {
+      return IdentityHashMap.this.size();
+    }
+
+    public boolean contains(Object o) {
+      if (o instanceof Entry<?,?>) {
+        Entry<?,?> e = (Entry<?,?>) o;
+        int i = find(mask(e.getKey()));
+        return i >= 0 && table[i + 1] == e.getValue();
+      }
+      return false;
+    }
+
+    public boolean remove(Object o) {
+      if (contains(o)) {
+        IdentityHashMap.this.remove(((Entry<?,?>) o).getKey());
+        return true;
+      }
+      return false;
+    }
+
+    public void clear() {
+      IdentityHashMap.this.clear();
+    }
+
+    public Iterator<Entry<K, V>> iterator() {
+      return new MyIterator();
+    }
+  }
+
+  private class KeySet extends AbstractSet<K> {
+    public int size() {
+      return IdentityHashMap.this.size();
+    }
+
+    public boolean contains(Object key) {
+      return containsKey(key);
+    }
+
+    public boolean remove(Object key) {
+      if (containsKey(key)) {
+        IdentityHashMap.this.remove(key);
+        return true;
+      }
+      return false;
+    }
+
+    public void clear() {
+      IdentityHashMap.this.clear();
+    }
+
+    public Iterator<K> iterator() {
+      return new Collections.KeyIterator(new MyIterator());
+    }
+  }
+
+  private class Values extends AbstractCollection<V> {
+    public int size() {
+      return IdentityHashMap.this.size();
+    }
+
+    public boolean contains(Object value) {
+      return containsValue(value);
+    }
+
+    public void clear() {
+      IdentityHashMap.this.clear();
+    }
+
+    public Iterator<V> iterator() {
+      return new Collections.ValueIterator(new MyIterator());
+    }
   }
 }
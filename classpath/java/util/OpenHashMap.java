@@ -0,0 +1,471 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util;
+
+// A map which keeps keys, values and their hashes in parallel arrays
+// probed linearly, so it allocates no per-entry objects.  If made
+// without values, it stores keys alone and every value reads as null,
+// which is all a set needs.
+class OpenHashMap<K, V> implements Map<K, V> {
+  private static final Object NullKey = new Object();
+  private static final int MinimumCapacity = 8;
+
+  private Object[] keys;
+  private Object[] values;
+  private int[] hashes;
+  private int size;
+  private final boolean hasValues;
+
+  public OpenHashMap(int capacity, boolean hasValues) {
+    this.hasValues = hasValues;
+    if (capacity > 0) {
+      allocate(capacityFor(capacity));
+    }
+  }
+
+  public OpenHashMap(int capacity) {
+    this(capacity, true);
+  }
+
+  public OpenHashMap() {
+    this(0);
+  }
+
+  public String toString() {
+    return Collections.toString(this);
+  }
+
+  // the smallest table which keeps size entries at most half full
+  private static int capacityFor(int size) {
+    int n = MinimumCapacity;
+    while (n < size * 2) {
+      n <<= 1;
+    }
+    return n;
+  }
+
+  private void allocate(int capacity) {
+    keys = new Object[capacity];
+    values = hasValues ? new Object[capacity] : null;
+    hashes = new int[capacity];
+  }
+
+  private static Object mask(Object key) {
+    return key == null ? NullKey : key;
+  }
+
+  private static Object unmask(Object key) {
+    return key == NullKey ? null : key;
+  }
+
+  private static int hash(Object key) {
+    return key == null ? 0 : key.hashCode();
+  }
+
+  private static int index(int hash, int length) {
+    // fold the high bits in, since only the low ones pick a slot
+    return (hash ^ (hash >>> 16)) & (length - 1);
+  }
+
+  private int find(Object key) {
+    Object[] keys = this.keys;
+    if (keys != null) {
+      Object k = mask(key);
+      int hash = hash(key);
+      for (int i = index(hash, keys.length);;
+           i = (i + 1) & (keys.length - 1))
+      {
+        Object o = keys[i];
+        if (o == null) {
+          return -1;
+        } else if (o == k || (hashes[i] == hash && k.equals(o))) {
+          return i;
+        }
+      }
+    }
+    return -1;
+  }
+
+  public boolean isEmpty() {
+    return size == 0;
+  }
+
+  public int size() {
+    return size;
+  }
+
+  public boolean containsKey(Object key) {
+    return find(key) >= 0;
+  }
+
+  public boolean containsValue(Object value) {
+    if (keys != null) {
+      for (int i = 0; i < keys.length; ++i) {
+        if (keys[i] != null) {
+          Object v = hasValues ? values[i] : null;
+          if (value == null ? v == null : value.equals(v)) {
+            return true;
+          }
+        }
+      }
+    }
+    return false;
+  }
+
+  public V get(Object key) {
+    int i = find(key);
+    return i < 0 || ! hasValues ? null : (V) values[i];
+  }
+
+  private void resize(int capacity) {
+    Object[] oldKeys = keys;
+    Object[] oldValues = values;
+    int[] oldHashes = hashes;
+
+    allocate(capacity);
+
+    if (oldKeys != null) {
+      for (int i = 0; i < oldKeys.length; ++i) {
+        if (oldKeys[i] != null) {
+          int j = index(oldHashes[i], capacity);
+          while (keys[j] != null) {
+            j = (j + 1) & (capacity - 1);
+          }
+          keys[j] = oldKeys[i];
+          hashes[j] = oldHashes[i];
+          if (hasValues) {
+            values[j] = oldValues[i];
+          }
+        }
+      }
+    }
+  }
+
+  // adds a key which is not yet in the map
+  private void insert(Object key, Object value) {
+    if (keys == null) {
+      allocate(MinimumCapacity);
+    } else if (size + 1 > keys.length - (keys.length >>> 2)) {
+      resize(keys.length * 2);
+    }
+
+    int hash = hash(key);
+    int i = index(hash, keys.length);
+    while (keys[i] != null) {
+      i = (i + 1) & (keys.length - 1);
+    }
+    keys[i] = mask(key);
+    hashes[i] = hash;
+    if (hasValues) {
+      values[i] = value;
+    }
+    ++ size;
+  }
+
+  public V put(K key, V value) {
+    int i = find(key);
+    if (i < 0) {
+      insert(key, value);
+      return null;
+    } else if (hasValues) {
+      V old = (V) values[i];
+      values[i] = value;
+      return old;
+    } else {
+      return null;
+    }
+  }
+
+  // adds a key, returning false if it was already present
+  public boolean add(K key) {
+    if (find(key) < 0) {
+      insert(key, null);
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  public void putAll(Map<? extends K,? extends V> elts) {
+    for (Map.Entry<? extends K, ? extends V> entry : elts.entrySet()) {
+      put(entry.getKey(), entry.getValue());
+    }
+  }
+
+  private void removeAt(int i) {
+    -- size;
+
+    // close the gap by moving back any later entry in this probe run
+    // which would no longer be reachable, rather than leaving a marker
+    int hole = i;
+    int j = (i + 1) & (keys.length - 1);
+    while (keys[j] != null) {
+      int home = index(hashes[j], keys.length);
+      boolean reachable = hole <= j
+        ? hole < home && home <= j
+        : hole < home || home <= j;
+
+      if (! reachable) {
+        keys[hole] = keys[j];
+        hashes[hole] = hashes[j];
+        if (hasValues) {
+          values[hole] = values[j];
+        }
+        hole = j;
+      }
+      j = (j + 1) & (keys.length - 1);
+    }
+    keys[hole] = null;
+    if (hasValues) {
+      values[hole] = null;
+    }
+
+    // halve the table once it is mostly empty, leaving enough room that
+    // a few more adds won't grow it again
+    if (keys.length > MinimumCapacity && size < keys.length >>> 3) {
+      resize(keys.length >>> 1);
+    }
+  }
+
+  public V remove(Object key) {
+    int i = find(key);
+    if (i < 0) {
+      return null;
+    }
+
+    V old = hasValues ? (V) values[i] : null;
+    removeAt(i);
+    return old;
+  }
+
+  // removes a key, returning false if it was not present
+  public boolean removeKey(Object key) {
+    int i = find(key);
+    if (i < 0) {
+      return false;
+    } else {
+      removeAt(i);
+      return true;
+    }
+  }
+
+  public void clear() {
+    keys = null;
+    values = null;
+    hashes = null;
+    size = 0;
+  }
+
+  public Set<Entry<K, V>> entrySet() {
+    return new EntrySet();
+  }
+
+  public Set<K> keySet() {
+    return new KeySet();
+  }
+
+  public Collection<V> values() {
+    return new Values();
+  }
+
+  // iterates over the keys without making an entry for each
+  Iterator<K> keyIterator() {
+    return new KeyIterator();
+  }
+
+  private class MyEntry implements Entry<K, V> {
+    private final K key;
+    private V value;
+
+    public MyEntry(K key, V value) {
+      this.key = key;
+      this.value = value;
+    }
+
+    public K getKey() {
+      return key;
+    }
+
+    public V getValue() {
+      return value;
+    }
+
+    public V setValue(V value) {
+      this.value = value;
+      return put(key, value);
+    }
+
+    public boolean equals(Object o) {
+      if (o instanceof Entry<?,?>) {
+        Entry<?,?> e = (Entry<?,?>) o;
+        return (key == null ? e.getKey() == null : key.equals(e.getKey()))
+          && (value == null
+              ? e.getValue() == null : value.equals(e.getValue()));
+      }
+      return false;
+    }
+
+    public int hashCode() {
+      return hash(key) ^ (value == null ? 0 : value.hashCode());
+    }
+
+    public String toString() {
+      return key + "=" + value;
+    }
+  }
+
+  private abstract class MyIterator<T> implements Iterator<T> {
+    // removing an entry may move a later one to an earlier slot, or
+    // shrink the table, so once the iterator removes anything it
+    // finishes over a snapshot
+    private Object[] traversalKeys = keys;
+    private Object[] traversalValues = values;
+    private int nextIndex = advance(0);
+    private Object currentKey;
+
+    protected abstract T make(K key, V value);
+
+    private int advance(int i) {
+      if (traversalKeys == null) {
+        return 0;
+      }
+      while (i < traversalKeys.length && traversalKeys[i] == null) {
+        ++ i;
+      }
+      return i;
+    }
+
+    public boolean hasNext() {
+      return traversalKeys != null && nextIndex < traversalKeys.length;
+    }
+
+    public T next() {
+      if (! hasNext()) {
+        throw new NoSuchElementException();
+      }
+
+      currentKey = traversalKeys[nextIndex];
+      T t = make((K) unmask(currentKey),
+                 hasValues ? (V) traversalValues[nextIndex] : null);
+      nextIndex = advance(nextIndex + 1);
+      return t;
+    }
+
+    public void remove() {
+      if (currentKey == null) {
+        throw new IllegalStateException();
+      }
+
+      if (traversalKeys == keys) {
+        traversalKeys = new Object[keys.length];
+        System.arraycopy(keys, 0, traversalKeys, 0, keys.length);
+        if (hasValues) {
+          traversalValues = new Object[values.length];
+          System.arraycopy(values, 0, traversalValues, 0, values.length);
+        }
+      }
+      removeKey(unmask(currentKey));
+      currentKey = null;
+    }
+  }
+
+  private class EntryIterator extends MyIterator<Entry<K, V>> {
+    protected Entry<K, V> make(K key, V value) {
+      return new MyEntry(key, value);
+    }
+  }
+
+  private class KeyIterator extends MyIterator<K> {
+    protected K make(K key, V value) {
+      return key;
+    }
+  }
+
+  private class ValueIterator extends MyIterator<V> {
+    protected V make(K key, V value) {
+      return value;
+    }
+  }
+
+  private class EntrySet extends AbstractSet<Entry<K, V>> {
+    public int size() {
+      return OpenHashMap.this.size();
+    }
+
+    public boolean contains(Object o) {
+      if (o instanceof Entry<?,?>) {
+        Entry<?,?> e = (Entry<?,?>) o;
+        int i = find(e.getKey());
+        if (i >= 0) {
+          Object v = hasValues ? values[i] : null;
+          return e.getValue() == null ? v == null : e.getValue().equals(v);
+        }
+      }
+      return false;
+    }
+
+    public boolean remove(Object o) {
+      if (contains(o)) {
+        removeKey(((Entry<?,?>) o).getKey());
+        return true;
+      }
+      return false;
+    }
+
+    public void clear() {
+      OpenHashMap.this.clear();
+    }
+
+    public Iterator<Entry<K, V>> iterator() {
+      return new EntryIterator();
+    }
+  }
+
+  private class KeySet extends AbstractSet<K> {
+    public int size() {
+      return OpenHashMap.this.size();
+    }
+
+    public boolean contains(Object key) {
+      return containsKey(key);
+    }
+
+    public boolean remove(Object key) {
+      return removeKey(key);
+    }
+
+    public void clear() {
+      OpenHashMap.this.clear();
+    }
+
+    public Iterator<K> iterator() {
+      return new KeyIterator();
+    }
+  }
+
+  private class Values extends AbstractCollection<V> {
+    public int size() {
+      return OpenHashMap.this.size();
+    }
+
+    public boolean contains(Object value) {
+      return containsValue(value);
+    }
+
+    public void clear() {
+      OpenHashMap.this.clear();
+    }
+
+    public Iterator<V> iterator() {
+      return new ValueIterator();
+    }
+  }
+}
@@ -0,0 +1,81 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.List;
+
+public abstract class AbstractExecutorService implements ExecutorService {
+  protected <T> RunnableFuture<T> newTaskFor(Callable<T> task) {
+    return new FutureTask<T>(task);
+  }
+
+  protected <T> RunnableFuture<T> newTaskFor(Runnable task, T result) {
+    return new FutureTask<T>(task, result);
+  }
+
+  public <T> Future<T> submit(Callable<T> task) {
+    if (task == null) throw new NullPointerException();
+
+    RunnableFuture<T> future = newTaskFor(task);
+    execute(future);
+    return future;
+  }
+
+  public <T> Future<T> submit(Runnable task, T result) {
+    if (task == null) throw new NullPointerException();
+
+    RunnableFuture<T> future = newTaskFor(task, result);
+    execute(future);
+    return future;
+  }
+
+  public Future<?> submit(Runnable task) {
+    return submit(task, null);
+  }
+
+  public <T> List<Future<T>> invokeAll(Collection<? extends Callable<T>> tasks)
+    throws InterruptedException
+  {
+    if (tasks == null) throw new NullPointerException();
+
+    List<Future<T>> futures = new ArrayList<Future<T>>(tasks.size());
+    boolean done = false;
+    try {
+      for (Callable<T> task: tasks) {
+        RunnableFuture<T> future = newTaskFor(task);
+        futures.add(future);
+        execute(future);
+      }
+
+      for (Future<T> future: futures) {
+        if (! future.isDone()) {
+          try {
+            future.get();
+          } catch (CancellationException e) {
+            // ignore
+          } catch (ExecutionException e) {
+            // ignore
+          }
+        }
+      }
+      done = true;
+      return futures;
+    } finally {
+      if (! done) {
+        for (Future<T> future: futures) {
+          future.cancel(true);
+        }
+      }
+    }
+  }
+}
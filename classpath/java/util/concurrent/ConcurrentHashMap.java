@@ -0,0 +1,763 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+import java.util.AbstractCollection;
+import java.util.AbstractMap;
+import java.util.AbstractSet;
+import java.util.Collection;
+import java.util.Iterator;
+import java.util.Map;
+import java.util.NoSuchElementException;
+import java.util.Set;
+import java.util.concurrent.locks.ReentrantLock;
+
+// The table is split into independently locked segments.  Writers
+// lock only the segment they modify, while readers take no lock at
+// all: entries are immutable apart from their values, so a reader
+// sees either the old or the new chain, and each segment's volatile
+// count is written after every update and read before every lookup.
+public class ConcurrentHashMap<K, V> extends AbstractMap<K, V>
+  implements ConcurrentMap<K, V>
+{
+  private static final int DefaultCapacity = 16;
+  private static final float DefaultLoadFactor = 0.75f;
+  private static final int DefaultConcurrency = 16;
+  private static final int MaximumCapacity = 1 << 30;
+  private static final int MaximumSegments = 1 << 16;
+  private static final int UnlockedSizeAttempts = 2;
+
+  private final Segment<K, V>[] segments;
+  private final int segmentShift;
+  private final int segmentMask;
+
+  private Set<K> keySet;
+  private Set<Map.Entry<K, V>> entrySet;
+  private Collection<V> values;
+
+  public ConcurrentHashMap(int capacity, float loadFactor, int concurrency) {
+    if (loadFactor <= 0 || capacity < 0 || concurrency <= 0) {
+      throw new IllegalArgumentException();
+    }
+
+    if (concurrency > MaximumSegments) {
+      concurrency = MaximumSegments;
+    }
+
+    int shift = 0;
+    int segmentCount = 1;
+    while (segmentCount < concurrency) {
+      ++ shift;
+      segmentCount <<= 1;
+    }
+    segmentShift = 32 - shift;
+    segmentMask = segmentCount - 1;
+    segments = new Segment[segmentCount];
+
+    if (capacity > MaximumCapacity) {
+      capacity = MaximumCapacity;
+    }
+
+    int perSegment = capacity / segmentCount;
+    if (perSegment * segmentCount < capacity) {
+      ++ perSegment;
+    }
+    int segmentCapacity = 1;
+    while (segmentCapacity < perSegment) {
+      segmentCapacity <<= 1;
+    }
+
+    for (int i = 0; i < segmentCount; ++i) {
+      segments[i] = new Segment<K, V>(segmentCapacity, loadFactor);
+    }
+  }
+
+  public ConcurrentHashMap(int capacity) {
+    this(capacity, DefaultLoadFactor, DefaultConcurrency);
+  }
+
+  public ConcurrentHashMap() {
+    this(DefaultCapacity, DefaultLoadFactor, DefaultConcurrency);
+  }
+
+  public ConcurrentHashMap(Map<? extends K, ? extends V> map) {
+    this(Math.max((int) (map.size() / DefaultLoadFactor) + 1,
+                  DefaultCapacity),
+         DefaultLoadFactor, DefaultConcurrency);
+    putAll(map);
+  }
+
+  // spreads the bits of a hash code so that both the segment index
+  // (from the high bits) and the bucket index (from the low bits) are
+  // well distributed
+  private static int hash(Object key) {
+    int h = key.hashCode();
+    h += (h << 15) ^ 0xffffcd7d;
+    h ^= (h >>> 10);
+    h += (h << 3);
+    h ^= (h >>> 6);
+    h += (h << 2) + (h << 14);
+    return h ^ (h >>> 16);
+  }
+
+  private Segment<K, V> segmentFor(int hash) {
+    return segments[(hash >>> segmentShift) & segmentMask];
+  }
+
+  public boolean isEmpty() {
+    Segment<K, V>[] segments = this.segments;
+    int[] modCounts = new int[segments.length];
+    int sum = 0;
+    for (int i = 0; i < segments.length; ++i) {
+      if (segments[i].count != 0) {
+        return false;
+      }
+      sum += modCounts[i] = segments[i].modCount;
+    }
+
+    // if any segment changed while we looked, it may have been
+    // non-empty at some point while we were looking at the others
+    if (sum != 0) {
+      for (int i = 0; i < segments.length; ++i) {
+        if (segments[i].count != 0 || modCounts[i] != segments[i].modCount) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  public int size() {
+    Segment<K, V>[] segments = this.segments;
+    int[] modCounts = new int[segments.length];
+
+    for (int attempt = 0; attempt < UnlockedSizeAttempts; ++attempt) {
+      long sum = 0;
+      int modSum = 0;
+      for (int i = 0; i < segments.length; ++i) {
+        sum += segments[i].count;
+        modSum += modCounts[i] = segments[i].modCount;
+      }
+
+      boolean consistent = true;
+      if (modSum != 0) {
+        long check = 0;
+        for (int i = 0; i < segments.length; ++i) {
+          check += segments[i].count;
+          if (modCounts[i] != segments[i].modCount) {
+            consistent = false;
+            break;
+          }
+        }
+        consistent = consistent && check == sum;
+      }
+
+      if (consistent) {
+        return sum > Integer.MAX_VALUE ? Integer.MAX_VALUE : (int) sum;
+      }
+    }
+
+    // the map kept changing underneath us, so count it with every
+    // segment locked
+    long sum = 0;
+    for (int i = 0; i < segments.length; ++i) {
+      segments[i].lock();
+    }
+    try {
+      for (int i = 0; i < segments.length; ++i) {
+        sum += segments[i].count;
+      }
+    } finally {
+      for (int i = 0; i < segments.length; ++i) {
+        segments[i].unlock();
+      }
+    }
+    return sum > Integer.MAX_VALUE ? Integer.MAX_VALUE : (int) sum;
+  }
+
+  public V get(Object key) {
+    int hash = hash(key);
+    return segmentFor(hash).get(key, hash);
+  }
+
+  public boolean containsKey(Object key) {
+    int hash = hash(key);
+    return segmentFor(hash).containsKey(key, hash);
+  }
+
+  public boolean containsValue(Object value) {
+    if (value == null) throw new NullPointerException();
+
+    for (int i = 0; i < segments.length; ++i) {
+      if (segments[i].containsValue(value)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  public boolean contains(Object value) {
+    return containsValue(value);
+  }
+
+  public V put(K key, V value) {
+    if (value == null) throw new NullPointerException();
+
+    int hash = hash(key);
+    return segmentFor(hash).put(key, hash, value, false);
+  }
+
+  public V putIfAbsent(K key, V value) {
+    if (value == null) throw new NullPointerException();
+
+    int hash = hash(key);
+    return segmentFor(hash).put(key, hash, value, true);
+  }
+
+  public void putAll(Map<? extends K, ? extends V> map) {
+    for (Map.Entry<? extends K, ? extends V> e: map.entrySet()) {
+      put(e.getKey(), e.getValue());
+    }
+  }
+
+  public V remove(Object key) {
+    int hash = hash(key);
+    return segmentFor(hash).remove(key, hash, null);
+  }
+
+  public boolean remove(Object key, Object value) {
+    int hash = hash(key);
+    return value != null && segmentFor(hash).remove(key, hash, value) != null;
+  }
+
+  public boolean replace(K key, V oldValue, V newValue) {
+    if (oldValue == null || newValue == null) {
+      throw new NullPointerException();
+    }
+
+    int hash = hash(key);
+    return segmentFor(hash).replace(key, hash, oldValue, newValue);
+  }
+
+  public V replace(K key, V value) {
+    if (value == null) throw new NullPointerException();
+
+    int hash = hash(key);
+    return segmentFor(hash).replace(key, hash, value);
+  }
+
+  public void clear() {
+    for (int i = 0; i < segments.length; ++i) {
+      segments[i].clear();
+    }
+  }
+
+  public Set<K> keySet() {
+    Set<K> set = keySet;
+    return set != null ? set : (keySet = new KeySet());
+  }
+
+  public Collection<V> values() {
+    Collection<V> collection = values;
+    return collection != null ? collection : (values = new Values());
+  }
+
+  public Set<Map.Entry<K, V>> entrySet() {
+    Set<Map.Entry<K, V>> set = entrySet;
+    return set != null ? set : (entrySet = new EntrySet());
+  }
+
+  public String toString() {
+    StringBuilder sb = new StringBuilder();
+    sb.append("{");
+    for (Iterator<Map.Entry<K, V>> it = entrySet().iterator();
+         it.hasNext();)
+    {
+      Map.Entry<K, V> e = it.next();
+      sb.append(e.getKey()).append("=").append(e.getValue());
+      if (it.hasNext()) {
+        sb.append(", ");
+      }
+    }
+    sb.append("}");
+    return sb.toString();
+  }
+
+  private static class HashEntry<K, V> {
+    public final K key;
+    public final int hash;
+    public volatile V value;
+    public final HashEntry<K, V> next;
+
+    public HashEntry(K key, int hash, HashEntry<K, V> next, V value) {
+      this.key = key;
+      this.hash = hash;
+      this.next = next;
+      this.value = value;
+    }
+  }
+
+  private static class Segment<K, V> extends ReentrantLock {
+    // number of entries, written last by every update so that reads
+    // which first read it see a consistent table
+    public volatile int count;
+    // number of structural changes, used to detect concurrent updates
+    // when summing over segments without locking
+    public int modCount;
+    private int threshold;
+    private volatile HashEntry<K, V>[] table;
+    private final float loadFactor;
+
+    public Segment(int capacity, float loadFactor) {
+      this.loadFactor = loadFactor;
+      setTable(new HashEntry[capacity]);
+    }
+
+    private void setTable(HashEntry<K, V>[] table) {
+      threshold = (int) (table.length * loadFactor);
+      this.table = table;
+    }
+
+    private HashEntry<K, V> first(int hash) {
+      HashEntry<K, V>[] table = this.table;
+      return table[hash & (table.length - 1)];
+    }
+
+    // a reader can only see a null value if the entry's constructor
+    // was reordered with its publication, so check again with the lock
+    // held
+    private V readValueUnderLock(HashEntry<K, V> e) {
+      lock();
+      try {
+        return e.value;
+      } finally {
+        unlock();
+      }
+    }
+
+    public V get(Object key, int hash) {
+      if (count != 0) {
+        for (HashEntry<K, V> e = first(hash); e != null; e = e.next) {
+          if (e.hash == hash && key.equals(e.key)) {
+            V v = e.value;
+            return v != null ? v : readValueUnderLock(e);
+          }
+        }
+      }
+      return null;
+    }
+
+    public boolean containsKey(Object key, int hash) {
+      if (count != 0) {
+        for (HashEntry<K, V> e = first(hash); e != null; e = e.next) {
+          if (e.hash == hash && key.equals(e.key)) {
+            return true;
+          }
+        }
+      }
+      return false;
+    }
+
+    public boolean containsValue(Object value) {
+      if (count != 0) {
+        HashEntry<K, V>[] table = this.table;
+        for (int i = 0; i < table.length; ++i) {
+          for (HashEntry<K, V> e = table[i]; e != null; e = e.next) {
+            V v = e.value;
+            if (v == null) {
+              v = readValueUnderLock(e);
+            }
+            if (value.equals(v)) {
+              return true;
+            }
+          }
+        }
+      }
+      return false;
+    }
+
+    public boolean replace(K key, int hash, V oldValue, V newValue) {
+      lock();
+      try {
+        HashEntry<K, V> e = first(hash);
+        while (e != null && (e.hash != hash || ! key.equals(e.key))) {
+          e = e.next;
+        }
+
+        if (e != null && oldValue.equals(e.value)) {
+          e.value = newValue;
+          return true;
+        } else {
+          return false;
+        }
+      } finally {
+        unlock();
+      }
+    }
+
+    public V replace(K key, int hash, V value) {
+      lock();
+      try {
+        HashEntry<K, V> e = first(hash);
+        while (e != null && (e.hash != hash || ! key.equals(e.key))) {
+          e = e.next;
+        }
+
+        if (e != null) {
+          V old = e.value;
+          e.value = value;
+          return old;
+        } else {
+          return null;
+        }
+      } finally {
+        unlock();
+      }
+    }
+
+    public V put(K key, int hash, V value, boolean onlyIfAbsent) {
+      lock();
+      try {
+        int c = count;
+        if (c++ > threshold) {
+          rehash();
+        }
+
+        HashEntry<K, V>[] table = this.table;
+        int index = hash & (table.length - 1);
+        HashEntry<K, V> first = table[index];
+        HashEntry<K, V> e = first;
+        while (e != null && (e.hash != hash || ! key.equals(e.key))) {
+          e = e.next;
+        }
+
+        if (e != null) {
+          V old = e.value;
+          if (! onlyIfAbsent) {
+            e.value = value;
+          }
+          return old;
+        } else {
+          ++ modCount;
+          table[index] = new HashEntry<K, V>(key, hash, first, value);
+          count = c;
+          return null;
+        }
+      } finally {
+        unlock();
+      }
+    }
+
+    // called with the lock held.  Readers may be traversing the old
+    // table concurrently, so existing entries are never modified;
+    // instead, each chain is split by reusing its longest tail which
+    // maps to a single new bucket and cloning the nodes before it.
+    private void rehash() {
+      HashEntry<K, V>[] oldTable = table;
+      int oldCapacity = oldTable.length;
+      if (oldCapacity >= MaximumCapacity) {
+        return;
+      }
+
+      HashEntry<K, V>[] newTable = new HashEntry[oldCapacity << 1];
+      int mask = newTable.length - 1;
+      for (int i = 0; i < oldCapacity; ++i) {
+        HashEntry<K, V> e = oldTable[i];
+        if (e != null) {
+          HashEntry<K, V> next = e.next;
+          int index = e.hash & mask;
+
+          if (next == null) {
+            newTable[index] = e;
+          } else {
+            HashEntry<K, V> lastRun = e;
+            int lastIndex = index;
+            for (HashEntry<K, V> last = next; last != null; last = last.next) {
+              int k = last.hash & mask;
+              if (k != lastIndex) {
+                lastIndex = k;
+                lastRun = last;
+              }
+            }
+            newTable[lastIndex] = lastRun;
+
+            for (HashEntry<K, V> p = e; p != lastRun; p = p.next) {
+              int k = p.hash & mask;
+              newTable[k] = new HashEntry<K, V>
+                (p.key, p.hash, newTable[k], p.value);
+            }
+          }
+        }
+      }
+      setTable(newTable);
+    }
+
+    // removes the entry for key if its value matches the specified one,
+    // or unconditionally if value is null
+    public V remove(Object key, int hash, Object value) {
+      lock();
+      try {
+        int c = count - 1;
+        HashEntry<K, V>[] table = this.table;
+        int index = hash & (table.length - 1);
+        HashEntry<K, V> first = table[index];
+        HashEntry<K, V> e = first;
+        while (e != null && (e.hash != hash || ! key.equals(e.key))) {
+          e = e.next;
+        }
+
+        if (e != null) {
+          V old = e.value;
+          if (value == null || value.equals(old)) {
+            // entries are immutable, so the nodes ahead of the removed
+            // one are copied rather than relinked
+            ++ modCount;
+            HashEntry<K, V> newFirst = e.next;
+            for (HashEntry<K, V> p = first; p != e; p = p.next) {
+              newFirst = new HashEntry<K, V>(p.key, p.hash, newFirst, p.value);
+            }
+            table[index] = newFirst;
+            count = c;
+            return old;
+          }
+        }
+        return null;
+      } finally {
+        unlock();
+      }
+    }
+
+    public void clear() {
+      if (count != 0) {
+        lock();
+        try {
+          HashEntry<K, V>[] table = this.table;
+          for (int i = 0; i < table.length; ++i) {
+            table[i] = null;
+          }
+          ++ modCount;
+          count = 0;
+        } finally {
+          unlock();
+        }
+      }
+    }
+  }
+
+  // weakly consistent: reflects some, but not necessarily all, of the
+  // updates made after the iterator was created, and never throws
+  // ConcurrentModificationException
+  private abstract class HashIterator {
+    private int segmentIndex = segments.length - 1;
+    private int tableIndex = -1;
+    private HashEntry<K, V>[] table;
+    private HashEntry<K, V> next;
+    private HashEntry<K, V> last;
+
+    public HashIterator() {
+      advance();
+    }
+
+    private void advance() {
+      if (next != null && (next = next.next) != null) {
+        return;
+      }
+
+      while (tableIndex >= 0) {
+        if ((next = table[tableIndex--]) != null) {
+          return;
+        }
+      }
+
+      while (segmentIndex >= 0) {
+        Segment<K, V> segment = segments[segmentIndex--];
+        if (segment.count != 0) {
+          table = segment.table;
+          for (tableIndex = table.length - 1; tableIndex >= 0;) {
+            if ((next = table[tableIndex--]) != null) {
+              return;
+            }
+          }
+        }
+      }
+    }
+
+    public boolean hasNext() {
+      return next != null;
+    }
+
+    protected HashEntry<K, V> nextEntry() {
+      if (next == null) throw new NoSuchElementException();
+
+      last = next;
+      advance();
+      return last;
+    }
+
+    public void remove() {
+      if (last == null) throw new IllegalStateException();
+
+      ConcurrentHashMap.this.remove(last.key);
+      last = null;
+    }
+  }
+
+  private class KeyIterator extends HashIterator implements Iterator<K> {
+    public K next() {
+      return nextEntry().key;
+    }
+  }
+
+  private class ValueIterator extends HashIterator implements Iterator<V> {
+    public V next() {
+      return nextEntry().value;
+    }
+  }
+
+  private class EntryIterator extends HashIterator
+    implements Iterator<Map.Entry<K, V>>
+  {
+    public Map.Entry<K, V> next() {
+      HashEntry<K, V> e = nextEntry();
+      return new MyEntry(e.key, e.value);
+    }
+  }
+
+  // a snapshot of a mapping which writes any change through to the map
+  private class MyEntry implements Map.Entry<K, V> {
+    private final K key;
+    private V value;
+
+    public MyEntry(K key, V value) {
+      this.key = key;
+      this.value = value;
+    }
+
+    public K getKey() {
+      return key;
+    }
+
+    public V getValue() {
+      return value;
+    }
+
+    public V setValue(V value) {
+      if (value == null) throw new NullPointerException();
+
+      V old = this.value;
+      this.value = value;
+      put(key, value);
+      return old;
+    }
+
+    public boolean equals(Object o) {
+      if (o instanceof Map.Entry) {
+        Map.Entry e = (Map.Entry) o;
+        return key.equals(e.getKey()) && value.equals(e.getValue());
+      } else {
+        return false;
+      }
+    }
+
+    public int hashCode() {
+      return key.hashCode() ^ value.hashCode();
+    }
+
+    public String toString() {
+      return key + "=" + value;
+    }
+  }
+
+  private class KeySet extends AbstractSet<K> {
+    public Iterator<K> iterator() {
+      return new KeyIterator();
+    }
+
+    public int size() {
+      return ConcurrentHashMap.this.size();
+    }
+
+    public boolean isEmpty() {
+      return ConcurrentHashMap.this.isEmpty();
+    }
+
+    public boolean contains(Object key) {
+      return containsKey(key);
+    }
+
+    public boolean remove(Object key) {
+      return ConcurrentHashMap.this.remove(key) != null;
+    }
+
+    public void clear() {
+      ConcurrentHashMap.this.clear();
+    }
+  }
+
+  private class Values extends AbstractCollection<V> {
+    public Iterator<V> iterator() {
+      return new ValueIterator();
+    }
+
+    public int size() {
+      return ConcurrentHashMap.this.size();
+    }
+
+    public boolean isEmpty() {
+      return ConcurrentHashMap.this.isEmpty();
+    }
+
+    public boolean contains(Object value) {
+      return containsValue(value);
+    }
+
+    public void clear() {
+      ConcurrentHashMap.this.clear();
+    }
+  }
+
+  private class EntrySet extends AbstractSet<Map.Entry<K, V>> {
+    public Iterator<Map.Entry<K, V>> iterator() {
+      return new EntryIterator();
+    }
+
+    public int size() {
+      return ConcurrentHashMap.this.size();
+    }
+
+    public boolean isEmpty() {
+      return ConcurrentHashMap.this.isEmpty();
+    }
+
+    public boolean contains(Object o) {
+      if (o instanceof Map.Entry) {
+        Map.Entry e = (Map.Entry) o;
+        V v = get(e.getKey());
+        return v != null && v.equals(e.getValue());
+      } else {
+        return false;
+      }
+    }
+
+    public boolean remove(Object o) {
+      if (o instanceof Map.Entry) {
+        Map.Entry e = (Map.Entry) o;
+        return ConcurrentHashMap.this.remove(e.getKey(), e.getValue());
+      } else {
+        return false;
+      }
+    }
+
+    public void clear() {
+      ConcurrentHashMap.this.clear();
+    }
+  }
+}
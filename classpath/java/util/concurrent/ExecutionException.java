@@ -0,0 +1,29 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+public class ExecutionException extends Exception {
+  public ExecutionException(String message, Throwable cause) {
+    super(message, cause);
+  }
+
+  public ExecutionException(String message) {
+    this(message, null);
+  }
+
+  public ExecutionException(Throwable cause) {
+    this(null, cause);
+  }
+
+  public ExecutionException() {
+    this(null, null);
+  }
+}
@@ -0,0 +1,102 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+import java.util.concurrent.atomic.AtomicInteger;
+
+public class Executors {
+  private static final AtomicInteger poolCount = new AtomicInteger();
+
+  private Executors() { }
+
+  public static ExecutorService newFixedThreadPool(int threadCount) {
+    return new ThreadPoolExecutor
+      (threadCount, threadCount, 0, TimeUnit.MILLISECONDS,
+       new LinkedBlockingQueue<Runnable>());
+  }
+
+  public static ExecutorService newFixedThreadPool(int threadCount,
+                                                   ThreadFactory factory)
+  {
+    return new ThreadPoolExecutor
+      (threadCount, threadCount, 0, TimeUnit.MILLISECONDS,
+       new LinkedBlockingQueue<Runnable>(), factory);
+  }
+
+  public static ExecutorService newSingleThreadExecutor() {
+    return newFixedThreadPool(1);
+  }
+
+  public static ExecutorService newSingleThreadExecutor
+    (ThreadFactory factory)
+  {
+    return newFixedThreadPool(1, factory);
+  }
+
+  public static ScheduledExecutorService newScheduledThreadPool
+    (int corePoolSize)
+  {
+    return new ScheduledThreadPoolExecutor(corePoolSize);
+  }
+
+  public static ScheduledExecutorService newScheduledThreadPool
+    (int corePoolSize, ThreadFactory factory)
+  {
+    return new ScheduledThreadPoolExecutor(corePoolSize, factory);
+  }
+
+  public static ScheduledExecutorService newSingleThreadScheduledExecutor() {
+    return newScheduledThreadPool(1);
+  }
+
+  public static ScheduledExecutorService newSingleThreadScheduledExecutor
+    (ThreadFactory factory)
+  {
+    return newScheduledThreadPool(1, factory);
+  }
+
+  public static ThreadFactory defaultThreadFactory() {
+    return new DefaultThreadFactory();
+  }
+
+  public static <T> Callable<T> callable(final Runnable task, final T result)
+  {
+    if (task == null) throw new NullPointerException();
+
+    return new Callable<T>() {
+      public T call() {
+        task.run();
+        return result;
+      }
+    };
+  }
+
+  public static Callable<Object> callable(Runnable task) {
+    return callable(task, null);
+  }
+
+  private static class DefaultThreadFactory implements ThreadFactory {
+    private final AtomicInteger threadCount = new AtomicInteger();
+    private final String prefix
+      = "pool-" + poolCount.incrementAndGet() + "-thread-";
+
+    public Thread newThread(Runnable task) {
+      Thread t = new Thread(task, prefix + threadCount.incrementAndGet());
+      if (t.isDaemon()) {
+        t.setDaemon(false);
+      }
+      if (t.getPriority() != Thread.NORM_PRIORITY) {
+        t.setPriority(Thread.NORM_PRIORITY);
+      }
+      return t;
+    }
+  }
+}
@@ -0,0 +1,469 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.atomic.AtomicInteger;
+import sun.misc.Unsafe;
+
+// Each worker owns a Chase-Lev deque: it pushes and pops forked tasks
+// at the bottom without locking, while idle workers steal from the
+// top, picking victims at random so that thieves spread out instead
+// of all contending for the same deque.  Tasks submitted from outside
+// the pool go through a shared queue.
+//
+// Every Avian thread carries its own native stack and allocation
+// state, so workers are started lazily, only when there is work for
+// them, and park (rather than spin) once they find nothing to do.
+public class ForkJoinPool extends AbstractExecutorService {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+  private static final long topOffset;
+  private static final long parkedOffset;
+
+  static {
+    try {
+      topOffset = unsafe.objectFieldOffset
+        (WorkQueue.class.getDeclaredField("top"));
+      parkedOffset = unsafe.objectFieldOffset
+        (ForkJoinWorkerThread.class.getDeclaredField("parked"));
+    } catch (NoSuchFieldException e) {
+      throw new Error(e);
+    }
+  }
+
+  private static final int Running = 0;
+  private static final int Shutdown = 1;
+  private static final int Stop = 2;
+  private static final int Terminated = 3;
+
+  private static final AtomicInteger poolCount = new AtomicInteger();
+  private static ForkJoinPool commonPool;
+
+  private final int parallelism;
+  private final String prefix;
+
+  // filled in order by addWorker; entries below startedCount are
+  // never null
+  private final ForkJoinWorkerThread[] workers;
+  private volatile int startedCount;
+  private final AtomicInteger liveCount = new AtomicInteger();
+  private final AtomicInteger idleCount = new AtomicInteger();
+
+  private final ConcurrentLinkedQueue<ForkJoinTask<?>> submissions
+    = new ConcurrentLinkedQueue();
+
+  private volatile int runState;
+
+  public ForkJoinPool(int parallelism) {
+    if (parallelism <= 0) throw new IllegalArgumentException();
+
+    this.parallelism = parallelism;
+    this.workers = new ForkJoinWorkerThread[parallelism];
+    this.prefix = "ForkJoinPool-" + poolCount.incrementAndGet() + "-worker-";
+  }
+
+  public ForkJoinPool() {
+    this(Runtime.getRuntime().availableProcessors());
+  }
+
+  public static synchronized ForkJoinPool commonPool() {
+    if (commonPool == null) {
+      commonPool = new ForkJoinPool();
+    }
+    return commonPool;
+  }
+
+  public int getParallelism() {
+    return parallelism;
+  }
+
+  public int getPoolSize() {
+    return liveCount.get();
+  }
+
+  public long getStealCount() {
+    long n = 0;
+    for (int i = 0; i < startedCount; ++i) {
+      n += workers[i].stealCount;
+    }
+    return n;
+  }
+
+  public boolean hasQueuedSubmissions() {
+    return submissions.peek() != null;
+  }
+
+  private boolean addWorker() {
+    ForkJoinWorkerThread w;
+    synchronized (this) {
+      int n = startedCount;
+      if (n >= parallelism || runState != Running) {
+        return false;
+      }
+
+      w = new ForkJoinWorkerThread(this, n, prefix + (n + 1));
+      workers[n] = w;
+      liveCount.incrementAndGet();
+      startedCount = n + 1;
+    }
+
+    w.start();
+    return true;
+  }
+
+  // wakes an idle worker or, if there are none, starts a new one
+  private void signalWork() {
+    if (idleCount.get() > 0) {
+      for (int i = 0; i < startedCount; ++i) {
+        ForkJoinWorkerThread w = workers[i];
+        if (w.parked != 0
+            && unsafe.compareAndSwapInt(w, parkedOffset, 1, 0))
+        {
+          unsafe.unpark(w);
+          return;
+        }
+      }
+    }
+
+    if (startedCount < parallelism) {
+      addWorker();
+    }
+  }
+
+  void push(ForkJoinWorkerThread w, ForkJoinTask<?> task) {
+    w.queue.push(task);
+    if (idleCount.get() > 0 || startedCount < parallelism) {
+      signalWork();
+    }
+  }
+
+  void externalPush(ForkJoinTask<?> task) {
+    if (task == null) throw new NullPointerException();
+
+    if (runState != Running) {
+      throw new RejectedExecutionException();
+    }
+
+    Thread t = Thread.currentThread();
+    if (t instanceof ForkJoinWorkerThread
+        && ((ForkJoinWorkerThread) t).pool == this)
+    {
+      push((ForkJoinWorkerThread) t, task);
+    } else {
+      submissions.add(task);
+      signalWork();
+    }
+  }
+
+  private ForkJoinTask<?> scan(ForkJoinWorkerThread w) {
+    ForkJoinTask<?> task = submissions.poll();
+    if (task != null) {
+      return task;
+    }
+
+    int n = startedCount;
+    if (n > 1) {
+      int r = w.seed;
+      r ^= r << 13;
+      r ^= r >>> 17;
+      r ^= r << 5;
+      w.seed = r;
+
+      int start = (r & Integer.MAX_VALUE) % n;
+      for (int i = 0; i < n; ++i) {
+        ForkJoinWorkerThread victim = workers[(start + i) % n];
+        if (victim != w) {
+          task = victim.queue.steal();
+          if (task != null) {
+            ++ w.stealCount;
+            return task;
+          }
+        }
+      }
+    }
+    return null;
+  }
+
+  private boolean hasQueuedTasks() {
+    if (submissions.peek() != null) {
+      return true;
+    }
+
+    for (int i = 0; i < startedCount; ++i) {
+      if (! workers[i].queue.isEmpty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // returns false if the worker should exit
+  private boolean awaitWork(ForkJoinWorkerThread w) {
+    w.parked = 1;
+    idleCount.incrementAndGet();
+    try {
+      // anything queued after we announced ourselves as idle will
+      // cause us to be woken, but we must check for anything queued
+      // before
+      if (hasQueuedTasks()) {
+        return true;
+      } else if (runState != Running) {
+        return false;
+      }
+
+      while (w.parked != 0 && runState == Running) {
+        unsafe.park(false, 0L);
+        Thread.interrupted();
+      }
+      return true;
+    } finally {
+      w.parked = 0;
+      idleCount.decrementAndGet();
+    }
+  }
+
+  void runWorker(ForkJoinWorkerThread w) {
+    WorkQueue queue = w.queue;
+    try {
+      while (runState < Stop) {
+        ForkJoinTask<?> task = queue.pop();
+        if (task == null) {
+          task = scan(w);
+        }
+
+        if (task != null) {
+          task.doExec();
+        } else if (! awaitWork(w)) {
+          break;
+        }
+      }
+
+      ForkJoinTask<?> task;
+      while ((task = queue.pop()) != null) {
+        task.cancel(false);
+      }
+    } finally {
+      if (liveCount.decrementAndGet() == 0 && runState != Running) {
+        terminate();
+      }
+    }
+  }
+
+  // runs other tasks while waiting for the specified one, blocking
+  // only when there is nothing left to help with
+  int awaitJoin(ForkJoinWorkerThread w, ForkJoinTask<?> task) {
+    int s;
+    while ((s = task.status()) >= 0) {
+      ForkJoinTask<?> t = w.queue.pop();
+      if (t == null) {
+        t = scan(w);
+      }
+
+      if (t != null) {
+        t.doExec();
+      } else {
+        // our own deque is empty, so nothing we're waiting for can be
+        // stuck behind us
+        try {
+          task.awaitDone(false, false, 0);
+        } catch (InterruptedException e) {
+          throw new AssertionError();
+        }
+      }
+    }
+    return s;
+  }
+
+  private synchronized void terminate() {
+    if (runState != Terminated) {
+      runState = Terminated;
+      notifyAll();
+    }
+  }
+
+  private void wakeAll() {
+    for (int i = 0; i < startedCount; ++i) {
+      ForkJoinWorkerThread w = workers[i];
+      if (w.parked != 0) {
+        w.parked = 0;
+        unsafe.unpark(w);
+      }
+    }
+  }
+
+  public <T> T invoke(ForkJoinTask<T> task) {
+    externalPush(task);
+    return task.join();
+  }
+
+  public void execute(ForkJoinTask<?> task) {
+    externalPush(task);
+  }
+
+  public void execute(Runnable task) {
+    externalPush(ForkJoinTask.adapt(task));
+  }
+
+  public <T> ForkJoinTask<T> submit(ForkJoinTask<T> task) {
+    externalPush(task);
+    return task;
+  }
+
+  public void shutdown() {
+    synchronized (this) {
+      if (runState == Running) {
+        runState = Shutdown;
+      }
+    }
+
+    wakeAll();
+    if (liveCount.get() == 0) {
+      terminate();
+    }
+  }
+
+  public List<Runnable> shutdownNow() {
+    synchronized (this) {
+      if (runState < Stop) {
+        runState = Stop;
+      }
+    }
+
+    ForkJoinTask<?> task;
+    while ((task = submissions.poll()) != null) {
+      task.cancel(false);
+    }
+
+    wakeAll();
+    if (liveCount.get() == 0) {
+      terminate();
+    }
+    return new ArrayList<Runnable>();
+  }
+
+  public boolean isShutdown() {
+    return runState != Running;
+  }
+
+  public boolean isTerminated() {
+    return runState == Terminated;
+  }
+
+  public synchronized boolean awaitTermination(long timeout, TimeUnit unit)
+    throws InterruptedException
+  {
+    long deadline = System.currentTimeMillis() + unit.toMillis(timeout);
+    while (runState != Terminated) {
+      long remaining = deadline - System.currentTimeMillis();
+      if (remaining <= 0) {
+        return false;
+      }
+      wait(remaining);
+    }
+    return true;
+  }
+
+  static class WorkQueue {
+    private static final int InitialCapacity = 1 << 6;
+
+    // the owner pushes and pops at bottom, thieves take from top, and
+    // the deque holds the elements in [top, bottom).  Indexes grow
+    // without bound and wrap around harmlessly, since they are only
+    // ever compared by difference.
+    volatile int top;
+    private volatile int bottom;
+    private volatile ForkJoinTask<?>[] array
+      = new ForkJoinTask<?>[InitialCapacity];
+
+    boolean isEmpty() {
+      return bottom - top <= 0;
+    }
+
+    // only called by the owner
+    void push(ForkJoinTask<?> task) {
+      int b = bottom;
+      ForkJoinTask<?>[] a = array;
+      if (b - top >= a.length - 1) {
+        a = grow(a, b);
+      }
+      a[b & (a.length - 1)] = task;
+      // publishes the slot written above
+      bottom = b + 1;
+    }
+
+    private ForkJoinTask<?>[] grow(ForkJoinTask<?>[] a, int b) {
+      // thieves may still be reading the old array, which is left
+      // intact, so any slot they find there is still valid
+      ForkJoinTask<?>[] n = new ForkJoinTask<?>[a.length << 1];
+      for (int i = top; i != b; ++i) {
+        n[i & (n.length - 1)] = a[i & (a.length - 1)];
+      }
+      array = n;
+      return n;
+    }
+
+    // only called by the owner
+    ForkJoinTask<?> pop() {
+      int b = bottom - 1;
+      ForkJoinTask<?>[] a = array;
+      // reserve the bottom slot before looking at top, so a thief
+      // racing with us for the last task sees the reservation
+      bottom = b;
+      int t = top;
+      if (b - t < 0) {
+        bottom = t;
+        return null;
+      }
+
+      int i = b & (a.length - 1);
+      ForkJoinTask<?> task = a[i];
+      if (b != t) {
+        a[i] = null;
+        return task;
+      }
+
+      // this is the last task, so a thief may be stealing it too
+      if (unsafe.compareAndSwapInt(this, topOffset, t, t + 1)) {
+        a[i] = null;
+      } else {
+        task = null;
+      }
+      bottom = t + 1;
+      return task;
+    }
+
+    // only called by the owner; pops the task if it is at the bottom
+    boolean tryUnpush(ForkJoinTask<?> task) {
+      int b = bottom - 1;
+      ForkJoinTask<?>[] a = array;
+      return b - top >= 0 && a[b & (a.length - 1)] == task && pop() == task;
+    }
+
+    ForkJoinTask<?> steal() {
+      while (true) {
+        int t = top;
+        int b = bottom;
+        if (b - t <= 0) {
+          return null;
+        }
+
+        ForkJoinTask<?>[] a = array;
+        ForkJoinTask<?> task = a[t & (a.length - 1)];
+        if (task != null
+            && unsafe.compareAndSwapInt(this, topOffset, t, t + 1))
+        {
+          return task;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,381 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+import java.util.Collection;
+import sun.misc.Unsafe;
+
+public abstract class ForkJoinTask<V> implements Future<V> {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+  private static final long statusOffset;
+
+  static {
+    try {
+      statusOffset = unsafe.objectFieldOffset
+        (ForkJoinTask.class.getDeclaredField("status"));
+    } catch (NoSuchFieldException e) {
+      throw new Error(e);
+    }
+  }
+
+  // a task is pending while its status is non-negative, and Signal
+  // means some thread may be waiting for it in wait()
+  private static final int Signal = 1;
+  static final int Normal = -1;
+  static final int Cancelled = -2;
+  static final int Exceptional = -3;
+
+  private volatile int status;
+  private Throwable exception;
+
+  protected abstract V getRawResult();
+
+  protected abstract void setRawResult(V value);
+
+  // returns true if the task completed normally
+  protected abstract boolean exec();
+
+  private int setCompletion(int completion) {
+    while (true) {
+      int s = status;
+      if (s < 0) {
+        return s;
+      } else if (unsafe.compareAndSwapInt(this, statusOffset, s, completion)) {
+        if (s == Signal) {
+          synchronized (this) {
+            notifyAll();
+          }
+        }
+        return completion;
+      }
+    }
+  }
+
+  private int setExceptionalCompletion(Throwable e) {
+    if (status >= 0) {
+      exception = e;
+    }
+    return setCompletion(Exceptional);
+  }
+
+  final int doExec() {
+    int s = status;
+    if (s >= 0) {
+      boolean completed;
+      try {
+        completed = exec();
+      } catch (Throwable e) {
+        return setExceptionalCompletion(e);
+      }
+      if (completed) {
+        s = setCompletion(Normal);
+      }
+    }
+    return s;
+  }
+
+  final int status() {
+    return status;
+  }
+
+  // blocks the calling thread until the task is done, returning false
+  // if the timeout (if any) elapses first
+  final boolean awaitDone(boolean interruptible, boolean timed,
+                          long deadline)
+    throws InterruptedException
+  {
+    boolean interrupted = false;
+    try {
+      int s;
+      while ((s = status) >= 0) {
+        if (unsafe.compareAndSwapInt(this, statusOffset, s, Signal)) {
+          synchronized (this) {
+            if (status >= 0) {
+              long wait = 0;
+              if (timed) {
+                wait = deadline - System.currentTimeMillis();
+                if (wait <= 0) {
+                  return false;
+                }
+              }
+
+              try {
+                wait(wait);
+              } catch (InterruptedException e) {
+                if (interruptible) {
+                  throw e;
+                }
+                interrupted = true;
+              }
+            }
+          }
+        }
+      }
+      return true;
+    } finally {
+      if (interrupted) {
+        Thread.currentThread().interrupt();
+      }
+    }
+  }
+
+  private int doJoin() {
+    int s = status;
+    if (s < 0) {
+      return s;
+    }
+
+    Thread t = Thread.currentThread();
+    if (t instanceof ForkJoinWorkerThread) {
+      ForkJoinWorkerThread w = (ForkJoinWorkerThread) t;
+      if (w.queue.tryUnpush(this)) {
+        s = doExec();
+        if (s < 0) {
+          return s;
+        }
+      }
+      return w.pool.awaitJoin(w, this);
+    } else {
+      try {
+        awaitDone(false, false, 0);
+      } catch (InterruptedException e) {
+        throw new AssertionError();
+      }
+      return status;
+    }
+  }
+
+  private Throwable exception(int s) {
+    if (s == Cancelled) {
+      return new CancellationException();
+    } else if (s == Exceptional) {
+      return exception;
+    } else {
+      return null;
+    }
+  }
+
+  private void report(int s) {
+    Throwable e = exception(s);
+    if (e instanceof RuntimeException) {
+      throw (RuntimeException) e;
+    } else if (e instanceof Error) {
+      throw (Error) e;
+    } else if (e != null) {
+      throw new RuntimeException(e);
+    }
+  }
+
+  public final ForkJoinTask<V> fork() {
+    Thread t = Thread.currentThread();
+    if (t instanceof ForkJoinWorkerThread) {
+      ForkJoinWorkerThread w = (ForkJoinWorkerThread) t;
+      w.pool.push(w, this);
+    } else {
+      ForkJoinPool.commonPool().externalPush(this);
+    }
+    return this;
+  }
+
+  public final V join() {
+    int s = doJoin();
+    if (s != Normal) {
+      report(s);
+    }
+    return getRawResult();
+  }
+
+  public final V invoke() {
+    int s = doExec();
+    if (s >= 0) {
+      s = doJoin();
+    }
+    if (s != Normal) {
+      report(s);
+    }
+    return getRawResult();
+  }
+
+  public static void invokeAll(ForkJoinTask<?> a, ForkJoinTask<?> b) {
+    b.fork();
+    a.invoke();
+    b.join();
+  }
+
+  public static void invokeAll(ForkJoinTask<?>... tasks) {
+    for (int i = tasks.length - 1; i > 0; --i) {
+      tasks[i].fork();
+    }
+
+    Throwable exception = null;
+    for (int i = 0; i < tasks.length; ++i) {
+      ForkJoinTask<?> t = tasks[i];
+      int s = i == 0 ? t.doExec() : t.status;
+      if (s >= 0) {
+        s = t.doJoin();
+      }
+      if (s != Normal && exception == null) {
+        exception = t.exception(s);
+      }
+    }
+
+    if (exception != null) {
+      if (exception instanceof RuntimeException) {
+        throw (RuntimeException) exception;
+      } else if (exception instanceof Error) {
+        throw (Error) exception;
+      } else {
+        throw new RuntimeException(exception);
+      }
+    }
+  }
+
+  public static <T extends ForkJoinTask<?>> Collection<T> invokeAll
+    (Collection<T> tasks)
+  {
+    invokeAll(tasks.toArray(new ForkJoinTask<?>[tasks.size()]));
+    return tasks;
+  }
+
+  public boolean cancel(boolean mayInterruptIfRunning) {
+    return setCompletion(Cancelled) == Cancelled;
+  }
+
+  public final boolean isDone() {
+    return status < 0;
+  }
+
+  public final boolean isCancelled() {
+    return status == Cancelled;
+  }
+
+  public final boolean isCompletedNormally() {
+    return status == Normal;
+  }
+
+  public final boolean isCompletedAbnormally() {
+    return status < Normal;
+  }
+
+  public final Throwable getException() {
+    return exception(status);
+  }
+
+  public void complete(V value) {
+    setRawResult(value);
+    setCompletion(Normal);
+  }
+
+  public void completeExceptionally(Throwable e) {
+    setExceptionalCompletion(e);
+  }
+
+  private V get(int s) throws ExecutionException {
+    if (s == Cancelled) {
+      throw new CancellationException();
+    } else if (s == Exceptional) {
+      throw new ExecutionException(exception);
+    } else {
+      return getRawResult();
+    }
+  }
+
+  public final V get() throws InterruptedException, ExecutionException {
+    if (Thread.currentThread() instanceof ForkJoinWorkerThread) {
+      return get(doJoin());
+    } else {
+      awaitDone(true, false, 0);
+      return get(status);
+    }
+  }
+
+  public final V get(long timeout, TimeUnit unit)
+    throws InterruptedException, ExecutionException, TimeoutException
+  {
+    if (! awaitDone
+        (true, true, System.currentTimeMillis() + unit.toMillis(timeout)))
+    {
+      throw new TimeoutException();
+    }
+    return get(status);
+  }
+
+  public static boolean inForkJoinPool() {
+    return Thread.currentThread() instanceof ForkJoinWorkerThread;
+  }
+
+  public static ForkJoinTask<?> adapt(Runnable task) {
+    return new AdaptedRunnable<Object>(task, null);
+  }
+
+  public static <T> ForkJoinTask<T> adapt(Runnable task, T result) {
+    return new AdaptedRunnable<T>(task, result);
+  }
+
+  public static <T> ForkJoinTask<T> adapt(Callable<? extends T> task) {
+    return new AdaptedCallable<T>(task);
+  }
+
+  private static class AdaptedRunnable<T> extends ForkJoinTask<T> {
+    private final Runnable task;
+    private T result;
+
+    public AdaptedRunnable(Runnable task, T result) {
+      if (task == null) throw new NullPointerException();
+
+      this.task = task;
+      this.result = result;
+    }
+
+    protected T getRawResult() {
+      return result;
+    }
+
+    protected void setRawResult(T value) {
+      result = value;
+    }
+
+    protected boolean exec() {
+      task.run();
+      return true;
+    }
+  }
+
+  private static class AdaptedCallable<T> extends ForkJoinTask<T> {
+    private final Callable<? extends T> task;
+    private T result;
+
+    public AdaptedCallable(Callable<? extends T> task) {
+      if (task == null) throw new NullPointerException();
+
+      this.task = task;
+    }
+
+    protected T getRawResult() {
+      return result;
+    }
+
+    protected void setRawResult(T value) {
+      result = value;
+    }
+
+    protected boolean exec() {
+      try {
+        result = task.call();
+        return true;
+      } catch (RuntimeException e) {
+        throw e;
+      } catch (Exception e) {
+        throw new RuntimeException(e);
+      }
+    }
+  }
+}
@@ -0,0 +1,44 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+public class ForkJoinWorkerThread extends Thread {
+  final ForkJoinPool pool;
+  final ForkJoinPool.WorkQueue queue = new ForkJoinPool.WorkQueue();
+  private final int index;
+
+  // non-zero while parked waiting for work; cleared by whoever wakes us
+  volatile int parked;
+
+  // state for choosing steal victims, and a count of successful steals
+  int seed;
+  long stealCount;
+
+  ForkJoinWorkerThread(ForkJoinPool pool, int index, String name) {
+    super(name);
+    this.pool = pool;
+    this.index = index;
+    this.seed = (index + 1) * 0x9E3779B9;
+    setDaemon(true);
+  }
+
+  public ForkJoinPool getPool() {
+    return pool;
+  }
+
+  public int getPoolIndex() {
+    return index;
+  }
+
+  public void run() {
+    pool.runWorker(this);
+  }
+}
@@ -0,0 +1,197 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+import sun.misc.Unsafe;
+
+public class FutureTask<T> implements RunnableFuture<T> {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+  private static final long stateOffset;
+
+  static {
+    try {
+      stateOffset = unsafe.objectFieldOffset
+        (FutureTask.class.getDeclaredField("state"));
+    } catch (NoSuchFieldException e) {
+      throw new Error(e);
+    }
+  }
+
+  private static final int New = 0;
+  private static final int Running = 1;
+  private static final int Done = 2;
+  private static final int Cancelled = 3;
+
+  private volatile int state;
+  private volatile Thread runner;
+  private Callable<T> callable;
+  private T result;
+  private Throwable exception;
+
+  public FutureTask(Callable<T> callable) {
+    if (callable == null) throw new NullPointerException();
+
+    this.callable = callable;
+  }
+
+  public FutureTask(final Runnable task, final T result) {
+    this(new Callable<T>() {
+        public T call() {
+          task.run();
+          return result;
+        }
+      });
+  }
+
+  private boolean transition(int from, int to) {
+    return unsafe.compareAndSwapInt(this, stateOffset, from, to);
+  }
+
+  public void run() {
+    if (! transition(New, Running)) {
+      return;
+    }
+
+    runner = Thread.currentThread();
+    try {
+      T v;
+      try {
+        v = callable.call();
+      } catch (Throwable e) {
+        setException(e);
+        return;
+      }
+      set(v);
+    } finally {
+      runner = null;
+    }
+  }
+
+  // runs the task without setting a result, leaving this ready to be
+  // run again, unless the task throws or this is cancelled; returns
+  // true if it may be run again
+  protected boolean runAndReset() {
+    if (! transition(New, Running)) {
+      return false;
+    }
+
+    runner = Thread.currentThread();
+    try {
+      try {
+        callable.call();
+      } catch (Throwable e) {
+        setException(e);
+        return false;
+      }
+      return transition(Running, New);
+    } finally {
+      runner = null;
+    }
+  }
+
+  private void finish(int from, T result, Throwable exception) {
+    // set the outcome before publishing it via the volatile state
+    this.result = result;
+    this.exception = exception;
+    if (transition(from, Done)) {
+      callable = null;
+      synchronized (this) {
+        notifyAll();
+      }
+      done();
+    }
+  }
+
+  protected void set(T v) {
+    int s = state;
+    if (s == New || s == Running) {
+      finish(s, v, null);
+    }
+  }
+
+  protected void setException(Throwable e) {
+    int s = state;
+    if (s == New || s == Running) {
+      finish(s, null, e);
+    }
+  }
+
+  protected void done() { }
+
+  public boolean cancel(boolean mayInterruptIfRunning) {
+    while (true) {
+      int s = state;
+      if (s >= Done) {
+        return false;
+      } else if (transition(s, Cancelled)) {
+        if (s == Running && mayInterruptIfRunning) {
+          Thread t = runner;
+          if (t != null) {
+            t.interrupt();
+          }
+        }
+        callable = null;
+        synchronized (this) {
+          notifyAll();
+        }
+        done();
+        return true;
+      }
+    }
+  }
+
+  public boolean isCancelled() {
+    return state == Cancelled;
+  }
+
+  public boolean isDone() {
+    return state >= Done;
+  }
+
+  private T report() throws ExecutionException {
+    if (state == Cancelled) {
+      throw new CancellationException();
+    } else if (exception != null) {
+      throw new ExecutionException(exception);
+    } else {
+      return result;
+    }
+  }
+
+  public T get() throws InterruptedException, ExecutionException {
+    if (state < Done) {
+      synchronized (this) {
+        while (state < Done) {
+          wait();
+        }
+      }
+    }
+    return report();
+  }
+
+  public T get(long timeout, TimeUnit unit)
+    throws InterruptedException, ExecutionException, TimeoutException
+  {
+    if (state < Done) {
+      long deadline = System.currentTimeMillis() + unit.toMillis(timeout);
+      synchronized (this) {
+        while (state < Done) {
+          long remaining = deadline - System.currentTimeMillis();
+          if (remaining <= 0) {
+            throw new TimeoutException();
+          }
+          wait(remaining);
+        }
+      }
+    }
+    return report();
+  }
+}
@@ -0,0 +1,419 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+import java.util.AbstractQueue;
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.Iterator;
+import java.util.NoSuchElementException;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.locks.Condition;
+import java.util.concurrent.locks.ReentrantLock;
+
+// Producers and consumers use separate locks, so a put at the tail
+// need not contend with a take at the head.  The element count is
+// the only state shared between the two ends.
+public class LinkedBlockingQueue<T> extends AbstractQueue<T>
+  implements BlockingQueue<T>
+{
+  private final int capacity;
+  private final AtomicInteger count = new AtomicInteger();
+
+  // head is a dummy node whose successor holds the first element
+  private Node<T> head;
+  private Node<T> last;
+
+  private final ReentrantLock takeLock = new ReentrantLock();
+  private final Condition notEmpty = takeLock.newCondition();
+  private final ReentrantLock putLock = new ReentrantLock();
+  private final Condition notFull = putLock.newCondition();
+
+  public LinkedBlockingQueue(int capacity) {
+    if (capacity <= 0) throw new IllegalArgumentException();
+
+    this.capacity = capacity;
+    head = last = new Node<T>(null);
+  }
+
+  public LinkedBlockingQueue() {
+    this(Integer.MAX_VALUE);
+  }
+
+  public LinkedBlockingQueue(Collection<? extends T> collection) {
+    this(Integer.MAX_VALUE);
+    for (T element: collection) {
+      add(element);
+    }
+  }
+
+  private void signalNotEmpty() {
+    takeLock.lock();
+    try {
+      notEmpty.signal();
+    } finally {
+      takeLock.unlock();
+    }
+  }
+
+  private void signalNotFull() {
+    putLock.lock();
+    try {
+      notFull.signal();
+    } finally {
+      putLock.unlock();
+    }
+  }
+
+  private void enqueue(T element) {
+    last = last.next = new Node<T>(element);
+  }
+
+  private T dequeue() {
+    Node<T> h = head;
+    Node<T> first = h.next;
+    h.next = null;
+    head = first;
+    T element = first.value;
+    first.value = null;
+    return element;
+  }
+
+  // called with putLock held after an insertion which left c elements
+  // queued before it
+  private void inserted(int c) {
+    if (c + 1 < capacity) {
+      notFull.signal();
+    }
+  }
+
+  public void put(T element) throws InterruptedException {
+    if (element == null) throw new NullPointerException();
+
+    int c;
+    putLock.lockInterruptibly();
+    try {
+      while (count.get() == capacity) {
+        notFull.await();
+      }
+      enqueue(element);
+      c = count.getAndIncrement();
+      inserted(c);
+    } finally {
+      putLock.unlock();
+    }
+
+    if (c == 0) {
+      signalNotEmpty();
+    }
+  }
+
+  public boolean offer(T element, long timeout, TimeUnit unit)
+    throws InterruptedException
+  {
+    if (element == null) throw new NullPointerException();
+
+    long nanoseconds = unit.toNanos(timeout);
+    int c;
+    putLock.lockInterruptibly();
+    try {
+      while (count.get() == capacity) {
+        if (nanoseconds <= 0) {
+          return false;
+        }
+        nanoseconds = notFull.awaitNanos(nanoseconds);
+      }
+      enqueue(element);
+      c = count.getAndIncrement();
+      inserted(c);
+    } finally {
+      putLock.unlock();
+    }
+
+    if (c == 0) {
+      signalNotEmpty();
+    }
+    return true;
+  }
+
+  public boolean offer(T element) {
+    if (element == null) throw new NullPointerException();
+
+    if (count.get() == capacity) {
+      return false;
+    }
+
+    int c = -1;
+    putLock.lock();
+    try {
+      if (count.get() < capacity) {
+        enqueue(element);
+        c = count.getAndIncrement();
+        inserted(c);
+      }
+    } finally {
+      putLock.unlock();
+    }
+
+    if (c == 0) {
+      signalNotEmpty();
+    }
+    return c >= 0;
+  }
+
+  // called with takeLock held after a removal which left c elements
+  // queued before it
+  private void removed(int c) {
+    if (c > 1) {
+      notEmpty.signal();
+    }
+  }
+
+  public T take() throws InterruptedException {
+    T element;
+    int c;
+    takeLock.lockInterruptibly();
+    try {
+      while (count.get() == 0) {
+        notEmpty.await();
+      }
+      element = dequeue();
+      c = count.getAndDecrement();
+      removed(c);
+    } finally {
+      takeLock.unlock();
+    }
+
+    if (c == capacity) {
+      signalNotFull();
+    }
+    return element;
+  }
+
+  public T poll(long timeout, TimeUnit unit) throws InterruptedException {
+    long nanoseconds = unit.toNanos(timeout);
+    T element;
+    int c;
+    takeLock.lockInterruptibly();
+    try {
+      while (count.get() == 0) {
+        if (nanoseconds <= 0) {
+          return null;
+        }
+        nanoseconds = notEmpty.awaitNanos(nanoseconds);
+      }
+      element = dequeue();
+      c = count.getAndDecrement();
+      removed(c);
+    } finally {
+      takeLock.unlock();
+    }
+
+    if (c == capacity) {
+      signalNotFull();
+    }
+    return element;
+  }
+
+  public T poll() {
+    if (count.get() == 0) {
+      return null;
+    }
+
+    T element = null;
+    int c = -1;
+    takeLock.lock();
+    try {
+      if (count.get() > 0) {
+        element = dequeue();
+        c = count.getAndDecrement();
+        removed(c);
+      }
+    } finally {
+      takeLock.unlock();
+    }
+
+    if (c == capacity) {
+      signalNotFull();
+    }
+    return element;
+  }
+
+  public T peek() {
+    if (count.get() == 0) {
+      return null;
+    }
+
+    takeLock.lock();
+    try {
+      Node<T> first = head.next;
+      return first == null ? null : first.value;
+    } finally {
+      takeLock.unlock();
+    }
+  }
+
+  private void fullyLock() {
+    putLock.lock();
+    takeLock.lock();
+  }
+
+  private void fullyUnlock() {
+    takeLock.unlock();
+    putLock.unlock();
+  }
+
+  public boolean remove(Object element) {
+    if (element == null) return false;
+
+    fullyLock();
+    try {
+      for (Node<T> p = head, n = p.next; n != null; p = n, n = n.next) {
+        if (element.equals(n.value)) {
+          p.next = n.next;
+          n.value = null;
+          if (last == n) {
+            last = p;
+          }
+          if (count.getAndDecrement() == capacity) {
+            notFull.signal();
+          }
+          return true;
+        }
+      }
+      return false;
+    } finally {
+      fullyUnlock();
+    }
+  }
+
+  public boolean contains(Object element) {
+    if (element == null) return false;
+
+    fullyLock();
+    try {
+      for (Node<T> n = head.next; n != null; n = n.next) {
+        if (element.equals(n.value)) {
+          return true;
+        }
+      }
+      return false;
+    } finally {
+      fullyUnlock();
+    }
+  }
+
+  public void clear() {
+    fullyLock();
+    try {
+      for (Node<T> n = head.next; n != null; n = n.next) {
+        n.value = null;
+      }
+      head.next = null;
+      last = head;
+      if (count.getAndSet(0) == capacity) {
+        notFull.signal();
+      }
+    } finally {
+      fullyUnlock();
+    }
+  }
+
+  public int size() {
+    return count.get();
+  }
+
+  public int remainingCapacity() {
+    return capacity - count.get();
+  }
+
+  public int drainTo(Collection<? super T> collection) {
+    return drainTo(collection, Integer.MAX_VALUE);
+  }
+
+  public int drainTo(Collection<? super T> collection, int max) {
+    if (collection == null) throw new NullPointerException();
+    if (collection == this) throw new IllegalArgumentException();
+
+    int n = 0;
+    int c = 0;
+    takeLock.lock();
+    try {
+      n = Math.min(max, count.get());
+      for (int i = 0; i < n; ++i) {
+        collection.add(dequeue());
+      }
+      if (n > 0) {
+        c = count.getAndAdd(-n);
+      }
+    } finally {
+      takeLock.unlock();
+    }
+
+    if (n > 0 && c == capacity) {
+      signalNotFull();
+    }
+    return n;
+  }
+
+  public Object[] toArray() {
+    return snapshot().toArray();
+  }
+
+  public <S> S[] toArray(S[] array) {
+    return snapshot().toArray(array);
+  }
+
+  private ArrayList<T> snapshot() {
+    fullyLock();
+    try {
+      ArrayList<T> list = new ArrayList<T>(count.get());
+      for (Node<T> n = head.next; n != null; n = n.next) {
+        list.add(n.value);
+      }
+      return list;
+    } finally {
+      fullyUnlock();
+    }
+  }
+
+  // iterates over the elements present when the iterator was created
+  public Iterator<T> iterator() {
+    final Iterator<T> it = snapshot().iterator();
+    return new Iterator<T>() {
+      private T current;
+
+      public boolean hasNext() {
+        return it.hasNext();
+      }
+
+      public T next() {
+        return current = it.next();
+      }
+
+      public void remove() {
+        if (current == null) throw new IllegalStateException();
+
+        LinkedBlockingQueue.this.remove(current);
+        current = null;
+      }
+    };
+  }
+
+  private static class Node<T> {
+    public T value;
+    public Node<T> next;
+
+    public Node(T value) {
+      this.value = value;
+    }
+  }
+}
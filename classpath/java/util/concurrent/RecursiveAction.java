@@ -0,0 +1,26 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+public abstract class RecursiveAction extends ForkJoinTask<Void> {
+  protected abstract void compute();
+
+  public final Void getRawResult() {
+    return null;
+  }
+
+  protected final void setRawResult(Void value) { }
+
+  protected final boolean exec() {
+    compute();
+    return true;
+  }
+}
@@ -0,0 +1,30 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+public abstract class RecursiveTask<V> extends ForkJoinTask<V> {
+  private V result;
+
+  protected abstract V compute();
+
+  public final V getRawResult() {
+    return result;
+  }
+
+  protected final void setRawResult(V value) {
+    result = value;
+  }
+
+  protected final boolean exec() {
+    result = compute();
+    return true;
+  }
+}
@@ -0,0 +1,29 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+public class RejectedExecutionException extends RuntimeException {
+  public RejectedExecutionException(String message, Throwable cause) {
+    super(message, cause);
+  }
+
+  public RejectedExecutionException(String message) {
+    this(message, null);
+  }
+
+  public RejectedExecutionException(Throwable cause) {
+    this(null, cause);
+  }
+
+  public RejectedExecutionException() {
+    this(null, null);
+  }
+}
@@ -0,0 +1,580 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+import java.util.AbstractQueue;
+import java.util.Collection;
+import java.util.Iterator;
+import java.util.List;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.locks.Condition;
+import java.util.concurrent.locks.ReentrantLock;
+
+// Tasks wait in a binary heap ordered by when they are due.  One idle
+// worker at a time, the leader, waits for the first task to become
+// due; the others wait until there is a new leader, so each task
+// wakes one thread.  The VM times those waits with its timer wheel,
+// so a pool with many workers costs the kernel no more timers than
+// one with a single worker.
+//
+// Delayed tasks submitted before shutdown still run after it, but
+// periodic ones do not, and a cancelled task is removed from the
+// queue right away.
+public class ScheduledThreadPoolExecutor extends ThreadPoolExecutor
+  implements ScheduledExecutorService
+{
+  private static final AtomicLong sequence = new AtomicLong();
+
+  // tasks due further ahead than this are treated as due this far
+  // ahead, so that comparing times can't overflow
+  private static final long MaximumDelay = Long.MAX_VALUE >> 1;
+
+  public ScheduledThreadPoolExecutor(int corePoolSize,
+                                     ThreadFactory threadFactory,
+                                     RejectedExecutionHandler handler)
+  {
+    super(corePoolSize, Integer.MAX_VALUE, 10, TimeUnit.MILLISECONDS,
+          new DelayedWorkQueue(), threadFactory, handler);
+  }
+
+  public ScheduledThreadPoolExecutor(int corePoolSize,
+                                     ThreadFactory threadFactory)
+  {
+    this(corePoolSize, threadFactory, new AbortPolicy());
+  }
+
+  public ScheduledThreadPoolExecutor(int corePoolSize,
+                                     RejectedExecutionHandler handler)
+  {
+    this(corePoolSize, Executors.defaultThreadFactory(), handler);
+  }
+
+  public ScheduledThreadPoolExecutor(int corePoolSize) {
+    this(corePoolSize, Executors.defaultThreadFactory(), new AbortPolicy());
+  }
+
+  private DelayedWorkQueue queue() {
+    return (DelayedWorkQueue) getQueue();
+  }
+
+  private static long triggerTime(long delay, TimeUnit unit) {
+    long nanoseconds = unit.toNanos(delay < 0 ? 0 : delay);
+    if (nanoseconds > MaximumDelay) {
+      nanoseconds = MaximumDelay;
+    }
+    return System.nanoTime() + nanoseconds;
+  }
+
+  private boolean canRun(boolean periodic) {
+    return (! isShutdown()) || ((! periodic) && ! isStopped());
+  }
+
+  private void delayedExecute(Task<?> task) {
+    if (isShutdown()) {
+      getRejectedExecutionHandler().rejectedExecution(task, this);
+      return;
+    }
+
+    queue().add(task);
+
+    if (isShutdown() && queue().remove(task)) {
+      // we raced with shutdown
+      task.cancel(false);
+      getRejectedExecutionHandler().rejectedExecution(task, this);
+    } else {
+      ensureWorker();
+    }
+  }
+
+  private void reschedule(Task<?> task) {
+    if (canRun(true)) {
+      queue().add(task);
+      if ((! canRun(true)) && queue().remove(task)) {
+        task.cancel(false);
+      } else {
+        ensureWorker();
+      }
+    } else {
+      task.cancel(false);
+    }
+  }
+
+  public ScheduledFuture<?> schedule(Runnable task, long delay, TimeUnit unit)
+  {
+    if (task == null || unit == null) throw new NullPointerException();
+
+    Task<Object> t = new Task<Object>
+      (Executors.callable(task), triggerTime(delay, unit), 0);
+    delayedExecute(t);
+    return t;
+  }
+
+  public <T> ScheduledFuture<T> schedule(Callable<T> task, long delay,
+                                         TimeUnit unit)
+  {
+    if (task == null || unit == null) throw new NullPointerException();
+
+    Task<T> t = new Task<T>(task, triggerTime(delay, unit), 0);
+    delayedExecute(t);
+    return t;
+  }
+
+  public ScheduledFuture<?> scheduleAtFixedRate(Runnable task,
+                                                long initialDelay,
+                                                long period, TimeUnit unit)
+  {
+    if (task == null || unit == null) throw new NullPointerException();
+    if (period <= 0) throw new IllegalArgumentException();
+
+    Task<Object> t = new Task<Object>
+      (Executors.callable(task), triggerTime(initialDelay, unit),
+       Math.min(unit.toNanos(period), MaximumDelay));
+    delayedExecute(t);
+    return t;
+  }
+
+  public ScheduledFuture<?> scheduleWithFixedDelay(Runnable task,
+                                                   long initialDelay,
+                                                   long delay, TimeUnit unit)
+  {
+    if (task == null || unit == null) throw new NullPointerException();
+    if (delay <= 0) throw new IllegalArgumentException();
+
+    Task<Object> t = new Task<Object>
+      (Executors.callable(task), triggerTime(initialDelay, unit),
+       - Math.min(unit.toNanos(delay), MaximumDelay));
+    delayedExecute(t);
+    return t;
+  }
+
+  public void execute(Runnable task) {
+    schedule(task, 0, TimeUnit.NANOSECONDS);
+  }
+
+  public Future<?> submit(Runnable task) {
+    return schedule(task, 0, TimeUnit.NANOSECONDS);
+  }
+
+  public <T> Future<T> submit(Runnable task, T result) {
+    return schedule(Executors.callable(task, result), 0,
+                    TimeUnit.NANOSECONDS);
+  }
+
+  public <T> Future<T> submit(Callable<T> task) {
+    return schedule(task, 0, TimeUnit.NANOSECONDS);
+  }
+
+  Runnable pollAfterShutdown() throws InterruptedException {
+    return queue().take(true);
+  }
+
+  void onShutdown() {
+    for (Object o: queue().toArray()) {
+      Task<?> task = (Task<?>) o;
+      if (task.isPeriodic() && queue().remove(task)) {
+        task.cancel(false);
+      }
+    }
+  }
+
+  public List<Runnable> shutdownNow() {
+    List<Runnable> tasks = super.shutdownNow();
+    for (Runnable task: tasks) {
+      ((Task<?>) task).cancel(false);
+    }
+    return tasks;
+  }
+
+  private class Task<T> extends FutureTask<T> implements ScheduledFuture<T> {
+    private final long sequenceNumber = sequence.getAndIncrement();
+    // when the task is next due, by System.nanoTime
+    private long time;
+    // the time between runs if positive, the negated delay between
+    // them if negative, or zero if the task runs once
+    private final long period;
+    // where the task is in the queue's heap, or -1 if it isn't there
+    public int index = -1;
+
+    public Task(Callable<T> callable, long time, long period) {
+      super(callable);
+      this.time = time;
+      this.period = period;
+    }
+
+    public long getDelay(TimeUnit unit) {
+      return unit.convert(time - System.nanoTime(), TimeUnit.NANOSECONDS);
+    }
+
+    public int compareTo(Delayed other) {
+      if (other == this) {
+        return 0;
+      } else if (other instanceof Task) {
+        Task<?> task = (Task<?>) other;
+        long difference = time - task.time;
+        if (difference != 0) {
+          return difference < 0 ? -1 : 1;
+        } else {
+          return sequenceNumber < task.sequenceNumber ? -1 : 1;
+        }
+      } else {
+        long difference = getDelay(TimeUnit.NANOSECONDS)
+          - other.getDelay(TimeUnit.NANOSECONDS);
+        return difference == 0 ? 0 : (difference < 0 ? -1 : 1);
+      }
+    }
+
+    public boolean isPeriodic() {
+      return period != 0;
+    }
+
+    public boolean cancel(boolean mayInterruptIfRunning) {
+      boolean cancelled = super.cancel(mayInterruptIfRunning);
+      if (cancelled && index >= 0) {
+        queue().remove(this);
+      }
+      return cancelled;
+    }
+
+    public void run() {
+      if (! canRun(isPeriodic())) {
+        cancel(false);
+      } else if (! isPeriodic()) {
+        super.run();
+      } else if (runAndReset()) {
+        time = period > 0 ? time + period : System.nanoTime() - period;
+        reschedule(this);
+      }
+    }
+  }
+
+  private static class DelayedWorkQueue extends AbstractQueue<Runnable>
+    implements BlockingQueue<Runnable>
+  {
+    private final ReentrantLock lock = new ReentrantLock();
+    private final Condition available = lock.newCondition();
+    private Task<?>[] heap = new Task<?>[16];
+    private int size;
+    // the thread waiting for the first task to become due, if any
+    private Thread leader;
+
+    private void siftUp(int index, Task<?> task) {
+      while (index > 0) {
+        int parent = (index - 1) >>> 1;
+        Task<?> p = heap[parent];
+        if (task.compareTo(p) >= 0) {
+          break;
+        }
+        heap[index] = p;
+        p.index = index;
+        index = parent;
+      }
+      heap[index] = task;
+      task.index = index;
+    }
+
+    private void siftDown(int index, Task<?> task) {
+      int half = size >>> 1;
+      while (index < half) {
+        int child = (index << 1) + 1;
+        Task<?> c = heap[child];
+        int right = child + 1;
+        if (right < size && c.compareTo(heap[right]) > 0) {
+          c = heap[child = right];
+        }
+        if (task.compareTo(c) <= 0) {
+          break;
+        }
+        heap[index] = c;
+        c.index = index;
+        index = child;
+      }
+      heap[index] = task;
+      task.index = index;
+    }
+
+    // called with the lock held
+    private void removeAt(int index) {
+      Task<?> task = heap[index];
+      task.index = -1;
+      Task<?> last = heap[-- size];
+      heap[size] = null;
+      if (index != size) {
+        siftDown(index, last);
+        if (heap[index] == last) {
+          siftUp(index, last);
+        }
+      }
+    }
+
+    // called with the lock held
+    private Task<?> finishPoll() {
+      Task<?> first = heap[0];
+      removeAt(0);
+      return first;
+    }
+
+    public boolean offer(Runnable element) {
+      Task<?> task = (Task<?>) element;
+      lock.lock();
+      try {
+        if (size == heap.length) {
+          Task<?>[] heap = new Task<?>[size * 2];
+          System.arraycopy(this.heap, 0, heap, 0, size);
+          this.heap = heap;
+        }
+        siftUp(size++, task);
+        if (heap[0] == task) {
+          // whoever was waiting for the old first task must wait for
+          // this one instead
+          leader = null;
+          available.signal();
+        }
+      } finally {
+        lock.unlock();
+      }
+      return true;
+    }
+
+    public void put(Runnable element) {
+      offer(element);
+    }
+
+    public boolean offer(Runnable element, long timeout, TimeUnit unit) {
+      return offer(element);
+    }
+
+    public Runnable poll() {
+      lock.lock();
+      try {
+        Task<?> first = heap[0];
+        if (first == null || first.getDelay(TimeUnit.NANOSECONDS) > 0) {
+          return null;
+        } else {
+          return finishPoll();
+        }
+      } finally {
+        lock.unlock();
+      }
+    }
+
+    public Runnable take() throws InterruptedException {
+      return take(false);
+    }
+
+    // waits for the first task to become due, or if ifAny is true and
+    // the queue is or becomes empty, returns null
+    public Runnable take(boolean ifAny) throws InterruptedException {
+      lock.lockInterruptibly();
+      try {
+        while (true) {
+          Task<?> first = heap[0];
+          if (first == null) {
+            if (ifAny) {
+              return null;
+            }
+            available.await();
+          } else {
+            long delay = first.getDelay(TimeUnit.NANOSECONDS);
+            if (delay <= 0) {
+              return finishPoll();
+            }
+            first = null;
+
+            if (leader != null) {
+              available.await();
+            } else {
+              Thread thread = Thread.currentThread();
+              leader = thread;
+              try {
+                available.awaitNanos(delay);
+              } finally {
+                if (leader == thread) {
+                  leader = null;
+                }
+              }
+            }
+          }
+        }
+      } finally {
+        if (leader == null && heap[0] != null) {
+          available.signal();
+        }
+        lock.unlock();
+      }
+    }
+
+    public Runnable poll(long timeout, TimeUnit unit)
+      throws InterruptedException
+    {
+      long nanoseconds = unit.toNanos(timeout);
+      lock.lockInterruptibly();
+      try {
+        while (true) {
+          Task<?> first = heap[0];
+          if (first == null) {
+            if (nanoseconds <= 0) {
+              return null;
+            }
+            nanoseconds = available.awaitNanos(nanoseconds);
+          } else {
+            long delay = first.getDelay(TimeUnit.NANOSECONDS);
+            if (delay <= 0) {
+              return finishPoll();
+            } else if (nanoseconds <= 0) {
+              return null;
+            }
+            first = null;
+
+            if (nanoseconds < delay || leader != null) {
+              nanoseconds = available.awaitNanos(nanoseconds);
+            } else {
+              Thread thread = Thread.currentThread();
+              leader = thread;
+              try {
+                nanoseconds -= delay - available.awaitNanos(delay);
+              } finally {
+                if (leader == thread) {
+                  leader = null;
+                }
+              }
+            }
+          }
+        }
+      } finally {
+        if (leader == null && heap[0] != null) {
+          available.signal();
+        }
+        lock.unlock();
+      }
+    }
+
+    public Runnable peek() {
+      lock.lock();
+      try {
+        return heap[0];
+      } finally {
+        lock.unlock();
+      }
+    }
+
+    public boolean remove(Object element) {
+      lock.lock();
+      try {
+        if (element instanceof Task) {
+          int index = ((Task<?>) element).index;
+          if (index >= 0 && index < size && heap[index] == element) {
+            removeAt(index);
+            return true;
+          }
+        }
+        return false;
+      } finally {
+        lock.unlock();
+      }
+    }
+
+    public boolean contains(Object element) {
+      lock.lock();
+      try {
+        if (element instanceof Task) {
+          int index = ((Task<?>) element).index;
+          return index >= 0 && index < size && heap[index] == element;
+        }
+        return false;
+      } finally {
+        lock.unlock();
+      }
+    }
+
+    public void clear() {
+      lock.lock();
+      try {
+        for (int i = 0; i < size; ++i) {
+          heap[i].index = -1;
+          heap[i] = null;
+        }
+        size = 0;
+      } finally {
+        lock.unlock();
+      }
+    }
+
+    public int size() {
+      lock.lock();
+      try {
+        return size;
+      } finally {
+        lock.unlock();
+      }
+    }
+
+    public int remainingCapacity() {
+      return Integer.MAX_VALUE;
+    }
+
+    // unlike DelayQueue, this drains tasks whether or not they are due,
+    // so that shutdownNow returns every task which never ran
+    public int drainTo(Collection<? super Runnable> collection) {
+      return drainTo(collection, Integer.MAX_VALUE);
+    }
+
+    public int drainTo(Collection<? super Runnable> collection, int max) {
+      if (collection == null) throw new NullPointerException();
+      if (collection == this) throw new IllegalArgumentException();
+
+      lock.lock();
+      try {
+        int count = 0;
+        while (size > 0 && count < max) {
+          collection.add(finishPoll());
+          ++ count;
+        }
+        return count;
+      } finally {
+        lock.unlock();
+      }
+    }
+
+    public Object[] toArray() {
+      lock.lock();
+      try {
+        Object[] array = new Object[size];
+        System.arraycopy(heap, 0, array, 0, size);
+        return array;
+      } finally {
+        lock.unlock();
+      }
+    }
+
+    public Iterator<Runnable> iterator() {
+      final Object[] array = toArray();
+      return new Iterator<Runnable>() {
+        private int index;
+        private Task<?> last;
+
+        public boolean hasNext() {
+          return index < array.length;
+        }
+
+        public Runnable next() {
+          return last = (Task<?>) array[index++];
+        }
+
+        public void remove() {
+          if (last == null) throw new IllegalStateException();
+
+          DelayedWorkQueue.this.remove(last);
+          last = null;
+        }
+      };
+    }
+  }
+}
@@ -0,0 +1,568 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+import java.util.ArrayList;
+import java.util.HashSet;
+import java.util.List;
+import java.util.concurrent.locks.Condition;
+import java.util.concurrent.locks.ReentrantLock;
+
+public class ThreadPoolExecutor extends AbstractExecutorService {
+  private static final int Running = 0;
+  private static final int Shutdown = 1;
+  private static final int Stop = 2;
+  private static final int Terminated = 3;
+
+  private static final RejectedExecutionHandler DefaultHandler
+    = new AbortPolicy();
+
+  private final BlockingQueue<Runnable> workQueue;
+
+  // guards workers, poolSize and transitions of runState
+  private final ReentrantLock mainLock = new ReentrantLock();
+  private final Condition termination = mainLock.newCondition();
+  private final HashSet<Worker> workers = new HashSet<Worker>();
+
+  private volatile int runState;
+  private volatile int poolSize;
+  private volatile int corePoolSize;
+  private volatile int maximumPoolSize;
+  private volatile long keepAliveNanoseconds;
+  private volatile boolean allowCoreThreadTimeOut;
+  private volatile ThreadFactory threadFactory;
+  private volatile RejectedExecutionHandler handler;
+  private int largestPoolSize;
+  private long completedTaskCount;
+
+  public ThreadPoolExecutor(int corePoolSize, int maximumPoolSize,
+                            long keepAliveTime, TimeUnit unit,
+                            BlockingQueue<Runnable> workQueue,
+                            ThreadFactory threadFactory,
+                            RejectedExecutionHandler handler)
+  {
+    if (corePoolSize < 0 || maximumPoolSize <= 0
+        || maximumPoolSize < corePoolSize || keepAliveTime < 0)
+    {
+      throw new IllegalArgumentException();
+    }
+
+    if (workQueue == null || threadFactory == null || handler == null) {
+      throw new NullPointerException();
+    }
+
+    this.corePoolSize = corePoolSize;
+    this.maximumPoolSize = maximumPoolSize;
+    this.keepAliveNanoseconds = unit.toNanos(keepAliveTime);
+    this.workQueue = workQueue;
+    this.threadFactory = threadFactory;
+    this.handler = handler;
+  }
+
+  public ThreadPoolExecutor(int corePoolSize, int maximumPoolSize,
+                            long keepAliveTime, TimeUnit unit,
+                            BlockingQueue<Runnable> workQueue,
+                            ThreadFactory threadFactory)
+  {
+    this(corePoolSize, maximumPoolSize, keepAliveTime, unit, workQueue,
+         threadFactory, DefaultHandler);
+  }
+
+  public ThreadPoolExecutor(int corePoolSize, int maximumPoolSize,
+                            long keepAliveTime, TimeUnit unit,
+                            BlockingQueue<Runnable> workQueue,
+                            RejectedExecutionHandler handler)
+  {
+    this(corePoolSize, maximumPoolSize, keepAliveTime, unit, workQueue,
+         Executors.defaultThreadFactory(), handler);
+  }
+
+  public ThreadPoolExecutor(int corePoolSize, int maximumPoolSize,
+                            long keepAliveTime, TimeUnit unit,
+                            BlockingQueue<Runnable> workQueue)
+  {
+    this(corePoolSize, maximumPoolSize, keepAliveTime, unit, workQueue,
+         Executors.defaultThreadFactory(), DefaultHandler);
+  }
+
+  public void execute(Runnable task) {
+    if (task == null) throw new NullPointerException();
+
+    if (poolSize < corePoolSize && addWorker(task, corePoolSize)) {
+      return;
+    }
+
+    if (runState == Running && workQueue.offer(task)) {
+      if (runState != Running) {
+        // we raced with shutdown; take the task back if no worker has
+        // claimed it yet
+        if (workQueue.remove(task)) {
+          reject(task);
+        }
+      } else if (poolSize == 0) {
+        // every worker exited between our check and the offer
+        addWorker(null, Integer.MAX_VALUE);
+      }
+    } else if (! addWorker(task, maximumPoolSize)) {
+      reject(task);
+    }
+  }
+
+  private void reject(Runnable task) {
+    handler.rejectedExecution(task, this);
+  }
+
+  // called with mainLock held
+  private Thread addThread(Runnable firstTask) {
+    Worker w = new Worker(firstTask);
+    Thread t = threadFactory.newThread(w);
+    if (t != null) {
+      w.thread = t;
+      workers.add(w);
+      if (++ poolSize > largestPoolSize) {
+        largestPoolSize = poolSize;
+      }
+    }
+    return t;
+  }
+
+  private boolean addWorker(Runnable firstTask, int limit) {
+    Thread t = null;
+    mainLock.lock();
+    try {
+      if (poolSize < limit && runState == Running) {
+        t = addThread(firstTask);
+      }
+    } finally {
+      mainLock.unlock();
+    }
+
+    if (t == null) {
+      return false;
+    } else {
+      t.start();
+      return true;
+    }
+  }
+
+  private Runnable getTask() {
+    while (true) {
+      try {
+        int state = runState;
+        if (state > Shutdown) {
+          return null;
+        }
+
+        Runnable task;
+        if (state == Shutdown) {
+          task = pollAfterShutdown();
+        } else if (poolSize > corePoolSize || allowCoreThreadTimeOut) {
+          task = workQueue.poll(keepAliveNanoseconds, TimeUnit.NANOSECONDS);
+        } else {
+          task = workQueue.take();
+        }
+
+        if (task != null) {
+          return task;
+        }
+
+        if (workerCanExit()) {
+          if (runState >= Shutdown) {
+            interruptIdleWorkers();
+          }
+          return null;
+        }
+      } catch (InterruptedException e) {
+        // we may have been interrupted by shutdown; check again
+      }
+    }
+  }
+
+  // the next task for a worker once the pool is shut down, or null if
+  // there are none left
+  Runnable pollAfterShutdown() throws InterruptedException {
+    return workQueue.poll();
+  }
+
+  // starts a worker without a task if there are fewer than the core
+  // pool size, or none at all
+  void ensureWorker() {
+    if (! addWorker(null, corePoolSize) && poolSize == 0) {
+      addWorker(null, maximumPoolSize);
+    }
+  }
+
+  // called with mainLock held by shutdown, before idle workers are
+  // interrupted
+  void onShutdown() { }
+
+  private boolean workerCanExit() {
+    mainLock.lock();
+    try {
+      return runState >= Stop
+        || workQueue.isEmpty()
+        || (allowCoreThreadTimeOut && poolSize > Math.max(1, corePoolSize));
+    } finally {
+      mainLock.unlock();
+    }
+  }
+
+  private void interruptIdleWorkers() {
+    mainLock.lock();
+    try {
+      for (Worker w: workers) {
+        w.interruptIfIdle();
+      }
+    } finally {
+      mainLock.unlock();
+    }
+  }
+
+  private void workerDone(Worker w) {
+    mainLock.lock();
+    try {
+      completedTaskCount += w.completedTasks;
+      workers.remove(w);
+      if (-- poolSize == 0) {
+        tryTerminate();
+      }
+    } finally {
+      mainLock.unlock();
+    }
+  }
+
+  // called with mainLock held when the pool becomes empty
+  private void tryTerminate() {
+    if (poolSize == 0) {
+      int state = runState;
+      if (state < Stop && ! workQueue.isEmpty()) {
+        // tasks remain but nobody is left to run them
+        Thread t = addThread(null);
+        if (t != null) {
+          t.start();
+          return;
+        }
+      }
+
+      if (state == Stop || state == Shutdown) {
+        runState = Terminated;
+        termination.signalAll();
+        terminated();
+      }
+    }
+  }
+
+  public void shutdown() {
+    mainLock.lock();
+    try {
+      if (runState < Shutdown) {
+        runState = Shutdown;
+      }
+
+      onShutdown();
+
+      for (Worker w: workers) {
+        w.interruptIfIdle();
+      }
+
+      tryTerminate();
+    } finally {
+      mainLock.unlock();
+    }
+  }
+
+  public List<Runnable> shutdownNow() {
+    mainLock.lock();
+    try {
+      if (runState < Stop) {
+        runState = Stop;
+      }
+
+      for (Worker w: workers) {
+        w.interruptNow();
+      }
+
+      List<Runnable> tasks = new ArrayList<Runnable>();
+      workQueue.drainTo(tasks);
+
+      tryTerminate();
+      return tasks;
+    } finally {
+      mainLock.unlock();
+    }
+  }
+
+  public boolean isShutdown() {
+    return runState != Running;
+  }
+
+  // true once shutdownNow has been called
+  boolean isStopped() {
+    return runState >= Stop;
+  }
+
+  public boolean isTerminating() {
+    int state = runState;
+    return state == Shutdown || state == Stop;
+  }
+
+  public boolean isTerminated() {
+    return runState == Terminated;
+  }
+
+  public boolean awaitTermination(long timeout, TimeUnit unit)
+    throws InterruptedException
+  {
+    long nanoseconds = unit.toNanos(timeout);
+    mainLock.lock();
+    try {
+      while (runState != Terminated) {
+        if (nanoseconds <= 0) {
+          return false;
+        }
+        nanoseconds = termination.awaitNanos(nanoseconds);
+      }
+      return true;
+    } finally {
+      mainLock.unlock();
+    }
+  }
+
+  public BlockingQueue<Runnable> getQueue() {
+    return workQueue;
+  }
+
+  public boolean remove(Runnable task) {
+    return workQueue.remove(task);
+  }
+
+  public void setThreadFactory(ThreadFactory threadFactory) {
+    if (threadFactory == null) throw new NullPointerException();
+
+    this.threadFactory = threadFactory;
+  }
+
+  public ThreadFactory getThreadFactory() {
+    return threadFactory;
+  }
+
+  public void setRejectedExecutionHandler(RejectedExecutionHandler handler) {
+    if (handler == null) throw new NullPointerException();
+
+    this.handler = handler;
+  }
+
+  public RejectedExecutionHandler getRejectedExecutionHandler() {
+    return handler;
+  }
+
+  public void setCorePoolSize(int corePoolSize) {
+    if (corePoolSize < 0) throw new IllegalArgumentException();
+
+    this.corePoolSize = corePoolSize;
+    if (poolSize > corePoolSize) {
+      // let the surplus threads notice and time out
+      interruptIdleWorkers();
+    }
+  }
+
+  public int getCorePoolSize() {
+    return corePoolSize;
+  }
+
+  public void setMaximumPoolSize(int maximumPoolSize) {
+    if (maximumPoolSize <= 0 || maximumPoolSize < corePoolSize) {
+      throw new IllegalArgumentException();
+    }
+
+    this.maximumPoolSize = maximumPoolSize;
+  }
+
+  public int getMaximumPoolSize() {
+    return maximumPoolSize;
+  }
+
+  public void setKeepAliveTime(long time, TimeUnit unit) {
+    if (time < 0) throw new IllegalArgumentException();
+
+    keepAliveNanoseconds = unit.toNanos(time);
+  }
+
+  public long getKeepAliveTime(TimeUnit unit) {
+    return unit.convert(keepAliveNanoseconds, TimeUnit.NANOSECONDS);
+  }
+
+  public void allowCoreThreadTimeOut(boolean value) {
+    allowCoreThreadTimeOut = value;
+  }
+
+  public boolean allowsCoreThreadTimeOut() {
+    return allowCoreThreadTimeOut;
+  }
+
+  public boolean prestartCoreThread() {
+    return addWorker(null, corePoolSize);
+  }
+
+  public int prestartAllCoreThreads() {
+    int n = 0;
+    while (addWorker(null, corePoolSize)) {
+      ++ n;
+    }
+    return n;
+  }
+
+  public int getPoolSize() {
+    return poolSize;
+  }
+
+  public int getLargestPoolSize() {
+    mainLock.lock();
+    try {
+      return largestPoolSize;
+    } finally {
+      mainLock.unlock();
+    }
+  }
+
+  public int getActiveCount() {
+    mainLock.lock();
+    try {
+      int n = 0;
+      for (Worker w: workers) {
+        if (w.isActive()) {
+          ++ n;
+        }
+      }
+      return n;
+    } finally {
+      mainLock.unlock();
+    }
+  }
+
+  public long getCompletedTaskCount() {
+    mainLock.lock();
+    try {
+      long n = completedTaskCount;
+      for (Worker w: workers) {
+        n += w.completedTasks;
+      }
+      return n;
+    } finally {
+      mainLock.unlock();
+    }
+  }
+
+  protected void beforeExecute(Thread thread, Runnable task) { }
+
+  protected void afterExecute(Runnable task, Throwable exception) { }
+
+  protected void terminated() { }
+
+  private class Worker implements Runnable {
+    // held while running a task, so that shutdown only interrupts
+    // workers which are waiting for one
+    private final ReentrantLock runLock = new ReentrantLock();
+    private Runnable firstTask;
+    public volatile long completedTasks;
+    public Thread thread;
+
+    public Worker(Runnable firstTask) {
+      this.firstTask = firstTask;
+    }
+
+    public boolean isActive() {
+      return runLock.isLocked();
+    }
+
+    public void interruptIfIdle() {
+      if (thread != Thread.currentThread() && runLock.tryLock()) {
+        try {
+          thread.interrupt();
+        } finally {
+          runLock.unlock();
+        }
+      }
+    }
+
+    public void interruptNow() {
+      thread.interrupt();
+    }
+
+    private void runTask(Runnable task) {
+      runLock.lock();
+      try {
+        // discard any interrupt meant for an idle worker unless the
+        // pool is stopping
+        if (runState < Stop) {
+          Thread.interrupted();
+        }
+
+        beforeExecute(thread, task);
+        try {
+          task.run();
+        } catch (RuntimeException e) {
+          afterExecute(task, e);
+          throw e;
+        } catch (Error e) {
+          afterExecute(task, e);
+          throw e;
+        }
+        afterExecute(task, null);
+        ++ completedTasks;
+      } finally {
+        runLock.unlock();
+      }
+    }
+
+    public void run() {
+      try {
+        Runnable task = firstTask;
+        firstTask = null;
+        while (task != null || (task = getTask()) != null) {
+          runTask(task);
+          task = null;
+        }
+      } finally {
+        workerDone(this);
+      }
+    }
+  }
+
+  public static class AbortPolicy implements RejectedExecutionHandler {
+    public void rejectedExecution(Runnable task, ThreadPoolExecutor executor) {
+      throw new RejectedExecutionException();
+    }
+  }
+
+  public static class CallerRunsPolicy implements RejectedExecutionHandler {
+    public void rejectedExecution(Runnable task, ThreadPoolExecutor executor) {
+      if (! executor.isShutdown()) {
+        task.run();
+      }
+    }
+  }
+
+  public static class DiscardPolicy implements RejectedExecutionHandler {
+    public void rejectedExecution(Runnable task, ThreadPoolExecutor executor) {
+      // ignore
+    }
+  }
+
+  public static class DiscardOldestPolicy implements RejectedExecutionHandler {
+    public void rejectedExecution(Runnable task, ThreadPoolExecutor executor) {
+      if (! executor.isShutdown()) {
+        executor.getQueue().poll();
+        executor.execute(task);
+      }
+    }
+  }
+}
@@ -0,0 +1,99 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+public enum TimeUnit {
+  NANOSECONDS(1L),
+  MICROSECONDS(1000L),
+  MILLISECONDS(1000L * 1000),
+  SECONDS(1000L * 1000 * 1000),
+  MINUTES(60L * 1000 * 1000 * 1000),
+  HOURS(60L * 60 * 1000 * 1000 * 1000),
+  DAYS(24L * 60 * 60 * 1000 * 1000 * 1000);
+
+  // length of one unit in nanoseconds
+  private final long scale;
+
+  private TimeUnit(long scale) {
+    this.scale = scale;
+  }
+
+  private static long scale(long duration, long multiply, long divide) {
+    if (multiply > divide) {
+      long factor = multiply / divide;
+      long limit = Long.MAX_VALUE / factor;
+      if (duration > limit) {
+        return Long.MAX_VALUE;
+      } else if (duration < -limit) {
+        return Long.MIN_VALUE;
+      } else {
+        return duration * factor;
+      }
+    } else {
+      return duration / (divide / multiply);
+    }
+  }
+
+  public long convert(long duration, TimeUnit unit) {
+    return scale(duration, unit.scale, scale);
+  }
+
+  public long toNanos(long duration) {
+    return scale(duration, scale, NANOSECONDS.scale);
+  }
+
+  public long toMicros(long duration) {
+    return scale(duration, scale, MICROSECONDS.scale);
+  }
+
+  public long toMillis(long duration) {
+    return scale(duration, scale, MILLISECONDS.scale);
+  }
+
+  public long toSeconds(long duration) {
+    return scale(duration, scale, SECONDS.scale);
+  }
+
+  public long toMinutes(long duration) {
+    return scale(duration, scale, MINUTES.scale);
+  }
+
+  public long toHours(long duration) {
+    return scale(duration, scale, HOURS.scale);
+  }
+
+  public long toDays(long duration) {
+    return scale(duration, scale, DAYS.scale);
+  }
+
+  public void sleep(long duration) throws InterruptedException {
+    if (duration > 0) {
+      long nanos = toNanos(duration);
+      Thread.sleep(nanos / 1000000, (int) (nanos % 1000000));
+    }
+  }
+
+  public void timedJoin(Thread thread, long duration)
+    throws InterruptedException
+  {
+    if (duration > 0) {
+      long nanos = toNanos(duration);
+      thread.join(nanos / 1000000, (int) (nanos % 1000000));
+    }
+  }
+
+  public void timedWait(Object o, long duration) throws InterruptedException {
+    if (duration > 0) {
+      long nanos = toNanos(duration);
+      o.wait(nanos / 1000000, (int) (nanos % 1000000));
+    }
+  }
+}
@@ -0,0 +1,69 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent.atomic;
+
+import sun.misc.Unsafe;
+
+public class AtomicBoolean {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+  private static final long valueOffset;
+
+  static {
+    try {
+      valueOffset = unsafe.objectFieldOffset
+        (AtomicBoolean.class.getDeclaredField("value"));
+    } catch (NoSuchFieldException e) {
+      throw new Error(e);
+    }
+  }
+
+  private volatile int value;
+
+  public AtomicBoolean(boolean value) {
+    this.value = value ? 1 : 0;
+  }
+
+  public AtomicBoolean() { }
+
+  public boolean get() {
+    return value != 0;
+  }
+
+  public void set(boolean value) {
+    this.value = value ? 1 : 0;
+  }
+
+  public void lazySet(boolean value) {
+    unsafe.putOrderedInt(this, valueOffset, value ? 1 : 0);
+  }
+
+  public boolean compareAndSet(boolean expect, boolean update) {
+    return unsafe.compareAndSwapInt
+      (this, valueOffset, expect ? 1 : 0, update ? 1 : 0);
+  }
+
+  public boolean weakCompareAndSet(boolean expect, boolean update) {
+    return compareAndSet(expect, update);
+  }
+
+  public boolean getAndSet(boolean value) {
+    while (true) {
+      boolean v = get();
+      if (compareAndSet(v, value)) {
+        return v;
+      }
+    }
+  }
+
+  public String toString() {
+    return String.valueOf(get());
+  }
+}
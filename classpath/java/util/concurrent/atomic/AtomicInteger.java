@@ -0,0 +1,121 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent.atomic;
+
+import sun.misc.Unsafe;
+
+public class AtomicInteger extends Number {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+  private static final long valueOffset;
+
+  static {
+    try {
+      valueOffset = unsafe.objectFieldOffset
+        (AtomicInteger.class.getDeclaredField("value"));
+    } catch (NoSuchFieldException e) {
+      throw new Error(e);
+    }
+  }
+
+  private volatile int value;
+
+  public AtomicInteger(int value) {
+    this.value = value;
+  }
+
+  public AtomicInteger() { }
+
+  public int get() {
+    return value;
+  }
+
+  public void set(int value) {
+    this.value = value;
+  }
+
+  public void lazySet(int value) {
+    unsafe.putOrderedInt(this, valueOffset, value);
+  }
+
+  public boolean compareAndSet(int expect, int update) {
+    return unsafe.compareAndSwapInt(this, valueOffset, expect, update);
+  }
+
+  public boolean weakCompareAndSet(int expect, int update) {
+    return compareAndSet(expect, update);
+  }
+
+  public int getAndSet(int value) {
+    while (true) {
+      int v = this.value;
+      if (compareAndSet(v, value)) {
+        return v;
+      }
+    }
+  }
+
+  public int getAndAdd(int delta) {
+    while (true) {
+      int v = value;
+      if (compareAndSet(v, v + delta)) {
+        return v;
+      }
+    }
+  }
+
+  public int addAndGet(int delta) {
+    return getAndAdd(delta) + delta;
+  }
+
+  public int getAndIncrement() {
+    return getAndAdd(1);
+  }
+
+  public int getAndDecrement() {
+    return getAndAdd(-1);
+  }
+
+  public int incrementAndGet() {
+    return getAndAdd(1) + 1;
+  }
+
+  public int decrementAndGet() {
+    return getAndAdd(-1) - 1;
+  }
+
+  public byte byteValue() {
+    return (byte) value;
+  }
+
+  public short shortValue() {
+    return (short) value;
+  }
+
+  public int intValue() {
+    return value;
+  }
+
+  public long longValue() {
+    return value;
+  }
+
+  public float floatValue() {
+    return value;
+  }
+
+  public double doubleValue() {
+    return value;
+  }
+
+  public String toString() {
+    return String.valueOf(value);
+  }
+}
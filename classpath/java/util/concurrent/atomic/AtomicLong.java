@@ -0,0 +1,121 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent.atomic;
+
+import sun.misc.Unsafe;
+
+public class AtomicLong extends Number {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+  private static final long valueOffset;
+
+  static {
+    try {
+      valueOffset = unsafe.objectFieldOffset
+        (AtomicLong.class.getDeclaredField("value"));
+    } catch (NoSuchFieldException e) {
+      throw new Error(e);
+    }
+  }
+
+  private volatile long value;
+
+  public AtomicLong(long value) {
+    this.value = value;
+  }
+
+  public AtomicLong() { }
+
+  public long get() {
+    return value;
+  }
+
+  public void set(long value) {
+    this.value = value;
+  }
+
+  public void lazySet(long value) {
+    this.value = value;
+  }
+
+  public boolean compareAndSet(long expect, long update) {
+    return unsafe.compareAndSwapLong(this, valueOffset, expect, update);
+  }
+
+  public boolean weakCompareAndSet(long expect, long update) {
+    return compareAndSet(expect, update);
+  }
+
+  public long getAndSet(long value) {
+    while (true) {
+      long v = this.value;
+      if (compareAndSet(v, value)) {
+        return v;
+      }
+    }
+  }
+
+  public long getAndAdd(long delta) {
+    while (true) {
+      long v = value;
+      if (compareAndSet(v, v + delta)) {
+        return v;
+      }
+    }
+  }
+
+  public long addAndGet(long delta) {
+    return getAndAdd(delta) + delta;
+  }
+
+  public long getAndIncrement() {
+    return getAndAdd(1);
+  }
+
+  public long getAndDecrement() {
+    return getAndAdd(-1);
+  }
+
+  public long incrementAndGet() {
+    return getAndAdd(1) + 1;
+  }
+
+  public long decrementAndGet() {
+    return getAndAdd(-1) - 1;
+  }
+
+  public byte byteValue() {
+    return (byte) value;
+  }
+
+  public short shortValue() {
+    return (short) value;
+  }
+
+  public int intValue() {
+    return (int) value;
+  }
+
+  public long longValue() {
+    return value;
+  }
+
+  public float floatValue() {
+    return value;
+  }
+
+  public double doubleValue() {
+    return value;
+  }
+
+  public String toString() {
+    return String.valueOf(value);
+  }
+}
@@ -0,0 +1,68 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent.atomic;
+
+import sun.misc.Unsafe;
+
+public class AtomicReference<T> {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+  private static final long valueOffset;
+
+  static {
+    try {
+      valueOffset = unsafe.objectFieldOffset
+        (AtomicReference.class.getDeclaredField("value"));
+    } catch (NoSuchFieldException e) {
+      throw new Error(e);
+    }
+  }
+
+  private volatile T value;
+
+  public AtomicReference(T value) {
+    this.value = value;
+  }
+
+  public AtomicReference() { }
+
+  public T get() {
+    return value;
+  }
+
+  public void set(T value) {
+    this.value = value;
+  }
+
+  public void lazySet(T value) {
+    this.value = value;
+  }
+
+  public boolean compareAndSet(T expect, T update) {
+    return unsafe.compareAndSwapObject(this, valueOffset, expect, update);
+  }
+
+  public boolean weakCompareAndSet(T expect, T update) {
+    return compareAndSet(expect, update);
+  }
+
+  public T getAndSet(T value) {
+    while (true) {
+      T v = this.value;
+      if (compareAndSet(v, value)) {
+        return v;
+      }
+    }
+  }
+
+  public String toString() {
+    return String.valueOf(value);
+  }
+}
@@ -0,0 +1,365 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent.locks;
+
+import java.util.Date;
+import java.util.LinkedList;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.TimeUnit;
+import sun.misc.Unsafe;
+
+public class ReentrantLock implements Lock {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+  private static final long stateOffset;
+  private static final long waitingOffset;
+
+  static {
+    try {
+      stateOffset = unsafe.objectFieldOffset
+        (ReentrantLock.class.getDeclaredField("state"));
+      waitingOffset = unsafe.objectFieldOffset
+        (Waiter.class.getDeclaredField("waiting"));
+    } catch (NoSuchFieldException e) {
+      throw new Error(e);
+    }
+  }
+
+  // 1 while some thread owns the lock, 0 otherwise
+  private volatile int state;
+  private volatile Thread owner;
+  // only read or written by the owner
+  private int holds;
+
+  // threads blocked in acquire, each of which is woken by at most one
+  // releaser
+  private final ConcurrentLinkedQueue<Waiter> waiters
+    = new ConcurrentLinkedQueue();
+
+  public ReentrantLock() { }
+
+  // fair ordering is not implemented: an arriving thread may take a
+  // released lock ahead of those already queued
+  public ReentrantLock(boolean fair) { }
+
+  private boolean tryAcquire(Thread current) {
+    if (state == 0 && unsafe.compareAndSwapInt(this, stateOffset, 0, 1)) {
+      owner = current;
+      holds = 1;
+      return true;
+    } else if (owner == current) {
+      ++ holds;
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  private void signalNext() {
+    Waiter w;
+    while ((w = waiters.poll()) != null) {
+      if (w.claim()) {
+        LockSupport.unpark(w.thread);
+        return;
+      }
+    }
+  }
+
+  // returns false if the deadline passed or, when interruptible, the
+  // thread was interrupted, leaving its interrupt flag set
+  private boolean acquire(boolean interruptible, boolean timed,
+                          long deadline)
+  {
+    Thread current = Thread.currentThread();
+    if (tryAcquire(current)) {
+      return true;
+    }
+
+    boolean interrupted = false;
+    try {
+      while (true) {
+        Waiter w = new Waiter(current);
+        waiters.add(w);
+
+        // the lock may have been released before we were queued, in
+        // which case nobody will wake us, so try again before parking
+        while (w.waiting != 0) {
+          if (tryAcquire(current)) {
+            w.claim();
+            return true;
+          }
+
+          if (timed) {
+            long remaining = deadline - System.nanoTime();
+            if (remaining <= 0) {
+              cancel(w);
+              return false;
+            }
+            LockSupport.parkNanos(this, remaining);
+          } else {
+            LockSupport.park(this);
+          }
+
+          if (Thread.interrupted()) {
+            interrupted = true;
+            if (interruptible) {
+              cancel(w);
+              return false;
+            }
+          }
+        }
+
+        // we were woken by a release, but another thread may have
+        // taken the lock first
+        if (tryAcquire(current)) {
+          return true;
+        }
+      }
+    } finally {
+      if (interrupted) {
+        current.interrupt();
+      }
+    }
+  }
+
+  private void cancel(Waiter w) {
+    if (! w.claim()) {
+      // a releaser chose us to wake; pass that on to someone else
+      signalNext();
+    }
+  }
+
+  public void lock() {
+    acquire(false, false, 0);
+  }
+
+  public void lockInterruptibly() throws InterruptedException {
+    if (Thread.interrupted() || ! acquire(true, false, 0)) {
+      Thread.interrupted();
+      throw new InterruptedException();
+    }
+  }
+
+  public boolean tryLock() {
+    return tryAcquire(Thread.currentThread());
+  }
+
+  public boolean tryLock(long time, TimeUnit unit)
+    throws InterruptedException
+  {
+    if (Thread.interrupted()) {
+      throw new InterruptedException();
+    }
+
+    if (acquire(true, true, System.nanoTime() + unit.toNanos(time))) {
+      return true;
+    } else if (Thread.interrupted()) {
+      throw new InterruptedException();
+    } else {
+      return false;
+    }
+  }
+
+  public void unlock() {
+    if (owner != Thread.currentThread()) {
+      throw new IllegalMonitorStateException();
+    }
+
+    if (-- holds == 0) {
+      owner = null;
+      state = 0;
+      signalNext();
+    }
+  }
+
+  private int releaseAll() {
+    if (owner != Thread.currentThread()) {
+      throw new IllegalMonitorStateException();
+    }
+
+    int saved = holds;
+    holds = 0;
+    owner = null;
+    state = 0;
+    signalNext();
+    return saved;
+  }
+
+  private void reacquire(int saved) {
+    acquire(false, false, 0);
+    holds = saved;
+  }
+
+  public boolean isLocked() {
+    return state != 0;
+  }
+
+  public boolean isHeldByCurrentThread() {
+    return owner == Thread.currentThread();
+  }
+
+  public int getHoldCount() {
+    return isHeldByCurrentThread() ? holds : 0;
+  }
+
+  public boolean hasQueuedThreads() {
+    return waiters.peek() != null;
+  }
+
+  public Condition newCondition() {
+    return new ConditionObject();
+  }
+
+  private static class Waiter {
+    public final Thread thread;
+    public volatile int waiting = 1;
+
+    public Waiter(Thread thread) {
+      this.thread = thread;
+    }
+
+    // returns true if this call, and no other, took the waiter out of
+    // the waiting state
+    public boolean claim() {
+      return waiting != 0
+        && unsafe.compareAndSwapInt(this, waitingOffset, 1, 0);
+    }
+  }
+
+  private class ConditionObject implements Condition {
+    // only accessed while holding the lock
+    private final LinkedList<Waiter> waiters = new LinkedList();
+
+    // returns true if signalled before the deadline passed or the
+    // thread was interrupted
+    private boolean await(boolean interruptible, boolean timed,
+                          long deadline)
+    {
+      Waiter w = new Waiter(Thread.currentThread());
+      int saved;
+      if (owner == w.thread) {
+        waiters.add(w);
+        saved = releaseAll();
+      } else {
+        throw new IllegalMonitorStateException();
+      }
+
+      boolean interrupted = false;
+      while (w.waiting != 0) {
+        if (timed) {
+          long remaining = deadline - System.nanoTime();
+          if (remaining <= 0) {
+            break;
+          }
+          LockSupport.parkNanos(this, remaining);
+        } else {
+          LockSupport.park(this);
+        }
+
+        if (Thread.interrupted()) {
+          interrupted = true;
+          if (interruptible) {
+            break;
+          }
+        }
+      }
+
+      reacquire(saved);
+
+      boolean signalled = ! w.claim();
+      if (! signalled) {
+        waiters.remove(w);
+      }
+
+      if (interrupted) {
+        w.thread.interrupt();
+      }
+
+      return signalled;
+    }
+
+    private void checkInterrupt(boolean signalled)
+      throws InterruptedException
+    {
+      // an interrupt which arrives after a signal is left pending
+      // rather than thrown
+      if ((! signalled) && Thread.interrupted()) {
+        throw new InterruptedException();
+      }
+    }
+
+    public void await() throws InterruptedException {
+      if (Thread.interrupted()) {
+        throw new InterruptedException();
+      }
+
+      checkInterrupt(await(true, false, 0));
+    }
+
+    public void awaitUninterruptibly() {
+      await(false, false, 0);
+    }
+
+    public long awaitNanos(long nanoseconds) throws InterruptedException {
+      if (Thread.interrupted()) {
+        throw new InterruptedException();
+      }
+
+      long deadline = System.nanoTime() + nanoseconds;
+      checkInterrupt(await(true, true, deadline));
+      return deadline - System.nanoTime();
+    }
+
+    public boolean await(long time, TimeUnit unit)
+      throws InterruptedException
+    {
+      if (Thread.interrupted()) {
+        throw new InterruptedException();
+      }
+
+      boolean signalled = await
+        (true, true, System.nanoTime() + unit.toNanos(time));
+      checkInterrupt(signalled);
+      return signalled;
+    }
+
+    public boolean awaitUntil(Date deadline) throws InterruptedException {
+      return await(deadline.getTime() - System.currentTimeMillis(),
+                   TimeUnit.MILLISECONDS);
+    }
+
+    public void signal() {
+      if (owner != Thread.currentThread()) {
+        throw new IllegalMonitorStateException();
+      }
+
+      while (! waiters.isEmpty()) {
+        Waiter w = waiters.removeFirst();
+        if (w.claim()) {
+          LockSupport.unpark(w.thread);
+          return;
+        }
+      }
+    }
+
+    public void signalAll() {
+      if (owner != Thread.currentThread()) {
+        throw new IllegalMonitorStateException();
+      }
+
+      while (! waiters.isEmpty()) {
+        Waiter w = waiters.removeFirst();
+        if (w.claim()) {
+          LockSupport.unpark(w.thread);
+        }
+      }
+    }
+  }
+}
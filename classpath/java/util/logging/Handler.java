@@ -13,4 +13,10 @@ package java.util.logging;
 public class Handler {
   public void publish(LogRecord r) {
   }
+
+  public void flush() {
+  }
+
+  public void close() {
+  }
 }
@@ -16,11 +16,17 @@ public class LogRecord {
   private final Throwable thrown;
   private final Level level;
   private final String methodName;
+  private final Object[] parameters;
+
+  public LogRecord(Level level, String message) {
+    this(null, null, level, message, null, null);
+  }
 
   LogRecord(String loggerName, String methodName, Level level, String message,
-            Throwable thrown) {
+            Object[] parameters, Throwable thrown) {
     this.loggerName = loggerName;
     this.message = message;
+    this.parameters = parameters;
     this.thrown = thrown;
     this.level = level;
     this.methodName = methodName;
@@ -45,4 +51,8 @@ public class LogRecord {
   public String getSourceMethodName() {
     return methodName;
   }
+
+  public Object[] getParameters() {
+    return parameters;
+  }
 }
@@ -55,35 +55,66 @@ public class Logger {
     return parent;
   }
 
+  // Each of the following checks the level before finding its caller,
+  // since that means walking the stack, and most calls to methods like
+  // fine are disabled.
+
   public void fine(String message) {
-    log(Level.FINE, Method.getCaller(), message, null);
+    if (isLoggable(Level.FINE)) {
+      log(Level.FINE, Method.getCaller(), message, null, null);
+    }
   }
 
   public void info(String message) {
-    log(Level.INFO, Method.getCaller(), message, null);
+    if (isLoggable(Level.INFO)) {
+      log(Level.INFO, Method.getCaller(), message, null, null);
+    }
   }
 
   public void warning(String message) {
-    log(Level.WARNING, Method.getCaller(), message, null);
+    if (isLoggable(Level.WARNING)) {
+      log(Level.WARNING, Method.getCaller(), message, null, null);
+    }
   }
 
   public void severe(String message) {
-    log(Level.SEVERE, Method.getCaller(), message, null);
+    if (isLoggable(Level.SEVERE)) {
+      log(Level.SEVERE, Method.getCaller(), message, null, null);
+    }
   }
 
   public void log(Level level, String message) {
-    log(level, Method.getCaller(), message, null);
+    if (isLoggable(level)) {
+      log(level, Method.getCaller(), message, null, null);
+    }
   }
 
   public void log(Level level, String message, Throwable exception) {
-    log(level, Method.getCaller(), message, exception);
+    if (isLoggable(level)) {
+      log(level, Method.getCaller(), message, null, exception);
+    }
+  }
+
+  // the message is only formatted with the parameter if and when a
+  // handler publishes the record
+  public void log(Level level, String message, Object parameter) {
+    if (isLoggable(level)) {
+      log(level, Method.getCaller(), message, new Object[] { parameter },
+          null);
+    }
+  }
+
+  public void log(Level level, String message, Object[] parameters) {
+    if (isLoggable(level)) {
+      log(level, Method.getCaller(), message, parameters, null);
+    }
   }
 
   public void logp(Level level, String sourceClass, String sourceMethod, String msg) {
 	if (!isLoggable(level)) {
 		return;
 	}
-    publish(new LogRecord(name, sourceMethod, level, msg, null));
+    publish(new LogRecord(name, sourceMethod, level, msg, null, null));
   }
   
   public void logp(Level level, String sourceClass, String sourceMethod,
@@ -91,7 +122,7 @@ public class Logger {
 	if (!isLoggable(level)) {
 	  return;
 	}
-	publish(new LogRecord(name, sourceMethod, level, msg, thrown));
+	publish(new LogRecord(name, sourceMethod, level, msg, null, thrown));
   }
 
   public Level getLevel() {
@@ -108,14 +139,10 @@ public class Logger {
   }
       
   private void log(Level level, avian.VMMethod caller, String message,
-                   Throwable exception) {
-    
-    if (level.intValue() < getEffectiveLevel().intValue()) {
-      return;
-    }
+                   Object[] parameters, Throwable exception) {
     LogRecord r = new LogRecord
       (name, caller == null ? "<unknown>" : Method.getName(caller), level,
-       message, exception);
+       message, parameters, exception);
     publish(r);
   }
 
@@ -130,9 +157,18 @@ public class Logger {
   }
   
   public boolean isLoggable(Level level) {
-    return level.intValue() >= levelValue.intValue();
+    return level.intValue() >= getEffectiveLevel().intValue();
   }
   
+  static String formatMessage(LogRecord r) {
+    Object[] parameters = r.getParameters();
+    if (parameters == null || parameters.length == 0) {
+      return r.getMessage();
+    } else {
+      return java.text.MessageFormat.format(r.getMessage(), parameters);
+    }
+  }
+
   private static class DefaultHandler extends Handler {
     private static final int NAME_WIDTH = 14;
     private static final int METHOD_WIDTH = 15;
@@ -191,7 +227,7 @@ public class Logger {
       indent(sb, METHOD_WIDTH - r.getSourceMethodName().length());
       sb.append(r.getLevel().getName());
       indent(sb, LEVEL_WIDTH - r.getLevel().getName().length());
-      sb.append(r.getMessage());
+      sb.append(formatMessage(r));
       maybeLogThrown(sb, r.getThrown());
       System.out.println(sb.toString());
     }
@@ -0,0 +1,258 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.regex;
+
+/**
+ * Runs a Program by backtracking, which, unlike the DFA, can match
+ * back references, lookarounds and atomic groups, and can find the
+ * bounds of groups.  Alternatives not yet tried are kept on an
+ * explicit stack, along with the old values of slots to restore when
+ * backtracking past the instruction which set them.
+ */
+class Backtracker {
+  private static final int Branch = 0;
+  private static final int Restore = 1;
+
+  private final Program program;
+  private int[] stack = new int[3 * 32];
+  private int top;
+
+  private CharSequence input;
+  private int start;
+  private int end;
+  private int lastMatchEnd;
+  private int[] slots;
+
+  public Backtracker(Program program) {
+    this.program = program;
+  }
+
+  // tries to match the input at position within the region from start
+  // to end, filling slots with the bounds of the groups if it
+  // succeeds; if requiredEnd is not negative, the match must end there
+  public boolean match(CharSequence input, int start, int end,
+                       int lastMatchEnd, int position, int requiredEnd,
+                       int[] slots)
+  {
+    this.input = input;
+    this.start = start;
+    this.end = end;
+    this.lastMatchEnd = lastMatchEnd;
+    this.slots = slots;
+    for (int i = 0; i < slots.length; ++i) {
+      slots[i] = -1;
+    }
+
+    top = 0;
+    boolean matched = run(0, position, requiredEnd) >= 0;
+
+    this.input = null;
+    this.slots = null;
+    return matched;
+  }
+
+  private void push(int kind, int a, int b) {
+    if (top + 3 > stack.length) {
+      int[] copy = new int[stack.length * 2];
+      System.arraycopy(stack, 0, copy, 0, top);
+      stack = copy;
+    }
+    stack[top++] = kind;
+    stack[top++] = a;
+    stack[top++] = b;
+  }
+
+  private void set(int slot, int position) {
+    push(Restore, slot, slots[slot]);
+    slots[slot] = position;
+  }
+
+  // discards the alternatives pushed since mark, keeping what is
+  // needed to restore the slots set since then
+  private void commit(int mark) {
+    int to = mark;
+    for (int i = mark; i < top; i += 3) {
+      if (stack[i] == Restore) {
+        stack[to] = Restore;
+        stack[to + 1] = stack[i + 1];
+        stack[to + 2] = stack[i + 2];
+        to += 3;
+      }
+    }
+    top = to;
+  }
+
+  // restores the slots set since mark
+  private void undo(int mark) {
+    while (top > mark) {
+      top -= 3;
+      if (stack[top] == Restore) {
+        slots[stack[top + 1]] = stack[top + 2];
+      }
+    }
+  }
+
+  private boolean backReference(int group, boolean ignoreCase, int position)
+  {
+    int s = slots[group * 2];
+    int e = slots[(group * 2) + 1];
+    if (s < 0 || e < 0 || position + (e - s) > end) {
+      return false;
+    }
+
+    for (int i = s; i < e; ++i) {
+      char a = input.charAt(i);
+      char b = input.charAt(position + (i - s));
+      if (a != b && ! (ignoreCase
+                       && (Character.toLowerCase(a)
+                           == Character.toLowerCase(b)
+                           || Character.toUpperCase(a)
+                           == Character.toUpperCase(b))))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  private boolean look(int pc, int kind, int position) {
+    int mark = top;
+    boolean found;
+    if ((kind & Program.LookBehind) != 0) {
+      found = false;
+      int limit = Math.max(start, position - (kind >>> 2));
+      for (int p = position; p >= limit && ! found; --p) {
+        found = run(pc, p, position) >= 0;
+      }
+    } else {
+      found = run(pc, position, -1) >= 0;
+    }
+
+    if ((kind & Program.Negative) != 0) {
+      if (found) {
+        undo(mark);
+      }
+      return ! found;
+    } else {
+      if (found) {
+        commit(mark);
+      }
+      return found;
+    }
+  }
+
+  // runs the program from pc until it reaches a Match, or, when
+  // running a lookaround or atomic group, a Succeed, returning the
+  // position there, or -1 if there is no such path
+  private int run(int pc, int position, int requiredEnd) {
+    final int[] op = program.op;
+    final int[] x = program.x;
+    final int[] y = program.y;
+    final int base = top;
+
+    while (true) {
+      boolean ok;
+      switch (op[pc]) {
+      case Program.Set:
+        ok = position < end
+          && program.sets[pc].contains(input.charAt(position));
+        if (ok) {
+          ++ position;
+          ++ pc;
+        }
+        break;
+
+      case Program.Split:
+        push(Branch, y[pc], position);
+        pc = x[pc];
+        ok = true;
+        break;
+
+      case Program.Jump:
+        pc = x[pc];
+        ok = true;
+        break;
+
+      case Program.Save:
+      case Program.Mark:
+        set(x[pc], position);
+        ++ pc;
+        ok = true;
+        break;
+
+      case Program.Check:
+        pc = slots[x[pc]] == position ? y[pc] : pc + 1;
+        ok = true;
+        break;
+
+      case Program.Match:
+      case Program.Succeed:
+        if (requiredEnd < 0 || position == requiredEnd) {
+          return position;
+        }
+        ok = false;
+        break;
+
+      case Program.Assert:
+        ok = program.holds
+          (x[pc], input, position, start, end, lastMatchEnd);
+        ++ pc;
+        break;
+
+      case Program.BackReference: {
+        int group = x[pc];
+        ok = group <= program.groupCount
+          && backReference(group, y[pc] != 0, position);
+        if (ok) {
+          position += slots[(group * 2) + 1] - slots[group * 2];
+          ++ pc;
+        }
+      } break;
+
+      case Program.Look:
+        ok = look(x[pc], y[pc], position);
+        ++ pc;
+        break;
+
+      case Program.Atomic: {
+        int mark = top;
+        int p = run(x[pc], position, -1);
+        ok = p >= 0;
+        if (ok) {
+          commit(mark);
+          position = p;
+          ++ pc;
+        }
+      } break;
+
+      default:
+        throw new IllegalStateException();
+      }
+
+      if (! ok) {
+        while (true) {
+          if (top == base) {
+            return -1;
+          }
+
+          top -= 3;
+          if (stack[top] == Restore) {
+            slots[stack[top + 1]] = stack[top + 2];
+          } else {
+            pc = stack[top + 1];
+            position = stack[top + 2];
+            break;
+          }
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,220 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.regex;
+
+/**
+ * An immutable set of chars, kept as sorted, disjoint, non-adjacent
+ * inclusive ranges, with a bitmap for fast lookup of ASCII chars.
+ */
+class CharSet {
+  private static final int Limit = 0x10000;
+
+  public static final CharSet Empty = new CharSet(new int[0]);
+  public static final CharSet All = range(0, Limit - 1);
+
+  private final int[] ranges;
+  private final long low;
+  private final long high;
+
+  private CharSet(int[] ranges) {
+    this.ranges = ranges;
+
+    long low = 0;
+    long high = 0;
+    for (int c = 0; c < 128; ++c) {
+      if (search(c)) {
+        if (c < 64) {
+          low |= 1L << c;
+        } else {
+          high |= 1L << (c - 64);
+        }
+      }
+    }
+    this.low = low;
+    this.high = high;
+  }
+
+  public static CharSet of(int c) {
+    return range(c, c);
+  }
+
+  public static CharSet range(int first, int last) {
+    return new CharSet(new int[] { first, last });
+  }
+
+  public static CharSet of(String chars) {
+    CharSet set = Empty;
+    for (int i = 0; i < chars.length(); ++i) {
+      set = set.union(of(chars.charAt(i)));
+    }
+    return set;
+  }
+
+  private boolean search(int c) {
+    int bottom = 0;
+    int top = ranges.length / 2;
+    while (bottom < top) {
+      int middle = (bottom + top) >>> 1;
+      if (c < ranges[middle * 2]) {
+        top = middle;
+      } else if (c > ranges[(middle * 2) + 1]) {
+        bottom = middle + 1;
+      } else {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  public boolean contains(char c) {
+    if (c < 64) {
+      return ((low >>> c) & 1) != 0;
+    } else if (c < 128) {
+      return ((high >>> (c - 64)) & 1) != 0;
+    } else {
+      return search(c);
+    }
+  }
+
+  public boolean isEmpty() {
+    return ranges.length == 0;
+  }
+
+  // the number of chars in the set
+  public int size() {
+    int size = 0;
+    for (int i = 0; i < ranges.length; i += 2) {
+      size += ranges[i + 1] - ranges[i] + 1;
+    }
+    return size;
+  }
+
+  // the only char in the set, or -1 if it doesn't hold exactly one
+  public int single() {
+    if (ranges.length == 2 && ranges[0] == ranges[1]) {
+      return ranges[0];
+    } else {
+      return -1;
+    }
+  }
+
+  public int rangeCount() {
+    return ranges.length / 2;
+  }
+
+  public int first(int range) {
+    return ranges[range * 2];
+  }
+
+  public int last(int range) {
+    return ranges[(range * 2) + 1];
+  }
+
+  public CharSet union(CharSet o) {
+    if (o.isEmpty()) {
+      return this;
+    } else if (isEmpty()) {
+      return o;
+    }
+
+    int[] merged = new int[ranges.length + o.ranges.length];
+    int count = 0;
+    int i = 0;
+    int j = 0;
+    while (i < ranges.length || j < o.ranges.length) {
+      int first;
+      int last;
+      if (j >= o.ranges.length
+          || (i < ranges.length && ranges[i] <= o.ranges[j]))
+      {
+        first = ranges[i];
+        last = ranges[i + 1];
+        i += 2;
+      } else {
+        first = o.ranges[j];
+        last = o.ranges[j + 1];
+        j += 2;
+      }
+
+      if (count > 0 && first <= merged[count - 1] + 1) {
+        if (last > merged[count - 1]) {
+          merged[count - 1] = last;
+        }
+      } else {
+        merged[count++] = first;
+        merged[count++] = last;
+      }
+    }
+
+    int[] result = new int[count];
+    System.arraycopy(merged, 0, result, 0, count);
+    return new CharSet(result);
+  }
+
+  public CharSet complement() {
+    int[] gaps = new int[ranges.length + 2];
+    int count = 0;
+    int next = 0;
+    for (int i = 0; i < ranges.length; i += 2) {
+      if (ranges[i] > next) {
+        gaps[count++] = next;
+        gaps[count++] = ranges[i] - 1;
+      }
+      next = ranges[i + 1] + 1;
+    }
+    if (next < Limit) {
+      gaps[count++] = next;
+      gaps[count++] = Limit - 1;
+    }
+
+    int[] result = new int[count];
+    System.arraycopy(gaps, 0, result, 0, count);
+    return new CharSet(result);
+  }
+
+  public CharSet intersection(CharSet o) {
+    return complement().union(o.complement()).complement();
+  }
+
+  // adds the other case of each letter, limited to ASCII unless
+  // unicode is true
+  public CharSet caseInsensitive(boolean unicode) {
+    CharSet set = this;
+    if (unicode) {
+      if (size() < Limit) {
+        for (int i = 0; i < ranges.length; i += 2) {
+          for (int c = ranges[i]; c <= ranges[i + 1]; ++c) {
+            char lower = Character.toLowerCase((char) c);
+            char upper = Character.toUpperCase((char) c);
+            if (lower != c) {
+              set = set.union(of(lower));
+            }
+            if (upper != c) {
+              set = set.union(of(upper));
+            }
+          }
+        }
+      }
+    } else {
+      for (int c = 'a'; c <= 'z'; ++c) {
+        if (contains((char) c)) {
+          set = set.union(of(c - 'a' + 'A'));
+        }
+      }
+      for (int c = 'A'; c <= 'Z'; ++c) {
+        if (contains((char) c)) {
+          set = set.union(of(c - 'A' + 'a'));
+        }
+      }
+    }
+    return set;
+  }
+}
@@ -0,0 +1,320 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.regex;
+
+import java.util.Arrays;
+import java.util.HashMap;
+
+/**
+ * A DFA built lazily from a Program, one state at a time as the input
+ * requires it.  Each state is the list of NFA threads, in priority
+ * order, which are waiting at Set instructions.  Chars are grouped
+ * into classes which no set in the program tells apart, so each
+ * state needs only one transition per class.
+ *
+ * This only works for programs whose control flow doesn't depend on
+ * anything but the input and whether the position is at the
+ * beginning of the region; see Node.deterministic.
+ */
+class DFA {
+  // the most transitions to keep before discarding all the states
+  private static final int Budget = 64 * 1024;
+
+  private final Program program;
+  // if true, threads of lower priority than one which has matched are
+  // dropped, so the last match found is the leftmost-first one
+  private final boolean firstMatch;
+  // if true, a new thread starts from every position
+  private final boolean unanchored;
+
+  private final int[] bounds;
+  private final int[] asciiClasses = new int[128];
+
+  private final HashMap<Key, State> states = new HashMap<Key, State>();
+  private int transitions;
+  private State beginning;
+  private State elsewhere;
+
+  private final int[] threads;
+  private int threadCount;
+  private final int[] work;
+  private final int[] visited;
+  private int generation;
+
+  public DFA(Program program, boolean firstMatch, boolean unanchored) {
+    this.program = program;
+    this.firstMatch = firstMatch;
+    this.unanchored = unanchored;
+
+    int count = 1;
+    for (int pc = 0; pc < program.length; ++pc) {
+      if (program.op[pc] == Program.Set) {
+        count += program.sets[pc].rangeCount() * 2;
+      }
+    }
+
+    int[] bounds = new int[count];
+    count = 1;
+    for (int pc = 0; pc < program.length; ++pc) {
+      if (program.op[pc] == Program.Set) {
+        CharSet set = program.sets[pc];
+        for (int i = 0; i < set.rangeCount(); ++i) {
+          bounds[count++] = set.first(i);
+          bounds[count++] = set.last(i) + 1;
+        }
+      }
+    }
+    Arrays.sort(bounds);
+
+    int unique = 0;
+    for (int i = 0; i < bounds.length; ++i) {
+      if (bounds[i] <= 0xFFFF
+          && (unique == 0 || bounds[i] != bounds[unique - 1]))
+      {
+        bounds[unique++] = bounds[i];
+      }
+    }
+    this.bounds = new int[unique];
+    System.arraycopy(bounds, 0, this.bounds, 0, unique);
+
+    for (int c = 0; c < asciiClasses.length; ++c) {
+      asciiClasses[c] = search((char) c);
+    }
+
+    threads = new int[program.length];
+    work = new int[(program.length * 2) + 1];
+    visited = new int[program.length];
+  }
+
+  // the index of the last class bound not greater than c
+  private int search(char c) {
+    int bottom = 0;
+    int top = bounds.length;
+    while (top - bottom > 1) {
+      int middle = (bottom + top) >>> 1;
+      if (c < bounds[middle]) {
+        top = middle;
+      } else {
+        bottom = middle;
+      }
+    }
+    return bottom;
+  }
+
+  private int classOf(char c) {
+    return c < 128 ? asciiClasses[c] : search(c);
+  }
+
+  // runs the DFA over the input from position, within the region from
+  // start to end, returning the last position at which it matched, or,
+  // if first is true, the first such position, or -1 if it never did
+  public int run(CharSequence input, int position, int start, int end,
+                 boolean first)
+  {
+    State s = position == start ? beginning : elsewhere;
+    if (s == null) {
+      s = initial(position == start);
+    }
+
+    int result = -1;
+    while (true) {
+      if (s.matching) {
+        result = position;
+        if (first) {
+          return result;
+        }
+      }
+
+      if (position == end || s.pcs.length == 0) {
+        return result;
+      }
+
+      int c = classOf(input.charAt(position++));
+      State next = s.next[c];
+      if (next == null) {
+        next = next(s, c);
+      }
+      s = next;
+    }
+  }
+
+  private synchronized State initial(boolean atBeginning) {
+    State s = atBeginning ? beginning : elsewhere;
+    if (s == null) {
+      ++ generation;
+      threadCount = 0;
+      s = intern(closure(0, atBeginning));
+      if (atBeginning) {
+        beginning = s;
+      } else {
+        elsewhere = s;
+      }
+    }
+    return s;
+  }
+
+  private synchronized State next(State s, int c) {
+    State next = s.next[c];
+    if (next == null) {
+      char representative = (char) bounds[c];
+      ++ generation;
+      threadCount = 0;
+      boolean matching = false;
+      for (int i = 0; i < s.pcs.length; ++i) {
+        int pc = s.pcs[i];
+        if (program.sets[pc].contains(representative)) {
+          if (closure(pc + 1, false)) {
+            matching = true;
+            if (firstMatch) {
+              break;
+            }
+          }
+        }
+      }
+
+      if (unanchored && ! (matching && firstMatch)) {
+        matching |= closure(0, false);
+      }
+
+      next = intern(matching);
+      s.next[c] = next;
+    }
+    return next;
+  }
+
+  // adds the threads reachable from pc without consuming input, in
+  // priority order, returning true if the program matches on the way
+  private boolean closure(int pc, boolean atBeginning) {
+    final int[] op = program.op;
+    boolean matched = false;
+    int top = 0;
+    work[top++] = pc;
+    while (top > 0) {
+      pc = work[--top];
+      if (visited[pc] == generation) {
+        continue;
+      }
+      visited[pc] = generation;
+
+      switch (op[pc]) {
+      case Program.Set:
+        threads[threadCount++] = pc;
+        break;
+
+      case Program.Split:
+        work[top++] = program.y[pc];
+        work[top++] = program.x[pc];
+        break;
+
+      case Program.Jump:
+        work[top++] = program.x[pc];
+        break;
+
+      case Program.Save:
+      case Program.Mark:
+      case Program.Check:
+        work[top++] = pc + 1;
+        break;
+
+      case Program.Assert:
+        if (program.x[pc] != Program.BeginText) {
+          throw new IllegalStateException();
+        }
+        if (atBeginning) {
+          work[top++] = pc + 1;
+        }
+        break;
+
+      case Program.Match:
+        if (firstMatch) {
+          return true;
+        }
+        matched = true;
+        break;
+
+      default:
+        throw new IllegalStateException();
+      }
+    }
+    return matched;
+  }
+
+  private State intern(boolean matching) {
+    int[] pcs = new int[threadCount];
+    System.arraycopy(threads, 0, pcs, 0, threadCount);
+    Key key = new Key(pcs, matching);
+    State s = states.get(key);
+    if (s == null) {
+      int classCount = bounds.length;
+      if (transitions + classCount > Budget) {
+        states.clear();
+        transitions = 0;
+        beginning = null;
+        elsewhere = null;
+      }
+
+      s = new State(pcs, matching, classCount);
+      states.put(key, s);
+      transitions += classCount;
+    }
+    return s;
+  }
+
+  private static class State {
+    public final int[] pcs;
+    public final boolean matching;
+    public final State[] next;
+
+    public State(int[] pcs, boolean matching, int classCount) {
+      this.pcs = pcs;
+      this.matching = matching;
+      this.next = new State[classCount];
+    }
+  }
+
+  private static class Key {
+    private final int[] pcs;
+    private final boolean matching;
+    private final int hashCode;
+
+    public Key(int[] pcs, boolean matching) {
+      this.pcs = pcs;
+      this.matching = matching;
+
+      int h = matching ? 1 : 0;
+      for (int i = 0; i < pcs.length; ++i) {
+        h = (h * 31) + pcs[i];
+      }
+      this.hashCode = h;
+    }
+
+    public int hashCode() {
+      return hashCode;
+    }
+
+    public boolean equals(Object o) {
+      if (o instanceof Key) {
+        Key k = (Key) o;
+        if (k.hashCode == hashCode && k.matching == matching
+            && k.pcs.length == pcs.length)
+        {
+          for (int i = 0; i < pcs.length; ++i) {
+            if (k.pcs[i] != pcs[i]) {
+              return false;
+            }
+          }
+          return true;
+        }
+      }
+      return false;
+    }
+  }
+}
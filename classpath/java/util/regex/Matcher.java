@@ -11,100 +11,463 @@
 package java.util.regex;
 
 /**
- * This is a work in progress.
- * 
- * @author zsombor and others
+ * Finds matches of a Pattern in a CharSequence.  Literal patterns are
+ * found with indexOf, patterns the DFA can handle are matched by it,
+ * and the rest by backtracking.  The bounds of groups, which the DFA
+ * doesn't track, are found by backtracking only when asked for.
  */
 public class Matcher {
   private final Pattern pattern;
+  private final Program program;
+  private final int[] groups;
+  private Backtracker backtracker;
   private CharSequence input;
-  private int start;
-  private int end;
+  private int regionStart;
+  private int regionEnd;
+  // the bounds of the last match, or first is -1 if there is none
+  private int first;
+  private int last;
+  // true if groups holds the bounds of the groups of the last match
+  private boolean groupsFound;
+  // the end of the previous match, for \G
+  private int lastMatchEnd;
+  private int appendPosition;
 
   Matcher(Pattern pattern, CharSequence input) {
     this.pattern = pattern;
+    this.program = pattern.program;
+    this.groups = new int[program.slotCount];
+    reset(input);
+  }
+
+  public Pattern pattern() {
+    return pattern;
+  }
+
+  public Matcher reset() {
+    first = -1;
+    last = 0;
+    groupsFound = false;
+    lastMatchEnd = -1;
+    appendPosition = 0;
+    regionStart = 0;
+    regionEnd = input.length();
+    return this;
+  }
+
+  public Matcher reset(CharSequence input) {
     this.input = input;
+    return reset();
+  }
+
+  public Matcher region(int start, int end) {
+    if (start < 0 || start > end || end > input.length()) {
+      throw new IndexOutOfBoundsException();
+    }
+    reset();
+    regionStart = start;
+    regionEnd = end;
+    return this;
+  }
+
+  public int regionStart() {
+    return regionStart;
+  }
+
+  public int regionEnd() {
+    return regionEnd;
   }
 
   public boolean matches() {
-    if (pattern.pattern().equals(input.toString())) {
-      start = 0;
-      end = input.length();
+    return match(true);
+  }
+
+  public boolean lookingAt() {
+    return match(false);
+  }
+
+  public boolean find() {
+    int from = last;
+    if (from == first) {
+      // don't find the same empty match again
+      ++ from;
+    }
+    if (from < regionStart) {
+      from = regionStart;
+    }
+    if (from > regionEnd) {
+      first = -1;
+      return false;
+    }
+    return search(from);
+  }
+
+  public boolean find(int start) {
+    if (start < 0 || start > input.length()) {
+      throw new IndexOutOfBoundsException();
+    }
+    reset();
+    return search(start);
+  }
+
+  private Backtracker backtracker() {
+    if (backtracker == null) {
+      backtracker = new Backtracker(program);
+    }
+    return backtracker;
+  }
+
+  private boolean found(int start, int end) {
+    first = start;
+    last = end;
+    groupsFound = false;
+    return true;
+  }
+
+  private boolean backtrack(int position, int requiredEnd) {
+    if (backtracker().match(input, regionStart, regionEnd, lastMatchEnd,
+                            position, requiredEnd, groups))
+    {
+      first = groups[0];
+      last = groups[1];
+      groupsFound = true;
       return true;
     } else {
       return false;
     }
   }
 
-  public Matcher reset() {
-    return reset(input);
+  private boolean match(boolean whole) {
+    int from = regionStart;
+    if (lastMatchEnd < 0) {
+      lastMatchEnd = from;
+    }
+
+    boolean result;
+    if (program.literal) {
+      String prefix = program.prefix;
+      int end = from + prefix.length();
+      result = (whole ? end == regionEnd : end <= regionEnd)
+        && startsWith(input, prefix, from) && found(from, end);
+    } else if (program.deterministic) {
+      if (whole) {
+        result = program.wholeDFA().run
+          (input, from, regionStart, regionEnd, false) == regionEnd
+          && found(from, regionEnd);
+      } else {
+        int end = program.searchDFA().run
+          (input, from, regionStart, regionEnd, false);
+        result = end >= 0 && found(from, end);
+      }
+    } else {
+      result = backtrack(from, whole ? regionEnd : -1);
+    }
+
+    if (! result) {
+      first = -1;
+    }
+    lastMatchEnd = last;
+    return result;
   }
 
-  public Matcher reset(CharSequence input) {
-    this.input = input;
-    start = 0;
-    end = 0;
-    return this;
+  private boolean search(int from) {
+    if (lastMatchEnd < 0) {
+      lastMatchEnd = from;
+    }
+
+    boolean result = false;
+    if (program.literal) {
+      int start = indexOf(input, program.prefix, from, regionEnd);
+      result = start >= 0 && found(start, start + program.prefix.length());
+    } else if (program.anchored) {
+      result = from == regionStart && attempt(from);
+    } else if (program.prefix.length() == 0 && program.deterministic
+               && program.scanDFA().run
+               (input, from, regionStart, regionEnd, true) < 0)
+    {
+      // no match ends anywhere after from, so none starts there
+      result = false;
+    } else {
+      for (int position = candidate(from); position >= 0;
+           position = candidate(position + 1))
+      {
+        if (attempt(position)) {
+          result = true;
+          break;
+        }
+      }
+    }
+
+    if (! result) {
+      first = -1;
+    }
+    lastMatchEnd = last;
+    return result;
+  }
+
+  // tries to match at position
+  private boolean attempt(int position) {
+    if (program.deterministic) {
+      int end = program.searchDFA().run
+        (input, position, regionStart, regionEnd, false);
+      return end >= 0 && found(position, end);
+    } else {
+      return backtrack(position, -1);
+    }
+  }
+
+  // the first position from position on at which a match might start,
+  // or -1 if there is none
+  private int candidate(int position) {
+    if (position > regionEnd) {
+      return -1;
+    } else if (program.prefix.length() > 0) {
+      return indexOf(input, program.prefix, position, regionEnd);
+    } else if (program.firstChars != null) {
+      CharSet set = program.firstChars;
+      while (position < regionEnd && ! set.contains(input.charAt(position)))
+      {
+        ++ position;
+      }
+      return position < regionEnd ? position : -1;
+    } else {
+      return position;
+    }
+  }
+
+  private static boolean startsWith(CharSequence input, String prefix,
+                                    int start)
+  {
+    for (int i = 0; i < prefix.length(); ++i) {
+      if (input.charAt(start + i) != prefix.charAt(i)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // the first index from start on at which needle occurs in haystack,
+  // ending no later than end, or -1 if there is none
+  private static int indexOf(CharSequence haystack, String needle,
+                             int start, int end)
+  {
+    int last = end - needle.length();
+    if (needle.length() == 0) {
+      return start <= end ? start : -1;
+    } else if (haystack instanceof String) {
+      int i = ((String) haystack).indexOf(needle, start);
+      return i <= last ? i : -1;
+    }
+
+    char c = needle.charAt(0);
+    for (int i = start; i <= last; ++i) {
+      if (haystack.charAt(i) == c && startsWith(haystack, needle, i)) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  private void findGroups() {
+    if (first < 0) {
+      throw new IllegalStateException("No match available");
+    }
+
+    if (! groupsFound) {
+      if (program.groupCount == 0) {
+        groups[0] = first;
+        groups[1] = last;
+      } else if (! backtracker().match
+                 (input, regionStart, regionEnd, lastMatchEnd, first, last,
+                  groups))
+      {
+        throw new IllegalStateException();
+      }
+      groupsFound = true;
+    }
+  }
+
+  public int groupCount() {
+    return program.groupCount;
+  }
+
+  private void checkGroup(int group) {
+    if (group < 0 || group > program.groupCount) {
+      throw new IndexOutOfBoundsException("No group " + group);
+    }
   }
 
   public int start() {
-    return start;
+    if (first < 0) {
+      throw new IllegalStateException("No match available");
+    }
+    return first;
+  }
+
+  public int start(int group) {
+    checkGroup(group);
+    findGroups();
+    return groups[group * 2];
+  }
+
+  public int start(String name) {
+    return start(pattern.groupIndex(name));
+  }
+
+  public int end() {
+    if (first < 0) {
+      throw new IllegalStateException("No match available");
+    }
+    return last;
+  }
+
+  public int end(int group) {
+    checkGroup(group);
+    findGroups();
+    return groups[(group * 2) + 1];
+  }
+
+  public int end(String name) {
+    return end(pattern.groupIndex(name));
+  }
+
+  public String group() {
+    return group(0);
+  }
+
+  public String group(int group) {
+    checkGroup(group);
+    findGroups();
+    int start = groups[group * 2];
+    int end = groups[(group * 2) + 1];
+    if (start < 0 || end < 0) {
+      return null;
+    } else {
+      return input.subSequence(start, end).toString();
+    }
+  }
+
+  public String group(String name) {
+    return group(pattern.groupIndex(name));
   }
 
   public String replaceAll(String replacement) {
-    return replace(replacement, Integer.MAX_VALUE);
+    return replace(replacement, true);
   }
 
   public String replaceFirst(String replacement) {
-    return replace(replacement, 1);
+    return replace(replacement, false);
   }
 
-  private String replace(String replacement, int limit) {
+  private String replace(String replacement, boolean all) {
     reset();
+    if (! find()) {
+      return input.toString();
+    }
 
-    StringBuilder sb = null;
+    boolean plain = replacement.indexOf('$') < 0
+      && replacement.indexOf('\\') < 0;
+    StringBuilder sb = new StringBuilder();
     int index = 0;
-    int count = 0;
-    while (count < limit && index < input.length()) {
-      if (find(index)) {
-        if (sb == null) {
-          sb = new StringBuilder();
-        }
-        if (start > index) {
-          sb.append(input.subSequence(index, start));
-        }
+    do {
+      sb.append(input.subSequence(index, first));
+      if (plain) {
         sb.append(replacement);
-        index = end;
-        ++ count;
-      } else if (index == 0) {
-        return input.toString();
       } else {
-        break;
+        expand(replacement, sb);
       }
-    }
-    if (index < input.length()) {
-      sb.append(input.subSequence(index, input.length()));
-    }
+      index = last;
+    } while (all && find());
+
+    sb.append(input.subSequence(index, input.length()));
     return sb.toString();
   }
 
-  public int end() {
-    return end;
+  public Matcher appendReplacement(StringBuffer sb, String replacement) {
+    if (first < 0) {
+      throw new IllegalStateException("No match available");
+    }
+
+    StringBuilder expanded = new StringBuilder();
+    expand(replacement, expanded);
+    sb.append(input.subSequence(appendPosition, first));
+    sb.append(expanded);
+    appendPosition = last;
+    return this;
   }
 
-  public boolean find() {
-    return find(end);
+  public StringBuffer appendTail(StringBuffer sb) {
+    sb.append(input.subSequence(appendPosition, input.length()));
+    return sb;
   }
 
-  public boolean find(int start) {
-    String p = pattern.pattern();
-    int i = Pattern.indexOf(input, p, start);
-    if (i >= 0) {
-      this.start = i;
-      this.end = i + p.length();
-      return true;
-    } else {
-      return false;
+  // appends replacement to sb, with $n and ${name} replaced by the
+  // text of the groups they refer to and escapes removed
+  private void expand(String replacement, StringBuilder sb) {
+    int i = 0;
+    while (i < replacement.length()) {
+      char c = replacement.charAt(i++);
+      if (c == '\\') {
+        if (i == replacement.length()) {
+          throw new IllegalArgumentException
+            ("character to be escaped is missing");
+        }
+        sb.append(replacement.charAt(i++));
+      } else if (c == '$') {
+        if (i == replacement.length()) {
+          throw new IllegalArgumentException
+            ("Illegal group reference: group index is missing");
+        }
+
+        int group;
+        if (replacement.charAt(i) == '{') {
+          int end = replacement.indexOf('}', i);
+          if (end < 0) {
+            throw new IllegalArgumentException
+              ("named capturing group is missing trailing '}'");
+          }
+          group = pattern.groupIndex(replacement.substring(i + 1, end));
+          i = end + 1;
+        } else {
+          group = replacement.charAt(i++) - '0';
+          if (group < 0 || group > 9) {
+            throw new IllegalArgumentException("Illegal group reference");
+          }
+          // like the JDK, take as many digits as form an existing group
+          while (i < replacement.length()) {
+            int digit = replacement.charAt(i) - '0';
+            int longer = (group * 10) + digit;
+            if (digit < 0 || digit > 9 || longer > program.groupCount) {
+              break;
+            }
+            group = longer;
+            ++ i;
+          }
+        }
+
+        String text = group(group);
+        if (text != null) {
+          sb.append(text);
+        }
+      } else {
+        sb.append(c);
+      }
+    }
+  }
+
+  public static String quoteReplacement(String s) {
+    if (s.indexOf('\\') < 0 && s.indexOf('$') < 0) {
+      return s;
     }
+
+    StringBuilder sb = new StringBuilder();
+    for (int i = 0; i < s.length(); ++i) {
+      char c = s.charAt(i);
+      if (c == '\\' || c == '$') {
+        sb.append('\\');
+      }
+      sb.append(c);
+    }
+    return sb.toString();
   }
 }
@@ -0,0 +1,500 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.regex;
+
+/**
+ * A node in the syntax tree built by Parser and compiled into a
+ * Program.
+ */
+abstract class Node {
+  public static final int Infinite = -1;
+
+  public abstract void compile(Program.Builder b);
+
+  public abstract boolean canMatchEmpty();
+
+  // the most chars a match of this node may consume, or -1 if there
+  // is no limit
+  public abstract int maxLength();
+
+  // the chars the first one consumed by a match of this node may be
+  public abstract CharSet firstChars();
+
+  // appends to sb the text every match of this node starts with,
+  // returning true if that is all a match may consist of
+  public abstract boolean prefix(StringBuilder sb);
+
+  // true if matches of this node must start at the beginning of the
+  // input
+  public boolean anchored() {
+    return false;
+  }
+
+  // true if this node, like most, may be matched by a DFA
+  public boolean deterministic() {
+    return true;
+  }
+
+  public static class Chars extends Node {
+    private final CharSet set;
+
+    public Chars(CharSet set) {
+      this.set = set;
+    }
+
+    public void compile(Program.Builder b) {
+      b.emit(Program.Set, 0, 0, set);
+    }
+
+    public boolean canMatchEmpty() {
+      return false;
+    }
+
+    public int maxLength() {
+      return 1;
+    }
+
+    public CharSet firstChars() {
+      return set;
+    }
+
+    public boolean prefix(StringBuilder sb) {
+      int c = set.single();
+      if (c >= 0) {
+        sb.append((char) c);
+        return true;
+      } else {
+        return false;
+      }
+    }
+  }
+
+  public static class Sequence extends Node {
+    private final Node[] children;
+
+    public Sequence(Node[] children) {
+      this.children = children;
+    }
+
+    public void compile(Program.Builder b) {
+      for (int i = 0; i < children.length; ++i) {
+        children[i].compile(b);
+      }
+    }
+
+    public boolean canMatchEmpty() {
+      for (int i = 0; i < children.length; ++i) {
+        if (! children[i].canMatchEmpty()) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    public int maxLength() {
+      int length = 0;
+      for (int i = 0; i < children.length; ++i) {
+        int m = children[i].maxLength();
+        if (m < 0) {
+          return -1;
+        }
+        length += m;
+      }
+      return length;
+    }
+
+    public CharSet firstChars() {
+      CharSet set = CharSet.Empty;
+      for (int i = 0; i < children.length; ++i) {
+        set = set.union(children[i].firstChars());
+        if (! children[i].canMatchEmpty()) {
+          break;
+        }
+      }
+      return set;
+    }
+
+    public boolean prefix(StringBuilder sb) {
+      for (int i = 0; i < children.length; ++i) {
+        if (! children[i].prefix(sb)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    public boolean anchored() {
+      return children.length > 0 && children[0].anchored();
+    }
+
+    public boolean deterministic() {
+      for (int i = 0; i < children.length; ++i) {
+        if (! children[i].deterministic()) {
+          return false;
+        }
+      }
+      return true;
+    }
+  }
+
+  public static class Alternation extends Node {
+    private final Node[] children;
+
+    public Alternation(Node[] children) {
+      this.children = children;
+    }
+
+    public void compile(Program.Builder b) {
+      int[] jumps = new int[children.length - 1];
+      for (int i = 0; i < children.length - 1; ++i) {
+        int split = b.emit(Program.Split, b.length() + 1, 0, null);
+        children[i].compile(b);
+        jumps[i] = b.emit(Program.Jump, 0, 0, null);
+        b.setY(split, b.length());
+      }
+      children[children.length - 1].compile(b);
+
+      for (int i = 0; i < jumps.length; ++i) {
+        b.setX(jumps[i], b.length());
+      }
+    }
+
+    public boolean canMatchEmpty() {
+      for (int i = 0; i < children.length; ++i) {
+        if (children[i].canMatchEmpty()) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    public int maxLength() {
+      int length = 0;
+      for (int i = 0; i < children.length; ++i) {
+        int m = children[i].maxLength();
+        if (m < 0) {
+          return -1;
+        } else if (m > length) {
+          length = m;
+        }
+      }
+      return length;
+    }
+
+    public CharSet firstChars() {
+      CharSet set = CharSet.Empty;
+      for (int i = 0; i < children.length; ++i) {
+        set = set.union(children[i].firstChars());
+      }
+      return set;
+    }
+
+    public boolean prefix(StringBuilder sb) {
+      return false;
+    }
+
+    public boolean anchored() {
+      for (int i = 0; i < children.length; ++i) {
+        if (! children[i].anchored()) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    public boolean deterministic() {
+      for (int i = 0; i < children.length; ++i) {
+        if (! children[i].deterministic()) {
+          return false;
+        }
+      }
+      return true;
+    }
+  }
+
+  public static class Repeat extends Node {
+    private final Node body;
+    private final int min;
+    private final int max;
+    private final boolean greedy;
+    private final boolean possessive;
+
+    public Repeat(Node body, int min, int max, boolean greedy,
+                  boolean possessive)
+    {
+      this.body = body;
+      this.min = min;
+      this.max = max;
+      this.greedy = greedy;
+      this.possessive = possessive;
+    }
+
+    public void compile(Program.Builder b) {
+      if (possessive) {
+        new Atomic(new Repeat(body, min, max, true, false)).compile(b);
+        return;
+      }
+
+      for (int i = 0; i < min; ++i) {
+        body.compile(b);
+      }
+
+      if (max == Infinite) {
+        int register = body.canMatchEmpty() ? b.register() : -1;
+        int loop = b.emit(Program.Split, 0, 0, null);
+        int start = b.length();
+        int check = -1;
+        if (register >= 0) {
+          b.emit(Program.Mark, register, 0, null);
+        }
+        body.compile(b);
+        if (register >= 0) {
+          check = b.emit(Program.Check, register, 0, null);
+        }
+        b.emit(Program.Jump, loop, 0, null);
+        prefer(b, loop, start, b.length());
+        if (check >= 0) {
+          b.setY(check, b.length());
+        }
+      } else {
+        int[] splits = new int[max - min];
+        for (int i = 0; i < splits.length; ++i) {
+          splits[i] = b.emit(Program.Split, 0, 0, null);
+          body.compile(b);
+        }
+        for (int i = 0; i < splits.length; ++i) {
+          prefer(b, splits[i], splits[i] + 1, b.length());
+        }
+      }
+    }
+
+    private void prefer(Program.Builder b, int split, int more, int done) {
+      if (greedy) {
+        b.setX(split, more);
+        b.setY(split, done);
+      } else {
+        b.setX(split, done);
+        b.setY(split, more);
+      }
+    }
+
+    public boolean canMatchEmpty() {
+      return min == 0 || body.canMatchEmpty();
+    }
+
+    public int maxLength() {
+      int m = body.maxLength();
+      if (max == 0 || m == 0) {
+        return 0;
+      } else if (max == Infinite || m < 0) {
+        return -1;
+      } else {
+        return m * max;
+      }
+    }
+
+    public CharSet firstChars() {
+      return max == 0 ? CharSet.Empty : body.firstChars();
+    }
+
+    public boolean prefix(StringBuilder sb) {
+      if (min == 0) {
+        return false;
+      } else {
+        return body.prefix(sb) && min == 1 && max == 1;
+      }
+    }
+
+    public boolean anchored() {
+      return min > 0 && body.anchored();
+    }
+
+    public boolean deterministic() {
+      return (! possessive) && body.deterministic();
+    }
+  }
+
+  public static class Group extends Node {
+    private final Node body;
+    // the number of the group, or -1 if it doesn't capture
+    private final int index;
+
+    public Group(Node body, int index) {
+      this.body = body;
+      this.index = index;
+    }
+
+    public void compile(Program.Builder b) {
+      if (index >= 0) {
+        b.emit(Program.Save, index * 2, 0, null);
+      }
+      body.compile(b);
+      if (index >= 0) {
+        b.emit(Program.Save, (index * 2) + 1, 0, null);
+      }
+    }
+
+    public boolean canMatchEmpty() {
+      return body.canMatchEmpty();
+    }
+
+    public int maxLength() {
+      return body.maxLength();
+    }
+
+    public CharSet firstChars() {
+      return body.firstChars();
+    }
+
+    public boolean prefix(StringBuilder sb) {
+      return body.prefix(sb);
+    }
+
+    public boolean anchored() {
+      return body.anchored();
+    }
+
+    public boolean deterministic() {
+      return body.deterministic();
+    }
+  }
+
+  public static class Assertion extends Node {
+    private final int kind;
+
+    public Assertion(int kind) {
+      this.kind = kind;
+    }
+
+    public void compile(Program.Builder b) {
+      b.emit(Program.Assert, kind, 0, null);
+    }
+
+    public boolean canMatchEmpty() {
+      return true;
+    }
+
+    public int maxLength() {
+      return 0;
+    }
+
+    public CharSet firstChars() {
+      return CharSet.Empty;
+    }
+
+    public boolean prefix(StringBuilder sb) {
+      return true;
+    }
+
+    public boolean anchored() {
+      return kind == Program.BeginText;
+    }
+
+    // the DFA only knows whether it is at the beginning of the input
+    public boolean deterministic() {
+      return kind == Program.BeginText;
+    }
+  }
+
+  public static class BackReference extends Node {
+    private final int group;
+    private final boolean caseInsensitive;
+
+    public BackReference(int group, boolean caseInsensitive) {
+      this.group = group;
+      this.caseInsensitive = caseInsensitive;
+    }
+
+    public void compile(Program.Builder b) {
+      b.emit(Program.BackReference, group, caseInsensitive ? 1 : 0, null);
+    }
+
+    public boolean canMatchEmpty() {
+      return true;
+    }
+
+    public int maxLength() {
+      return -1;
+    }
+
+    public CharSet firstChars() {
+      return CharSet.All;
+    }
+
+    public boolean prefix(StringBuilder sb) {
+      return false;
+    }
+
+    public boolean deterministic() {
+      return false;
+    }
+  }
+
+  // a lookaround or atomic group, compiled out of line
+  public static class Look extends Node {
+    private final Node body;
+    // Program.LookAhead or Program.LookBehind, possibly with
+    // Program.Negative, or -1 for an atomic group
+    private final int kind;
+
+    public Look(Node body, int kind) {
+      this.body = body;
+      this.kind = kind;
+    }
+
+    public void compile(Program.Builder b) {
+      int look;
+      if (kind < 0) {
+        look = b.emit(Program.Atomic, 0, 0, null);
+      } else if ((kind & Program.LookBehind) != 0) {
+        look = b.emit(Program.Look, 0, kind | (body.maxLength() << 2), null);
+      } else {
+        look = b.emit(Program.Look, 0, kind, null);
+      }
+      int jump = b.emit(Program.Jump, 0, 0, null);
+      b.setX(look, b.length());
+      body.compile(b);
+      b.emit(Program.Succeed, 0, 0, null);
+      b.setX(jump, b.length());
+    }
+
+    public boolean canMatchEmpty() {
+      return kind >= 0 || body.canMatchEmpty();
+    }
+
+    public int maxLength() {
+      return kind >= 0 ? 0 : body.maxLength();
+    }
+
+    public CharSet firstChars() {
+      return kind >= 0 ? CharSet.Empty : body.firstChars();
+    }
+
+    public boolean prefix(StringBuilder sb) {
+      if (kind < 0) {
+        body.prefix(sb);
+        return false;
+      } else {
+        return true;
+      }
+    }
+
+    public boolean deterministic() {
+      return false;
+    }
+  }
+
+  public static class Atomic extends Look {
+    public Atomic(Node body) {
+      super(body, -1);
+    }
+  }
+}
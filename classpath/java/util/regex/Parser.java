@@ -0,0 +1,888 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.regex;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+
+/**
+ * A recursive descent parser for the syntax described in the
+ * java.util.regex.Pattern documentation, producing a tree of Nodes.
+ * Chars are UTF-16 code units rather than code points.
+ */
+class Parser {
+  private static final CharSet Digits = CharSet.range('0', '9');
+  private static final CharSet Spaces = CharSet.of(" \t\n\u000B\f\r");
+  private static final CharSet WordChars = CharSet.range('a', 'z')
+    .union(CharSet.range('A', 'Z')).union(Digits).union(CharSet.of('_'));
+  private static final CharSet LineTerminators
+    = CharSet.of("\n\r\u0085\u2028\u2029");
+
+  // java.lang.Character properties
+  private static final int Letter = 0;
+  private static final int UpperCase = 1;
+  private static final int LowerCase = 2;
+  private static final int Digit = 3;
+  private static final int Whitespace = 4;
+
+  private final String regex;
+  private int position;
+  private int flags;
+  private int groupCount;
+  private final Map<String, Integer> names = new HashMap<String, Integer>();
+
+  public Parser(String regex, int flags) {
+    this.regex = regex;
+    this.flags = flags;
+  }
+
+  public int groupCount() {
+    return groupCount;
+  }
+
+  public Map<String, Integer> names() {
+    return names;
+  }
+
+  public Node parse() {
+    if ((flags & Pattern.LITERAL) != 0) {
+      Node[] chars = new Node[regex.length()];
+      for (int i = 0; i < chars.length; ++i) {
+        chars[i] = literal(regex.charAt(i));
+      }
+      return new Node.Sequence(chars);
+    }
+
+    Node node = alternation();
+    if (position < regex.length()) {
+      throw error("Unmatched closing ')'", position - 1);
+    }
+    return node;
+  }
+
+  private PatternSyntaxException error(String description, int index) {
+    return new PatternSyntaxException(description, regex, index);
+  }
+
+  private PatternSyntaxException error(String description) {
+    return error(description, position);
+  }
+
+  private boolean flag(int flag) {
+    return (flags & flag) != 0;
+  }
+
+  private boolean atEnd() {
+    return position >= regex.length();
+  }
+
+  private char peek() {
+    return regex.charAt(position);
+  }
+
+  private boolean accept(char c) {
+    if (position < regex.length() && regex.charAt(position) == c) {
+      ++ position;
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  private boolean accept(String s) {
+    if (regex.startsWith(s, position)) {
+      position += s.length();
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  private char next() {
+    if (atEnd()) {
+      throw error("Unexpected internal error");
+    }
+    return regex.charAt(position++);
+  }
+
+  // skips whitespace and comments if the COMMENTS flag is set
+  private void skipComments() {
+    if (flag(Pattern.COMMENTS)) {
+      while (! atEnd()) {
+        char c = peek();
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f'
+            || c == '\u000B')
+        {
+          ++ position;
+        } else if (c == '#') {
+          while (! (atEnd() || LineTerminators.contains(peek()))) {
+            ++ position;
+          }
+        } else {
+          break;
+        }
+      }
+    }
+  }
+
+  private CharSet fold(CharSet set) {
+    if (flag(Pattern.CASE_INSENSITIVE)) {
+      return set.caseInsensitive(flag(Pattern.UNICODE_CASE));
+    } else {
+      return set;
+    }
+  }
+
+  private Node literal(char c) {
+    return new Node.Chars(fold(CharSet.of(c)));
+  }
+
+  private Node alternation() {
+    List<Node> alternatives = new ArrayList<Node>();
+    alternatives.add(sequence());
+    while (accept('|')) {
+      alternatives.add(sequence());
+    }
+
+    if (alternatives.size() == 1) {
+      return alternatives.get(0);
+    } else {
+      return new Node.Alternation
+        (alternatives.toArray(new Node[alternatives.size()]));
+    }
+  }
+
+  private Node sequence() {
+    List<Node> items = new ArrayList<Node>();
+    while (true) {
+      skipComments();
+      if (atEnd() || peek() == '|' || peek() == ')') {
+        break;
+      }
+
+      int start = items.size();
+      atom(items);
+      if (items.size() > start) {
+        Node atom = items.remove(items.size() - 1);
+        items.add(quantified(atom));
+      }
+    }
+
+    if (items.size() == 1) {
+      return items.get(0);
+    } else {
+      return new Node.Sequence(items.toArray(new Node[items.size()]));
+    }
+  }
+
+  private Node quantified(Node atom) {
+    skipComments();
+    if (atEnd()) {
+      return atom;
+    }
+
+    int start = position;
+    int min;
+    int max;
+    switch (peek()) {
+    case '*':
+      ++ position;
+      min = 0;
+      max = Node.Infinite;
+      break;
+
+    case '+':
+      ++ position;
+      min = 1;
+      max = Node.Infinite;
+      break;
+
+    case '?':
+      ++ position;
+      min = 0;
+      max = 1;
+      break;
+
+    case '{':
+      ++ position;
+      min = number();
+      if (min < 0) {
+        throw error("Illegal repetition", start);
+      }
+      if (accept(',')) {
+        max = number();
+        if (max < 0) {
+          max = Node.Infinite;
+        } else if (max < min) {
+          throw error("Illegal repetition range", start);
+        }
+      } else {
+        max = min;
+      }
+      if (! accept('}')) {
+        throw error("Unclosed counted closure");
+      }
+      break;
+
+    default:
+      return atom;
+    }
+
+    boolean greedy = true;
+    boolean possessive = false;
+    if (accept('?')) {
+      greedy = false;
+    } else if (accept('+')) {
+      possessive = true;
+    }
+
+    return new Node.Repeat(atom, min, max, greedy, possessive);
+  }
+
+  // parses a decimal number, returning -1 if there isn't one here
+  private int number() {
+    int start = position;
+    long value = 0;
+    while (! atEnd() && peek() >= '0' && peek() <= '9') {
+      value = (value * 10) + (next() - '0');
+      if (value > Integer.MAX_VALUE) {
+        throw error("Illegal repetition range", start);
+      }
+    }
+    return position == start ? -1 : (int) value;
+  }
+
+  // parses an atom, adding it to items unless it is only a change of
+  // flags or a \Q...\E quote, whose chars are each added separately
+  private void atom(List<Node> items) {
+    int start = position;
+    char c = next();
+    switch (c) {
+    case '(':
+      group(items, start);
+      break;
+
+    case '[':
+      items.add(new Node.Chars(characterClass()));
+      break;
+
+    case '.':
+      if (flag(Pattern.DOTALL)) {
+        items.add(new Node.Chars(CharSet.All));
+      } else if (flag(Pattern.UNIX_LINES)) {
+        items.add(new Node.Chars(CharSet.of('\n').complement()));
+      } else {
+        items.add(new Node.Chars(LineTerminators.complement()));
+      }
+      break;
+
+    case '^':
+      items.add(new Node.Assertion
+                (flag(Pattern.MULTILINE)
+                 ? Program.BeginLine : Program.BeginText));
+      break;
+
+    case '$':
+      items.add(new Node.Assertion
+                (flag(Pattern.MULTILINE)
+                 ? Program.EndLine : Program.EndTextOrFinalTerminator));
+      break;
+
+    case '\\':
+      escape(items);
+      break;
+
+    case '*':
+    case '+':
+    case '?':
+      throw error("Dangling meta character '" + c + "'", start);
+
+    case '{':
+      throw error("Illegal repetition", start);
+
+    default:
+      items.add(literal(c));
+      break;
+    }
+  }
+
+  private void group(List<Node> items, int start) {
+    int savedFlags = flags;
+    Node node;
+    if (accept('?')) {
+      if (atEnd()) {
+        throw error("Unknown group type");
+      }
+
+      char c = next();
+      switch (c) {
+      case ':':
+        node = new Node.Group(alternation(), -1);
+        break;
+
+      case '=':
+        node = new Node.Look(alternation(), Program.LookAhead);
+        break;
+
+      case '!':
+        node = new Node.Look
+          (alternation(), Program.LookAhead | Program.Negative);
+        break;
+
+      case '>':
+        node = new Node.Atomic(alternation());
+        break;
+
+      case '<':
+        if (accept('=')) {
+          node = lookBehind(Program.LookBehind);
+        } else if (accept('!')) {
+          node = lookBehind(Program.LookBehind | Program.Negative);
+        } else {
+          String name = groupName();
+          if (names.containsKey(name)) {
+            throw error("Named capturing group <" + name
+                        + "> is already defined");
+          }
+          int index = ++ groupCount;
+          names.put(name, index);
+          node = new Node.Group(alternation(), index);
+        }
+        break;
+
+      default:
+        -- position;
+        if (inlineFlags()) {
+          // the new flags apply to the rest of the enclosing group
+          return;
+        }
+        node = new Node.Group(alternation(), -1);
+        break;
+      }
+    } else {
+      int index = ++ groupCount;
+      node = new Node.Group(alternation(), index);
+    }
+
+    if (! accept(')')) {
+      throw error("Unclosed group", regex.length());
+    }
+    flags = savedFlags;
+    items.add(node);
+  }
+
+  private Node lookBehind(int kind) {
+    int start = position;
+    Node body = alternation();
+    if (body.maxLength() < 0) {
+      throw error("Look-behind group does not have an obvious maximum"
+                  + " length", start);
+    }
+    return new Node.Look(body, kind);
+  }
+
+  private String groupName() {
+    int start = position;
+    while (! atEnd()) {
+      char c = peek();
+      if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+          || (position > start && c >= '0' && c <= '9'))
+      {
+        ++ position;
+      } else {
+        break;
+      }
+    }
+
+    if (position == start) {
+      throw error("capturing group name does not start with a Latin"
+                  + " letter");
+    } else if (! accept('>')) {
+      throw error("named capturing group is missing trailing '>'");
+    }
+    return regex.substring(start, position - 1);
+  }
+
+  // parses the flags of (?idmsux-idmsux) or (?idmsux-idmsux:X),
+  // returning true for the former
+  private boolean inlineFlags() {
+    boolean on = true;
+    while (true) {
+      if (atEnd()) {
+        throw error("Unknown inline modifier");
+      }
+
+      char c = next();
+      int flag;
+      switch (c) {
+      case 'i': flag = Pattern.CASE_INSENSITIVE; break;
+      case 'd': flag = Pattern.UNIX_LINES; break;
+      case 'm': flag = Pattern.MULTILINE; break;
+      case 's': flag = Pattern.DOTALL; break;
+      case 'u': flag = Pattern.UNICODE_CASE; break;
+      case 'x': flag = Pattern.COMMENTS; break;
+
+      case '-':
+        if (! on) {
+          throw error("Unknown inline modifier", position - 1);
+        }
+        on = false;
+        continue;
+
+      case ')':
+        return true;
+
+      case ':':
+        return false;
+
+      default:
+        throw error("Unknown inline modifier", position - 1);
+      }
+
+      if (on) {
+        flags |= flag;
+      } else {
+        flags &= ~flag;
+      }
+    }
+  }
+
+  private void escape(List<Node> items) {
+    int start = position - 1;
+    if (atEnd()) {
+      throw error("Unexpected internal error");
+    }
+
+    char c = peek();
+    switch (c) {
+    case 'b':
+      ++ position;
+      items.add(new Node.Assertion(Program.WordBoundary));
+      return;
+
+    case 'B':
+      ++ position;
+      items.add(new Node.Assertion(Program.NotWordBoundary));
+      return;
+
+    case 'A':
+      ++ position;
+      items.add(new Node.Assertion(Program.BeginText));
+      return;
+
+    case 'G':
+      ++ position;
+      items.add(new Node.Assertion(Program.LastMatchEnd));
+      return;
+
+    case 'Z':
+      ++ position;
+      items.add(new Node.Assertion(Program.EndTextOrFinalTerminator));
+      return;
+
+    case 'z':
+      ++ position;
+      items.add(new Node.Assertion(Program.EndText));
+      return;
+
+    case 'Q': {
+      ++ position;
+      int end = regex.indexOf("\\E", position);
+      if (end < 0) {
+        end = regex.length();
+      }
+      for (int i = position; i < end; ++i) {
+        items.add(literal(regex.charAt(i)));
+      }
+      position = Math.min(end + 2, regex.length());
+    } return;
+
+    case 'k': {
+      ++ position;
+      if (! accept('<')) {
+        throw error("\\k is not followed by '<' for named capturing group");
+      }
+      String name = groupName();
+      Integer index = names.get(name);
+      if (index == null) {
+        throw error("named capturing group <" + name
+                    + "> does not exist");
+      }
+      items.add(new Node.BackReference
+                (index, flag(Pattern.CASE_INSENSITIVE)));
+    } return;
+
+    case '1': case '2': case '3': case '4': case '5':
+    case '6': case '7': case '8': case '9': {
+      // like the JDK, take as many digits as form an existing group
+      int index = next() - '0';
+      while (! atEnd() && peek() >= '0' && peek() <= '9') {
+        int longer = (index * 10) + (peek() - '0');
+        if (longer > groupCount) {
+          break;
+        }
+        index = longer;
+        ++ position;
+      }
+      items.add(new Node.BackReference
+                (index, flag(Pattern.CASE_INSENSITIVE)));
+    } return;
+
+    default:
+      break;
+    }
+
+    CharSet set = escapedSet();
+    if (set != null) {
+      items.add(new Node.Chars(set));
+    } else {
+      items.add(literal(escapedChar(start)));
+    }
+  }
+
+  // parses the set named by an escape such as \d or \p{Alpha}, or
+  // returns null, consuming nothing, if the escape names a single char
+  private CharSet escapedSet() {
+    char c = peek();
+    switch (c) {
+    case 'd':
+      ++ position;
+      return Digits;
+
+    case 'D':
+      ++ position;
+      return Digits.complement();
+
+    case 's':
+      ++ position;
+      return Spaces;
+
+    case 'S':
+      ++ position;
+      return Spaces.complement();
+
+    case 'w':
+      ++ position;
+      return WordChars;
+
+    case 'W':
+      ++ position;
+      return WordChars.complement();
+
+    case 'p':
+    case 'P': {
+      int start = position - 1;
+      ++ position;
+      String name;
+      if (accept('{')) {
+        int end = regex.indexOf('}', position);
+        if (end < 0) {
+          throw error("Unclosed character family");
+        }
+        name = regex.substring(position, end);
+        position = end + 1;
+      } else if (! atEnd()) {
+        name = String.valueOf(next());
+      } else {
+        throw error("Illegal character family", start);
+      }
+
+      CharSet set = property(name, start);
+      return c == 'P' ? set.complement() : set;
+    }
+
+    default:
+      return null;
+    }
+  }
+
+  private CharSet property(String name, int start) {
+    if (name.startsWith("Is")) {
+      name = name.substring(2);
+    }
+
+    CharSet set;
+    if (name.equals("Lower")) {
+      set = CharSet.range('a', 'z');
+    } else if (name.equals("Upper")) {
+      set = CharSet.range('A', 'Z');
+    } else if (name.equals("ASCII")) {
+      set = CharSet.range(0, 0x7F);
+    } else if (name.equals("Alpha")) {
+      set = CharSet.range('a', 'z').union(CharSet.range('A', 'Z'));
+    } else if (name.equals("Digit")) {
+      set = Digits;
+    } else if (name.equals("Alnum")) {
+      set = property("Alpha", start).union(Digits);
+    } else if (name.equals("Punct")) {
+      set = CharSet.of("!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~");
+    } else if (name.equals("Graph")) {
+      set = property("Alnum", start).union(property("Punct", start));
+    } else if (name.equals("Print")) {
+      set = property("Graph", start).union(CharSet.of(' '));
+    } else if (name.equals("Blank")) {
+      set = CharSet.of(" \t");
+    } else if (name.equals("Cntrl")) {
+      set = CharSet.range(0, 0x1F).union(CharSet.of(0x7F));
+    } else if (name.equals("XDigit")) {
+      set = Digits.union(CharSet.range('a', 'f'))
+        .union(CharSet.range('A', 'F'));
+    } else if (name.equals("Space")) {
+      set = Spaces;
+    } else if (name.equals("L") || name.equals("javaLetter")) {
+      set = matching(Letter);
+    } else if (name.equals("Lu") || name.equals("javaUpperCase")) {
+      set = matching(UpperCase);
+    } else if (name.equals("Ll") || name.equals("javaLowerCase")) {
+      set = matching(LowerCase);
+    } else if (name.equals("N") || name.equals("Nd")
+               || name.equals("javaDigit"))
+    {
+      set = matching(Digit);
+    } else if (name.equals("javaLetterOrDigit")) {
+      set = matching(Letter).union(matching(Digit));
+    } else if (name.equals("javaWhitespace")) {
+      set = matching(Whitespace);
+    } else {
+      throw error("Unknown character property name {" + name + "}",
+                  start);
+    }
+
+    if (flag(Pattern.CASE_INSENSITIVE)
+        && (name.equals("Lower") || name.equals("Upper")))
+    {
+      set = fold(set);
+    }
+    return set;
+  }
+
+  private static boolean test(int property, char c) {
+    switch (property) {
+    case Letter: return Character.isLetter(c);
+    case UpperCase: return Character.isUpperCase(c);
+    case LowerCase: return Character.isLowerCase(c);
+    case Digit: return Character.isDigit(c);
+    case Whitespace: return Character.isWhitespace(c);
+    default: throw new IllegalArgumentException();
+    }
+  }
+
+  // the set of chars which have the specified java.lang.Character
+  // property
+  private static CharSet matching(int property) {
+    CharSet set = CharSet.Empty;
+    int first = -1;
+    for (int c = 0; c <= 0x10000; ++c) {
+      if (c < 0x10000 && test(property, (char) c)) {
+        if (first < 0) {
+          first = c;
+        }
+      } else if (first >= 0) {
+        set = set.union(CharSet.range(first, c - 1));
+        first = -1;
+      }
+    }
+    return set;
+  }
+
+  // parses the rest of an escape naming a single char, such as \t or
+  // \x41, the backslash of which is at start
+  private char escapedChar(int start) {
+    char c = next();
+    switch (c) {
+    case 't': return '\t';
+    case 'n': return '\n';
+    case 'r': return '\r';
+    case 'f': return '\f';
+    case 'a': return '\u0007';
+    case 'e': return '\u001B';
+
+    case 'c':
+      if (atEnd()) {
+        throw error("Illegal control escape sequence");
+      }
+      return (char) (next() ^ 64);
+
+    case '0': {
+      int value = 0;
+      int digits = 0;
+      while (digits < 3 && ! atEnd() && peek() >= '0' && peek() <= '7'
+             && (digits < 2 || value < 040))
+      {
+        value = (value * 8) + (next() - '0');
+        ++ digits;
+      }
+      if (digits == 0) {
+        throw error("Illegal octal escape sequence");
+      }
+      return (char) value;
+    }
+
+    case 'x':
+      if (accept('{')) {
+        int end = regex.indexOf('}', position);
+        if (end < 0 || end == position) {
+          throw error("Unclosed hexadecimal escape sequence");
+        }
+        int value = hex(position, end);
+        position = end + 1;
+        if (value > 0xFFFF) {
+          throw error("Hexadecimal codepoint is too big", start);
+        }
+        return (char) value;
+      } else {
+        return (char) hex(position, position += 2);
+      }
+
+    case 'u':
+      return (char) hex(position, position += 4);
+
+    default:
+      if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+        throw error("Illegal/unsupported escape sequence", position - 1);
+      }
+      return c;
+    }
+  }
+
+  private int hex(int start, int end) {
+    if (end > regex.length()) {
+      throw error("Illegal hexadecimal escape sequence", start);
+    }
+
+    int value = 0;
+    for (int i = start; i < end; ++i) {
+      int digit = Character.digit(regex.charAt(i), 16);
+      if (digit < 0 || value > 0xFFFFFF) {
+        throw error("Illegal hexadecimal escape sequence", i);
+      }
+      value = (value * 16) + digit;
+    }
+    return value;
+  }
+
+  // parses a character class, the opening bracket of which has been
+  // consumed
+  private CharSet characterClass() {
+    int start = position - 1;
+    boolean negated = accept('^');
+
+    CharSet set = classUnion(true);
+    while (accept("&&")) {
+      CharSet operand = classUnion(false);
+      if (operand != null) {
+        set = set == null ? operand : set.intersection(operand);
+      }
+    }
+
+    if (! accept(']')) {
+      throw error("Unclosed character class", regex.length() - 1);
+    }
+    if (set == null) {
+      throw error("Unclosed character class", start);
+    }
+
+    set = fold(set);
+    return negated ? set.complement() : set;
+  }
+
+  // parses class items up to a closing bracket or &&, returning their
+  // union, or null if there are none
+  private CharSet classUnion(boolean first) {
+    CharSet set = null;
+    while (true) {
+      skipComments();
+      if (atEnd()) {
+        throw error("Unclosed character class", regex.length() - 1);
+      }
+
+      char c = peek();
+      CharSet item;
+      if (c == ']' && ! (first && set == null)) {
+        break;
+      } else if (regex.startsWith("&&", position)) {
+        break;
+      } else if (c == '[') {
+        ++ position;
+        item = characterClass();
+      } else if (c == '\\' && position + 1 < regex.length()
+                 && regex.charAt(position + 1) == 'Q')
+      {
+        position += 2;
+        int end = regex.indexOf("\\E", position);
+        if (end < 0) {
+          end = regex.length();
+        }
+        item = CharSet.Empty;
+        for (int i = position; i < end; ++i) {
+          item = item.union(CharSet.of(regex.charAt(i)));
+        }
+        position = Math.min(end + 2, regex.length());
+      } else {
+        item = classRange();
+      }
+
+      set = set == null ? item : set.union(item);
+    }
+    return set;
+  }
+
+  // parses a single char, a range of chars, or an escape naming a set
+  private CharSet classRange() {
+    int start = position;
+    if (accept('\\')) {
+      if (atEnd()) {
+        throw error("Unclosed character class", regex.length() - 1);
+      }
+      CharSet set = escapedSet();
+      if (set != null) {
+        return set;
+      }
+    }
+
+    char first = classChar(start);
+    if (position + 1 < regex.length() && peek() == '-'
+        && regex.charAt(position + 1) != ']')
+    {
+      ++ position;
+      int lastStart = position;
+      if (accept('\\')) {
+        if (atEnd()) {
+          throw error("Unclosed character class", regex.length() - 1);
+        } else if (escapedSet() != null) {
+          throw error("Illegal character range", lastStart);
+        }
+      } else if (peek() == '[') {
+        throw error("Illegal character range", lastStart);
+      }
+
+      char last = classChar(lastStart);
+      if (last < first) {
+        throw error("Illegal character range", lastStart);
+      }
+      return CharSet.range(first, last);
+    } else {
+      return CharSet.of(first);
+    }
+  }
+
+  // parses a char in a class, the escaping backslash, if any, of which
+  // is at start
+  private char classChar(int start) {
+    if (position > start) {
+      return escapedChar(start);
+    } else {
+      return next();
+    }
+  }
+}
@@ -10,13 +10,16 @@
 
 package java.util.regex;
 
-import java.util.Iterator;
+import java.util.ArrayList;
+import java.util.HashMap;
 import java.util.List;
-import java.util.LinkedList;
+import java.util.Map;
 
 /**
- * This is a work in progress.
- * 
+ * A compiled regular expression.  Patterns are immutable, so those
+ * compiled by the static methods, which String.split and friends
+ * use, are cached and reused.
+ *
  * @author zsombor and others
  * 
  */
@@ -31,49 +34,57 @@ public class Pattern {
   public static final int UNICODE_CASE     = 64;
   public static final int CANON_EQ         = 128;
 
+  private static final int CacheSize = 64;
+
+  private static final Map<Key, Pattern> cache = new HashMap<Key, Pattern>();
+
   private final int patternFlags;
   private final String pattern;
+  final Program program;
+  private final Map<String, Integer> names;
 
   protected Pattern(String pattern, int flags) {
     this.pattern = pattern;
     this.patternFlags = flags;
 
-    if (! trivial(pattern)) {
-      throw new UnsupportedOperationException
-        ("only trivial regular expressions are supported so far");
-    }
+    Parser parser = new Parser(pattern, flags);
+    Node root = parser.parse();
+    this.program = Program.compile(root, parser.groupCount(), flags);
+    this.names = parser.names();
   }
 
-  private static boolean trivial(String pattern) {
-    for (int i = 0; i < pattern.length(); ++i) {
-      char c = pattern.charAt(i);
-      switch (c) {
-      case '\\':
-      case '.':
-      case '*':
-      case '+':
-      case '?':
-      case '|':
-      case '[':
-      case ']':
-      case '{':
-      case '}':
-      case '(':
-      case ')':
-      case '^':
-      case '$':
-        return false;
+  public static Pattern compile(String regex) {
+    return compile(regex, 0);
+  }
+
+  public static Pattern compile(String regex, int flags) {
+    Key key = new Key(regex, flags);
+    synchronized (cache) {
+      Pattern p = cache.get(key);
+      if (p != null) {
+        return p;
       }
     }
-    return true;
-  }
 
-  public static Pattern compile(String regex) {
-    return new Pattern(regex, 0);
+    Pattern p = new Pattern(regex, flags);
+    synchronized (cache) {
+      if (cache.size() >= CacheSize) {
+        cache.clear();
+      }
+      cache.put(key, p);
+    }
+    return p;
   }
 
-  public static Pattern compile(String regex, int flags) {
-    return new Pattern(regex, flags);
+  public static String quote(String s) {
+    StringBuilder sb = new StringBuilder("\\Q");
+    int start = 0;
+    int end;
+    while ((end = s.indexOf("\\E", start)) >= 0) {
+      sb.append(s.substring(start, end)).append("\\E\\\\E\\Q");
+      start = end + 2;
+    }
+    return sb.append(s.substring(start)).append("\\E").toString();
   }
 
   public int flags() {
@@ -92,84 +103,80 @@ public class Pattern {
     return pattern;
   }
 
+  public String toString() {
+    return pattern;
+  }
+
+  int groupIndex(String name) {
+    Integer index = names.get(name);
+    if (index == null) {
+      throw new IllegalArgumentException
+        ("No group with name <" + name + ">");
+    }
+    return index;
+  }
+
   public String[] split(CharSequence input) {
     return split(input, 0);
   }
 
   public String[] split(CharSequence input, int limit) {
-    boolean strip;
-    if (limit < 0) {
-      strip = false;
-      limit = Integer.MAX_VALUE;
-    } else if (limit == 0) {
-      strip = true;
-      limit = Integer.MAX_VALUE;
-    } else {
-      strip = false;
-    }
-
-    List<CharSequence> list = new LinkedList();
+    List<String> list = new ArrayList<String>();
     int index = 0;
-    int trailing = 0;
-    int patternLength = pattern.length();
-    while (index < input.length() && list.size() < limit - 1) {
-      int i;
-      if (patternLength == 0) {
-        if (list.size() == 0) {
-          i = 0;
-        } else {
-          i = index + 1;
-        }
+    Matcher m = matcher(input);
+    while (m.find()) {
+      if (limit <= 0 || list.size() < limit - 1) {
+        list.add(input.subSequence(index, m.start()).toString());
+        index = m.end();
       } else {
-        i = indexOf(input, pattern, index);
+        list.add(input.subSequence(index, input.length()).toString());
+        index = m.end();
+        break;
       }
+    }
 
-      if (i >= 0) {
-        if (patternLength != 0 && i == index) {
-          ++ trailing;
-        } else {
-          trailing = 0;
-        }
+    if (index == 0) {
+      return new String[] { input.toString() };
+    }
 
-        list.add(input.subSequence(index, i));
-        index = i + patternLength;
-      } else {
-        break;
-      }
+    if (limit <= 0 || list.size() < limit) {
+      list.add(input.subSequence(index, input.length()).toString());
     }
 
-    if (strip && index > 0 && index == input.length()) {
-      ++ trailing;
-    } else {
-      trailing = 0;
+    int size = list.size();
+    if (limit == 0) {
+      while (size > 0 && list.get(size - 1).length() == 0) {
+        -- size;
+      }
     }
-    list.add(input.subSequence(index, input.length()));
-
-    String[] result = new String[list.size() - trailing];
-    int i = 0;
-    for (Iterator<CharSequence> it = list.iterator();
-         it.hasNext() && i < result.length; ++ i)
-    {
-      result[i] = it.next().toString();
+
+    String[] result = new String[size];
+    for (int i = 0; i < size; ++i) {
+      result[i] = list.get(i);
     }
     return result;
   }
 
-  static int indexOf(CharSequence haystack, CharSequence needle, int start) {
-    if (needle.length() == 0) return start;
+  private static class Key {
+    private final String regex;
+    private final int flags;
 
-    for (int i = start; i < haystack.length() - needle.length() + 1; ++i) {
-      int j = 0;
-      for (; j < needle.length(); ++j) {
-        if (haystack.charAt(i + j) != needle.charAt(j)) {
-          break;
-        }
-      }
-      if (j == needle.length()) {
-        return i;
-      }
+    public Key(String regex, int flags) {
+      this.regex = regex;
+      this.flags = flags;
+    }
+
+    public int hashCode() {
+      return regex.hashCode() ^ flags;
     }
 
-    return -1;
+    public boolean equals(Object o) {
+      if (o instanceof Key) {
+        Key k = (Key) o;
+        return k.flags == flags && k.regex.equals(regex);
+      } else {
+        return false;
+      }
+    }
   }
 }
@@ -0,0 +1,54 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.regex;
+
+public class PatternSyntaxException extends IllegalArgumentException {
+  private final String description;
+  private final String pattern;
+  private final int index;
+
+  public PatternSyntaxException(String description, String pattern,
+                                int index)
+  {
+    super(description);
+    this.description = description;
+    this.pattern = pattern;
+    this.index = index;
+  }
+
+  public String getDescription() {
+    return description;
+  }
+
+  public String getPattern() {
+    return pattern;
+  }
+
+  public int getIndex() {
+    return index;
+  }
+
+  public String getMessage() {
+    StringBuilder sb = new StringBuilder(description);
+    if (index >= 0) {
+      sb.append(" near index ").append(index);
+    }
+    sb.append('\n').append(pattern);
+    if (index >= 0) {
+      sb.append('\n');
+      for (int i = 0; i < index; ++i) {
+        sb.append(' ');
+      }
+      sb.append('^');
+    }
+    return sb.toString();
+  }
+}
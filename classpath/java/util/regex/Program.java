@@ -0,0 +1,289 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.regex;
+
+/**
+ * A compiled pattern: a list of NFA instructions, in the style of
+ * Thompson and Pike, shared by the backtracker and the lazy DFA.
+ * Where an instruction may continue at more than one place, the
+ * earlier one has priority, which gives the leftmost-first semantics
+ * of a backtracking matcher.
+ */
+class Program {
+  // consume a char which is in sets[pc]
+  public static final int Set = 0;
+  // continue at x, or else at y
+  public static final int Split = 1;
+  // continue at x
+  public static final int Jump = 2;
+  // record the current position in slot x
+  public static final int Save = 3;
+  // the whole pattern has matched
+  public static final int Match = 4;
+  // continue only if the assertion numbered x holds here
+  public static final int Assert = 5;
+  // consume the text matched by group x, ignoring case if y is 1
+  public static final int BackReference = 6;
+  // continue only if the lookaround at x succeeds, of the kind in the
+  // low two bits of y; for a lookbehind, the rest of y is the most
+  // chars the lookaround may match
+  public static final int Look = 7;
+  // match the subpattern at x once, without backtracking into it
+  public static final int Atomic = 8;
+  // record the current position in register slot x
+  public static final int Mark = 9;
+  // continue at y, leaving the loop, unless the position has moved
+  // since the Mark of slot x, so loops whose bodies match the empty
+  // string end
+  public static final int Check = 10;
+  // a lookaround or atomic subpattern has matched
+  public static final int Succeed = 11;
+
+  public static final int BeginText = 0;
+  public static final int BeginLine = 1;
+  public static final int EndText = 2;
+  public static final int EndTextOrFinalTerminator = 3;
+  public static final int EndLine = 4;
+  public static final int WordBoundary = 5;
+  public static final int NotWordBoundary = 6;
+  public static final int LastMatchEnd = 7;
+
+  public static final int LookAhead = 0;
+  public static final int LookBehind = 1;
+  public static final int Negative = 2;
+
+  public final int[] op;
+  public final int[] x;
+  public final int[] y;
+  public final CharSet[] sets;
+  public final int length;
+
+  // the number of capturing groups, not counting the whole match
+  public final int groupCount;
+  // capture slots come first, then registers used by Mark and Check
+  public final int slotCount;
+
+  // text every match must start with, possibly empty
+  public final String prefix;
+  // the chars a match may start with, or null if it may be empty
+  public final CharSet firstChars;
+  // true if matches may only start at the beginning of the input
+  public final boolean anchored;
+  // true if the lazy DFA can find the bounds of matches
+  public final boolean deterministic;
+  // true if the prefix is all there is to the pattern
+  public final boolean literal;
+
+  public final boolean unixLines;
+  public final boolean multiline;
+
+  private DFA search;
+  private DFA whole;
+  private DFA scan;
+
+  private Program(Builder b, Node root, int groupCount, int flags) {
+    this.op = b.op;
+    this.x = b.x;
+    this.y = b.y;
+    this.sets = b.sets;
+    this.length = b.length;
+    this.groupCount = groupCount;
+    this.slotCount = ((groupCount + 1) * 2) + b.registers;
+
+    StringBuilder sb = new StringBuilder();
+    boolean complete = root.prefix(sb);
+    this.prefix = sb.toString();
+    this.firstChars = root.canMatchEmpty() ? null : root.firstChars();
+    this.anchored = root.anchored();
+    // the DFA can't tell whether a loop body has matched the empty
+    // string, so it doesn't run programs with Check instructions
+    this.deterministic = root.deterministic() && b.registers == 0;
+
+    boolean assertions = false;
+    for (int i = 0; i < length; ++i) {
+      if (op[i] == Assert) {
+        assertions = true;
+      }
+    }
+    this.literal = complete && deterministic && ! assertions;
+
+    this.unixLines = (flags & Pattern.UNIX_LINES) != 0;
+    this.multiline = (flags & Pattern.MULTILINE) != 0;
+  }
+
+  public static Program compile(Node root, int groupCount, int flags) {
+    Builder b = new Builder();
+    b.emit(Save, 0, 0, null);
+    root.compile(b);
+    b.emit(Save, 1, 0, null);
+    b.emit(Match, 0, 0, null);
+    b.resolveRegisters(groupCount);
+    return new Program(b, root, groupCount, flags);
+  }
+
+  // the DFA which finds where the leftmost-first match from a given
+  // position ends
+  public synchronized DFA searchDFA() {
+    if (search == null) {
+      search = new DFA(this, true, false);
+    }
+    return search;
+  }
+
+  // the DFA which finds every position at which a match from a given
+  // position may end
+  public synchronized DFA wholeDFA() {
+    if (whole == null) {
+      whole = new DFA(this, false, false);
+    }
+    return whole;
+  }
+
+  // the DFA which finds where the first match to end, wherever it
+  // starts, ends
+  public synchronized DFA scanDFA() {
+    if (scan == null) {
+      scan = new DFA(this, false, true);
+    }
+    return scan;
+  }
+
+  public boolean isLineTerminator(char c) {
+    if (unixLines) {
+      return c == '\n';
+    } else {
+      return c == '\n' || c == '\r' || c == '\u0085' || c == '\u2028'
+        || c == '\u2029';
+    }
+  }
+
+  private static boolean isWord(char c) {
+    return Character.isLetterOrDigit(c) || c == '_';
+  }
+
+  public boolean holds(int assertion, CharSequence input, int position,
+                       int start, int end, int lastMatchEnd)
+  {
+    switch (assertion) {
+    case BeginText:
+      return position == start;
+
+    case BeginLine:
+      if (position == start) {
+        return true;
+      } else if (position == end) {
+        return false;
+      } else {
+        char previous = input.charAt(position - 1);
+        return isLineTerminator(previous)
+          && (previous != '\r' || input.charAt(position) != '\n');
+      }
+
+    case EndText:
+      return position == end;
+
+    case EndTextOrFinalTerminator:
+      if (position == end) {
+        return true;
+      } else if (position == end - 1) {
+        return isLineTerminator(input.charAt(position))
+          && (position == start || input.charAt(position) != '\n'
+              || input.charAt(position - 1) != '\r');
+      } else {
+        return position == end - 2 && (! unixLines)
+          && input.charAt(position) == '\r'
+          && input.charAt(position + 1) == '\n';
+      }
+
+    case EndLine:
+      if (position == end) {
+        return true;
+      } else {
+        char c = input.charAt(position);
+        return isLineTerminator(c)
+          && (c != '\n' || position == start
+              || input.charAt(position - 1) != '\r');
+      }
+
+    case WordBoundary:
+    case NotWordBoundary: {
+      boolean before = position > start && isWord(input.charAt(position - 1));
+      boolean after = position < end && isWord(input.charAt(position));
+      return (before != after) == (assertion == WordBoundary);
+    }
+
+    case LastMatchEnd:
+      return position == lastMatchEnd;
+
+    default:
+      throw new IllegalStateException();
+    }
+  }
+
+  public static class Builder {
+    private int[] op = new int[16];
+    private int[] x = new int[16];
+    private int[] y = new int[16];
+    private CharSet[] sets = new CharSet[16];
+    private int length;
+    private int registers;
+
+    public int emit(int op, int x, int y, CharSet set) {
+      if (length == this.op.length) {
+        this.op = grow(this.op);
+        this.x = grow(this.x);
+        this.y = grow(this.y);
+        CharSet[] sets = new CharSet[length * 2];
+        System.arraycopy(this.sets, 0, sets, 0, length);
+        this.sets = sets;
+      }
+
+      this.op[length] = op;
+      this.x[length] = x;
+      this.y[length] = y;
+      this.sets[length] = set;
+      return length++;
+    }
+
+    private static int[] grow(int[] array) {
+      int[] copy = new int[array.length * 2];
+      System.arraycopy(array, 0, copy, 0, array.length);
+      return copy;
+    }
+
+    public int length() {
+      return length;
+    }
+
+    public void setX(int pc, int value) {
+      x[pc] = value;
+    }
+
+    public void setY(int pc, int value) {
+      y[pc] = value;
+    }
+
+    // allocates a register slot, numbered after all capture slots once
+    // the group count is known; see resolveRegisters
+    public int register() {
+      return registers++;
+    }
+
+    void resolveRegisters(int groupCount) {
+      int base = (groupCount + 1) * 2;
+      for (int i = 0; i < length; ++i) {
+        if (op[i] == Mark || op[i] == Check) {
+          x[i] += base;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,80 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.zip;
+
+import java.nio.ByteBuffer;
+
+public class Adler32 implements Checksum {
+  private static final int Modulus = 65521;
+
+  // updates shorter than this are done here rather than natively,
+  // where they would cost less than the call itself
+  private static final int NativeThreshold = 32;
+
+  // the low half is the sum of the bytes so far plus one, and the high
+  // half the sum of those sums, each modulo Modulus
+  private int adler = 1;
+
+  public void reset() {
+    adler = 1;
+  }
+
+  public void update(int b) {
+    int a = ((adler & 0xFFFF) + (b & 0xFF)) % Modulus;
+    adler = ((((adler >>> 16) + a) % Modulus) << 16) | a;
+  }
+
+  public void update(byte[] array, int offset, int length) {
+    if (offset < 0 || length < 0 || offset > array.length - length) {
+      throw new ArrayIndexOutOfBoundsException();
+    }
+
+    if (length < NativeThreshold) {
+      // neither sum can overflow before the end, so reduce them once
+      int a = adler & 0xFFFF;
+      int b = adler >>> 16;
+      for (int i = offset; i < offset + length; ++i) {
+        a += array[i] & 0xFF;
+        b += a;
+      }
+      adler = ((b % Modulus) << 16) | (a % Modulus);
+    } else {
+      adler = update(adler, array, null, offset, length);
+    }
+  }
+
+  public void update(byte[] array) {
+    update(array, 0, array.length);
+  }
+
+  public void update(ByteBuffer buffer) {
+    int length = buffer.remaining();
+    if (buffer.isDirect()) {
+      adler = update(adler, null, buffer, buffer.position(), length);
+    } else if (buffer.hasArray()) {
+      update(buffer.array(), buffer.arrayOffset() + buffer.position(),
+             length);
+    } else {
+      byte[] copy = new byte[length];
+      buffer.get(copy);
+      update(copy);
+      return;
+    }
+    buffer.position(buffer.position() + length);
+  }
+
+  public long getValue() {
+    return adler & 0xFFFFFFFFL;
+  }
+
+  private static native int update(int adler, byte[] array,
+                                   ByteBuffer buffer, int offset, int length);
+}
@@ -10,41 +10,57 @@
 
 package java.util.zip;
 
-public class CRC32 {
-  private static final int Polynomial = 0x04C11DB7;
-  private static final int Width = 32;
-  private static final int Top = 1 << (Width - 1);
-  private static final int InitialRemainder = 0xFFFFFFFF;
-  private static final long ResultXor = 0xFFFFFFFFL;
+import java.nio.ByteBuffer;
+
+public class CRC32 implements Checksum {
+  // the IEEE polynomial, bit-reversed, since the CRC is computed least
+  // significant bit first
+  private static final int Polynomial = 0xEDB88320;
+
+  // updates shorter than this are done here rather than natively,
+  // where they would cost less than the call itself
+  private static final int NativeThreshold = 32;
 
   private static final int[] table = new int[256];
 
   static {
     for (int dividend = 0; dividend < 256; ++ dividend) {
-      int remainder = dividend << (Width - 8);
+      int remainder = dividend;
       for (int bit = 8; bit > 0; --bit) {
-        remainder = ((remainder & Top) != 0)
-          ? (remainder << 1) ^ Polynomial
-          : (remainder << 1);
+        remainder = ((remainder & 1) != 0)
+          ? (remainder >>> 1) ^ Polynomial
+          : (remainder >>> 1);
       }
       table[dividend] = remainder;
     }
   }
 
-  private int remainder = InitialRemainder;
+  // the checksum of the bytes so far, as zlib keeps it
+  private int crc;
 
   public void reset() {
-    remainder = InitialRemainder;
+    crc = 0;
   }
 
   public void update(int b) {
-    remainder = table[reflect(b, 8) ^ (remainder >>> (Width - 8))]
-      ^ (remainder << 8);
+    int c = ~crc;
+    c = table[(c ^ b) & 0xFF] ^ (c >>> 8);
+    crc = ~c;
   }
 
   public void update(byte[] array, int offset, int length) {
-    for (int i = 0; i < length; ++i) {
-      update(array[offset + i] & 0xFF);
+    if (offset < 0 || length < 0 || offset > array.length - length) {
+      throw new ArrayIndexOutOfBoundsException();
+    }
+
+    if (length < NativeThreshold) {
+      int c = ~crc;
+      for (int i = offset; i < offset + length; ++i) {
+        c = table[(c ^ array[i]) & 0xFF] ^ (c >>> 8);
+      }
+      crc = ~c;
+    } else {
+      crc = update(crc, array, null, offset, length);
     }
   }
 
@@ -52,18 +68,26 @@ public class CRC32 {
     update(array, 0, array.length);
   }
 
-  public long getValue() {
-    return (reflect(remainder, Width) ^ ResultXor) & 0xFFFFFFFFL;
+  public void update(ByteBuffer buffer) {
+    int length = buffer.remaining();
+    if (buffer.isDirect()) {
+      crc = update(crc, null, buffer, buffer.position(), length);
+    } else if (buffer.hasArray()) {
+      update(buffer.array(), buffer.arrayOffset() + buffer.position(),
+             length);
+    } else {
+      byte[] copy = new byte[length];
+      buffer.get(copy);
+      update(copy);
+      return;
+    }
+    buffer.position(buffer.position() + length);
   }
 
-  private static int reflect(int x, int n) {
-    int reflection = 0;
-    for (int i = 0; i < n; ++i) {
-      if ((x & 1) != 0) {
-        reflection |= (1 << ((n - 1) - i));
-      }
-      x = (x >>> 1);
-    }
-    return reflection;
+  public long getValue() {
+    return crc & 0xFFFFFFFFL;
   }
+
+  private static native int update(int crc, byte[] array, ByteBuffer buffer,
+                                   int offset, int length);
 }
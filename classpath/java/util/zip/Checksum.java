@@ -0,0 +1,21 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.zip;
+
+public interface Checksum {
+  public void update(int b);
+
+  public void update(byte[] array, int offset, int length);
+
+  public long getValue();
+
+  public void reset();
+}
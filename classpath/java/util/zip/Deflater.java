@@ -10,28 +10,42 @@
 
 package java.util.zip;
 
+import java.nio.ByteBuffer;
+
 public class Deflater {
   private static final int DEFAULT_LEVEL = 6; // default compression level (6 is default for gzip)
   private static final int Z_OK = 0;
   private static final int Z_STREAM_END = 1;
   private static final int Z_NEED_DICT = 2;
 
+  // as in Inflater, streams released by end are reset and kept for
+  // reuse, each with the format and level it was made with
+  private static final int PoolSize = 8;
+  private static final long[] pool = new long[PoolSize];
+  private static final int[] poolKeys = new int[PoolSize];
+  private static int poolCount;
+
 //   static {
 //     System.loadLibrary("natives");
 //   }
 
   private long peer;
   private byte[] input;
+  // the buffer input is taken from, if any; see Inflater.inputBuffer
+  private ByteBuffer inputBuffer;
   private int offset;
   private int length;
   private boolean needDictionary;
   private boolean finished;
   private final boolean nowrap;
+  private int level;
   private boolean finish;
+  private final int[] results = new int[3];
 
   public Deflater(int level, boolean nowrap) {
     this.nowrap = nowrap;
-    peer = make(nowrap, level);
+    this.level = level;
+    peer = acquire(nowrap, level);
   }
 
   public Deflater(int level) {
@@ -48,8 +62,44 @@ public class Deflater {
     }
   }
 
+  private static int key(boolean nowrap, int level) {
+    return ((level + 1) * 2) + (nowrap ? 1 : 0);
+  }
+
+  private static long acquire(boolean nowrap, int level) {
+    int key = key(nowrap, level);
+    synchronized (pool) {
+      for (int i = poolCount - 1; i >= 0; --i) {
+        if (poolKeys[i] == key) {
+          long peer = pool[i];
+          -- poolCount;
+          pool[i] = pool[poolCount];
+          poolKeys[i] = poolKeys[poolCount];
+          return peer;
+        }
+      }
+    }
+    return make(nowrap, level);
+  }
+
+  private static void release(long peer, boolean nowrap, int level) {
+    reset(peer);
+
+    synchronized (pool) {
+      if (poolCount < PoolSize) {
+        pool[poolCount] = peer;
+        poolKeys[poolCount] = key(nowrap, level);
+        ++ poolCount;
+        return;
+      }
+    }
+    dispose(peer);
+  }
+
   private static native long make(boolean nowrap, int level);
 
+  private static native void reset(long peer);
+
   public boolean finished() {
     return finished;
   }
@@ -71,8 +121,10 @@ public class Deflater {
       throw new IllegalArgumentException("Valid compression levels are 0-9");
     }
 
-    dispose(peer);
-    peer = make(nowrap, level);
+    check();
+    release(peer, nowrap, this.level);
+    peer = acquire(nowrap, level);
+    this.level = level;
   }
   
   public void setInput(byte[] input) {
@@ -80,15 +132,39 @@ public class Deflater {
   }
 
   public void setInput(byte[] input, int offset, int length) {
+    if (offset < 0 || length < 0 || offset > input.length - length) {
+      throw new ArrayIndexOutOfBoundsException();
+    }
+
     this.input = input;
+    this.inputBuffer = null;
     this.offset = offset;
     this.length = length;
   }
 
+  public void setInput(ByteBuffer input) {
+    if (input.isDirect()) {
+      this.input = null;
+      this.offset = input.position();
+    } else if (input.hasArray()) {
+      this.input = input.array();
+      this.offset = input.arrayOffset() + input.position();
+    } else {
+      byte[] copy = new byte[input.remaining()];
+      input.get(copy);
+      setInput(copy);
+      return;
+    }
+
+    this.inputBuffer = input;
+    this.length = input.remaining();
+  }
+
   public void reset() {
-    dispose();
-    peer = make(nowrap, DEFAULT_LEVEL);
+    check();
+    reset(peer);
     input = null;
+    inputBuffer = null;
     offset = length = 0;
     finish = false;
     needDictionary = finished = false;
@@ -99,22 +175,52 @@ public class Deflater {
   }
 
   public int deflate(byte[] output, int offset, int length) {
+    if (output == null) {
+      throw new NullPointerException();
+    }
+
+    if (offset < 0 || length < 0 || offset > output.length - length) {
+      throw new ArrayIndexOutOfBoundsException();
+    }
+
+    return deflate(output, null, offset, length);
+  }
+
+  public int deflate(ByteBuffer output) {
+    int count;
+    if (output.isDirect()) {
+      count = deflate(null, output, output.position(), output.remaining());
+    } else if (output.hasArray()) {
+      count = deflate(output.array(), null,
+                      output.arrayOffset() + output.position(),
+                      output.remaining());
+    } else {
+      byte[] buffer = new byte[output.remaining()];
+      count = deflate(buffer, null, 0, buffer.length);
+      output.put(buffer, 0, count);
+      return count;
+    }
+
+    output.position(output.position() + count);
+    return count;
+  }
+
+  private int deflate(byte[] outputArray, ByteBuffer outputBuffer,
+                      int offset, int length)
+  {
     final int zlibResult = 0;
     final int inputCount = 1;
     final int outputCount = 2;
 
-    if (peer == 0) {
-      throw new IllegalStateException();      
-    }
+    check();
 
-    if (input == null || output == null) {
+    if (input == null && inputBuffer == null) {
       throw new NullPointerException();
     }
 
-    int[] results = new int[3];
-    deflate(peer, 
-            input, this.offset, this.length,
-            output, offset, length, finish, results);
+    deflate(peer, input, input == null ? inputBuffer : null, this.offset,
+            this.length, outputArray, outputBuffer, offset, length, finish,
+            results);
 
     if (results[zlibResult] < 0) {
       throw new AssertionError();
@@ -132,6 +238,9 @@ public class Deflater {
 
     this.offset += results[inputCount];
     this.length -= results[inputCount];
+    if (inputBuffer != null) {
+      inputBuffer.position(inputBuffer.position() + results[inputCount]);
+    }
     
     return results[outputCount];
   }
@@ -142,8 +251,10 @@ public class Deflater {
 
   private static native void deflate
     (long peer,
-     byte[] input, int inputOffset, int inputLength,
-     byte[] output, int outputOffset, int outputLength,
+     byte[] inputArray, ByteBuffer inputBuffer, int inputOffset,
+     int inputLength,
+     byte[] outputArray, ByteBuffer outputBuffer, int outputOffset,
+     int outputLength,
      boolean finish,
      int[] results);
 
@@ -153,9 +264,11 @@ public class Deflater {
 
   public void dispose() {
     if (peer != 0) {
-      dispose(peer);
+      release(peer, nowrap, level);
       peer = 0;
     }
+    input = null;
+    inputBuffer = null;
   }
 
   private static native void dispose(long peer);
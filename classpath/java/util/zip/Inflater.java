@@ -10,26 +10,40 @@
 
 package java.util.zip;
 
+import java.nio.ByteBuffer;
+
 public class Inflater {
   private static final int Z_OK = 0;
   private static final int Z_STREAM_END = 1;
   private static final int Z_NEED_DICT = 2;
 
+  // zlib allocates a window and tables for each stream, so streams
+  // released by end are reset and kept here for reuse, separately for
+  // each format
+  private static final int PoolSize = 8;
+  private static final long[][] pool = new long[2][PoolSize];
+  private static final int[] poolCount = new int[2];
+
 //   static {
 //     System.loadLibrary("natives");
 //   }
 
   private long peer;
   private byte[] input;
+  // the buffer input is taken from, if any, whose position is advanced
+  // as it is consumed; if input is null, the buffer is direct and
+  // zlib reads it in place
+  private ByteBuffer inputBuffer;
   private int offset;
   private int length;
   private boolean needDictionary;
   private boolean finished;
   private final boolean nowrap;
+  private final int[] results = new int[3];
 
   public Inflater(boolean nowrap) {
     this.nowrap = nowrap;
-    peer = make(nowrap);
+    peer = acquire(nowrap);
   }
 
   public Inflater() {
@@ -42,8 +56,33 @@ public class Inflater {
     }
   }
 
+  private static long acquire(boolean nowrap) {
+    int kind = nowrap ? 1 : 0;
+    synchronized (pool) {
+      if (poolCount[kind] > 0) {
+        return pool[kind][-- poolCount[kind]];
+      }
+    }
+    return make(nowrap);
+  }
+
+  private static void release(long peer, boolean nowrap) {
+    reset(peer);
+
+    int kind = nowrap ? 1 : 0;
+    synchronized (pool) {
+      if (poolCount[kind] < PoolSize) {
+        pool[kind][poolCount[kind] ++] = peer;
+        return;
+      }
+    }
+    dispose(peer);
+  }
+
   private static native long make(boolean nowrap);
 
+  private static native void reset(long peer);
+
   public boolean finished() {
     return finished;
   }
@@ -65,15 +104,39 @@ public class Inflater {
   }
 
   public void setInput(byte[] input, int offset, int length) {
+    if (offset < 0 || length < 0 || offset > input.length - length) {
+      throw new ArrayIndexOutOfBoundsException();
+    }
+
     this.input = input;
+    this.inputBuffer = null;
     this.offset = offset;
     this.length = length;
   }
 
+  public void setInput(ByteBuffer input) {
+    if (input.isDirect()) {
+      this.input = null;
+      this.offset = input.position();
+    } else if (input.hasArray()) {
+      this.input = input.array();
+      this.offset = input.arrayOffset() + input.position();
+    } else {
+      byte[] copy = new byte[input.remaining()];
+      input.get(copy);
+      setInput(copy);
+      return;
+    }
+
+    this.inputBuffer = input;
+    this.length = input.remaining();
+  }
+
   public void reset() {
-    dispose();
-    peer = make(nowrap);
+    check();
+    reset(peer);
     input = null;
+    inputBuffer = null;
     offset = length = 0;
     needDictionary = finished = false;
   }
@@ -84,22 +147,53 @@ public class Inflater {
 
   public int inflate(byte[] output, int offset, int length)
     throws DataFormatException
+  {
+    if (output == null) {
+      throw new NullPointerException();
+    }
+
+    if (offset < 0 || length < 0 || offset > output.length - length) {
+      throw new ArrayIndexOutOfBoundsException();
+    }
+
+    return inflate(output, null, offset, length);
+  }
+
+  public int inflate(ByteBuffer output) throws DataFormatException {
+    int count;
+    if (output.isDirect()) {
+      count = inflate(null, output, output.position(), output.remaining());
+    } else if (output.hasArray()) {
+      count = inflate(output.array(), null,
+                      output.arrayOffset() + output.position(),
+                      output.remaining());
+    } else {
+      byte[] buffer = new byte[output.remaining()];
+      count = inflate(buffer, null, 0, buffer.length);
+      output.put(buffer, 0, count);
+      return count;
+    }
+
+    output.position(output.position() + count);
+    return count;
+  }
+
+  private int inflate(byte[] outputArray, ByteBuffer outputBuffer,
+                      int offset, int length)
+    throws DataFormatException
   {
     final int zlibResult = 0;
     final int inputCount = 1;
     final int outputCount = 2;
 
-    if (peer == 0) {
-      throw new IllegalStateException();      
-    }
+    check();
 
-    if (input == null || output == null) {
+    if (input == null && inputBuffer == null) {
       throw new NullPointerException();
     }
 
-    int[] results = new int[3];
-    inflate(peer, input, this.offset, this.length,
-            output, offset, length, results);
+    inflate(peer, input, input == null ? inputBuffer : null, this.offset,
+            this.length, outputArray, outputBuffer, offset, length, results);
 
     if (results[zlibResult] < 0) {
       throw new DataFormatException();
@@ -117,14 +211,19 @@ public class Inflater {
 
     this.offset += results[inputCount];
     this.length -= results[inputCount];
+    if (inputBuffer != null) {
+      inputBuffer.position(inputBuffer.position() + results[inputCount]);
+    }
     
     return results[outputCount];
   }
 
   private static native void inflate
     (long peer,
-     byte[] input, int inputOffset, int inputLength,
-     byte[] output, int outputOffset, int outputLength,
+     byte[] inputArray, ByteBuffer inputBuffer, int inputOffset,
+     int inputLength,
+     byte[] outputArray, ByteBuffer outputBuffer, int outputOffset,
+     int outputLength,
      int[] results);
 
   public void end() {
@@ -133,9 +232,11 @@ public class Inflater {
 
   public void dispose() {
     if (peer != 0) {
-      dispose(peer);
+      release(peer, nowrap);
       peer = 0;
     }
+    input = null;
+    inputBuffer = null;
   }
 
   private static native void dispose(long peer);
@@ -11,37 +11,46 @@
 package java.util.zip;
 
 import java.io.File;
-import java.io.RandomAccessFile;
+import java.io.FileInputStream;
 import java.io.InputStream;
 import java.io.IOException;
+import java.io.EOFException;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
 import java.util.Enumeration;
 import java.util.Iterator;
 import java.util.Map;
 import java.util.HashMap;
 
+// The file is mapped into memory, as the VM's Finder does for the
+// class path, so that reading the directory and entries costs no
+// system calls, and deflated entries are inflated straight out of the
+// mapping.
 public class ZipFile {
-  private final RandomAccessFile file;
   private final Window window;
   private final Map<String,Integer> index = new HashMap();
 
   public ZipFile(String name) throws IOException {
-    file = new RandomAccessFile(name, "r");
-    window = new Window(file, 4096);
+    FileInputStream in = new FileInputStream(name);
+    try {
+      FileChannel channel = in.getChannel();
+      window = new Window
+        (channel.map(FileChannel.MapMode.READ_ONLY, 0, channel.size()));
+    } finally {
+      // the mapping outlives the file descriptor
+      in.close();
+    }
     
-    int fileLength = (int) file.length();
+    int fileLength = window.length;
     int pointer = fileLength - 22;
     byte[] magic = new byte[] { 0x50, 0x4B, 0x05, 0x06 };
     while (pointer > 0) {
-      if (equal(window.data, window.seek(pointer, magic.length),
-                magic, 0, magic.length))
-      {
+      if (equal(window, pointer, magic)) {
         pointer = directoryOffset(window, pointer);
 
         magic = new byte[] { 0x50, 0x4B, 0x01, 0x02 };
         while (pointer < fileLength) {
-          if (equal(window.data, window.seek(pointer, magic.length),
-                    magic, 0, magic.length))
-          {
+          if (equal(window, pointer, magic)) {
             index.put(entryName(window, pointer), pointer);
             pointer = entryEnd(window, pointer);
           } else {
@@ -86,77 +95,49 @@ public class ZipFile {
   }
 
   public InputStream getInputStream(ZipEntry entry) throws IOException {
-    final int pointer = ((MyEntry) entry).pointer();
+    int pointer = ((MyEntry) entry).pointer();
     int method = compressionMethod(window, pointer);
-    int size = compressedSize(window, pointer);
-    InputStream in = new MyInputStream(file, fileData(window, pointer), size);
+    ByteBuffer data = window.slice
+      (fileData(window, pointer), compressedSize(window, pointer));
 
     final int Stored = 0;
     final int Deflated = 8;
 
     switch (method) {
     case Stored:
-      return in;
+      return new MyInputStream(data);
 
     case Deflated:
-      return new InflaterInputStream(in, new Inflater(true)) {
-        int remaining = uncompressedSize(window, pointer);
-
-        public int read() throws IOException {
-          int c = super.read();
-          if (c >= 0) {
-            -- remaining;
-          }
-          return c;
-        }
-
-        public int read(byte[] buffer) throws IOException {
-          return read(buffer, 0, buffer.length);
-        }
-
-        public int read(byte[] buffer, int offset, int length)
-          throws IOException
-        {
-          int c = super.read(buffer, offset, length);
-          if (c > 0) {
-            remaining -= c;
-          }
-          return c;
-        }
-
-        public int available() {
-          return remaining;
-        }
-      };
+      return new MyInflaterInputStream
+        (data, uncompressedSize(window, pointer));
 
     default:
       throw new IOException();
     }
   }
 
-  private static boolean equal(byte[] a, int aOffset, byte[] b, int bOffset,
-                               int size)
-  {
-    for (int i = 0; i < size; ++i) {
-      if (a[aOffset + i] != b[bOffset + i]) return false;
+  private static boolean equal(Window w, int p, byte[] b) throws IOException {
+    w.check(p, b.length);
+    for (int i = 0; i < b.length; ++i) {
+      if (w.data.get(p + i) != b[i]) return false;
     }
     return true;
   }
 
   private static int get2(Window w, int p) throws IOException {
-    int offset = w.seek(p, 2);
+    w.check(p, 2);
     return
-      ((w.data[offset + 1] & 0xFF) <<  8) |
-      ((w.data[offset    ] & 0xFF)      );
+      ((w.data.get(p + 1) & 0xFF) <<  8) |
+      ((w.data.get(p    ) & 0xFF)      );
   }
 
   private static int get4(Window w, int p) throws IOException {
-    int offset = w.seek(p, 4);
+    w.check(p, 4);
     return
-      ((w.data[offset + 3] & 0xFF) << 24) |
-      ((w.data[offset + 2] & 0xFF) << 16) |
-      ((w.data[offset + 1] & 0xFF) <<  8) |
-      ((w.data[offset    ] & 0xFF)      );
+      ((w.data.get(p + 3) & 0xFF) << 24) |
+      ((w.data.get(p + 2) & 0xFF) << 16) |
+      ((w.data.get(p + 1) & 0xFF) <<  8) |
+      ((w.data.get(p    ) & 0xFF)      );
   }
 
   private static int directoryOffset(Window w, int p) throws IOException {
@@ -169,7 +150,9 @@ public class ZipFile {
 
   protected static String entryName(Window w, int p) throws IOException {
     int length = entryNameLength(w, p);
-    return new String(w.data, w.seek(p + 46, length), length);
+    byte[] name = new byte[length];
+    w.slice(p + 46, length).get(name);
+    return new String(name);
   }
 
   private static int compressionMethod(Window w, int p) throws IOException {
@@ -228,51 +211,45 @@ public class ZipFile {
   }
 
   public void close() throws IOException {
-    file.close();
+    // the mapping is released once the last stream reading from it is
+    // collected
   }
 
   protected static class Window {
-    private final RandomAccessFile file;
-    public final byte[] data;
-    public int start;
-    public int length;
-    
-    public Window(RandomAccessFile file, int size) {
-      this.file = file;
-      data = new byte[size];
+    // read only with absolute gets, so it may be shared between threads
+    public final ByteBuffer data;
+    public final int length;
+    // positioned and limited by slice, under its lock
+    private final ByteBuffer view;
+
+    public Window(ByteBuffer data) {
+      this.data = data;
+      this.length = data.capacity();
+      this.view = data.asReadOnlyBuffer();
     }
 
-    public int seek(int start, int length) throws IOException {
-      int fileLength = (int) file.length();
-
-      if (length > data.length) {
-        throw new IllegalArgumentException
-          ("length " + length + " greater than buffer length " + data.length);
-      }
-
+    public void check(int start, int length) {
       if (start < 0) {
         throw new IllegalArgumentException("negative start " + start);
       }
 
-      if (start + length > fileLength) {
+      if (length > this.length - start) {
         throw new IllegalArgumentException
           ("end " + (start + length) + " greater than file length " +
-           fileLength);
+           this.length);
       }
+    }
 
-      if (start < this.start || start + length > this.start + this.length) {
-        this.length = Math.min(data.length, fileLength);
-        this.start = start - ((this.length - length) / 2);
-        if (this.start < 0) {
-          this.start = 0;
-        } else if (this.start + this.length > fileLength) {
-          this.start = fileLength - this.length;
-        }
-        file.seek(this.start);
-        file.readFully(data, 0, this.length);
-      }
+    // a view of the given part of the file, with its own position
+    public ByteBuffer slice(int start, int length) {
+      check(start, length);
 
-      return start - this.start;
+      synchronized (view) {
+        view.clear();
+        view.position(start);
+        view.limit(start + length);
+        return view.slice();
+      }
     }
   }
 
@@ -353,38 +330,80 @@ public class ZipFile {
   }
 
   private static class MyInputStream extends InputStream {
-    private RandomAccessFile file;
-    private int offset;
-    private int length;
-
-    public MyInputStream(RandomAccessFile file, int start, int length) {
-      this.file = file;
-      this.offset = start;
-      this.length = length;
+    private final ByteBuffer data;
+
+    public MyInputStream(ByteBuffer data) {
+      this.data = data;
     }
 
     public int read() throws IOException {
-      byte[] b = new byte[1];
-      int c = read(b);
-      return (c == -1 ? -1 : b[0] & 0xFF);
+      return data.hasRemaining() ? data.get() & 0xFF : -1;
     }
 
     public int read(byte[] b, int offset, int length) throws IOException {
-      if (this.length == 0) return -1;
-
-      if (length > this.length) length = this.length;
+      if (! data.hasRemaining()) return -1;
 
-      file.seek(this.offset);
-      file.readFully(b, offset, length);
+      if (length > data.remaining()) length = data.remaining();
 
-      this.offset += length;
-      this.length -= length;
+      data.get(b, offset, length);
 
       return length;
     }
 
-    public void close() throws IOException {
-      file = null;
+    public int available() {
+      return data.remaining();
+    }
+  }
+
+  private static class MyInflaterInputStream extends InputStream {
+    private final Inflater inflater = new Inflater(true);
+    private int remaining;
+
+    public MyInflaterInputStream(ByteBuffer data, int size) {
+      this.remaining = size;
+      inflater.setInput(data);
+    }
+
+    public int read() throws IOException {
+      byte[] buffer = new byte[1];
+      int c = read(buffer);
+      return (c < 0 ? c : (buffer[0] & 0xFF));
+    }
+
+    public int read(byte[] b, int offset, int length) throws IOException {
+      if (length == 0) {
+        return 0;
+      }
+
+      try {
+        while (true) {
+          if (inflater.finished()) {
+            return -1;
+          }
+
+          int count = inflater.inflate(b, offset, length);
+          if (count > 0) {
+            remaining -= count;
+            return count;
+          } else if (inflater.needsDictionary()) {
+            throw new IOException("missing dictionary");
+          } else if (inflater.needsInput() && ! inflater.finished()) {
+            throw new EOFException();
+          }
+        }
+      } catch (DataFormatException e) {
+        throw new IOException(e);
+      } catch (IllegalStateException e) {
+        throw new IOException("stream closed");
+      }
+    }
+
+    public int available() {
+      return remaining;
+    }
+
+    public void close() {
+      inflater.end();
     }
   }
 }
@@ -10,4 +10,63 @@
 
 package sun.misc;
 
-public class Cleaner { }
+import java.lang.ref.PhantomReference;
+
+public class Cleaner extends PhantomReference<Object> {
+  // cleaners must stay reachable until they have run, so we keep the
+  // pending ones in a list
+  private static Cleaner first;
+
+  private Cleaner next;
+  private Cleaner previous;
+  private final Runnable thunk;
+
+  private Cleaner(Object referent, Runnable thunk) {
+    super(referent);
+    this.thunk = thunk;
+  }
+
+  public static Cleaner create(Object referent, Runnable thunk) {
+    if (thunk == null) {
+      return null;
+    }
+
+    Cleaner c = new Cleaner(referent, thunk);
+    synchronized (Cleaner.class) {
+      if (first != null) {
+        c.next = first;
+        first.previous = c;
+      }
+      first = c;
+    }
+    return c;
+  }
+
+  private static synchronized boolean remove(Cleaner c) {
+    if (c.next == c) {
+      // already removed
+      return false;
+    }
+
+    if (first == c) {
+      first = c.next;
+    }
+    if (c.next != null) {
+      c.next.previous = c.previous;
+    }
+    if (c.previous != null) {
+      c.previous.next = c.next;
+    }
+
+    c.next = c;
+    c.previous = c;
+    return true;
+  }
+
+  // called by the VM once the referent is unreachable
+  public void clean() {
+    if (remove(this)) {
+      thunk.run();
+    }
+  }
+}
@@ -76,7 +76,14 @@ public final class Unsafe {
   public native boolean compareAndSwapObject(Object o, long offset, Object old,
                                              Object new_);
 
+  public native boolean compareAndSwapLong(Object o, long offset, long old,
+                                           long new_);
+
   public void copyMemory(long src, long dst, long count) {
     copyMemory(null, src, null, dst, count);
   }
+
+  public void setMemory(long address, long count, byte value) {
+    setMemory(null, address, count, value);
+  }
 }
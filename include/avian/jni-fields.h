@@ -0,0 +1,55 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#ifndef AVIAN_JNI_FIELDS_H
+#define AVIAN_JNI_FIELDS_H
+
+#include <jni.h>
+
+/* Avian extensions to JNI for moving the primitive fields of an object
+   to or from a native struct in one call, rather than one Get/Set call
+   per field.
+
+   A layout is made once from a list of instance field IDs, which must
+   all name primitive fields.  The struct it describes holds the fields
+   in the order given, each at its natural alignment, as a C compiler
+   would lay out a struct declaring members of the corresponding JNI
+   types in that order.  AvianFieldLayoutSize returns the size of that
+   struct without trailing padding.  A layout may be used from any
+   thread and is only freed by AvianDisposeFieldLayout.
+
+   AvianMakeFieldLayout returns null with an IllegalArgumentException
+   pending if count is negative or any ID is null or names a field
+   holding an object. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+JNIIMPORT void* JNICALL
+AvianMakeFieldLayout(JNIEnv* e, const jfieldID* fields, jint count);
+
+JNIIMPORT jint JNICALL
+AvianFieldLayoutSize(JNIEnv* e, void* layout);
+
+JNIIMPORT void JNICALL
+AvianDisposeFieldLayout(JNIEnv* e, void* layout);
+
+JNIIMPORT void JNICALL
+AvianGetFields(JNIEnv* e, jobject o, void* layout, void* dst);
+
+JNIIMPORT void JNICALL
+AvianSetFields(JNIEnv* e, jobject o, void* layout, const void* src);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif//AVIAN_JNI_FIELDS_H
@@ -134,6 +134,7 @@ public:
     x86_64 = AVIAN_ARCH_X86_64,
     PowerPC = AVIAN_ARCH_POWERPC,
     Arm = AVIAN_ARCH_ARM,
+    Arm64 = AVIAN_ARCH_ARM64,
     UnknownArch = AVIAN_ARCH_UNKNOWN
   };
 
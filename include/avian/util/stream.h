@@ -100,6 +100,12 @@ class Stream: public AbstractStream {
     AbstractStream(client, size), data(data)
   { }
 
+  // the bytes not yet read, for looking at something in place before
+  // skipping it
+  const uint8_t* current() {
+    return data + position();
+  }
+
  private:
   virtual void copy(uint8_t* dst, unsigned offset, unsigned size) {
     memcpy(dst, data + offset, size);
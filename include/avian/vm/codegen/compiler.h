@@ -64,6 +64,11 @@ class Compiler {
 
   virtual void visitLogicalIp(unsigned logicalIp) = 0;
   virtual void startLogicalIp(unsigned logicalIp) = 0;
+  // lays out the instruction at logicalIp after all those not so marked
+  virtual void markCold(unsigned logicalIp) = 0;
+  // pads the code before the instruction at logicalIp so that it
+  // starts on a boundary suitable for the head of a loop
+  virtual void markLoopHeader(unsigned logicalIp) = 0;
 
   virtual Promise* machineIp(unsigned logicalIp) = 0;
 
@@ -105,6 +110,9 @@ class Compiler {
                              OperandType resultType,
                              unsigned argumentFootprint) = 0;
 
+  virtual void safepoint(Operand* address, TraceHandler* traceHandler,
+                         unsigned pollOffset) = 0;
+
   virtual void return_(unsigned size, Operand* value) = 0;
 
   virtual void initLocal(unsigned size, unsigned index, OperandType type) = 0;
@@ -181,6 +189,12 @@ class Compiler {
   virtual Operand* abs(unsigned size, Operand* a) = 0;
   virtual Operand* fabs(unsigned size, Operand* a) = 0;
   virtual Operand* fsqrt(unsigned size, Operand* a) = 0;
+  virtual Operand* popcnt(unsigned size, Operand* a) = 0;
+  virtual Operand* lzcnt(unsigned size, Operand* a) = 0;
+  virtual Operand* tzcnt(unsigned size, Operand* a) = 0;
+  virtual Operand* bswap(unsigned size, Operand* a) = 0;
+  virtual Operand* ffloor(unsigned size, Operand* a) = 0;
+  virtual Operand* fceil(unsigned size, Operand* a) = 0;
   virtual Operand* f2f(unsigned aSize, unsigned resSize, Operand* a) = 0;
   virtual Operand* f2i(unsigned aSize, unsigned resSize, Operand* a) = 0;
   virtual Operand* i2f(unsigned aSize, unsigned resSize, Operand* a) = 0;
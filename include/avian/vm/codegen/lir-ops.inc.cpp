@@ -2,6 +2,7 @@ LIR_OP_0(Return)
 LIR_OP_0(LoadBarrier)
 LIR_OP_0(StoreStoreBarrier)
 LIR_OP_0(StoreLoadBarrier)
+LIR_OP_0(AlignLoop)
 LIR_OP_0(Trap)
 
 LIR_OP_1(Call)
@@ -25,6 +26,12 @@ LIR_OP_2(Int2Float)
 LIR_OP_2(FloatSquareRoot)
 LIR_OP_2(FloatAbsolute)
 LIR_OP_2(Absolute)
+LIR_OP_2(PopCount)
+LIR_OP_2(LeadingZeros)
+LIR_OP_2(TrailingZeros)
+LIR_OP_2(ByteSwap)
+LIR_OP_2(FloatFloor)
+LIR_OP_2(FloatCeiling)
 
 LIR_OP_3(Add)
 LIR_OP_3(Subtract)
@@ -46,6 +46,40 @@ class Heap: public Allocator {
     virtual bool visit(unsigned) = 0;
   };
 
+  // roots divided into groups which don't depend on each other, such
+  // as the stacks of different threads, so they may be visited
+  // concurrently (see visitRootGroups)
+  class RootGroups {
+   public:
+    // worker identifies the collector thread making the call, so that
+    // state cached by one call may be reused by later calls with the
+    // same worker without locking; it is less than the worker count
+    // passed to makeHeap, or zero if that was zero
+    virtual void visit(Visitor* v, unsigned group, unsigned worker) = 0;
+  };
+
+  // figures describing the most recent collection; sizes are in bytes
+  class CollectionStatistics {
+   public:
+    CollectionType type;
+    // why a minor collection was upgraded to a major one, or null
+    const char* upgradeCause;
+    unsigned gen1Before;
+    unsigned gen1After;
+    unsigned gen2Before;
+    unsigned gen2After;
+    unsigned fixieCountBefore;
+    unsigned fixieCountAfter;
+    unsigned fixieFootprintBefore;
+    unsigned fixieFootprintAfter;
+    // per System::nanoTime, when tracing from the roots started, when
+    // sweeping the fixed objects left unmarked started, and when the
+    // collection ended
+    int64_t traceStart;
+    int64_t sweepStart;
+    int64_t end;
+  };
+
   class Client {
    public:
     virtual void collect(void* context, CollectionType type) = 0;
@@ -59,6 +93,8 @@ class Heap: public Allocator {
 
   virtual void setClient(Client* client) = 0;
   virtual void setImmortalHeap(uintptr_t* start, unsigned sizeInWords) = 0;
+  // whether p lies within the range passed to setImmortalHeap
+  virtual bool immortal(void* p) = 0;
   virtual unsigned limit() = 0;
   virtual bool limitExceeded(int pendingAllocation = 0) = 0;
   virtual void collect(CollectionType type, unsigned footprint,
@@ -72,14 +108,28 @@ class Heap: public Allocator {
   virtual void mark(void* p, unsigned offset, unsigned count) = 0;
   virtual void pad(void* p) = 0;
   virtual void* follow(void* p) = 0;
+  // visits groups 0 through count - 1, spreading them among any
+  // collector threads it can, or simply calling groups->visit with v
+  // and a worker of zero if it can't:
+  virtual void visitRootGroups(Visitor* v, RootGroups* groups,
+                               unsigned count) = 0;
   virtual void postVisit() = 0;
   virtual Status status(void* p) = 0;
   virtual CollectionType collectionType() = 0;
+  virtual const CollectionStatistics* lastCollection() = 0;
   virtual void disposeFixies() = 0;
   virtual void dispose() = 0;
 };
 
-Heap* makeHeap(System* system, unsigned limit);
+// workerCount is the number of threads (including the collecting
+// thread) used to perform minor collections; values greater than one
+// only take effect where atomic operations are available.  If
+// targetFootprint is non-zero, gen2 is sized to keep the total heap
+// footprint near it when the live set allows.  If largePages is true,
+// segments of at least one large page are backed by huge pages where
+// the system provides them:
+Heap* makeHeap(System* system, unsigned limit, unsigned workerCount = 1,
+               unsigned targetFootprint = 0, bool largePages = false);
 
 } // namespace vm
 
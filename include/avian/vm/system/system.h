@@ -33,6 +33,23 @@ class System : public avian::util::Aborter {
     virtual void interrupt() = 0;
     virtual bool getAndClearInterrupted() = 0;
     virtual void join() = 0;
+
+    // Blocks the calling thread, which must be this one, until unpark
+    // or interrupt is called, the specified number of nanoseconds (if
+    // non-zero) elapse, or the thread is spuriously woken.  Returns
+    // immediately if unpark has been called since the last park.
+    virtual void park(int64_t nanoseconds) = 0;
+    virtual void unpark() = 0;
+
+    // Returns the CPU time, in nanoseconds, this thread has used since
+    // it was started or attached, or -1 if that can't be known.
+    virtual int64_t cpuTime() = 0;
+
+    // Restricts this thread to the specified CPUs, numbered from zero,
+    // or if count is zero, lets it run wherever the process may.
+    // Returns false if the platform can't do that.
+    virtual bool setAffinity(const unsigned* cpus, unsigned count) = 0;
+
     virtual void dispose() = 0;
   };
 
@@ -122,17 +139,33 @@ class System : public avian::util::Aborter {
   virtual bool success(Status) = 0;
   virtual void* tryAllocate(unsigned sizeInBytes) = 0;
   virtual void free(const void* p) = 0;
+  // large allocations are backed by huge pages where the platform
+  // provides them and by normal pages otherwise.  The same size must
+  // be passed to the matching free.
+  virtual void* tryAllocateLarge(unsigned sizeInBytes) = 0;
+  virtual void freeLarge(const void* p, unsigned sizeInBytes) = 0;
+  // moves the pages wholly inside the specified range to the memory
+  // node of the calling thread's CPU and has those faulted in later
+  // placed there too, where the platform supports that
+  virtual void bindToLocalNode(void* p, unsigned sizeInBytes) = 0;
 #if !defined(AVIAN_AOT_ONLY)
-  virtual void* tryAllocateExecutable(unsigned sizeInBytes) = 0;
-  virtual void freeExecutable(const void* p, unsigned sizeInBytes) = 0;
+  virtual void* tryAllocateExecutable(unsigned sizeInBytes,
+                                      bool largePages = false) = 0;
+  virtual void freeExecutable(const void* p, unsigned sizeInBytes,
+                              bool largePages = false) = 0;
 #endif
   virtual Status attach(Runnable*) = 0;
-  virtual Status start(Runnable*) = 0;
+  // a stackSizeInBytes of zero means the platform default
+  virtual Status start(Runnable*, unsigned stackSizeInBytes = 0) = 0;
   virtual Status make(Mutex**) = 0;
   virtual Status make(Monitor**) = 0;
   virtual Status make(Local**) = 0;
   virtual Status handleSegFault(SignalHandler* handler) = 0;
   virtual Status handleDivideByZero(SignalHandler* handler) = 0;
+  // the handler runs in a signal context when the process is asked to
+  // quit by a terminal (SIGQUIT), so it can do little but set a flag.
+  // Its return value is ignored.
+  virtual Status handleQuit(SignalHandler* handler) = 0;
   virtual Status visit(Thread* thread, Thread* target,
                        ThreadVisitor* visitor) = 0;
   virtual uint64_t call(void* function, uintptr_t* arguments, uint8_t* types,
@@ -149,7 +182,10 @@ class System : public avian::util::Aborter {
   virtual const char* toAbsolutePath(Allocator* allocator,
                                      const char* name) = 0;
   virtual int64_t now() = 0;
+  // a monotonic clock for measuring intervals, in nanoseconds
+  virtual int64_t nanoTime() = 0;
   virtual void yield() = 0;
+  virtual unsigned processorCount() = 0;
   virtual void exit(int code) = 0;
   virtual void dispose() = 0;
 };
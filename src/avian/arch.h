@@ -43,7 +43,7 @@ compileTimeMemoryBarrier()
 #  include "x86.h"
 #elif defined ARCH_powerpc
 #  include "powerpc.h"
-#elif defined ARCH_arm
+#elif (defined ARCH_arm) || (defined ARCH_arm64)
 #  include "arm.h"
 #else
 #  error unsupported architecture
@@ -22,9 +22,15 @@
 #  include "mach/arm/thread_act.h"
 #  include "mach/arm/thread_status.h"
 
-#  define THREAD_STATE ARM_THREAD_STATE
-#  define THREAD_STATE_TYPE arm_thread_state_t
-#  define THREAD_STATE_COUNT ARM_THREAD_STATE_COUNT
+#  ifdef ARCH_arm64
+#    define THREAD_STATE ARM_THREAD_STATE64
+#    define THREAD_STATE_TYPE arm_thread_state64_t
+#    define THREAD_STATE_COUNT ARM_THREAD_STATE64_COUNT
+#  else
+#    define THREAD_STATE ARM_THREAD_STATE
+#    define THREAD_STATE_TYPE arm_thread_state_t
+#    define THREAD_STATE_COUNT ARM_THREAD_STATE_COUNT
+#  endif
 
 #  if __DARWIN_UNIX03 && defined(_STRUCT_ARM_EXCEPTION_STATE)
 #    define FIELD(x) __##x
@@ -34,7 +40,11 @@
 
 #  define THREAD_STATE_IP(state) ((state).FIELD(pc))
 #  define THREAD_STATE_STACK(state) ((state).FIELD(sp))
-#  define THREAD_STATE_THREAD(state) ((state).FIELD(r[8]))
+#  ifdef ARCH_arm64
+#    define THREAD_STATE_THREAD(state) ((state).FIELD(x[19]))
+#  else
+#    define THREAD_STATE_THREAD(state) ((state).FIELD(r[8]))
+#  endif
 #  define THREAD_STATE_LINK(state) ((state).FIELD(lr))
 
 #  define IP_REGISTER(context) \
@@ -53,6 +63,11 @@
 #  define STACK_REGISTER(context) (context->uc_mcontext.cpu.gpr[ARM_REG_SP])
 #  define THREAD_REGISTER(context) (context->uc_mcontext.cpu.gpr[ARM_REG_IP])
 #  define LINK_REGISTER(context) (context->uc_mcontext.cpu.gpr[ARM_REG_LR])
+#elif defined ARCH_arm64
+#  define IP_REGISTER(context) (context->uc_mcontext.pc)
+#  define STACK_REGISTER(context) (context->uc_mcontext.sp)
+#  define THREAD_REGISTER(context) (context->uc_mcontext.regs[19])
+#  define LINK_REGISTER(context) (context->uc_mcontext.regs[30])
 #else
 #  define IP_REGISTER(context) (context->uc_mcontext.arm_pc)
 #  define STACK_REGISTER(context) (context->uc_mcontext.arm_sp)
@@ -74,16 +89,36 @@ trap()
 {
 #ifdef _MSC_VER
   __debugbreak();
+#elif defined ARCH_arm64
+  asm("brk 0");
 #else
   asm("bkpt");
 #endif
 }
 
+inline void
+spinLoopHint()
+{
+#ifdef _MSC_VER
+  __yield();
+#elif (defined ARCH_arm64) || (defined __ARM_ARCH_6K__) || (defined __ARM_ARCH_7__) \
+  || (defined __ARM_ARCH_7A__) || (defined __ARM_ARCH_7R__) \
+  || (defined __ARM_ARCH_7M__) || (defined __ARM_ARCH_7S__)
+  __asm__ __volatile__("yield": : :"memory");
+#else
+  __asm__ __volatile__("": : :"memory");
+#endif
+}
+
 #ifndef _MSC_VER
 inline void
 memoryBarrier()
 {
+#ifdef ARCH_arm64
+  __asm__ __volatile__("dmb ish": : :"memory");
+#else
   asm("nop");
+#endif
 }
 #endif
 
@@ -139,7 +174,21 @@ syncInstructionCache(const void* start, unsigned size)
 
 #endif // AVIAN_AOT_ONLY
 
-#ifndef __APPLE__
+// copies or fills memory which won't be read again soon, bypassing the
+// cache where the processor allows (it doesn't here)
+inline void
+streamingCopy(void* dst, const void* src, uintptr_t size)
+{
+  memcpy(dst, src, size);
+}
+
+inline void
+streamingFill(void* dst, uint8_t value, uintptr_t size)
+{
+  memset(dst, value, size);
+}
+
+#if (! defined __APPLE__) && (! defined ARCH_arm64)
 typedef int (__kernel_cmpxchg_t)(int oldval, int newval, int *ptr);
 #  define __kernel_cmpxchg (*(__kernel_cmpxchg_t *)0xffff0fc0)
 #endif
@@ -147,7 +196,9 @@ typedef int (__kernel_cmpxchg_t)(int oldval, int newval, int *ptr);
 inline bool
 atomicCompareAndSwap32(uint32_t* p, uint32_t old, uint32_t new_)
 {
-#ifdef __APPLE__
+#ifdef ARCH_arm64
+  return __sync_bool_compare_and_swap(p, old, new_);
+#elif defined __APPLE__
   return OSAtomicCompareAndSwap32(old, new_, reinterpret_cast<int32_t*>(p));
 #elif (defined __QNX__)
   return old == _smp_cmpxchg(p, old, new_);
@@ -157,6 +208,72 @@ atomicCompareAndSwap32(uint32_t* p, uint32_t old, uint32_t new_)
 #endif
 }
 
+#ifdef ARCH_arm64
+// not defined for ARMv7, whose ldrexd and strexd need 8-byte
+// alignment, while a long field in a 32-bit heap object is only
+// aligned to a word, so wide volatile fields there are still guarded
+// by a monitor
+#define AVIAN_HAS_CAS64
+
+inline bool
+atomicCompareAndSwap64(uint64_t* p, uint64_t old, uint64_t new_)
+{
+  return __sync_bool_compare_and_swap(p, old, new_);
+}
+
+inline bool
+atomicCompareAndSwap(uintptr_t* p, uintptr_t old, uintptr_t new_)
+{
+  return atomicCompareAndSwap64(reinterpret_cast<uint64_t*>(p), old, new_);
+}
+
+inline uint64_t
+dynamicCall(void* function, uintptr_t* arguments, uint8_t* argumentTypes,
+            unsigned argumentCount, unsigned, unsigned returnType)
+{
+  const unsigned GprCount = 8;
+  uint64_t gprTable[GprCount];
+  unsigned gprIndex = 0;
+
+  const unsigned VfpCount = 8;
+  uint64_t vfpTable[VfpCount];
+  unsigned vfpIndex = 0;
+
+  RUNTIME_ARRAY(uint64_t, stack, argumentCount + 1);
+  unsigned stackIndex = 0;
+
+  for (unsigned i = 0; i < argumentCount; ++i) {
+    switch (argumentTypes[i]) {
+    case FLOAT_TYPE:
+    case DOUBLE_TYPE: {
+      if (vfpIndex < VfpCount) {
+        vfpTable[vfpIndex++] = arguments[i];
+      } else {
+        RUNTIME_ARRAY_BODY(stack)[stackIndex++] = arguments[i];
+      }
+    } break;
+
+    default: {
+      if (gprIndex < GprCount) {
+        gprTable[gprIndex++] = arguments[i];
+      } else {
+        RUNTIME_ARRAY_BODY(stack)[stackIndex++] = arguments[i];
+      }
+    } break;
+    }
+  }
+
+  // the assembly loads whole register tables, and the stack pointer
+  // must stay 16-byte aligned
+  memset(gprTable + gprIndex, 0, (GprCount - gprIndex) * 8);
+  memset(vfpTable + vfpIndex, 0, (VfpCount - vfpIndex) * 8);
+
+  unsigned stackSize = (stackIndex + (stackIndex & 1)) * 8;
+  return vmNativeCall
+    (function, stackSize, RUNTIME_ARRAY_BODY(stack), stackIndex * 8,
+     (gprIndex ? gprTable : 0), (vfpIndex ? vfpTable : 0), returnType);
+}
+#else // not ARCH_arm64
 inline bool
 atomicCompareAndSwap(uintptr_t* p, uintptr_t old, uintptr_t new_)
 {
@@ -278,6 +395,7 @@ dynamicCall(void* function, uintptr_t* arguments, uint8_t* argumentTypes,
      (gprIndex ? gprTable : 0),
      (vfpIndex ? vfpTable : 0), returnType);
 }
+#endif // not ARCH_arm64
 
 } // namespace vm
 
@@ -610,7 +610,7 @@ intercept(Thread* t, object c, const char* name, const char* spec,
       // through the vtable.
       methodFlags(t, clone) |= ACC_PRIVATE;
 
-      object native = makeNativeIntercept(t, function, true, clone);
+      object native = makeNativeIntercept(t, function, true, false, clone);
       
       PROTECT(t, native);
       
@@ -660,7 +660,8 @@ getFinder(Thread* t, const char* name, unsigned nameLength)
     unsigned size;
     uint8_t* data = function(&size);
     if (data) {
-      Finder* f = makeFinder(t->m->system, t->m->heap, data, size);
+      Finder* f = makeFinder
+        (t->m->system, categoryAllocator(t->m, ClassPathMemory), data, size);
       object finder = makeFinder
         (t, f, n, root(t, Machine::VirtualFileFinders));
 
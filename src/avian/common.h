@@ -130,6 +130,8 @@ typedef intptr_t intptr_alias_t;
 #    define ARCH_powerpc
 #  elif defined __arm__
 #    define ARCH_arm
+#  elif defined __aarch64__
+#    define ARCH_arm64
 #  else
 #    error "unsupported architecture"
 #  endif
@@ -166,7 +168,7 @@ typedef intptr_t __attribute__((__may_alias__)) intptr_alias_t;
 #    define LX "x"
 #    define ULD "u"
 #  endif
-#elif defined ARCH_x86_64
+#elif (defined ARCH_x86_64) || (defined ARCH_arm64)
 #  define LD "ld"
 #  define LX "lx"
 #  if (defined _MSC_VER) || (defined __MINGW32__)
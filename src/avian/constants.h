@@ -19,6 +19,7 @@ enum OpCode {
   aconst_null = 0x01,
   aload = 0x19,
   aload_0 = 0x2a,
+  aload_0_getfield = 0xce,
   aload_1 = 0x2b,
   aload_2 = 0x2c,
   aload_3 = 0x2d,
@@ -98,6 +99,7 @@ enum OpCode {
   fstore_3 = 0x46,
   fsub = 0x66,
   getfield = 0xb4,
+  getfield_quick = 0xcb,
   getstatic = 0xb2,
   goto_ = 0xa7,
   goto_w = 0xc8,
@@ -136,6 +138,7 @@ enum OpCode {
   ifnonnull = 0xc7,
   ifnull = 0xc6,
   iinc = 0x84,
+  iinc_goto = 0xcf,
   iload = 0x15,
   iload_0 = 0x1a,
   iload_1 = 0x1b,
@@ -147,9 +150,11 @@ enum OpCode {
   ineg = 0x74,
   instanceof = 0xc1,
   invokeinterface = 0xb9,
+  invokeinterface_quick = 0xd0,
   invokespecial = 0xb7,
   invokestatic = 0xb8,
   invokevirtual = 0xb6,
+  invokevirtual_quick = 0xcd,
   ior = 0x80,
   irem = 0x70,
   ireturn = 0xac,
@@ -209,6 +214,7 @@ enum OpCode {
   pop_ = 0x57,
   pop2 = 0x58,
   putfield = 0xb5,
+  putfield_quick = 0xcc,
   putstatic = 0xb3,
   ret = 0xa9,
   return_ = 0xb1,
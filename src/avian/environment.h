@@ -29,6 +29,7 @@
 #define AVIAN_ARCH_X86_64 (2 << 8)
 #define AVIAN_ARCH_ARM (3 << 8)
 #define AVIAN_ARCH_POWERPC (4 << 8)
+#define AVIAN_ARCH_ARM64 (5 << 8)
 
 #endif
 
@@ -0,0 +1,110 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#ifndef AVIAN_EVENTS_H
+#define AVIAN_EVENTS_H
+
+#include "avian/common.h"
+
+namespace vm {
+
+// The flight recorder, enabled by setting avian.events to the file it
+// should write, keeps the most recent events seen by each thread in a
+// ring buffer owned by that thread.  The buffers are written out on
+// demand (see avian.Machine.dumpEvents), on a crash, and when the VM
+// exits, as an EventFileHeader followed by the surviving events, in no
+// particular order.  src/tools/event-reader converts such a file to
+// JSON.  Events which overlap on a thread nest, so a trace of startup
+// (with avian.events.capacity large enough to keep all of it) shows
+// which class loads and initializers it spends its time in.
+
+const uint32_t EventFileMagic = 0x41564556; // "AVEV"
+const uint32_t EventFileVersion = 1;
+
+const unsigned EventNameCapacity = 80;
+
+enum EventType {
+  // a garbage collection, from the point of view of the collecting
+  // thread; a is 1 for a major collection and 0 for a minor one, b is
+  // the heap footprint afterward, and the name is the cause
+  CollectionEvent,
+
+  // a phase of a collection, named by the phase; a is as above
+  CollectionPhaseEvent,
+
+  // a method compiled by the JIT, named "class.method"; a is the size
+  // of the machine code
+  CompileEvent,
+
+  // a class file parsed, named by the class; a is its size
+  ClassLoadEvent,
+
+  // time spent blocked acquiring a monitor, named by the class of the
+  // object locked or by the VM lock (e.g. "classLock")
+  MonitorContentionEvent,
+
+  // time spent bringing the other threads to a stop for exclusive
+  // access to the heap, named by what it was wanted for; a is the
+  // number of threads waited for and b the nanoseconds spent waiting
+  // for them
+  ExclusiveEvent,
+
+  // a thread parked by LockSupport.park; a is the requested timeout in
+  // nanoseconds, or zero if there is none
+  ParkEvent,
+
+  // a phase of VM startup, named by the phase; those before the main
+  // thread exists are recorded once it does
+  StartupEvent,
+
+  // a class resolved by the VM's class loaders, including finding,
+  // parsing and linking it, named by the class
+  ClassResolveEvent,
+
+  // a class file looked up, and inflated if need be, in the class
+  // path, named by the file; a is its size, or zero if not found
+  ClassFindEvent,
+
+  // a static initializer run, named by the class
+  ClassInitEvent,
+
+  EventTypeCount
+};
+
+class EventFileHeader {
+ public:
+  uint32_t magic;
+  uint32_t version;
+  uint32_t eventSize;
+  uint32_t eventCount;
+};
+
+class Event {
+ public:
+  // System::nanoTime when the event started
+  int64_t time;
+  // in nanoseconds
+  int64_t duration;
+  uint64_t a;
+  uint64_t b;
+  // identifies the recording thread; filled in as the event is written
+  // out, since any thread only records into its own buffer
+  uint64_t thread;
+  uint32_t type;
+  // the low bits of the event's position in its buffer's history plus
+  // one, or zero while it is being written, so that a reader racing
+  // with the writer can tell a torn copy from a good one
+  uint32_t sequence;
+  char name[EventNameCapacity];
+};
+
+} // namespace vm
+
+#endif//AVIAN_EVENTS_H
@@ -91,6 +91,10 @@ inline uint32_t centralDirectoryOffset(const uint8_t* centralHeader) {
   return get4(centralHeader + 16);
 }
 
+inline uint16_t centralDirectoryEntryCount(const uint8_t* centralHeader) {
+  return get2(centralHeader + 10);
+}
+
 inline const uint8_t* fileName(const uint8_t* centralHeader) {
   return centralHeader + 46;
 }
@@ -170,11 +174,20 @@ class Finder {
   virtual const char* urlPrefix(const char* name) = 0;
   virtual const char* sourceUrl(const char* name) = 0;
   virtual const char* path() = 0;
+
+  // start threadCount threads inflating the entries listed (one per
+  // line, e.g. "java/lang/Object.class") in the file at listPath ahead
+  // of their being found
+  virtual void prefetch(const char* listPath, unsigned threadCount) = 0;
+
   virtual void dispose() = 0;
 };
 
+// cacheBudget is the number of bytes of inflated jar entries to keep
+// for reuse, or zero to inflate entries afresh each time they are found
 JNIEXPORT Finder*
-makeFinder(System* s, Allocator* a, const char* path, const char* bootLibrary);
+makeFinder(System* s, Allocator* a, const char* path, const char* bootLibrary,
+           unsigned cacheBudget = 0, bool cacheStatistics = false);
 
 Finder*
 makeFinder(System* s, Allocator* a, const uint8_t* jarData,
@@ -20,9 +20,17 @@
 #define EMBED_PREFIX_PROPERTY "avian.embed.prefix"
 #define CLASSPATH_PROPERTY "java.class.path"
 #define JAVA_HOME_PROPERTY "java.home"
+#define FINDER_CACHE_PROPERTY "avian.finder.cache"
+#define FINDER_CACHE_STATISTICS_PROPERTY "avian.finder.cache.statistics"
+#define FINDER_PREFETCH_PROPERTY "avian.finder.prefetch"
+#define FINDER_PREFETCH_THREADS_PROPERTY "avian.finder.prefetch.threads"
+#define GC_TARGET_FOOTPRINT_PROPERTY "avian.gc.targetFootprint"
+#define LARGE_PAGES_PROPERTY "avian.largePages"
+#define MEMORY_TRACKING_PROPERTY "avian.memory.tracking"
 #define BOOTCLASSPATH_PREPEND_OPTION "bootclasspath/p"
 #define BOOTCLASSPATH_OPTION "bootclasspath"
 #define BOOTCLASSPATH_APPEND_OPTION "bootclasspath/a"
+#define GC_THREADS_OPTION "gcthreads"
 #define BOOTCLASSPATH_APPEND_OPTION "bootclasspath/a"
 
 namespace vm {
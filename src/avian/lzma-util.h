@@ -20,6 +20,19 @@ namespace vm {
 
 const unsigned Padding = 16;
 
+const unsigned LzmaPropHeaderSize = 5;
+const unsigned LzmaHeaderSize = 13;
+
+// Large inputs are split into chunks which are compressed
+// independently, so they can be decoded in parallel.  Such data starts
+// with LzmaChunkedMarker, which is never a valid LZMA properties byte,
+// followed by three zero bytes, the uncompressed size, the chunk size
+// and the chunk count (each as four little-endian bytes), then the
+// compressed size of each chunk, then the chunks themselves.
+const uint8_t LzmaChunkedMarker = 0xFF;
+const unsigned LzmaChunkedHeaderSize = 16;
+const unsigned LzmaChunkSize = 2 * 1024 * 1024;
+
 class LzmaAllocator {
  public:
   LzmaAllocator(Allocator* a): a(a) {
@@ -24,6 +24,21 @@ uint8_t*
 encodeLZMA(System* s, Allocator* a, uint8_t* in, unsigned inSize,
            unsigned* outSize);
 
+// Reads ranges of a chunked stream, decoding only the chunks each
+// range touches and keeping the most recently used of them.
+class LzmaChunks {
+ public:
+  // the uncompressed size
+  virtual unsigned length() = 0;
+  virtual void read(unsigned offset, unsigned length, uint8_t* out) = 0;
+  virtual void dispose() = 0;
+};
+
+// Returns null if the specified data is not a chunked stream.
+LzmaChunks*
+openLZMAChunks(System* s, Allocator* a, uint8_t* in, unsigned inSize,
+               unsigned cacheCount);
+
 } // namespace vm
 
 #endif // LZMA_H
@@ -19,6 +19,9 @@
 #include "avian/processor.h"
 #include "avian/constants.h"
 #include "avian/arch.h"
+#include "avian/events.h"
+#include "avian/tracking-allocator.h"
+#include "avian/probes.h"
 
 using namespace avian::util;
 
@@ -46,6 +49,9 @@ using namespace avian::util;
 
 #define ENTER(t, state) StateResource MAKE_NAME(stateResource_) (t, state)
 
+#define ENTER_EXCLUSIVE(t, reason) \
+  StateResource MAKE_NAME(stateResource_) (t, Thread::ExclusiveState, reason)
+
 #define THREAD_RESOURCE0(t, releaseBody)                                \
   class MAKE_NAME(Resource_): public Thread::Resource {                 \
   public:                                                               \
@@ -119,13 +125,81 @@ const unsigned ThreadBackupHeapSizeInWords
 
 const unsigned ThreadHeapPoolSize = 64;
 
+// timed waits at least this long are timed by Machine::timerWheel,
+// which ticks once a millisecond, rather than by the kernel; shorter
+// ones would lose too much to rounding up to the tick
+const int64_t TimerWheelTickInNanoseconds = 1000 * 1000;
+const int64_t MinimumWheelTimeoutInNanoseconds = TimerWheelTickInNanoseconds;
+// and waits longer than this are timed by the kernel, since they are
+// rare and would be moved between wheels many times
+const int64_t MaximumWheelTimeoutInNanoseconds
+= 24LL * 60 * 60 * 1000 * 1000 * 1000;
+
+// fields marked sun.misc.Contended are surrounded by this much padding,
+// which covers a cache line and the one prefetched alongside it:
+const unsigned ContendedPaddingInBytes = 128;
+
 const unsigned FixedFootprintThresholdInBytes
 = ThreadHeapPoolSize * ThreadHeapSizeInBytes;
 
+// fixed objects allocated since the last collection may also use up to
+// this fraction of the heap limit before forcing another, so programs
+// which churn large arrays aren't collected every few megabytes:
+const unsigned FixedFootprintHeapFraction = 16;
+
+// the heap is under memory pressure while less than this percentage of
+// its limit was free after the last collection, unless
+// avian.heap.freeTarget says otherwise.  Soft references are then
+// cleared once they have gone unread for longer than this many
+// milliseconds per free megabyte, so the least recently read go first
+// as the free heap shrinks.
+const unsigned DefaultFreeHeapTargetPercent = 25;
+const int64_t SoftReferenceMillisecondsPerFreeMegabyte = 1000;
+
+// collection pauses are counted in log-linear buckets of microseconds:
+// four linear buckets per power of two, covering up to 2^33 us
+const unsigned CollectionPauseSubBuckets = 4;
+const unsigned CollectionPauseBucketCount = CollectionPauseSubBuckets * 32;
+
+// allocation sampling, enabled by setting avian.alloc.profile: on
+// average one sample is taken every this many bytes allocated.  It and
+// CPU sampling aggregate samples by stack in tables of this many
+// buckets.
+const unsigned DefaultAllocationSampleIntervalInBytes = 512 * 1024;
+const unsigned StackSampleBucketCount = 256;
+
+// CPU sampling, enabled by setting avian.profile or from avian.Machine:
+// running threads are sampled this often unless
+// avian.profile.interval says otherwise
+const unsigned DefaultCpuSampleIntervalInMilliseconds = 10;
+
+// flight recording, enabled by setting avian.events: each thread keeps
+// its most recent events, this many unless avian.events.capacity says
+// otherwise
+const unsigned DefaultEventCapacity = 1024;
+
+// finalizers and cleaners are taken off the queue this many at a time,
+// and up to avian.finalizer.threads threads (at most this many) share
+// the work, extra ones being started as the backlog grows
+const unsigned FinalizeBatchSize = 64;
+const unsigned MaximumFinalizeThreadCount = 16;
+
 // number of zombie threads which may accumulate before we force a GC
 // to clean them up:
 const unsigned ZombieCollectionThreshold = 16;
 
+// bounds on the Java stack size requested via the Thread constructor,
+// plus the extra native stack we reserve beyond it for VM and JNI code:
+const unsigned MinimumStackSizeInBytes = 16 * 1024;
+const unsigned MaximumStackSizeInBytes = 1024 * 1024 * 1024;
+const unsigned NativeStackReserveInBytes = 256 * 1024;
+
+// enough room for any report written by memoryReport:
+const unsigned MemoryReportCapacity = 1024;
+
+// enough room for any report written by safepointReport:
+const unsigned SafepointReportCapacity = 256;
+
 enum FieldCode {
   VoidField,
   ByteField,
@@ -160,10 +234,21 @@ const unsigned LinkFlag = 1 << 8;
 const unsigned HasFinalMemberFlag = 1 << 9;
 const unsigned SingletonFlag = 1 << 10;
 const unsigned ContinuationFlag = 1 << 11;
+const unsigned SoftReferenceFlag = 1 << 12;
+// the signatures, annotations, exception tables, inner class table
+// and enclosing method of the class and its members were skipped when
+// it was parsed and will be read from its class file again on first
+// use; see loadReflectionData
+const unsigned LazyReflectionFlag = 1 << 13;
 
 // method vmFlags:
 const unsigned ClassInitFlag = 1 << 0;
 const unsigned ConstructorFlag = 1 << 1;
+// some loaded class overrides this method:
+const unsigned OverriddenFlag = 1 << 2;
+// compiled code calls this method directly, on the assumption that it
+// has not been overridden:
+const unsigned DevirtualizedFlag = 1 << 3;
 
 #ifndef JNI_VERSION_1_6
 #define JNI_VERSION_1_6 0x00010006
@@ -1195,6 +1280,55 @@ class Reference {
 
 class Classpath;
 
+// a stack seen by one of the samplers, followed in memory by its
+// null-terminated collapsed form ("outer;...;inner", with ";class"
+// appended for allocations).  Until its class is known, an allocation
+// sample is pending and also records the sampled object.
+class StackSample {
+ public:
+  char* stack() {
+    return reinterpret_cast<char*>(this + 1);
+  }
+
+  StackSample* next;
+  object target;
+  uint64_t count;
+  uint64_t bytes;
+  uint32_t hash;
+  unsigned length;
+};
+
+class LibraryPreloader;
+
+class CpuSampler;
+
+class TimerWheel;
+
+// a timed wait registered with Machine::timerWheel, which lives in
+// the waiting thread's frame; see scheduleTimer
+class Timer {
+ public:
+  enum State {
+    Idle,
+    Pending,
+    Firing
+  };
+
+  Timer(System::Thread* thread, System::Monitor* monitor):
+    thread(thread), monitor(monitor), tick(0), next(0), previous(0),
+    state(Idle)
+  { }
+
+  System::Thread* thread;
+  // the monitor to notify when the timer fires, or null if the thread
+  // is to be unparked instead
+  System::Monitor* monitor;
+  uint64_t tick;
+  Timer* next;
+  Timer** previous;
+  State state;
+};
+
 class Machine {
  public:
   enum Type {
@@ -1260,7 +1394,12 @@ class Machine {
   Classpath* classpath;
   Thread* rootThread;
   Thread* exclusive;
+  Thread* handshakeTarget;
   Thread* finalizeThread;
+  unsigned finalizeThreadLimit;
+  unsigned finalizeHelperCount;
+  unsigned finalizeBacklog;
+  uint32_t fastThrowCount;
   Reference* jniReferences;
   const char** properties;
   unsigned propertyCount;
@@ -1270,9 +1409,24 @@ class Machine {
   unsigned activeCount;
   unsigned liveCount;
   unsigned daemonCount;
+  unsigned safepointCount;
+  // in nanoseconds, as is safepointMaxTime
+  int64_t safepointTime;
+  int64_t safepointMaxTime;
+  // what the exclusive state took longest to enter for
+  const char* safepointMaxReason;
+  // the last thread to stop for the exclusive state being entered
+  Thread* safepointStraggler;
+  // waits for other threads longer than this many nanoseconds are
+  // logged to stderr, unless it is zero (see avian.safepoint.threshold)
+  int64_t safepointLogThreshold;
   unsigned fixedFootprint;
   unsigned stackSizeInBytes;
   System::Local* localThread;
+  // holds a detached thread for reuse by the next attach from the same
+  // native thread, if avian.jni.cacheAttachments is set
+  System::Local* parkedThread;
+  LibraryPreloader* libraryPreloader;
   System::Monitor* stateLock;
   System::Monitor* heapLock;
   System::Monitor* classLock;
@@ -1288,18 +1442,96 @@ class Machine {
   object finalizeQueue;
   object weakReferences;
   object tenuredWeakReferences;
+  // the percentage of the heap limit below which the free heap puts it
+  // under memory pressure (see avian.heap.freeTarget)
+  unsigned freeHeapTarget;
+  // the time, in milliseconds, the last collection ended, which soft
+  // references record as they are read (see SoftReference.clock)
+  int64_t softReferenceClock;
+  // the offset of SoftReference.clock in the class's static table,
+  // zero if it has no such field, or -1 until the first soft reference
+  // is made
+  int softReferenceClockOffset;
+  // how long, in milliseconds, a soft reference may have gone unread
+  // and still be kept by the current collection
+  int64_t softReferenceAllowance;
+  // true once something has asked to hear of memory pressure (see
+  // avian.Machine.addMemoryPressureHandler)
+  bool memoryPressureWatched;
+  // true from a collection leaving the heap under pressure until the
+  // finalizer thread has passed the news on
+  bool memoryPressurePending;
+  // the number of collections started so far, by which state cached
+  // for the duration of one may be told from that of the last
+  unsigned collectionCount;
+  // whether classes loaded through a finder leave the data only
+  // reflection needs to be read again when it is asked for (see
+  // LazyReflectionFlag), which is true except when writing a boot
+  // image
+  bool lazyReflection;
   bool unsafe;
   bool collecting;
   bool triedBuiltinOnLoad;
   bool dumpedHeapOnOOM;
   bool alive;
+  object* stringCandidates;
+  unsigned stringCandidateCount;
+  object stringClass;
+  FILE* collectionLog;
+  uint64_t collectionPauseHistogram[CollectionPauseBucketCount];
+  System::Monitor* allocationSampleLock;
+  StackSample* pendingAllocationSamples;
+  StackSample* allocationSamples[StackSampleBucketCount];
+  int64_t allocationSampleCountdown;
+  unsigned allocationSampleInterval;
+  uint32_t allocationSampleSeed;
+  System::Monitor* cpuSampleLock;
+  StackSample* cpuSamples[StackSampleBucketCount];
+  // where the CPU profile will be written, or null if not sampling
+  char* cpuProfilePath;
+  unsigned cpuSampleInterval;
+  CpuSampler* cpuSampler;
+  // times long timed waits with a single thread, or null if
+  // avian.timer.wheel is false
+  TimerWheel* timerWheel;
+  // where recorded events are written on a crash or at exit, or null
+  // if they aren't being recorded
+  char* eventPath;
+  unsigned eventCapacity;
+  // guards contentionSamples, or null if contention isn't being
+  // profiled (see avian.contention.profile)
+  System::Monitor* contentionLock;
+  StackSample* contentionSamples[StackSampleBucketCount];
+  // set by quitHandler, if any, until a thread prints the class
+  // histogram it asks for (see avian.heap.histogramOnQuit)
+  System::SignalHandler* quitHandler;
+  volatile bool histogramRequested;
+  unsigned histogramLimit;
+  // counts the native memory used by parts of the VM, or null if it
+  // isn't being tracked (see avian.memory.tracking)
+  MemoryTracker* memoryTracker;
   JavaVMVTable javaVMVTable;
   JNIEnvVTable jniEnvVTable;
   uintptr_t* heapPool[ThreadHeapPoolSize];
-  unsigned heapPoolIndex;
+  uint32_t heapPoolIndex;
+  // true if each thread heap is moved to the memory node of the thread
+  // which takes it (see avian.heap.numa)
+  bool localHeaps;
   unsigned bootimageSize;
 };
 
+// Returns the allocator which the part of the VM in category should
+// use for native memory, counting it if tracking is on.
+inline Allocator*
+categoryAllocator(Machine* m, MemoryCategory category)
+{
+  if (m->memoryTracker) {
+    return &(m->memoryTracker->allocators[category]);
+  } else {
+    return m->heap;
+  }
+}
+
 void
 printTrace(Thread* t, object exception);
 
@@ -1359,6 +1591,10 @@ class Thread {
   static const unsigned ActiveFlag = 1 << 5;
   static const unsigned SystemFlag = 1 << 6;
   static const unsigned JoinFlag = 1 << 7;
+  static const unsigned FinalizerFlag = 1 << 8;
+
+  // must be a power of two:
+  static const unsigned MonitorCacheSize = 8;
 
   class Protector {
    public:
@@ -1403,6 +1639,12 @@ class Thread {
     Resource* next;
   };
 
+  // an operation run by handshake while its target is stopped
+  class Handshake {
+   public:
+    virtual void run(Thread* t, Thread* target) = 0;
+  };
+
   class ClassInitStack: public Resource {
    public:
     ClassInitStack(Thread* t, object class_):
@@ -1478,6 +1720,12 @@ class Thread {
     }
 
     virtual void run() {
+      if (t->m->localHeaps) {
+        // the default heap was allocated by the thread which started
+        // this one, possibly on another node
+        t->m->system->bindToLocalNode(t->defaultHeap, ThreadHeapSizeInBytes);
+      }
+
       enterActiveState(t);
 
       vm::run(t, runThread, 0);
@@ -1530,6 +1778,17 @@ class Thread {
   uintptr_t backupHeap[ThreadBackupHeapSizeInWords];
   unsigned backupHeapIndex;
   unsigned flags;
+  // (object, monitor) pairs, indexed by object address and cleared
+  // after every collection:
+  object monitorCache[MonitorCacheSize * 2];
+  // this thread's flight recorder buffer, written only by this thread,
+  // holding Machine::eventCapacity events, or null if not recording
+  Event* events;
+  // the number of events recorded so far, including those overwritten
+  uintptr_t eventCount;
+  // bytes allocated by this thread, not counting those in its current
+  // thread-local heap (see threadAllocatedBytes)
+  uint64_t allocatedBytes;
 };
 
 class Classpath {
@@ -1644,14 +1903,31 @@ objectClass(Thread*, object o)
   return maskAlignedPointer(fieldAtOffset<object>(o, 0));
 }
 
+inline unsigned
+fixedFootprintThreshold(Thread* t)
+{
+  return max(FixedFootprintThresholdInBytes,
+             t->m->heap->limit() / FixedFootprintHeapFraction);
+}
+
 inline unsigned
 stackSizeInWords(Thread* t)
 {
   return t->m->stackSizeInBytes / BytesPerWord;
 }
 
+// Moves t to the specified state.  When that is the exclusive state,
+// reason says what it is wanted for, for the safepoint statistics.
 void
-enter(Thread* t, Thread::State state);
+enter(Thread* t, Thread::State state, const char* reason = 0);
+
+// stops the target thread at its next safepoint poll (or right away
+// if it isn't running Java code), runs the handshake on the calling
+// thread whilst the target stays stopped, and then lets the target
+// continue.  Other threads are not affected.  Returns false without
+// running the handshake if the target has exited.
+bool
+handshake(Thread* t, Thread* target, Thread::Handshake* h);
 
 inline void
 enterActiveState(Thread* t)
@@ -1661,10 +1937,10 @@ enterActiveState(Thread* t)
 
 class StateResource: public Thread::Resource {
  public:
-  StateResource(Thread* t, Thread::State state):
+  StateResource(Thread* t, Thread::State state, const char* reason = 0):
     Resource(t), oldState(t->state)
   {
-    enter(t, state);
+    enter(t, state, reason);
   }
 
   ~StateResource() { enter(t, oldState); }
@@ -1677,6 +1953,19 @@ class StateResource: public Thread::Resource {
   Thread::State oldState;
 };
 
+// called by the interpreter at backward branches so that a thread
+// spinning in a loop which never allocates can't hold up another
+// thread waiting to enter the exclusive state or handshake with it
+inline void
+pollSafepoint(Thread* t)
+{
+  if (UNLIKELY((t->m->exclusive or t->m->handshakeTarget == t)
+               and t->state == Thread::ActiveState))
+  {
+    ENTER(t, Thread::IdleState);
+  }
+}
+
 inline void
 dispose(Thread* t, Reference* r)
 {
@@ -1684,7 +1973,7 @@ dispose(Thread* t, Reference* r)
   if (r->next) {
     r->next->handle = r->handle;
   }
-  t->m->heap->free(r, sizeof(*r));
+  categoryAllocator(t->m, ReferenceMemory)->free(r, sizeof(*r));
 }
 
 inline void
@@ -1707,6 +1996,109 @@ collect(Thread* t, Heap::CollectionType type, int pendingAllocation = 0);
 void
 shutDown(Thread* t);
 
+// Starts sampling the stacks of threads running Java or VM code, for
+// a profile to be written to the file named by spec, which must have
+// the form "cpu:<file>" ("cpu:-" means stderr).  Returns false if the
+// spec is malformed or a profile is already being taken.
+bool
+startCpuProfiler(Thread* t, const char* spec);
+
+// Stops sampling and writes the profile in collapsed-stack form, one
+// line per stack with its sample count.  Returns false if no profile
+// was being taken or the file can't be opened.
+bool
+stopCpuProfiler(Thread* t);
+
+// Arranges for the thread waiting on timer to be woken once the
+// specified number of nanoseconds have passed, rounded up to the
+// wheel's tick.  Returns false if there is no wheel or the timeout is
+// outside the range it handles, in which case the caller should time
+// the wait itself.  Otherwise, the caller must wait without a timeout
+// and then call cancelTimer.
+bool
+scheduleTimer(Thread* t, Timer* timer, int64_t nanoseconds);
+
+// Ensures timer has either fired or never will, so it may go out of
+// scope.  The caller must not hold the monitor the timer notifies.
+void
+cancelTimer(Thread* t, Timer* timer);
+
+// Returns the time to pass to recordEvent once the event is over, or
+// zero if t isn't recording events.
+inline int64_t
+eventStart(Thread* t)
+{
+  return t->events ? t->m->system->nanoTime() : 0;
+}
+
+// Returns the time to pass to recordContention once a contended lock
+// has been acquired, or zero if contention isn't being recorded.
+inline int64_t
+contentionStart(Thread* t)
+{
+  return (t->events or t->m->contentionLock)
+    ? t->m->system->nanoTime() : 0;
+}
+
+// Records that t was blocked from start until now acquiring lock.
+void
+recordContention(Thread* t, System::Monitor* lock, int64_t start);
+
+// Returns a report, allocated from t->m->heap in a block of *size
+// bytes, of the sites at which threads blocked on monitors for the
+// longest total time, one per line with the time in microseconds, the
+// number of times, and the site and lock, giving no more than limit
+// lines unless limit is zero.  Contention must be being profiled.
+char*
+contentionReport(Thread* t, unsigned limit, unsigned* size);
+
+// Writes a summary of the native memory used by the VM, truncated to
+// fit in capacity bytes, to buffer, giving the footprint and peak of
+// each tracked category if avian.memory.tracking is true, followed by
+// the sizes of fixed objects, compiled code and thread stacks.
+// Returns the length of the summary.
+unsigned
+memoryReport(Thread* t, char* buffer, unsigned capacity);
+
+// Writes a summary of the waits for other threads to stop so that one
+// may enter the exclusive state, truncated to fit in capacity bytes,
+// to buffer.  Returns the length of the summary.
+unsigned
+safepointReport(Thread* t, char* buffer, unsigned capacity);
+
+// Appends formatted text to the report of length *length in buffer,
+// truncating it to fit in capacity bytes.
+void
+appendReport(char* buffer, unsigned capacity, unsigned* length,
+             const char* format, ...);
+
+// Records an event which started at start and ends now in t's buffer,
+// which must exist.  The name, which may be null, is truncated to fit.
+void
+recordEvent(Thread* t, EventType type, int64_t start, uint64_t a,
+            uint64_t b, const char* name);
+
+// As above, naming the event after method.
+void
+recordMethodEvent(Thread* t, EventType type, int64_t start, uint64_t a,
+                  uint64_t b, object method);
+
+// As recordEvent, for an event which ended at end rather than now.
+void
+recordInterval(Thread* t, EventType type, int64_t start, int64_t end,
+               uint64_t a, uint64_t b, const char* name);
+
+// Writes the events recorded by live threads to the named file, or to
+// the one named by avian.events if path is null.  Returns false if
+// events aren't being recorded or the file can't be written.
+bool
+dumpEvents(Thread* t, const char* path);
+
+// Does the same as dumpEvents, to the file named by avian.events, but
+// without taking any of the VM's locks, for use when it is crashing.
+void
+dumpEventsOnCrash(Machine* m);
+
 #ifdef VM_STRESS
 
 inline void
@@ -1735,8 +2127,15 @@ inline void
 acquire(Thread* t, System::Monitor* m)
 {
   if (not m->tryAcquire(t->systemThread)) {
-    ENTER(t, Thread::IdleState);
-    m->acquire(t->systemThread);
+    int64_t start = contentionStart(t);
+
+    { ENTER(t, Thread::IdleState);
+      m->acquire(t->systemThread);
+    }
+
+    if (start) {
+      recordContention(t, m, start);
+    }
   }
 
   stress(t);
@@ -1957,6 +2356,14 @@ run(Thread* t, uint64_t (*function)(Thread*, uintptr_t*), uintptr_t* arguments)
   return runRaw(t, function, arguments);
 }
 
+// Returns the number of bytes of objects t has allocated.  If t is
+// another thread, the result may be slightly out of date.
+inline uint64_t
+threadAllocatedBytes(Thread* t)
+{
+  return t->allocatedBytes + (t->heapIndex * BytesPerWord);
+}
+
 inline void
 runJavaThread(Thread* t)
 {
@@ -1973,20 +2380,52 @@ runThread(Thread* t, uintptr_t*)
 
   checkDaemon(t);
 
-  if (t == t->m->finalizeThread) {
+  AVIAN_PROBE1(thread__start, t);
+
+  if (t == t->m->finalizeThread or (t->flags & Thread::FinalizerFlag)) {
     runFinalizeThread(t);
   } else if (t->javaThread) {
     runJavaThread(t);
   }
 
+  AVIAN_PROBE1(thread__stop, t);
+
   return 1;
 }
 
+inline unsigned
+requestedStackSizeInBytes(Thread* t, object javaThread)
+{
+  int64_t size = javaThread ? threadStackSize(t, javaThread) : 0;
+  if (size <= 0) {
+    return 0;
+  } else if (size < MinimumStackSizeInBytes) {
+    return MinimumStackSizeInBytes;
+  } else if (size > MaximumStackSizeInBytes) {
+    return MaximumStackSizeInBytes;
+  } else {
+    return size;
+  }
+}
+
+// the number of bytes of native stack Java frames may use on the
+// specified thread before a StackOverflowError is thrown
+inline unsigned
+javaStackSizeInBytes(Thread* t)
+{
+  unsigned size = requestedStackSizeInBytes(t, t->javaThread);
+  return size ? size : t->m->stackSizeInBytes;
+}
+
 inline bool
 startThread(Thread* t, Thread* p)
 {
   p->flags |= Thread::JoinFlag;
-  return t->m->system->success(t->m->system->start(&(p->runnable)));
+
+  unsigned size = requestedStackSizeInBytes(t, p->javaThread);
+  return t->m->system->success
+    (t->m->system->start
+     (&(p->runnable), size ? size + NativeStackReserveInBytes : 0));
 }
 
 inline void
@@ -2147,6 +2586,27 @@ objectFixed(Thread*, object o)
   return (alias(o, 0) & (~PointerMask)) == FixedMark;
 }
 
+// whether o is a non-fixed object in the boot image heap, which the
+// collector never visits, so that it may only refer to objects which
+// never move
+inline bool
+objectImmutable(Thread* t, object o)
+{
+  return t->m->heap->immortal(o) and not objectFixed(t, o);
+}
+
+// stores value in a field which only caches something that can be
+// found again, skipping the store if target is immutable: the
+// collector would not see the reference, and a machine which copies
+// the boot image heap from another could not tell it from a number
+inline void
+setCache(Thread* t, object target, unsigned offset, object value)
+{
+  if (not objectImmutable(t, target)) {
+    set(t, target, offset, value);
+  }
+}
+
 inline bool
 objectExtended(Thread*, object o)
 {
@@ -2295,6 +2755,27 @@ stringUTFChars(Thread* t, object string, char* chars, unsigned charsLength)
 bool
 isAssignableFrom(Thread* t, object a, object b);
 
+// the cheap part of the check an aastore of value, which isn't null,
+// into array must pass: the element class is the value's class or
+// Object, or the value's class was the last allowed into such an
+// array.  If it returns false, checkArrayStore decides.
+inline bool
+quickArrayStoreCheck(Thread* t, object array, object value)
+{
+  object arrayClass = objectClass(t, array);
+  object elementClass = classStaticTable(t, arrayClass);
+  object valueClass = objectClass(t, value);
+
+  return elementClass == valueClass
+    or elementClass == 0
+    or elementClass == type(t, Machine::JobjectType)
+    or classLastStored(t, arrayClass) == valueClass;
+}
+
+// may cause a collection, so the caller must protect array and value
+bool
+checkArrayStore(Thread* t, object array, object value);
+
 object
 classInitializer(Thread* t, object class_);
 
@@ -2545,7 +3026,8 @@ parseUtf8(Thread* t, object array);
 
 object
 parseClass(Thread* t, object loader, const uint8_t* data, unsigned length,
-           Machine::Type throwType = Machine::NoClassDefFoundErrorType);
+           Machine::Type throwType = Machine::NoClassDefFoundErrorType,
+           bool lazyReflection = false);
 
 object
 resolveClass(Thread* t, object loader, object name, bool throw_ = true,
@@ -2635,6 +3117,11 @@ findFieldInClass2(Thread* t, object class_, const char* name, const char* spec)
   return findFieldInClass(t, class_, n, s);
 }
 
+// returns the non-static field of o's class (or the static field,
+// if o is a class singleton) stored at the specified offset
+object
+fieldForOffset(Thread* t, object o, unsigned offset);
+
 object
 findMethodInClass(Thread* t, object class_, object name, object spec);
 
@@ -2710,6 +3197,30 @@ namespace vm {
 void
 dumpHeap(Thread* t, FILE* out);
 
+// writes an HPROF heap dump, gzipped if requested, streaming it rather
+// than buffering the whole dump.  Returns false if the file can't be
+// opened.
+bool
+dumpHprof(Thread* t, const char* path, bool compress);
+
+// Returns a histogram of the objects reachable from the roots by class,
+// allocated from t->m->heap in a block of *size bytes: one line per
+// class, most bytes first, with the number of instances, their shallow
+// size and, if retained is true, an estimate of what they keep alive,
+// giving no more than limit lines unless limit is zero.  The caller
+// must be in the exclusive state.
+char*
+classHistogram(Thread* t, unsigned limit, bool retained, unsigned* size);
+
+inline bool
+endsWith(const char* s, const char* suffix)
+{
+  size_t length = ::strlen(s);
+  size_t suffixLength = ::strlen(suffix);
+  return length >= suffixLength
+    and ::strcmp(s + length - suffixLength, suffix) == 0;
+}
+
 inline void NO_RETURN
 throw_(Thread* t, object e)
 {
@@ -2726,10 +3237,16 @@ throw_(Thread* t, object e)
       t->m->dumpedHeapOnOOM = true;
       const char* path = findProperty(t, "avian.heap.dump");
       if (path) {
-        FILE* out = vm::fopen(path, "wb");
-        if (out) {
-          dumpHeap(t, out);
-          fclose(out);
+        if (endsWith(path, ".hprof")) {
+          dumpHprof(t, path, false);
+        } else if (endsWith(path, ".hprof.gz")) {
+          dumpHprof(t, path, true);
+        } else {
+          FILE* out = vm::fopen(path, "wb");
+          if (out) {
+            dumpHeap(t, out);
+            fclose(out);
+          }
         }
       }
     }
@@ -2821,12 +3338,44 @@ findVirtualMethod(Thread* t, object method, object class_)
   return arrayBody(t, classVirtualTable(t, class_), methodOffset(t, method));
 }
 
+// a hash which, unlike objectHash, is the same in every process, so
+// tables keyed on it can be stored in a boot image.  Sampling the end
+// of the name keeps it cheap enough to compute on each lookup.
+inline unsigned
+interfaceHash(Thread* t, object interface)
+{
+  object name = className(t, interface);
+  unsigned length = byteArrayLength(t, name);
+  unsigned hash = length;
+  for (unsigned i = length > 8 ? length - 8 : 0; i < length; ++i) {
+    hash = (hash * 31) + byteArrayBody(t, name, i);
+  }
+  return hash;
+}
+
 inline object
 findInterfaceMethod(Thread* t, object method, object class_)
 {
   assert(t, (classVmFlags(t, class_) & BootstrapFlag) == 0);
 
   object interface = methodClass(t, method);
+
+  object addendum = classAddendum(t, class_);
+  if (addendum and classAddendumInterfaceHashTable(t, addendum)) {
+    object table = classAddendumInterfaceHashTable(t, addendum);
+    unsigned mask = (arrayLength(t, table) / 2) - 1;
+    for (unsigned i = interfaceHash(t, interface) & mask;
+         arrayBody(t, table, i * 2);
+         i = (i + 1) & mask)
+    {
+      if (arrayBody(t, table, i * 2) == interface) {
+        return arrayBody
+          (t, arrayBody(t, table, (i * 2) + 1), methodOffset(t, method));
+      }
+    }
+    abort(t);
+  }
+
   object itable = classInterfaceTable(t, class_);
   for (unsigned i = 0; i < arrayLength(t, itable); i += 2) {
     if (arrayBody(t, itable, i) == interface) {
@@ -2997,6 +3546,8 @@ monitorAcquire(Thread* t, object monitor, object node = 0)
     PROTECT(t, monitor);
     PROTECT(t, node);
 
+    AVIAN_PROBE2(monitor__contended__enter, t, monitor);
+
     ACQUIRE(t, t->lock);
 
     monitorAtomicAppendAcquire(t, monitor, node);
@@ -3018,6 +3569,8 @@ monitorAcquire(Thread* t, object monitor, object node = 0)
     expect(t, t == monitorAtomicPollAcquire(t, monitor, true));
         
     ++ monitorDepth(t, monitor);
+
+    AVIAN_PROBE2(monitor__contended__entered, t, monitor);
   }
 
   assert(t, monitorOwner(t, monitor) == t);
@@ -3035,6 +3588,10 @@ monitorRelease(Thread* t, object monitor)
     
     Thread* next = monitorAtomicPollAcquire(t, monitor, false);
 
+    if (next) {
+      AVIAN_PROBE3(monitor__contended__exit, t, monitor, next);
+    }
+
     if (next and acquireSystem(t, next)) {
       ACQUIRE(t, next->lock);
        
@@ -3128,6 +3685,9 @@ monitorWait(Thread* t, object monitor, int64_t time)
   object monitorNode = makeMonitorNode(t, t, 0);
   PROTECT(t, monitorNode);
 
+  Timer timer(t->systemThread, t->lock);
+  bool timed = false;
+
   { ACQUIRE(t, t->lock);
 
     monitorAppendWait(t, monitor);
@@ -3139,7 +3699,18 @@ monitorWait(Thread* t, object monitor, int64_t time)
 
     ENTER(t, Thread::IdleState);
 
-    interrupted = t->lock->waitAndClearInterrupted(t->systemThread, time);
+    // the timer can't fire until we wait, since it must acquire our
+    // lock to notify us
+    timed = time > 0
+      and time <= MaximumWheelTimeoutInNanoseconds / (1000 * 1000)
+      and scheduleTimer(t, &timer, time * 1000 * 1000);
+
+    interrupted = t->lock->waitAndClearInterrupted
+      (t->systemThread, timed ? 0 : time);
+  }
+
+  if (timed) {
+    cancelTimer(t, &timer);
   }
 
   monitorAcquire(t, monitor, monitorNode);
@@ -3222,6 +3793,50 @@ class ObjectMonitorResource {
 object
 objectMonitor(Thread* t, object o, bool createNew);
 
+inline object*
+monitorCacheEntry(Thread* t, object o)
+{
+  return t->monitorCache
+    + (((reinterpret_cast<uintptr_t>(o) / BytesPerWord)
+        & (Thread::MonitorCacheSize - 1)) * 2);
+}
+
+// objects don't move between collections, so we can remember which
+// monitor belongs to a recently used object and skip the map lookup
+inline object
+cachedObjectMonitor(Thread* t, object o, bool createNew)
+{
+  object* entry = monitorCacheEntry(t, o);
+  if (entry[0] == o) {
+    return entry[1];
+  }
+
+  PROTECT(t, o);
+
+  object m = objectMonitor(t, o, createNew);
+
+  if (m) {
+    // objectMonitor may have caused a collection, so look up the
+    // entry again
+    entry = monitorCacheEntry(t, o);
+    entry[0] = o;
+    entry[1] = m;
+  }
+
+  return m;
+}
+
+inline void
+clearMonitorCache(Thread* t)
+{
+  memset(t->monitorCache, 0, sizeof(t->monitorCache));
+}
+
+// Acquires m, the contended monitor of o, and records how long that
+// took and, if contention is being profiled, where.
+void
+acquireAndRecord(Thread* t, object o, object m);
+
 inline void
 acquire(Thread* t, object o)
 {
@@ -3230,13 +3845,19 @@ acquire(Thread* t, object o)
     hash = objectHash(t, o);
   }
 
-  object m = objectMonitor(t, o, true);
+  object m = cachedObjectMonitor(t, o, true);
 
   if (DebugMonitors) {
     fprintf(stderr, "thread %p acquires %p for %x\n", t, m, hash);
   }
 
-  monitorAcquire(t, m);
+  if (UNLIKELY(t->events or t->m->contentionLock)) {
+    if (not monitorTryAcquire(t, m)) {
+      acquireAndRecord(t, o, m);
+    }
+  } else {
+    monitorAcquire(t, m);
+  }
 }
 
 inline void
@@ -3247,7 +3868,7 @@ release(Thread* t, object o)
     hash = objectHash(t, o);
   }
 
-  object m = objectMonitor(t, o, false);
+  object m = cachedObjectMonitor(t, o, false);
 
   if (DebugMonitors) {
     fprintf(stderr, "thread %p releases %p for %x\n", t, m, hash);
@@ -3264,7 +3885,7 @@ wait(Thread* t, object o, int64_t milliseconds)
     hash = objectHash(t, o);
   }
 
-  object m = objectMonitor(t, o, false);
+  object m = cachedObjectMonitor(t, o, false);
 
   if (DebugMonitors) {
     fprintf(stderr, "thread %p waits %d millis on %p for %x\n",
@@ -3304,7 +3925,7 @@ notify(Thread* t, object o)
     hash = objectHash(t, o);
   }
 
-  object m = objectMonitor(t, o, false);
+  object m = cachedObjectMonitor(t, o, false);
 
   if (DebugMonitors) {
     fprintf(stderr, "thread %p notifies on %p for %x\n",
@@ -3321,7 +3942,7 @@ notify(Thread* t, object o)
 inline void
 notifyAll(Thread* t, object o)
 {
-  object m = objectMonitor(t, o, false);
+  object m = cachedObjectMonitor(t, o, false);
 
   if (DebugMonitors) {
     fprintf(stderr, "thread %p notifies all on %p for %x\n",
@@ -3623,27 +4244,88 @@ resolveField(Thread* t, object method, unsigned index, bool throw_ = true)
     (t, classLoader(t, methodClass(t, method)), method, index, throw_);
 }
 
+// true if field is a volatile long or double which a 32-bit target
+// can't load or store with one instruction
+inline bool
+volatileWideField(Thread* t, object field)
+{
+  return BytesPerWord == 4
+    and (fieldFlags(t, field) & ACC_VOLATILE)
+    and (fieldCode(t, field) == DoubleField
+         or fieldCode(t, field) == LongField);
+}
+
+#ifdef AVIAN_HAS_CAS64
+inline uint64_t
+atomicLoad64(uint64_t* p)
+{
+  // a torn read won't compare equal, so the value swapped in place
+  // was read whole
+  uint64_t v;
+  do {
+    v = *static_cast<volatile uint64_t*>(p);
+  } while (not atomicCompareAndSwap64(p, v, v));
+  return v;
+}
+
 inline void
-acquireFieldForRead(Thread* t, object field)
+atomicStore64(uint64_t* p, uint64_t v)
 {
-  if (UNLIKELY((fieldFlags(t, field) & ACC_VOLATILE)
-               and BytesPerWord == 4
-               and (fieldCode(t, field) == DoubleField
-                    or fieldCode(t, field) == LongField)))
-  {
+  uint64_t old;
+  do {
+    old = *static_cast<volatile uint64_t*>(p);
+  } while (not atomicCompareAndSwap64(p, old, v));
+}
+#endif
+
+// Loads and stores the value of a long or double field, atomically if
+// it is volatile.  Where there is a 64-bit compare-and-swap, that
+// serves in place of the field's monitor, which otherwise must be
+// held; see acquireFieldForRead and acquireFieldForWrite.
+inline uint64_t
+getWideField(Thread* t, object field, object target)
+{
+  uint64_t* p = &fieldAtOffset<uint64_t>(target, fieldOffset(t, field));
+#ifdef AVIAN_HAS_CAS64
+  if (UNLIKELY(volatileWideField(t, field))) {
+    return atomicLoad64(p);
+  }
+#endif
+  return *p;
+}
+
+inline void
+setWideField(Thread* t, object field, object target, uint64_t value)
+{
+  uint64_t* p = &fieldAtOffset<uint64_t>(target, fieldOffset(t, field));
+#ifdef AVIAN_HAS_CAS64
+  if (UNLIKELY(volatileWideField(t, field))) {
+    atomicStore64(p, value);
+    return;
+  }
+#endif
+  *p = value;
+}
+
+inline void
+acquireFieldForRead(Thread* t UNUSED, object field UNUSED)
+{
+#ifndef AVIAN_HAS_CAS64
+  if (UNLIKELY(volatileWideField(t, field))) {
     acquire(t, field);        
   }
+#endif
 }
 
 inline void
 releaseFieldForRead(Thread* t, object field)
 {
   if (UNLIKELY(fieldFlags(t, field) & ACC_VOLATILE)) {
-    if (BytesPerWord == 4
-        and (fieldCode(t, field) == DoubleField
-             or fieldCode(t, field) == LongField))
-    {
+    if (volatileWideField(t, field)) {
+      // the compare-and-swap in getWideField is a full barrier
+#ifndef AVIAN_HAS_CAS64
       release(t, field);        
+#endif
     } else {
       loadMemoryBarrier();
     }
@@ -3669,11 +4351,10 @@ inline void
 acquireFieldForWrite(Thread* t, object field)
 {
   if (UNLIKELY(fieldFlags(t, field) & ACC_VOLATILE)) {
-    if (BytesPerWord == 4
-        and (fieldCode(t, field) == DoubleField
-             or fieldCode(t, field) == LongField))
-    {
+    if (volatileWideField(t, field)) {
+#ifndef AVIAN_HAS_CAS64
       acquire(t, field);        
+#endif
     } else {
       storeStoreMemoryBarrier();
     }
@@ -3684,11 +4365,10 @@ inline void
 releaseFieldForWrite(Thread* t, object field)
 {
   if (UNLIKELY(fieldFlags(t, field) & ACC_VOLATILE)) {
-    if (BytesPerWord == 4
-        and (fieldCode(t, field) == DoubleField
-             or fieldCode(t, field) == LongField))
-    {
+    if (volatileWideField(t, field)) {
+#ifndef AVIAN_HAS_CAS64
       release(t, field);        
+#endif
     } else {
       storeLoadMemoryBarrier();
     }
@@ -3775,7 +4455,7 @@ getMethodRuntimeData(Thread* t, object method)
     ACQUIRE(t, t->m->classLock);
 
     if (methodRuntimeDataIndex(t, method) == 0) {
-      object runtimeData = makeMethodRuntimeData(t, 0);
+      object runtimeData = makeMethodRuntimeData(t, 0, 0, 0);
 
       setRoot(t, Machine::MethodRuntimeDataTable, vectorAppend
               (t, root(t, Machine::MethodRuntimeDataTable), runtimeData));
@@ -3840,11 +4520,21 @@ registerNative(Thread* t, object method, void* function)
 
   expect(t, methodFlags(t, method) & ACC_NATIVE);
 
-  object native = makeNative(t, function, false);
-  PROTECT(t, native);
-
   object runtimeData = getMethodRuntimeData(t, method);
 
+  object existing = methodRuntimeDataNative(t, runtimeData);
+  if (existing
+      and objectClass(t, existing) == type(t, Machine::NativeInterceptType))
+  {
+    // the VM has its own implementation (see Classpath::interceptMethods)
+    return;
+  }
+
+  PROTECT(t, runtimeData);
+
+  object native = makeNative(t, function, false, false);
+  PROTECT(t, native);
+
   // ensure other threads only see the methodRuntimeDataNative field
   // populated once the object it points to has been populated:
   storeStoreMemoryBarrier();
@@ -3872,9 +4562,30 @@ populateMultiArray(Thread* t, object array, int32_t* counts,
 object
 getCaller(Thread* t, unsigned target, bool skipMethodInvoke = false);
 
+void
+arrayCopy(Thread* t, object src, int32_t srcOffset, object dst,
+          int32_t dstOffset, int32_t length);
+
 object
 defineClass(Thread* t, object loader, const uint8_t* buffer, unsigned length);
 
+void
+loadReflectionData(Thread* t, object class_);
+
+// called before reading the signature, annotations, exception table,
+// inner class table or enclosing method of the specified class or one
+// of its members
+inline void
+ensureReflectionData(Thread* t, object class_)
+{
+  if (UNLIKELY(classVmFlags(t, class_) & LazyReflectionFlag)) {
+    loadReflectionData(t, class_);
+  }
+
+  // see the barrier in loadReflectionData
+  loadMemoryBarrier();
+}
+
 inline object
 methodClone(Thread* t, object method)
 {
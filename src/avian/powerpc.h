@@ -68,6 +68,13 @@ trap()
   asm("trap");
 }
 
+inline void
+spinLoopHint()
+{
+  // lowers the priority of this hardware thread
+  __asm__ __volatile__("or 27,27,27": : :"memory");
+}
+
 inline void
 memoryBarrier()
 {
@@ -115,6 +122,20 @@ syncInstructionCache(const void* start, unsigned size)
   __asm__ __volatile__("isync");
 }
 
+// copies or fills memory which won't be read again soon, bypassing the
+// cache where the processor allows (it doesn't here)
+inline void
+streamingCopy(void* dst, const void* src, uintptr_t size)
+{
+  memcpy(dst, src, size);
+}
+
+inline void
+streamingFill(void* dst, uint8_t value, uintptr_t size)
+{
+  memset(dst, value, size);
+}
+
 #ifdef USE_ATOMIC_OPERATIONS
 inline bool
 atomicCompareAndSwap32(uint32_t* p, uint32_t old, uint32_t new_)
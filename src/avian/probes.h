@@ -0,0 +1,59 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#ifndef AVIAN_PROBES_H
+#define AVIAN_PROBES_H
+
+// Statically defined tracing probes in the "avian" provider, built in
+// when the VM is made with usdt=true.  Each compiles to a nop plus a
+// note describing where its arguments are, so it costs nothing until
+// a tracer such as bpftrace or systemtap attaches to it, e.g.:
+//
+//   bpftrace -e 'usdt:/path/to/avian:avian:gc__begin { @[arg0] = count(); }'
+//
+// The arguments are evaluated whether or not anything is attached, so
+// they should be ones the probed code already has at hand.  Strings
+// are the VM's own null-terminated names, valid only while the probe
+// fires.  The probes are:
+//
+//   method__compile__begin(class, name, spec)
+//   method__compile__end(class, name, spec, code size)
+//   gc__begin(type)                  0 for minor, 1 for major
+//   gc__end(type, bytes in use after)
+//   monitor__contended__enter(thread, monitor)
+//   monitor__contended__entered(thread, monitor)
+//   monitor__contended__exit(thread, monitor, next owner)
+//   thread__start(thread)
+//   thread__stop(thread)
+//   class__load(name, class file size)
+//   object__alloc(thread, size, bytes sampled)
+//                                    fires only for allocations sampled
+//                                    by avian.alloc.profile
+
+#ifdef AVIAN_USDT
+
+#  include <sys/sdt.h>
+
+#  define AVIAN_PROBE1(name, a) DTRACE_PROBE1(avian, name, a)
+#  define AVIAN_PROBE2(name, a, b) DTRACE_PROBE2(avian, name, a, b)
+#  define AVIAN_PROBE3(name, a, b, c) DTRACE_PROBE3(avian, name, a, b, c)
+#  define AVIAN_PROBE4(name, a, b, c, d) \
+  DTRACE_PROBE4(avian, name, a, b, c, d)
+
+#else // not AVIAN_USDT
+
+#  define AVIAN_PROBE1(name, a)
+#  define AVIAN_PROBE2(name, a, b)
+#  define AVIAN_PROBE3(name, a, b, c)
+#  define AVIAN_PROBE4(name, a, b, c, d)
+
+#endif // not AVIAN_USDT
+
+#endif//AVIAN_PROBES_H
@@ -59,6 +59,10 @@ isSpecialMethod(Thread* t, object method, object class_)
 void
 resolveNative(Thread* t, object method);
 
+uint64_t
+invokeCriticalNative(Thread* t, object method, void* function,
+                     uintptr_t* arguments);
+
 int
 findLineNumber(Thread* t, object method, unsigned ip);
 
@@ -26,6 +26,9 @@ class DelayedPromise;
 
 namespace vm {
 
+// enough room for any report written by Processor::compilationReport
+const unsigned CompilationReportCapacity = 4096;
+
 class Processor {
  public:
   class StackWalker;
@@ -94,11 +97,19 @@ class Processor {
   initVtable(Thread* t, object c) = 0;
 
   virtual void
-  visitObjects(Thread* t, Heap::Visitor* v) = 0;
+  methodOverridden(Thread* t, object method) = 0;
+
+  // worker is as passed to Heap::RootGroups::visit, or zero when not
+  // visiting roots for a collection
+  virtual void
+  visitObjects(Thread* t, Heap::Visitor* v, unsigned worker) = 0;
 
   virtual void
   walkStack(Thread* t, StackVisitor* v) = 0;
 
+  virtual void
+  requestSafepoint(Thread* t, Thread* target) = 0;
+
   virtual int
   lineNumber(Thread* t, object method, int ip) = 0;
 
@@ -121,6 +132,13 @@ class Processor {
   invokeArray(Thread* t, object method, object this_, const jvalue* arguments)
   = 0;
 
+  // like invokeArray, but returns a primitive result as is rather than
+  // boxed, and an object result as a raw pointer which the caller must
+  // use before anything else may allocate
+  virtual uint64_t
+  invokeUnboxed(Thread* t, object method, object this_,
+                const jvalue* arguments) = 0;
+
   virtual object
   invokeList(Thread* t, object method, object this_, bool indirectObjects,
              va_list arguments) = 0;
@@ -139,6 +157,27 @@ class Processor {
   virtual object
   getStackTrace(Thread* t, Thread* target) = 0;
 
+  // Walks the stack of target from wherever it is interrupted, which
+  // may be in a thunk or native code, without waiting for a safepoint.
+  // The visitor may run in a signal handler on target's thread, so it
+  // must neither allocate nor block.  The caller holds
+  // Machine::stateLock, so target can't exit meanwhile.  Returns false
+  // if this processor can't sample running threads.
+  virtual bool
+  sampleStack(Thread* t, Thread* target, StackVisitor* v) = 0;
+
+  // Writes a summary of what the JIT compiler has done so far,
+  // truncated to fit in capacity bytes, to buffer.  The caller holds
+  // Machine::classLock.  Returns the length of the summary, which is
+  // zero if this processor doesn't compile.
+  virtual unsigned
+  compilationReport(Thread* t, char* buffer, unsigned capacity) = 0;
+
+  // Returns the number of bytes of executable memory holding compiled
+  // code, which is zero if this processor doesn't compile.
+  virtual unsigned
+  codeFootprint() = 0;
+
   virtual void
   initialize(BootImage* image, uint8_t* code, unsigned capacity) = 0;
 
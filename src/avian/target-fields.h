@@ -16,42 +16,44 @@
 #  if (TARGET_BYTES_PER_WORD == 8)
 
 #define TARGET_THREAD_EXCEPTION 80
-#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2256
-#define TARGET_THREAD_EXCEPTIONOFFSET 2264
-#define TARGET_THREAD_EXCEPTIONHANDLER 2272
+#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2408
+#define TARGET_THREAD_EXCEPTIONOFFSET 2416
+#define TARGET_THREAD_EXCEPTIONHANDLER 2424
 
-#define TARGET_THREAD_IP 2216
-#define TARGET_THREAD_STACK 2224
-#define TARGET_THREAD_NEWSTACK 2232
-#define TARGET_THREAD_SCRATCH 2240
-#define TARGET_THREAD_CONTINUATION 2248
-#define TARGET_THREAD_TAILADDRESS 2280
-#define TARGET_THREAD_VIRTUALCALLTARGET 2288
-#define TARGET_THREAD_VIRTUALCALLINDEX 2296
-#define TARGET_THREAD_HEAPIMAGE 2304
-#define TARGET_THREAD_CODEIMAGE 2312
-#define TARGET_THREAD_THUNKTABLE 2320
-#define TARGET_THREAD_STACKLIMIT 2368
+#define TARGET_THREAD_IP 2368
+#define TARGET_THREAD_STACK 2376
+#define TARGET_THREAD_NEWSTACK 2384
+#define TARGET_THREAD_SCRATCH 2392
+#define TARGET_THREAD_CONTINUATION 2400
+#define TARGET_THREAD_TAILADDRESS 2432
+#define TARGET_THREAD_VIRTUALCALLTARGET 2440
+#define TARGET_THREAD_VIRTUALCALLINDEX 2448
+#define TARGET_THREAD_HEAPIMAGE 2456
+#define TARGET_THREAD_CODEIMAGE 2464
+#define TARGET_THREAD_THUNKTABLE 2472
+#define TARGET_THREAD_STACKLIMIT 2520
+#define TARGET_THREAD_SAFEPOINT 2528
 
 #  elif (TARGET_BYTES_PER_WORD == 4)
 
 #define TARGET_THREAD_EXCEPTION 44
-#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2164
-#define TARGET_THREAD_EXCEPTIONOFFSET 2168
-#define TARGET_THREAD_EXCEPTIONHANDLER 2172
+#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2244
+#define TARGET_THREAD_EXCEPTIONOFFSET 2248
+#define TARGET_THREAD_EXCEPTIONHANDLER 2252
 
-#define TARGET_THREAD_IP 2144
-#define TARGET_THREAD_STACK 2148
-#define TARGET_THREAD_NEWSTACK 2152
-#define TARGET_THREAD_SCRATCH 2156
-#define TARGET_THREAD_CONTINUATION 2160
-#define TARGET_THREAD_TAILADDRESS 2176
-#define TARGET_THREAD_VIRTUALCALLTARGET 2180
-#define TARGET_THREAD_VIRTUALCALLINDEX 2184
-#define TARGET_THREAD_HEAPIMAGE 2188
-#define TARGET_THREAD_CODEIMAGE 2192
-#define TARGET_THREAD_THUNKTABLE 2196
-#define TARGET_THREAD_STACKLIMIT 2220
+#define TARGET_THREAD_IP 2224
+#define TARGET_THREAD_STACK 2228
+#define TARGET_THREAD_NEWSTACK 2232
+#define TARGET_THREAD_SCRATCH 2236
+#define TARGET_THREAD_CONTINUATION 2240
+#define TARGET_THREAD_TAILADDRESS 2256
+#define TARGET_THREAD_VIRTUALCALLTARGET 2260
+#define TARGET_THREAD_VIRTUALCALLINDEX 2264
+#define TARGET_THREAD_HEAPIMAGE 2268
+#define TARGET_THREAD_CODEIMAGE 2272
+#define TARGET_THREAD_THUNKTABLE 2276
+#define TARGET_THREAD_STACKLIMIT 2300
+#define TARGET_THREAD_SAFEPOINT 2304
 
 #  else
 #    error
@@ -116,7 +116,7 @@ typedef int64_t target_intptr_t;
 
 const unsigned TargetClassFixedSize = 12;
 const unsigned TargetClassArrayElementSize = 14;
-const unsigned TargetClassVtable = 128;
+const unsigned TargetClassVtable = 152;
 
 const unsigned TargetFieldOffset = 12;
 
@@ -134,7 +134,7 @@ typedef int32_t target_intptr_t;
 
 const unsigned TargetClassFixedSize = 8;
 const unsigned TargetClassArrayElementSize = 10;
-const unsigned TargetClassVtable = 68;
+const unsigned TargetClassVtable = 80;
 
 const unsigned TargetFieldOffset = 8;
 
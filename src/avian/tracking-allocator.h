@@ -0,0 +1,96 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#ifndef AVIAN_TRACKING_ALLOCATOR_H
+#define AVIAN_TRACKING_ALLOCATOR_H
+
+#include "avian/allocator.h"
+#include "avian/arch.h"
+
+namespace vm {
+
+// The parts of the VM whose native memory is tracked when
+// avian.memory.tracking is true.  Each has an allocator of its own
+// (see categoryAllocator in machine.h) which counts what passes
+// through it.
+enum MemoryCategory {
+  // zones used by the JIT compiler
+  CompilerMemory,
+
+  // class path indexes, caches and buffers kept by finders
+  ClassPathMemory,
+
+  // JNI local and global references
+  ReferenceMemory,
+
+  MemoryCategoryCount
+};
+
+// Passes allocations through to another allocator, keeping count of the
+// bytes outstanding and the most there have been.  The peak is updated
+// without synchronization, so it is only approximate.
+class TrackingAllocator: public Allocator {
+ public:
+  TrackingAllocator(): base(0), footprint(0), peak(0) { }
+
+  virtual void* tryAllocate(unsigned size) {
+    void* p = base->tryAllocate(size);
+    if (p) {
+      add(size);
+    }
+    return p;
+  }
+
+  virtual void* allocate(unsigned size) {
+    void* p = base->allocate(size);
+    add(size);
+    return p;
+  }
+
+  virtual void free(const void* p, unsigned size) {
+    base->free(p, size);
+    add(- static_cast<intptr_t>(size));
+  }
+
+  void add(intptr_t size) {
+#ifdef USE_ATOMIC_OPERATIONS
+    uintptr_t old;
+    do {
+      old = footprint;
+    } while (not atomicCompareAndSwap(&footprint, old, old + size));
+#else
+    uintptr_t old = footprint;
+    footprint = old + size;
+#endif
+
+    if (old + size > peak) {
+      peak = old + size;
+    }
+  }
+
+  Allocator* base;
+  uintptr_t footprint;
+  uintptr_t peak;
+};
+
+class MemoryTracker {
+ public:
+  MemoryTracker(Allocator* base) {
+    for (unsigned i = 0; i < MemoryCategoryCount; ++i) {
+      allocators[i].base = base;
+    }
+  }
+
+  TrackingAllocator allocators[MemoryCategoryCount];
+};
+
+} // namespace vm
+
+#endif//AVIAN_TRACKING_ALLOCATOR_H
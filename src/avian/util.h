@@ -75,6 +75,28 @@ hashMapRemove(Thread* t, object map, object key,
 object
 hashMapIterator(Thread* t, object map);
 
+// probeMap is an open-addressed table with linear probing over flat
+// key and value arrays.  It allocates no per-entry nodes, but supports
+// neither removal nor weak keys.
+
+int
+probeMapFindIndex(Thread* t, object map, object key,
+                  uint32_t (*hash)(Thread*, object),
+                  bool (*equal)(Thread*, object, object));
+
+inline object
+probeMapFind(Thread* t, object map, object key,
+             uint32_t (*hash)(Thread*, object),
+             bool (*equal)(Thread*, object, object))
+{
+  int index = probeMapFindIndex(t, map, key, hash, equal);
+  return (index >= 0 ? arrayBody(t, probeMapValues(t, map), index) : 0);
+}
+
+void
+probeMapInsert(Thread* t, object map, object key, object value,
+               uint32_t (*hash)(Thread*, object));
+
 object
 hashMapIteratorNext(Thread* t, object it);
 
@@ -22,6 +22,11 @@
 #  undef interface
 #endif
 
+#if (defined ARCH_x86_64) || (defined __SSE2__)
+#  include <emmintrin.h>
+#  define AVIAN_HAS_STREAMING_STORES
+#endif
+
 #if (defined ARCH_x86_32) || (defined PLATFORM_WINDOWS)
 #  define VA_LIST(x) (&(x))
 #else
@@ -148,11 +153,93 @@ vmNativeCall(void* function, void* stack, unsigned stackSize,
 
 namespace vm {
 
+typedef uint64_t (*DirectFunction0)();
+typedef uint64_t (*DirectFunction1)(uint64_t);
+typedef uint64_t (*DirectFunction2)(uint64_t, uint64_t);
+typedef uint64_t (*DirectFunction3)(uint64_t, uint64_t, uint64_t);
+typedef uint64_t (*DirectFunction4)(uint64_t, uint64_t, uint64_t, uint64_t);
+typedef uint64_t (*DirectFunction5)
+  (uint64_t, uint64_t, uint64_t, uint64_t, uint64_t);
+typedef uint64_t (*DirectFunction6)
+  (uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t);
+
+// Calls function with a plain C call when every argument and the result
+// is an integer or pointer, in which case each argument occupies one
+// general purpose register, just as it would for a function declared
+// with uint64_t parameters.  This saves marshalling the arguments into
+// tables for vmNativeCall, which matters for the many small JNI methods
+// with such signatures.  Returns false if the call must be made the
+// general way.
+inline bool
+directCall(void* function, uint64_t* arguments, uint8_t* argumentTypes,
+           unsigned argumentCount, unsigned returnType, uint64_t* result)
+{
+  if (argumentCount > 6
+      or returnType == FLOAT_TYPE
+      or returnType == DOUBLE_TYPE)
+  {
+    return false;
+  }
+
+  for (unsigned i = 0; i < argumentCount; ++i) {
+    if (argumentTypes[i] == FLOAT_TYPE or argumentTypes[i] == DOUBLE_TYPE) {
+      return false;
+    }
+  }
+
+  uint64_t* a = arguments;
+  switch (argumentCount) {
+  case 0: {
+    DirectFunction0 f; memcpy(&f, &function, sizeof(void*));
+    *result = f();
+  } break;
+
+  case 1: {
+    DirectFunction1 f; memcpy(&f, &function, sizeof(void*));
+    *result = f(a[0]);
+  } break;
+
+  case 2: {
+    DirectFunction2 f; memcpy(&f, &function, sizeof(void*));
+    *result = f(a[0], a[1]);
+  } break;
+
+  case 3: {
+    DirectFunction3 f; memcpy(&f, &function, sizeof(void*));
+    *result = f(a[0], a[1], a[2]);
+  } break;
+
+  case 4: {
+    DirectFunction4 f; memcpy(&f, &function, sizeof(void*));
+    *result = f(a[0], a[1], a[2], a[3]);
+  } break;
+
+  case 5: {
+    DirectFunction5 f; memcpy(&f, &function, sizeof(void*));
+    *result = f(a[0], a[1], a[2], a[3], a[4]);
+  } break;
+
+  case 6: {
+    DirectFunction6 f; memcpy(&f, &function, sizeof(void*));
+    *result = f(a[0], a[1], a[2], a[3], a[4], a[5]);
+  } break;
+  }
+
+  return true;
+}
+
 #  ifdef PLATFORM_WINDOWS
 inline uint64_t
-dynamicCall(void* function, uint64_t* arguments, UNUSED uint8_t* argumentTypes,
+dynamicCall(void* function, uint64_t* arguments, uint8_t* argumentTypes,
             unsigned argumentCount, unsigned, unsigned returnType)
 {
+  uint64_t result;
+  if (directCall(function, arguments, argumentTypes, argumentCount,
+                 returnType, &result))
+  {
+    return result;
+  }
+
   return vmNativeCall(function, arguments, argumentCount, returnType);
 }
 #  else
@@ -160,6 +247,13 @@ inline uint64_t
 dynamicCall(void* function, uintptr_t* arguments, uint8_t* argumentTypes,
             unsigned argumentCount, unsigned, unsigned returnType)
 {
+  uint64_t result;
+  if (directCall(function, reinterpret_cast<uint64_t*>(arguments),
+                 argumentTypes, argumentCount, returnType, &result))
+  {
+    return result;
+  }
+
   const unsigned GprCount = 6;
   uint64_t gprTable[GprCount];
   unsigned gprIndex = 0;
@@ -216,6 +310,18 @@ trap()
 #endif
 }
 
+// tells the processor we're in a spin-wait loop, which saves power and
+// avoids a pipeline flush on exit from the loop
+inline void
+spinLoopHint()
+{
+#ifdef _MSC_VER
+  YieldProcessor();
+#else
+  __asm__ __volatile__("pause": : :"memory");
+#endif
+}
+
 inline void
 programOrderMemoryBarrier()
 {
@@ -252,6 +358,74 @@ syncInstructionCache(const void*, unsigned)
   programOrderMemoryBarrier();
 }
 
+// copies or fills memory which won't be read again soon, using
+// non-temporal stores where available so that the destination doesn't
+// push everything else out of the cache.  The regions must not overlap.
+inline void
+streamingCopy(void* dst, const void* src, uintptr_t size)
+{
+#ifdef AVIAN_HAS_STREAMING_STORES
+  uint8_t* d = static_cast<uint8_t*>(dst);
+  const uint8_t* s = static_cast<const uint8_t*>(src);
+
+  uintptr_t head = (16 - (reinterpret_cast<uintptr_t>(d) & 15)) & 15;
+  if (head > size) {
+    head = size;
+  }
+  memcpy(d, s, head);
+  d += head;
+  s += head;
+  size -= head;
+
+  for (; size >= 64; size -= 64, d += 64, s += 64) {
+    const __m128i* from = reinterpret_cast<const __m128i*>(s);
+    __m128i* to = reinterpret_cast<__m128i*>(d);
+    __m128i a = _mm_loadu_si128(from);
+    __m128i b = _mm_loadu_si128(from + 1);
+    __m128i c = _mm_loadu_si128(from + 2);
+    __m128i e = _mm_loadu_si128(from + 3);
+    _mm_stream_si128(to, a);
+    _mm_stream_si128(to + 1, b);
+    _mm_stream_si128(to + 2, c);
+    _mm_stream_si128(to + 3, e);
+  }
+
+  // streaming stores aren't ordered with respect to other stores
+  _mm_sfence();
+
+  memcpy(d, s, size);
+#else
+  memcpy(dst, src, size);
+#endif
+}
+
+inline void
+streamingFill(void* dst, uint8_t value, uintptr_t size)
+{
+#ifdef AVIAN_HAS_STREAMING_STORES
+  uint8_t* d = static_cast<uint8_t*>(dst);
+
+  uintptr_t head = (16 - (reinterpret_cast<uintptr_t>(d) & 15)) & 15;
+  if (head > size) {
+    head = size;
+  }
+  memset(d, value, head);
+  d += head;
+  size -= head;
+
+  __m128i v = _mm_set1_epi8(static_cast<char>(value));
+  for (; size >= 16; size -= 16, d += 16) {
+    _mm_stream_si128(reinterpret_cast<__m128i*>(d), v);
+  }
+
+  _mm_sfence();
+
+  memset(d, value, size);
+#else
+  memset(dst, value, size);
+#endif
+}
+
 #ifdef USE_ATOMIC_OPERATIONS
 inline bool
 atomicCompareAndSwap32(uint32_t* p, uint32_t old, uint32_t new_)
@@ -32,9 +32,57 @@ class Zone: public Allocator {
     uint8_t data[0];
   };
 
-  Zone(System* s, Allocator* allocator, unsigned minimumFootprint):
+  // segments released by zones which share a pool are kept, up to a
+  // limit, for reuse by the next zone rather than returned to the
+  // allocator.  A pool must only be used by one thread at a time.
+  class Pool {
+   public:
+    Pool(unsigned limit): segments(0), footprint(0), limit(limit) { }
+
+    Segment* take(unsigned space) {
+      for (Segment** p = &segments; *p; p = &((*p)->next)) {
+        Segment* seg = *p;
+        if (seg->size >= space) {
+          *p = seg->next;
+          footprint -= sizeof(Segment) + seg->size;
+          return seg;
+        }
+      }
+      return 0;
+    }
+
+    bool give(Segment* seg) {
+      unsigned size = sizeof(Segment) + seg->size;
+      if (footprint + size <= limit) {
+        seg->next = segments;
+        segments = seg;
+        footprint += size;
+        return true;
+      } else {
+        return false;
+      }
+    }
+
+    void dispose(Allocator* allocator) {
+      for (Segment* seg = segments, *next; seg; seg = next) {
+        next = seg->next;
+        allocator->free(seg, sizeof(Segment) + seg->size);
+      }
+
+      segments = 0;
+      footprint = 0;
+    }
+
+    Segment* segments;
+    unsigned footprint;
+    unsigned limit;
+  };
+
+  Zone(System* s, Allocator* allocator, unsigned minimumFootprint,
+       Pool* pool = 0):
     s(s),
     allocator(allocator),
+    pool(pool),
     segment(0),
     minimumFootprint(minimumFootprint < sizeof(Segment) ? 0 :
                      minimumFootprint - sizeof(Segment))
@@ -44,15 +92,30 @@ class Zone: public Allocator {
     dispose();
   }
 
+  void release(Segment* seg) {
+    if (pool == 0 or not pool->give(seg)) {
+      allocator->free(seg, sizeof(Segment) + seg->size);
+    }
+  }
+
   void dispose() {
     for (Segment* seg = segment, *next; seg; seg = next) {
       next = seg->next;
-      allocator->free(seg, sizeof(Segment) + seg->size);
+      release(seg);
     }
 
     segment = 0;
   }
 
+  Segment* reuse(unsigned space) {
+    Segment* seg = pool ? pool->take(space) : 0;
+    if (seg) {
+      seg->next = segment;
+      seg->position = 0;
+    }
+    return seg;
+  }
+
   static unsigned padToPage(unsigned size) {
     return (size + (LikelyPageSizeInBytes - 1))
       & ~(LikelyPageSizeInBytes - 1);
@@ -66,8 +129,19 @@ class Zone: public Allocator {
           (minimumFootprint, segment == 0 ? 0 : segment->size * 2))
          + sizeof(Segment));
 
+      Segment* seg = reuse(size - sizeof(Segment));
+      if (seg) {
+        segment = seg;
+        return true;
+      }
+
       void* p = allocator->tryAllocate(size);
       if (p == 0) {
+        // memory is short, so stop holding on to spare segments
+        if (pool) {
+          pool->dispose(allocator);
+        }
+
         size = padToPage(space + sizeof(Segment));
         p = allocator->tryAllocate(size);
         if (p == 0) {
@@ -129,13 +203,23 @@ class Zone: public Allocator {
     while (s->position < size) {
       size -= s->position;
       Segment* next = s->next;
-      allocator->free(s, sizeof(Segment) + s->size);
+      release(s);
       s = next;
     }
     s->position -= size;
     segment = s;
   }
 
+  // the bytes held by this zone's segments, including those for
+  // allocations which have since been popped
+  unsigned footprint() {
+    unsigned total = 0;
+    for (Segment* seg = segment; seg; seg = seg->next) {
+      total += sizeof(Segment) + seg->size;
+    }
+    return total;
+  }
+
   virtual void free(const void*, unsigned) {
     // not supported
     abort(s);
@@ -143,6 +227,7 @@ class Zone: public Allocator {
   
   System* s;
   Allocator* allocator;
+  Pool* pool;
   void* context;
   Segment* segment;
   unsigned minimumFootprint;
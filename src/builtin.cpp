@@ -19,6 +19,13 @@ using namespace vm;
 
 namespace {
 
+// Unsafe copies and fills involving the heap are done this many bytes
+// at a time, letting a collection proceed between chunks
+const int64_t UnsafeChunkSize = 256 * 1024;
+
+// and those of at least this many bytes bypass the cache
+const int64_t StreamingThreshold = 4 * 1024 * 1024;
+
 int64_t
 search(Thread* t, object loader, object name,
        object (*op)(Thread*, object, object), bool replaceDots)
@@ -48,6 +55,34 @@ resolveSystemClassThrow(Thread* t, object loader, object spec)
     (t, loader, spec, true, Machine::ClassNotFoundExceptionType);
 }
 
+uint8_t*
+unsafeAddress(object base, int64_t offset)
+{
+  return base
+    ? &fieldAtOffset<uint8_t>(base, offset)
+    : reinterpret_cast<uint8_t*>(offset);
+}
+
+void
+copyBytes(uint8_t* dst, const uint8_t* src, int64_t count, bool stream)
+{
+  if (stream and (dst + count <= src or src + count <= dst)) {
+    streamingCopy(dst, src, count);
+  } else {
+    memmove(dst, src, count);
+  }
+}
+
+void
+fillBytes(uint8_t* dst, int8_t value, int64_t count, bool stream)
+{
+  if (stream) {
+    streamingFill(dst, value, count);
+  } else {
+    memset(dst, value, count);
+  }
+}
+
 } // namespace
 
 extern "C" JNIEXPORT void JNICALL
@@ -59,6 +94,13 @@ Avian_avian_Classes_initialize
   initClass(t, this_);
 }
 
+extern "C" JNIEXPORT void JNICALL
+Avian_avian_Classes_loadReflectionData
+(Thread* t, object, uintptr_t* arguments)
+{
+  ensureReflectionData(t, reinterpret_cast<object>(arguments[0]));
+}
+
 extern "C" JNIEXPORT void JNICALL
 Avian_avian_Classes_acquireClassLock
 (Thread* t, object, uintptr_t*)
@@ -173,7 +215,7 @@ Avian_avian_Machine_dumpHeap
   stringChars(t, outputFile, RUNTIME_ARRAY_BODY(n));
   FILE* out = vm::fopen(RUNTIME_ARRAY_BODY(n), "wb");
   if (out) {
-    { ENTER(t, Thread::ExclusiveState);
+    { ENTER_EXCLUSIVE(t, "heap dump");
       dumpHeap(t, out);
     }
     fclose(out);
@@ -183,8 +225,238 @@ Avian_avian_Machine_dumpHeap
   }
 }
 
+extern "C" JNIEXPORT void JNICALL
+Avian_avian_Machine_dumpHprof
+(Thread* t, object, uintptr_t* arguments)
+{
+  object outputFile = reinterpret_cast<object>(arguments[0]);
+  bool compress = arguments[1];
+
+  unsigned length = stringLength(t, outputFile);
+  THREAD_RUNTIME_ARRAY(t, char, n, length + 1);
+  stringChars(t, outputFile, RUNTIME_ARRAY_BODY(n));
+
+  bool success;
+  { ENTER_EXCLUSIVE(t, "heap dump");
+    success = dumpHprof(t, RUNTIME_ARRAY_BODY(n), compress);
+  }
+
+  if (not success) {
+    throwNew(t, Machine::RuntimeExceptionType, "file not found: %s",
+             RUNTIME_ARRAY_BODY(n));
+  }
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_classHistogram
+(Thread* t, object, uintptr_t* arguments)
+{
+  int limit = arguments[0];
+  bool retained = arguments[1];
+
+  if (limit < 0) {
+    throwNew(t, Machine::IllegalArgumentExceptionType, "%d", limit);
+  }
+
+  unsigned size;
+  char* histogram;
+  { ENTER_EXCLUSIVE(t, "class histogram");
+    histogram = classHistogram(t, limit, retained, &size);
+  }
+
+  THREAD_RESOURCE2(t, char*, histogram, unsigned, size,
+                   t->m->heap->free(histogram, size));
+
+  return reinterpret_cast<int64_t>(makeString(t, "%s", histogram));
+}
+
 #endif//AVIAN_HEAPDUMP
 
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_collectionPauseHistogram
+(Thread* t, object, uintptr_t*)
+{
+  object array = makeLongArray(t, CollectionPauseBucketCount);
+
+  // collections only happen in the exclusive state, so the histogram
+  // can't change underneath us
+  memcpy(&longArrayBody(t, array, 0), t->m->collectionPauseHistogram,
+         CollectionPauseBucketCount * sizeof(uint64_t));
+
+  return reinterpret_cast<int64_t>(array);
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_finalizerBacklog
+(Thread* t, object, uintptr_t*)
+{
+  return t->m->finalizeBacklog;
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_fastThrowCount
+(Thread* t, object, uintptr_t*)
+{
+  return t->m->fastThrowCount;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_avian_Machine_startProfiler
+(Thread* t, object, uintptr_t* arguments)
+{
+  object spec = reinterpret_cast<object>(arguments[0]);
+
+  unsigned length = stringLength(t, spec);
+  THREAD_RUNTIME_ARRAY(t, char, n, length + 1);
+  stringChars(t, spec, RUNTIME_ARRAY_BODY(n));
+
+  if (not startCpuProfiler(t, RUNTIME_ARRAY_BODY(n))) {
+    throwNew(t, Machine::RuntimeExceptionType,
+             "malformed spec or already profiling: %s",
+             RUNTIME_ARRAY_BODY(n));
+  }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_avian_Machine_stopProfiler
+(Thread* t, object, uintptr_t*)
+{
+  if (not stopCpuProfiler(t)) {
+    throwNew(t, Machine::RuntimeExceptionType,
+             "not profiling, or profile can't be written");
+  }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_avian_Machine_dumpEvents
+(Thread* t, object, uintptr_t* arguments)
+{
+  object path = reinterpret_cast<object>(arguments[0]);
+
+  bool success;
+  if (path) {
+    unsigned length = stringLength(t, path);
+    THREAD_RUNTIME_ARRAY(t, char, n, length + 1);
+    stringChars(t, path, RUNTIME_ARRAY_BODY(n));
+
+    success = dumpEvents(t, RUNTIME_ARRAY_BODY(n));
+  } else {
+    success = dumpEvents(t, 0);
+  }
+
+  if (not success) {
+    throwNew(t, Machine::RuntimeExceptionType,
+             "not recording events, or they can't be written");
+  }
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_contentionReport
+(Thread* t, object, uintptr_t* arguments)
+{
+  int limit = arguments[0];
+
+  if (t->m->contentionLock == 0) {
+    throwNew(t, Machine::RuntimeExceptionType,
+             "not profiling contention");
+  } else if (limit < 0) {
+    throwNew(t, Machine::IllegalArgumentExceptionType, "%d", limit);
+  }
+
+  unsigned size;
+  char* report = contentionReport(t, limit, &size);
+
+  THREAD_RESOURCE2(t, char*, report, unsigned, size,
+                   t->m->heap->free(report, size));
+
+  return reinterpret_cast<int64_t>(makeString(t, "%s", report));
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_compilationReport
+(Thread* t, object, uintptr_t*)
+{
+  char buffer[CompilationReportCapacity];
+  unsigned length;
+  { ACQUIRE(t, t->m->classLock);
+
+    length = t->m->processor->compilationReport
+      (t, buffer, CompilationReportCapacity);
+  }
+
+  return length
+    ? reinterpret_cast<int64_t>(makeString(t, "%s", buffer)) : 0;
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_safepointReport
+(Thread* t, object, uintptr_t*)
+{
+  char buffer[SafepointReportCapacity];
+  safepointReport(t, buffer, SafepointReportCapacity);
+
+  return reinterpret_cast<int64_t>(makeString(t, "%s", buffer));
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_memoryReport
+(Thread* t, object, uintptr_t*)
+{
+  char buffer[MemoryReportCapacity];
+  memoryReport(t, buffer, MemoryReportCapacity);
+
+  return reinterpret_cast<int64_t>(makeString(t, "%s", buffer));
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_threadAllocatedBytes
+(Thread* t, object, uintptr_t* arguments)
+{
+  object thread = reinterpret_cast<object>(arguments[0]);
+
+  // as in Unsafe.unpark, the peer can't be disposed while we're active
+  Thread* p = reinterpret_cast<Thread*>(threadPeer(t, thread));
+  return p ? static_cast<int64_t>(threadAllocatedBytes(p)) : -1;
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_threadCpuTime
+(Thread* t, object, uintptr_t* arguments)
+{
+  object thread = reinterpret_cast<object>(arguments[0]);
+
+  Thread* p = reinterpret_cast<Thread*>(threadPeer(t, thread));
+  return p ? p->systemThread->cpuTime() : -1;
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_setThreadAffinity
+(Thread* t, object, uintptr_t* arguments)
+{
+  object thread = reinterpret_cast<object>(arguments[0]);
+  object cpus = reinterpret_cast<object>(arguments[1]);
+
+  unsigned count = cpus ? intArrayLength(t, cpus) : 0;
+  THREAD_RUNTIME_ARRAY(t, unsigned, set, count + 1);
+  for (unsigned i = 0; i < count; ++i) {
+    int32_t cpu = intArrayBody(t, cpus, i);
+    if (cpu < 0) {
+      throwNew(t, Machine::IllegalArgumentExceptionType, "%d", cpu);
+    }
+    RUNTIME_ARRAY_BODY(set)[i] = cpu;
+  }
+
+  Thread* p = reinterpret_cast<Thread*>(threadPeer(t, thread));
+  return p and p->systemThread->setAffinity(RUNTIME_ARRAY_BODY(set), count);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Avian_avian_Machine_watchMemoryPressure
+(Thread* t, object, uintptr_t*)
+{
+  t->m->memoryPressureWatched = true;
+}
+
 extern "C" JNIEXPORT void JNICALL
 Avian_java_lang_Runtime_exit
 (Thread* t, object, uintptr_t* arguments)
@@ -400,14 +672,31 @@ Avian_sun_misc_Unsafe_setMemory
   int64_t count; memcpy(&count, arguments + 4, 8);
   int8_t value = arguments[6];
 
+  bool stream = count >= StreamingThreshold;
+
+  if (base == 0) {
+    // nothing here can move, so a long fill needn't hold up a
+    // collection
+    if (count >= UnsafeChunkSize) {
+      ENTER(t, Thread::IdleState);
+      fillBytes(unsafeAddress(0, offset), value, count, stream);
+    } else {
+      fillBytes(unsafeAddress(0, offset), value, count, stream);
+    }
+    return;
+  }
+
   PROTECT(t, base);
 
-  ACQUIRE(t, t->m->referenceLock);
+  for (int64_t done = 0; done < count;) {
+    int64_t n = min(count - done, UnsafeChunkSize);
+    fillBytes(unsafeAddress(base, offset + done), value, n, stream);
+    done += n;
 
-  if (base) {
-    memset(&fieldAtOffset<int8_t>(base, offset), value, count);
-  } else {
-    memset(reinterpret_cast<int8_t*>(offset), value, count);
+    if (done < count) {
+      // base may move here
+      pollSafepoint(t);
+    }
   }
 }
 
@@ -562,20 +851,40 @@ Avian_sun_misc_Unsafe_copyMemory
   int64_t dstOffset; memcpy(&dstOffset, arguments + 5, 8);
   int64_t count; memcpy(&count, arguments + 7, 8);
 
+  bool stream = count >= StreamingThreshold;
+
+  if (srcBase == 0 and dstBase == 0) {
+    // as in setMemory, there's nothing to move
+    if (count >= UnsafeChunkSize) {
+      ENTER(t, Thread::IdleState);
+      copyBytes(unsafeAddress(0, dstOffset), unsafeAddress(0, srcOffset),
+                count, stream);
+    } else {
+      copyBytes(unsafeAddress(0, dstOffset), unsafeAddress(0, srcOffset),
+                count, stream);
+    }
+    return;
+  }
+
   PROTECT(t, srcBase);
   PROTECT(t, dstBase);
 
-  ACQUIRE(t, t->m->referenceLock);
-
-  void* src = srcBase
-    ? &fieldAtOffset<uint8_t>(srcBase, srcOffset)
-    : reinterpret_cast<uint8_t*>(srcOffset);
+  // copy an overlapping range within one object from the end, so no
+  // chunk overwrites bytes a later one has yet to read
+  bool backward = srcBase == dstBase and dstOffset > srcOffset;
 
-  void* dst = dstBase
-    ? &fieldAtOffset<uint8_t>(dstBase, dstOffset)
-    : reinterpret_cast<uint8_t*>(dstOffset);
+  for (int64_t done = 0; done < count;) {
+    int64_t n = min(count - done, UnsafeChunkSize);
+    int64_t start = backward ? count - done - n : done;
+    copyBytes(unsafeAddress(dstBase, dstOffset + start),
+              unsafeAddress(srcBase, srcOffset + start), n, stream);
+    done += n;
 
-  memcpy(dst, src, count);
+    if (done < count) {
+      // the bases may move here
+      pollSafepoint(t);
+    }
+  }
 }
 
 extern "C" JNIEXPORT int64_t JNICALL
@@ -662,11 +971,14 @@ Avian_sun_misc_Unsafe_unpark
 (Thread* t, object, uintptr_t* arguments)
 {
   object thread = reinterpret_cast<object>(arguments[1]);
-  
-  monitorAcquire(t, interruptLock(t, thread));
-  threadUnparked(t, thread) = true;
-  monitorNotify(t, interruptLock(t, thread));
-  monitorRelease(t, interruptLock(t, thread));
+
+  // the target's system thread can't be disposed while we're in the
+  // active state, since that only happens during an exclusive
+  // collection, so no lock is needed here
+  Thread* p = reinterpret_cast<Thread*>(threadPeer(t, thread));
+  if (p) {
+    p->systemThread->unpark();
+  }
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -675,42 +987,50 @@ Avian_sun_misc_Unsafe_park
 {
   bool absolute = arguments[1];
   int64_t time; memcpy(&time, arguments + 2, 8);
-  
-  int64_t then = t->m->system->now();
 
+  int64_t nanoseconds;
   if (absolute) {
-    time -= then;
+    // absolute times are in milliseconds since the epoch
+    time -= t->m->system->now();
     if (time <= 0) {
       return;
     }
-  } else if (time) {
-    // if not absolute, interpret time as nanoseconds, but make sure
-    // it doesn't become zero when we convert to milliseconds, since
-    // zero is interpreted as infinity below
-    time = (time / (1000 * 1000)) + 1;
-  }
-
-  monitorAcquire(t, interruptLock(t, t->javaThread));
-  bool interrupted = false;
-  while (time >= 0
-         and (not (threadUnparked(t, t->javaThread)
-                   or threadInterrupted(t, t->javaThread)
-                   or (interrupted = monitorWait
-                       (t, interruptLock(t, t->javaThread), time)))))
-  {
-    int64_t now = t->m->system->now();
-    time -= now - then;
-    then = now;
-    
-    if (time == 0) {
-      break;
+    nanoseconds = time * 1000 * 1000;
+  } else if (time < 0) {
+    return;
+  } else {
+    // zero means wait indefinitely
+    nanoseconds = time;
+  }
+
+  if (threadInterrupted(t, t->javaThread)) {
+    return;
+  }
+
+  int64_t start = eventStart(t);
+
+  { ENTER(t, Thread::IdleState);
+
+    Timer timer(t->systemThread, 0);
+    if (scheduleTimer(t, &timer, nanoseconds)) {
+      t->systemThread->park(0);
+      cancelTimer(t, &timer);
+    } else {
+      t->systemThread->park(nanoseconds);
     }
   }
-  if (interrupted) {
+
+  if (start) {
+    recordEvent(t, ParkEvent, start, nanoseconds, 0, 0);
+  }
+
+  // if we were woken by Thread.interrupt, consume the system-level
+  // interrupt so it isn't seen again by a later monitor wait
+  if (t->systemThread->getAndClearInterrupted()) {
+    monitorAcquire(t, interruptLock(t, t->javaThread));
     threadInterrupted(t, t->javaThread) = true;
+    monitorRelease(t, interruptLock(t, t->javaThread));
   }
-  threadUnparked(t, t->javaThread) = false;
-  monitorRelease(t, interruptLock(t, t->javaThread));
 }
 
 extern "C" JNIEXPORT void JNICALL
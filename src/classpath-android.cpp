@@ -113,6 +113,8 @@ makeMethodOrConstructor(Thread* t, object c, unsigned index)
      byteArrayLength(t, methodSpec(t, method)) - 1 - returnTypeSpec);
   PROTECT(t, returnType);
 
+  ensureReflectionData(t, methodClass(t, method));
+
   object exceptionTypes = resolveExceptionJTypes
     (t, classLoader(t, methodClass(t, method)), methodAddendum(t, method));
 
@@ -792,7 +794,17 @@ extern "C" JNIEXPORT int64_t JNICALL
 Avian_java_lang_String_charAt
 (Thread* t, object, uintptr_t* arguments)
 {
-  return stringCharAt(t, reinterpret_cast<object>(arguments[0]), arguments[1]);
+  object s = reinterpret_cast<object>(arguments[0]);
+  int index = arguments[1];
+
+  // compiled code checks the index the same way, so each throws the
+  // same exception
+  if (UNLIKELY(index < 0 or index >= static_cast<int>(stringLength(t, s)))) {
+    throwNew(t, Machine::ArrayIndexOutOfBoundsExceptionType,
+             "%d not in [0,%d)", index, stringLength(t, s));
+  }
+
+  return stringCharAt(t, s, index);
 }
 
 extern "C" JNIEXPORT int64_t JNICALL
@@ -1479,6 +1491,9 @@ Avian_java_lang_reflect_Method_isAnnotationPresent
      (t, classMethodTable
       (t, jclassVmClass(t, reinterpret_cast<object>(arguments[0]))),
       arguments[1]);
+  PROTECT(t, method);
+
+  ensureReflectionData(t, methodClass(t, method));
 
   object addendum = methodAddendum(t, method);
   if (addendum) {
@@ -1505,6 +1520,9 @@ Avian_java_lang_reflect_Method_getAnnotation
      (t, classMethodTable
       (t, jclassVmClass(t, reinterpret_cast<object>(arguments[0]))),
       arguments[1]);
+  PROTECT(t, method);
+
+  ensureReflectionData(t, methodClass(t, method));
 
   object addendum = methodAddendum(t, method);
   if (addendum) {
@@ -1514,7 +1532,6 @@ Avian_java_lang_reflect_Method_getAnnotation
         if (objectArrayBody(t, objectArrayBody(t, table, i), 1)
             == reinterpret_cast<object>(arguments[2]))
         {
-          PROTECT(t, method);
           PROTECT(t, table);
 
           object get = resolveMethod
@@ -1542,12 +1559,14 @@ Avian_java_lang_reflect_Method_getDeclaredAnnotations
      (t, classMethodTable
       (t, jclassVmClass(t, reinterpret_cast<object>(arguments[0]))),
       arguments[1]);
+  PROTECT(t, method);
+
+  ensureReflectionData(t, methodClass(t, method));
 
   object addendum = methodAddendum(t, method);
   if (addendum) {
     object table = addendumAnnotationTable(t, addendum);
     if (table) {
-      PROTECT(t, method);
       PROTECT(t, table);
 
       object array = makeObjectArray
@@ -1782,7 +1801,7 @@ extern "C" JNIEXPORT int64_t JNICALL
 Avian_java_lang_System_nanoTime
 (Thread* t, object, uintptr_t*)
 {
-  return t->m->system->now() * 1000 * 1000;
+  return t->m->system->nanoTime();
 }
 
 extern "C" JNIEXPORT int64_t JNICALL
@@ -1891,6 +1910,8 @@ Avian_libcore_io_Posix_uname(Thread* t, object, uintptr_t*)
   object arch = makeString(t, "ppc");
 #elif defined ARCH_arm
   object arch = makeString(t, "arm");
+#elif defined ARCH_arm64
+  object arch = makeString(t, "aarch64");
 #else
   object arch = makeString(t, "unknown");
 #endif
@@ -53,7 +53,7 @@ class MyClasspath : public Classpath {
 
     return vm::makeThread
       (t, 0, 0, 0, 0, NewState, NormalPriority, 0, 0, 0,
-       root(t, Machine::BootLoader), 0, 0, group, 0);
+       root(t, Machine::BootLoader), 0, 0, group, 0, 0);
   }
 
   virtual object
@@ -61,7 +61,7 @@ class MyClasspath : public Classpath {
   {
     PROTECT(t, vmMethod);
 
-    object jmethod = makeJmethod(t, vmMethod, false);
+    object jmethod = makeJmethod(t, vmMethod, false, 0, 0);
 
     return byteArrayBody(t, methodName(t, vmMethod), 0) == '<'
       ? makeJconstructor(t, jmethod) : jmethod;
@@ -78,7 +78,7 @@ class MyClasspath : public Classpath {
   virtual object
   makeJField(Thread* t, object vmField)
   {
-    return makeJfield(t, vmField, false);
+    return makeJfield(t, vmField, false, 0, 0);
   }
 
   virtual object
@@ -421,19 +421,7 @@ Avian_java_lang_reflect_Method_invoke
   object instance = reinterpret_cast<object>(arguments[1]);
   object args = reinterpret_cast<object>(arguments[2]);
 
-  THREAD_RESOURCE0(t, {
-      if (t->exception) {
-        object exception = t->exception;
-        t->exception = makeThrowable
-          (t, Machine::InvocationTargetExceptionType, 0, 0, exception);
-      }
-    });
-
-  unsigned returnCode = methodReturnCode(t, method);
-
-  return reinterpret_cast<int64_t>
-    (translateInvokeResult
-     (t, returnCode, t->m->processor->invokeArray(t, method, instance, args)));
+  return reinterpret_cast<int64_t>(invoke(t, method, instance, args));
 }
 
 extern "C" JNIEXPORT int64_t JNICALL
@@ -563,6 +551,13 @@ Avian_java_lang_System_identityHashCode
   }
 }
 
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_java_lang_System_nanoTime
+(Thread* t, object, uintptr_t*)
+{
+  return t->m->system->nanoTime();
+}
+
 extern "C" JNIEXPORT void JNICALL
 Avian_java_lang_Runtime_load
 (Thread* t, object, uintptr_t* arguments)
@@ -600,6 +595,13 @@ Avian_java_lang_Runtime_totalMemory
   return 0;
 }
 
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_java_lang_Runtime_availableProcessors
+(Thread* t, object, uintptr_t*)
+{
+  return t->m->system->processorCount();
+}
+
 extern "C" JNIEXPORT void JNICALL
 Avian_java_lang_Runtime_addShutdownHook
 (Thread* t, object, uintptr_t* arguments)
@@ -743,6 +745,37 @@ Avian_avian_Atomic_compareAndSwapObject
   return success;
 }
 
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_sun_misc_Unsafe_objectFieldOffset
+(Thread* t, object, uintptr_t* arguments)
+{
+  return fieldOffset
+    (t, jfieldVmField(t, reinterpret_cast<object>(arguments[1])));
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_sun_misc_Unsafe_compareAndSwapLong
+(Thread* t UNUSED, object, uintptr_t* arguments)
+{
+  object target = reinterpret_cast<object>(arguments[1]);
+  int64_t offset; memcpy(&offset, arguments + 2, 8);
+  uint64_t expect; memcpy(&expect, arguments + 4, 8);
+  uint64_t update; memcpy(&update, arguments + 6, 8);
+
+#ifdef AVIAN_HAS_CAS64
+  return atomicCompareAndSwap64
+    (&fieldAtOffset<uint64_t>(target, offset), expect, update);
+#else
+  ACQUIRE_FIELD_FOR_WRITE(t, fieldForOffset(t, target, offset));
+  if (fieldAtOffset<uint64_t>(target, offset) == expect) {
+    fieldAtOffset<uint64_t>(target, offset) = update;
+    return true;
+  } else {
+    return false;
+  }
+#endif
+}
+
 extern "C" JNIEXPORT int64_t JNICALL
 Avian_avian_Classes_isAssignableFrom
 (Thread* t, object, uintptr_t* arguments)
@@ -356,6 +356,9 @@ void
 interceptFileOperations(Thread*, bool);
 #endif
 
+void
+interceptHotNatives(Thread*, bool);
+
 class MyClasspath : public Classpath {
  public:
   MyClasspath(System* s, Allocator* allocator, const char* javaHome,
@@ -446,6 +449,8 @@ class MyClasspath : public Classpath {
 #  define LIB_DIR "/lib/amd64"
 #elif defined ARCH_arm
 #  define LIB_DIR "/lib/arm"
+#elif defined ARCH_arm64
+#  define LIB_DIR "/lib/aarch64"
 #else
     // todo: handle other architectures
 #  define LIB_DIR "/lib/i386"
@@ -666,11 +671,12 @@ class MyClasspath : public Classpath {
   }
 
   virtual void
-  interceptMethods(Thread* t UNUSED)
+  interceptMethods(Thread* t)
   {
 #ifdef AVIAN_OPENJDK_SRC
     interceptFileOperations(t, false);
 #endif
+    interceptHotNatives(t, false);
   }
 
   virtual void
@@ -691,6 +697,8 @@ class MyClasspath : public Classpath {
             (t, root(t, Machine::BootLoader), "java/lang/ThreadGroup",
              "threadTerminated", "(Ljava/lang/Thread;)V"));
 
+    interceptHotNatives(t, true);
+
 #ifdef AVIAN_OPENJDK_SRC
     interceptFileOperations(t, true);
 #else // not AVIAN_OPENJDK_SRC
@@ -2123,6 +2131,71 @@ interceptFileOperations(Thread* t, bool updateRuntimeData)
 }
 #endif // AVIAN_OPENJDK_SRC
 
+int64_t JNICALL
+objectHashCode(Thread* t, object, uintptr_t* arguments)
+{
+  return objectHash(t, reinterpret_cast<object>(arguments[0]));
+}
+
+int64_t JNICALL
+identityHashCode(Thread* t, object, uintptr_t* arguments)
+{
+  object o = reinterpret_cast<object>(arguments[0]);
+
+  return o ? objectHash(t, o) : 0;
+}
+
+int64_t JNICALL
+currentTimeMillis(Thread* t, object, uintptr_t*)
+{
+  return t->m->system->now();
+}
+
+int64_t JNICALL
+nanoTime(Thread* t, object, uintptr_t*)
+{
+  return t->m->system->nanoTime();
+}
+
+void JNICALL
+arraycopy(Thread* t, object, uintptr_t* arguments)
+{
+  arrayCopy(t, reinterpret_cast<object>(arguments[0]), arguments[1],
+            reinterpret_cast<object>(arguments[2]), arguments[3],
+            arguments[4]);
+}
+
+// The class library registers JVM_IHashCode and friends as the JNI
+// implementations of these, so each call would otherwise go through a
+// JNI transition and a handle for every argument.  The builtins below
+// take their place instead, and registerNative leaves them there.
+void
+interceptHotNatives(Thread* t, bool updateRuntimeData)
+{
+  intercept(t, type(t, Machine::JobjectType), "hashCode", "()I",
+            voidPointer(objectHashCode), updateRuntimeData);
+
+  object systemClass = resolveClass
+    (t, root(t, Machine::BootLoader), "java/lang/System", false);
+
+  if (systemClass) {
+    PROTECT(t, systemClass);
+
+    intercept(t, systemClass, "identityHashCode", "(Ljava/lang/Object;)I",
+              voidPointer(identityHashCode), updateRuntimeData);
+
+    intercept(t, systemClass, "currentTimeMillis", "()J",
+              voidPointer(currentTimeMillis), updateRuntimeData);
+
+    intercept(t, systemClass, "nanoTime", "()J",
+              voidPointer(nanoTime), updateRuntimeData);
+
+    intercept(t, systemClass, "arraycopy",
+              "(Ljava/lang/Object;ILjava/lang/Object;II)V",
+              voidPointer(arraycopy), updateRuntimeData);
+  }
+}
+
 object
 getClassMethodTable(Thread* t, object c)
 {
@@ -2212,6 +2285,8 @@ makeJmethod(Thread* t, object vmMethod, int index)
      byteArrayLength(t, methodSpec(t, vmMethod)) - 1 - returnTypeSpec);
   PROTECT(t, returnType);
 
+  ensureReflectionData(t, methodClass(t, vmMethod));
+
   object exceptionTypes = resolveExceptionJTypes
     (t, classLoader(t, methodClass(t, vmMethod)),
      methodAddendum(t, vmMethod));
@@ -2288,6 +2363,8 @@ makeJconstructor(Thread* t, object vmMethod, int index)
      &parameterCount, &returnTypeSpec);
   PROTECT(t, parameterTypes);
 
+  ensureReflectionData(t, methodClass(t, vmMethod));
+
   object exceptionTypes = resolveExceptionJTypes
     (t, classLoader(t, methodClass(t, vmMethod)),
      methodAddendum(t, vmMethod));
@@ -2366,6 +2443,8 @@ makeJfield(Thread* t, object vmField, int index)
 
   type = getJClass(t, type);
 
+  ensureReflectionData(t, fieldClass(t, vmField));
+
   object signature;
   object annotationTable;
   object addendum = fieldAddendum(t, vmField);
@@ -2453,60 +2532,6 @@ pipeAvailable(int fd, int* available)
 #endif
 }
 
-object
-fieldForOffsetInClass(Thread* t, object c, unsigned offset)
-{
-  object super = classSuper(t, c);
-  if (super) {
-    object field = fieldForOffsetInClass(t, super, offset);
-    if (field) {
-      return field;
-    }
-  }
-
-  object table = classFieldTable(t, c);
-  if (table) {
-    for (unsigned i = 0; i < objectArrayLength(t, table); ++i) {
-      object field = objectArrayBody(t, table, i);
-      if ((fieldFlags(t, field) & ACC_STATIC) == 0
-          and fieldOffset(t, field) == offset)
-      {
-        return field;
-      }
-    }
-  }
-
-  return 0;
-}
-
-object
-fieldForOffset(Thread* t, object o, unsigned offset)
-{
-  object c = objectClass(t, o);
-  if (classVmFlags(t, c) & SingletonFlag) {
-    c = singletonObject(t, o, 0);
-    object table = classFieldTable(t, c);
-    if (table) {
-      for (unsigned i = 0; i < objectArrayLength(t, table); ++i) {
-        object field = objectArrayBody(t, table, i);
-        if ((fieldFlags(t, field) & ACC_STATIC)
-            and fieldOffset(t, field) == offset)
-        {
-          return field;
-        }
-      }
-    }
-    abort(t);
-  } else {
-    object field = fieldForOffsetInClass(t, c, offset);
-    if (field) {
-      return field;
-    } else {
-      abort(t);
-    }
-  }
-}
-
 } // namespace local
 
 } // namespace
@@ -2741,23 +2766,28 @@ Avian_sun_misc_Unsafe_getLongVolatile
   PROTECT(t, o);
   { ENTER(t, Thread::IdleState); }
 
-  object field;
   if (BytesPerWord < 8) {
-    field = local::fieldForOffset(t, o, offset);
+#ifdef AVIAN_HAS_CAS64
+    return atomicLoad64(&fieldAtOffset<uint64_t>(o, offset));
+#else
+    object field = fieldForOffset(t, o, offset);
 
     PROTECT(t, field);
     acquire(t, field);        
-  }
 
-  int64_t result = fieldAtOffset<int64_t>(o, offset);
+    int64_t result = fieldAtOffset<int64_t>(o, offset);
 
-  if (BytesPerWord < 8) {
     release(t, field);        
+
+    return result;
+#endif
   } else {
+    int64_t result = fieldAtOffset<int64_t>(o, offset);
+
     loadMemoryBarrier();
-  }
 
-  return result;
+    return result;
+  }
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -2904,7 +2934,7 @@ Avian_sun_misc_Unsafe_compareAndSwapLong
   return atomicCompareAndSwap64
     (&fieldAtOffset<uint64_t>(target, offset), expect, update);
 #else
-  ACQUIRE_FIELD_FOR_WRITE(t, local::fieldForOffset(t, target, offset));
+  ACQUIRE_FIELD_FOR_WRITE(t, fieldForOffset(t, target, offset));
   if (fieldAtOffset<uint64_t>(target, offset) == expect) {
     fieldAtOffset<uint64_t>(target, offset) = update;
     return true;
@@ -3058,7 +3088,7 @@ EXPORT(JVM_CurrentTimeMillis)(Thread* t, jclass)
 extern "C" JNIEXPORT jlong JNICALL
 EXPORT(JVM_NanoTime)(Thread* t, jclass)
 {
-  return t->m->system->now() * 1000 * 1000;
+  return t->m->system->nanoTime();
 }
 
 uint64_t
@@ -3171,6 +3201,8 @@ jvmInitProperties(Thread* t, uintptr_t* arguments)
   local::setProperty(t, method, *properties, "os.arch", "ppc");
 #elif defined ARCH_arm
   local::setProperty(t, method, *properties, "os.arch", "arm");
+#elif defined ARCH_arm64
+  local::setProperty(t, method, *properties, "os.arch", "aarch64");
 #else
   local::setProperty(t, method, *properties, "os.arch", "unknown");
 #endif
@@ -4297,6 +4329,8 @@ jvmGetDeclaredClasses(Thread* t, uintptr_t* arguments)
 {
   jclass c = reinterpret_cast<jobject>(arguments[0]);
 
+  ensureReflectionData(t, jclassVmClass(t, *c));
+
   object addendum = classAddendum(t, jclassVmClass(t, *c));
   if (addendum) {
     object table = classAddendumInnerClassTable(t, addendum);
@@ -4354,6 +4388,8 @@ jvmGetDeclaringClass(Thread* t, uintptr_t* arguments)
   jclass c = reinterpret_cast<jobject>(arguments[0]);
 
   object class_ = jclassVmClass(t, *c);
+  ensureReflectionData(t, class_);
+
   object addendum = classAddendum(t, class_);
   if (addendum) {
     object table = classAddendumInnerClassTable(t, addendum);
@@ -4391,6 +4427,8 @@ jvmGetClassSignature(Thread* t, uintptr_t* arguments)
 {
   jclass c = reinterpret_cast<jobject>(arguments[0]);
 
+  ensureReflectionData(t, jclassVmClass(t, *c));
+
   object addendum = classAddendum(t, jclassVmClass(t, *c));
   if (addendum) {
     object signature = addendumSignature(t, addendum);
@@ -4417,6 +4455,8 @@ EXPORT(JVM_GetClassAnnotations)(Thread* t, jclass c)
 {
   ENTER(t, Thread::ActiveState);
 
+  ensureReflectionData(t, jclassVmClass(t, *c));
+
   object addendum = classAddendum(t, jclassVmClass(t, *c));
   return addendum
     ? makeLocalReference(t, addendumAnnotationTable(t, addendum)) : 0;
@@ -4647,6 +4687,11 @@ EXPORT(JVM_GetClassConstantPool)(Thread* t, jclass c)
   ENTER(t, Thread::ActiveState);
 
   object vmClass = jclassVmClass(t, *c);
+  PROTECT(t, vmClass);
+
+  // the pool must be the one any annotations will be read with
+  ensureReflectionData(t, vmClass);
+
   object addendum = classAddendum(t, vmClass);
   object pool;
   if (addendum) {
@@ -5305,9 +5350,28 @@ jint JNICALL
 GetOptionalSupport(Thread*, jmmOptionalSupport* support)
 {
   memset(support, 0, sizeof(jmmOptionalSupport));
+  support->isCurrentThreadCpuTimeSupported = 1;
   return 0;
 }
 
+// ThreadMXBean asks for the current thread with an ID of zero, which is
+// the only one we can find without a search by ID
+jlong JNICALL
+GetThreadCpuTimeWithKind(Thread* t, jlong id, jboolean userAndSystem)
+{
+  if (id == 0 and userAndSystem) {
+    return t->systemThread->cpuTime();
+  } else {
+    return -1;
+  }
+}
+
+jlong JNICALL
+GetThreadCpuTime(Thread* t, jlong id)
+{
+  return GetThreadCpuTimeWithKind(t, id, true);
+}
+
 jlong JNICALL
 GetLongAttribute(Thread* t, jobject, jmmLongAttribute attribute)
 {
@@ -5330,6 +5394,8 @@ GetBoolAttribute(Thread* t, jmmBoolAttribute attribute)
 
   switch (attribute) {
   case JMM_THREAD_CPU_TIME:
+    return true;
+
   case JMM_THREAD_ALLOCATED_MEMORY:
     return false;
 
@@ -5386,6 +5452,8 @@ EXPORT(JVM_GetManagement)(jint version)
     interface->GetOptionalSupport = GetOptionalSupport;
     interface->GetLongAttribute = GetLongAttribute;
     interface->GetBoolAttribute = GetBoolAttribute;
+    interface->GetThreadCpuTime = GetThreadCpuTime;
+    interface->GetThreadCpuTimeWithKind = GetThreadCpuTimeWithKind;
     interface->GetMemoryManagers = GetMemoryManagers;
     interface->GetMemoryPools = GetMemoryPools;
     interface->GetInputArgumentArray = GetInputArgumentArray;
@@ -5406,6 +5474,8 @@ getEnclosingMethodInfo(Thread* t, uintptr_t* arguments)
   object class_ = jclassVmClass(t, *c);
   PROTECT(t, class_);
 
+  ensureReflectionData(t, class_);
+
   object addendum = classAddendum(t, class_);
   if (addendum) {
     object enclosingClass = classAddendumEnclosingClass(t, addendum);
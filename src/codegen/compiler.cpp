@@ -1867,6 +1867,10 @@ compile(Context* c, uintptr_t stackOverflowHandler, unsigned stackLimitOffset)
     c->locals = e->localsBefore;
 
     if (e->logicalInstruction->machineOffset == 0) {
+      if (e->logicalInstruction->loopHeader) {
+        a->apply(lir::AlignLoop);
+      }
+
       e->logicalInstruction->machineOffset = a->offset();
     }
 
@@ -2110,6 +2114,54 @@ class Client: public Assembler::Client {
   Context* c;
 };
 
+bool
+foldConstants(Context* c, lir::TernaryOperation type, unsigned size,
+              Value* a, Value* b, int64_t* result)
+{
+  if (size > vm::TargetBytesPerWord) {
+    return false;
+  }
+
+  ConstantSite* as = findConstantSite(c, a);
+  ConstantSite* bs = findConstantSite(c, b);
+  if (as == 0 or bs == 0
+      or not (as->value->resolved() and bs->value->resolved()))
+  {
+    return false;
+  }
+
+  // like the LIR operations themselves, this computes "b op a"
+  uint64_t av = as->value->value();
+  uint64_t bv = bs->value->value();
+  unsigned shift = av & (size * 8 - 1);
+
+  uint64_t r;
+  switch (type) {
+  case lir::Add: r = bv + av; break;
+  case lir::Subtract: r = bv - av; break;
+  case lir::Multiply: r = bv * av; break;
+  case lir::And: r = bv & av; break;
+  case lir::Or: r = bv | av; break;
+  case lir::Xor: r = bv ^ av; break;
+  case lir::ShiftLeft: r = bv << shift; break;
+
+  case lir::ShiftRight:
+    r = size == 4 ? static_cast<int32_t>(bv) >> shift
+      : static_cast<int64_t>(bv) >> shift;
+    break;
+
+  case lir::UnsignedShiftRight:
+    r = size == 4 ? static_cast<uint32_t>(bv) >> shift : bv >> shift;
+    break;
+
+  default:
+    return false;
+  }
+
+  *result = size == 4 ? static_cast<int32_t>(r) : static_cast<int64_t>(r);
+  return true;
+}
+
 class MyCompiler: public Compiler {
  public:
   MyCompiler(System* s, Assembler* assembler, Zone* zone,
@@ -2266,6 +2318,18 @@ class MyCompiler: public Compiler {
     }
   }
 
+  virtual void markCold(unsigned logicalIp) {
+    assert(&c, c.logicalCode[logicalIp]);
+
+    c.logicalCode[logicalIp]->cold = true;
+  }
+
+  virtual void markLoopHeader(unsigned logicalIp) {
+    assert(&c, c.logicalCode[logicalIp]);
+
+    c.logicalCode[logicalIp]->loopHeader = true;
+  }
+
   virtual Promise* machineIp(unsigned logicalIp) {
     return ipPromise(&c, logicalIp);
   }
@@ -2478,6 +2542,16 @@ class MyCompiler: public Compiler {
     return result;
   }
 
+  virtual void safepoint(Operand* address, TraceHandler* traceHandler,
+                         unsigned pollOffset)
+  {
+    Stack* argumentStack = compiler::stack
+      (&c, compiler::register_(&c, c.arch->thread()), c.stack);
+
+    appendSafepoint(&c, static_cast<Value*>(address), traceHandler,
+                    argumentStack, pollOffset);
+  }
+
   virtual void return_(unsigned size, Operand* value) {
     appendReturn(&c, size, static_cast<Value*>(value));
   }
@@ -2767,6 +2841,13 @@ class MyCompiler: public Compiler {
   virtual Operand* add(unsigned size, Operand* a, Operand* b) {
     assert(&c, static_cast<Value*>(a)->type == lir::ValueGeneral
            and static_cast<Value*>(b)->type == lir::ValueGeneral);
+    int64_t folded;
+    if (foldConstants(&c, lir::Add, size, static_cast<Value*>(a),
+                      static_cast<Value*>(b), &folded))
+    {
+      return constant(folded, Compiler::IntegerType);
+    }
+
     Value* result = value(&c, lir::ValueGeneral);
     appendCombine(&c, lir::Add, size, static_cast<Value*>(a),
                   size, static_cast<Value*>(b), size, result);
@@ -2776,6 +2857,13 @@ class MyCompiler: public Compiler {
   virtual Operand* sub(unsigned size, Operand* a, Operand* b) {
     assert(&c, static_cast<Value*>(a)->type == lir::ValueGeneral
            and static_cast<Value*>(b)->type == lir::ValueGeneral);
+    int64_t folded;
+    if (foldConstants(&c, lir::Subtract, size, static_cast<Value*>(a),
+                      static_cast<Value*>(b), &folded))
+    {
+      return constant(folded, Compiler::IntegerType);
+    }
+
     Value* result = value(&c, lir::ValueGeneral);
     appendCombine(&c, lir::Subtract, size, static_cast<Value*>(a),
                   size, static_cast<Value*>(b), size, result);
@@ -2785,6 +2873,13 @@ class MyCompiler: public Compiler {
   virtual Operand* mul(unsigned size, Operand* a, Operand* b) {
     assert(&c, static_cast<Value*>(a)->type == lir::ValueGeneral
            and static_cast<Value*>(b)->type == lir::ValueGeneral);
+    int64_t folded;
+    if (foldConstants(&c, lir::Multiply, size, static_cast<Value*>(a),
+                      static_cast<Value*>(b), &folded))
+    {
+      return constant(folded, Compiler::IntegerType);
+    }
+
     Value* result = value(&c, lir::ValueGeneral);
     appendCombine(&c, lir::Multiply, size, static_cast<Value*>(a),
                   size, static_cast<Value*>(b), size, result);
@@ -2859,6 +2954,13 @@ class MyCompiler: public Compiler {
 
   virtual Operand* shl(unsigned size, Operand* a, Operand* b) {
   	assert(&c, static_cast<Value*>(a)->type == lir::ValueGeneral);
+    int64_t folded;
+    if (foldConstants(&c, lir::ShiftLeft, size, static_cast<Value*>(a),
+                      static_cast<Value*>(b), &folded))
+    {
+      return constant(folded, Compiler::IntegerType);
+    }
+
     Value* result = value(&c, lir::ValueGeneral);
     appendCombine(&c, lir::ShiftLeft, TargetBytesPerWord, static_cast<Value*>(a),
                   size, static_cast<Value*>(b), size, result);
@@ -2867,6 +2969,13 @@ class MyCompiler: public Compiler {
 
   virtual Operand* shr(unsigned size, Operand* a, Operand* b) {
   	assert(&c, static_cast<Value*>(a)->type == lir::ValueGeneral);
+    int64_t folded;
+    if (foldConstants(&c, lir::ShiftRight, size, static_cast<Value*>(a),
+                      static_cast<Value*>(b), &folded))
+    {
+      return constant(folded, Compiler::IntegerType);
+    }
+
     Value* result = value(&c, lir::ValueGeneral);
     appendCombine(&c, lir::ShiftRight, TargetBytesPerWord, static_cast<Value*>(a),
                   size, static_cast<Value*>(b), size, result);
@@ -2875,6 +2984,13 @@ class MyCompiler: public Compiler {
 
   virtual Operand* ushr(unsigned size, Operand* a, Operand* b) {
   	assert(&c, static_cast<Value*>(a)->type == lir::ValueGeneral);
+    int64_t folded;
+    if (foldConstants(&c, lir::UnsignedShiftRight, size, static_cast<Value*>(a),
+                      static_cast<Value*>(b), &folded))
+    {
+      return constant(folded, Compiler::IntegerType);
+    }
+
     Value* result = value(&c, lir::ValueGeneral);
     appendCombine
       (&c, lir::UnsignedShiftRight, TargetBytesPerWord, static_cast<Value*>(a),
@@ -2884,6 +3000,13 @@ class MyCompiler: public Compiler {
 
   virtual Operand* and_(unsigned size, Operand* a, Operand* b) {
   	assert(&c, static_cast<Value*>(a)->type == lir::ValueGeneral);
+    int64_t folded;
+    if (foldConstants(&c, lir::And, size, static_cast<Value*>(a),
+                      static_cast<Value*>(b), &folded))
+    {
+      return constant(folded, Compiler::IntegerType);
+    }
+
     Value* result = value(&c, lir::ValueGeneral);
     appendCombine(&c, lir::And, size, static_cast<Value*>(a),
                   size, static_cast<Value*>(b), size, result);
@@ -2892,6 +3015,13 @@ class MyCompiler: public Compiler {
 
   virtual Operand* or_(unsigned size, Operand* a, Operand* b) {
   	assert(&c, static_cast<Value*>(a)->type == lir::ValueGeneral);
+    int64_t folded;
+    if (foldConstants(&c, lir::Or, size, static_cast<Value*>(a),
+                      static_cast<Value*>(b), &folded))
+    {
+      return constant(folded, Compiler::IntegerType);
+    }
+
     Value* result = value(&c, lir::ValueGeneral);
     appendCombine(&c, lir::Or, size, static_cast<Value*>(a),
                   size, static_cast<Value*>(b), size, result);
@@ -2900,6 +3030,13 @@ class MyCompiler: public Compiler {
 
   virtual Operand* xor_(unsigned size, Operand* a, Operand* b) {
   	assert(&c, static_cast<Value*>(a)->type == lir::ValueGeneral);
+    int64_t folded;
+    if (foldConstants(&c, lir::Xor, size, static_cast<Value*>(a),
+                      static_cast<Value*>(b), &folded))
+    {
+      return constant(folded, Compiler::IntegerType);
+    }
+
     Value* result = value(&c, lir::ValueGeneral);
     appendCombine(&c, lir::Xor, size, static_cast<Value*>(a),
                   size, static_cast<Value*>(b), size, result);
@@ -2942,6 +3079,54 @@ class MyCompiler: public Compiler {
       (&c, lir::FloatSquareRoot, size, static_cast<Value*>(a), size, result);
     return result;
   }
+
+  virtual Operand* popcnt(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == lir::ValueGeneral);
+    Value* result = value(&c, lir::ValueGeneral);
+    appendTranslate
+      (&c, lir::PopCount, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
+
+  virtual Operand* lzcnt(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == lir::ValueGeneral);
+    Value* result = value(&c, lir::ValueGeneral);
+    appendTranslate
+      (&c, lir::LeadingZeros, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
+
+  virtual Operand* tzcnt(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == lir::ValueGeneral);
+    Value* result = value(&c, lir::ValueGeneral);
+    appendTranslate
+      (&c, lir::TrailingZeros, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
+
+  virtual Operand* bswap(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == lir::ValueGeneral);
+    Value* result = value(&c, lir::ValueGeneral);
+    appendTranslate
+      (&c, lir::ByteSwap, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
+
+  virtual Operand* ffloor(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == lir::ValueFloat);
+    Value* result = value(&c, lir::ValueFloat);
+    appendTranslate
+      (&c, lir::FloatFloor, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
+
+  virtual Operand* fceil(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == lir::ValueFloat);
+    Value* result = value(&c, lir::ValueFloat);
+    appendTranslate
+      (&c, lir::FloatCeiling, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
   
   virtual Operand* f2f(unsigned aSize, unsigned resSize, Operand* a) {
     assert(&c, static_cast<Value*>(a)->type == lir::ValueFloat);
@@ -506,6 +506,50 @@ appendCall(Context* c, Value* address, unsigned flags,
                    stackArgumentFootprint));
 }
 
+class SafepointEvent: public CallEvent {
+ public:
+  SafepointEvent(Context* c, Value* address, TraceHandler* traceHandler,
+                 Stack* argumentStack, unsigned pollOffset):
+    CallEvent(c, address, 0, traceHandler, 0, 0, argumentStack, 1, 0),
+    pollOffset(pollOffset)
+  { }
+
+  virtual const char* name() {
+    return "SafepointEvent";
+  }
+
+  virtual void compile(Context* c) {
+    // skip the call unless the poll word at pollOffset from the
+    // thread register is nonzero
+    CodePromise* nextPromise = compiler::codePromise
+      (c, static_cast<Promise*>(0));
+
+    ConstantSite zero(resolvedPromise(c, 0));
+    MemorySite poll(c->arch->thread(), pollOffset, lir::NoRegister, 1);
+    poll.acquired = true;
+    ConstantSite next(nextPromise);
+    apply(c, lir::JumpIfEqual,
+      vm::TargetBytesPerWord, &zero, &zero,
+      vm::TargetBytesPerWord, &poll, &poll,
+      vm::TargetBytesPerWord, &next, &next);
+
+    CallEvent::compile(c);
+
+    nextPromise->offset = c->assembler->offset();
+  }
+
+  unsigned pollOffset;
+};
+
+void
+appendSafepoint(Context* c, Value* address, TraceHandler* traceHandler,
+                Stack* argumentStack, unsigned pollOffset)
+{
+  append(c, new(c->zone)
+         SafepointEvent(c, address, traceHandler, argumentStack,
+                        pollOffset));
+}
+
 
 class ReturnEvent: public Event {
  public:
@@ -119,6 +119,10 @@ appendCall(Context* c, Value* address, unsigned flags,
            Stack* argumentStack, unsigned argumentCount,
            unsigned stackArgumentFootprint);
 
+void
+appendSafepoint(Context* c, Value* address, TraceHandler* traceHandler,
+                Stack* argumentStack, unsigned pollOffset);
+
 void
 appendReturn(Context* c, unsigned size, Value* value);
 
@@ -17,14 +17,23 @@ namespace compiler {
 
 LogicalInstruction::LogicalInstruction(int index, Stack* stack, Local* locals):
   firstEvent(0), lastEvent(0), immediatePredecessor(0), stack(stack),
-  locals(locals), machineOffset(0), subroutine(0), index(index)
+  locals(locals), machineOffset(0), subroutine(0), index(index), cold(false),
+  loopHeader(false)
 { }
 
+// Returns the instruction laid out after this one: cold instructions
+// follow all the others, and each group is kept in logical order.
 LogicalInstruction* LogicalInstruction::next(Context* c) {
-  LogicalInstruction* i = this;
-  for (unsigned n = i->index + 1; n < c->logicalCodeLength; ++n) {
-    i = c->logicalCode[n];
-    if (i) return i;
+  for (unsigned n = index + 1; n < c->logicalCodeLength; ++n) {
+    LogicalInstruction* i = c->logicalCode[n];
+    if (i and i->cold == cold) return i;
+  }
+
+  if (not cold) {
+    for (unsigned n = 0; n < c->logicalCodeLength; ++n) {
+      LogicalInstruction* i = c->logicalCode[n];
+      if (i and i->cold) return i;
+    }
   }
   return 0;
 }
@@ -59,6 +59,8 @@ class LogicalInstruction {
   Promise* machineOffset;
   MySubroutine* subroutine;
   int index;
+  bool cold;
+  bool loopHeader;
 };
 
 class MySubroutine: public Compiler::Subroutine {
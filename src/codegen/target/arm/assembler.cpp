@@ -21,6 +21,7 @@
 #include "encode.h"
 #include "operations.h"
 #include "registers.h"
+#include "detect.h"
 #include "../multimethod.h"
 
 #include "avian/alloc-vector.h"
@@ -34,23 +35,6 @@ namespace avian {
 namespace codegen {
 namespace arm {
 
-namespace isa {
-// HARDWARE FLAGS
-bool vfpSupported() {
-  // TODO: Use at runtime detection
-#if defined(__ARM_PCS_VFP)  
-  // armhf
-  return true;
-#else
-  // armel
-  // TODO: allow VFP use for -mfloat-abi=softfp armel builds.
-  // GCC -mfloat-abi=softfp flag allows use of VFP while remaining compatible
-  // with soft-float code. 
-  return false;
-#endif
-}
-} // namespace isa
-
 inline unsigned lo8(int64_t i) { return (unsigned)(i&MASK_LO8); }
 
 const RegisterFile MyRegisterFileWithoutFloats(GPR_MASK, 0);
@@ -140,16 +124,18 @@ nextFrame(ArchitectureContext* con, uint32_t* start, unsigned size UNUSED,
 
 class MyArchitecture: public Architecture {
  public:
-  MyArchitecture(System* system): con(system), referenceCount(0) {
+  MyArchitecture(System* system, bool useNativeFeatures):
+    con(system, useNativeFeatures), referenceCount(0)
+  {
     populateTables(&con);
   }
 
   virtual unsigned floatRegisterSize() {
-    return vfpSupported() ? 8 : 0;
+    return vfpSupported(&con) ? 8 : 0;
   }
 
   virtual const RegisterFile* registerFile() {
-    return vfpSupported() ? &MyRegisterFileWithFloats : &MyRegisterFileWithoutFloats;
+    return vfpSupported(&con) ? &MyRegisterFileWithFloats : &MyRegisterFileWithoutFloats;
   }
 
   virtual int scratch() {
@@ -357,14 +343,28 @@ class MyArchitecture: public Architecture {
       break;
 
     case lir::Absolute:
+    case lir::PopCount:
+    case lir::TrailingZeros:
+    case lir::ByteSwap:
+    case lir::FloatFloor:
+    case lir::FloatCeiling:
       *thunk = true;
       break;
 
+    case lir::LeadingZeros:
+      if (aSize == 4) {
+        aMask.typeMask = (1 << lir::RegisterOperand);
+        aMask.registerMask = GPR_MASK64;
+      } else {
+        *thunk = true;
+      }
+      break;
+
     case lir::FloatAbsolute:
     case lir::FloatSquareRoot:
     case lir::FloatNegate:
     case lir::Float2Float:
-      if (vfpSupported()) {
+      if (vfpSupported(&con)) {
         aMask.typeMask = (1 << lir::RegisterOperand);
         aMask.registerMask = FPR_MASK64;
       } else {
@@ -373,11 +373,10 @@ class MyArchitecture: public Architecture {
       break;
 
     case lir::Float2Int:
-      // todo: Java requires different semantics than SSE for
-      // converting floats to integers, we we need to either use
-      // thunks or produce inline machine code which handles edge
-      // cases properly.
-      if (false && vfpSupported() && bSize == 4) {
+      // VFP's round-towards-zero conversions saturate and map NaN to
+      // zero, which is what Java requires, but there is no VFP
+      // conversion to a 64-bit integer
+      if (vfpSupported(&con) && bSize == 4) {
         aMask.typeMask = (1 << lir::RegisterOperand);
         aMask.registerMask = FPR_MASK64;
       } else {
@@ -386,7 +385,7 @@ class MyArchitecture: public Architecture {
       break;
 
     case lir::Int2Float:
-      if (vfpSupported() && aSize == 4) {
+      if (vfpSupported(&con) && aSize == 4) {
         aMask.typeMask = (1 << lir::RegisterOperand);
         aMask.registerMask = GPR_MASK64;
       } else {
@@ -409,6 +408,7 @@ class MyArchitecture: public Architecture {
 
     switch (op) {
     case lir::Negate:
+    case lir::LeadingZeros:
       bMask.typeMask = (1 << lir::RegisterOperand);
       bMask.registerMask = GPR_MASK64;
       break;
@@ -454,7 +454,7 @@ class MyArchitecture: public Architecture {
       srcMask.typeMask = 1 << lir::RegisterOperand;
       tmpMask.typeMask = 1 << lir::RegisterOperand;
       tmpMask.registerMask = GPR_MASK64;
-    } else if (vfpSupported() &&
+    } else if (vfpSupported(&con) &&
                dstMask.typeMask & 1 << lir::RegisterOperand &&
                dstMask.registerMask & FPR_MASK) {
       srcMask.typeMask = tmpMask.typeMask = 1 << lir::RegisterOperand |
@@ -502,7 +502,7 @@ class MyArchitecture: public Architecture {
     case lir::FloatSubtract:
     case lir::FloatMultiply:
     case lir::FloatDivide:
-      if (vfpSupported()) {
+      if (vfpSupported(&con)) {
         aMask.typeMask = bMask.typeMask = (1 << lir::RegisterOperand);
         aMask.registerMask = bMask.registerMask = FPR_MASK64;
       } else {
@@ -520,7 +520,7 @@ class MyArchitecture: public Architecture {
     case lir::JumpIfFloatGreaterOrUnordered:
     case lir::JumpIfFloatLessOrEqualOrUnordered:
     case lir::JumpIfFloatGreaterOrEqualOrUnordered:
-      if (vfpSupported()) {
+      if (vfpSupported(&con)) {
         aMask.typeMask = bMask.typeMask = (1 << lir::RegisterOperand);
         aMask.registerMask = bMask.registerMask = FPR_MASK64;
       } else {
@@ -953,9 +953,10 @@ Assembler* MyArchitecture::makeAssembler(Allocator* allocator, Zone* zone) {
 } // namespace arm
 
 Architecture*
-makeArchitectureArm(System* system, bool)
+makeArchitectureArm(System* system, bool useNativeFeatures)
 {
-  return new (allocate(system, sizeof(arm::MyArchitecture))) arm::MyArchitecture(system);
+  return new (allocate(system, sizeof(arm::MyArchitecture)))
+    arm::MyArchitecture(system, useNativeFeatures);
 }
 
 } // namespace codegen
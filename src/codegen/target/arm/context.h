@@ -70,9 +70,12 @@ typedef void (*BranchOperationType)
 
 class ArchitectureContext {
  public:
-  ArchitectureContext(vm::System* s): s(s) { }
+  ArchitectureContext(vm::System* s, bool useNativeFeatures):
+    s(s), useNativeFeatures(useNativeFeatures)
+  { }
 
   vm::System* s;
+  bool useNativeFeatures;
   OperationType operations[lir::OperationCount];
   UnaryOperationType unaryOperations[lir::UnaryOperationCount
                                      * lir::OperandTypeCount];
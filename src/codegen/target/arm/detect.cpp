@@ -0,0 +1,82 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include "avian/common.h"
+
+#include "context.h"
+#include "detect.h"
+
+#if (defined __arm__) && (defined __linux__)
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace {
+
+#if (defined __arm__) && (defined __linux__)
+const uint32_t AT_HWCAP_ = 16;
+const uint32_t HWCAP_VFP_ = 1 << 6;
+
+// reads the kernel's hardware capability bits from the auxiliary
+// vector, which works on both glibc and Bionic
+bool
+detectVfp()
+{
+  int fd = open("/proc/self/auxv", O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  bool supported = false;
+  uint32_t entry[2];
+  while (read(fd, entry, sizeof(entry)) == sizeof(entry) and entry[0]) {
+    if (entry[0] == AT_HWCAP_) {
+      supported = (entry[1] & HWCAP_VFP_) != 0;
+      break;
+    }
+  }
+
+  close(fd);
+
+  return supported;
+}
+#endif
+
+} // namespace
+
+namespace avian {
+namespace codegen {
+namespace arm {
+
+bool vfpSupported(ArchitectureContext* c UNUSED) {
+#if defined(__ARM_PCS_VFP)
+  // armhf
+  return true;
+#elif (defined __arm__) && (defined __linux__)
+  // armel, which may still use VFP internally if the CPU has it,
+  // since compiled code passes floats to native code in core
+  // registers either way
+  if (c->useNativeFeatures) {
+    static int supported = -1;
+    if (supported == -1) {
+      supported = detectVfp();
+    }
+    return supported;
+  } else {
+    return false;
+  }
+#else
+  return false;
+#endif
+}
+
+} // namespace arm
+} // namespace codegen
+} // namespace avian
@@ -0,0 +1,26 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#ifndef AVIAN_CODEGEN_ASSEMBLER_ARM_DETECT_H
+#define AVIAN_CODEGEN_ASSEMBLER_ARM_DETECT_H
+
+namespace avian {
+namespace codegen {
+namespace arm {
+
+class ArchitectureContext;
+
+bool vfpSupported(ArchitectureContext* c);
+
+} // namespace arm
+} // namespace codegen
+} // namespace avian
+
+#endif // AVIAN_CODEGEN_ASSEMBLER_ARM_DETECT_H
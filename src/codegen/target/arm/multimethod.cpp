@@ -61,6 +61,7 @@ void populateTables(ArchitectureContext* con) {
   zo[lir::LoadBarrier] = memoryBarrier;
   zo[lir::StoreStoreBarrier] = memoryBarrier;
   zo[lir::StoreLoadBarrier] = memoryBarrier;
+  zo[lir::AlignLoop] = ignore;
   zo[lir::Trap] = trap;
 
   uo[Multimethod::index(lir::LongCall, C)] = CAST1(longCallC);
@@ -95,6 +96,7 @@ void populateTables(ArchitectureContext* con) {
   bo[index(con, lir::MoveZ, C, R)] = CAST2(moveCR);
 
   bo[index(con, lir::Negate, R, R)] = CAST2(negateRR);
+  bo[index(con, lir::LeadingZeros, R, R)] = CAST2(leadingZerosRR);
 
   bo[index(con, lir::FloatAbsolute, R, R)] = CAST2(floatAbsoluteRR);
   bo[index(con, lir::FloatNegate, R, R)] = CAST2(floatNegateRR);
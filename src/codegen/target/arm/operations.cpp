@@ -428,6 +428,11 @@ void multiplyR(Context* con, unsigned size, lir::Register* a, lir::Register* b,
   }
 }
 
+void leadingZerosRR(Context* con, unsigned size UNUSED, lir::Register* a, unsigned, lir::Register* b) {
+  assert(con, size == 4);
+  emit(con, clz(b->low, a->low));
+}
+
 void floatAbsoluteRR(Context* con, unsigned size, lir::Register* a, unsigned, lir::Register* b) {
   if (size == 8) {
     emit(con, fabsd(fpr64(b), fpr64(a)));
@@ -1230,6 +1235,8 @@ void trap(Context* con)
 
 void memoryBarrier(Context*) {}
 
+void ignore(Context*) {}
+
 } // namespace arm
 } // namespace codegen
 } // namespace avian
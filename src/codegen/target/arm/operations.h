@@ -109,6 +109,8 @@ void subC(Context* con, unsigned size, lir::Constant* a,
 
 void multiplyR(Context* con, unsigned size, lir::Register* a, lir::Register* b, lir::Register* t);
 
+void leadingZerosRR(Context* con, unsigned size, lir::Register* a, unsigned, lir::Register* b);
+
 void floatAbsoluteRR(Context* con, unsigned size, lir::Register* a, unsigned, lir::Register* b);
 
 void floatNegateRR(Context* con, unsigned size, lir::Register* a, unsigned, lir::Register* b);
@@ -232,6 +234,8 @@ void trap(Context* con);
 
 void memoryBarrier(Context*);
 
+void ignore(Context*);
+
 } // namespace arm
 } // namespace codegen
 } // namespace avian
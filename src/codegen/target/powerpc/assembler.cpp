@@ -456,8 +456,14 @@ class MyArchitecture: public Architecture {
       break;
 
     case lir::Absolute:
+    case lir::PopCount:
+    case lir::LeadingZeros:
+    case lir::TrailingZeros:
+    case lir::ByteSwap:
     case lir::FloatAbsolute:
     case lir::FloatSquareRoot:
+    case lir::FloatFloor:
+    case lir::FloatCeiling:
     case lir::FloatNegate:
     case lir::Float2Float:
     case lir::Float2Int:
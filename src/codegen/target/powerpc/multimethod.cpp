@@ -63,6 +63,7 @@ void populateTables(ArchitectureContext* c) {
   zo[lir::LoadBarrier] = memoryBarrier;
   zo[lir::StoreStoreBarrier] = memoryBarrier;
   zo[lir::StoreLoadBarrier] = memoryBarrier;
+  zo[lir::AlignLoop] = ignore;
   zo[lir::Trap] = trap;
 
   uo[Multimethod::index(lir::LongCall, C)] = CAST1(longCallC);
@@ -1092,6 +1092,8 @@ void memoryBarrier(Context* c) {
   emit(c, sync(0));
 }
 
+void ignore(Context*) { }
+
 } // namespace powerpc
 } // namespace codegen
 } // namespace avian
@@ -190,6 +190,8 @@ void trap(Context* c);
 
 void memoryBarrier(Context* c);
 
+void ignore(Context* c);
+
 } // namespace powerpc
 } // namespace codegen
 } // namespace avian
@@ -9,6 +9,7 @@
    details. */
 
 #include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "avian/environment.h"
@@ -51,6 +52,8 @@ namespace avian {
 namespace codegen {
 namespace x86 {
 
+const bool DebugPeephole = false;
+
 const unsigned FrameHeaderSize = (UseFramePointer ? 2 : 1);
 
 const unsigned StackAlignmentInBytes = 16;
@@ -400,10 +403,16 @@ class MyArchitecture: public Architecture {
     case lir::FloatAbsolute:
     case lir::FloatNegate:
     case lir::FloatSquareRoot:
+    case lir::FloatFloor:
+    case lir::FloatCeiling:
+    case lir::PopCount:
+    case lir::LeadingZeros:
+    case lir::TrailingZeros:
       return false;
 
     case lir::Negate:
     case lir::Absolute:
+    case lir::ByteSwap:
       return true;
 
     default:
@@ -488,6 +497,35 @@ class MyArchitecture: public Architecture {
       }
       break;
 
+    case lir::FloatFloor:
+    case lir::FloatCeiling:
+      if (useSSE41(&c)) {
+        aMask.typeMask = (1 << lir::RegisterOperand);
+        aMask.registerMask = (static_cast<uint64_t>(FloatRegisterMask) << 32)
+          | FloatRegisterMask;
+      } else {
+        *thunk = true;
+      }
+      break;
+
+    case lir::PopCount:
+      if (usePopcnt(&c) and aSize <= TargetBytesPerWord) {
+        aMask.typeMask = (1 << lir::RegisterOperand);
+      } else {
+        *thunk = true;
+      }
+      break;
+
+    case lir::LeadingZeros:
+    case lir::TrailingZeros:
+    case lir::ByteSwap:
+      if (aSize <= TargetBytesPerWord) {
+        aMask.typeMask = (1 << lir::RegisterOperand);
+      } else {
+        *thunk = true;
+      }
+      break;
+
     case lir::Float2Float:
       if (useSSE(&c)) {
         aMask.typeMask = (1 << lir::RegisterOperand) | (1 << lir::MemoryOperand);
@@ -499,12 +537,10 @@ class MyArchitecture: public Architecture {
       break;
 
     case lir::Float2Int:
-      // todo: Java requires different semantics than SSE for
-      // converting floats to integers, we we need to either use
-      // thunks or produce inline machine code which handles edge
-      // cases properly.
-      if (false and useSSE(&c) and bSize <= TargetBytesPerWord) {
-        aMask.typeMask = (1 << lir::RegisterOperand) | (1 << lir::MemoryOperand);
+      // float2IntRR fixes up NaN and out-of-range results to match
+      // Java semantics, which needs the source in a register
+      if (useSSE(&c) and bSize <= TargetBytesPerWord) {
+        aMask.typeMask = (1 << lir::RegisterOperand);
         aMask.registerMask = (static_cast<uint64_t>(FloatRegisterMask) << 32)
           | FloatRegisterMask;
       } else {
@@ -567,12 +603,21 @@ class MyArchitecture: public Architecture {
       break;
 
     case lir::Negate:
+    case lir::ByteSwap:
       bMask.typeMask = (1 << lir::RegisterOperand);
       bMask.registerMask = aMask.registerMask;
       break;
 
+    case lir::PopCount:
+    case lir::LeadingZeros:
+    case lir::TrailingZeros:
+      bMask.typeMask = (1 << lir::RegisterOperand);
+      break;
+
     case lir::FloatNegate:
     case lir::FloatSquareRoot:
+    case lir::FloatFloor:
+    case lir::FloatCeiling:
     case lir::Float2Float:
     case lir::Int2Float:
       bMask.typeMask = (1 << lir::RegisterOperand);
@@ -1089,9 +1134,10 @@ class MyAssembler: public Assembler {
 
         index += size;
 
-        while ((b->start + index + padding + p->instructionOffset)
-               % p->alignment)
-        {
+        // use the padding computed when the block was resolved, which
+        // may have been done before the destination was known
+        assert(&c, p->padding >= 0);
+        while (padding < static_cast<unsigned>(p->padding)) {
           *(dst + b->start + index + padding) = 0x90;
           ++ padding;
         }
@@ -1105,6 +1151,11 @@ class MyAssembler: public Assembler {
     for (Task* t = c.tasks; t; t = t->next) {
       t->run(&c);
     }
+
+    if (DebugPeephole and c.peepholeCount) {
+      fprintf(stderr, "peephole: %d instructions eliminated\n",
+              c.peepholeCount);
+    }
   }
 
   virtual Promise* offset(bool) {
@@ -1114,6 +1165,7 @@ class MyAssembler: public Assembler {
   virtual Block* endBlock(bool startNew) {
     MyBlock* b = c.lastBlock;
     b->size = c.code.length() - b->offset;
+    c.lastStoreRegister = lir::NoRegister;
     if (startNew) {
       c.lastBlock = new(c.zone) MyBlock(c.code.length());
     } else {
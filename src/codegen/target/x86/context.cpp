@@ -25,7 +25,8 @@ ArchitectureContext::ArchitectureContext(vm::System* s, bool useNativeFeatures):
 Context::Context(vm::System* s, vm::Allocator* a, vm::Zone* zone, ArchitectureContext* ac):
   s(s), zone(zone), client(0), code(s, a, 1024), tasks(0), result(0),
   firstBlock(new(zone) MyBlock(0)),
-  lastBlock(firstBlock), ac(ac)
+  lastBlock(firstBlock), ac(ac), lastStore(lir::NoRegister, 0),
+  lastStoreRegister(lir::NoRegister), lastStoreEnd(0), peepholeCount(0)
 { }
 
 } // namespace x86
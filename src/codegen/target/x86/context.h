@@ -86,6 +86,10 @@ class Context {
   MyBlock* firstBlock;
   MyBlock* lastBlock;
   ArchitectureContext* ac;
+  lir::Memory lastStore;
+  int lastStoreRegister;
+  unsigned lastStoreEnd;
+  unsigned peepholeCount;
 };
 
 inline avian::util::Aborter* getAborter(Context* c) {
@@ -36,6 +36,30 @@ bool useSSE(ArchitectureContext* c) {
   }
 }
 
+bool usePopcnt(ArchitectureContext* c) {
+  if (c->useNativeFeatures) {
+    static int supported = -1;
+    if (supported == -1) {
+      supported = detectFeature(0x800000, 0); // POPCNT
+    }
+    return supported;
+  } else {
+    return false;
+  }
+}
+
+bool useSSE41(ArchitectureContext* c) {
+  if (c->useNativeFeatures and useSSE(c)) {
+    static int supported = -1;
+    if (supported == -1) {
+      supported = detectFeature(0x80000, 0); // SSE 4.1
+    }
+    return supported;
+  } else {
+    return false;
+  }
+}
+
 } // namespace x86
 } // namespace codegen
 } // namespace avian
@@ -158,6 +158,11 @@ void sseMoveRR(Context* c, unsigned aSize, lir::Register* a,
   assert(c, aSize == bSize);
 
   if (isFloatReg(a) and isFloatReg(b)) {
+    if (a->low == b->low) {
+      ++ c->peepholeCount;
+      return;
+    }
+
     if (aSize == 4) {
       opcode(c, 0xf3);
       maybeRex(c, 4, a, b);
@@ -52,6 +52,10 @@ int64_t OffsetPromise::value() {
   return value_;
 }
 Promise* offsetPromise(Context* c) {
+  // anything may jump to or return to this offset, so whatever was
+  // last stored can no longer be assumed to be in a register here
+  c->lastStoreRegister = lir::NoRegister;
+
   return new(c->zone) OffsetPromise(c, c->lastBlock, c->code.length(), c->lastBlock->lastPadding);
 }
 
@@ -69,6 +69,7 @@ void populateTables(ArchitectureContext* c) {
   zo[lir::LoadBarrier] = ignore;
   zo[lir::StoreStoreBarrier] = ignore;
   zo[lir::StoreLoadBarrier] = storeLoadBarrier;
+  zo[lir::AlignLoop] = alignLoop;
   zo[lir::Trap] = trap;
 
   uo[Multimethod::index(lir::Call, C)] = CAST1(callC);
@@ -164,6 +165,13 @@ void populateTables(ArchitectureContext* c) {
   bo[index(c, lir::Absolute, R, R)] = CAST2(absoluteRR);
   bo[index(c, lir::FloatAbsolute, R, R)] = CAST2(floatAbsoluteRR);
 
+  bo[index(c, lir::PopCount, R, R)] = CAST2(popCountRR);
+  bo[index(c, lir::LeadingZeros, R, R)] = CAST2(leadingZerosRR);
+  bo[index(c, lir::TrailingZeros, R, R)] = CAST2(trailingZerosRR);
+  bo[index(c, lir::ByteSwap, R, R)] = CAST2(byteSwapRR);
+  bo[index(c, lir::FloatFloor, R, R)] = CAST2(floatFloorRR);
+  bo[index(c, lir::FloatCeiling, R, R)] = CAST2(floatCeilingRR);
+
   bro[branchIndex(c, R, R)] = CAST_BRANCH(branchRR);
   bro[branchIndex(c, C, R)] = CAST_BRANCH(branchCR);
   bro[branchIndex(c, C, M)] = CAST_BRANCH(branchCM);
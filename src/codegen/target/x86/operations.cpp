@@ -42,6 +42,10 @@ void trap(Context* c) {
 
 void ignore(Context*) { }
 
+void alignLoop(Context* c) {
+  new (c->zone) AlignmentPadding(c, 0, 16);
+}
+
 void storeLoadBarrier(Context* c) {
   if (useSSE(c->ac)) {
     // mfence:
@@ -330,6 +334,24 @@ void moveRR(Context* c, unsigned aSize, lir::Register* a,
   }
 }
 
+void rememberStore(Context* c, lir::Register* a, lir::Memory* b) {
+  c->lastStore = *b;
+  c->lastStoreRegister = a->low;
+  c->lastStoreEnd = c->code.length();
+}
+
+bool storeForwards(Context* c, lir::Memory* a, lir::Register* b) {
+  // a word load which immediately follows a word store of the same
+  // register to the same address, with no offset taken in between,
+  // would only reload the value already in that register
+  return c->lastStoreRegister == b->low
+    and c->lastStoreEnd == c->code.length()
+    and c->lastStore.base == a->base
+    and c->lastStore.offset == a->offset
+    and c->lastStore.index == a->index
+    and c->lastStore.scale == a->scale;
+}
+
 void moveMR(Context* c, unsigned aSize, lir::Memory* a,
        unsigned bSize, lir::Register* b)
 {
@@ -337,6 +359,14 @@ void moveMR(Context* c, unsigned aSize, lir::Memory* a,
     sseMoveMR(c, aSize, a, bSize, b);
     return;
   }
+
+  if (aSize == vm::TargetBytesPerWord
+      and bSize == vm::TargetBytesPerWord
+      and storeForwards(c, a, b))
+  {
+    ++ c->peepholeCount;
+    return;
+  }
   
   switch (aSize) {
   case 1:
@@ -421,6 +451,7 @@ void moveRM(Context* c, unsigned aSize, lir::Register* a,
     } else {
       opcode(c, 0x89);
       modrmSibImm(c, a, b);
+      rememberStore(c, a, b);
     }
     break;
     
@@ -429,6 +460,7 @@ void moveRM(Context* c, unsigned aSize, lir::Register* a,
       maybeRex(c, bSize, a, b);
       opcode(c, 0x89);
       modrmSibImm(c, a, b);
+      rememberStore(c, a, b);
     } else {
       lir::Register ah(a->high);
       lir::Memory bh(b->base, b->offset + 4, b->index, b->scale);
@@ -1470,6 +1502,62 @@ void float2IntRR(Context* c, unsigned aSize, lir::Register* a,
 {
   assert(c, not isFloatReg(b));
   floatRegOp(c, aSize, a, bSize, b, 0x2c);
+
+  // cvttss2si and cvttsd2si yield the minimum integer for NaN and
+  // out-of-range inputs, whereas Java wants zero for NaN and the
+  // nearest bound otherwise, so fix up that one result value
+  maybeRex(c, bSize, b);
+  opcode(c, 0x83, 0xf8 + regCode(b)); // cmp $1, b overflows iff b == min
+  c->code.append(1);
+
+  opcode(c, 0x71); // jno
+  unsigned done = c->code.length();
+  c->code.append(0);
+
+  compareFloatRR(c, aSize, a, aSize, a);
+
+  opcode(c, 0x7a); // jp
+  unsigned nan = c->code.length();
+  c->code.append(0);
+
+  // b = sign(a) - 1 with its top bit flipped, i.e. max for positive
+  // and min for negative inputs
+  if (aSize == 8) {
+    opcode(c, 0x66);
+  }
+  maybeRex(c, 4, b, a);
+  opcode(c, 0x0f, 0x50); // movmskps/movmskpd
+  modrm(c, 0xc0, a, b);
+
+  maybeRex(c, 4, b);
+  opcode(c, 0x83, 0xe0 + regCode(b)); // and $1, b
+  c->code.append(1);
+
+  maybeRex(c, bSize, b);
+  opcode(c, 0x83, 0xe8 + regCode(b)); // sub $1, b
+  c->code.append(1);
+
+  maybeRex(c, bSize, b);
+  opcode(c, 0x0f, 0xba); // btc $(bits - 1), b
+  c->code.append(0xf8 + regCode(b));
+  c->code.append(bSize * 8 - 1);
+
+  opcode(c, 0xeb); // jmp
+  unsigned end = c->code.length();
+  c->code.append(0);
+
+  int8_t offset = c->code.length() - nan - 1;
+  c->code.set(nan, &offset, 1);
+
+  maybeRex(c, 4, b, b);
+  opcode(c, 0x31); // xor b, b
+  modrm(c, 0xc0, b, b);
+
+  offset = c->code.length() - done - 1;
+  c->code.set(done, &offset, 1);
+
+  offset = c->code.length() - end - 1;
+  c->code.set(end, &offset, 1);
 }
 
 void float2IntMR(Context* c, unsigned aSize, lir::Memory* a,
@@ -1552,6 +1640,100 @@ void absoluteRR(Context* c, unsigned aSize, lir::Register* a,
   c->client->releaseTemporary(rdx);
 }
 
+void popCountRR(Context* c, unsigned aSize, lir::Register* a,
+      unsigned bSize UNUSED, lir::Register* b)
+{
+  assert(c, aSize == bSize);
+  opcode(c, 0xf3);
+  maybeRex(c, aSize, b, a);
+  opcode(c, 0x0f, 0xb8); // popcnt
+  modrm(c, 0xc0, a, b);
+}
+
+void leadingZerosRR(Context* c, unsigned aSize, lir::Register* a,
+      unsigned bSize UNUSED, lir::Register* b)
+{
+  assert(c, aSize == bSize);
+
+  // unlike lzcnt, which not every processor has, bsr yields the index
+  // of the highest set bit, which xor turns into the count we want
+  maybeRex(c, aSize, b, a);
+  opcode(c, 0x0f, 0xbd); // bsr
+  modrm(c, 0xc0, a, b);
+
+  opcode(c, 0x75); // jnz
+  unsigned nonzero = c->code.length();
+  c->code.append(0);
+
+  // bsr leaves b undefined if a is zero, so load the value the xor
+  // below turns into the width of a
+  maybeRex(c, 4, b);
+  opcode(c, 0xb8 + regCode(b)); // mov $((bits * 2) - 1), b
+  c->code.append4((aSize * 16) - 1);
+
+  int8_t offset = c->code.length() - nonzero - 1;
+  c->code.set(nonzero, &offset, 1);
+
+  maybeRex(c, aSize, b);
+  opcode(c, 0x83, 0xf0 + regCode(b)); // xor $(bits - 1), b
+  c->code.append((aSize * 8) - 1);
+}
+
+void trailingZerosRR(Context* c, unsigned aSize, lir::Register* a,
+      unsigned bSize UNUSED, lir::Register* b)
+{
+  assert(c, aSize == bSize);
+
+  maybeRex(c, aSize, b, a);
+  opcode(c, 0x0f, 0xbc); // bsf
+  modrm(c, 0xc0, a, b);
+
+  opcode(c, 0x75); // jnz
+  unsigned nonzero = c->code.length();
+  c->code.append(0);
+
+  // bsf leaves b undefined if a is zero
+  maybeRex(c, 4, b);
+  opcode(c, 0xb8 + regCode(b)); // mov $bits, b
+  c->code.append4(aSize * 8);
+
+  int8_t offset = c->code.length() - nonzero - 1;
+  c->code.set(nonzero, &offset, 1);
+}
+
+void byteSwapRR(Context* c, unsigned aSize, lir::Register* a UNUSED,
+      unsigned bSize UNUSED, lir::Register* b)
+{
+  assert(c, aSize == bSize and a->low == b->low);
+  maybeRex(c, aSize, b);
+  opcode(c, 0x0f, 0xc8 + regCode(b)); // bswap
+}
+
+void floatRoundRR(Context* c, unsigned aSize, lir::Register* a,
+      lir::Register* b, uint8_t mode)
+{
+  opcode(c, 0x66);
+  maybeRex(c, 4, b, a);
+  opcode(c, 0x0f, 0x3a);
+  opcode(c, aSize == 4 ? 0x0a : 0x0b); // roundss/roundsd
+  modrm(c, 0xc0, a, b);
+  // the low bits give the rounding direction, and 8 suppresses the
+  // precision exception
+  c->code.append(mode | 8);
+}
+
+void floatFloorRR(Context* c, unsigned aSize, lir::Register* a,
+      unsigned bSize UNUSED, lir::Register* b)
+{
+  floatRoundRR(c, aSize, a, b, 1);
+}
+
+void floatCeilingRR(Context* c, unsigned aSize, lir::Register* a,
+      unsigned bSize UNUSED, lir::Register* b)
+{
+  floatRoundRR(c, aSize, a, b, 2);
+}
+
 } // namespace x86
 } // namespace codegen
 } // namespace avian
@@ -27,6 +27,8 @@ void trap(Context* c);
 
 void ignore(Context*);
 
+void alignLoop(Context* c);
+
 void storeLoadBarrier(Context* c);
 
 void callC(Context* c, unsigned size UNUSED, lir::Constant* a);
@@ -74,6 +76,10 @@ void swapRR(Context* c, unsigned aSize UNUSED, lir::Register* a,
 void moveRR(Context* c, unsigned aSize, lir::Register* a,
        UNUSED unsigned bSize, lir::Register* b);
 
+void rememberStore(Context* c, lir::Register* a, lir::Memory* b);
+
+bool storeForwards(Context* c, lir::Memory* a, lir::Register* b);
+
 void moveMR(Context* c, unsigned aSize, lir::Memory* a,
        unsigned bSize, lir::Register* b);
 
@@ -263,6 +269,24 @@ void floatAbsoluteRR(Context* c, unsigned aSize UNUSED, lir::Register* a,
 void absoluteRR(Context* c, unsigned aSize, lir::Register* a,
       unsigned bSize UNUSED, lir::Register* b UNUSED);
 
+void popCountRR(Context* c, unsigned aSize, lir::Register* a,
+      unsigned bSize UNUSED, lir::Register* b);
+
+void leadingZerosRR(Context* c, unsigned aSize, lir::Register* a,
+      unsigned bSize UNUSED, lir::Register* b);
+
+void trailingZerosRR(Context* c, unsigned aSize, lir::Register* a,
+      unsigned bSize UNUSED, lir::Register* b);
+
+void byteSwapRR(Context* c, unsigned aSize, lir::Register* a UNUSED,
+      unsigned bSize UNUSED, lir::Register* b);
+
+void floatFloorRR(Context* c, unsigned aSize, lir::Register* a,
+      unsigned bSize UNUSED, lir::Register* b);
+
+void floatCeilingRR(Context* c, unsigned aSize, lir::Register* a,
+      unsigned bSize UNUSED, lir::Register* b);
+
 } // namespace x86
 } // namespace codegen
 } // namespace avian
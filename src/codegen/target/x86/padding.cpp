@@ -19,6 +19,7 @@ namespace codegen {
 namespace x86 {
 
 AlignmentPadding::AlignmentPadding(Context* c, unsigned instructionOffset, unsigned alignment):
+  c(c),
   offset(c->code.length()),
   instructionOffset(instructionOffset),
   alignment(alignment),
@@ -42,8 +43,11 @@ padding(AlignmentPadding* p, unsigned start, unsigned offset,
     if (limit->padding == -1) {
       for (; p; p = p->next) {
         if (p->padding == -1) {
+          // align relative to the destination address if it is known,
+          // since the code itself may only be word aligned
+          uintptr_t base = reinterpret_cast<uintptr_t>(p->c->result);
           unsigned index = p->offset - offset;
-          while ((start + index + padding + p->instructionOffset)
+          while ((base + start + index + padding + p->instructionOffset)
                  % p->alignment)
           {
             ++ padding;
@@ -21,6 +21,7 @@ class AlignmentPadding {
  public:
   AlignmentPadding(Context* c, unsigned instructionOffset, unsigned alignment);
 
+  Context* c;
   unsigned offset;
   unsigned instructionOffset;
   unsigned alignment;
@@ -64,8 +64,44 @@ const unsigned MaxNativeCallFootprint = TargetBytesPerWord == 8 ? 4 : 5;
 
 const unsigned InitialZoneCapacityInBytes = 64 * 1024;
 
+// compiler zone segments each thread keeps for its next compilation
+const unsigned ZonePoolLimitInBytes = 256 * 1024;
+
+// number of released local reference cells a thread keeps for reuse
+const unsigned ReferencePoolLimit = 1024;
+
+// number of popped local frames a thread keeps for reuse
+const unsigned ReferenceFramePoolLimit = 64;
+
 const unsigned ExecutableAreaSizeInBytes = 30 * 1024 * 1024;
 
+// the code area must be small enough that any call or jump within it
+// may be encoded using an immediate offset
+#if (AVIAN_TARGET_ARCH == AVIAN_ARCH_X86_64) \
+  || (AVIAN_TARGET_ARCH == AVIAN_ARCH_X86)
+const unsigned MaximumExecutableAreaSizeInBytes = 1024 * 1024 * 1024;
+#else
+const unsigned MaximumExecutableAreaSizeInBytes = ExecutableAreaSizeInBytes;
+#endif
+
+const unsigned MaximumCompileQueueLength = 256;
+
+const unsigned InterfaceCacheSize = 4;
+
+const unsigned HandlerCacheSize = 16;
+
+const unsigned FastThrowSiteCount = 16;
+
+// return addresses remembered by each collector thread scanning
+// stacks (a power of two), and the most such threads which get a cache
+const unsigned FrameMapCacheSize = 256;
+
+const unsigned MaxFrameMapCaches = 32;
+
+// loops spanning at most this many bytes of bytecode have their heads
+// aligned, which is only worth the padding for small, hot loops
+const unsigned LoopAlignmentLimit = 128;
+
 enum Root {
   CallTable,
   MethodTree,
@@ -75,7 +111,9 @@ enum Root {
   VirtualThunks,
   ReceiveMethod,
   WindMethod,
-  RewindMethod
+  RewindMethod,
+  CompileQueue,
+  DispatchThunks
 };
 
 enum ThunkIndex {
@@ -92,7 +130,7 @@ enum ThunkIndex {
   dummyIndex
 };
 
-const unsigned RootCount = RewindMethod + 1;
+const unsigned RootCount = DispatchThunks + 1;
 
 inline bool
 isVmInvokeUnsafeStack(void* ip)
@@ -184,7 +222,8 @@ class MyThread: public Thread {
       t(t),
       link(0),
       next(t->traceContext),
-      methodIsMostRecent(false)
+      methodIsMostRecent(false),
+      sampling(false)
     {
       t->traceContext = this;
     }
@@ -194,7 +233,8 @@ class MyThread: public Thread {
       t(t),
       link(link),
       next(t->traceContext),
-      methodIsMostRecent(false)
+      methodIsMostRecent(false),
+      sampling(false)
     {
       t->traceContext = this;
     }
@@ -207,6 +247,29 @@ class MyThread: public Thread {
     void* link;
     TraceContext* next;
     bool methodIsMostRecent;
+    // true while a profiler walks the stack from a signal handler
+    // which may have interrupted the thread anywhere (see
+    // MyProcessor::sampleStack)
+    bool sampling;
+  };
+
+  // Code which uses exceptions for control flow tends to throw the
+  // same type from the same place repeatedly, so each thread
+  // remembers the handler, or lack of one, most recently found for a
+  // given return address and exception type.
+  class HandlerCacheEntry {
+   public:
+    uintptr_t ip;
+    object type;
+    void* handler;
+  };
+
+  // counts the implicit exceptions recently thrown from a given
+  // return address; see fastThrow
+  class FastThrowSite {
+   public:
+    void* ip;
+    unsigned count;
   };
 
   class ReferenceFrame {
@@ -273,10 +336,23 @@ class MyThread: public Thread {
     transition(0),
     traceContext(0),
     stackLimit(0),
+    safepoint(0),
     referenceFrame(0),
-    methodLockIsClean(true)
+    methodLockIsClean(true),
+    methodCache(0),
+    methodCacheStart(0),
+    methodCacheEnd(0),
+    methodCacheVersion(0),
+    zonePool(ZonePoolLimitInBytes),
+    referencePool(0),
+    referencePoolSize(0),
+    referenceFramePool(0),
+    referenceFramePoolSize(0)
   {
     arch->acquire();
+
+    memset(handlerCache, 0, sizeof(handlerCache));
+    memset(fastThrowSites, 0, sizeof(fastThrowSites));
   }
 
   void* ip;
@@ -299,10 +375,60 @@ class MyThread: public Thread {
   Context* transition;
   TraceContext* traceContext;
   uintptr_t stackLimit;
+  // set by another thread waiting to enter the exclusive state and
+  // polled by compiled code at backward branches and method returns
+  uintptr_t safepoint;
   ReferenceFrame* referenceFrame;
   bool methodLockIsClean;
+  object methodCache;
+  uintptr_t methodCacheStart;
+  uintptr_t methodCacheEnd;
+  unsigned methodCacheVersion;
+  Zone::Pool zonePool;
+  Reference* referencePool;
+  unsigned referencePoolSize;
+  ReferenceFrame* referenceFramePool;
+  unsigned referenceFramePoolSize;
+  HandlerCacheEntry handlerCache[HandlerCacheSize];
+  FastThrowSite fastThrowSites[FastThrowSiteCount];
 };
 
+// Local references are made and dropped at a high rate by JNI code, so
+// released cells are kept on a per-thread free list rather than going
+// back to the heap each time.
+Reference*
+newLocalReference(MyThread* t, object o)
+{
+  void* p;
+  if (t->referencePool) {
+    p = t->referencePool;
+    t->referencePool = t->referencePool->next;
+    -- t->referencePoolSize;
+  } else {
+    p = categoryAllocator(t->m, ReferenceMemory)->allocate
+      (sizeof(Reference));
+  }
+
+  return new (p) Reference(o, &(t->reference), false);
+}
+
+void
+freeLocalReference(MyThread* t, Reference* r)
+{
+  *(r->handle) = r->next;
+  if (r->next) {
+    r->next->handle = r->handle;
+  }
+
+  if (t->referencePoolSize < ReferencePoolLimit) {
+    r->next = t->referencePool;
+    t->referencePool = r;
+    ++ t->referencePoolSize;
+  } else {
+    categoryAllocator(t->m, ReferenceMemory)->free(r, sizeof(Reference));
+  }
+}
+
 void
 transition(MyThread* t, void* ip, void* stack, object continuation,
            MyThread::CallTrace* trace)
@@ -402,6 +528,15 @@ compareIpToMethodBounds(Thread* t, intptr_t ip, object method)
   }
 }
 
+unsigned&
+methodTreeVersion(MyThread* t);
+
+bool
+fastThrow(MyThread* t, void* ip);
+
+void NO_RETURN
+throwNullPointer(MyThread* t);
+
 object
 methodForIp(MyThread* t, void* ip)
 {
@@ -414,8 +549,44 @@ methodForIp(MyThread* t, void* ip)
   // compile(MyThread*, FixedAllocator*, BootContext*, object)):
   loadMemoryBarrier();
 
-  return treeQuery(t, root(t, MethodTree), reinterpret_cast<intptr_t>(ip),
-                   root(t, MethodTreeSentinal), compareIpToMethodBounds);
+  uintptr_t address = reinterpret_cast<uintptr_t>(ip);
+
+  // Stack walks tend to revisit the same method repeatedly (recursion,
+  // exceptions thrown in a loop), so each thread remembers its last
+  // hit.  The cache is only used by the thread that owns it, and not
+  // during collection: the stack of an idle or suspended thread may be
+  // walked by another, and a cached pointer written during collection
+  // could miss being visited.  Nor is it used by a profiler's signal
+  // handler, which may have interrupted the thread updating it.
+  bool useCache = (not t->m->collecting)
+    and t->m->localThread->get() == t
+    and not (t->traceContext and t->traceContext->sampling);
+
+  // read the version before querying the tree so a concurrent
+  // treeUpdate can't leave us caching a stale entry as current
+  unsigned version = methodTreeVersion(t);
+
+  if (useCache
+      and t->methodCache
+      and t->methodCacheVersion == version
+      and address >= t->methodCacheStart
+      and address < t->methodCacheEnd)
+  {
+    return t->methodCache;
+  }
+
+  object method = treeQuery
+    (t, root(t, MethodTree), reinterpret_cast<intptr_t>(ip),
+     root(t, MethodTreeSentinal), compareIpToMethodBounds);
+
+  if (useCache and method) {
+    t->methodCache = method;
+    t->methodCacheStart = methodCompiled(t, method);
+    t->methodCacheEnd = t->methodCacheStart + methodCompiledSize(t, method);
+    t->methodCacheVersion = version;
+  }
+
+  return method;
 }
 
 unsigned
@@ -872,6 +1043,7 @@ class TraceElement: public avian::codegen::TraceHandler {
   static const unsigned VirtualCall = 1 << 0;
   static const unsigned TailCall    = 1 << 1;
   static const unsigned LongCall    = 1 << 2;
+  static const unsigned Devirtualized = 1 << 3;
 
   TraceElement(Context* context, unsigned ip, object target, unsigned flags,
                TraceElement* next, unsigned mapSize):
@@ -970,189 +1142,939 @@ makeRootTable(MyThread* t, Zone* zone, object method)
   return table;
 }
 
-enum Thunk {
-#define THUNK(s) s##Thunk,
+unsigned
+instructionLength(MyThread* t, object code, unsigned ip)
+{
+  switch (codeBody(t, code, ip)) {
+  case aload: case astore: case bipush: case dload: case dstore:
+  case fload: case fstore: case iload: case istore: case ldc:
+  case lload: case lstore: case newarray:
+    return 2;
+
+  case anewarray: case checkcast: case getfield: case getstatic:
+  case goto_: case if_acmpeq: case if_acmpne: case if_icmpeq:
+  case if_icmpge: case if_icmpgt: case if_icmple: case if_icmplt:
+  case if_icmpne: case ifeq: case ifge: case ifgt: case ifle: case iflt:
+  case ifne: case ifnonnull: case ifnull: case iinc: case instanceof:
+  case invokespecial: case invokestatic: case invokevirtual: case ldc_w:
+  case ldc2_w: case new_: case putfield: case putstatic: case sipush:
+    return 3;
+
+  case multianewarray:
+    return 4;
 
-#include "thunks.cpp"
+  case goto_w: case invokeinterface:
+    return 5;
 
-#undef THUNK
-};
+  case tableswitch: {
+    unsigned index = ((ip + 1) + 3) & ~3;
+    index += 4;
+    int32_t bottom = codeReadInt32(t, code, index);
+    int32_t top = codeReadInt32(t, code, index);
+    return (index - ip) + ((top - bottom + 1) * 4);
+  }
 
-const unsigned ThunkCount = gcIfNecessaryThunk + 1;
+  case lookupswitch: {
+    unsigned index = ((ip + 1) + 3) & ~3;
+    index += 4;
+    int32_t pairCount = codeReadInt32(t, code, index);
+    return (index - ip) + (pairCount * 8);
+  }
 
-intptr_t
-getThunk(MyThread* t, Thunk thunk);
+  case wide:
+    return codeBody(t, code, ip + 1) == iinc ? 6 : 4;
 
-class BootContext {
- public:
-  class MyProtector: public Thread::Protector {
-   public:
-    MyProtector(Thread* t, BootContext* c): Protector(t), c(c) { }
+  case jsr: case jsr_w: case ret:
+    // subroutines may be compiled more than once, so we don't try to
+    // reason about them
+    return 0;
 
-    virtual void visit(Heap::Visitor* v) {
-      v->visit(&(c->constants));
-      v->visit(&(c->calls));
-    }
+  default:
+    return 1;
+  }
+}
 
-    BootContext* c;
-  };
+const uint8_t InstructionStartFlag = 1 << 0;
+const uint8_t BranchTargetFlag = 1 << 1;
+const uint8_t HandlerStartFlag = 1 << 2;
 
-  BootContext(Thread* t, object constants, object calls,
-              avian::codegen::DelayedPromise* addresses, Zone* zone, OffsetResolver* resolver):
-    protector(t, this), constants(constants), calls(calls),
-    addresses(addresses), addressSentinal(addresses), zone(zone),
-    resolver(resolver)
-  { }
+// Calls visit for each destination of the branch or switch at ip.
+template <class Visitor>
+void
+visitBranchTargets(MyThread* t, object code, unsigned ip, Visitor* visitor)
+{
+  unsigned instruction = codeBody(t, code, ip);
+  unsigned index = ip + 1;
+  switch (instruction) {
+  case goto_: case if_acmpeq: case if_acmpne: case if_icmpeq:
+  case if_icmpge: case if_icmpgt: case if_icmple: case if_icmplt:
+  case if_icmpne: case ifeq: case ifge: case ifgt: case ifle: case iflt:
+  case ifne: case ifnonnull: case ifnull:
+    visitor->visit(ip, ip + static_cast<int16_t>
+                   (codeReadInt16(t, code, index)));
+    break;
 
-  MyProtector protector;
-  object constants;
-  object calls;
-  avian::codegen::DelayedPromise* addresses;
-  avian::codegen::DelayedPromise* addressSentinal;
-  Zone* zone;
-  OffsetResolver* resolver;
-};
+  case goto_w:
+    visitor->visit(ip, ip + codeReadInt32(t, code, index));
+    break;
 
-class Context {
- public:
-  class MyResource: public Thread::Resource {
-   public:
-    MyResource(Context* c): Resource(c->thread), c(c) { }
+  case tableswitch:
+  case lookupswitch: {
+    index = (index + 3) & ~3;
+    visitor->visit(ip, ip + codeReadInt32(t, code, index));
 
-    virtual void release() {
-      c->dispose();
+    unsigned count;
+    unsigned stride;
+    if (instruction == tableswitch) {
+      int32_t bottom = codeReadInt32(t, code, index);
+      int32_t top = codeReadInt32(t, code, index);
+      count = top - bottom + 1;
+      stride = 0;
+    } else {
+      count = codeReadInt32(t, code, index);
+      stride = 4;
     }
 
-    Context* c;
-  };
+    for (unsigned i = 0; i < count; ++i) {
+      index += stride;
+      visitor->visit(ip, ip + codeReadInt32(t, code, index));
+    }
+  } break;
 
-  class MyProtector: public Thread::Protector {
-   public:
-    MyProtector(Context* c): Protector(c->thread), c(c) { }
+  default: break;
+  }
+}
 
-    virtual void visit(Heap::Visitor* v) {
-      v->visit(&(c->method));
+class TargetMarker {
+ public:
+  TargetMarker(uint8_t* flags): flags(flags) { }
 
-      for (PoolElement* p = c->objectPool; p; p = p->next) {
-        v->visit(&(p->target));
-      }
+  void visit(unsigned, unsigned to) {
+    flags[to] |= BranchTargetFlag;
+  }
 
-      for (TraceElement* p = c->traceLog; p; p = p->next) {
-        v->visit(&(p->target));
-      }
-    }
+  uint8_t* flags;
+};
 
-    Context* c;
-  };
+// Checks that no branch outside [start, end) lands inside it and that
+// every branch inside it is a forward one, with the exception of the
+// loop's own test and back edge.
+class LoopChecker {
+ public:
+  LoopChecker(unsigned start, unsigned end):
+    start(start), end(end), ok(true)
+  { }
 
-  class MyClient: public Compiler::Client {
-   public:
-    MyClient(MyThread* t): t(t) { }
+  void visit(unsigned from, unsigned to) {
+    if (from >= start and from < end) {
+      ok = ok and to > from;
+    } else {
+      ok = ok and (to < start or to >= end);
+    }
+  }
 
-    virtual intptr_t getThunk(avian::codegen::lir::UnaryOperation, unsigned) {
-      abort(t);
+  unsigned start;
+  unsigned end;
+  bool ok;
+};
+
+bool
+forwardOnly(MyThread* t, object code, unsigned start, unsigned end,
+            unsigned testIp, unsigned backIp)
+{
+  LoopChecker checker(start, end);
+  for (unsigned ip = 0; checker.ok and ip < codeLength(t, code);) {
+    if (ip != testIp and ip != backIp) {
+      visitBranchTargets(t, code, ip, &checker);
     }
-    
-    virtual intptr_t getThunk(avian::codegen::lir::BinaryOperation op, unsigned size,
-                              unsigned resultSize)
-    {
-      if (size == 8) {
-        switch(op) {
-        case avian::codegen::lir::Absolute:
-          assert(t, resultSize == 8);
-          return local::getThunk(t, absoluteLongThunk);
+    ip += instructionLength(t, code, ip);
+  }
 
-        case avian::codegen::lir::FloatNegate:
-          assert(t, resultSize == 8);
-          return local::getThunk(t, negateDoubleThunk);
+  object eht = codeExceptionHandlerTable(t, code);
+  if (eht) {
+    for (unsigned i = 0; i < exceptionHandlerTableLength(t, eht); ++i) {
+      unsigned handlerIp = exceptionHandlerIp
+        (exceptionHandlerTableBody(t, eht, i));
+      if (handlerIp >= start and handlerIp < end) {
+        return false;
+      }
+    }
+  }
 
-        case avian::codegen::lir::FloatSquareRoot:
-          assert(t, resultSize == 8);
-          return local::getThunk(t, squareRootDoubleThunk);
+  return checker.ok;
+}
 
-        case avian::codegen::lir::Float2Float:
-          assert(t, resultSize == 4);
-          return local::getThunk(t, doubleToFloatThunk);
+int
+loadedLocal(MyThread* t, object code, unsigned ip, unsigned base,
+            unsigned indexed)
+{
+  unsigned instruction = codeBody(t, code, ip);
+  if (instruction >= base and instruction < base + 4) {
+    return instruction - base;
+  } else if (instruction == indexed) {
+    return codeBody(t, code, ip + 1);
+  } else {
+    return -1;
+  }
+}
 
-        case avian::codegen::lir::Float2Int:
-          if (resultSize == 8) {
-            return local::getThunk(t, doubleToLongThunk);
-          } else {
-            assert(t, resultSize == 4);
-            return local::getThunk(t, doubleToIntThunk);
-          }
+// Returns the index of the local written by the instruction at ip if
+// it is an int or reference store or an increment, or -1 otherwise.
+// The amount of an increment is returned via the increment parameter.
+int
+storedLocal(MyThread* t, object code, unsigned ip, int* increment)
+{
+  *increment = 0;
 
-        case avian::codegen::lir::Int2Float:
-          if (resultSize == 8) {
-            return local::getThunk(t, longToDoubleThunk);
-          } else {
-            assert(t, resultSize == 4);
-            return local::getThunk(t, longToFloatThunk);
-          }
-          
-        default: abort(t);
-        }
-      } else {
-        assert(t, size == 4);
+  unsigned instruction = codeBody(t, code, ip);
+  switch (instruction) {
+  case istore: case astore:
+    return codeBody(t, code, ip + 1);
 
-        switch(op) {
-        case avian::codegen::lir::Absolute:
-          assert(t, resultSize == 4);
-          return local::getThunk(t, absoluteIntThunk);
+  case istore_0: case istore_1: case istore_2: case istore_3:
+    return instruction - istore_0;
 
-        case avian::codegen::lir::FloatNegate:
-          assert(t, resultSize == 4);
-          return local::getThunk(t, negateFloatThunk);
+  case astore_0: case astore_1: case astore_2: case astore_3:
+    return instruction - astore_0;
 
-        case avian::codegen::lir::FloatAbsolute:
-          assert(t, resultSize == 4);
-          return local::getThunk(t, absoluteFloatThunk);
+  case iinc:
+    *increment = static_cast<int8_t>(codeBody(t, code, ip + 2));
+    return codeBody(t, code, ip + 1);
 
-        case avian::codegen::lir::Float2Float:
-          assert(t, resultSize == 8);
-          return local::getThunk(t, floatToDoubleThunk);
+  case wide: {
+    unsigned index = ip + 2;
+    unsigned local = codeReadInt16(t, code, index);
+    switch (codeBody(t, code, ip + 1)) {
+    case istore: case astore:
+      return local;
 
-        case avian::codegen::lir::Float2Int:
-          if (resultSize == 4) {
-            return local::getThunk(t, floatToIntThunk);
-          } else {
-            assert(t, resultSize == 8);
-            return local::getThunk(t, floatToLongThunk);
-          }
+    case iinc:
+      *increment = static_cast<int16_t>(codeReadInt16(t, code, index));
+      return local;
 
-        case avian::codegen::lir::Int2Float:
-          if (resultSize == 4) {
-            return local::getThunk(t, intToFloatThunk);
-          } else {
-            assert(t, resultSize == 8);
-            return local::getThunk(t, intToDoubleThunk);
-          }
-          
-        default: abort(t);
-        }
-      }
+    default:
+      return -1;
     }
+  }
 
-    virtual intptr_t getThunk(avian::codegen::lir::TernaryOperation op, unsigned size, unsigned,
-                              bool* threadParameter)
-    {
-      *threadParameter = false;
-
-      if (size == 8) {
-        switch (op) {
-        case avian::codegen::lir::Divide:
-          *threadParameter = true;
-          return local::getThunk(t, divideLongThunk);
+  default:
+    return -1;
+  }
+}
 
-        case avian::codegen::lir::Remainder:
-          *threadParameter = true;
-          return local::getThunk(t, moduloLongThunk);
+bool
+isArrayLoad(unsigned instruction)
+{
+  switch (instruction) {
+  case aaload: case baload: case caload: case daload: case faload:
+  case iaload: case laload: case saload:
+    return true;
 
-        case avian::codegen::lir::FloatAdd:
-          return local::getThunk(t, addDoubleThunk);
+  default:
+    return false;
+  }
+}
 
-        case avian::codegen::lir::FloatSubtract:
-          return local::getThunk(t, subtractDoubleThunk);
+bool
+isArrayStore(unsigned instruction)
+{
+  switch (instruction) {
+  case aastore: case bastore: case castore: case dastore: case fastore:
+  case iastore: case lastore: case sastore:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+bool
+isSimplePush(unsigned instruction)
+{
+  return (instruction >= aconst_null and instruction <= sipush)
+    or (instruction >= iload and instruction <= aload_3);
+}
+
+unsigned
+previousInstruction(uint8_t* flags, unsigned ip)
+{
+  do {
+    -- ip;
+  } while ((flags[ip] & InstructionStartFlag) == 0);
+
+  return ip;
+}
+
+void
+markRedundantBoundsChecks(MyThread* t, object code, uint8_t* flags,
+                          uint8_t* table, unsigned start, unsigned end,
+                          int index, int array)
+{
+  // i is only incremented after its last use in the body and every
+  // branch inside the loop is a forward one, so wherever we see
+  // array[i] before the increment, 0 <= i < array.length holds
+  for (unsigned ip = start; ip < end; ip += instructionLength(t, code, ip)) {
+    int increment;
+    if (storedLocal(t, code, ip, &increment) == index) {
+      return;
+    }
+
+    unsigned instruction = codeBody(t, code, ip);
+    unsigned operands;
+    if (isArrayLoad(instruction)) {
+      operands = 2;
+    } else if (isArrayStore(instruction)) {
+      operands = 3;
+    } else {
+      continue;
+    }
+
+    // the operands must be pushed by the instructions immediately
+    // preceding this one, none of which may be reached by a branch
+    unsigned p[3];
+    unsigned next = ip;
+    bool ok = true;
+    for (unsigned i = 0; ok and i < operands; ++i) {
+      if (next <= start or (flags[next] & BranchTargetFlag)) {
+        ok = false;
+      } else {
+        next = p[i] = previousInstruction(flags, next);
+      }
+    }
+
+    if (ok
+        and (operands == 2 or isSimplePush(codeBody(t, code, p[0])))
+        and loadedLocal(t, code, p[operands - 2], iload_0, iload) == index
+        and loadedLocal(t, code, p[operands - 1], aload_0, aload) == array)
+    {
+      table[ip] = 1;
+    }
+  }
+}
+
+bool
+isIntStore(unsigned instruction)
+{
+  return instruction == istore
+    or (instruction >= istore_0 and instruction <= istore_3);
+}
+
+void
+findRedundantBoundsChecks(MyThread* t, object code, uint8_t* flags,
+                          uint8_t* table)
+{
+  unsigned length = codeLength(t, code);
+  for (unsigned ip = 0; ip < length; ip += instructionLength(t, code, ip)) {
+    unsigned instruction = codeBody(t, code, ip);
+    if (not (instruction == if_icmpge or instruction == if_icmplt)) {
+      continue;
+    }
+
+    // match "iload i; aload array; arraylength; if_icmp{ge,lt} target"
+    unsigned p[3];
+    unsigned next = ip;
+    for (unsigned i = 0; i < 3; ++i) {
+      next = p[i] = (next ? previousInstruction(flags, next) : 0);
+    }
+
+    if (p[2] == p[1] or codeBody(t, code, p[0]) != arraylength) {
+      continue;
+    }
+
+    int array = loadedLocal(t, code, p[1], aload_0, aload);
+    int index = loadedLocal(t, code, p[2], iload_0, iload);
+    if (array < 0 or index < 0) {
+      continue;
+    }
+
+    unsigned head = p[2];
+    unsigned offsetIp = ip + 1;
+    unsigned target = ip + static_cast<int16_t>
+      (codeReadInt16(t, code, offsetIp));
+    unsigned testEnd = ip + 3;
+
+    unsigned backIp;
+    unsigned loopStart;
+    unsigned loopEnd;
+    unsigned bodyStart;
+    unsigned bodyEnd;
+    if (instruction == if_icmpge and target > testEnd) {
+      // test at the top, exiting to target, and a goto back to the
+      // test at the bottom
+      backIp = previousInstruction(flags, target);
+      loopStart = head;
+      loopEnd = target;
+      bodyStart = testEnd;
+      bodyEnd = backIp;
+    } else if (instruction == if_icmplt and target > 0 and target < head) {
+      // a goto to the test at the bottom, which branches back to the
+      // top of the body
+      backIp = previousInstruction(flags, target);
+      loopStart = backIp;
+      loopEnd = testEnd;
+      bodyStart = target;
+      bodyEnd = head;
+    } else {
+      continue;
+    }
+
+    unsigned backOffsetIp = backIp + 1;
+    if (codeBody(t, code, backIp) != goto_
+        or backIp + static_cast<int16_t>
+        (codeReadInt16(t, code, backOffsetIp)) != head)
+    {
+      continue;
+    }
+
+    // i must be set to zero immediately before entering the loop
+    if (loopStart == 0) {
+      continue;
+    }
+
+    unsigned storeIp = previousInstruction(flags, loopStart);
+    int increment;
+    if (storeIp == 0
+        or not isIntStore(codeBody(t, code, storeIp))
+        or storedLocal(t, code, storeIp, &increment) != index
+        or codeBody(t, code, previousInstruction(flags, storeIp)) != iconst_0)
+    {
+      continue;
+    }
+
+    // the only write to i in the loop must be a single "i++", and
+    // array must not be written at all
+    unsigned incrementCount = 0;
+    bool clean = true;
+    for (unsigned i = loopStart; clean and i < loopEnd;
+         i += instructionLength(t, code, i))
+    {
+      int local = storedLocal(t, code, i, &increment);
+      if (local == array) {
+        clean = false;
+      } else if (local == index) {
+        if (increment == 1 and i >= bodyStart and i < bodyEnd) {
+          ++ incrementCount;
+        } else {
+          clean = false;
+        }
+      }
+    }
+
+    // the store which initializes i is included in the range checked
+    // here so that nothing can branch to it with another value
+    if (clean and incrementCount == 1
+        and forwardOnly(t, code, storeIp, loopEnd, ip, backIp))
+    {
+      markRedundantBoundsChecks
+        (t, code, flags, table, bodyStart, bodyEnd, index, array);
+    }
+  }
+}
+
+// Returns true if the specified method runs no more than once, as a
+// static initializer does.  Compiling such a method as quickly as
+// possible matters more than the speed of the result, so the analyses
+// below which only pay off over many runs are skipped for it.
+bool
+runsOnce(MyThread* t, object method)
+{
+  return (methodVmFlags(t, method) & ClassInitFlag) != 0;
+}
+
+// Returns a table with a nonzero entry for each array load or store
+// instruction which is known not to need a bounds check.
+uint8_t*
+makeBoundsCheckTable(MyThread* t, Zone* zone, object method)
+{
+  object code = methodCode(t, method);
+  unsigned length = codeLength(t, code);
+
+  uint8_t* table = static_cast<uint8_t*>(zone->allocate(length * 2));
+  memset(table, 0, length * 2);
+
+  if (runsOnce(t, method)) {
+    return table;
+  }
+
+  uint8_t* flags = table + length;
+  TargetMarker marker(flags);
+  for (unsigned ip = 0; ip < length;) {
+    unsigned size = instructionLength(t, code, ip);
+    if (size == 0) {
+      return table;
+    }
+
+    flags[ip] |= InstructionStartFlag;
+    visitBranchTargets(t, code, ip, &marker);
+    ip += size;
+  }
+
+  object eht = codeExceptionHandlerTable(t, code);
+  if (eht) {
+    for (unsigned i = 0; i < exceptionHandlerTableLength(t, eht); ++i) {
+      flags[exceptionHandlerIp(exceptionHandlerTableBody(t, eht, i))]
+        |= BranchTargetFlag;
+    }
+  }
+
+  findRedundantBoundsChecks(t, code, flags, table);
+
+  return table;
+}
+
+bool
+fallsThrough(unsigned instruction)
+{
+  switch (instruction) {
+  case goto_: case goto_w: case athrow: case tableswitch: case lookupswitch:
+  case areturn: case dreturn: case freturn: case ireturn: case lreturn:
+  case return_:
+    return false;
+
+  default:
+    return true;
+  }
+}
+
+bool
+isConditionalBranch(unsigned instruction)
+{
+  return (instruction >= ifeq and instruction <= if_acmpne)
+    or instruction == ifnull or instruction == ifnonnull;
+}
+
+unsigned
+invertedBranch(MyThread* t, unsigned instruction)
+{
+  switch (instruction) {
+  case ifeq: return ifne;
+  case ifne: return ifeq;
+  case iflt: return ifge;
+  case ifge: return iflt;
+  case ifgt: return ifle;
+  case ifle: return ifgt;
+  case if_icmpeq: return if_icmpne;
+  case if_icmpne: return if_icmpeq;
+  case if_icmplt: return if_icmpge;
+  case if_icmpge: return if_icmplt;
+  case if_icmpgt: return if_icmple;
+  case if_icmple: return if_icmpgt;
+  case if_acmpeq: return if_acmpne;
+  case if_acmpne: return if_acmpeq;
+  case ifnull: return ifnonnull;
+  case ifnonnull: return ifnull;
+  default: abort(t);
+  }
+}
+
+// Returns the end of the cold range starting with the exception
+// handler at ip, or zero if it can't be moved out of line.  The range
+// must not be entered except through the handler or be left by
+// falling through.
+unsigned
+coldHandlerEnd(MyThread* t, object code, uint8_t* flags, unsigned ip)
+{
+  if (ip == 0 or fallsThrough
+      (codeBody(t, code, previousInstruction(flags, ip))))
+  {
+    return 0;
+  }
+
+  unsigned length = codeLength(t, code);
+  for (unsigned p = ip; p < length; p += instructionLength(t, code, p)) {
+    if (p > ip and (flags[p] & (BranchTargetFlag | HandlerStartFlag))) {
+      return 0;
+    } else if (not fallsThrough(codeBody(t, code, p))) {
+      return p + instructionLength(t, code, p);
+    }
+  }
+
+  return 0;
+}
+
+// Returns the end of the cold range which follows the conditional
+// branch at ip, or zero if there is none.  This is the pattern javac
+// generates for "if (x) throw ...": a forward branch around a
+// sequence ending in athrow which nothing else branches into.  The
+// branch is inverted when compiled, so the code at its target becomes
+// the fall-through path.
+unsigned
+coldThrowEnd(MyThread* t, object code, uint8_t* flags, unsigned ip)
+{
+  if (ip > 0) {
+    switch (codeBody(t, code, previousInstruction(flags, ip))) {
+    case lcmp: case fcmpl: case fcmpg: case dcmpl: case dcmpg:
+      // these are fused with the branch, which is then not inverted
+      return 0;
+
+    default: break;
+    }
+  }
+
+  unsigned index = ip + 1;
+  unsigned newIp = ip + static_cast<int16_t>(codeReadInt16(t, code, index));
+  if (newIp <= ip + 3 or (flags[newIp] & HandlerStartFlag)) {
+    return 0;
+  }
+
+  unsigned last = 0;
+  for (unsigned p = ip + 3; p < newIp; p += instructionLength(t, code, p)) {
+    if (flags[p] & (BranchTargetFlag | HandlerStartFlag)) {
+      return 0;
+    }
+    last = p;
+  }
+
+  return (last + 1 == newIp and codeBody(t, code, last) == athrow)
+    ? newIp : 0;
+}
+
+// Returns a table with a nonzero entry for each byte of code which is
+// expected to run rarely (exception handlers and code leading to an
+// athrow) and may be laid out after the rest of the method, or null
+// if there is no such code.
+uint8_t*
+makeColdTable(MyThread* t, Zone* zone, object method)
+{
+  if (runsOnce(t, method)) {
+    return 0;
+  }
+
+  object code = methodCode(t, method);
+  unsigned length = codeLength(t, code);
+
+  uint8_t* table = static_cast<uint8_t*>(zone->allocate(length * 2));
+  memset(table, 0, length * 2);
+
+  uint8_t* flags = table + length;
+  TargetMarker marker(flags);
+  for (unsigned ip = 0; ip < length;) {
+    unsigned size = instructionLength(t, code, ip);
+    if (size == 0) {
+      return 0;
+    }
+
+    flags[ip] |= InstructionStartFlag;
+    visitBranchTargets(t, code, ip, &marker);
+    ip += size;
+  }
+
+  object eht = codeExceptionHandlerTable(t, code);
+  unsigned handlerCount = eht ? exceptionHandlerTableLength(t, eht) : 0;
+  for (unsigned i = 0; i < handlerCount; ++i) {
+    uint64_t eh = exceptionHandlerTableBody(t, eht, i);
+    if (exceptionHandlerEnd(eh) >= length) {
+      // the end of such a range is translated to the end of the
+      // method's machine code, which would take in any cold code
+      return 0;
+    }
+
+    flags[exceptionHandlerIp(eh)] |= HandlerStartFlag;
+  }
+
+  bool found = false;
+  for (unsigned ip = 0; ip < length; ip += instructionLength(t, code, ip)) {
+    unsigned start;
+    unsigned end;
+    if (flags[ip] & HandlerStartFlag) {
+      start = ip;
+      end = coldHandlerEnd(t, code, flags, ip);
+    } else if (isConditionalBranch(codeBody(t, code, ip))) {
+      start = ip + 3;
+      end = coldThrowEnd(t, code, flags, ip);
+    } else {
+      continue;
+    }
+
+    // code covered by a try block (including one ending where the
+    // cold code starts) stays in line, so each range still maps to a
+    // single span of machine code
+    for (unsigned i = 0; end and i < handlerCount; ++i) {
+      uint64_t eh = exceptionHandlerTableBody(t, eht, i);
+      if (start <= exceptionHandlerEnd(eh)
+          and exceptionHandlerStart(eh) < end)
+      {
+        end = 0;
+      }
+    }
+
+    if (end) {
+      memset(table + start, 1, end - start);
+      found = true;
+    }
+  }
+
+  return found ? table : 0;
+}
+
+class LoopHeaderMarker {
+ public:
+  LoopHeaderMarker(uint8_t* table): table(table), found(false) { }
+
+  void visit(unsigned from, unsigned to) {
+    if (to <= from and from - to <= LoopAlignmentLimit) {
+      table[to] = 1;
+      found = true;
+    }
+  }
+
+  uint8_t* table;
+  bool found;
+};
+
+// Returns a table with a nonzero entry for each instruction which is
+// the target of the back edge of a small loop, or null if there is no
+// such instruction.
+uint8_t*
+makeLoopTable(MyThread* t, Zone* zone, object method)
+{
+  if (runsOnce(t, method)) {
+    return 0;
+  }
+
+  object code = methodCode(t, method);
+  unsigned length = codeLength(t, code);
+
+  uint8_t* table = static_cast<uint8_t*>(zone->allocate(length));
+  memset(table, 0, length);
+
+  LoopHeaderMarker marker(table);
+  for (unsigned ip = 0; ip < length;) {
+    unsigned size = instructionLength(t, code, ip);
+    if (size == 0) {
+      return 0;
+    }
+
+    visitBranchTargets(t, code, ip, &marker);
+    ip += size;
+  }
+
+  return marker.found ? table : 0;
+}
+
+enum Thunk {
+#define THUNK(s) s##Thunk,
+
+#include "thunks.cpp"
+
+#undef THUNK
+};
+
+const unsigned ThunkCount = safepointThunk + 1;
+
+intptr_t
+getThunk(MyThread* t, Thunk thunk);
+
+class BootContext {
+ public:
+  class MyProtector: public Thread::Protector {
+   public:
+    MyProtector(Thread* t, BootContext* c): Protector(t), c(c) { }
+
+    virtual void visit(Heap::Visitor* v) {
+      v->visit(&(c->constants));
+      v->visit(&(c->calls));
+    }
+
+    BootContext* c;
+  };
+
+  BootContext(Thread* t, object constants, object calls,
+              avian::codegen::DelayedPromise* addresses, Zone* zone, OffsetResolver* resolver):
+    protector(t, this), constants(constants), calls(calls),
+    addresses(addresses), addressSentinal(addresses), zone(zone),
+    resolver(resolver)
+  { }
+
+  MyProtector protector;
+  object constants;
+  object calls;
+  avian::codegen::DelayedPromise* addresses;
+  avian::codegen::DelayedPromise* addressSentinal;
+  Zone* zone;
+  OffsetResolver* resolver;
+};
+
+class Context {
+ public:
+  class MyResource: public Thread::Resource {
+   public:
+    MyResource(Context* c): Resource(c->thread), c(c) { }
+
+    virtual void release() {
+      c->dispose();
+    }
+
+    Context* c;
+  };
+
+  class MyProtector: public Thread::Protector {
+   public:
+    MyProtector(Context* c): Protector(c->thread), c(c) { }
+
+    virtual void visit(Heap::Visitor* v) {
+      v->visit(&(c->method));
+
+      for (PoolElement* p = c->objectPool; p; p = p->next) {
+        v->visit(&(p->target));
+      }
+
+      for (TraceElement* p = c->traceLog; p; p = p->next) {
+        v->visit(&(p->target));
+      }
+    }
+
+    Context* c;
+  };
+
+  class MyClient: public Compiler::Client {
+   public:
+    MyClient(MyThread* t): t(t) { }
+
+    virtual intptr_t getThunk(avian::codegen::lir::UnaryOperation, unsigned) {
+      abort(t);
+    }
+    
+    virtual intptr_t getThunk(avian::codegen::lir::BinaryOperation op, unsigned size,
+                              unsigned resultSize)
+    {
+      if (size == 8) {
+        switch(op) {
+        case avian::codegen::lir::Absolute:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, absoluteLongThunk);
+
+        case avian::codegen::lir::PopCount:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, popCountLongThunk);
+
+        case avian::codegen::lir::LeadingZeros:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, leadingZerosLongThunk);
+
+        case avian::codegen::lir::TrailingZeros:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, trailingZerosLongThunk);
+
+        case avian::codegen::lir::ByteSwap:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, byteSwapLongThunk);
+
+        case avian::codegen::lir::FloatFloor:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, floorDoubleThunk);
+
+        case avian::codegen::lir::FloatCeiling:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, ceilingDoubleThunk);
+
+        case avian::codegen::lir::FloatNegate:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, negateDoubleThunk);
+
+        case avian::codegen::lir::FloatSquareRoot:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, squareRootDoubleThunk);
+
+        case avian::codegen::lir::Float2Float:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, doubleToFloatThunk);
+
+        case avian::codegen::lir::Float2Int:
+          if (resultSize == 8) {
+            return local::getThunk(t, doubleToLongThunk);
+          } else {
+            assert(t, resultSize == 4);
+            return local::getThunk(t, doubleToIntThunk);
+          }
+
+        case avian::codegen::lir::Int2Float:
+          if (resultSize == 8) {
+            return local::getThunk(t, longToDoubleThunk);
+          } else {
+            assert(t, resultSize == 4);
+            return local::getThunk(t, longToFloatThunk);
+          }
+          
+        default: abort(t);
+        }
+      } else {
+        assert(t, size == 4);
+
+        switch(op) {
+        case avian::codegen::lir::Absolute:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, absoluteIntThunk);
+
+        case avian::codegen::lir::PopCount:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, popCountIntThunk);
+
+        case avian::codegen::lir::LeadingZeros:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, leadingZerosIntThunk);
+
+        case avian::codegen::lir::TrailingZeros:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, trailingZerosIntThunk);
+
+        case avian::codegen::lir::ByteSwap:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, byteSwapIntThunk);
+
+        case avian::codegen::lir::FloatNegate:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, negateFloatThunk);
+
+        case avian::codegen::lir::FloatAbsolute:
+          assert(t, resultSize == 4);
+          return local::getThunk(t, absoluteFloatThunk);
+
+        case avian::codegen::lir::Float2Float:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, floatToDoubleThunk);
+
+        case avian::codegen::lir::Float2Int:
+          if (resultSize == 4) {
+            return local::getThunk(t, floatToIntThunk);
+          } else {
+            assert(t, resultSize == 8);
+            return local::getThunk(t, floatToLongThunk);
+          }
+
+        case avian::codegen::lir::Int2Float:
+          if (resultSize == 4) {
+            return local::getThunk(t, intToFloatThunk);
+          } else {
+            assert(t, resultSize == 8);
+            return local::getThunk(t, intToDoubleThunk);
+          }
+          
+        default: abort(t);
+        }
+      }
+    }
+
+    virtual intptr_t getThunk(avian::codegen::lir::TernaryOperation op, unsigned size, unsigned,
+                              bool* threadParameter)
+    {
+      *threadParameter = false;
+
+      if (size == 8) {
+        switch (op) {
+        case avian::codegen::lir::Divide:
+          *threadParameter = true;
+          return local::getThunk(t, divideLongThunk);
+
+        case avian::codegen::lir::Remainder:
+          *threadParameter = true;
+          return local::getThunk(t, moduloLongThunk);
+
+        case avian::codegen::lir::FloatAdd:
+          return local::getThunk(t, addDoubleThunk);
+
+        case avian::codegen::lir::FloatSubtract:
+          return local::getThunk(t, subtractDoubleThunk);
 
         case avian::codegen::lir::FloatMultiply:
           return local::getThunk(t, multiplyDoubleThunk);
@@ -1229,7 +2151,9 @@ class Context {
 
   Context(MyThread* t, BootContext* bootContext, object method):
     thread(t),
-    zone(t->m->system, t->m->heap, InitialZoneCapacityInBytes),
+    zone(t->m->system, categoryAllocator(t->m, CompilerMemory),
+         InitialZoneCapacityInBytes,
+         &(t->zonePool)),
     assembler(t->arch->makeAssembler(t->m->heap, &zone)),
     client(t),
     compiler(makeCompiler(t->m->system, assembler, &zone, &client)),
@@ -1240,6 +2164,9 @@ class Context {
     traceLog(0),
     visitTable(makeVisitTable(t, &zone, method)),
     rootTable(makeRootTable(t, &zone, method)),
+    boundsCheckTable(makeBoundsCheckTable(t, &zone, method)),
+    coldTable(makeColdTable(t, &zone, method)),
+    loopTable(makeLoopTable(t, &zone, method)),
     subroutineTable(0),
     executableAllocator(0),
     executableStart(0),
@@ -1255,7 +2182,9 @@ class Context {
 
   Context(MyThread* t):
     thread(t),
-    zone(t->m->system, t->m->heap, InitialZoneCapacityInBytes),
+    zone(t->m->system, categoryAllocator(t->m, CompilerMemory),
+         InitialZoneCapacityInBytes,
+         &(t->zonePool)),
     assembler(t->arch->makeAssembler(t->m->heap, &zone)),
     client(t),
     compiler(0),
@@ -1266,6 +2195,9 @@ class Context {
     traceLog(0),
     visitTable(0),
     rootTable(0),
+    boundsCheckTable(0),
+    coldTable(0),
+    loopTable(0),
     subroutineTable(0),
     executableAllocator(0),
     executableStart(0),
@@ -1311,6 +2243,9 @@ class Context {
   TraceElement* traceLog;
   uint16_t* visitTable;
   uintptr_t* rootTable;
+  uint8_t* boundsCheckTable;
+  uint8_t* coldTable;
+  uint8_t* loopTable;
   Subroutine** subroutineTable;
   Allocator* executableAllocator;
   void* executableStart;
@@ -1355,6 +2290,9 @@ storeLocal(Context* context, unsigned footprint, Compiler::Operand* value,
 FixedAllocator*
 codeAllocator(MyThread* t);
 
+void
+enqueueCompile(MyThread* t, object method);
+
 class Frame {
  public:
   enum StackType {
@@ -1674,6 +2612,12 @@ class Frame {
 
     c->startLogicalIp(ip);
 
+    if (context->coldTable and context->coldTable[ip]) {
+      c->markCold(ip);
+    } else if (context->loopTable and context->loopTable[ip]) {
+      c->markLoopHeader(ip);
+    }
+
     context->eventLog.append(IpEvent);
     context->eventLog.append2(ip);
 
@@ -2019,11 +2963,27 @@ findExceptionHandler(Thread* t, object method, void* ip)
   if (t->exception) {
     object table = codeExceptionHandlerTable(t, methodCode(t, method));
     if (table) {
+      // whether the shutdown exception matches depends on its
+      // identity rather than its type, so it is never cached
+      bool useCache = t->exception != root(t, Machine::Shutdown);
+      object type = objectClass(t, t->exception);
+      MyThread::HandlerCacheEntry* entry
+        = static_cast<MyThread*>(t)->handlerCache
+        + ((reinterpret_cast<uintptr_t>(ip) >> 2) % HandlerCacheSize);
+
+      if (useCache
+          and entry->ip == reinterpret_cast<uintptr_t>(ip)
+          and entry->type == type)
+      {
+        return entry->handler;
+      }
+
       object index = arrayBody(t, table, 0);
       
       uint8_t* compiled = reinterpret_cast<uint8_t*>
         (methodCompiled(t, method));
 
+      void* handler = 0;
       for (unsigned i = 0; i < arrayLength(t, table) - 1; ++i) {
         unsigned start = intArrayBody(t, index, i * 3);
         unsigned end = intArrayBody(t, index, (i * 3) + 1);
@@ -2033,10 +2993,19 @@ findExceptionHandler(Thread* t, object method, void* ip)
           object catchType = arrayBody(t, table, i + 1);
 
           if (exceptionMatch(t, catchType, t->exception)) {
-            return compiled + intArrayBody(t, index, (i * 3) + 2);
+            handler = compiled + intArrayBody(t, index, (i * 3) + 2);
+            break;
           }
         }
       }
+
+      if (useCache) {
+        entry->ip = reinterpret_cast<uintptr_t>(ip);
+        entry->type = type;
+        entry->handler = handler;
+      }
+
+      return handler;
     }
   }
 
@@ -2164,6 +3133,11 @@ findUnwindTarget(MyThread* t, void** targetIp, void** targetFrame,
   }
 }
 
+// Only the frames on the native stack above the most recent
+// transition are copied here; everything below is already on the heap
+// as t->continuation and is simply linked to.  Frames are copied back
+// one at a time by vmInvoke as each frame returns, so the cost of a
+// capture is proportional to the frames entered since the last one.
 object
 makeCurrentContinuation(MyThread* t, void** targetIp, void** targetStack)
 {
@@ -2295,6 +3269,9 @@ stackOverflowThunk(MyThread* t);
 uintptr_t
 virtualThunk(MyThread* t, unsigned index);
 
+uintptr_t
+dispatchThunk(MyThread* t, unsigned index);
+
 bool
 unresolved(MyThread* t, uintptr_t methodAddress);
 
@@ -2355,22 +3332,84 @@ prepareMethodForCall(MyThread* t, object target)
       compile(t, codeAllocator(t), 0, target);
     }
 
-    if (methodFlags(t, target) & ACC_NATIVE) {
-      t->trace->nativeMethod = target;
-    }
+    if (methodFlags(t, target) & ACC_NATIVE) {
+      t->trace->nativeMethod = target;
+    }
+
+    return methodAddress(t, target);
+  }
+}
+
+object
+makeInterfaceCache(Thread* t, object method)
+{
+  PROTECT(t, method);
+
+  object cache = makeArray(t, 1 + (InterfaceCacheSize * 2));
+  set(t, cache, ArrayBody, method);
+
+  return cache;
+}
+
+void
+cacheInterfaceMethod(MyThread* t, object cache, object class_, object method)
+{
+  // a cache compiled into the boot image stays empty (see setCache)
+  if (objectImmutable(t, cache)) {
+    return;
+  }
+
+  PROTECT(t, cache);
+  PROTECT(t, class_);
+  PROTECT(t, method);
+
+  ACQUIRE(t, t->m->classLock);
 
-    return methodAddress(t, target);
+  // entries are never replaced once filled, so a lock-free reader
+  // which sees a class always sees the method stored with it
+  for (unsigned i = 0; i < InterfaceCacheSize; ++i) {
+    unsigned index = 1 + (i * 2);
+    object c = arrayBody(t, cache, index);
+    if (c == class_) {
+      return;
+    } else if (c == 0) {
+      set(t, cache, ArrayBody + ((index + 1) * BytesPerWord), method);
+
+      storeStoreMemoryBarrier();
+
+      set(t, cache, ArrayBody + (index * BytesPerWord), class_);
+      return;
+    }
   }
 }
 
 int64_t
-findInterfaceMethodFromInstance(MyThread* t, object method, object instance)
+findInterfaceMethodFromInstance(MyThread* t, object cache, object instance)
 {
   if (instance) {
-    return prepareMethodForCall
-      (t, findInterfaceMethod(t, method, objectClass(t, instance)));
+    object class_ = objectClass(t, instance);
+    for (unsigned i = 0; i < InterfaceCacheSize; ++i) {
+      unsigned index = 1 + (i * 2);
+      object c = arrayBody(t, cache, index);
+      if (c == class_) {
+        loadMemoryBarrier();
+
+        return prepareMethodForCall(t, arrayBody(t, cache, index + 1));
+      } else if (c == 0) {
+        break;
+      }
+    }
+
+    // either a miss or a megamorphic call site, in which case we
+    // fall back to searching the interface table every time
+    object method = findInterfaceMethod
+      (t, arrayBody(t, cache, 0), class_);
+
+    cacheInterfaceMethod(t, cache, class_, method);
+
+    return prepareMethodForCall(t, method);
   } else {
-    throwNew(t, Machine::NullPointerExceptionType);
+    throwNullPointer(t);
   }
 }
 
@@ -2382,7 +3421,12 @@ findInterfaceMethodFromInstanceAndReference
 
   object method = resolveMethod(t, pair);
 
-  return findInterfaceMethodFromInstance(t, method, instance);
+  if (instance) {
+    return prepareMethodForCall
+      (t, findInterfaceMethod(t, method, objectClass(t, instance)));
+  } else {
+    throwNullPointer(t);
+  }
 }
 
 void
@@ -2693,6 +3737,88 @@ absoluteInt(int32_t a)
   return a > 0 ? a : -a;
 }
 
+int64_t
+popCountLong(int64_t a)
+{
+  uint64_t v = a;
+  v = v - ((v >> 1) & UINT64_C(0x5555555555555555));
+  v = (v & UINT64_C(0x3333333333333333))
+    + ((v >> 2) & UINT64_C(0x3333333333333333));
+  v = (v + (v >> 4)) & UINT64_C(0x0F0F0F0F0F0F0F0F);
+  return (v * UINT64_C(0x0101010101010101)) >> 56;
+}
+
+int64_t
+popCountInt(int32_t a)
+{
+  return popCountLong(static_cast<uint32_t>(a));
+}
+
+int64_t
+leadingZerosLong(int64_t a)
+{
+  uint64_t v = a;
+  if (v == 0) {
+    return 64;
+  }
+
+  int64_t n = 0;
+  if ((v >> 32) == 0) { n += 32; v <<= 32; }
+  if ((v >> 48) == 0) { n += 16; v <<= 16; }
+  if ((v >> 56) == 0) { n +=  8; v <<=  8; }
+  if ((v >> 60) == 0) { n +=  4; v <<=  4; }
+  if ((v >> 62) == 0) { n +=  2; v <<=  2; }
+  if ((v >> 63) == 0) { n +=  1; }
+  return n;
+}
+
+int64_t
+leadingZerosInt(int32_t a)
+{
+  return leadingZerosLong(static_cast<uint32_t>(a)) - 32;
+}
+
+int64_t
+trailingZerosLong(int64_t a)
+{
+  uint64_t v = a;
+  return v == 0 ? 64 : 63 - leadingZerosLong(v & -v);
+}
+
+int64_t
+trailingZerosInt(int32_t a)
+{
+  return a == 0 ? 32 : trailingZerosLong(static_cast<uint32_t>(a));
+}
+
+int64_t
+byteSwapInt(int32_t a)
+{
+  uint32_t v = a;
+  return static_cast<int32_t>
+    ((v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24));
+}
+
+int64_t
+byteSwapLong(int64_t a)
+{
+  uint64_t v = a;
+  return (static_cast<uint64_t>(static_cast<uint32_t>(byteSwapInt(v))) << 32)
+    | static_cast<uint32_t>(byteSwapInt(v >> 32));
+}
+
+uint64_t
+floorDouble(uint64_t a)
+{
+  return doubleToBits(floor(bitsToDouble(a)));
+}
+
+uint64_t
+ceilingDouble(uint64_t a)
+{
+  return doubleToBits(ceil(bitsToDouble(a)));
+}
+
 unsigned
 traceSize(Thread* t)
 {
@@ -2715,20 +3841,38 @@ traceSize(Thread* t)
 }
 
 void NO_RETURN
-throwArithmetic(MyThread* t)
+throwImplicit(MyThread* t, Machine::Type type, Machine::Root root,
+              unsigned fixedSize)
 {
-  if (ensure(t, FixedSizeOfArithmeticException + traceSize(t))) {
+  if ((not fastThrow(t, getIp(t))) and ensure(t, fixedSize + traceSize(t))) {
     atomicOr(&(t->flags), Thread::TracingFlag);
     THREAD_RESOURCE0(t, atomicAnd(&(t->flags), ~Thread::TracingFlag));
 
-    throwNew(t, Machine::ArithmeticExceptionType); 
+    throwNew(t, type);
   } else {
-    // not enough memory available for a new exception and stack trace
+    // either this site throws too often to be worth a new exception
+    // and stack trace or there isn't enough memory available for one
     // -- use a preallocated instance instead
-    throw_(t, root(t, Machine::ArithmeticException));
+    throw_(t, vm::root(t, root));
   }
 }
 
+void NO_RETURN
+throwNullPointer(MyThread* t)
+{
+  throwImplicit(t, Machine::NullPointerExceptionType,
+                Machine::NullPointerException,
+                FixedSizeOfNullPointerException);
+}
+
+void NO_RETURN
+throwArithmetic(MyThread* t)
+{
+  throwImplicit(t, Machine::ArithmeticExceptionType,
+                Machine::ArithmeticException,
+                FixedSizeOfArithmeticException);
+}
+
 int64_t
 divideLong(MyThread* t, int64_t b, int64_t a)
 {
@@ -2918,8 +4062,163 @@ setMaybeNull(MyThread* t, object o, unsigned offset, object value)
   if (LIKELY(o)) {
     set(t, o, offset, value);
   } else {
-    throwNew(t, Machine::NullPointerExceptionType);
+    throwNullPointer(t);
+  }
+}
+
+void
+setObjectArrayElement(MyThread* t, object array, unsigned offset,
+                      object value)
+{
+  if (UNLIKELY(array == 0)) {
+    throwNullPointer(t);
+  } else if (value == 0 or LIKELY(quickArrayStoreCheck(t, array, value))) {
+    set(t, array, offset, value);
+  } else {
+    PROTECT(t, array);
+    PROTECT(t, value);
+
+    if (checkArrayStore(t, array, value)) {
+      set(t, array, offset, value);
+    } else {
+      throwNew(t, Machine::ArrayStoreExceptionType, "%s",
+               &byteArrayBody(t, className(t, objectClass(t, value)), 0));
+    }
+  }
+}
+
+uint64_t
+nanoTime64(MyThread* t)
+{
+  return t->m->system->nanoTime();
+}
+
+void
+copyArray(MyThread* t, object src, int32_t srcOffset, object dst,
+          int32_t dstOffset, int32_t length)
+{
+  arrayCopy(t, src, srcOffset, dst, dstOffset, length);
+}
+
+void
+fillByteArray(MyThread* t, object array, int32_t value)
+{
+  if (LIKELY(array)) {
+    memset(&byteArrayBody(t, array, 0), value, byteArrayLength(t, array));
+  } else {
+    throwNullPointer(t);
+  }
+}
+
+void
+fillCharArray(MyThread* t, object array, int32_t value)
+{
+  if (LIKELY(array)) {
+    uint16_t* body = &charArrayBody(t, array, 0);
+    for (unsigned i = 0, n = charArrayLength(t, array); i < n; ++i) {
+      body[i] = value;
+    }
+  } else {
+    throwNullPointer(t);
+  }
+}
+
+void
+fillIntArray(MyThread* t, object array, int32_t value)
+{
+  if (LIKELY(array)) {
+    int32_t* body = &intArrayBody(t, array, 0);
+    for (unsigned i = 0, n = intArrayLength(t, array); i < n; ++i) {
+      body[i] = value;
+    }
+  } else {
+    throwNullPointer(t);
+  }
+}
+
+// the characters of a string whose data is a char array, which may
+// be empty
+const uint16_t*
+stringCharBody(MyThread* t, object s)
+{
+  return reinterpret_cast<uint16_t*>
+    (reinterpret_cast<uint8_t*>(stringData(t, s)) + ArrayBody)
+    + stringOffset(t, s);
+}
+
+uint64_t
+equalStrings(MyThread* t, object a, object b)
+{
+  if (UNLIKELY(a == 0)) {
+    throwNullPointer(t);
+  }
+
+  return a == b
+    or (b
+        and objectClass(t, b) == objectClass(t, a)
+        and stringLength(t, b) == stringLength(t, a)
+        and memcmp(stringCharBody(t, a), stringCharBody(t, b),
+                   stringLength(t, a) * 2) == 0);
+}
+
+int64_t
+compareStrings(MyThread* t, object a, object b)
+{
+  if (UNLIKELY(a == 0 or b == 0)) {
+    throwNullPointer(t);
   }
+
+  const uint16_t* ac = stringCharBody(t, a);
+  const uint16_t* bc = stringCharBody(t, b);
+  int32_t al = stringLength(t, a);
+  int32_t bl = stringLength(t, b);
+  for (int32_t i = 0, n = (al < bl ? al : bl); i < n; ++i) {
+    if (ac[i] != bc[i]) {
+      return ac[i] - bc[i];
+    }
+  }
+  return al - bl;
+}
+
+int64_t
+indexOfChar(MyThread* t, object s, int32_t c, int32_t start)
+{
+  if (UNLIKELY(s == 0)) {
+    throwNullPointer(t);
+  }
+
+  const uint16_t* chars = stringCharBody(t, s);
+  for (int32_t i = (start < 0 ? 0 : start), n = stringLength(t, s); i < n;
+       ++i)
+  {
+    if (chars[i] == c) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+uint64_t
+compareAndSwapInt(MyThread*, object target, uintptr_t offset,
+                  int32_t expect, int32_t update)
+{
+  return atomicCompareAndSwap32
+    (&fieldAtOffset<uint32_t>(target, offset), expect, update);
+}
+
+uint64_t
+compareAndSwapWord(MyThread*, object target, uintptr_t offset,
+                   uintptr_t expect, uintptr_t update)
+{
+  return atomicCompareAndSwap
+    (&fieldAtOffset<uintptr_t>(target, offset), expect, update);
+}
+
+uint64_t
+compareAndSwapObject(MyThread* t, object target, uintptr_t offset,
+                     object expect, object update)
+{
+  return atomicCompareAndSwapObject(t, target, offset, expect, update);
 }
 
 void
@@ -2928,7 +4227,7 @@ acquireMonitorForObject(MyThread* t, object o)
   if (LIKELY(o)) {
     acquire(t, o);
   } else {
-    throwNew(t, Machine::NullPointerExceptionType);
+    throwNullPointer(t);
   }
 }
 
@@ -2940,7 +4239,7 @@ acquireMonitorForObjectOnEntrance(MyThread* t, object o)
     acquire(t, o);
     t->methodLockIsClean = true;
   } else {
-    throwNew(t, Machine::NullPointerExceptionType);
+    throwNullPointer(t);
   }
 }
 
@@ -2950,7 +4249,7 @@ releaseMonitorForObject(MyThread* t, object o)
   if (LIKELY(o)) {
     release(t, o);
   } else {
-    throwNew(t, Machine::NullPointerExceptionType);
+    throwNullPointer(t);
   }
 }
 
@@ -3002,16 +4301,9 @@ makeMultidimensionalArrayFromReference(MyThread* t, object pair,
 void NO_RETURN
 throwArrayIndexOutOfBounds(MyThread* t)
 {
-  if (ensure(t, FixedSizeOfArrayIndexOutOfBoundsException + traceSize(t))) {
-    atomicOr(&(t->flags), Thread::TracingFlag);
-    THREAD_RESOURCE0(t, atomicAnd(&(t->flags), ~Thread::TracingFlag));
-
-    throwNew(t, Machine::ArrayIndexOutOfBoundsExceptionType); 
-  } else {
-    // not enough memory available for a new exception and stack trace
-    // -- use a preallocated instance instead
-    throw_(t, root(t, Machine::ArrayIndexOutOfBoundsException));
-  }
+  throwImplicit(t, Machine::ArrayIndexOutOfBoundsExceptionType,
+                Machine::ArrayIndexOutOfBoundsException,
+                FixedSizeOfArrayIndexOutOfBoundsException);
 }
 
 void NO_RETURN
@@ -3026,7 +4318,7 @@ throw_(MyThread* t, object o)
   if (LIKELY(o)) {
     vm::throw_(t, o);
   } else {
-    throwNew(t, Machine::NullPointerExceptionType);
+    throwNullPointer(t);
   }
 }
 
@@ -3060,19 +4352,33 @@ checkCastFromReference(MyThread* t, object pair, object o)
   checkCast(t, c, o);
 }
 
+// Resolves the field a compiled access site refers to.  The pair is
+// private to the site and a reference resolves to the same field
+// every time, so the field replaces the reference in the pair, and
+// later executions of the site go straight to it.  A pair in the boot
+// image keeps the reference (see setCache).
 object
 resolveField(Thread* t, object pair)
 {
   object reference = pairSecond(t, pair);
+  if (objectClass(t, reference) == type(t, Machine::FieldType)) {
+    return reference;
+  }
+
+  PROTECT(t, pair);
   PROTECT(t, reference);
 
   object class_ = resolveClassInObject
     (t, classLoader(t, methodClass(t, pairFirst(t, pair))), reference,
      ReferenceClass);
 
-  return findInHierarchy
+  object field = findInHierarchy
     (t, class_, referenceName(t, reference), referenceSpec(t, reference),
      findFieldInClass, Machine::NoSuchFieldErrorType);
+
+  setCache(t, pair, PairSecond, field);
+
+  return field;
 }
 
 uint64_t
@@ -3093,7 +4399,7 @@ getFieldValue(Thread* t, object target, object field)
 
   case DoubleField:
   case LongField:
-    return fieldAtOffset<int64_t>(target, fieldOffset(t, field));
+    return getWideField(t, field, target);
 
   case ObjectField:
     return fieldAtOffset<intptr_t>(target, fieldOffset(t, field));
@@ -3139,8 +4445,7 @@ setStaticLongFieldValueFromReference(MyThread* t, object pair, uint64_t value)
 
   ACQUIRE_FIELD_FOR_WRITE(t, field);
 
-  fieldAtOffset<int64_t>
-    (classStaticTable(t, fieldClass(t, field)), fieldOffset(t, field)) = value;
+  setWideField(t, field, classStaticTable(t, fieldClass(t, field)), value);
 }
 
 void
@@ -3154,7 +4459,36 @@ setLongFieldValueFromReference(MyThread* t, object pair, object instance,
 
   ACQUIRE_FIELD_FOR_WRITE(t, field);
 
-  fieldAtOffset<int64_t>(instance, fieldOffset(t, field)) = value;
+  setWideField(t, field, instance, value);
+}
+
+uint64_t
+getVolatileWideField(MyThread* t, object field, object target)
+{
+  if (UNLIKELY(target == 0)) {
+    throwNew(t, Machine::NullPointerExceptionType);
+  }
+
+  PROTECT(t, target);
+
+  ACQUIRE_FIELD_FOR_READ(t, field);
+
+  return getWideField(t, field, target);
+}
+
+void
+setVolatileWideField(MyThread* t, object field, object target,
+                     uint64_t value)
+{
+  if (UNLIKELY(target == 0)) {
+    throwNew(t, Machine::NullPointerExceptionType);
+  }
+
+  PROTECT(t, target);
+
+  ACQUIRE_FIELD_FOR_WRITE(t, field);
+
+  setWideField(t, field, target, value);
 }
 
 void
@@ -3276,6 +4610,26 @@ makeNew64(Thread* t, object class_)
   return reinterpret_cast<uintptr_t>(makeNew(t, class_));
 }
 
+// whether neither class_ nor any of its superclasses has a static
+// initializer which has yet to run.  A class without one of its own
+// never has NeedInitFlag set, even while its superclass does.
+bool
+superclassesInitialized(Thread* t, object class_)
+{
+  for (object c = class_; c; c = classSuper(t, c)) {
+    if (classVmFlags(t, c) & NeedInitFlag) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t
+makeNewInitialized64(Thread* t, object class_)
+{
+  return reinterpret_cast<uintptr_t>(makeNew(t, class_));
+}
+
 uint64_t
 makeNewFromReference(Thread* t, object pair)
 {
@@ -3306,6 +4660,16 @@ gcIfNecessary(MyThread* t)
   }
 }
 
+void
+safepoint(MyThread* t)
+{
+  // clear the request before going idle so a request made while we
+  // wait isn't lost
+  t->safepoint = 0;
+
+  ENTER(t, Thread::IdleState);
+}
+
 unsigned
 resultSize(MyThread* t, unsigned code)
 {
@@ -3423,18 +4787,17 @@ useLongJump(MyThread* t, uintptr_t target)
 
 Compiler::Operand*
 compileDirectInvoke(MyThread* t, Frame* frame, object target, bool tailCall,
-                    bool useThunk, unsigned rSize, avian::codegen::Promise* addressPromise)
+                    bool useThunk, unsigned rSize, avian::codegen::Promise* addressPromise,
+                    bool devirtualized = false)
 {
   avian::codegen::Compiler* c = frame->c;
 
   unsigned flags = (avian::codegen::TailCalls and tailCall ? Compiler::TailJump : 0);
-  unsigned traceFlags;
+  unsigned traceFlags = devirtualized ? TraceElement::Devirtualized : 0;
 
   if (addressPromise == 0 and useLongJump(t, methodAddress(t, target))) {
     flags |= Compiler::LongJumpOrCall;
-    traceFlags = TraceElement::LongCall;
-  } else {
-    traceFlags = 0;
+    traceFlags |= TraceElement::LongCall;
   }
 
   if (useThunk
@@ -3533,6 +4896,11 @@ compileDirectInvoke(MyThread* t, Frame* frame, object target, bool tailCall)
     } else if (unresolved(t, methodAddress(t, target))
                or classNeedsInit(t, methodClass(t, target)))
     {
+      if (not classNeedsInit(t, methodClass(t, target))) {
+        PROTECT(t, target);
+        enqueueCompile(t, target);
+      }
+
       result = compileDirectInvoke
         (t, frame, target, tailCall, true, rSize, 0);
     } else {
@@ -3703,9 +5071,22 @@ handleEntrance(MyThread* t, Frame* frame)
     (t, frame, getThunk(t, acquireMonitorForObjectOnEntranceThunk));
 }
 
+void
+compileSafepoint(MyThread* t, Frame* frame)
+{
+  avian::codegen::Compiler* c = frame->c;
+
+  c->safepoint
+    (c->constant(getThunk(t, safepointThunk), Compiler::AddressType),
+     frame->trace(0, 0),
+     TARGET_THREAD_SAFEPOINT);
+}
+
 void
 handleExit(MyThread* t, Frame* frame)
 {
+  compileSafepoint(t, frame);
+
   handleMonitorEvent
     (t, frame, getThunk(t, releaseMonitorForObjectThunk));
 }
@@ -3807,6 +5188,24 @@ isReferenceTailCall(MyThread* t, object code, unsigned ip, object caller,
      c, referenceName(t, calleeReference), referenceSpec(t, calleeReference));
 }
 
+// Returns the target for the conditional branch which falls through
+// to ip.  If the fall-through code is cold, the branch is inverted
+// (updating *instruction) so that it jumps there instead.
+Compiler::Operand*
+branchTarget(MyThread* t, Frame* frame, unsigned ip, unsigned newIp,
+             unsigned* instruction)
+{
+  uint8_t* table = frame->context->coldTable;
+  if (table and table[ip] and not table[ip - 3]) {
+    assert(t, newIp > ip and not table[newIp]);
+
+    *instruction = invertedBranch(t, *instruction);
+    return frame->machineIp(ip);
+  } else {
+    return frame->machineIp(newIp);
+  }
+}
+
 bool
 integerBranch(MyThread* t, Frame* frame, object code, unsigned& ip,
               unsigned size, Compiler::Operand* a, Compiler::Operand* b,
@@ -3932,22 +5331,116 @@ popLongAddress(Frame* frame)
     (8, 8, frame->popLong(), TargetBytesPerWord);
 }
 
-bool
-intrinsic(MyThread* t, Frame* frame, object target)
-{
-#define MATCH(name, constant)                                           \
-  (byteArrayLength(t, name) == sizeof(constant)                         \
-   and ::strcmp(reinterpret_cast<char*>(&byteArrayBody(t, name, 0)),    \
-                constant) == 0)
+// value if swap is zero and otherwise swapped, chosen with a mask
+// rather than a branch
+Compiler::Operand*
+selectSwapped(avian::codegen::Compiler* c, unsigned size,
+              Compiler::Operand* swap, Compiler::Operand* value,
+              Compiler::Operand* swapped)
+{
+  Compiler::Operand* mask = c->neg(4, swap);
+  if (size == 8) {
+    mask = c->load(TargetBytesPerWord, 4, mask, 8);
+  }
+
+  return c->xor_
+    (size, value, c->and_(size, mask, c->xor_(size, value, swapped)));
+}
+
+bool
+intrinsic(MyThread* t, Frame* frame, object target)
+{
+#define MATCH(name, constant)                                           \
+  (byteArrayLength(t, name) == sizeof(constant)                         \
+   and ::strcmp(reinterpret_cast<char*>(&byteArrayBody(t, name, 0)),    \
+                constant) == 0)
+
+  object className = vm::className(t, methodClass(t, target));
+  if (UNLIKELY(MATCH(className, "java/lang/System"))) {
+    avian::codegen::Compiler* c = frame->c;
+    if (MATCH(methodName(t, target), "arraycopy")
+        and MATCH(methodSpec(t, target),
+                  "(Ljava/lang/Object;ILjava/lang/Object;II)V"))
+    {
+      Compiler::Operand* length = frame->popInt();
+      Compiler::Operand* dstOffset = frame->popInt();
+      Compiler::Operand* dst = frame->popObject();
+      Compiler::Operand* srcOffset = frame->popInt();
+      Compiler::Operand* src = frame->popObject();
+
+      c->call
+        (c->constant(getThunk(t, copyArrayThunk), Compiler::AddressType),
+         0,
+         frame->trace(0, 0),
+         0,
+         Compiler::VoidType,
+         6, c->register_(t->arch->thread()), src, srcOffset, dst, dstOffset,
+         length);
+      return true;
+    } else if (MATCH(methodName(t, target), "nanoTime")
+               and MATCH(methodSpec(t, target), "()J"))
+    {
+      // a direct call, skipping the native method stub, since timing
+      // loops are sensitive to what nanoTime itself costs
+      frame->pushLong
+        (c->call
+         (c->constant(getThunk(t, nanoTime64Thunk), Compiler::AddressType),
+          0,
+          0,
+          8,
+          Compiler::IntegerType,
+          1, c->register_(t->arch->thread())));
+      return true;
+    }
+  } else if (UNLIKELY(MATCH(className, "java/util/Arrays"))) {
+    avian::codegen::Compiler* c = frame->c;
+    if (MATCH(methodName(t, target), "fill")) {
+      Thunk thunk;
+      if (MATCH(methodSpec(t, target), "([BB)V")
+          or MATCH(methodSpec(t, target), "([ZZ)V"))
+      {
+        thunk = fillByteArrayThunk;
+      } else if (MATCH(methodSpec(t, target), "([CC)V")
+                 or MATCH(methodSpec(t, target), "([SS)V"))
+      {
+        thunk = fillCharArrayThunk;
+      } else if (MATCH(methodSpec(t, target), "([II)V")
+                 or MATCH(methodSpec(t, target), "([FF)V"))
+      {
+        thunk = fillIntArrayThunk;
+      } else {
+        return false;
+      }
+
+      Compiler::Operand* value = frame->popInt();
+      Compiler::Operand* array = frame->popObject();
 
-  object className = vm::className(t, methodClass(t, target));
-  if (UNLIKELY(MATCH(className, "java/lang/Math"))) {
+      c->call
+        (c->constant(getThunk(t, thunk), Compiler::AddressType),
+         0,
+         frame->trace(0, 0),
+         0,
+         Compiler::VoidType,
+         3, c->register_(t->arch->thread()), array, value);
+      return true;
+    }
+  } else if (UNLIKELY(MATCH(className, "java/lang/Math"))) {
     avian::codegen::Compiler* c = frame->c;
     if (MATCH(methodName(t, target), "sqrt")
         and MATCH(methodSpec(t, target), "(D)D"))
     {
       frame->pushLong(c->fsqrt(8, frame->popLong()));
       return true;
+    } else if (MATCH(methodName(t, target), "floor")
+               and MATCH(methodSpec(t, target), "(D)D"))
+    {
+      frame->pushLong(c->ffloor(8, frame->popLong()));
+      return true;
+    } else if (MATCH(methodName(t, target), "ceil")
+               and MATCH(methodSpec(t, target), "(D)D"))
+    {
+      frame->pushLong(c->fceil(8, frame->popLong()));
+      return true;
     } else if (MATCH(methodName(t, target), "abs")) {
       if (MATCH(methodSpec(t, target), "(I)I")) {
         frame->pushInt(c->abs(4, frame->popInt()));
@@ -3960,6 +5453,78 @@ intrinsic(MyThread* t, Frame* frame, object target)
         return true;
       }
     }
+  } else if (UNLIKELY(MATCH(className, "java/lang/Integer"))) {
+    avian::codegen::Compiler* c = frame->c;
+    if (MATCH(methodSpec(t, target), "(I)I")) {
+      if (MATCH(methodName(t, target), "bitCount")) {
+        frame->pushInt(c->popcnt(4, frame->popInt()));
+        return true;
+      } else if (MATCH(methodName(t, target), "numberOfLeadingZeros")) {
+        frame->pushInt(c->lzcnt(4, frame->popInt()));
+        return true;
+      } else if (MATCH(methodName(t, target), "numberOfTrailingZeros")) {
+        frame->pushInt(c->tzcnt(4, frame->popInt()));
+        return true;
+      } else if (MATCH(methodName(t, target), "reverseBytes")) {
+        frame->pushInt(c->bswap(4, frame->popInt()));
+        return true;
+      }
+    } else if (MATCH(methodSpec(t, target), "(II)I")) {
+      // shifts use only the low bits of the distance, so shifting the
+      // other way by its negation makes up the rest of the rotation
+      if (MATCH(methodName(t, target), "rotateLeft")) {
+        Compiler::Operand* distance = frame->popInt();
+        Compiler::Operand* value = frame->popInt();
+        frame->pushInt
+          (c->or_(4, c->shl(4, distance, value),
+                  c->ushr(4, c->neg(4, distance), value)));
+        return true;
+      } else if (MATCH(methodName(t, target), "rotateRight")) {
+        Compiler::Operand* distance = frame->popInt();
+        Compiler::Operand* value = frame->popInt();
+        frame->pushInt
+          (c->or_(4, c->ushr(4, distance, value),
+                  c->shl(4, c->neg(4, distance), value)));
+        return true;
+      }
+    }
+  } else if (UNLIKELY(MATCH(className, "java/lang/Long"))) {
+    avian::codegen::Compiler* c = frame->c;
+    if (MATCH(methodSpec(t, target), "(J)I")) {
+      Compiler::Operand* result;
+      if (MATCH(methodName(t, target), "bitCount")) {
+        result = c->popcnt(8, frame->popLong());
+      } else if (MATCH(methodName(t, target), "numberOfLeadingZeros")) {
+        result = c->lzcnt(8, frame->popLong());
+      } else if (MATCH(methodName(t, target), "numberOfTrailingZeros")) {
+        result = c->tzcnt(8, frame->popLong());
+      } else {
+        return false;
+      }
+      frame->pushInt(c->load(8, 8, result, TargetBytesPerWord));
+      return true;
+    } else if (MATCH(methodName(t, target), "reverseBytes")
+               and MATCH(methodSpec(t, target), "(J)J"))
+    {
+      frame->pushLong(c->bswap(8, frame->popLong()));
+      return true;
+    } else if (MATCH(methodSpec(t, target), "(JI)J")) {
+      if (MATCH(methodName(t, target), "rotateLeft")) {
+        Compiler::Operand* distance = frame->popInt();
+        Compiler::Operand* value = frame->popLong();
+        frame->pushLong
+          (c->or_(8, c->shl(8, distance, value),
+                  c->ushr(8, c->neg(4, distance), value)));
+        return true;
+      } else if (MATCH(methodName(t, target), "rotateRight")) {
+        Compiler::Operand* distance = frame->popInt();
+        Compiler::Operand* value = frame->popLong();
+        frame->pushLong
+          (c->or_(8, c->ushr(8, distance, value),
+                  c->shl(8, c->neg(4, distance), value)));
+        return true;
+      }
+    }
   } else if (UNLIKELY(MATCH(className, "sun/misc/Unsafe"))) {
     avian::codegen::Compiler* c = frame->c;
     if (MATCH(methodName(t, target), "getByte")
@@ -4080,19 +5645,581 @@ intrinsic(MyThread* t, Frame* frame, object target)
         (8, value, TargetBytesPerWord, c->memory
          (address, Compiler::AddressType, 0, 0, 1));
       return true;
+    } else if ((MATCH(methodName(t, target), "putIntVolatile")
+                or MATCH(methodName(t, target), "putOrderedInt"))
+               and MATCH(methodSpec(t, target), "(Ljava/lang/Object;JI)V"))
+    {
+      Compiler::Operand* value = frame->popInt();
+      Compiler::Operand* offset = popLongAddress(frame);
+      Compiler::Operand* object = frame->popObject();
+      frame->popObject();
+
+      c->storeStoreBarrier();
+
+      c->store
+        (TargetBytesPerWord, value, 4, c->memory
+         (object, Compiler::IntegerType, 0, offset, 1));
+
+      // an ordered put only needs to be visible after the stores
+      // which precede it
+      if (MATCH(methodName(t, target), "putIntVolatile")) {
+        c->storeLoadBarrier();
+      }
+      return true;
+    } else if (MATCH(methodName(t, target), "getIntVolatile")
+               and MATCH(methodSpec(t, target), "(Ljava/lang/Object;J)I"))
+    {
+      Compiler::Operand* offset = popLongAddress(frame);
+      Compiler::Operand* object = frame->popObject();
+      frame->popObject();
+
+      frame->pushInt
+        (c->load
+         (4, 4, c->memory(object, Compiler::IntegerType, 0, offset, 1),
+          TargetBytesPerWord));
+
+      c->loadBarrier();
+      return true;
+    } else if (MATCH(methodName(t, target), "getObjectVolatile")
+               and MATCH(methodSpec(t, target),
+                         "(Ljava/lang/Object;J)Ljava/lang/Object;"))
+    {
+      Compiler::Operand* offset = popLongAddress(frame);
+      Compiler::Operand* object = frame->popObject();
+      frame->popObject();
+
+      frame->pushObject
+        (c->load
+         (TargetBytesPerWord, TargetBytesPerWord, c->memory
+          (object, Compiler::ObjectType, 0, offset, 1), TargetBytesPerWord));
+
+      c->loadBarrier();
+      return true;
+    } else if ((MATCH(methodName(t, target), "putObjectVolatile")
+                or MATCH(methodName(t, target), "putOrderedObject"))
+               and MATCH(methodSpec(t, target),
+                         "(Ljava/lang/Object;JLjava/lang/Object;)V"))
+    {
+      Compiler::Operand* value = frame->popObject();
+      Compiler::Operand* offset = popLongAddress(frame);
+      Compiler::Operand* object = frame->popObject();
+      frame->popObject();
+
+      c->storeStoreBarrier();
+
+      // through the same thunk as putstatic, which marks the card of
+      // the object for the collector
+      c->call
+        (c->constant(getThunk(t, setThunk), Compiler::AddressType),
+         0, 0, 0, Compiler::VoidType,
+         4, c->register_(t->arch->thread()), object, offset, value);
+
+      if (MATCH(methodName(t, target), "putObjectVolatile")) {
+        c->storeLoadBarrier();
+      }
+      return true;
+    } else if (MATCH(methodName(t, target), "compareAndSwapInt")
+               and MATCH(methodSpec(t, target), "(Ljava/lang/Object;JII)Z"))
+    {
+      Compiler::Operand* update = frame->popInt();
+      Compiler::Operand* expect = frame->popInt();
+      Compiler::Operand* offset = popLongAddress(frame);
+      Compiler::Operand* object = frame->popObject();
+      frame->popObject();
+
+      frame->pushInt
+        (c->call
+         (c->constant
+          (getThunk(t, compareAndSwapIntThunk), Compiler::AddressType),
+          0, 0, 4, Compiler::IntegerType, 5,
+          c->register_(t->arch->thread()), object, offset, expect, update));
+      return true;
+    } else if (TargetBytesPerWord == 8
+               and MATCH(methodName(t, target), "compareAndSwapLong")
+               and MATCH(methodSpec(t, target), "(Ljava/lang/Object;JJJ)Z"))
+    {
+      Compiler::Operand* update = frame->popLong();
+      Compiler::Operand* expect = frame->popLong();
+      Compiler::Operand* offset = popLongAddress(frame);
+      Compiler::Operand* object = frame->popObject();
+      frame->popObject();
+
+      frame->pushInt
+        (c->call
+         (c->constant
+          (getThunk(t, compareAndSwapWordThunk), Compiler::AddressType),
+          0, 0, 4, Compiler::IntegerType, 5,
+          c->register_(t->arch->thread()), object, offset, expect, update));
+      return true;
+    } else if (MATCH(methodName(t, target), "compareAndSwapObject")
+               and MATCH(methodSpec(t, target),
+                         "(Ljava/lang/Object;JLjava/lang/Object;"
+                         "Ljava/lang/Object;)Z"))
+    {
+      Compiler::Operand* update = frame->popObject();
+      Compiler::Operand* expect = frame->popObject();
+      Compiler::Operand* offset = popLongAddress(frame);
+      Compiler::Operand* object = frame->popObject();
+      frame->popObject();
+
+      frame->pushInt
+        (c->call
+         (c->constant
+          (getThunk(t, compareAndSwapObjectThunk), Compiler::AddressType),
+          0, 0, 4, Compiler::IntegerType, 5,
+          c->register_(t->arch->thread()), object, offset, expect, update));
+      return true;
+    }
+  } else if (UNLIKELY(MATCH(className, "libcore/io/Memory"))
+             and (methodFlags(t, target) & ACC_NATIVE))
+  {
+    // Android's accessors for raw memory, which but for peekByte and
+    // pokeByte take a flag saying whether to reverse the bytes
+    avian::codegen::Compiler* c = frame->c;
+    if (MATCH(methodName(t, target), "peekByte")
+        and MATCH(methodSpec(t, target), "(J)B"))
+    {
+      Compiler::Operand* address = popLongAddress(frame);
+      frame->pushInt
+        (c->load
+         (1, 1, c->memory(address, Compiler::IntegerType, 0, 0, 1),
+          TargetBytesPerWord));
+      return true;
+    } else if (MATCH(methodName(t, target), "pokeByte")
+               and MATCH(methodSpec(t, target), "(JB)V"))
+    {
+      Compiler::Operand* value = frame->popInt();
+      Compiler::Operand* address = popLongAddress(frame);
+      c->store
+        (TargetBytesPerWord, value, 1, c->memory
+         (address, Compiler::IntegerType, 0, 0, 1));
+      return true;
+    } else if (MATCH(methodName(t, target), "peekShort")
+               and MATCH(methodSpec(t, target), "(JZ)S"))
+    {
+      Compiler::Operand* swap = frame->popInt();
+      Compiler::Operand* address = popLongAddress(frame);
+      Compiler::Operand* value = c->load
+        (2, 2, c->memory(address, Compiler::IntegerType, 0, 0, 1),
+         TargetBytesPerWord);
+
+      // the swapped bytes end up in the top half, from which an
+      // arithmetic shift extends their sign
+      frame->pushInt
+        (selectSwapped
+         (c, 4, swap, value, c->shr
+          (4, c->constant(16, Compiler::IntegerType), c->bswap(4, value))));
+      return true;
+    } else if (MATCH(methodName(t, target), "pokeShort")
+               and MATCH(methodSpec(t, target), "(JSZ)V"))
+    {
+      Compiler::Operand* swap = frame->popInt();
+      Compiler::Operand* value = frame->popInt();
+      Compiler::Operand* address = popLongAddress(frame);
+      c->store
+        (TargetBytesPerWord, selectSwapped
+         (c, 4, swap, value, c->ushr
+          (4, c->constant(16, Compiler::IntegerType), c->bswap(4, value))),
+         2, c->memory(address, Compiler::IntegerType, 0, 0, 1));
+      return true;
+    } else if (MATCH(methodName(t, target), "peekInt")
+               and MATCH(methodSpec(t, target), "(JZ)I"))
+    {
+      Compiler::Operand* swap = frame->popInt();
+      Compiler::Operand* address = popLongAddress(frame);
+      Compiler::Operand* value = c->load
+        (4, 4, c->memory(address, Compiler::IntegerType, 0, 0, 1),
+         TargetBytesPerWord);
+      frame->pushInt(selectSwapped(c, 4, swap, value, c->bswap(4, value)));
+      return true;
+    } else if (MATCH(methodName(t, target), "pokeInt")
+               and MATCH(methodSpec(t, target), "(JIZ)V"))
+    {
+      Compiler::Operand* swap = frame->popInt();
+      Compiler::Operand* value = frame->popInt();
+      Compiler::Operand* address = popLongAddress(frame);
+      c->store
+        (TargetBytesPerWord,
+         selectSwapped(c, 4, swap, value, c->bswap(4, value)),
+         4, c->memory(address, Compiler::IntegerType, 0, 0, 1));
+      return true;
+    } else if (MATCH(methodName(t, target), "peekLong")
+               and MATCH(methodSpec(t, target), "(JZ)J"))
+    {
+      Compiler::Operand* swap = frame->popInt();
+      Compiler::Operand* address = popLongAddress(frame);
+      Compiler::Operand* value = c->load
+        (8, 8, c->memory(address, Compiler::IntegerType, 0, 0, 1), 8);
+      frame->pushLong(selectSwapped(c, 8, swap, value, c->bswap(8, value)));
+      return true;
+    } else if (MATCH(methodName(t, target), "pokeLong")
+               and MATCH(methodSpec(t, target), "(JJZ)V"))
+    {
+      Compiler::Operand* swap = frame->popInt();
+      Compiler::Operand* value = frame->popLong();
+      Compiler::Operand* address = popLongAddress(frame);
+      c->store
+        (8, selectSwapped(c, 8, swap, value, c->bswap(8, value)),
+         8, c->memory(address, Compiler::IntegerType, 0, 0, 1));
+      return true;
+    }
+  }
+  return false;
+}
+
+unsigned
+targetFieldOffset(Context* context, object field)
+{
+  if (context->bootContext) {
+    return context->bootContext->resolver->fieldOffset(context->thread, field);
+  } else {
+    return fieldOffset(context->thread, field);
+  }
+}
+
+void
+compileFieldLoad(MyThread* t, Frame* frame, Compiler::Operand* table,
+                 object field)
+{
+  avian::codegen::Compiler* c = frame->c;
+
+  switch (fieldCode(t, field)) {
+  case ByteField:
+  case BooleanField:
+    frame->pushInt
+      (c->load
+       (1, 1, c->memory
+        (table, Compiler::IntegerType, targetFieldOffset
+         (frame->context, field), 0, 1), TargetBytesPerWord));
+    break;
+
+  case CharField:
+    frame->pushInt
+      (c->loadz
+       (2, 2, c->memory
+        (table, Compiler::IntegerType, targetFieldOffset
+         (frame->context, field), 0, 1), TargetBytesPerWord));
+    break;
+
+  case ShortField:
+    frame->pushInt
+      (c->load
+       (2, 2, c->memory
+        (table, Compiler::IntegerType, targetFieldOffset
+         (frame->context, field), 0, 1), TargetBytesPerWord));
+    break;
+
+  case FloatField:
+    frame->pushInt
+      (c->load
+       (4, 4, c->memory
+        (table, Compiler::FloatType, targetFieldOffset
+         (frame->context, field), 0, 1), TargetBytesPerWord));
+    break;
+
+  case IntField:
+    frame->pushInt
+      (c->load
+       (4, 4, c->memory
+        (table, Compiler::IntegerType, targetFieldOffset
+         (frame->context, field), 0, 1), TargetBytesPerWord));
+    break;
+
+  case DoubleField:
+    frame->pushLong
+      (c->load
+       (8, 8, c->memory
+        (table, Compiler::FloatType, targetFieldOffset
+         (frame->context, field), 0, 1), 8));
+    break;
+
+  case LongField:
+    frame->pushLong
+      (c->load
+       (8, 8, c->memory
+        (table, Compiler::IntegerType, targetFieldOffset
+         (frame->context, field), 0, 1), 8));
+    break;
+
+  case ObjectField:
+    frame->pushObject
+      (c->load
+       (TargetBytesPerWord, TargetBytesPerWord,
+        c->memory
+        (table, Compiler::ObjectType, targetFieldOffset
+         (frame->context, field), 0, 1), TargetBytesPerWord));
+    break;
+
+  default:
+    abort(t);
+  }
+}
+
+bool
+inlineGetter(MyThread* t, Frame* frame, object code, unsigned ip,
+             object target)
+{
+  // only a method which can't be overridden may be replaced by its
+  // body, and we only handle the simplest body: "return this.field"
+  if ((methodFlags(t, target) & (ACC_NATIVE | ACC_SYNCHRONIZED
+                                 | ACC_ABSTRACT | ACC_STATIC))
+      or ((methodFlags(t, target) & (ACC_FINAL | ACC_PRIVATE)) == 0
+          and (classFlags(t, methodClass(t, target)) & ACC_FINAL) == 0)
+      or methodCode(t, target) == 0
+      or codeLength(t, methodCode(t, target)) != 5)
+  {
+    return false;
+  }
+
+  object targetCode = methodCode(t, target);
+  if (codeBody(t, targetCode, 0) != aload_0
+      or codeBody(t, targetCode, 1) != getfield)
+  {
+    return false;
+  }
+
+  unsigned index = (codeBody(t, targetCode, 2) << 8)
+    | codeBody(t, targetCode, 3);
+
+  // the field must already be resolved, since resolving it here could
+  // throw an error which belongs to the callee's frame
+  object field = singletonObject(t, codePool(t, targetCode), index - 1);
+  if (objectClass(t, field) != type(t, Machine::FieldType)
+      or (fieldFlags(t, field) & (ACC_VOLATILE | ACC_STATIC)))
+  {
+    return false;
+  }
+
+  unsigned returnInstruction;
+  switch (fieldCode(t, field)) {
+  case ByteField:
+  case BooleanField:
+  case CharField:
+  case ShortField:
+  case IntField:
+    returnInstruction = ireturn;
+    break;
+
+  case FloatField:
+    returnInstruction = freturn;
+    break;
+
+  case LongField:
+    returnInstruction = lreturn;
+    break;
+
+  case DoubleField:
+    returnInstruction = dreturn;
+    break;
+
+  case ObjectField:
+    returnInstruction = areturn;
+    break;
+
+  default:
+    abort(t);
+  }
+
+  if (codeBody(t, targetCode, 4) != returnInstruction) {
+    return false;
+  }
+
+  Compiler::Operand* table = frame->popObject();
+
+  if (inTryBlock(t, code, ip - 3)) {
+    frame->c->saveLocals();
+    frame->trace(0, 0);
+  }
+
+  compileFieldLoad(t, frame, table, field);
+
+  return true;
+}
+
+// the instance field of the specified class with the specified name
+// and spec, or zero if there is none.  This compares names in place,
+// since allocating here could move the method being compiled.
+object
+declaredField(MyThread* t, object class_, const char* name, const char* spec)
+{
+  object table = classFieldTable(t, class_);
+  if (table) {
+    for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+      object field = arrayBody(t, table, i);
+      if ((fieldFlags(t, field) & ACC_STATIC) == 0
+          and ::strcmp(reinterpret_cast<char*>
+                       (&byteArrayBody(t, fieldName(t, field), 0)), name) == 0
+          and ::strcmp(reinterpret_cast<char*>
+                       (&byteArrayBody(t, fieldSpec(t, field), 0)), spec) == 0)
+      {
+        return field;
+      }
+    }
+  }
+  return 0;
+}
+
+bool
+stringIntrinsic(MyThread* t, Frame* frame, object code, unsigned ip,
+                object target)
+{
+  // Android's String declares these native and keeps its characters
+  // in value[offset] through value[offset + count - 1], so we can
+  // read them directly or call a thunk instead of the native method
+  if ((methodFlags(t, target) & ACC_NATIVE) == 0
+      or not MATCH(className(t, methodClass(t, target)), "java/lang/String"))
+  {
+    return false;
+  }
+
+  object class_ = methodClass(t, target);
+  object count = declaredField(t, class_, "count", "I");
+  object offset = declaredField(t, class_, "offset", "I");
+  object value = declaredField(t, class_, "value", "[C");
+  if (count == 0 or offset == 0 or value == 0) {
+    return false;
+  }
+
+  Context* context = frame->context;
+  avian::codegen::Compiler* c = frame->c;
+  if (MATCH(methodName(t, target), "length")
+      and MATCH(methodSpec(t, target), "()I"))
+  {
+    Compiler::Operand* string = frame->popObject();
+
+    if (inTryBlock(t, code, ip - 3)) {
+      c->saveLocals();
+      frame->trace(0, 0);
+    }
+
+    frame->pushInt
+      (c->load
+       (4, 4, c->memory
+        (string, Compiler::IntegerType, targetFieldOffset(context, count), 0,
+         1), TargetBytesPerWord));
+    return true;
+  } else if (MATCH(methodName(t, target), "charAt")
+             and MATCH(methodSpec(t, target), "(I)C"))
+  {
+    Compiler::Operand* index = frame->popInt();
+    Compiler::Operand* string = frame->popObject();
+
+    if (inTryBlock(t, code, ip - 3)) {
+      c->saveLocals();
+      frame->trace(0, 0);
     }
+
+    // the array check works for any 32-bit length, and what it throws
+    // is the IndexOutOfBoundsException charAt promises
+    if (CheckArrayBounds) {
+      c->checkBounds
+        (string, targetFieldOffset(context, count), index, aioobThunk(t));
+    }
+
+    Compiler::Operand* data = c->load
+      (TargetBytesPerWord, TargetBytesPerWord, c->memory
+       (string, Compiler::ObjectType, targetFieldOffset(context, value), 0,
+        1), TargetBytesPerWord);
+
+    Compiler::Operand* start = c->load
+      (4, 4, c->memory
+       (string, Compiler::IntegerType, targetFieldOffset(context, offset), 0,
+        1), TargetBytesPerWord);
+
+    frame->pushInt
+      (c->loadz
+       (2, 2, c->memory
+        (data, Compiler::IntegerType, TargetArrayBody, c->add(4, start, index),
+         2), TargetBytesPerWord));
+    return true;
+  } else if (MATCH(methodName(t, target), "equals")
+             and MATCH(methodSpec(t, target), "(Ljava/lang/Object;)Z"))
+  {
+    Compiler::Operand* other = frame->popObject();
+    Compiler::Operand* string = frame->popObject();
+    frame->pushInt
+      (c->call
+       (c->constant(getThunk(t, equalStringsThunk), Compiler::AddressType),
+        0, frame->trace(0, 0), 4, Compiler::IntegerType,
+        3, c->register_(t->arch->thread()), string, other));
+    return true;
+  } else if (MATCH(methodName(t, target), "compareTo")
+             and MATCH(methodSpec(t, target), "(Ljava/lang/String;)I"))
+  {
+    Compiler::Operand* other = frame->popObject();
+    Compiler::Operand* string = frame->popObject();
+    frame->pushInt
+      (c->call
+       (c->constant(getThunk(t, compareStringsThunk), Compiler::AddressType),
+        0, frame->trace(0, 0), 4, Compiler::IntegerType,
+        3, c->register_(t->arch->thread()), string, other));
+    return true;
+  } else if (MATCH(methodName(t, target), "fastIndexOf")
+             and MATCH(methodSpec(t, target), "(II)I"))
+  {
+    Compiler::Operand* start = frame->popInt();
+    Compiler::Operand* character = frame->popInt();
+    Compiler::Operand* string = frame->popObject();
+    frame->pushInt
+      (c->call
+       (c->constant(getThunk(t, indexOfCharThunk), Compiler::AddressType),
+        0, frame->trace(0, 0), 4, Compiler::IntegerType,
+        4, c->register_(t->arch->thread()), string, character, start));
+    return true;
   }
+
   return false;
 }
 
-unsigned
-targetFieldOffset(Context* context, object field)
-{
-  if (context->bootContext) {
-    return context->bootContext->resolver->fieldOffset(context->thread, field);
-  } else {
-    return fieldOffset(context->thread, field);
+bool
+devirtualize(MyThread* t, Frame* frame, object code, unsigned ip,
+             object target)
+{
+  // a method which no loaded class overrides may be called directly
+  // instead of through the vtable.  If such a class is loaded later,
+  // methodOverridden sends the call through a dispatch thunk instead.
+  if (frame->context->bootContext
+      or (not methodVirtual(t, target))
+      or isTailCall(t, code, ip, frame->context->method, target)
+      or (methodFlags(t, target) & (ACC_ABSTRACT | ACC_NATIVE))
+      or (methodVmFlags(t, target) & OverriddenFlag))
+  {
+    return false;
+  }
+
+  avian::codegen::Compiler* c = frame->c;
+
+  unsigned parameterFootprint = methodParameterFootprint(t, target);
+
+  Compiler::Operand* instance = c->peek(1, parameterFootprint - 1);
+
+  if (inTryBlock(t, code, ip - 3)) {
+    c->saveLocals();
+    frame->trace(0, 0);
+  }
+
+  // a vtable call throws NullPointerException when it loads the
+  // receiver's class, so we load it here as well.  The copy stored in
+  // the thread is what the dispatch thunk reads if this call is later
+  // redirected to it.
+  c->store
+    (TargetBytesPerWord, c->memory(instance, Compiler::AddressType, 0, 0, 1),
+     TargetBytesPerWord, c->memory
+     (c->register_(t->arch->thread()), Compiler::AddressType,
+      TARGET_THREAD_VIRTUALCALLTARGET));
+
+  unsigned rSize = resultSize(t, methodReturnCode(t, target));
+
+  Compiler::Operand* result = compileDirectInvoke
+    (t, frame, target, false, true, rSize, 0, true);
+
+  frame->pop(parameterFootprint);
+
+  if (rSize) {
+    pushReturnValue(t, frame, methodReturnCode(t, target), result);
   }
+
+  return true;
 }
 
 class Stack {
@@ -4110,7 +6237,7 @@ class Stack {
 
   Stack(MyThread* t):
     thread(t),
-    zone(t->m->system, t->m->heap, 0),
+    zone(t->m->system, categoryAllocator(t->m, CompilerMemory), 0),
     resource(this)
   { }
 
@@ -4264,7 +6391,7 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
         frame->trace(0, 0);
       }
 
-      if (CheckArrayBounds) {
+      if (CheckArrayBounds and not context->boundsCheckTable[ip - 1]) {
         c->checkBounds(array, TargetArrayLength, index, aioobThunk(t));
       }
 
@@ -4359,14 +6486,15 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
         frame->trace(0, 0);
       }
 
-      if (CheckArrayBounds) {
+      if (CheckArrayBounds and not context->boundsCheckTable[ip - 1]) {
         c->checkBounds(array, TargetArrayLength, index, aioobThunk(t));
       }
 
       switch (instruction) {
       case aastore: {
         c->call
-          (c->constant(getThunk(t, setMaybeNullThunk), Compiler::AddressType),
+          (c->constant
+           (getThunk(t, setObjectArrayElementThunk), Compiler::AddressType),
            0,
            frame->trace(0, 0),
            0,
@@ -4787,22 +6915,6 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       object field = resolveField(t, context->method, index - 1, false);
 
       if (LIKELY(field)) {
-        if ((fieldFlags(t, field) & ACC_VOLATILE)
-            and TargetBytesPerWord == 4
-            and (fieldCode(t, field) == DoubleField
-                 or fieldCode(t, field) == LongField))
-        {
-          PROTECT(t, field);
-
-          c->call
-            (c->constant
-             (getThunk(t, acquireMonitorForObjectThunk),
-              Compiler::AddressType),
-             0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
-             c->register_(t->arch->thread()),
-             frame->append(field));
-        }
-
         Compiler::Operand* table;
 
         if (instruction == getstatic) {
@@ -4834,90 +6946,29 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
           }
         }
 
-        switch (fieldCode(t, field)) {
-        case ByteField:
-        case BooleanField:
-          frame->pushInt
-            (c->load
-             (1, 1, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
-
-        case CharField:
-          frame->pushInt
-            (c->loadz
-             (2, 2, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
-
-        case ShortField:
-          frame->pushInt
-            (c->load
-             (2, 2, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
-
-        case FloatField:
-          frame->pushInt
-            (c->load
-             (4, 4, c->memory
-              (table, Compiler::FloatType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
-
-        case IntField:
-          frame->pushInt
-            (c->load
-             (4, 4, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
-
-        case DoubleField:
-          frame->pushLong
-            (c->load
-             (8, 8, c->memory
-              (table, Compiler::FloatType, targetFieldOffset
-               (context, field), 0, 1), 8));
-          break;
+        if ((fieldFlags(t, field) & ACC_VOLATILE)
+            and TargetBytesPerWord == 4
+            and (fieldCode(t, field) == DoubleField
+                 or fieldCode(t, field) == LongField))
+        {
+          // a 32-bit target can't load the field atomically with
+          // ordinary instructions, so the thunk does it, using a
+          // 64-bit compare-and-swap where there is one
+          PROTECT(t, field);
 
-        case LongField:
           frame->pushLong
-            (c->load
-             (8, 8, c->memory
-              (table, Compiler::IntegerType, targetFieldOffset
-               (context, field), 0, 1), 8));
-          break;
-
-        case ObjectField:
-          frame->pushObject
-            (c->load
-             (TargetBytesPerWord, TargetBytesPerWord,
-              c->memory
-              (table, Compiler::ObjectType, targetFieldOffset
-               (context, field), 0, 1), TargetBytesPerWord));
-          break;
-
-        default:
-          abort(t);
-        }
+            (c->call
+             (c->constant
+              (getThunk(t, getVolatileWideFieldThunk),
+               Compiler::AddressType),
+              0, frame->trace(0, 0), 8,
+              operandTypeForFieldCode(t, fieldCode(t, field)), 3,
+              c->register_(t->arch->thread()), frame->append(field),
+              table));
+        } else {
+          compileFieldLoad(t, frame, table, field);
 
-        if (fieldFlags(t, field) & ACC_VOLATILE) {
-          if (TargetBytesPerWord == 4
-              and (fieldCode(t, field) == DoubleField
-                   or fieldCode(t, field) == LongField))
-          {
-            c->call
-              (c->constant
-               (getThunk(t, releaseMonitorForObjectThunk),
-                Compiler::AddressType),
-               0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
-               c->register_(t->arch->thread()),
-               frame->append(field));
-          } else {
+          if (fieldFlags(t, field) & ACC_VOLATILE) {
             c->loadBarrier();
           }
         }
@@ -4959,6 +7010,10 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       uint32_t newIp = (ip - 3) + offset;
       assert(t, newIp < codeLength(t, code));
 
+      if (newIp < ip) {
+        compileSafepoint(t, frame);
+      }
+
       c->jmp(frame->machineIp(newIp));
       ip = newIp;
     } break;
@@ -4968,6 +7023,10 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       uint32_t newIp = (ip - 5) + offset;
       assert(t, newIp < codeLength(t, code));
 
+      if (newIp < ip) {
+        compileSafepoint(t, frame);
+      }
+
       c->jmp(frame->machineIp(newIp));
       ip = newIp;
     } break;
@@ -5056,10 +7115,15 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       uint32_t offset = codeReadInt16(t, code, ip);
       newIp = (ip - 3) + offset;
       assert(t, newIp < codeLength(t, code));
+
+      if (newIp < ip) {
+        compileSafepoint(t, frame);
+      }
         
       Compiler::Operand* a = frame->popObject();
       Compiler::Operand* b = frame->popObject();
-      Compiler::Operand* target = frame->machineIp(newIp);
+      Compiler::Operand* target = branchTarget
+        (t, frame, ip, newIp, &instruction);
 
       if (instruction == if_acmpeq) {
         c->jumpIfEqual(TargetBytesPerWord, a, b, target);
@@ -5077,10 +7141,15 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       uint32_t offset = codeReadInt16(t, code, ip);
       newIp = (ip - 3) + offset;
       assert(t, newIp < codeLength(t, code));
+
+      if (newIp < ip) {
+        compileSafepoint(t, frame);
+      }
         
       Compiler::Operand* a = frame->popInt();
       Compiler::Operand* b = frame->popInt();
-      Compiler::Operand* target = frame->machineIp(newIp);
+      Compiler::Operand* target = branchTarget
+        (t, frame, ip, newIp, &instruction);
 
       switch (instruction) {
       case if_icmpeq:
@@ -5116,7 +7185,12 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       newIp = (ip - 3) + offset;
       assert(t, newIp < codeLength(t, code));
 
-      Compiler::Operand* target = frame->machineIp(newIp);
+      if (newIp < ip) {
+        compileSafepoint(t, frame);
+      }
+
+      Compiler::Operand* target = branchTarget
+        (t, frame, ip, newIp, &instruction);
 
       Compiler::Operand* a = c->constant(0, Compiler::IntegerType);
       Compiler::Operand* b = frame->popInt();
@@ -5151,9 +7225,14 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       newIp = (ip - 3) + offset;
       assert(t, newIp < codeLength(t, code));
 
+      if (newIp < ip) {
+        compileSafepoint(t, frame);
+      }
+
       Compiler::Operand* a = c->constant(0, Compiler::ObjectType);
       Compiler::Operand* b = frame->popObject();
-      Compiler::Operand* target = frame->machineIp(newIp);
+      Compiler::Operand* target = branchTarget
+        (t, frame, ip, newIp, &instruction);
 
       if (instruction == ifnull) {
         c->jumpIfEqual(TargetBytesPerWord, a, b, target);
@@ -5260,11 +7339,11 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       if (LIKELY(target)) {
         checkMethod(t, target, false);
 
-        argument = target;
         thunk = findInterfaceMethodFromInstanceThunk;
         parameterFootprint = methodParameterFootprint(t, target);
         returnCode = methodReturnCode(t, target);
         tailCall = isTailCall(t, code, ip, context->method, target);
+        argument = makeInterfaceCache(t, target);
       } else {
         argument = makePair(t, context->method, reference);
         thunk = findInterfaceMethodFromInstanceAndReferenceThunk;
@@ -5319,13 +7398,16 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
 
         checkMethod(t, target, false);
 
-        bool tailCall = isTailCall(t, code, ip, context->method, target);
+        // String calls its private fastIndexOf this way
+        if (not stringIntrinsic(t, frame, code, ip, target)) {
+          bool tailCall = isTailCall(t, code, ip, context->method, target);
 
-        if (UNLIKELY(methodAbstract(t, target))) {
-          compileDirectAbstractInvoke
-            (t, frame, getMethodAddressThunk, target, tailCall);
-        } else {
-          compileDirectInvoke(t, frame, target, tailCall);
+          if (UNLIKELY(methodAbstract(t, target))) {
+            compileDirectAbstractInvoke
+              (t, frame, getMethodAddressThunk, target, tailCall);
+          } else {
+            compileDirectInvoke(t, frame, target, tailCall);
+          }
         }
       } else {
         compileDirectReferenceInvoke
@@ -5375,7 +7457,11 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       if (LIKELY(target)) {
         checkMethod(t, target, false);
          
-        if (not intrinsic(t, frame, target)) {
+        if (not (intrinsic(t, frame, target)
+                 or stringIntrinsic(t, frame, code, ip, target)
+                 or inlineGetter(t, frame, code, ip, target)
+                 or devirtualize(t, frame, code, ip, target)))
+        {
           bool tailCall = isTailCall(t, code, ip, context->method, target);
 
           if (LIKELY(methodVirtual(t, target))) {
@@ -5925,6 +8011,14 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
         argument = class_;
         if (classVmFlags(t, class_) & (WeakReferenceFlag | HasFinalizerFlag)) {
           thunk = makeNewGeneral64Thunk;
+        } else if (context->bootContext == 0
+                   and superclassesInitialized(t, class_))
+        {
+          // the class and its superclasses are already initialized,
+          // so there's no need to walk the hierarchy on every
+          // allocation (classes in a boot image may be reinitialized
+          // at runtime, so we can't make this assumption there)
+          thunk = makeNewInitialized64Thunk;
         } else {
           thunk = makeNew64Thunk;
         }
@@ -6012,21 +8106,14 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
           }
         }
 
-        if (fieldFlags(t, field) & ACC_VOLATILE) {
-          if (TargetBytesPerWord == 4
-              and (fieldCode == DoubleField or fieldCode == LongField))
-          {
-            PROTECT(t, field);
+        // as with getfield, a thunk stores volatile long and double
+        // fields on 32-bit targets, and needs no barriers here
+        bool wideVolatile = (fieldFlags(t, field) & ACC_VOLATILE)
+          and TargetBytesPerWord == 4
+          and (fieldCode == DoubleField or fieldCode == LongField);
 
-            c->call
-              (c->constant
-               (getThunk(t, acquireMonitorForObjectThunk),
-                Compiler::AddressType),
-               0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
-               c->register_(t->arch->thread()), frame->append(field));
-          } else {
-            c->storeStoreBarrier();
-          }
+        if ((fieldFlags(t, field) & ACC_VOLATILE) and not wideVolatile) {
+          c->storeStoreBarrier();
         }
 
         Compiler::Operand* value = popField(t, frame, fieldCode);
@@ -6073,17 +8160,24 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
           break;
 
         case DoubleField:
-          c->store
-            (8, value, 8, c->memory
-             (table, Compiler::FloatType, targetFieldOffset
-              (context, field), 0, 1));
-          break;
-
         case LongField:
-          c->store
-            (8, value, 8, c->memory
-             (table, Compiler::IntegerType, targetFieldOffset
-              (context, field), 0, 1));
+          if (wideVolatile) {
+            PROTECT(t, field);
+
+            c->call
+              (c->constant
+               (getThunk(t, setVolatileWideFieldThunk),
+                Compiler::AddressType),
+               0, frame->trace(0, 0), 0, Compiler::VoidType, 5,
+               c->register_(t->arch->thread()), frame->append(field),
+               table, static_cast<Compiler::Operand*>(0), value);
+          } else {
+            c->store
+              (8, value, 8, c->memory
+               (table, fieldCode == DoubleField
+                ? Compiler::FloatType : Compiler::IntegerType,
+                targetFieldOffset(context, field), 0, 1));
+          }
           break;
 
         case ObjectField:
@@ -6113,19 +8207,8 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
         default: abort(t);
         }
 
-        if (fieldFlags(t, field) & ACC_VOLATILE) {
-          if (TargetBytesPerWord == 4
-              and (fieldCode == DoubleField or fieldCode == LongField))
-          {
-            c->call
-              (c->constant
-               (getThunk(t, releaseMonitorForObjectThunk),
-                Compiler::AddressType),
-               0, frame->trace(0, 0), 0, Compiler::VoidType, 2,
-               c->register_(t->arch->thread()), frame->append(field));
-          } else {
-            c->storeLoadBarrier();
-          }
+        if ((fieldFlags(t, field) & ACC_VOLATILE) and not wideVolatile) {
+          c->storeLoadBarrier();
         }
       } else {
         int fieldCode = vm::fieldCode
@@ -6617,6 +8700,44 @@ translateExceptionHandlerTable(MyThread* t, Context* context, intptr_t start,
   }
 }
 
+bool
+coldBoundary(Context* context, unsigned ip)
+{
+  return context->coldTable
+    and context->coldTable[ip] != context->coldTable[ip - 1]
+    and context->visitTable[ip];
+}
+
+// Returns the source line of the instruction at ip, or -1 if unknown.
+int
+lineAt(MyThread* t, object table, unsigned ip)
+{
+  int line = -1;
+  unsigned best = 0;
+  for (unsigned i = 0; i < lineNumberTableLength(t, table); ++i) {
+    uint64_t ln = lineNumberTableBody(t, table, i);
+    if (lineNumberIp(ln) <= ip and (line < 0 or lineNumberIp(ln) >= best)) {
+      best = lineNumberIp(ln);
+      line = lineNumberLine(ln);
+    }
+  }
+  return line;
+}
+
+int
+compareLineNumbers(const void* va, const void* vb)
+{
+  uint64_t a = lineNumberIp(*static_cast<const uint64_t*>(va));
+  uint64_t b = lineNumberIp(*static_cast<const uint64_t*>(vb));
+  if (a > b) {
+    return 1;
+  } else if (a < b) {
+    return -1;
+  } else {
+    return 0;
+  }
+}
+
 object
 translateLineNumberTable(MyThread* t, Context* context, intptr_t start)
 {
@@ -6625,7 +8746,16 @@ translateLineNumberTable(MyThread* t, Context* context, intptr_t start)
     PROTECT(t, oldTable);
 
     unsigned length = lineNumberTableLength(t, oldTable);
-    object newTable = makeLineNumberTable(t, length);
+    unsigned coldBoundaryCount = 0;
+    for (unsigned ip = 1; ip < codeLength(t, methodCode(t, context->method));
+         ++ip)
+    {
+      if (coldBoundary(context, ip)) {
+        ++ coldBoundaryCount;
+      }
+    }
+
+    object newTable = makeLineNumberTable(t, length + coldBoundaryCount);
     unsigned ni = 0;
     for (unsigned oi = 0; oi < length; ++oi) {
       uint64_t oldLine = lineNumberTableBody(t, oldTable, oi);
@@ -6642,8 +8772,28 @@ translateLineNumberTable(MyThread* t, Context* context, intptr_t start)
       }
     }
 
-    if (UNLIKELY(ni < length)) {
-      newTable = truncateLineNumberTable(t, newTable, ni);      
+    if (coldBoundaryCount) {
+      // cold code is laid out at the end, so each place where the
+      // layout leaves bytecode order needs an entry of its own, and
+      // the table must then be sorted by machine offset
+      for (unsigned ip = 1;
+           ip < codeLength(t, methodCode(t, context->method)); ++ip)
+      {
+        if (coldBoundary(context, ip)) {
+          int line = lineAt(t, oldTable, ip);
+          if (line >= 0) {
+            lineNumberTableBody(t, newTable, ni++) = lineNumber
+              (context->compiler->machineIp(ip)->value() - start, line);
+          }
+        }
+      }
+
+      qsort(&lineNumberTableBody(t, newTable, 0), ni, sizeof(uint64_t),
+            compareLineNumbers);
+    }
+
+    if (UNLIKELY(ni < length + coldBoundaryCount)) {
+      newTable = truncateLineNumberTable(t, newTable, ni);
     }
 
     return newTable;
@@ -6982,11 +9132,40 @@ compareTraceElementPointers(const void* va, const void* vb)
   }
 }
 
+// A simple frame map table is an int array holding the number of
+// call sites and the widths of the packed fields below, followed by
+// each site's code offset, then each site's index into the list of
+// distinct frame maps, then the distinct maps themselves.  Most sites
+// in a method share a handful of maps, so storing each map once and
+// packing the offsets and indexes into as few bits as they need keeps
+// the table much smaller than a map per site.
+const unsigned SimpleFrameMapSiteCount = 0;
+const unsigned SimpleFrameMapFieldBits = 1;
+const unsigned SimpleFrameMapHeaderSize = 2;
+
+unsigned
+simpleFrameMapIndexStart(unsigned siteCount, unsigned offsetBits)
+{
+  return SimpleFrameMapHeaderSize + ceilingDivide(siteCount * offsetBits, 32);
+}
+
+unsigned
+simpleFrameMapMapStart(unsigned siteCount, unsigned offsetBits,
+                       unsigned indexBits)
+{
+  return simpleFrameMapIndexStart(siteCount, offsetBits)
+    + ceilingDivide(siteCount * indexBits, 32);
+}
+
 unsigned
-simpleFrameMapTableSize(MyThread* t, object method, object map)
+bitsNeeded(unsigned v)
 {
-  int size = frameMapSizeInBits(t, method);
-  return ceilingDivide(intArrayLength(t, map) * size, 32 + size);
+  unsigned bits = 0;
+  while (v) {
+    ++ bits;
+    v >>= 1;
+  }
+  return bits;
 }
 
 uint8_t*
@@ -7242,24 +9421,93 @@ makeSimpleFrameMapTable(MyThread* t, Context* context, uint8_t* start,
                         TraceElement** elements, unsigned elementCount)
 {
   unsigned mapSize = frameMapSizeInBits(t, context->method);
+  unsigned mapWords = ceilingDivide(mapSize, 32);
+  unsigned mapBytes = mapWords * sizeof(int32_t);
+
+  unsigned* mapIndexes = static_cast<unsigned*>
+    (context->zone.allocate(sizeof(unsigned) * max(elementCount, 1U)));
+  int32_t* maps = static_cast<int32_t*>
+    (context->zone.allocate(max(elementCount * mapBytes, 1U)));
+  unsigned mapCount = 0;
+
+  if (mapSize) {
+    int32_t* scratch = static_cast<int32_t*>(context->zone.allocate(mapBytes));
+
+    // open-addressed set of distinct maps, holding map index + 1
+    unsigned capacity = nextPowerOfTwo(elementCount * 2);
+    unsigned* slots = static_cast<unsigned*>
+      (context->zone.allocate(sizeof(unsigned) * capacity));
+    memset(slots, 0, sizeof(unsigned) * capacity);
+
+    for (unsigned i = 0; i < elementCount; ++i) {
+      memset(scratch, 0, mapBytes);
+      copyFrameMap(scratch, elements[i]->map, mapSize, 0, elements[i], 0);
+
+      uint32_t h = 0;
+      for (unsigned j = 0; j < mapWords; ++j) {
+        h = (h * 31) + scratch[j];
+      }
+
+      unsigned slot = h & (capacity - 1);
+      while (slots[slot]
+             and memcmp(maps + ((slots[slot] - 1) * mapWords), scratch,
+                        mapBytes) != 0)
+      {
+        slot = (slot + 1) & (capacity - 1);
+      }
+
+      if (slots[slot] == 0) {
+        memcpy(maps + (mapCount * mapWords), scratch, mapBytes);
+        slots[slot] = ++ mapCount;
+      }
+
+      mapIndexes[i] = slots[slot] - 1;
+    }
+  }
+
+  unsigned lastOffset = elementCount
+    ? static_cast<intptr_t>(elements[elementCount - 1]->address->value())
+    - reinterpret_cast<intptr_t>(start)
+    : 0;
+  unsigned offsetBits = lastOffset <= 0xFFFF ? 16 : 32;
+  unsigned indexBits = mapCount > 1 ? bitsNeeded(mapCount - 1) : 0;
+  unsigned mapStart = simpleFrameMapMapStart
+    (elementCount, offsetBits, indexBits);
+
   object table = makeIntArray
-    (t, elementCount + ceilingDivide(elementCount * mapSize, 32));
+    (t, mapStart + ceilingDivide(mapCount * mapSize, 32));
 
-  assert(t, intArrayLength(t, table) == elementCount
-         + simpleFrameMapTableSize(t, context->method, table));
+  intArrayBody(t, table, SimpleFrameMapSiteCount) = elementCount;
+  intArrayBody(t, table, SimpleFrameMapFieldBits)
+    = offsetBits | (indexBits << 8);
 
-  for (unsigned i = 0; i < elementCount; ++i) {
-    TraceElement* p = elements[i];
+  uint32_t* offsets = reinterpret_cast<uint32_t*>
+    (&intArrayBody(t, table, SimpleFrameMapHeaderSize));
+  uint32_t* indexes = reinterpret_cast<uint32_t*>
+    (&intArrayBody(t, table, simpleFrameMapIndexStart
+                   (elementCount, offsetBits)));
 
-    intArrayBody(t, table, i) = static_cast<intptr_t>(p->address->value())
-      - reinterpret_cast<intptr_t>(start);
+  for (unsigned i = 0; i < elementCount; ++i) {
+    setBits<uint32_t>
+      (offsets, offsetBits, i * offsetBits,
+       static_cast<intptr_t>(elements[i]->address->value())
+       - reinterpret_cast<intptr_t>(start));
 
-    assert(t, elementCount + ceilingDivide((i + 1) * mapSize, 32)
-           <= intArrayLength(t, table));
+    if (indexBits) {
+      setBits<uint32_t>(indexes, indexBits, i * indexBits, mapIndexes[i]);
+    }
+  }
 
-    if (mapSize) {
-      copyFrameMap(&intArrayBody(t, table, elementCount), p->map,
-                   mapSize, i * mapSize, p, 0);
+  if (mapSize) {
+    uint32_t* dst = reinterpret_cast<uint32_t*>
+      (&intArrayBody(t, table, mapStart));
+    uint32_t* src = reinterpret_cast<uint32_t*>(maps);
+    for (unsigned i = 0; i < mapCount; ++i) {
+      for (unsigned j = 0; j < mapSize; ++j) {
+        if (getBit(src + (i * mapWords), j)) {
+          markBit(dst, (i * mapSize) + j);
+        }
+      }
     }
   }
 
@@ -7312,6 +9560,12 @@ finish(MyThread* t, FixedAllocator* allocator, Context* context)
   unsigned total = pad(codeSize, TargetBytesPerWord)
     + pad(c->poolSize(), TargetBytesPerWord);
 
+  if (allocator->offset + total >= allocator->capacity) {
+    throwNew(t, Machine::OutOfMemoryErrorType,
+             "code area exhausted (%d bytes); see avian.jit.codeCapacity",
+             allocator->capacity);
+  }
+
   target_uintptr_t* code = static_cast<target_uintptr_t*>
     (allocator->allocate(total, TargetBytesPerWord));
   uint8_t* start = reinterpret_cast<uint8_t*>(code);
@@ -7369,7 +9623,7 @@ finish(MyThread* t, FixedAllocator* allocator, Context* context)
     object code = methodCode(t, context->method);
 
     code = makeCode
-      (t, 0, newExceptionHandlerTable, newLineNumberTable,
+      (t, 0, newExceptionHandlerTable, newLineNumberTable, 0,
        reinterpret_cast<uintptr_t>(start), codeSize, codeMaxStack(t, code),
        codeMaxLocals(t, code), 0);
 
@@ -7409,6 +9663,10 @@ finish(MyThread* t, FixedAllocator* allocator, Context* context)
           insertCallNode
             (t, makeCallNode
              (t, p->address->value(), p->target, p->flags, 0));
+
+          if (p->flags & TraceElement::Devirtualized) {
+            methodVmFlags(t, p->target) |= DevirtualizedFlag;
+          }
         }
       }
     }
@@ -7598,6 +9856,22 @@ updateCall(MyThread* t, avian::codegen::lir::UnaryOperation op, void* returnAddr
   t->arch->updateCall(op, returnAddress, target);
 }
 
+avian::codegen::lir::UnaryOperation
+updateOperation(unsigned callNodeFlags)
+{
+  if (callNodeFlags & TraceElement::LongCall) {
+    if (callNodeFlags & TraceElement::TailCall) {
+      return avian::codegen::lir::AlignedLongJump;
+    } else {
+      return avian::codegen::lir::AlignedLongCall;
+    }
+  } else if (callNodeFlags & TraceElement::TailCall) {
+    return avian::codegen::lir::AlignedJump;
+  } else {
+    return avian::codegen::lir::AlignedCall;
+  }
+}
+
 void*
 compileMethod2(MyThread* t, void* ip);
 
@@ -7834,7 +10108,7 @@ invokeNativeSlow(MyThread* t, object method, void* function)
   }
 
   while (t->reference != reference) {
-    dispose(t, t->reference);
+    freeLocalReference(t, t->reference);
   }
 
   return result;
@@ -7846,6 +10120,12 @@ invokeNative2(MyThread* t, object method)
   object native = methodRuntimeDataNative(t, getMethodRuntimeData(t, method));
   if (nativeFast(t, native)) {
     return invokeNativeFast(t, method, nativeFunction(t, native));
+  } else if (nativeCritical(t, native)) {
+    return invokeCriticalNative
+      (t, method, nativeFunction(t, native),
+       static_cast<uintptr_t*>(t->stack)
+       + t->arch->frameFooterSize()
+       + t->arch->frameReturnAddressSize());
   } else {
     return invokeNativeSlow(t, method, nativeFunction(t, native));
   }
@@ -7901,26 +10181,65 @@ invokeNative(MyThread* t)
 
   t->newStack = stack;
 
-  return result;
-}
+  return result;
+}
+
+// the method and frame map each return address seen while scanning
+// stacks for the current collection belongs to, so the identical
+// frames of a pool of threads are only looked up once
+class FrameMapCache {
+ public:
+  class Entry {
+   public:
+    void* ip;
+    object method;
+    // null if the frame map also depends on the contents of the stack
+    // (see findFrameMapInGeneralTable)
+    int32_t* map;
+    unsigned start;
+  };
+
+  Entry* entry(void* ip) {
+    uintptr_t a = reinterpret_cast<uintptr_t>(ip);
+    return entries + ((a ^ (a >> 8)) & (FrameMapCacheSize - 1));
+  }
+
+  unsigned collection;
+  Entry entries[FrameMapCacheSize];
+};
+
+FrameMapCache*
+frameMapCache(MyThread* t, unsigned worker);
 
 void
 findFrameMapInSimpleTable(MyThread* t, object method, object table,
                           int32_t offset, int32_t** map, unsigned* start)
 {
-  unsigned tableSize = simpleFrameMapTableSize(t, method, table);
-  unsigned indexSize = intArrayLength(t, table) - tableSize;
+  unsigned siteCount = intArrayBody(t, table, SimpleFrameMapSiteCount);
+  unsigned fieldBits = intArrayBody(t, table, SimpleFrameMapFieldBits);
+  unsigned offsetBits = fieldBits & 0xFF;
+  unsigned indexBits = fieldBits >> 8;
+
+  uint32_t* offsets = reinterpret_cast<uint32_t*>
+    (&intArrayBody(t, table, SimpleFrameMapHeaderSize));
 
-  *map = &intArrayBody(t, table, indexSize);
+  *map = &intArrayBody
+    (t, table, simpleFrameMapMapStart(siteCount, offsetBits, indexBits));
     
   unsigned bottom = 0;
-  unsigned top = indexSize;
+  unsigned top = siteCount;
   for (unsigned span = top - bottom; span; span = top - bottom) {
     unsigned middle = bottom + (span / 2);
-    int32_t v = intArrayBody(t, table, middle);
+    int32_t v = getBits<uint32_t>(offsets, offsetBits, middle * offsetBits);
       
     if (offset == v) {
-      *start = frameMapSizeInBits(t, method) * middle;
+      unsigned index = indexBits ? getBits<uint32_t>
+        (reinterpret_cast<uint32_t*>
+         (&intArrayBody(t, table, simpleFrameMapIndexStart
+                        (siteCount, offsetBits))),
+         indexBits, middle * indexBits) : 0;
+
+      *start = frameMapSizeInBits(t, method) * index;
       return;
     } else if (offset < v) {
       top = middle;
@@ -7989,21 +10308,24 @@ findFrameMapInGeneralTable(MyThread* t, void* stack, object method,
   abort(t);
 }
 
-void
+// returns true if the map found depends only on the offset
+bool
 findFrameMap(MyThread* t, void* stack, object method, int32_t offset,
              int32_t** map, unsigned* start)
 {
   object table = codePool(t, methodCode(t, method));
   if (objectClass(t, table) == type(t, Machine::IntArrayType)) {
     findFrameMapInSimpleTable(t, method, table, offset, map, start);
+    return true;
   } else {
     findFrameMapInGeneralTable(t, stack, method, table, offset, map, start);
+    return false;
   }
 }
 
 void
 visitStackAndLocals(MyThread* t, Heap::Visitor* v, void* frame, object method,
-                    void* ip)
+                    void* ip, FrameMapCache::Entry* cached)
 {
   unsigned count = frameMapSizeInBits(t, method);
 
@@ -8012,9 +10334,17 @@ visitStackAndLocals(MyThread* t, Heap::Visitor* v, void* frame, object method,
 
     int32_t* map;
     unsigned offset;
-    findFrameMap
-      (t, stack, method, difference
-       (ip, reinterpret_cast<void*>(methodAddress(t, method))), &map, &offset);
+    if (cached and cached->map) {
+      map = cached->map;
+      offset = cached->start;
+    } else if (findFrameMap
+               (t, stack, method, difference
+                (ip, reinterpret_cast<void*>(methodAddress(t, method))),
+                &map, &offset) and cached)
+    {
+      cached->map = map;
+      cached->start = offset;
+    }
 
     for (unsigned i = 0; i < count; ++i) {
       int j = offset + i;
@@ -8067,8 +10397,10 @@ visitArguments(MyThread* t, Heap::Visitor* v, void* stack, object method)
 }
 
 void
-visitStack(MyThread* t, Heap::Visitor* v)
+visitStack(MyThread* t, Heap::Visitor* v, unsigned worker)
 {
+  FrameMapCache* cache = frameMapCache(t, worker);
+
   void* ip = getIp(t);
   void* stack = t->stack;
 
@@ -8083,14 +10415,26 @@ visitStack(MyThread* t, Heap::Visitor* v)
       targetMethod = 0;
     }
 
-    object method = methodForIp(t, ip);
+    FrameMapCache::Entry* cached = cache ? cache->entry(ip) : 0;
+    object method;
+    if (cached and cached->ip == ip and cached->method) {
+      method = cached->method;
+    } else {
+      method = methodForIp(t, ip);
+      if (cached) {
+        cached->ip = ip;
+        cached->method = method;
+        cached->map = 0;
+      }
+    }
+
     if (method) {
       PROTECT(t, method);
 
       void* nextIp = ip;
       nextFrame(t, &nextIp, &stack, method, target, mostRecent);
 
-      visitStackAndLocals(t, v, stack, method, ip);
+      visitStackAndLocals(t, v, stack, method, ip, cached);
 
       ip = nextIp;
 
@@ -8621,8 +10965,8 @@ class ArgumentList {
   } protector;
 };
 
-object
-invoke(Thread* thread, object method, ArgumentList* arguments)
+uint64_t
+invokeUnboxed(Thread* thread, object method, ArgumentList* arguments)
 {
   MyThread* t = static_cast<MyThread*>(thread);
 
@@ -8640,7 +10984,7 @@ invoke(Thread* thread, object method, ArgumentList* arguments)
   uintptr_t stackLimit = t->stackLimit;
   uintptr_t stackPosition = reinterpret_cast<uintptr_t>(&t);
   if (stackLimit == 0) {
-    t->stackLimit = stackPosition - t->m->stackSizeInBytes;
+    t->stackLimit = stackPosition - javaStackSizeInBytes(t);
   } else if (stackPosition < stackLimit) {
     throwNew(t, Machine::StackOverflowErrorType);
   }
@@ -8679,6 +11023,15 @@ invoke(Thread* thread, object method, ArgumentList* arguments)
     vm::throw_(t, exception);
   }
 
+  return result;
+}
+
+object
+invoke(Thread* t, object method, ArgumentList* arguments)
+{
+  unsigned returnCode = methodReturnCode(t, method);
+  uint64_t result = invokeUnboxed(t, method, arguments);
+
   object r;
   switch (returnCode) {
   case ByteField:
@@ -8713,7 +11066,7 @@ invoke(Thread* thread, object method, ArgumentList* arguments)
 class SignalHandler: public System::SignalHandler {
  public:
   SignalHandler(Machine::Type type, Machine::Root root, unsigned fixedSize):
-    m(0), type(type), root(root), fixedSize(fixedSize) { }
+    m(0), next(0), type(type), root(root), fixedSize(fixedSize) { }
 
   virtual bool handleSignal(void** ip, void** frame, void** stack,
                             void** thread)
@@ -8729,13 +11082,14 @@ class SignalHandler: public System::SignalHandler {
            static_cast<void**>(*stack) - t->arch->frameReturnAddressSize(),
            t->continuation, t->trace);
 
-        if (ensure(t, fixedSize + traceSize(t))) {
+        if ((not fastThrow(t, *ip)) and ensure(t, fixedSize + traceSize(t))) {
           atomicOr(&(t->flags), Thread::TracingFlag);
           t->exception = makeThrowable(t, type);
           atomicAnd(&(t->flags), ~Thread::TracingFlag);
         } else {
-          // not enough memory available for a new exception and stack
-          // trace -- use a preallocated instance instead
+          // either this site throws too often to be worth a new
+          // exception and stack trace or there isn't enough memory
+          // available for one -- use a preallocated instance instead
           t->exception = vm::root(t, root);
         }
 
@@ -8756,15 +11110,118 @@ class SignalHandler: public System::SignalHandler {
       fflush(compileLog);
     }
 
+    dumpEventsOnCrash(m);
+
     return false;
   }
 
   Machine* m;
+  SignalHandler* next;
   Machine::Type type;
   Machine::Root root;
   unsigned fixedSize;
 };
 
+// The handlers of every machine in the process for one kind of
+// signal.  The system, which the machines share, takes one handler
+// per signal, so this one passes each signal on to the handler of the
+// machine the faulting thread belongs to.
+class SignalHandlerList: public System::SignalHandler {
+ public:
+  typedef System::Status (System::*Register)(System::SignalHandler*);
+
+  SignalHandlerList(Register register_):
+    register_(register_), first(0), writing(0), readers(0)
+  { }
+
+  virtual bool handleSignal(void** ip, void** frame, void** stack,
+                            void** thread)
+  {
+    increment(&readers, 1);
+
+    local::SignalHandler* h = first;
+    while (h and h->next and h->m->localThread->get() == 0) {
+      h = h->next;
+    }
+
+    // if the thread belongs to no machine, the last handler tried
+    // reports the crash
+    bool handled = h and h->handleSignal(ip, frame, stack, thread);
+
+    increment(&readers, -1);
+
+    return handled;
+  }
+
+  bool add(System* s, local::SignalHandler* handler) {
+    acquire(s);
+
+    bool success = true;
+    if (first == 0) {
+      success = s->success((s->*register_)(this));
+    }
+
+    if (success) {
+      handler->next = first;
+      first = handler;
+    }
+
+    release();
+
+    return success;
+  }
+
+  void remove(System* s, local::SignalHandler* handler) {
+    acquire(s);
+
+    for (local::SignalHandler** p = &first; *p; p = &((*p)->next)) {
+      if (*p == handler) {
+        *p = handler->next;
+        break;
+      }
+    }
+
+    if (first == 0) {
+      (s->*register_)(0);
+    }
+
+    release();
+
+    // a signal on another machine's thread may still be looking at the
+    // handler, which its caller is about to free
+    while (readers) {
+      s->yield();
+    }
+  }
+
+ private:
+  static void increment(uint32_t* p, int v) {
+    for (uint32_t old = *p;
+         not atomicCompareAndSwap32(p, old, old + v);
+         old = *p)
+    { }
+  }
+
+  void acquire(System* s) {
+    while (not atomicCompareAndSwap32(&writing, 0, 1)) {
+      s->yield();
+    }
+  }
+
+  void release() {
+    storeStoreMemoryBarrier();
+    writing = 0;
+  }
+
+  Register register_;
+  local::SignalHandler* first;
+  uint32_t writing;
+  uint32_t readers;
+};
+
+SignalHandlerList segFaultHandlers(&System::handleSegFault);
+SignalHandlerList divideByZeroHandlers(&System::handleDivideByZero);
+
 bool
 isThunk(MyThread* t, void* ip);
 
@@ -8782,6 +11239,9 @@ class MyProcessor;
 MyProcessor*
 processor(MyThread* t);
 
+unsigned
+compilationReport(MyThread* t, char* buffer, unsigned capacity);
+
 void
 compileThunks(MyThread* t, FixedAllocator* allocator);
 
@@ -8803,6 +11263,60 @@ public:
   Processor::CompilationHandler* handler;
 };
 
+// writes a symbol map in the format understood by the Linux perf
+// tool, which looks for /tmp/perf-<pid>.map when it finds samples in
+// anonymous executable memory
+class PerfMapHandler: public Processor::CompilationHandler {
+ public:
+  PerfMapHandler(Allocator* allocator, FILE* file):
+    allocator(allocator), file(file)
+  { }
+
+  virtual void compiled(const void* code, unsigned size, unsigned,
+                        const char* name)
+  {
+    fprintf(file, "%lx %x %s\n", reinterpret_cast<unsigned long>(code),
+            size, name);
+    fflush(file);
+  }
+
+  virtual void dispose() {
+    fclose(file);
+    allocator->free(this, sizeof(*this));
+  }
+
+  Allocator* allocator;
+  FILE* file;
+};
+
+void
+openPerfMap(Thread* t)
+{
+  // perf only exists on Linux, where /proc gives us our pid without
+  // pulling in platform headers here
+  FILE* stat = vm::fopen("/proc/self/stat", "rb");
+  if (stat == 0) {
+    return;
+  }
+
+  int pid;
+  bool found = fscanf(stat, "%d", &pid) == 1;
+  fclose(stat);
+
+  if (found) {
+    char path[64];
+    vm::snprintf(path, sizeof(path), "/tmp/perf-%d.map", pid);
+
+    FILE* file = vm::fopen(path, "wb");
+    if (file) {
+      Allocator* allocator = t->m->heap;
+      t->m->processor->addCompilationHandler
+        (new (allocator->allocate(sizeof(PerfMapHandler)))
+         PerfMapHandler(allocator, file));
+    }
+  }
+}
+
 template<class T, class C>
 int checkConstant(MyThread* t, size_t expected, T C::* field, const char* name) {
   size_t actual = reinterpret_cast<uint8_t*>(&(t->*field)) - reinterpret_cast<uint8_t*>(t);
@@ -8813,6 +11327,69 @@ int checkConstant(MyThread* t, size_t expected, T C::* field, const char* name)
   return 0;
 }
 
+void
+runCompileThread(Machine* m);
+
+// services the compile queue, which holds methods we expect to be
+// called soon, so that callers find them already compiled
+class CompileThread: public System::Runnable {
+ public:
+  CompileThread(): m(0) { }
+
+  virtual void attach(System::Thread*) {
+    // ignore
+  }
+
+  virtual void run() {
+    runCompileThread(m);
+  }
+
+  virtual bool interrupted() {
+    return false;
+  }
+
+  virtual void setInterrupted(bool) {
+    // ignore
+  }
+
+  Machine* m;
+};
+
+const unsigned CompileTimeBucketCount = 16;
+
+const unsigned SlowCompileCount = 8;
+
+const unsigned SlowCompileNameCapacity = 160;
+
+class SlowCompile {
+ public:
+  int64_t duration;
+  char name[SlowCompileNameCapacity];
+};
+
+// Counters kept as methods are compiled, guarded by Machine::classLock.
+class CompileStatistics {
+ public:
+  CompileStatistics() {
+    memset(this, 0, sizeof(*this));
+  }
+
+  uint64_t methodCount;
+  uint64_t bytecodeSize;
+  uint64_t codeSize;
+  uint64_t virtualThunkSize;
+  int64_t duration;
+  // times[i] counts compiles taking less than 2^(i+1) microseconds,
+  // and at least 2^i if i isn't zero; the last bucket has no limit
+  uint64_t times[CompileTimeBucketCount];
+  unsigned zonePeak;
+  // the slowest compiles, slowest first
+  SlowCompile slowest[SlowCompileCount];
+  // nanoseconds between summaries written to the compile log, or zero
+  int64_t reportInterval;
+  int64_t lastReport;
+};
+
 class MyProcessor: public Processor {
  public:
   class Thunk {
@@ -8846,6 +11423,8 @@ class MyProcessor: public Processor {
     roots(0),
     bootImage(0),
     heapImage(0),
+    heapCopy(0),
+    heapCopySize(0),
     codeImage(0),
     codeImageSize(0),
     segFaultHandler(Machine::NullPointerExceptionType,
@@ -8857,8 +11436,16 @@ class MyProcessor: public Processor {
     codeAllocator(s, 0, 0),
     callTableSize(0),
     useNativeFeatures(useNativeFeatures),
-    compilationHandlers(0)
+    compilationHandlers(0),
+    compileLock(0),
+    compileQueueLength(0),
+    compileThreadStarted(false),
+    methodTreeVersion(0),
+    largeCodePages(false),
+    fastThrowLimit(0)
   {
+    memset(frameMapCaches, 0, sizeof(frameMapCaches));
+
     thunkTable[compileMethodIndex] = voidPointer(local::compileMethod);
     thunkTable[compileVirtualMethodIndex] = voidPointer(compileVirtualMethod);
     thunkTable[invokeNativeIndex] = voidPointer(invokeNative);
@@ -8905,7 +11492,8 @@ class MyProcessor: public Processor {
       checkConstant(t, TARGET_THREAD_HEAPIMAGE, &MyThread::heapImage, "TARGET_THREAD_HEAPIMAGE") +
       checkConstant(t, TARGET_THREAD_CODEIMAGE, &MyThread::codeImage, "TARGET_THREAD_CODEIMAGE") +
       checkConstant(t, TARGET_THREAD_THUNKTABLE, &MyThread::thunkTable, "TARGET_THREAD_THUNKTABLE") +
-      checkConstant(t, TARGET_THREAD_STACKLIMIT, &MyThread::stackLimit, "TARGET_THREAD_STACKLIMIT");
+      checkConstant(t, TARGET_THREAD_STACKLIMIT, &MyThread::stackLimit, "TARGET_THREAD_STACKLIMIT") +
+      checkConstant(t, TARGET_THREAD_SAFEPOINT, &MyThread::safepoint, "TARGET_THREAD_SAFEPOINT");
 
     if(mismatches > 0) {
       fprintf(stderr, "%d constant mismatches\n", mismatches);
@@ -8965,7 +11553,7 @@ class MyProcessor: public Processor {
     return vm::makeClass
       (t, flags, vmFlags, fixedSize, arrayElementSize, arrayDimensions,
        0, objectMask, name, sourceFile, super, interfaceTable, virtualTable,
-       fieldTable, methodTable, staticTable, addendum, loader, 0,
+       fieldTable, methodTable, staticTable, addendum, loader, 0, 0, 0, 0,
        vtableLength);
   }
 
@@ -8981,7 +11569,39 @@ class MyProcessor: public Processor {
   }
 
   virtual void
-  visitObjects(Thread* vmt, Heap::Visitor* v)
+  methodOverridden(Thread* vmt, object method)
+  {
+    MyThread* t = static_cast<MyThread*>(vmt);
+
+    PROTECT(t, method);
+
+    ACQUIRE(t, t->m->classLock);
+
+    methodVmFlags(t, method) |= OverriddenFlag;
+
+    if (methodVmFlags(t, method) & DevirtualizedFlag) {
+      // send calls which were bound directly to this method through
+      // the vtable from now on
+      void* thunk = reinterpret_cast<void*>
+        (dispatchThunk(t, methodOffset(t, method)));
+
+      object table = root(t, CallTable);
+      for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+        for (object n = arrayBody(t, table, i); n; n = callNodeNext(t, n)) {
+          if ((callNodeFlags(t, n) & TraceElement::Devirtualized)
+              and callNodeTarget(t, n) == method)
+          {
+            updateCall
+              (t, updateOperation(callNodeFlags(t, n)),
+               reinterpret_cast<void*>(callNodeAddress(t, n)), thunk);
+          }
+        }
+      }
+    }
+  }
+
+  virtual void
+  visitObjects(Thread* vmt, Heap::Visitor* v, unsigned worker)
   {
     MyThread* t = static_cast<MyThread*>(vmt);
 
@@ -8998,11 +11618,17 @@ class MyProcessor: public Processor {
 
     v->visit(&(t->continuation));
 
+    v->visit(&(t->methodCache));
+
+    for (unsigned i = 0; i < HandlerCacheSize; ++i) {
+      v->visit(&(t->handlerCache[i].type));
+    }
+
     for (Reference* r = t->reference; r; r = r->next) {
       v->visit(&(r->target));
     }
 
-    visitStack(t, v);
+    visitStack(t, v, worker);
   }
 
   virtual void
@@ -9014,6 +11640,12 @@ class MyProcessor: public Processor {
     walker.walk(v);
   }
 
+  virtual void
+  requestSafepoint(Thread*, Thread* target)
+  {
+    static_cast<MyThread*>(target)->safepoint = 1;
+  }
+
   virtual int
   lineNumber(Thread* vmt, object method, int ip)
   {
@@ -9034,8 +11666,7 @@ class MyProcessor: public Processor {
         }
       }
 
-      Reference* r = new (t->m->heap->allocate(sizeof(Reference)))
-        Reference(o, &(t->reference), false);
+      Reference* r = newLocalReference(t, o);
 
       acquire(t, r);
 
@@ -9046,10 +11677,15 @@ class MyProcessor: public Processor {
   }
 
   virtual void
-  disposeLocalReference(Thread* t, object* r)
+  disposeLocalReference(Thread* vmt, object* r)
   {
     if (r) {
-      release(t, reinterpret_cast<Reference*>(r));
+      MyThread* t = static_cast<MyThread*>(vmt);
+      Reference* reference = reinterpret_cast<Reference*>(r);
+
+      if ((-- reference->count) == 0) {
+        freeLocalReference(t, reference);
+      }
     }
   }
 
@@ -9058,9 +11694,17 @@ class MyProcessor: public Processor {
   {
     MyThread* t = static_cast<MyThread*>(vmt);
 
-    t->referenceFrame = new
-      (t->m->heap->allocate(sizeof(MyThread::ReferenceFrame)))
-      MyThread::ReferenceFrame(t->referenceFrame, t->reference);
+    void* p;
+    if (t->referenceFramePool) {
+      p = t->referenceFramePool;
+      t->referenceFramePool = t->referenceFramePool->next;
+      -- t->referenceFramePoolSize;
+    } else {
+      p = t->m->heap->allocate(sizeof(MyThread::ReferenceFrame));
+    }
+
+    t->referenceFrame = new (p) MyThread::ReferenceFrame
+      (t->referenceFrame, t->reference);
     
     return true;
   }
@@ -9073,10 +11717,16 @@ class MyProcessor: public Processor {
     MyThread::ReferenceFrame* f = t->referenceFrame;
     t->referenceFrame = f->next;
     while (t->reference != f->reference) {
-      vm::dispose(t, t->reference);
+      freeLocalReference(t, t->reference);
     }
 
-    t->m->heap->free(f, sizeof(MyThread::ReferenceFrame));
+    if (t->referenceFramePoolSize < ReferenceFramePoolLimit) {
+      f->next = t->referenceFramePool;
+      t->referenceFramePool = f;
+      ++ t->referenceFramePoolSize;
+    } else {
+      t->m->heap->free(f, sizeof(MyThread::ReferenceFrame));
+    }
   }
 
   virtual object
@@ -9139,6 +11789,37 @@ class MyProcessor: public Processor {
     return local::invoke(t, method, &list);
   }
 
+  virtual uint64_t
+  invokeUnboxed(Thread* t, object method, object this_,
+                const jvalue* arguments)
+  {
+    assert(t, t->exception == 0);
+
+    assert(t, t->state == Thread::ActiveState
+           or t->state == Thread::ExclusiveState);
+
+    assert(t, ((methodFlags(t, method) & ACC_STATIC) == 0) xor (this_ == 0));
+    
+    method = findMethod(t, method, this_);
+
+    const char* spec = reinterpret_cast<char*>
+      (&byteArrayBody(t, methodSpec(t, method), 0));
+
+    unsigned size = methodParameterFootprint(t, method);
+    THREAD_RUNTIME_ARRAY(t, uintptr_t, array, size);
+    THREAD_RUNTIME_ARRAY(t, bool, objectMask, size);
+    ArgumentList list
+      (t, RUNTIME_ARRAY_BODY(array), size, RUNTIME_ARRAY_BODY(objectMask),
+       this_, spec, arguments);
+
+    PROTECT(t, method);
+
+    compile(static_cast<MyThread*>(t),
+            local::codeAllocator(static_cast<MyThread*>(t)), 0, method);
+
+    return local::invokeUnboxed(t, method, &list);
+  }
+
   virtual object
   invokeList(Thread* t, object method, object this_, bool indirectObjects,
              va_list arguments)
@@ -9207,8 +11888,23 @@ class MyProcessor: public Processor {
       vm::dispose(t, t->reference);
     }
 
+    while (t->referencePool) {
+      Reference* r = t->referencePool;
+      t->referencePool = r->next;
+      categoryAllocator(t->m, ReferenceMemory)->free
+        (r, sizeof(Reference));
+    }
+
+    while (t->referenceFramePool) {
+      MyThread::ReferenceFrame* f = t->referenceFramePool;
+      t->referenceFramePool = f->next;
+      t->m->heap->free(f, sizeof(MyThread::ReferenceFrame));
+    }
+
     t->arch->release();
 
+    t->zonePool.dispose(t->m->heap);
+
     t->m->heap->free(t, sizeof(*t));
 
   }
@@ -9216,13 +11912,31 @@ class MyProcessor: public Processor {
   virtual void dispose() {
     if (codeAllocator.base) {
 #if !defined(AVIAN_AOT_ONLY)
-      s->freeExecutable(codeAllocator.base, codeAllocator.capacity);
+      s->freeExecutable
+        (codeAllocator.base, codeAllocator.capacity, largeCodePages);
 #endif
     }
 
     compilationHandlers->dispose(allocator);
 
-    s->handleSegFault(0);
+    if (compileLock) {
+      compileLock->dispose();
+    }
+
+    if (segFaultHandler.m) {
+      segFaultHandlers.remove(s, &segFaultHandler);
+      divideByZeroHandlers.remove(s, &divideByZeroHandler);
+    }
+
+    if (heapCopy) {
+      allocator->free(heapCopy, heapCopySize);
+    }
+
+    for (unsigned i = 0; i < MaxFrameMapCaches; ++i) {
+      if (frameMapCaches[i]) {
+        s->free(frameMapCaches[i]);
+      }
+    }
 
     allocator->free(this, sizeof(*this));
   }
@@ -9230,16 +11944,50 @@ class MyProcessor: public Processor {
   virtual object getStackTrace(Thread* vmt, Thread* vmTarget) {
     MyThread* t = static_cast<MyThread*>(vmt);
     MyThread* target = static_cast<MyThread*>(vmTarget);
-    MyProcessor* p = this;
+
+    class Visitor: public Thread::Handshake {
+     public:
+      Visitor(): trace(0) { }
+
+      virtual void run(Thread* t, Thread* target) {
+        // the target is stopped at a safepoint or in native code, so
+        // its saved context (MyThread::stack, etc.) is accurate
+        if (ensure(t, traceSize(target))) {
+          atomicOr(&(t->flags), Thread::TracingFlag);
+          trace = makeTrace(t, target);
+          atomicAnd(&(t->flags), ~Thread::TracingFlag);
+        }
+      }
+
+      object trace;
+    } visitor;
+
+    handshake(t, target, &visitor);
+
+    if (UNLIKELY(t->flags & Thread::UseBackupHeapFlag)) {
+      PROTECT(t, visitor.trace);
+
+      collect(t, Heap::MinorCollection);
+    }
+
+    return visitor.trace ? visitor.trace : makeObjectArray(t, 0);
+  }
+
+  virtual bool sampleStack(Thread* vmt, Thread* vmTarget,
+                           StackVisitor* v)
+  {
+    MyThread* t = static_cast<MyThread*>(vmt);
+    MyThread* target = static_cast<MyThread*>(vmTarget);
 
     class Visitor: public System::ThreadVisitor {
      public:
-      Visitor(MyThread* t, MyProcessor* p, MyThread* target):
-        t(t), p(p), target(target), trace(0)
+      Visitor(MyThread* t, MyThread* target, StackVisitor* v):
+        t(t), target(target), v(v)
       { }
 
       virtual void visit(void* ip, void* stack, void* link) {
         MyThread::TraceContext c(target, link);
+        c.sampling = true;
 
         if (methodForIp(t, ip)) {
           // we caught the thread in Java code - use the register values
@@ -9270,7 +12018,7 @@ class MyProcessor: public Processor {
         } else if (isThunk(t, ip) or isVirtualThunk(t, ip)) {
           // we caught the thread in a thunk where the stack register
           // indicates the most recent Java frame on the stack
-          
+
           // On e.g. x86, the return address will have already been
           // pushed onto the stack, in which case we use getIp to
           // retrieve it.  On e.g. PowerPC and ARM, it will be in the
@@ -9288,28 +12036,28 @@ class MyProcessor: public Processor {
           c.stack = 0;
         }
 
-        if (ensure(t, traceSize(target))) {
-          atomicOr(&(t->flags), Thread::TracingFlag);
-          trace = makeTrace(t, target);
-          atomicAnd(&(t->flags), ~Thread::TracingFlag);
-        }
+        MyStackWalker walker(target);
+        walker.walk(v);
       }
 
       MyThread* t;
-      MyProcessor* p;
       MyThread* target;
-      object trace;
-    } visitor(t, p, target);
+      StackVisitor* v;
+    } visitor(t, target, v);
 
-    t->m->system->visit(t->systemThread, target->systemThread, &visitor);
-
-    if (UNLIKELY(t->flags & Thread::UseBackupHeapFlag)) {
-      PROTECT(t, visitor.trace);
+    return t->m->system->success
+      (t->m->system->visit(t->systemThread, target->systemThread, &visitor));
+  }
 
-      collect(t, Heap::MinorCollection);
-    }
+  virtual unsigned compilationReport(Thread* t, char* buffer,
+                                     unsigned capacity)
+  {
+    return local::compilationReport
+      (static_cast<MyThread*>(t), buffer, capacity);
+  }
 
-    return visitor.trace ? visitor.trace : makeObjectArray(t, 0);
+  virtual unsigned codeFootprint() {
+    return codeAllocator.offset;
   }
 
   virtual void initialize(BootImage* image, uint8_t* code, unsigned capacity) {
@@ -9378,11 +12126,29 @@ class MyProcessor: public Processor {
   }
 
   virtual void boot(Thread* t, BootImage* image, uint8_t* code) {
+    const char* perfMap = findProperty(t, "avian.perfmap");
+    if (perfMap and strcmp(perfMap, "true") == 0) {
+      openPerfMap(t);
+    }
+
 #if !defined(AVIAN_AOT_ONLY)
     if (codeAllocator.base == 0) {
+      unsigned capacity = ExecutableAreaSizeInBytes;
+      const char* property = findProperty(t, "avian.jit.codeCapacity");
+      if (property) {
+        int value = atoi(property);
+        if (value > 0) {
+          capacity = min
+            (static_cast<unsigned>(value), MaximumExecutableAreaSizeInBytes);
+        }
+      }
+
+      property = findProperty(t, "avian.largePages");
+      largeCodePages = property and ::strcmp(property, "true") == 0;
+
       codeAllocator.base = static_cast<uint8_t*>
-        (s->tryAllocateExecutable(ExecutableAreaSizeInBytes));
-      codeAllocator.capacity = ExecutableAreaSizeInBytes;
+        (s->tryAllocateExecutable(capacity, largeCodePages));
+      codeAllocator.capacity = capacity;
     }
 #endif
 
@@ -9412,12 +12178,31 @@ class MyProcessor: public Processor {
 #endif
 
     segFaultHandler.m = t->m;
-    expect(t, t->m->system->success
-           (t->m->system->handleSegFault(&segFaultHandler)));
+    expect(t, segFaultHandlers.add(t->m->system, &segFaultHandler));
 
     divideByZeroHandler.m = t->m;
-    expect(t, t->m->system->success
-           (t->m->system->handleDivideByZero(&divideByZeroHandler)));
+    expect(t, divideByZeroHandlers.add(t->m->system, &divideByZeroHandler));
+
+    const char* limit = findProperty(t, "avian.jit.fastThrowLimit");
+    if (limit) {
+      int value = atoi(limit);
+      if (value > 0) {
+        fastThrowLimit = value;
+      }
+    }
+
+    const char* interval = findProperty(t, "avian.jit.statistics");
+    if (interval and atoi(interval) > 0) {
+      compileStatistics.reportInterval
+        = static_cast<int64_t>(atoi(interval)) * 1000 * 1000 * 1000;
+      compileStatistics.lastReport = t->m->system->nanoTime();
+    }
+
+    const char* background = findProperty(t, "avian.jit.background");
+    if (background and strcmp(background, "true") == 0) {
+      expect(t, t->m->system->success(t->m->system->make(&compileLock)));
+      compileThread.m = t->m;
+    }
   }
 
   virtual void callWithCurrentContinuation(Thread* t, object receiver) {
@@ -9473,6 +12258,9 @@ class MyProcessor: public Processor {
   object roots;
   BootImage* bootImage;
   uintptr_t* heapImage;
+  // this processor's copy of a shared boot image's heap, if any
+  uintptr_t* heapCopy;
+  unsigned heapCopySize;
   uint8_t* codeImage;
   unsigned codeImageSize;
   SignalHandler segFaultHandler;
@@ -9484,6 +12272,16 @@ class MyProcessor: public Processor {
   bool useNativeFeatures;
   void* thunkTable[dummyIndex + 1];
   CompilationHandlerList* compilationHandlers;
+  System::Monitor* compileLock;
+  unsigned compileQueueLength;
+  bool compileThreadStarted;
+  unsigned methodTreeVersion;
+  bool largeCodePages;
+  unsigned fastThrowLimit;
+  CompileThread compileThread;
+  CompileStatistics compileStatistics;
+  // one per collector thread scanning stacks, made as needed
+  FrameMapCache* frameMapCaches[MaxFrameMapCaches];
 };
 
 const char*
@@ -9529,7 +12327,7 @@ logCompile(MyThread* t, const void* code, unsigned size, const char* class_,
 
   MyProcessor* p = static_cast<MyProcessor*>(t->m->processor);
   for(CompilationHandlerList* h = p->compilationHandlers; h; h = h->next) {
-    h->handler->compiled(code, 0, 0, RUNTIME_ARRAY_BODY(completeName));
+    h->handler->compiled(code, size, 0, RUNTIME_ARRAY_BODY(completeName));
   }
 }
 
@@ -9542,11 +12340,25 @@ compileMethod2(MyThread* t, void* ip)
   PROTECT(t, node);
   PROTECT(t, target);
 
+  // a devirtualized call whose target has been overridden since the
+  // caller was compiled goes wherever a vtable call would.  The class
+  // of any receiver which overrides it was loaded before the receiver
+  // was made, so the flag is already set for such a receiver.
   t->trace->targetMethod = target;
 
-  THREAD_RESOURCE0(t, static_cast<MyThread*>(t)->trace->targetMethod = 0);
+  THREAD_RESOURCE0(t, static_cast<MyThread*>(t)->trace->targetMethod = 0);
+
+  object method = target;
+  PROTECT(t, method);
+
+  if ((callNodeFlags(t, node) & TraceElement::Devirtualized)
+      and (methodVmFlags(t, target) & OverriddenFlag))
+  {
+    method = resolveTarget(t, t->stack, target);
+    t->trace->targetMethod = method;
+  }
 
-  compile(t, codeAllocator(t), 0, target);
+  compile(t, codeAllocator(t), 0, method);
 
   uint8_t* updateIp = static_cast<uint8_t*>(ip);
 
@@ -9556,28 +12368,37 @@ compileMethod2(MyThread* t, void* ip)
     or updateIp >= p->codeImage + p->codeImageSize;
 
   uintptr_t address;
-  if (methodFlags(t, target) & ACC_NATIVE) {
+  if (methodFlags(t, method) & ACC_NATIVE) {
     address = useLongJump(t, reinterpret_cast<uintptr_t>(ip))
       or (not updateCaller) ? bootNativeThunk(t) : nativeThunk(t);
+
+    if (method != target) {
+      t->trace->nativeMethod = method;
+    }
   } else {
-    address = methodAddress(t, target);
+    address = methodAddress(t, method);
   }
 
   if (updateCaller) {
-    avian::codegen::lir::UnaryOperation op;
-    if (callNodeFlags(t, node) & TraceElement::LongCall) {
-      if (callNodeFlags(t, node) & TraceElement::TailCall) {
-        op = avian::codegen::lir::AlignedLongJump;
+    avian::codegen::lir::UnaryOperation op
+      = updateOperation(callNodeFlags(t, node));
+
+    if (callNodeFlags(t, node) & TraceElement::Devirtualized) {
+      // the target may have been overridden since the caller was
+      // compiled, in which case later calls go through the dispatch
+      // thunk, and MyProcessor::methodOverridden may already have
+      // redirected this one
+      ACQUIRE(t, t->m->classLock);
+
+      if (methodVmFlags(t, target) & OverriddenFlag) {
+        updateCall(t, op, updateIp, reinterpret_cast<void*>
+                   (dispatchThunk(t, methodOffset(t, target))));
       } else {
-        op = avian::codegen::lir::AlignedLongCall;
+        updateCall(t, op, updateIp, reinterpret_cast<void*>(address));
       }
-    } else if (callNodeFlags(t, node) & TraceElement::TailCall) {
-      op = avian::codegen::lir::AlignedJump;
     } else {
-      op = avian::codegen::lir::AlignedCall;
+      updateCall(t, op, updateIp, reinterpret_cast<void*>(address));
     }
-
-    updateCall(t, op, updateIp, reinterpret_cast<void*>(address));
   }
 
   return reinterpret_cast<void*>(address);
@@ -9670,6 +12491,15 @@ isThunkUnsafeStack(MyThread* t, void* ip)
          or isThunkUnsafeStack(&(p->bootThunks), ip));
 }
 
+unsigned
+callTableIndex(intptr_t key, unsigned length)
+{
+  // return addresses are instruction-aligned on some architectures, so
+  // fold the low bits in rather than masking them off directly
+  uintptr_t k = static_cast<uintptr_t>(key);
+  return (k ^ (k >> 2)) & (length - 1);
+}
+
 object
 findCallNode(MyThread* t, void* address)
 {
@@ -9685,7 +12515,7 @@ findCallNode(MyThread* t, void* address)
   object table = root(t, CallTable);
 
   intptr_t key = reinterpret_cast<intptr_t>(address);
-  unsigned index = static_cast<uintptr_t>(key) & (arrayLength(t, table) - 1);
+  unsigned index = callTableIndex(key, arrayLength(t, table));
 
   for (object n = arrayBody(t, table, index);
        n; n = callNodeNext(t, n))
@@ -9718,7 +12548,7 @@ resizeTable(MyThread* t, object oldTable, unsigned newLength)
     {
       intptr_t k = callNodeAddress(t, oldNode);
 
-      unsigned index = k & (newLength - 1);
+      unsigned index = callTableIndex(k, newLength);
 
       object newNode = makeCallNode
         (t, callNodeAddress(t, oldNode),
@@ -9751,9 +12581,15 @@ insertCallNode(MyThread* t, object table, unsigned* size, object node)
   }
 
   intptr_t key = callNodeAddress(t, node);
-  unsigned index = static_cast<uintptr_t>(key) & (arrayLength(t, table) - 1);
+  unsigned index = callTableIndex(key, arrayLength(t, table));
 
   set(t, node, CallNodeNext, arrayBody(t, table, index));
+
+  // findCallNode reads the table without locking, so the node (and any
+  // table built by resizeTable above) must be fully initialized before
+  // it becomes reachable
+  storeStoreMemoryBarrier();
+
   set(t, table, ArrayBody + (index * BytesPerWord), node);
 
   return table;
@@ -9844,8 +12680,15 @@ fixupHeap(MyThread* t UNUSED, uintptr_t* map, unsigned size, uintptr_t* heap)
   for (unsigned word = 0; word < size; ++word) {
     uintptr_t w = map[word];
     if (w) {
-      for (unsigned bit = 0; bit < BitsPerWord; ++bit) {
-        if (w & (static_cast<uintptr_t>(1) << bit)) {
+      // stop as soon as no set bits remain, skipping runs of clear
+      // ones a byte at a time
+      for (unsigned bit = 0; w; ++bit, w >>= 1) {
+        while ((w & 0xFF) == 0) {
+          w >>= 8;
+          bit += 8;
+        }
+
+        if (w & 1) {
           unsigned index = indexOf(word, bit);
 
           uintptr_t* p = heap + index;
@@ -9866,26 +12709,71 @@ fixupHeap(MyThread* t UNUSED, uintptr_t* map, unsigned size, uintptr_t* heap)
   }
 }
 
-void
-resetClassRuntimeState(Thread* t, object c, uintptr_t* heap, unsigned heapSize)
+// Moves a reference which another machine fixed up to point into the
+// boot image heap at "from" so that it points into the copy at "to".
+// Only fixed objects in the image may refer to the heap of the
+// machine which owns it, and those references are dropped.
+uintptr_t
+rebase(uintptr_t v, uintptr_t* from, uintptr_t* to, unsigned size)
 {
-  classRuntimeDataIndex(t, c) = 0;
+  uintptr_t* p = reinterpret_cast<uintptr_t*>(v & PointerMask);
+  if (p >= from and p < from + size) {
+    return reinterpret_cast<uintptr_t>(to + (p - from)) | (v & ~PointerMask);
+  } else if (p >= to and p < to + size) {
+    return v;
+  } else {
+    return v & ~PointerMask;
+  }
+}
 
-  if (classArrayElementSize(t, c) == 0) {
-    object staticTable = classStaticTable(t, c);
-    if (staticTable) {
-      for (unsigned i = 0; i < singletonCount(t, staticTable); ++i) {
-        if (singletonIsObject(t, staticTable, i)
-            and (reinterpret_cast<uintptr_t*>
-                 (singletonObject(t, staticTable, i)) < heap or
-                 reinterpret_cast<uintptr_t*>
-                 (singletonObject(t, staticTable, i)) > heap + heapSize))
-        {
-          singletonObject(t, staticTable, i) = 0;
-        }
+void
+rebaseHeap(uintptr_t* map, unsigned mapSize, uintptr_t* from, uintptr_t* to,
+           unsigned size)
+{
+  for (unsigned word = 0; word < mapSize; ++word) {
+    for (uintptr_t w = map[word], bit = 0; w; ++bit, w >>= 1) {
+      if (w & 1) {
+        uintptr_t* p = to + indexOf(word, bit);
+        *p = rebase(*p, from, to, size);
       }
     }
   }
+}
+
+void
+rebaseObject(Thread* t, object o, uintptr_t* from, uintptr_t* to,
+             unsigned size)
+{
+  class Walker: public Heap::Walker {
+   public:
+    Walker(object o, uintptr_t* from, uintptr_t* to, unsigned size):
+      o(o), from(from), to(to), size(size)
+    { }
+
+    bool visit(unsigned offset) {
+      uintptr_t* p = &fieldAtOffset<uintptr_t>(o, offset * BytesPerWord);
+      *p = rebase(*p, from, to, size);
+      return true;
+    }
+
+    object o;
+    uintptr_t* from;
+    uintptr_t* to;
+    unsigned size;
+  } walker(o, from, to, size);
+
+  walk(t, &walker, o, 0);
+}
+
+void
+resetClassRuntimeState(Thread* t, object c, uintptr_t* from, uintptr_t* to,
+                       unsigned size)
+{
+  classRuntimeDataIndex(t, c) = 0;
+
+  if (classArrayElementSize(t, c) == 0 and classStaticTable(t, c)) {
+    rebaseObject(t, classStaticTable(t, c), from, to, size);
+  }
 
   if (classMethodTable(t, c)) {
     for (unsigned i = 0; i < arrayLength(t, classMethodTable(t, c)); ++i) {
@@ -9896,7 +12784,7 @@ resetClassRuntimeState(Thread* t, object c, uintptr_t* heap, unsigned heapSize)
 
       if (methodVmFlags(t, m) & ClassInitFlag) {
         classVmFlags(t, c) |= NeedInitFlag;
-        classVmFlags(t, c) &= ~InitErrorFlag;
+        classVmFlags(t, c) &= ~(InitFlag | InitErrorFlag);
       }
     }
   }
@@ -9905,10 +12793,28 @@ resetClassRuntimeState(Thread* t, object c, uintptr_t* heap, unsigned heapSize)
 }
 
 void
-resetRuntimeState(Thread* t, object map, uintptr_t* heap, unsigned heapSize)
+resetRuntimeState(Thread* t, object map, uintptr_t* from, uintptr_t* to,
+                  unsigned size)
 {
   for (HashMapIterator it(t, map); it.hasMore();) {
-    resetClassRuntimeState(t, tripleSecond(t, it.next()), heap, heapSize);
+    resetClassRuntimeState(t, tripleSecond(t, it.next()), from, to, size);
+  }
+}
+
+// drops the virtual thunks which the machine that owns the image
+// compiled for itself, since they are not part of the code image
+void
+resetVirtualThunks(MyThread* t, uint8_t* code, unsigned codeSize)
+{
+  for (unsigned i = 0; i < wordArrayLength(t, root(t, VirtualThunks)); i += 2)
+  {
+    uintptr_t start = wordArrayBody(t, root(t, VirtualThunks), i);
+    if (start < reinterpret_cast<uintptr_t>(code)
+        or start >= reinterpret_cast<uintptr_t>(code) + codeSize)
+    {
+      wordArrayBody(t, root(t, VirtualThunks), i) = 0;
+      wordArrayBody(t, root(t, VirtualThunks), i + 1) = 0;
+    }
   }
 }
 
@@ -9928,7 +12834,9 @@ fixupMethods(Thread* t, object map, BootImage* image UNUSED, uint8_t* code)
           codeCompiled(t, methodCode(t, method))
             = methodCompiled(t, method) + reinterpret_cast<uintptr_t>(code);
 
-          if (DebugCompile) {
+          if (DebugCompile or processor
+              (static_cast<MyThread*>(t))->compilationHandlers)
+          {
             logCompile
               (static_cast<MyThread*>(t),
                reinterpret_cast<uint8_t*>(methodCompiled(t, method)),
@@ -9983,6 +12891,46 @@ fixupVirtualThunks(MyThread* t, uint8_t* code)
   }
 }
 
+// guards the initialized field of every boot image in the process,
+// since BootImage is packed and the field may not be aligned for
+// atomic access
+uint32_t bootImageLock = 0;
+
+void
+setBootImageState(System* s, BootImage* image, unsigned from, unsigned to,
+                  unsigned* state)
+{
+  while (not atomicCompareAndSwap32(&bootImageLock, 0, 1)) {
+    s->yield();
+  }
+
+  *state = image->initialized;
+  if (*state == from) {
+    image->initialized = to;
+  }
+
+  storeStoreMemoryBarrier();
+  bootImageLock = 0;
+}
+
+// moves image->initialized from 0 to 1, returning what it was, and
+// waits while another machine has it at 1
+unsigned
+claimBootImage(System* s, BootImage* image)
+{
+  unsigned state;
+  for (setBootImageState(s, image, 0, 1, &state);
+       state == 1;
+       setBootImageState(s, image, 0, 1, &state))
+  {
+    s->yield();
+  }
+
+  loadMemoryBarrier();
+
+  return state;
+}
+
 void
 boot(MyThread* t, BootImage* image, uint8_t* code)
 {
@@ -10002,6 +12950,33 @@ boot(MyThread* t, BootImage* image, uint8_t* code)
 
   MyProcessor* p = static_cast<MyProcessor*>(t->m->processor);
 
+  // The first machine to boot from an image fixes up its heap, which
+  // holds the classes and their statics, where it is.  The image may
+  // be shared by several machines in the process, though, unless the
+  // machine decoded it for itself, so image->initialized goes from 0
+  // to 1 while the first fixes it up and to 2 once it is done.  Any
+  // later machine copies the heap, moves the references in the copy to
+  // it and resets the runtime state the first left in the classes.
+  // The code and tables are only read and stay where they are, since
+  // compiled code finds the heap through the thread rather than by
+  // address.
+  bool claimed = false;
+  uintptr_t* shared = 0;
+  if (image != t->m->bootimage) {
+    if (claimBootImage(t->m->system, image) == 0) {
+      claimed = true;
+    } else {
+      shared = heap;
+      p->heapCopy = static_cast<uintptr_t*>
+        (p->allocator->allocate(image->heapSize));
+      p->heapCopySize = image->heapSize;
+      memcpy(p->heapCopy, shared, image->heapSize);
+      heap = p->heapCopy;
+    }
+  }
+
+  unsigned heapSizeInWords = image->heapSize / BytesPerWord;
+
   t->heapImage = p->heapImage = heap;
 
   // fprintf(stderr, "heap from %p to %p\n",
@@ -10013,11 +12988,13 @@ boot(MyThread* t, BootImage* image, uint8_t* code)
   // fprintf(stderr, "code from %p to %p\n",
   //         code, code + image->codeSize);
  
-  if (not image->initialized) {
+  if (shared) {
+    rebaseHeap(heapMap, heapMapSizeInWords, shared, heap, heapSizeInWords);
+  } else {
     fixupHeap(t, heapMap, heapMapSizeInWords, heap);
   }
-  
-  t->m->heap->setImmortalHeap(heap, image->heapSize / BytesPerWord);
+
+  t->m->heap->setImmortalHeap(heap, heapSizeInWords);
 
   t->m->types = bootObject(heap, image->types);
 
@@ -10026,6 +13003,13 @@ boot(MyThread* t, BootImage* image, uint8_t* code)
   setRoot(t, Machine::BootLoader, bootObject(heap, image->bootLoader));
   setRoot(t, Machine::AppLoader, bootObject(heap, image->appLoader));
 
+  if (shared) {
+    rebaseObject
+      (t, root(t, Machine::BootLoader), shared, heap, heapSizeInWords);
+    rebaseObject
+      (t, root(t, Machine::AppLoader), shared, heap, heapSizeInWords);
+  }
+
   p->roots = makeArray(t, RootCount);
   
   setRoot(t, MethodTree, bootObject(heap, image->methodTree));
@@ -10060,18 +13044,21 @@ boot(MyThread* t, BootImage* image, uint8_t* code)
     
   findThunks(t, image, code);
 
-  if (image->initialized) {
+  if (shared) {
+    resetVirtualThunks(t, code, image->codeSize);
+
     resetRuntimeState
-      (t, classLoaderMap(t, root(t, Machine::BootLoader)), heap,
-       image->heapSize);
+      (t, classLoaderMap(t, root(t, Machine::BootLoader)), shared, heap,
+       heapSizeInWords);
 
     resetRuntimeState
-      (t, classLoaderMap(t, root(t, Machine::AppLoader)), heap,
-       image->heapSize);
+      (t, classLoaderMap(t, root(t, Machine::AppLoader)), shared, heap,
+       heapSizeInWords);
 
     for (unsigned i = 0; i < arrayLength(t, t->m->types); ++i) {
       resetClassRuntimeState
-        (t, type(t, static_cast<Machine::Type>(i)), heap, image->heapSize);
+        (t, type(t, static_cast<Machine::Type>(i)), shared, heap,
+         heapSizeInWords);
     }
   } else {
     fixupVirtualThunks(t, code);
@@ -10083,7 +13070,10 @@ boot(MyThread* t, BootImage* image, uint8_t* code)
       (t, classLoaderMap(t, root(t, Machine::AppLoader)), image, code);
   }
 
-  image->initialized = true;
+  if (claimed) {
+    unsigned state;
+    setBootImageState(t->m->system, image, 1, 2, &state);
+  }
 
   setRoot(t, Machine::BootstrapClassMap, makeHashMap(t, 0, 0));
 }
@@ -10334,6 +13324,78 @@ processor(MyThread* t)
   return static_cast<MyProcessor*>(t->m->processor);
 }
 
+// the cache for the specified collector thread, emptied if it was
+// filled by an earlier collection, or null if there is none.  An
+// entry's method may be a copy the collection is leaving behind, but
+// that stays readable until the collection ends.
+FrameMapCache*
+frameMapCache(MyThread* t, unsigned worker)
+{
+  if ((not t->m->collecting) or worker >= MaxFrameMapCaches) {
+    return 0;
+  }
+
+  MyProcessor* p = processor(t);
+  FrameMapCache* cache = p->frameMapCaches[worker];
+  if (cache == 0) {
+    cache = static_cast<FrameMapCache*>
+      (p->s->tryAllocate(sizeof(FrameMapCache)));
+    if (cache == 0) {
+      return 0;
+    }
+    cache->collection = t->m->collectionCount - 1;
+    p->frameMapCaches[worker] = cache;
+  }
+
+  if (cache->collection != t->m->collectionCount) {
+    memset(cache->entries, 0, sizeof(cache->entries));
+    cache->collection = t->m->collectionCount;
+  }
+
+  return cache;
+}
+
+unsigned&
+methodTreeVersion(MyThread* t)
+{
+  return processor(t)->methodTreeVersion;
+}
+
+// Code which uses implicit exceptions for control flow tends to
+// throw them from the same place over and over and never look at
+// their stack traces, so once a site has thrown the number of times
+// given by avian.jit.fastThrowLimit, it reuses a preallocated,
+// stackless instance instead of making a new one.  Returns true if
+// the site at the specified address has reached that point.
+bool
+fastThrow(MyThread* t, void* ip)
+{
+  unsigned limit = processor(t)->fastThrowLimit;
+  if (limit == 0) {
+    return false;
+  }
+
+  MyThread::FastThrowSite* site = t->fastThrowSites
+    + ((reinterpret_cast<uintptr_t>(ip) >> 2) % FastThrowSiteCount);
+
+  if (site->ip != ip) {
+    site->ip = ip;
+    site->count = 0;
+  }
+
+  if (site->count < limit) {
+    ++ site->count;
+    return false;
+  }
+
+  for (uint32_t old = t->m->fastThrowCount;
+       not atomicCompareAndSwap32(&(t->m->fastThrowCount), old, old + 1);
+       old = t->m->fastThrowCount)
+  { }
+
+  return true;
+}
+
 uintptr_t
 defaultThunk(MyThread* t)
 {
@@ -10445,11 +13507,208 @@ virtualThunk(MyThread* t, unsigned index)
     uintptr_t thunk = compileVirtualThunk(t, index, &size);
     wordArrayBody(t, root(t, VirtualThunks), index * 2) = thunk;
     wordArrayBody(t, root(t, VirtualThunks), (index * 2) + 1) = size;
+
+    processor(t)->compileStatistics.virtualThunkSize += size;
   }
 
   return wordArrayBody(t, root(t, VirtualThunks), index * 2);
 }
 
+uintptr_t
+compileDispatchThunk(MyThread* t, unsigned index, unsigned* size)
+{
+  Context context(t);
+  avian::codegen::Assembler* a = context.assembler;
+
+  // load the receiver's vtable entry and jump to it, leaving the stack
+  // as the caller left it.  Devirtualized call sites store the
+  // receiver's header in the thread just before the call, so we need
+  // not know where the receiver lies among the arguments.
+  lir::Register target(t->arch->virtualCallTarget());
+  lir::Memory header(t->arch->thread(), TARGET_THREAD_VIRTUALCALLTARGET);
+  a->apply(lir::Move,
+           OperandInfo(TargetBytesPerWord, lir::MemoryOperand, &header),
+           OperandInfo(TargetBytesPerWord, lir::RegisterOperand, &target));
+
+  avian::codegen::ResolvedPromise maskPromise(TargetPointerMask);
+  lir::Constant mask(&maskPromise);
+  a->apply(lir::And,
+           OperandInfo(TargetBytesPerWord, lir::ConstantOperand, &mask),
+           OperandInfo(TargetBytesPerWord, lir::RegisterOperand, &target),
+           OperandInfo(TargetBytesPerWord, lir::RegisterOperand, &target));
+
+  lir::Memory entry
+    (target.low, TargetClassVtable + (index * TargetBytesPerWord));
+  a->apply(lir::Move,
+           OperandInfo(TargetBytesPerWord, lir::MemoryOperand, &entry),
+           OperandInfo(TargetBytesPerWord, lir::RegisterOperand, &target));
+
+  a->apply(lir::Jump,
+           OperandInfo(TargetBytesPerWord, lir::RegisterOperand, &target));
+
+  *size = a->endBlock(false)->resolve(0, 0);
+
+  uint8_t* start = static_cast<uint8_t*>
+    (codeAllocator(t)->allocate(*size, TargetBytesPerWord));
+
+  a->setDestination(start);
+  a->write();
+
+  char name[32];
+  vm::snprintf(name, 32, "dispatchThunk%d", index);
+
+  logCompile(t, start, *size, 0, name, 0);
+
+  return reinterpret_cast<uintptr_t>(start);
+}
+
+uintptr_t
+dispatchThunk(MyThread* t, unsigned index)
+{
+  ACQUIRE(t, t->m->classLock);
+
+  if (root(t, DispatchThunks) == 0
+      or wordArrayLength(t, root(t, DispatchThunks)) <= index)
+  {
+    object newArray = makeWordArray(t, nextPowerOfTwo(index + 1));
+    if (root(t, DispatchThunks)) {
+      memcpy(&wordArrayBody(t, newArray, 0),
+             &wordArrayBody(t, root(t, DispatchThunks), 0),
+             wordArrayLength(t, root(t, DispatchThunks)) * BytesPerWord);
+    }
+    setRoot(t, DispatchThunks, newArray);
+  }
+
+  if (wordArrayBody(t, root(t, DispatchThunks), index) == 0) {
+    unsigned size;
+    wordArrayBody(t, root(t, DispatchThunks), index)
+      = compileDispatchThunk(t, index, &size);
+  }
+
+  return wordArrayBody(t, root(t, DispatchThunks), index);
+}
+
+unsigned
+compilationReport(MyThread* t, char* buffer, unsigned capacity)
+{
+  MyProcessor* p = processor(t);
+  CompileStatistics* s = &(p->compileStatistics);
+
+  unsigned thunkSize = p->thunks.default_.length
+    + p->thunks.defaultVirtual.length
+    + p->thunks.native.length
+    + p->thunks.aioob.length
+    + p->thunks.stackOverflow.length
+    + (p->thunks.table.length * ThunkCount);
+
+  unsigned length = 0;
+  buffer[0] = 0;
+
+  appendReport(buffer, capacity, &length,
+               "methods %" LLD "\n"
+               "bytecode %" LLD "\n"
+               "code %" LLD "\n"
+               "time %" LLD "us\n"
+               "zonePeak %u\n"
+               "codeCache %u/%u\n"
+               "thunks %u\n"
+               "virtualThunks %" LLD "\n"
+               "callNodes %u\n",
+               static_cast<int64_t>(s->methodCount),
+               static_cast<int64_t>(s->bytecodeSize),
+               static_cast<int64_t>(s->codeSize),
+               s->duration / 1000,
+               s->zonePeak,
+               p->codeAllocator.offset, p->codeAllocator.capacity,
+               thunkSize,
+               static_cast<int64_t>(s->virtualThunkSize),
+               p->callTableSize);
+
+  appendReport(buffer, capacity, &length, "times\n");
+  for (unsigned i = 0; i < CompileTimeBucketCount; ++i) {
+    if (s->times[i]) {
+      if (i == CompileTimeBucketCount - 1) {
+        appendReport(buffer, capacity, &length, "  >=%uus %" LLD "\n",
+                     1U << i, static_cast<int64_t>(s->times[i]));
+      } else {
+        appendReport(buffer, capacity, &length, "  <%uus %" LLD "\n",
+                     1U << (i + 1), static_cast<int64_t>(s->times[i]));
+      }
+    }
+  }
+
+  appendReport(buffer, capacity, &length, "slowest\n");
+  for (unsigned i = 0; i < SlowCompileCount and s->slowest[i].duration;
+       ++i)
+  {
+    appendReport(buffer, capacity, &length, "  %" LLD "us %s\n",
+                 s->slowest[i].duration / 1000, s->slowest[i].name);
+  }
+
+  return length;
+}
+
+// Adds a compile of method, which started at start and used a zone of
+// footprint bytes, to the statistics, and writes them to the compile
+// log if it's time to.  The caller holds Machine::classLock.
+void
+recordCompile(MyThread* t, object method, unsigned footprint,
+              int64_t start)
+{
+  CompileStatistics* s = &(processor(t)->compileStatistics);
+
+  int64_t now = t->m->system->nanoTime();
+  int64_t duration = now - start;
+
+  ++ s->methodCount;
+  s->bytecodeSize += codeLength(t, methodCode(t, method));
+  s->codeSize += methodCompiledSize(t, method);
+  s->duration += duration;
+
+  unsigned bucket = 0;
+  for (int64_t us = duration / 1000;
+       us > 1 and bucket < CompileTimeBucketCount - 1; us >>= 1)
+  {
+    ++ bucket;
+  }
+  ++ s->times[bucket];
+
+  if (footprint > s->zonePeak) {
+    s->zonePeak = footprint;
+  }
+
+  unsigned i = SlowCompileCount;
+  while (i > 0 and duration > s->slowest[i - 1].duration) {
+    -- i;
+  }
+
+  if (i < SlowCompileCount) {
+    memmove(s->slowest + i + 1, s->slowest + i,
+            (SlowCompileCount - i - 1) * sizeof(SlowCompile));
+
+    s->slowest[i].duration = duration;
+    vm::snprintf
+      (s->slowest[i].name, SlowCompileNameCapacity, "%s.%s%s",
+       reinterpret_cast<const char*>
+       (&byteArrayBody(t, className(t, methodClass(t, method)), 0)),
+       reinterpret_cast<const char*>
+       (&byteArrayBody(t, methodName(t, method), 0)),
+       reinterpret_cast<const char*>
+       (&byteArrayBody(t, methodSpec(t, method), 0)));
+  }
+
+  if (s->reportInterval and now - s->lastReport >= s->reportInterval) {
+    s->lastReport = now;
+
+    char buffer[CompilationReportCapacity];
+    compilationReport(t, buffer, CompilationReportCapacity);
+
+    FILE* out = compileLog ? compileLog : stderr;
+    fputs(buffer, out);
+    fflush(out);
+  }
+}
+
 void
 compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
         object method)
@@ -10483,6 +13742,13 @@ compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
 
   PROTECT(t, clone);
 
+  int64_t start = t->m->system->nanoTime();
+
+  AVIAN_PROBE3(method__compile__begin,
+               &byteArrayBody(t, className(t, methodClass(t, method)), 0),
+               &byteArrayBody(t, methodName(t, method), 0),
+               &byteArrayBody(t, methodSpec(t, method), 0));
+
   Context context(t, bootContext, clone);
   compile(t, &context);
 
@@ -10548,6 +13814,22 @@ compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
 
   treeUpdate(t, root(t, MethodTree), methodCompiled(t, clone),
              method, root(t, MethodTreeSentinal), compareIpToMethodBounds);
+
+  // threads may have cached the clone; make them look it up again
+  ++ methodTreeVersion(t);
+
+  recordCompile(t, method, context.zone.footprint(), start);
+
+  AVIAN_PROBE4(method__compile__end,
+               &byteArrayBody(t, className(t, methodClass(t, method)), 0),
+               &byteArrayBody(t, methodName(t, method), 0),
+               &byteArrayBody(t, methodSpec(t, method), 0),
+               methodCompiledSize(t, method));
+
+  if (t->events) {
+    recordMethodEvent
+      (t, CompileEvent, start, methodCompiledSize(t, method), 0, method);
+  }
 }
 
 object&
@@ -10569,6 +13851,107 @@ codeAllocator(MyThread* t)
   return &(processor(t)->codeAllocator);
 }
 
+void
+enqueueCompile(MyThread* t, object method)
+{
+  MyProcessor* p = processor(t);
+
+  // wait until the classpath is able to make thread objects before
+  // starting the compile thread:
+  if (p->compileLock == 0
+      or root(t, Machine::FinalizerThread) == 0
+      or p->compileQueueLength >= MaximumCompileQueueLength
+      or (methodFlags(t, method) & ACC_NATIVE))
+  {
+    return;
+  }
+
+  object pair = makePair(t, method, 0);
+  PROTECT(t, pair);
+
+  ACQUIRE(t, p->compileLock);
+
+  set(t, pair, PairSecond, root(t, CompileQueue));
+  setRoot(t, CompileQueue, pair);
+  ++ p->compileQueueLength;
+
+  if (not p->compileThreadStarted) {
+    p->compileThreadStarted = true;
+    expect(t, t->m->system->success(t->m->system->start(&(p->compileThread))));
+  }
+
+  p->compileLock->notify(t->systemThread);
+}
+
+uint64_t
+compileInBackground(Thread* t, uintptr_t* arguments)
+{
+  object method = reinterpret_cast<object>(arguments[0]);
+
+  compile(static_cast<MyThread*>(t),
+          codeAllocator(static_cast<MyThread*>(t)), 0, method);
+
+  return 1;
+}
+
+void
+runCompileThread(Machine* m)
+{
+  MyThread* t = static_cast<MyThread*>(attachThread(m, true));
+  if (t == 0) {
+    return;
+  }
+
+  MyProcessor* p = processor(t);
+
+  enter(t, Thread::ActiveState);
+
+  object method = 0;
+  PROTECT(t, method);
+
+  while (true) {
+    { ACQUIRE(t, p->compileLock);
+
+      while (t->m->alive and root(t, CompileQueue) == 0) {
+        ENTER(t, Thread::IdleState);
+        p->compileLock->waitAndClearInterrupted(t->systemThread, 0);
+      }
+
+      if (not t->m->alive) {
+        break;
+      }
+
+      method = pairFirst(t, root(t, CompileQueue));
+      setRoot(t, CompileQueue, pairSecond(t, root(t, CompileQueue)));
+      -- p->compileQueueLength;
+    }
+
+    // a static method of a class which hasn't been initialized would
+    // need to run its initializer, and that's the caller's job:
+    if (unresolved(t, methodAddress(t, method))
+        and not classNeedsInit(t, methodClass(t, method)))
+    {
+      uintptr_t arguments[] = { reinterpret_cast<uintptr_t>(method) };
+
+      if (not run(t, compileInBackground, arguments)) {
+        // the caller will see the same error when it compiles the
+        // method itself
+        t->exception = 0;
+      }
+    }
+  }
+
+  m->localThread->set(0);
+
+  ACQUIRE_RAW(t, m->stateLock);
+
+  threadPeer(t, t->javaThread) = 0;
+
+  enter(t, Thread::ZombieState);
+
+  t->state = Thread::JoinedState;
+}
+
 } // namespace local
 
 } // namespace
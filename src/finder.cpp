@@ -11,11 +11,16 @@
 #include <avian/vm/system/system.h>
 #include <avian/util/string.h>
 #include <avian/util/runtime-array.h>
+#include <avian/util/math.h>
 
 #include "avian/zlib-custom.h"
 #include "avian/finder.h"
 #include "avian/lzma.h"
 
+#ifdef AVIAN_USE_LIBDEFLATE
+#  include <libdeflate.h>
+#endif
+
 
 using namespace vm;
 using namespace avian::util;
@@ -25,6 +30,14 @@ namespace {
 const bool DebugFind = false;
 const bool DebugStat = false;
 
+// cache budget used for prefetched entries when none was requested
+const unsigned DefaultPrefetchCacheBudget = 32 * 1024 * 1024;
+
+// decoded chunks kept for each builtin jar compressed in chunks
+const unsigned BuiltinChunkCacheCount = 4;
+
+class InflateCache;
+
 class Element {
  public:
   class Iterator {
@@ -41,6 +54,18 @@ class Element {
                                 bool tryDirectory) = 0;
   virtual const char* urlPrefix() = 0;
   virtual const char* sourceUrl() = 0;
+  virtual void useCache(InflateCache*) { }
+
+  // Returns true if this element contains the named entry.  If the
+  // entry is compressed, also sets *entry to its central directory
+  // header and *start to the start of the archive containing it.
+  virtual bool locate(const char* name, const uint8_t** entry UNUSED,
+                      const uint8_t** start UNUSED)
+  {
+    unsigned length;
+    return stat(name, &length, false) != System::TypeDoesNotExist;
+  }
+
   virtual void dispose() = 0;
 
   Element* next;
@@ -234,6 +259,239 @@ class DataRegion: public System::Region {
   uint8_t data[0];
 };
 
+// Holds the inflated contents of recently found jar entries so that
+// resources read repeatedly (e.g. configuration and service files) are
+// only decompressed once.  Entries are keyed by their central
+// directory header, which identifies both the jar and the entry, and
+// are evicted least-recently-used first once the total size exceeds
+// the budget.  An evicted entry stays alive until the last region
+// referring to it is disposed.
+class InflateCache {
+ public:
+  static const unsigned BucketCount = 256;
+
+  class Entry {
+   public:
+    Entry(const uint8_t* key, unsigned length, bool prefetched):
+      key(key), next(0), older(0), newer(0), refs(1), length(length),
+      live(false), prefetched(prefetched)
+    { }
+
+    const uint8_t* key;
+    Entry* next;
+    Entry* older;
+    Entry* newer;
+    unsigned refs;
+    unsigned length;
+    bool live;
+    bool prefetched;
+    uint8_t data[0];
+  };
+
+  InflateCache(System* s, Allocator* allocator, unsigned budget,
+               bool statistics):
+    s(s),
+    allocator(allocator),
+    budget(budget),
+    size(0),
+    newest(0),
+    oldest(0),
+    statistics(statistics),
+    hits(0),
+    misses(0),
+    evictions(0)
+  {
+    expect(s, s->success(s->make(&lock)));
+    memset(buckets, 0, sizeof(Entry*) * BucketCount);
+  }
+
+  // entries larger than this are not worth displacing everything else
+  // for, so they are inflated freshly each time
+  bool admits(unsigned length) {
+    return length <= budget / 8;
+  }
+
+  Entry* acquire(const uint8_t* key) {
+    lock->acquire();
+
+    for (Entry* e = buckets[bucket(key)]; e; e = e->next) {
+      if (e->key == key) {
+        ++ e->refs;
+        ++ hits;
+        if (e->prefetched) {
+          // prefetched entries are typically classes, which are only
+          // loaded once, so hand this one over rather than keeping it
+          remove(e);
+        } else {
+          unlink(e);
+          link(e);
+        }
+
+        lock->release();
+        return e;
+      }
+    }
+
+    ++ misses;
+    lock->release();
+    return 0;
+  }
+
+  Entry* allocate(const uint8_t* key, unsigned length,
+                  bool prefetched = false)
+  {
+    return new (allocator->allocate(sizeof(Entry) + length))
+      Entry(key, length, prefetched);
+  }
+
+  // adds an entry returned by allocate and filled in by the caller,
+  // who holds the initial reference
+  void add(Entry* e) {
+    lock->acquire();
+
+    for (Entry* o = buckets[bucket(e->key)]; o; o = o->next) {
+      if (o->key == e->key) {
+        // another thread inflated the same entry first; ours will be
+        // freed when the caller releases it
+        lock->release();
+        return;
+      }
+    }
+
+    e->live = true;
+    e->next = buckets[bucket(e->key)];
+    buckets[bucket(e->key)] = e;
+    link(e);
+    size += e->length;
+
+    while (size > budget and oldest != e) {
+      Entry* victim = oldest;
+      remove(victim);
+      ++ evictions;
+      if (victim->refs == 0) {
+        free(victim);
+      }
+    }
+
+    lock->release();
+  }
+
+  void release(Entry* e) {
+    lock->acquire();
+
+    if ((-- e->refs) == 0 and not e->live) {
+      free(e);
+    }
+
+    lock->release();
+  }
+
+  void dispose() {
+    if (statistics) {
+      fprintf(stderr, "inflate cache: %u hits, %u misses, %u evictions, "
+              "%u of %u bytes used\n", hits, misses, evictions, size,
+              budget);
+    }
+
+    while (oldest) {
+      Entry* e = oldest;
+      remove(e);
+      free(e);
+    }
+
+    lock->dispose();
+    allocator->free(this, sizeof(*this));
+  }
+
+ private:
+  static unsigned bucket(const uint8_t* key) {
+    uintptr_t k = reinterpret_cast<uintptr_t>(key);
+    return (k ^ (k >> 8)) & (BucketCount - 1);
+  }
+
+  void link(Entry* e) {
+    e->older = newest;
+    e->newer = 0;
+    if (newest) {
+      newest->newer = e;
+    } else {
+      oldest = e;
+    }
+    newest = e;
+  }
+
+  void unlink(Entry* e) {
+    if (e->older) {
+      e->older->newer = e->newer;
+    } else {
+      oldest = e->newer;
+    }
+    if (e->newer) {
+      e->newer->older = e->older;
+    } else {
+      newest = e->older;
+    }
+  }
+
+  void remove(Entry* e) {
+    unlink(e);
+
+    for (Entry** p = buckets + bucket(e->key); *p; p = &((*p)->next)) {
+      if (*p == e) {
+        *p = e->next;
+        break;
+      }
+    }
+
+    e->live = false;
+    size -= e->length;
+  }
+
+  void free(Entry* e) {
+    allocator->free(e, sizeof(Entry) + e->length);
+  }
+
+  System* s;
+  Allocator* allocator;
+  System::Mutex* lock;
+  unsigned budget;
+  unsigned size;
+  Entry* newest;
+  Entry* oldest;
+  bool statistics;
+  unsigned hits;
+  unsigned misses;
+  unsigned evictions;
+  Entry* buckets[BucketCount];
+};
+
+class CachedRegion: public System::Region {
+ public:
+  CachedRegion(Allocator* allocator, InflateCache* cache,
+               InflateCache::Entry* entry):
+    allocator(allocator),
+    cache(cache),
+    entry(entry)
+  { }
+
+  virtual const uint8_t* start() {
+    return entry->data;
+  }
+
+  virtual size_t length() {
+    return entry->length;
+  }
+
+  virtual void dispose() {
+    cache->release(entry);
+    allocator->free(this, sizeof(*this));
+  }
+
+  Allocator* allocator;
+  InflateCache* cache;
+  InflateCache::Entry* entry;
+};
+
 class JarIndex {
  public:
   enum CompressionMethod {
@@ -268,33 +526,56 @@ class JarIndex {
       JarIndex(s, allocator, capacity);
   }
   
+  // the end of central directory record in the specified jar data, or
+  // null if there is none
+  static const uint8_t* findEnd(const uint8_t* start, const uint8_t* end) {
+    const uint8_t* p = end - CentralDirectorySearchStart;
+    while (p > start) {
+      if (signature(p) == CentralDirectorySignature) {
+        return p;
+      } else {
+        p--;
+      }
+    }
+    return 0;
+  }
+
   static JarIndex* open(System* s, Allocator* allocator,
                         System::Region* region)
   {
-    JarIndex* index = make(s, allocator, 32);
-
     const uint8_t* start = region->start();
     const uint8_t* end = start + region->length();
-    const uint8_t* p = end - CentralDirectorySearchStart;
-    // Find end of central directory record
-    while (p > start) {
-      if (signature(p) == CentralDirectorySignature) {
-	p = region->start() + centralDirectoryOffset(p);
-	
-	while (p < end) {
-	  if (signature(p) == EntrySignature) {
-	    index = index->add(hash(fileName(p), fileNameLength(p)), p);
-
-	    p = endOfEntry(p);
-	  } else {
-	    return index;
-	  }
-	}
+    const uint8_t* p = findEnd(start, end);
+    if (p) {
+      return open(s, allocator, p, start + centralDirectoryOffset(p), end);
+    } else {
+      return make(s, allocator, 32);
+    }
+  }
+
+  // indexes the central directory which starts at directory, given
+  // its end record
+  static JarIndex* open(System* s, Allocator* allocator,
+                        const uint8_t* record, const uint8_t* directory,
+                        const uint8_t* end)
+  {
+    // size the table from the entry count recorded by the archiver so
+    // large jars are indexed without repeated rehashing; add() still
+    // grows it if the count is wrong (e.g. for Zip64 archives, which
+    // store 0xFFFF here)
+    JarIndex* index = make(s, allocator, nextPowerOfTwo
+                           (max(32, centralDirectoryEntryCount(record))));
+
+    const uint8_t* p = directory;
+    while (p < end) {
+      if (signature(p) == EntrySignature) {
+        index = index->add(hash(fileName(p), fileNameLength(p)), p);
+
+        p = endOfEntry(p);
       } else {
-	p--;
+        return index;
       }
     }
-
     return index;
   }
 
@@ -326,7 +607,48 @@ class JarIndex {
     return 0;
   }
 
-  System::Region* find(const char* name, const uint8_t* start) {
+  static void inflateEntry(System* s, const uint8_t* p, const uint8_t* start,
+                           uint8_t* data)
+  {
+    inflateData(s, p, fileData(start + localHeaderOffset(p)), data);
+  }
+
+  // inflates the compressed data of the entry with the specified
+  // central directory header
+  static void inflateData(System* s, const uint8_t* p,
+                          const uint8_t* compressed, uint8_t* data)
+  {
+#ifdef AVIAN_USE_LIBDEFLATE
+    libdeflate_decompressor* d = libdeflate_alloc_decompressor();
+    expect(s, d);
+
+    enum libdeflate_result r = libdeflate_deflate_decompress
+      (d, compressed, compressedSize(p), data, uncompressedSize(p), 0);
+    expect(s, r == LIBDEFLATE_SUCCESS);
+
+    libdeflate_free_decompressor(d);
+#else
+    z_stream zStream; memset(&zStream, 0, sizeof(z_stream));
+
+    zStream.next_in = const_cast<uint8_t*>(compressed);
+    zStream.avail_in = compressedSize(p);
+    zStream.next_out = data;
+    zStream.avail_out = uncompressedSize(p);
+
+    // -15 means max window size and raw deflate (no zlib wrapper)
+    int r = inflateInit2(&zStream, -15);
+    expect(s, r == Z_OK);
+
+    r = inflate(&zStream, Z_FINISH);
+    expect(s, r == Z_STREAM_END);
+
+    inflateEnd(&zStream);
+#endif
+  }
+
+  System::Region* find(const char* name, const uint8_t* start,
+                       InflateCache* cache)
+  {
     Node* n = findNode(name);
     if (n) {
       const uint8_t* p = n->entry;
@@ -338,26 +660,23 @@ class JarIndex {
       } break;
 
       case Deflated: {
+        if (cache and cache->admits(uncompressedSize(p))) {
+          InflateCache::Entry* e = cache->acquire(p);
+          if (e == 0) {
+            e = cache->allocate(p, uncompressedSize(p));
+            inflateEntry(s, p, start, e->data);
+            cache->add(e);
+          }
+
+          return new (allocator->allocate(sizeof(CachedRegion)))
+            CachedRegion(allocator, cache, e);
+        }
+
         DataRegion* region = new
           (allocator->allocate(sizeof(DataRegion) + uncompressedSize(p)))
           DataRegion(s, allocator, uncompressedSize(p));
-          
-        z_stream zStream; memset(&zStream, 0, sizeof(z_stream));
-
-        zStream.next_in = const_cast<uint8_t*>(fileData(start +
-							localHeaderOffset(p)));
-        zStream.avail_in = compressedSize(p);
-        zStream.next_out = region->data;
-        zStream.avail_out = region->length();
-
-        // -15 means max window size and raw deflate (no zlib wrapper)
-        int r = inflateInit2(&zStream, -15);
-        expect(s, r == Z_OK);
-
-        r = inflate(&zStream, Z_FINISH);
-        expect(s, r == Z_STREAM_END);
 
-        inflateEnd(&zStream);
+        inflateEntry(s, p, start, region->data);
 
         return region;
       } break;
@@ -451,7 +770,7 @@ class JarElement: public Element {
                ? append(allocator, "jar:file:", this->name, "!/") : 0),
     sourceUrl_(this->name
                ? append(allocator, "file:", this->name) : 0),
-    region(0), index(0)
+    region(0), index(0), cache(0)
   { }
 
   JarElement(System* s, Allocator* allocator, const uint8_t* jarData,
@@ -464,7 +783,8 @@ class JarElement: public Element {
     sourceUrl_(name ? append(allocator, "file:", name) : 0),
     region(new (allocator->allocate(sizeof(PointerRegion)))
            PointerRegion(s, allocator, jarData, jarLength)),
-    index(JarIndex::open(s, allocator, region))
+    index(JarIndex::open(s, allocator, region)),
+    cache(0)
   { }
 
   virtual Element::Iterator* iterator() {
@@ -489,7 +809,8 @@ class JarElement: public Element {
 
     while (*name == '/') name++;
 
-    System::Region* r = (index ? index->find(name, region->start()) : 0);
+    System::Region* r
+      = (index ? index->find(name, region->start(), cache) : 0);
     if (DebugFind) {
       if (r) {
         fprintf(stderr, "found %s in %s\n", name, this->name);
@@ -523,6 +844,28 @@ class JarElement: public Element {
     return sourceUrl_;
   }
 
+  virtual void useCache(InflateCache* cache) {
+    this->cache = cache;
+  }
+
+  virtual bool locate(const char* name, const uint8_t** entry,
+                      const uint8_t** start)
+  {
+    init();
+
+    while (*name == '/') name++;
+
+    JarIndex::Node* n = (index ? index->findNode(name) : 0);
+    if (n) {
+      if (compressionMethod(n->entry) == JarIndex::Deflated) {
+        *entry = n->entry;
+        *start = region->start();
+      }
+      return true;
+    }
+    return false;
+  }
+
   virtual void dispose() {
     dispose(sizeof(*this));
   }
@@ -553,6 +896,7 @@ class JarElement: public Element {
   const char* sourceUrl_;
   System::Region* region;
   JarIndex* index;
+  InflateCache* cache;
 };
 
 class BuiltinElement: public JarElement {
@@ -560,7 +904,10 @@ class BuiltinElement: public JarElement {
   BuiltinElement(System* s, Allocator* allocator, const char* name,
                  const char* libraryName):
     JarElement(s, allocator, name, false),
-    libraryName(libraryName ? copy(allocator, libraryName) : 0)
+    libraryName(libraryName ? copy(allocator, libraryName) : 0),
+    chunks(0),
+    directory(0),
+    directorySize(0)
   { }
 
   virtual void init() {
@@ -576,6 +923,18 @@ class BuiltinElement: public JarElement {
 
           unsigned size;
           uint8_t* data = function(&size);
+#ifdef AVIAN_USE_LZMA
+          // a jar compressed in chunks is indexed from its central
+          // directory alone, and its entries decoded as they are found
+          if (data and lzma) {
+            chunks = openLZMAChunks
+              (s, allocator, data, size, BuiltinChunkCacheCount);
+            if (chunks) {
+              index = indexChunks();
+              return;
+            }
+          }
+#endif
           if (data) {
             bool freePointer;
             if (lzma) {
@@ -605,6 +964,130 @@ class BuiltinElement: public JarElement {
     }
   }
 
+  // reads the central directory of a jar compressed in chunks, which
+  // stays decoded for as long as this element lives
+  JarIndex* indexChunks() {
+    // the end record is followed by a comment of at most 64KB
+    unsigned size = chunks->length();
+    unsigned tailSize = min(size, CentralDirectorySearchStart + 0xFFFF);
+    uint8_t* tail = static_cast<uint8_t*>(allocator->allocate(tailSize));
+    chunks->read(size - tailSize, tailSize, tail);
+
+    JarIndex* index;
+    const uint8_t* record = JarIndex::findEnd(tail, tail + tailSize);
+    if (record) {
+      unsigned recordOffset = (size - tailSize) + (record - tail);
+      unsigned directoryOffset = centralDirectoryOffset(record);
+      expect(s, directoryOffset <= recordOffset);
+
+      directorySize = size - directoryOffset;
+      directory = static_cast<uint8_t*>(allocator->allocate(directorySize));
+      chunks->read(directoryOffset, directorySize, directory);
+
+      index = JarIndex::open
+        (s, allocator, directory + (recordOffset - directoryOffset),
+         directory, directory + directorySize);
+    } else {
+      index = JarIndex::make(s, allocator, 32);
+    }
+
+    allocator->free(tail, tailSize);
+
+    return index;
+  }
+
+  // decodes just the chunks holding the entry with the specified
+  // central directory header
+  System::Region* decode(const uint8_t* p) {
+    uint8_t header[LocalHeaderSize];
+    chunks->read(localHeaderOffset(p), LocalHeaderSize, header);
+    unsigned offset = localHeaderOffset(p) + (fileData(header) - header);
+
+    switch (compressionMethod(p)) {
+    case JarIndex::Stored: {
+      DataRegion* region = new
+        (allocator->allocate(sizeof(DataRegion) + compressedSize(p)))
+        DataRegion(s, allocator, compressedSize(p));
+
+      chunks->read(offset, compressedSize(p), region->data);
+
+      return region;
+    } break;
+
+    case JarIndex::Deflated: {
+      if (cache and cache->admits(uncompressedSize(p))) {
+        InflateCache::Entry* e = cache->acquire(p);
+        if (e == 0) {
+          e = cache->allocate(p, uncompressedSize(p));
+          inflate(p, offset, e->data);
+          cache->add(e);
+        }
+
+        return new (allocator->allocate(sizeof(CachedRegion)))
+          CachedRegion(allocator, cache, e);
+      }
+
+      DataRegion* region = new
+        (allocator->allocate(sizeof(DataRegion) + uncompressedSize(p)))
+        DataRegion(s, allocator, uncompressedSize(p));
+
+      inflate(p, offset, region->data);
+
+      return region;
+    } break;
+
+    default:
+      abort(s);
+    }
+  }
+
+  void inflate(const uint8_t* p, unsigned offset, uint8_t* data) {
+    unsigned size = compressedSize(p);
+    uint8_t* compressed = static_cast<uint8_t*>(allocator->allocate(size));
+    chunks->read(offset, size, compressed);
+
+    JarIndex::inflateData(s, p, compressed, data);
+
+    allocator->free(compressed, size);
+  }
+
+  virtual System::Region* find(const char* name) {
+    init();
+
+    if (chunks == 0) {
+      return JarElement::find(name);
+    }
+
+    while (*name == '/') name++;
+
+    JarIndex::Node* n = (index ? index->findNode(name) : 0);
+    System::Region* r = (n ? decode(n->entry) : 0);
+    if (DebugFind) {
+      if (r) {
+        fprintf(stderr, "found %s in %s\n", name, this->name);
+      } else {
+        fprintf(stderr, "%s not found in %s\n", name, this->name);
+      }
+    }
+    return r;
+  }
+
+  virtual bool locate(const char* name, const uint8_t** entry,
+                      const uint8_t** start)
+  {
+    init();
+
+    if (chunks == 0) {
+      return JarElement::locate(name, entry, start);
+    }
+
+    // entries are decoded when found rather than prefetched, since
+    // there is no one region which holds them all
+    while (*name == '/') name++;
+
+    return index and index->findNode(name);
+  }
+
   virtual const char* urlPrefix() {
     return "avianvmresource:";
   }
@@ -618,11 +1101,20 @@ class BuiltinElement: public JarElement {
     if (libraryName) {
       allocator->free(libraryName, strlen(libraryName) + 1);
     }
+    if (chunks) {
+      chunks->dispose();
+    }
+    if (directory) {
+      allocator->free(directory, directorySize);
+    }
     JarElement::dispose(sizeof(*this));
   }
 
   System::Library* library;
   const char* libraryName;
+  LzmaChunks* chunks;
+  uint8_t* directory;
+  unsigned directorySize;
 };
 
 void
@@ -823,12 +1315,32 @@ parsePath(System* s, Allocator* allocator, const char* path,
   return first;
 }
 
+class MutexResource {
+ public:
+  MutexResource(System::Mutex* m): m(m) {
+    m->acquire();
+  }
+
+  ~MutexResource() {
+    m->release();
+  }
+
+ private:
+  System::Mutex* m;
+};
+
 class MyIterator: public Finder::IteratorImp {
  public:
-  MyIterator(System* s, Allocator* allocator, Element* path):
-    s(s), allocator(allocator), e(path ? path->next : 0),
-    it(path ? path->iterator() : 0)
-  { }
+  MyIterator(System* s, Allocator* allocator, System::Mutex* lock,
+             Element* path):
+    s(s), allocator(allocator), lock(lock), e(path ? path->next : 0),
+    it(0)
+  {
+    if (path) {
+      MutexResource r(lock);
+      it = path->iterator();
+    }
+  }
 
   virtual const char* next(unsigned* size) {
     while (it) {
@@ -838,6 +1350,7 @@ class MyIterator: public Finder::IteratorImp {
       } else {
         it->dispose();
         if (e) {
+          MutexResource r(lock);
           it = e->iterator();
           e = e->next;
         } else {
@@ -855,19 +1368,158 @@ class MyIterator: public Finder::IteratorImp {
 
   System* s;
   Allocator* allocator;
+  System::Mutex* lock;
   Element* e;
   Element::Iterator* it;
 };
 
+// Inflates the entries named in a list (one per line) on background
+// threads so that they are already in the cache when the VM asks for
+// them.  Entries are located while holding the finder's lock, since
+// elements open their archives lazily, but are inflated outside it so
+// the workers and the VM's own lookups proceed in parallel.
+class Prefetcher {
+ public:
+  class Worker: public System::Runnable {
+   public:
+    Worker(Prefetcher* prefetcher): prefetcher(prefetcher), thread(0) { }
+
+    virtual void attach(System::Thread* t) {
+      thread = t;
+    }
+
+    virtual void run() {
+      prefetcher->run();
+    }
+
+    virtual bool interrupted() {
+      return false;
+    }
+
+    virtual void setInterrupted(bool) { }
+
+    Prefetcher* prefetcher;
+    System::Thread* thread;
+  };
+
+  Prefetcher(System* s, Allocator* allocator, System::Mutex* lock,
+             Element* path, InflateCache* cache, System::Region* list,
+             unsigned workerCount):
+    s(s),
+    allocator(allocator),
+    lock(lock),
+    path(path),
+    cache(cache),
+    list(list),
+    position(0),
+    stopped(false),
+    workerCount(workerCount),
+    workers(static_cast<Worker*>
+            (allocator->allocate(sizeof(Worker) * workerCount)))
+  {
+    for (unsigned i = 0; i < workerCount; ++i) {
+      new (workers + i) Worker(this);
+    }
+  }
+
+  void start() {
+    for (unsigned i = 0; i < workerCount; ++i) {
+      expect(s, s->success(s->start(workers + i)));
+    }
+  }
+
+  void run() {
+    while (true) {
+      const uint8_t* entry = 0;
+      const uint8_t* start = 0;
+
+      { MutexResource r(lock);
+
+        unsigned lineStart = position;
+        unsigned length;
+        if (stopped or not readLine
+            (list->start(), list->length(), &lineStart, &length))
+        {
+          return;
+        }
+        position = lineStart + length;
+
+        RUNTIME_ARRAY(char, name, length + 1);
+        memcpy(RUNTIME_ARRAY_BODY(name), list->start() + lineStart, length);
+        RUNTIME_ARRAY_BODY(name)[length] = 0;
+
+        for (Element* e = path; e; e = e->next) {
+          if (e->locate(RUNTIME_ARRAY_BODY(name), &entry, &start)) {
+            break;
+          }
+        }
+      }
+
+      if (entry and cache->admits(uncompressedSize(entry))) {
+        InflateCache::Entry* e = cache->allocate
+          (entry, uncompressedSize(entry), true);
+        JarIndex::inflateEntry(s, entry, start, e->data);
+        cache->add(e);
+        cache->release(e);
+      }
+    }
+  }
+
+  void dispose() {
+    { MutexResource r(lock);
+      stopped = true;
+    }
+
+    for (unsigned i = 0; i < workerCount; ++i) {
+      workers[i].thread->join();
+      workers[i].thread->dispose();
+    }
+
+    list->dispose();
+    allocator->free(workers, sizeof(Worker) * workerCount);
+    allocator->free(this, sizeof(*this));
+  }
+
+  System* s;
+  Allocator* allocator;
+  System::Mutex* lock;
+  Element* path;
+  InflateCache* cache;
+  System::Region* list;
+  unsigned position;
+  bool stopped;
+  unsigned workerCount;
+  Worker* workers;
+};
+
 class MyFinder: public Finder {
  public:
   MyFinder(System* system, Allocator* allocator, const char* path,
-           const char* bootLibrary):
+           const char* bootLibrary, unsigned cacheBudget,
+           bool cacheStatistics):
     system(system),
     allocator(allocator),
     path_(parsePath(system, allocator, path, bootLibrary)),
-    pathString(copy(allocator, path))
-  { }
+    pathString(copy(allocator, path)),
+    cache(0),
+    cacheStatistics(cacheStatistics),
+    prefetcher(0)
+  {
+    expect(system, system->success(system->make(&lock)));
+
+    if (cacheBudget) {
+      makeCache(cacheBudget);
+    }
+  }
+
+  void makeCache(unsigned budget) {
+    cache = new (allocator->allocate(sizeof(InflateCache)))
+      InflateCache(system, allocator, budget, cacheStatistics);
+
+    for (Element* e = path_; e; e = e->next) {
+      e->useCache(cache);
+    }
+  }
 
   MyFinder(System* system, Allocator* allocator, const uint8_t* jarData,
            unsigned jarLength):
@@ -875,15 +1527,25 @@ class MyFinder: public Finder {
     allocator(allocator),
     path_(new (allocator->allocate(sizeof(JarElement)))
           JarElement(system, allocator, jarData, jarLength)),
-    pathString(0)
-  { }
+    pathString(0),
+    cache(0),
+    cacheStatistics(false),
+    prefetcher(0)
+  {
+    expect(system, system->success(system->make(&lock)));
+  }
 
   virtual IteratorImp* iterator() {
     return new (allocator->allocate(sizeof(MyIterator)))
-      MyIterator(system, allocator, path_);
+      MyIterator(system, allocator, lock, path_);
   }
 
+  // elements open and index their archives lazily, so lookups are
+  // serialized per finder rather than relying on callers to hold
+  // Machine::classLock
   virtual System::Region* find(const char* name) {
+    MutexResource r(lock);
+
     for (Element* e = path_; e; e = e->next) {
       System::Region* r = e->find(name);
       if (r) {
@@ -897,6 +1559,8 @@ class MyFinder: public Finder {
   virtual System::FileType stat(const char* name, unsigned* length,
                                 bool tryDirectory)
   {
+    MutexResource r(lock);
+
     for (Element* e = path_; e; e = e->next) {
       System::FileType type = e->stat(name, length, tryDirectory);
       if (type != System::TypeDoesNotExist) {
@@ -908,6 +1572,8 @@ class MyFinder: public Finder {
   }
 
   virtual const char* urlPrefix(const char* name) {
+    MutexResource r(lock);
+
     for (Element* e = path_; e; e = e->next) {
       unsigned length;
       System::FileType type = e->stat(name, &length, true);
@@ -920,6 +1586,8 @@ class MyFinder: public Finder {
   }
 
   virtual const char* sourceUrl(const char* name) {
+    MutexResource r(lock);
+
     for (Element* e = path_; e; e = e->next) {
       unsigned length;
       System::FileType type = e->stat(name, &length, true);
@@ -935,7 +1603,27 @@ class MyFinder: public Finder {
     return pathString;
   }
 
+  virtual void prefetch(const char* listPath, unsigned threadCount) {
+    System::Region* list;
+    if (prefetcher or threadCount == 0
+        or not system->success(system->map(&list, listPath)))
+    {
+      return;
+    }
+
+    if (cache == 0) {
+      makeCache(DefaultPrefetchCacheBudget);
+    }
+
+    prefetcher = new (allocator->allocate(sizeof(Prefetcher))) Prefetcher
+      (system, allocator, lock, path_, cache, list, threadCount);
+    prefetcher->start();
+  }
+
   virtual void dispose() {
+    if (prefetcher) {
+      prefetcher->dispose();
+    }
     for (Element* e = path_; e;) {
       Element* t = e;
       e = e->next;
@@ -944,13 +1632,21 @@ class MyFinder: public Finder {
     if (pathString) {
       allocator->free(pathString, strlen(pathString) + 1);
     }
+    if (cache) {
+      cache->dispose();
+    }
+    lock->dispose();
     allocator->free(this, sizeof(*this));
   }
 
   System* system;
   Allocator* allocator;
+  System::Mutex* lock;
   Element* path_;
   const char* pathString;
+  InflateCache* cache;
+  bool cacheStatistics;
+  Prefetcher* prefetcher;
 };
 
 } // namespace
@@ -958,9 +1654,11 @@ class MyFinder: public Finder {
 namespace vm {
 
 JNIEXPORT Finder*
-makeFinder(System* s, Allocator* a, const char* path, const char* bootLibrary)
+makeFinder(System* s, Allocator* a, const char* path, const char* bootLibrary,
+           unsigned cacheBudget, bool cacheStatistics)
 {
-  return new (a->allocate(sizeof(MyFinder))) MyFinder(s, a, path, bootLibrary);
+  return new (a->allocate(sizeof(MyFinder))) MyFinder
+    (s, a, path, bootLibrary, cacheBudget, cacheStatistics);
 }
 
 Finder*
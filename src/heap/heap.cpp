@@ -12,6 +12,7 @@
 #include <avian/vm/system/system.h>
 #include "avian/common.h"
 #include "avian/arch.h"
+#include "avian/probes.h"
 
 #include <avian/util/math.h>
 
@@ -27,6 +28,23 @@ const unsigned Top = ~static_cast<unsigned>(0);
 const unsigned InitialGen2CapacityInBytes = 4 * 1024 * 1024;
 const unsigned InitialTenuredFixieCeilingInBytes = 4 * 1024 * 1024;
 
+// Fixies up to MaximumFixieClassSizeInBytes are rounded up to one of
+// four size classes per power of two, and dead ones are kept on per-class
+// free lists (up to FixieCacheCeilingInBytes in total) for reuse rather
+// than handed back to the system one at a time.
+const unsigned MinimumFixieClassSizeInBytes = 64;
+const unsigned MaximumFixieClassSizeInBytes = 1024 * 1024;
+const unsigned FixieClassesPerPowerOfTwo = 4;
+const unsigned FixieClassCount = 1 + (FixieClassesPerPowerOfTwo * 14);
+const unsigned FixieCacheCeilingInBytes = 4 * 1024 * 1024;
+
+const unsigned CopyBufferSizeInWords = 1024;
+const unsigned MinimumCopyBufferRemainderInWords = 16;
+const unsigned ClaimLockCount = 1024;
+const unsigned InitialWorkQueueCapacity = 256;
+const unsigned MaximumStealCount = 64;
+const unsigned LargePageThresholdInBytes = 2 * 1024 * 1024;
+
 const bool Verbose = false;
 const bool Verbose2 = false;
 const bool Debug = false;
@@ -62,6 +80,9 @@ void* tryAllocate(Context* c, unsigned size);
 void* allocate(Context* c, unsigned size);
 void* allocate(Context* c, unsigned size, bool limit);
 void free(Context* c, const void* p, unsigned size);
+void* tryAllocateSegment(Context* c, unsigned size);
+void* allocateSegment(Context* c, unsigned size);
+void freeSegment(Context* c, const void* p, unsigned size);
 
 #ifdef USE_ATOMIC_OPERATIONS
 inline void
@@ -69,11 +90,56 @@ markBitAtomic(uintptr_t* map, unsigned i)
 {
   uintptr_t* p = map + wordOf(i);
   uintptr_t v = static_cast<uintptr_t>(1) << bitOf(i);
+  // the bit is usually set already when the same fields are written
+  // again and again, in which case there's no need for a locked
+  // instruction
   for (uintptr_t old = *p;
-       not atomicCompareAndSwap(p, old, old | v);
+       (old & v) == 0 and not atomicCompareAndSwap(p, old, old | v);
+       old = *p)
+  { }
+}
+
+inline void
+atomicAdd(uint32_t* p, int v)
+{
+  for (uint32_t old = *p;
+       not atomicCompareAndSwap32(p, old, old + v);
        old = *p)
   { }
 }
+
+class SpinLock {
+ public:
+  SpinLock(): value(0) { }
+
+  void acquire(System* s) {
+    while (not atomicCompareAndSwap32(&value, 0, 1)) {
+      s->yield();
+    }
+  }
+
+  void release() {
+    atomicCompareAndSwap32(&value, 1, 0);
+  }
+
+  uint32_t value;
+};
+
+class SpinLockResource {
+ public:
+  SpinLockResource(System* s, SpinLock* lock): lock(lock) {
+    lock->acquire(s);
+  }
+
+  ~SpinLockResource() {
+    lock->release();
+  }
+
+ private:
+  SpinLock* lock;
+};
+
+#define ACQUIRE_SPIN(s, x) SpinLockResource MAKE_NAME(spinLock_) (s, x)
 #endif // USE_ATOMIC_OPERATIONS
 
 inline void*
@@ -317,6 +383,22 @@ class Segment {
       assert(segment->context, getBit(data, indexOf(p)));
       if (child) child->markAtomic(p);
     }
+
+    void setOnlyAtomic(void* p, unsigned v) {
+      unsigned index = indexOf(p);
+      uintptr_t* word = data + wordOf(index);
+      assert(segment->context,
+             wordOf(index + bitsPerRecord - 1) == wordOf(index));
+
+      for (uintptr_t old = *word;; old = *word) {
+        uintptr_t n = old;
+        setBits(&n, bitsPerRecord, bitOf(index), v);
+        if (atomicCompareAndSwap(word, old, n)) {
+          break;
+        }
+      }
+      assert(segment->context, get(p) == v);
+    }
 #endif
 
     unsigned get(void* p) {
@@ -379,8 +461,8 @@ class Segment {
 
       while (data == 0) {
         data = static_cast<uintptr_t*>
-          (local::allocate
-           (context, (footprint(capacity_)) * BytesPerWord, false));
+          (tryAllocateSegment
+           (context, (footprint(capacity_)) * BytesPerWord));
 
         if (data == 0) {
           if (capacity_ > minimum) {
@@ -390,7 +472,7 @@ class Segment {
             }
           } else {
             data = static_cast<uintptr_t*>
-              (local::allocate
+              (allocateSegment
                (context, (footprint(capacity_)) * BytesPerWord));
           }
         }
@@ -434,7 +516,7 @@ class Segment {
 
   void replaceWith(Segment* s) {
     if (data) {
-      free(context, data, (footprint(capacity())) * BytesPerWord);
+      freeSegment(context, data, (footprint(capacity())) * BytesPerWord);
     }
     data = s->data;
     s->data = 0;
@@ -484,9 +566,27 @@ class Segment {
     return p;
   }
 
+#ifdef USE_ATOMIC_OPERATIONS
+  void* allocateAtomic(unsigned size) {
+    assert(context, size);
+
+    for (unsigned old = position_;; old = position_) {
+      if (old + size > capacity()) {
+        return 0;
+      }
+
+      if (atomicCompareAndSwap32
+          (reinterpret_cast<uint32_t*>(&position_), old, old + size))
+      {
+        return data + old;
+      }
+    }
+  }
+#endif
+
   void dispose() {
     if (data) {
-      free(context, data, (footprint(capacity())) * BytesPerWord);
+      freeSegment(context, data, (footprint(capacity())) * BytesPerWord);
     }
     data = 0;
     map = 0;
@@ -634,14 +734,44 @@ fixie(void* body)
 void
 free(Context* c, Fixie** fixies, bool resetImmortal = false);
 
+class Worker;
+
+void
+disposeWorkers(Context* c);
+
+void
+flushFixieCache(Context* c);
+
 class Context {
  public:
-  Context(System* system, unsigned limit):
+  Context(System* system, unsigned limit, unsigned workerCount UNUSED,
+          unsigned targetFootprint, bool largePages):
     system(system),
     client(0),
     count(0),
     limit(limit),
+    targetFootprint(targetFootprint),
+    largePages(largePages),
     lock(0),
+
+#ifdef USE_ATOMIC_OPERATIONS
+    workerCount(workerCount ? workerCount : 1),
+#else
+    workerCount(1),
+#endif
+    workers(0),
+    workerMonitor(0),
+    claimLocks(0),
+    phase(0),
+    activeWorkers(0),
+    exitedWorkers(0),
+    rootGroups(0),
+    rootGroupCount(0),
+    nextRootGroup(0),
+    parallelCollecting(false),
+    synchronous(false),
+    draining(false),
+    shutdown(false),
     
     immortalHeapStart(0),
     immortalHeapEnd(0),
@@ -676,6 +806,8 @@ class Context {
     tenuredFixieFootprint(0),
     tenuredFixieCeiling(InitialTenuredFixieCeilingInBytes),
 
+    gen2Survival(100),
+
     mode(Heap::MinorCollection),
 
     fixies(0),
@@ -684,6 +816,9 @@ class Context {
     markedFixies(0),
     visitedFixies(0),
 
+    fixieCacheFootprint(0),
+    fixieCount(0),
+
     lastCollectionTime(system->now()),
     totalCollectionTime(0),
     totalTime(0),
@@ -693,9 +828,13 @@ class Context {
     if (not system->success(system->make(&lock))) {
       system->abort();
     }
+
+    memset(fixieCache, 0, sizeof(fixieCache));
   }
 
   void dispose() {
+    flushFixieCache(this);
+    disposeWorkers(this);
     gen1.dispose();
     nextGen1.dispose();
     gen2.dispose();
@@ -714,9 +853,33 @@ class Context {
 
   unsigned count;
   unsigned limit;
+  unsigned targetFootprint;
+  bool largePages;
 
   System::Mutex* lock;
 
+  unsigned workerCount;
+  Worker** workers;
+  System::Monitor* workerMonitor;
+#ifdef USE_ATOMIC_OPERATIONS
+  SpinLock* claimLocks;
+  SpinLock fixieLock;
+#else
+  void* claimLocks;
+#endif
+  unsigned phase;
+  uint32_t activeWorkers;
+  uint32_t exitedWorkers;
+  // the roots being scanned by every worker, if any (see
+  // visitRootGroups), and the next group to be claimed
+  Heap::RootGroups* rootGroups;
+  uint32_t rootGroupCount;
+  uint32_t nextRootGroup;
+  bool parallelCollecting;
+  bool synchronous;
+  bool draining;
+  bool shutdown;
+
   uintptr_t* immortalHeapStart;
   uintptr_t* immortalHeapEnd;
 
@@ -750,6 +913,9 @@ class Context {
   unsigned tenuredFixieFootprint;
   unsigned tenuredFixieCeiling;
 
+  // percentage of gen2 which survived the last major collection
+  unsigned gen2Survival;
+
   Heap::CollectionType mode;
 
   Fixie* fixies;
@@ -758,6 +924,14 @@ class Context {
   Fixie* markedFixies;
   Fixie* visitedFixies;
 
+  void* fixieCache[FixieClassCount];
+  unsigned fixieCacheFootprint;
+
+  // number of mortal fixies currently allocated
+  unsigned fixieCount;
+
+  Heap::CollectionStatistics statistics;
+
   int64_t lastCollectionTime;
   int64_t totalCollectionTime;
   int64_t totalTime;
@@ -806,6 +980,27 @@ oversizedGen2(Context* c)
     and c->gen2.position() < (c->gen2.capacity() / 4);
 }
 
+inline bool
+parallel(Context* c)
+{
+  return c->workerCount > 1 and c->mode == Heap::MinorCollection;
+}
+
+// space lost to partially filled copy buffers during a parallel
+// collection:
+inline unsigned
+parallelReserve(Context* c, unsigned footprint)
+{
+  return (footprint / 32) + (c->workerCount * CopyBufferSizeInWords);
+}
+
+inline unsigned
+tenureRequirement(Context* c)
+{
+  unsigned n = c->tenureFootprint + c->tenurePadding;
+  return c->workerCount > 1 ? n + parallelReserve(c, n) : n;
+}
+
 inline void
 initNextGen1(Context* c)
 {
@@ -813,6 +1008,9 @@ initNextGen1(Context* c)
     (&(c->nextGen1), max(1, log(TenureThreshold)), 1, 0, false);
 
   unsigned minimum = minimumNextGen1Capacity(c);
+  if (parallel(c)) {
+    minimum += parallelReserve(c, minimum);
+  }
   unsigned desired = minimum;
 
   new (&(c->nextGen1)) Segment(c, &(c->nextAgeMap), desired, minimum);
@@ -840,20 +1038,34 @@ initNextGen2(Context* c)
   unsigned desired = minimum;
 
   if (not oversizedGen2(c)) {
-    desired *= 2;
+    // leave room to double the live set if most of gen2 survived last
+    // time, but only half as much if it was mostly garbage
+    desired += c->gen2Survival >= 50 ? minimum : minimum / 2;
   }
 
   if (desired < InitialGen2CapacityInBytes / BytesPerWord) {
     desired = InitialGen2CapacityInBytes / BytesPerWord;
   }
 
+  int64_t otherFootprint = static_cast<int64_t>(c->count / BytesPerWord)
+    - c->gen2.footprint(c->gen2.capacity())
+    - c->gen1.footprint(c->gen1.capacity())
+    + c->pendingAllocation;
+
+  if (c->targetFootprint) {
+    // trade more frequent major collections for staying near the
+    // requested footprint, but never go below what we need
+    int64_t available = static_cast<int64_t>
+      (c->targetFootprint / BytesPerWord) - otherFootprint;
+
+    if (available < desired) {
+      desired = max(minimum, static_cast<unsigned>(max(available, 0)));
+    }
+  }
+
   new (&(c->nextGen2)) Segment
     (c, &(c->nextHeapMap), desired, minimum,
-     static_cast<int64_t>(c->limit / BytesPerWord)
-     - (static_cast<int64_t>(c->count / BytesPerWord)
-        - c->gen2.footprint(c->gen2.capacity())
-        - c->gen1.footprint(c->gen1.capacity())
-        + c->pendingAllocation));
+     static_cast<int64_t>(c->limit / BytesPerWord) - otherFootprint);
 
   if (Verbose2) {
     fprintf(stderr, "init nextGen2 to %d bytes\n",
@@ -896,6 +1108,9 @@ bitset(Context* c UNUSED, void* o)
   return &fieldAtOffset<uintptr_t>(o, BytesPerWord * 2);
 }
 
+void
+freeFixie(Context* c, void* p, unsigned size);
+
 void
 free(Context* c, Fixie** fixies, bool resetImmortal)
 {
@@ -921,7 +1136,8 @@ free(Context* c, Fixie** fixies, bool resetImmortal)
       if (DebugFixies) {
         fprintf(stderr, "free fixie %p\n", f);
       }
-      free(c, f, f->totalSize());
+      freeFixie(c, f, f->totalSize());
+      -- c->fixieCount;
     }
   }
 }
@@ -954,6 +1170,9 @@ sweepFixies(Context* c)
   assert(c, c->markedFixies == 0);
 
   if (c->mode == Heap::MajorCollection) {
+    // anything still cached has gone unused for a whole cycle
+    flushFixieCache(c);
+
     free(c, &(c->tenuredFixies));
     free(c, &(c->dirtyTenuredFixies));
 
@@ -1651,163 +1870,889 @@ collect(Context* c, Segment::Map* map, unsigned start, unsigned end,
   assert(c, wasDirty or not expectDirty);
 }
 
-void
-collect2(Context* c)
-{
-  c->gen2Base = Top;
-  c->tenureFootprint = 0;
-  c->fixieTenureFootprint = 0;
-  c->gen1Padding = 0;
-  c->tenurePadding = 0;
+#ifdef USE_ATOMIC_OPERATIONS
 
-  if (c->mode == Heap::MajorCollection) {
-    c->gen2Padding = 0;
-  }
+class Task {
+ public:
+  Task() { }
 
-  if (c->mode == Heap::MinorCollection and c->gen2.position()) {
-    unsigned start = 0;
-    unsigned end = start + c->gen2.position();
-    bool dirty;
-    collect(c, &(c->heapMap), start, end, &dirty, false);
-  }
+  Task(void** p, void* target, unsigned offset):
+    p(p), target(target), offset(offset)
+  { }
 
-  if (c->mode == Heap::MinorCollection) {
-    visitDirtyFixies(c, &(c->dirtyTenuredFixies));
+  // slot to update, or zero if target is an object whose fields
+  // should be visited:
+  void** p;
+  void* target;
+  unsigned offset;
+};
+
+class WorkQueue {
+ public:
+  WorkQueue(): tasks(0), capacity(0), head(0), count(0) { }
+
+  void grow(Context* c) {
+    unsigned newCapacity = capacity ? capacity * 2 : InitialWorkQueueCapacity;
+    Task* newTasks = static_cast<Task*>
+      (local::allocate(c, newCapacity * sizeof(Task)));
+
+    for (unsigned i = 0; i < count; ++i) {
+      newTasks[i] = tasks[(head + i) & (capacity - 1)];
+    }
+
+    if (tasks) {
+      local::free(c, tasks, capacity * sizeof(Task));
+    }
+
+    tasks = newTasks;
+    capacity = newCapacity;
+    head = 0;
   }
 
-  class Visitor : public Heap::Visitor {
-   public:
-    Visitor(Context* c): c(c) { }
+  void push(Context* c, const Task& task) {
+    ACQUIRE_SPIN(c->system, &lock);
 
-    virtual void visit(void* p) {
-      local::collect(c, static_cast<void**>(p));
-      visitMarkedFixies(c);
+    if (count == capacity) {
+      grow(c);
     }
 
-    Context* c;
-  } v(c);
+    tasks[(head + count) & (capacity - 1)] = task;
+    ++ count;
+  }
 
-  c->client->visitRoots(&v);
-}
+  bool pop(Context* c, Task* task) {
+    ACQUIRE_SPIN(c->system, &lock);
 
-bool
-limitExceeded(Context* c, int pendingAllocation)
-{
-  unsigned count = c->count + pendingAllocation
-    - (c->gen2.remaining() * BytesPerWord);
+    if (count) {
+      -- count;
+      *task = tasks[(head + count) & (capacity - 1)];
+      return true;
+    } else {
+      return false;
+    }
+  }
 
-  if (Verbose) {
-    if (count > c->limit) {
-      if (not c->limitWasExceeded) {
-        c->limitWasExceeded = true;
-        fprintf(stderr, "heap limit %d exceeded: %d\n", c->limit, count);
+  // take up to half of the oldest tasks from the specified queue
+  unsigned steal(Context* c, WorkQueue* victim) {
+    Task stolen[MaximumStealCount];
+    unsigned n;
+
+    { ACQUIRE_SPIN(c->system, &(victim->lock));
+
+      n = min(MaximumStealCount, (victim->count + 1) / 2);
+      for (unsigned i = 0; i < n; ++i) {
+        stolen[i] = victim->tasks[victim->head];
+        victim->head = (victim->head + 1) & (victim->capacity - 1);
       }
-    } else if (c->limitWasExceeded) {
-      c->limitWasExceeded = false;
-      fprintf(stderr, "heap limit %d no longer exceeded: %d\n",
-              c->limit, count);
+      victim->count -= n;
     }
+
+    for (unsigned i = 0; i < n; ++i) {
+      push(c, stolen[i]);
+    }
+
+    return n;
   }
 
-  return count > c->limit;
-}
+  void dispose(Context* c) {
+    if (tasks) {
+      local::free(c, tasks, capacity * sizeof(Task));
+    }
+  }
+
+  SpinLock lock;
+  Task* tasks;
+  unsigned capacity;
+  unsigned head;
+  unsigned count;
+};
+
+class CopyBuffer {
+ public:
+  CopyBuffer(): position(0), limit(0) { }
+
+  unsigned remaining() {
+    return limit - position;
+  }
+
+  uintptr_t* position;
+  uintptr_t* limit;
+};
 
 void
-collect(Context* c)
-{
-  if (limitExceeded(c, c->pendingAllocation)
-      or oversizedGen2(c)
-      or c->tenureFootprint + c->tenurePadding > c->gen2.remaining()
-      or c->fixieTenureFootprint + c->tenuredFixieFootprint
-      > c->tenuredFixieCeiling)
-  {
-    if (Verbose) {
-      if (limitExceeded(c, c->pendingAllocation)) {
-        fprintf(stderr, "low memory causes ");
-      } else if (oversizedGen2(c)) {
-        fprintf(stderr, "oversized gen2 causes ");
-      } else if (c->tenureFootprint + c->tenurePadding > c->gen2.remaining())
-      {
-        fprintf(stderr, "undersized gen2 causes ");
+work(Context* c, Worker* w);
+
+void
+scanRootGroups(Context* c, Worker* w);
+
+class Worker: public System::Runnable {
+ public:
+  Worker(Context* c, unsigned index):
+    c(c),
+    thread(0),
+    index(index),
+    seed(index + 1),
+    tenureFootprint(0)
+  { }
+
+  virtual void attach(System::Thread* t) {
+    thread = t;
+  }
+
+  virtual void run() {
+    unsigned phase = 0;
+    while (true) {
+      { ACQUIRE_MONITOR(thread, c->workerMonitor);
+
+        while (c->phase == phase and not c->shutdown) {
+          c->workerMonitor->wait(thread, 0);
+        }
+
+        if (c->shutdown) {
+          return;
+        }
+
+        phase = c->phase;
+      }
+
+      if (c->rootGroups) {
+        scanRootGroups(c, this);
       } else {
-        fprintf(stderr, "fixie ceiling causes ");
+        work(c, this);
       }
-    }
 
-    c->mode = Heap::MajorCollection;
+      atomicAdd(&(c->exitedWorkers), 1);
+    }
   }
 
-  int64_t then;
-  if (Verbose) {
-    if (c->mode == Heap::MajorCollection) {
-      fprintf(stderr, "major collection\n");
-    } else {
-      fprintf(stderr, "minor collection\n");
-    }
+  virtual bool interrupted() {
+    return false;
+  }
 
-    then = c->system->now();
+  virtual void setInterrupted(bool) {
+    // ignore
   }
 
-  initNextGen1(c);
+  Context* c;
+  System::Thread* thread;
+  unsigned index;
+  unsigned seed;
+  unsigned tenureFootprint;
+  WorkQueue queue;
+  CopyBuffer gen1Buffer;
+  CopyBuffer gen2Buffer;
+};
 
-  if (c->mode == Heap::MajorCollection) {
-    initNextGen2(c);
+void
+startWorkers(Context* c)
+{
+  c->claimLocks = static_cast<SpinLock*>
+    (local::allocate(c, ClaimLockCount * sizeof(SpinLock)));
+  for (unsigned i = 0; i < ClaimLockCount; ++i) {
+    new (c->claimLocks + i) SpinLock;
   }
 
-  collect2(c);
+  expect(c->system, c->system->success(c->system->make(&(c->workerMonitor))));
 
-  c->gen1.replaceWith(&(c->nextGen1));
-  if (c->mode == Heap::MajorCollection) {
-    c->gen2.replaceWith(&(c->nextGen2));
-  }
+  c->workers = static_cast<Worker**>
+    (local::allocate(c, c->workerCount * sizeof(Worker*)));
 
-  sweepFixies(c);
+  for (unsigned i = 0; i < c->workerCount; ++i) {
+    c->workers[i] = new (local::allocate(c, sizeof(Worker))) Worker(c, i);
+  }
 
-  if (Verbose) {
-    int64_t now = c->system->now();
-    int64_t collection = now - then;
-    int64_t run = then - c->lastCollectionTime;
-    c->totalCollectionTime += collection;
-    c->totalTime += collection + run;
-    c->lastCollectionTime = now;
+  // worker zero is whichever thread is collecting, and only needs a
+  // context for signalling the others:
+  expect(c->system, c->system->success(c->system->attach(c->workers[0])));
 
-    fprintf(stderr,
-            " - collect: %4dms; "
-            "total: %4dms; "
-            "run: %4dms; "
-            "total: %4dms\n",
-            static_cast<int>(collection),
-            static_cast<int>(c->totalCollectionTime),
-            static_cast<int>(run),
-            static_cast<int>(c->totalTime - c->totalCollectionTime));
+  for (unsigned i = 1; i < c->workerCount; ++i) {
+    expect(c->system, c->system->success(c->system->start(c->workers[i])));
+  }
+}
 
-    fprintf(stderr,
-            " -             gen1: %8d/%8d bytes\n",
-            c->gen1.position() * BytesPerWord,
-            c->gen1.capacity() * BytesPerWord);
+void
+disposeWorkers(Context* c)
+{
+  if (c->workers) {
+    { ACQUIRE_MONITOR(c->workers[0]->thread, c->workerMonitor);
+      c->shutdown = true;
+      c->workerMonitor->notifyAll(c->workers[0]->thread);
+    }
 
-    fprintf(stderr,
-            " -             gen2: %8d/%8d bytes\n",
-            c->gen2.position() * BytesPerWord,
-            c->gen2.capacity() * BytesPerWord);
+    for (unsigned i = 0; i < c->workerCount; ++i) {
+      Worker* w = c->workers[i];
+      if (i) {
+        w->thread->join();
+      }
+      w->thread->dispose();
+      w->queue.dispose(c);
+      local::free(c, w, sizeof(Worker));
+    }
 
-    fprintf(stderr,
-            " - untenured fixies:          %8d bytes\n",
-            c->untenuredFixieFootprint);
+    local::free(c, c->workers, c->workerCount * sizeof(Worker*));
+    local::free(c, c->claimLocks, ClaimLockCount * sizeof(SpinLock));
+    c->workerMonitor->dispose();
 
-    fprintf(stderr,
-            " -   tenured fixies:          %8d bytes\n",
-            c->tenuredFixieFootprint);
+    c->workers = 0;
   }
 }
 
 void*
-allocate(Context* c, unsigned size, bool limit)
+allocateCopy(Context* c, CopyBuffer* b, Segment* s, unsigned size)
 {
-  ACQUIRE(c->lock);
+  if (b->remaining() < size
+      and b->remaining() < MinimumCopyBufferRemainderInWords
+      and size < CopyBufferSizeInWords)
+  {
+    uintptr_t* p = static_cast<uintptr_t*>
+      (s->allocateAtomic(CopyBufferSizeInWords));
 
-  if (DebugAllocation) {
-    size = pad(size) + 2 * BytesPerWord;
+    if (p) {
+      b->position = p;
+      b->limit = p + CopyBufferSizeInWords;
+    }
+  }
+
+  if (b->remaining() >= size) {
+    void* p = b->position;
+    b->position += size;
+    return p;
+  } else {
+    void* p = s->allocateAtomic(size);
+    expect(c->system, p);
+    return p;
+  }
+}
+
+void*
+parallelCopy(Context* c, Worker* w, void* o)
+{
+  SpinLock* lock = c->claimLocks
+    + ((reinterpret_cast<uintptr_t>(o) / BytesPerWord) % ClaimLockCount);
+
+  void* r;
+  { ACQUIRE_SPIN(c->system, lock);
+
+    if (wasCollected(c, o)) {
+      return follow(c, o);
+    }
+
+    unsigned size = c->client->copiedSizeInWords(o);
+
+    if (c->gen1.contains(o)) {
+      unsigned age = c->ageMap.get(o);
+      if (age == TenureThreshold) {
+        r = allocateCopy(c, &(w->gen2Buffer), &(c->gen2), size);
+        c->client->copy(o, r);
+      } else {
+        r = allocateCopy(c, &(w->gen1Buffer), &(c->nextGen1), size);
+        c->client->copy(o, r);
+
+        c->nextAgeMap.setOnlyAtomic(r, age + 1);
+        if (age + 1 == TenureThreshold) {
+          w->tenureFootprint += size;
+        }
+      }
+    } else {
+      assert(c, not immortalHeapContains(c, o));
+
+      r = allocateCopy(c, &(w->gen1Buffer), &(c->nextGen1), size);
+      c->client->copy(o, r);
+
+      c->nextAgeMap.setOnlyAtomic(r, 0);
+    }
+
+    // other workers may read the copy as soon as they see the
+    // forwarding pointer, so it must be complete by then:
+    storeStoreMemoryBarrier();
+
+    fieldAtOffset<void*>(o, 0) = r;
+  }
+
+  w->queue.push(c, Task(0, r, 0));
+
+  return r;
+}
+
+void
+parallelMarkFixie(Context* c, Worker* w, void* o)
+{
+  Fixie* f = fixie(o);
+  if (f->age < FixieTenureThreshold) {
+    bool visit = false;
+    { ACQUIRE_SPIN(c->system, &(c->fixieLock));
+
+      if (not f->marked()) {
+        f->marked(true);
+        f->dead(false);
+        f->move(c, &(c->visitedFixies));
+        visit = true;
+      }
+    }
+
+    if (visit) {
+      w->queue.push(c, Task(0, o, 0));
+    }
+  }
+}
+
+void*
+parallelUpdate(Context* c, Worker* w, void* o)
+{
+  if (c->gen2.contains(o)) {
+    return o;
+  } else if (c->client->isFixed(o)) {
+    parallelMarkFixie(c, w, o);
+    return o;
+  } else if (immortalHeapContains(c, o) or fresh(c, o)) {
+    return o;
+  } else {
+    return parallelCopy(c, w, o);
+  }
+}
+
+void
+parallelUpdateHeapMap(Context* c, void** p, void* target, unsigned offset,
+                      void* result)
+{
+  if (not (immortalHeapContains(c, result)
+           or (c->client->isFixed(result)
+               and fixie(result)->age >= FixieTenureThreshold)
+           or c->gen2.contains(result)))
+  {
+    if (target and c->client->isFixed(target)) {
+      Fixie* f = fixie(target);
+      assert(c, offset == 0 or f->hasMask());
+
+      if (static_cast<unsigned>(f->age + 1) >= FixieTenureThreshold) {
+        ACQUIRE_SPIN(c->system, &(c->fixieLock));
+
+        f->dirty(true);
+        markBit(f->mask(), offset);
+      }
+    } else if (c->gen2.contains(p)) {
+      c->heapMap.markAtomic(p);
+    }
+  }
+}
+
+void
+parallelCollect(Context* c, Worker* w, void** p, void* target,
+                unsigned offset)
+{
+  void* o = maskAlignedPointer(*p);
+  if (o) {
+    void* result = parallelUpdate(c, w, o);
+    if (result != o) {
+      set(p, result);
+    }
+
+    parallelUpdateHeapMap(c, p, target, offset, result);
+  }
+}
+
+void
+process(Context* c, Worker* w, const Task& task)
+{
+  if (task.p) {
+    parallelCollect(c, w, task.p, task.target, task.offset);
+  } else {
+    class Walker: public Heap::Walker {
+     public:
+      Walker(Context* c, Worker* w, void* o):
+        c(c), w(w), o(o)
+      { }
+
+      virtual bool visit(unsigned offset) {
+        parallelCollect(c, w, getp(o, offset), o, offset);
+        return true;
+      }
+
+      Context* c;
+      Worker* w;
+      void* o;
+    } walker(c, w, task.target);
+
+    c->client->walk(task.target, &walker);
+  }
+}
+
+bool
+steal(Context* c, Worker* w)
+{
+  w->seed = (w->seed * 1103515245) + 12345;
+  unsigned start = w->seed % c->workerCount;
+
+  for (unsigned i = 0; i < c->workerCount; ++i) {
+    Worker* victim = c->workers[(start + i) % c->workerCount];
+    if (victim != w and victim->queue.count and w->queue.steal
+        (c, &(victim->queue)))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool
+workAvailable(Context* c)
+{
+  for (unsigned i = 0; i < c->workerCount; ++i) {
+    if (c->workers[i]->queue.count) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// process tasks until every queue is empty and every worker is idle
+void
+work(Context* c, Worker* w)
+{
+  Task task;
+  while (true) {
+    while (w->queue.pop(c, &task)) {
+      process(c, w, task);
+    }
+
+    if (steal(c, w)) {
+      continue;
+    }
+
+    atomicAdd(&(c->activeWorkers), -1);
+
+    while (true) {
+      if (c->activeWorkers == 0) {
+        return;
+      }
+
+      if (workAvailable(c)) {
+        atomicAdd(&(c->activeWorkers), 1);
+        if (steal(c, w)) {
+          break;
+        }
+        atomicAdd(&(c->activeWorkers), -1);
+      }
+
+      c->system->yield();
+    }
+  }
+}
+
+void
+drain(Context* c)
+{
+  Worker* w = c->workers[0];
+  // root groups may have left tasks in any queue
+  if (not workAvailable(c)) {
+    return;
+  }
+
+  c->draining = true;
+
+  if (c->synchronous) {
+    Task task;
+    while (w->queue.pop(c, &task)) {
+      process(c, w, task);
+    }
+  } else {
+    c->activeWorkers = c->workerCount;
+    c->exitedWorkers = 0;
+
+    { ACQUIRE_MONITOR(w->thread, c->workerMonitor);
+      ++ c->phase;
+      c->workerMonitor->notifyAll(w->thread);
+    }
+
+    work(c, w);
+
+    // wait for the others to notice we're done before reusing the
+    // counters:
+    while (c->exitedWorkers != c->workerCount - 1) {
+      c->system->yield();
+    }
+  }
+
+  c->draining = false;
+}
+
+// claim and visit root groups until there are none left, queueing
+// what they refer to for the drain which follows
+void
+scanRootGroups(Context* c, Worker* w)
+{
+  class Visitor : public Heap::Visitor {
+   public:
+    Visitor(Context* c, Worker* w): c(c), w(w) { }
+
+    virtual void visit(void* p) {
+      w->queue.push(c, Task(static_cast<void**>(p), 0, 0));
+    }
+
+    Context* c;
+    Worker* w;
+  } v(c, w);
+
+  for (uint32_t group = c->nextRootGroup; group < c->rootGroupCount;
+       group = c->nextRootGroup)
+  {
+    if (atomicCompareAndSwap32(&(c->nextRootGroup), group, group + 1)) {
+      c->rootGroups->visit(&v, group, w->index);
+    }
+  }
+}
+
+void
+visitRootGroups(Context* c, Heap::RootGroups* groups, unsigned count)
+{
+  Worker* w = c->workers[0];
+
+  c->rootGroups = groups;
+  c->rootGroupCount = count;
+  c->nextRootGroup = 0;
+  c->exitedWorkers = 0;
+
+  { ACQUIRE_MONITOR(w->thread, c->workerMonitor);
+    ++ c->phase;
+    c->workerMonitor->notifyAll(w->thread);
+  }
+
+  scanRootGroups(c, w);
+
+  while (c->exitedWorkers != c->workerCount - 1) {
+    c->system->yield();
+  }
+
+  c->rootGroups = 0;
+}
+
+void
+gatherDirty(Context* c, Worker* w, Segment::Map* map, unsigned start,
+            unsigned end)
+{
+  for (Segment::Map::Iterator it(map, start, end); it.hasMore();) {
+    if (map->child) {
+      assert(c, map->scale > 1);
+      unsigned s = it.next();
+
+      map->clearOnly(s);
+      gatherDirty(c, w, map->child, s, s + map->scale);
+    } else {
+      assert(c, map->scale == 1);
+      void** p = reinterpret_cast<void**>(map->segment->get(it.next()));
+
+      // parallelUpdateHeapMap will mark the slot again if necessary
+      map->clearOnly(p);
+      w->queue.push(c, Task(p, 0, 0));
+    }
+  }
+}
+
+void
+gatherDirtyFixies(Context* c, Worker* w)
+{
+  for (Fixie* f = c->dirtyTenuredFixies; f; f = f->next) {
+    uintptr_t* mask = f->mask();
+    for (unsigned i = 0; i < f->size; ++i) {
+      if (getBit(mask, i)) {
+        clearBit(mask, i);
+        w->queue.push(c, Task(f->body() + i, f->body(), i));
+      }
+    }
+  }
+}
+
+void
+cleanDirtyFixies(Context* c)
+{
+  for (Fixie** p = &(c->dirtyTenuredFixies); *p;) {
+    Fixie* f = *p;
+
+    bool clean = true;
+    for (unsigned i = 0; i < ceilingDivide(f->size, BitsPerWord); ++i) {
+      if (f->mask()[i]) {
+        clean = false;
+        break;
+      }
+    }
+
+    if (clean) {
+      markClean(c, f);
+    } else {
+      p = &(f->next);
+    }
+  }
+}
+
+void
+parallelCollect2(Context* c)
+{
+  if (c->workers == 0) {
+    startWorkers(c);
+  }
+
+  Worker* w = c->workers[0];
+
+  // tenured copies are allocated concurrently, so they can't be
+  // tracked lazily as in copy2:
+  c->gen2Base = c->gen2.position();
+
+  if (c->gen2.position()) {
+    gatherDirty(c, w, &(c->heapMap), 0, c->gen2.position());
+  }
+
+  gatherDirtyFixies(c, w);
+
+  c->parallelCollecting = true;
+  c->synchronous = false;
+
+  class Visitor : public Heap::Visitor {
+   public:
+    Visitor(Context* c, Worker* w): c(c), w(w) { }
+
+    virtual void visit(void* p) {
+      w->queue.push(c, Task(static_cast<void**>(p), 0, 0));
+      if (c->synchronous) {
+        drain(c);
+      }
+    }
+
+    Context* c;
+    Worker* w;
+  } v(c, w);
+
+  c->client->visitRoots(&v);
+
+  drain(c);
+
+  c->parallelCollecting = false;
+
+  for (unsigned i = 0; i < c->workerCount; ++i) {
+    Worker* w = c->workers[i];
+    c->tenureFootprint += w->tenureFootprint;
+    w->tenureFootprint = 0;
+    w->gen1Buffer = CopyBuffer();
+    w->gen2Buffer = CopyBuffer();
+  }
+
+  cleanDirtyFixies(c);
+}
+
+#else // not USE_ATOMIC_OPERATIONS
+
+void
+disposeWorkers(Context*)
+{ }
+
+#endif // not USE_ATOMIC_OPERATIONS
+
+void
+collect2(Context* c)
+{
+  c->gen2Base = Top;
+  c->tenureFootprint = 0;
+  c->fixieTenureFootprint = 0;
+  c->gen1Padding = 0;
+  c->tenurePadding = 0;
+
+  if (c->mode == Heap::MajorCollection) {
+    c->gen2Padding = 0;
+  }
+
+#ifdef USE_ATOMIC_OPERATIONS
+  if (parallel(c)) {
+    parallelCollect2(c);
+    return;
+  }
+#endif
+
+  if (c->mode == Heap::MinorCollection and c->gen2.position()) {
+    unsigned start = 0;
+    unsigned end = start + c->gen2.position();
+    bool dirty;
+    collect(c, &(c->heapMap), start, end, &dirty, false);
+  }
+
+  if (c->mode == Heap::MinorCollection) {
+    visitDirtyFixies(c, &(c->dirtyTenuredFixies));
+  }
+
+  class Visitor : public Heap::Visitor {
+   public:
+    Visitor(Context* c): c(c) { }
+
+    virtual void visit(void* p) {
+      local::collect(c, static_cast<void**>(p));
+      visitMarkedFixies(c);
+    }
+
+    Context* c;
+  } v(c);
+
+  c->client->visitRoots(&v);
+}
+
+bool
+limitExceeded(Context* c, int pendingAllocation)
+{
+  unsigned count = c->count + pendingAllocation
+    - (c->gen2.remaining() * BytesPerWord);
+
+  if (Verbose) {
+    if (count > c->limit) {
+      if (not c->limitWasExceeded) {
+        c->limitWasExceeded = true;
+        fprintf(stderr, "heap limit %d exceeded: %d\n", c->limit, count);
+      }
+    } else if (c->limitWasExceeded) {
+      c->limitWasExceeded = false;
+      fprintf(stderr, "heap limit %d no longer exceeded: %d\n",
+              c->limit, count);
+    }
+  }
+
+  return count > c->limit;
+}
+
+void
+collect(Context* c)
+{
+  Heap::CollectionStatistics* s = &(c->statistics);
+  s->upgradeCause = 0;
+
+  if (limitExceeded(c, c->pendingAllocation)
+      or oversizedGen2(c)
+      or tenureRequirement(c) > c->gen2.remaining()
+      or c->fixieTenureFootprint + c->tenuredFixieFootprint
+      > c->tenuredFixieCeiling)
+  {
+    const char* cause;
+    if (limitExceeded(c, c->pendingAllocation)) {
+      cause = "low-memory";
+    } else if (oversizedGen2(c)) {
+      cause = "oversized-gen2";
+    } else if (tenureRequirement(c) > c->gen2.remaining()) {
+      cause = "undersized-gen2";
+    } else {
+      cause = "fixie-ceiling";
+    }
+
+    if (Verbose) {
+      fprintf(stderr, "%s causes ", cause);
+    }
+
+    if (c->mode == Heap::MinorCollection) {
+      s->upgradeCause = cause;
+    }
+
+    c->mode = Heap::MajorCollection;
+  }
+
+  s->type = c->mode;
+
+  AVIAN_PROBE1(gc__begin, c->mode == Heap::MajorCollection);
+
+  s->gen1Before = (c->gen1.position() + c->incomingFootprint) * BytesPerWord;
+  s->gen2Before = c->gen2.position() * BytesPerWord;
+  s->fixieCountBefore = c->fixieCount;
+  s->fixieFootprintBefore = c->untenuredFixieFootprint
+    + c->tenuredFixieFootprint;
+
+  int64_t then;
+  if (Verbose) {
+    if (c->mode == Heap::MajorCollection) {
+      fprintf(stderr, "major collection\n");
+    } else {
+      fprintf(stderr, "minor collection\n");
+    }
+
+    then = c->system->now();
+  }
+
+  s->traceStart = c->system->nanoTime();
+
+  initNextGen1(c);
+
+  if (c->mode == Heap::MajorCollection) {
+    initNextGen2(c);
+  }
+
+  unsigned gen2Before = c->gen2.position();
+
+  collect2(c);
+
+  c->gen1.replaceWith(&(c->nextGen1));
+  if (c->mode == Heap::MajorCollection) {
+    c->gen2.replaceWith(&(c->nextGen2));
+
+    if (gen2Before) {
+      c->gen2Survival = min
+        (100, static_cast<unsigned>
+         ((static_cast<uint64_t>(c->gen2.position()) * 100) / gen2Before));
+    }
+  }
+
+  s->sweepStart = c->system->nanoTime();
+
+  sweepFixies(c);
+
+  s->end = c->system->nanoTime();
+
+  s->gen1After = c->gen1.position() * BytesPerWord;
+  s->gen2After = c->gen2.position() * BytesPerWord;
+  s->fixieCountAfter = c->fixieCount;
+  s->fixieFootprintAfter = c->untenuredFixieFootprint
+    + c->tenuredFixieFootprint;
+
+  AVIAN_PROBE2(gc__end, c->mode == Heap::MajorCollection,
+               s->gen1After + s->gen2After + s->fixieFootprintAfter);
+
+  if (Verbose) {
+    int64_t now = c->system->now();
+    int64_t collection = now - then;
+    int64_t run = then - c->lastCollectionTime;
+    c->totalCollectionTime += collection;
+    c->totalTime += collection + run;
+    c->lastCollectionTime = now;
+
+    fprintf(stderr,
+            " - collect: %4dms; "
+            "total: %4dms; "
+            "run: %4dms; "
+            "total: %4dms\n",
+            static_cast<int>(collection),
+            static_cast<int>(c->totalCollectionTime),
+            static_cast<int>(run),
+            static_cast<int>(c->totalTime - c->totalCollectionTime));
+
+    fprintf(stderr,
+            " -             gen1: %8d/%8d bytes\n",
+            c->gen1.position() * BytesPerWord,
+            c->gen1.capacity() * BytesPerWord);
+
+    fprintf(stderr,
+            " -             gen2: %8d/%8d bytes\n",
+            c->gen2.position() * BytesPerWord,
+            c->gen2.capacity() * BytesPerWord);
+
+    fprintf(stderr,
+            " - untenured fixies:          %8d bytes\n",
+            c->untenuredFixieFootprint);
+
+    fprintf(stderr,
+            " -   tenured fixies:          %8d bytes\n",
+            c->tenuredFixieFootprint);
+  }
+}
+
+void*
+allocate(Context* c, unsigned size, bool limit)
+{
+  ACQUIRE(c->lock);
+
+  if (DebugAllocation) {
+    size = pad(size) + 2 * BytesPerWord;
   }
 
   if ((not limit) or size + c->count < c->limit) {
@@ -1866,18 +2811,172 @@ free(Context* c, const void* p, unsigned size)
   c->count -= size;
 }
 
+bool
+useLargePages(Context* c, unsigned size)
+{
+  // smaller segments would waste most of a page rounding up
+  return c->largePages and (not DebugAllocation)
+    and size >= LargePageThresholdInBytes;
+}
+
+void*
+tryAllocateSegment(Context* c, unsigned size)
+{
+  if (useLargePages(c, size)) {
+    ACQUIRE(c->lock);
+
+    void* p = c->system->tryAllocateLarge(size);
+    if (p) {
+      c->count += size;
+    }
+    return p;
+  } else {
+    return allocate(c, size, false);
+  }
+}
+
+void*
+allocateSegment(Context* c, unsigned size)
+{
+  void* p = tryAllocateSegment(c, size);
+  expect(c->system, p);
+
+  return p;
+}
+
+void
+freeSegment(Context* c, const void* p, unsigned size)
+{
+  if (useLargePages(c, size)) {
+    ACQUIRE(c->lock);
+
+    expect(c->system, c->count >= size);
+
+    c->system->freeLarge(p, size);
+    c->count -= size;
+  } else {
+    free(c, p, size);
+  }
+}
+
 void
 free_(Context* c, const void* p, unsigned size)
 {
   free(c, p, size);
 }
 
+unsigned
+fixieClass(unsigned size, unsigned* classSize)
+{
+  if (size <= MinimumFixieClassSizeInBytes) {
+    *classSize = MinimumFixieClassSizeInBytes;
+    return 0;
+  }
+
+  // 2^(k - 1) < size <= 2^k
+  unsigned k = log(size);
+  unsigned base = 1 << (k - 1);
+  unsigned step = base / FixieClassesPerPowerOfTwo;
+  unsigned n = ceilingDivide(size - base, step);
+
+  *classSize = base + (n * step);
+  return 1 + ((k - 1 - log(MinimumFixieClassSizeInBytes))
+              * FixieClassesPerPowerOfTwo) + n - 1;
+}
+
+void*
+allocateFixie(Context* c, unsigned size)
+{
+  if (size <= MaximumFixieClassSizeInBytes) {
+    unsigned classSize;
+    unsigned index = fixieClass(size, &classSize);
+    assert(c, index < FixieClassCount);
+
+    { ACQUIRE(c->lock);
+
+      void* p = c->fixieCache[index];
+      if (p) {
+        c->fixieCache[index] = *static_cast<void**>(p);
+        c->fixieCacheFootprint -= classSize;
+        return p;
+      }
+    }
+
+    return allocate(c, classSize);
+  } else {
+    return allocate(c, size);
+  }
+}
+
+void
+freeFixie(Context* c, void* p, unsigned size)
+{
+  if (size <= MaximumFixieClassSizeInBytes) {
+    unsigned classSize;
+    unsigned index = fixieClass(size, &classSize);
+
+    { ACQUIRE(c->lock);
+
+      if (c->fixieCacheFootprint + classSize <= FixieCacheCeilingInBytes) {
+        *static_cast<void**>(p) = c->fixieCache[index];
+        c->fixieCache[index] = p;
+        c->fixieCacheFootprint += classSize;
+        return;
+      }
+    }
+
+    free(c, p, classSize);
+  } else {
+    free(c, p, size);
+  }
+}
+
+unsigned
+fixieClassSize(unsigned index)
+{
+  if (index == 0) {
+    return MinimumFixieClassSizeInBytes;
+  }
+
+  unsigned base = MinimumFixieClassSizeInBytes
+    << ((index - 1) / FixieClassesPerPowerOfTwo);
+  unsigned n = ((index - 1) % FixieClassesPerPowerOfTwo) + 1;
+
+  return base + (n * (base / FixieClassesPerPowerOfTwo));
+}
+
+void
+flushFixieCache(Context* c)
+{
+  for (unsigned i = 0; i < FixieClassCount; ++i) {
+    unsigned classSize = fixieClassSize(i);
+    while (c->fixieCache[i]) {
+      void* p = c->fixieCache[i];
+      c->fixieCache[i] = *static_cast<void**>(p);
+      free(c, p, classSize);
+    }
+  }
+
+  c->fixieCacheFootprint = 0;
+}
+
 class MyHeap: public Heap {
  public:
-  MyHeap(System* system, unsigned limit):
-    c(system, limit)
+  MyHeap(System* system, unsigned limit, unsigned workerCount,
+         unsigned targetFootprint, bool largePages):
+    c(system, limit, workerCount, targetFootprint, largePages)
   { }
 
+  // make sure any visits queued up so far have been processed before
+  // the client asks about the result
+  void drainPending() {
+#ifdef USE_ATOMIC_OPERATIONS
+    if (c.parallelCollecting and not c.draining) {
+      local::drain(&c);
+    }
+#endif
+  }
+
   virtual void setClient(Heap::Client* client) {
     assert(&c, c.client == 0);
     c.client = client;
@@ -1888,6 +2987,10 @@ class MyHeap: public Heap {
     c.immortalHeapEnd = start + sizeInWords;
   }
 
+  virtual bool immortal(void* p) {
+    return immortalHeapContains(&c, maskAlignedPointer(p));
+  }
+
   virtual unsigned limit() {
     return c.limit;
   }
@@ -1928,7 +3031,15 @@ class MyHeap: public Heap {
     expect(&c, not limitExceeded());
 
     unsigned total = Fixie::totalSize(sizeInWords, objectMask);
-    void* p = allocator->allocate(total);
+
+    // mortal fixies are swept by freeFixie, so they must come from the
+    // matching size-class allocator
+    assert(&c, immortal or allocator == this);
+    void* p = immortal ? allocator->allocate(total) : allocateFixie(&c, total);
+
+    if (not immortal) {
+      ++ c.fixieCount;
+    }
 
     expect(&c, not limitExceeded());
 
@@ -1969,6 +3080,12 @@ class MyHeap: public Heap {
   }
 
   virtual void mark(void* p, unsigned offset, unsigned count) {
+    // most stores are to objects which are still young, and fixies
+    // never live in gen1, so this avoids asking the client about them
+    if (c.gen1.contains(p)) {
+      return;
+    }
+
     if (needsMark(p)) {
 #ifndef USE_ATOMIC_OPERATIONS
       ACQUIRE(c.lock);
@@ -2036,6 +3153,8 @@ class MyHeap: public Heap {
   }
 
   virtual void* follow(void* p) {
+    drainPending();
+
     if (p == 0 or c.client->isFixed(p)) {
       return p;
     } else if (wasCollected(&c, p)) {
@@ -2051,11 +3170,38 @@ class MyHeap: public Heap {
     }
   }
 
+  virtual void visitRootGroups(Visitor* v, RootGroups* groups,
+                               unsigned count)
+  {
+#ifdef USE_ATOMIC_OPERATIONS
+    // nothing may be copied while the groups are visited, since they
+    // may read objects other workers would otherwise be moving
+    if (count > 1 and c.parallelCollecting and not c.synchronous
+        and not c.draining)
+    {
+      local::visitRootGroups(&c, groups, count);
+      return;
+    }
+#endif
+
+    for (unsigned i = 0; i < count; ++i) {
+      groups->visit(v, i, 0);
+    }
+  }
+
   virtual void postVisit() {
+    drainPending();
+
+    // the remaining visits depend on each other's results, so there's
+    // little to be gained from queueing them:
+    c.synchronous = true;
+
     killFixies(&c);
   }
 
   virtual Status status(void* p) {
+    drainPending();
+
     p = maskAlignedPointer(p);
 
     if (p == 0) {
@@ -2083,6 +3229,10 @@ class MyHeap: public Heap {
     }
   }
 
+  virtual const CollectionStatistics* lastCollection() {
+    return &(c.statistics);
+  }
+
   virtual CollectionType collectionType() {
     return c.mode;
   }
@@ -2107,10 +3257,11 @@ class MyHeap: public Heap {
 namespace vm {
 
 Heap*
-makeHeap(System* system, unsigned limit)
+makeHeap(System* system, unsigned limit, unsigned workerCount,
+         unsigned targetFootprint, bool largePages)
 {  
   return new (system->tryAllocate(sizeof(local::MyHeap)))
-    local::MyHeap(system, limit);
+    local::MyHeap(system, limit, workerCount, targetFootprint, largePages);
 }
 
 } // namespace vm
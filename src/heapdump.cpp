@@ -10,6 +10,8 @@
 
 #include "avian/machine.h"
 #include "avian/heapwalk.h"
+#include "avian/zlib-custom.h"
+#include <avian/util/runtime-array.h>
 
 using namespace vm;
 
@@ -55,6 +57,725 @@ objectSize(Thread* t, object o)
   return extendedSize(t, o, baseSize(t, o, objectClass(t, o)));
 }
 
+
+// HPROF 1.0.2, as read by Eclipse MAT and VisualVM
+enum {
+  HprofString = 0x01,
+  HprofLoadClass = 0x02,
+  HprofStackTrace = 0x05,
+  HprofHeapDumpSegment = 0x1C,
+  HprofHeapDumpEnd = 0x2C
+};
+
+enum {
+  HprofRootUnknown = 0xFF,
+  HprofRootStickyClass = 0x05,
+  HprofClassDump = 0x20,
+  HprofInstanceDump = 0x21,
+  HprofObjectArrayDump = 0x22,
+  HprofPrimitiveArrayDump = 0x23
+};
+
+enum {
+  HprofObject = 2,
+  HprofBoolean = 4,
+  HprofChar = 5,
+  HprofFloat = 6,
+  HprofDouble = 7,
+  HprofByte = 8,
+  HprofShort = 9,
+  HprofInt = 10,
+  HprofLong = 11
+};
+
+// heap dump sub-records are buffered up to this size and then
+// written as one segment, so the whole dump never has to be held at
+// once.  A bigger sub-record gets a segment to itself
+const unsigned HprofSegmentCapacity = 1024 * 1024;
+
+const unsigned HprofOutputCapacity = 64 * 1024;
+
+const unsigned HprofStackTraceSerial = 1;
+
+// fields of VM types with no Java declaration are named "$<offset>".
+// Their string IDs are odd, so they can't collide with the addresses
+// of the byte arrays which name everything else
+const unsigned HprofSyntheticNameCount = 1024;
+
+class HprofWriter {
+ public:
+  HprofWriter(Thread* t, FILE* out, bool compress):
+    t(t),
+    out(out),
+    segment(static_cast<uint8_t*>
+            (t->m->heap->allocate(HprofSegmentCapacity))),
+    output(compress ? static_cast<uint8_t*>
+           (t->m->heap->allocate(HprofOutputCapacity)) : 0),
+    position(0),
+    buffering(false),
+    nextClassSerial(1),
+    pendingRoot(false)
+  {
+    memset(syntheticNames, 0, sizeof(syntheticNames));
+
+    if (compress) {
+      memset(&zStream, 0, sizeof(z_stream));
+      // 16 + 15: a gzip wrapper around the largest window
+      int r UNUSED = deflateInit2(&zStream, Z_DEFAULT_COMPRESSION, 16 + 15);
+      expect(t, r == Z_OK);
+    }
+  }
+
+  void drain(int flush) {
+    zStream.next_in = 0;
+    zStream.avail_in = 0;
+    int r;
+    do {
+      zStream.next_out = output;
+      zStream.avail_out = HprofOutputCapacity;
+      r = deflate(&zStream, flush);
+      size_t n UNUSED = fwrite
+        (output, HprofOutputCapacity - zStream.avail_out, 1, out);
+    } while (r == Z_OK);
+  }
+
+  void raw(const void* p, unsigned size) {
+    if (size == 0) {
+      return;
+    }
+
+    if (output) {
+      zStream.next_in = static_cast<Bytef*>(const_cast<void*>(p));
+      zStream.avail_in = size;
+      while (zStream.avail_in) {
+        zStream.next_out = output;
+        zStream.avail_out = HprofOutputCapacity;
+        deflate(&zStream, Z_NO_FLUSH);
+        size_t n UNUSED = fwrite
+          (output, HprofOutputCapacity - zStream.avail_out, 1, out);
+      }
+    } else {
+      size_t n UNUSED = fwrite(p, size, 1, out);
+    }
+  }
+
+  void header(uint8_t tag, unsigned length) {
+    uint8_t b[] = { tag, 0, 0, 0, 0,
+                    static_cast<uint8_t>( length >> 24        ),
+                    static_cast<uint8_t>((length >> 16) & 0xFF),
+                    static_cast<uint8_t>((length >>  8) & 0xFF),
+                    static_cast<uint8_t>( length        & 0xFF) };
+    raw(b, sizeof(b));
+  }
+
+  void write(const void* p, unsigned size) {
+    if (buffering) {
+      assert(t, position + size <= HprofSegmentCapacity);
+      memcpy(segment + position, p, size);
+      position += size;
+    } else {
+      raw(p, size);
+    }
+  }
+
+  void write1(uint8_t v) {
+    write(&v, 1);
+  }
+
+  void write2(uint16_t v) {
+    uint8_t b[] = { static_cast<uint8_t>(v >> 8),
+                    static_cast<uint8_t>(v & 0xFF) };
+    write(b, 2);
+  }
+
+  void write4(uint32_t v) {
+    uint8_t b[] = { static_cast<uint8_t>( v >> 24        ),
+                    static_cast<uint8_t>((v >> 16) & 0xFF),
+                    static_cast<uint8_t>((v >>  8) & 0xFF),
+                    static_cast<uint8_t>( v        & 0xFF) };
+    write(b, 4);
+  }
+
+  void write8(uint64_t v) {
+    write4(v >> 32);
+    write4(v & 0xFFFFFFFF);
+  }
+
+  void writeId(uintptr_t v) {
+    if (BytesPerWord == 8) {
+      write8(v);
+    } else {
+      write4(v);
+    }
+  }
+
+  void writeId(object o) {
+    writeId(reinterpret_cast<uintptr_t>(o));
+  }
+
+  void flush() {
+    if (position) {
+      header(HprofHeapDumpSegment, position);
+      raw(segment, position);
+      position = 0;
+    }
+  }
+
+  // starts a top-level record, ending any heap dump segment
+  void record(uint8_t tag, unsigned length) {
+    flush();
+    buffering = false;
+    header(tag, length);
+  }
+
+  // starts a heap dump sub-record of the given size
+  void subrecord(unsigned size) {
+    if (size > HprofSegmentCapacity) {
+      flush();
+      buffering = false;
+      header(HprofHeapDumpSegment, size);
+    } else {
+      if (position + size > HprofSegmentCapacity) {
+        flush();
+      }
+      buffering = true;
+    }
+  }
+
+  void finish() {
+    record(HprofHeapDumpEnd, 0);
+
+    if (output) {
+      drain(Z_FINISH);
+      deflateEnd(&zStream);
+    }
+  }
+
+  void dispose() {
+    t->m->heap->free(segment, HprofSegmentCapacity);
+    if (output) {
+      t->m->heap->free(output, HprofOutputCapacity);
+    }
+  }
+
+  Thread* t;
+  FILE* out;
+  uint8_t* segment;
+  uint8_t* output;
+  z_stream zStream;
+  unsigned position;
+  bool buffering;
+  unsigned nextClassSerial;
+  bool pendingRoot;
+  uint8_t syntheticNames[HprofSyntheticNameCount + 1];
+};
+
+class HprofField {
+ public:
+  unsigned offset;
+  unsigned type;
+  object name;
+};
+
+unsigned
+hprofTypeSize(unsigned type)
+{
+  switch (type) {
+  case HprofObject: return BytesPerWord;
+  case HprofBoolean:
+  case HprofByte: return 1;
+  case HprofChar:
+  case HprofShort: return 2;
+  case HprofFloat:
+  case HprofInt: return 4;
+  case HprofDouble:
+  case HprofLong: return 8;
+  default: abort();
+  }
+}
+
+unsigned
+hprofType(Thread* t, unsigned fieldCode)
+{
+  switch (fieldCode) {
+  case ByteField: return HprofByte;
+  case BooleanField: return HprofBoolean;
+  case CharField: return HprofChar;
+  case ShortField: return HprofShort;
+  case FloatField: return HprofFloat;
+  case IntField: return HprofInt;
+  case LongField: return HprofLong;
+  case DoubleField: return HprofDouble;
+  case ObjectField: return HprofObject;
+  default: abort(t);
+  }
+}
+
+unsigned
+hprofArrayType(int8_t elementSpec)
+{
+  switch (elementSpec) {
+  case 'B': return HprofByte;
+  case 'Z': return HprofBoolean;
+  case 'C': return HprofChar;
+  case 'S': return HprofShort;
+  case 'F': return HprofFloat;
+  case 'I': return HprofInt;
+  case 'J': return HprofLong;
+  case 'D': return HprofDouble;
+  default: return HprofObject;
+  }
+}
+
+uintptr_t
+hprofNameId(object name, unsigned offset)
+{
+  if (name) {
+    return reinterpret_cast<uintptr_t>(name);
+  } else {
+    return (min(offset, HprofSyntheticNameCount) << 1) | 1;
+  }
+}
+
+void
+writeHprofName(HprofWriter* w, object name, unsigned offset)
+{
+  if (name) {
+    unsigned length = byteArrayLength(w->t, name) - 1;
+    w->record(HprofString, BytesPerWord + length);
+    w->writeId(name);
+    w->write(&byteArrayBody(w->t, name, 0), length);
+  } else {
+    offset = min(offset, HprofSyntheticNameCount);
+    if (w->syntheticNames[offset] == 0) {
+      w->syntheticNames[offset] = 1;
+
+      char buffer[16];
+      int length = offset == HprofSyntheticNameCount
+        ? vm::snprintf(buffer, sizeof(buffer), "$?")
+        : vm::snprintf(buffer, sizeof(buffer), "$%d", offset);
+      w->record(HprofString, BytesPerWord + length);
+      w->writeId(hprofNameId(0, offset));
+      w->write(buffer, length);
+    }
+  }
+}
+
+bool
+isJavaArray(Thread* t, object class_)
+{
+  return classArrayElementSize(t, class_)
+    and className(t, class_)
+    and byteArrayBody(t, className(t, class_), 0) == '[';
+}
+
+// HPROF can only describe plain instances and arrays, so objects with
+// both fixed fields and a variable-length body are written as arrays
+// of the references they hold
+bool
+isOpaque(Thread* t, object class_)
+{
+  return (classArrayElementSize(t, class_) and not isJavaArray(t, class_))
+    or (classVmFlags(t, class_) & (SingletonFlag | ContinuationFlag));
+}
+
+unsigned
+hprofFieldCapacity(Thread* t, object class_)
+{
+  unsigned capacity = classFixedSize(t, class_) / BytesPerWord;
+  if (classFieldTable(t, class_)) {
+    capacity = max(capacity, arrayLength(t, classFieldTable(t, class_)));
+  }
+  return capacity;
+}
+
+// the instance fields declared by class_ itself, excluding those of
+// its superclasses
+unsigned
+hprofInstanceFields(Thread* t, object class_, HprofField* fields)
+{
+  unsigned count = 0;
+  object table = classFieldTable(t, class_);
+  if (table) {
+    for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+      object field = arrayBody(t, table, i);
+      if ((fieldFlags(t, field) & ACC_STATIC) == 0) {
+        fields[count].offset = fieldOffset(t, field);
+        fields[count].type = hprofType(t, fieldCode(t, field));
+        fields[count].name = fieldName(t, field);
+        ++ count;
+      }
+    }
+  } else {
+    // a VM type with no Java declaration: describe it word by word,
+    // using the object mask to tell references apart
+    object super = classSuper(t, class_);
+    object mask = classObjectMask(t, class_);
+    for (unsigned offset = super ? classFixedSize(t, super) : BytesPerWord;
+         offset + BytesPerWord <= classFixedSize(t, class_);
+         offset += BytesPerWord)
+    {
+      unsigned i = offset / BytesPerWord;
+      bool reference = mask
+        and (intArrayBody(t, mask, i / 32)
+             & (static_cast<uint32_t>(1) << (i % 32)));
+
+      fields[count].offset = offset;
+      fields[count].type = reference ? HprofObject
+        : (BytesPerWord == 8 ? HprofLong : HprofInt);
+      fields[count].name = 0;
+      ++ count;
+    }
+  }
+  return count;
+}
+
+void
+writeHprofValue(HprofWriter* w, unsigned type, object o, unsigned offset)
+{
+  switch (type) {
+  case HprofObject:
+    w->writeId(maskAlignedPointer(fieldAtOffset<object>(o, offset)));
+    break;
+
+  case HprofBoolean:
+  case HprofByte:
+    w->write1(fieldAtOffset<uint8_t>(o, offset));
+    break;
+
+  case HprofChar:
+  case HprofShort:
+    w->write2(fieldAtOffset<uint16_t>(o, offset));
+    break;
+
+  case HprofFloat:
+  case HprofInt:
+    w->write4(fieldAtOffset<uint32_t>(o, offset));
+    break;
+
+  case HprofDouble:
+  case HprofLong: {
+    uint64_t v;
+    memcpy(&v, &fieldAtOffset<uint64_t>(o, offset), 8);
+    w->write8(v);
+  } break;
+
+  default: abort(w->t);
+  }
+}
+
+unsigned
+referenceCount(Thread* t, object o)
+{
+  unsigned count = 0;
+  for (int offset = walkNext(t, o, 0); offset != -1;
+       offset = walkNext(t, o, offset))
+  {
+    ++ count;
+  }
+  return count;
+}
+
+void
+writeHprofClass(HprofWriter* w, object class_)
+{
+  Thread* t = w->t;
+
+  THREAD_RUNTIME_ARRAY(t, HprofField, fields, hprofFieldCapacity(t, class_));
+  HprofField* f = RUNTIME_ARRAY_BODY(fields);
+  unsigned fieldCount = hprofInstanceFields(t, class_, f);
+
+  object table = classFieldTable(t, class_);
+  object staticTable = classStaticTable(t, class_);
+  unsigned staticCount = 0;
+  unsigned staticSize = 0;
+  if (table and staticTable) {
+    for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+      object field = arrayBody(t, table, i);
+      if (fieldFlags(t, field) & ACC_STATIC) {
+        writeHprofName(w, fieldName(t, field), 0);
+        ++ staticCount;
+        staticSize += BytesPerWord + 1 + hprofTypeSize
+          (hprofType(t, fieldCode(t, field)));
+      }
+    }
+  }
+
+  // the references held by the VM class itself (methods, constant
+  // pool, loader and so on) are written as extra static fields so they
+  // stay reachable from the class
+  unsigned vmReferenceCount = referenceCount(t, class_);
+  for (int offset = walkNext(t, class_, 0); offset != -1;
+       offset = walkNext(t, class_, offset))
+  {
+    writeHprofName(w, 0, offset * BytesPerWord);
+  }
+  staticCount += vmReferenceCount;
+  staticSize += vmReferenceCount * (BytesPerWord + 1 + BytesPerWord);
+
+  for (unsigned i = 0; i < fieldCount; ++i) {
+    writeHprofName(w, f[i].name, f[i].offset);
+  }
+
+  object name = className(t, class_);
+  if (name) {
+    writeHprofName(w, name, 0);
+  }
+
+  w->record(HprofLoadClass, 4 + BytesPerWord + 4 + BytesPerWord);
+  w->write4(w->nextClassSerial++);
+  w->writeId(class_);
+  w->write4(HprofStackTraceSerial);
+  w->writeId(name);
+
+  w->subrecord(1 + BytesPerWord + 4 + (BytesPerWord * 6) + 4 + 2
+               + 2 + staticSize
+               + 2 + fieldCount * (BytesPerWord + 1));
+  w->write1(HprofClassDump);
+  w->writeId(class_);
+  w->write4(HprofStackTraceSerial);
+  w->writeId(classSuper(t, class_));
+  w->writeId(classLoader(t, class_));
+  w->writeId(static_cast<uintptr_t>(0));
+  w->writeId(static_cast<uintptr_t>(0));
+  w->writeId(static_cast<uintptr_t>(0));
+  w->writeId(static_cast<uintptr_t>(0));
+  w->write4(classFixedSize(t, class_));
+  w->write2(0);
+
+  w->write2(staticCount);
+  if (table and staticTable) {
+    for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+      object field = arrayBody(t, table, i);
+      if (fieldFlags(t, field) & ACC_STATIC) {
+        unsigned type = hprofType(t, fieldCode(t, field));
+        w->writeId(fieldName(t, field));
+        w->write1(type);
+        writeHprofValue(w, type, staticTable, fieldOffset(t, field));
+      }
+    }
+  }
+
+  for (int offset = walkNext(t, class_, 0); offset != -1;
+       offset = walkNext(t, class_, offset))
+  {
+    w->writeId(hprofNameId(0, offset * BytesPerWord));
+    w->write1(HprofObject);
+    w->writeId(maskAlignedPointer
+               (fieldAtOffset<object>(class_, offset * BytesPerWord)));
+  }
+
+  w->write2(fieldCount);
+  for (unsigned i = 0; i < fieldCount; ++i) {
+    w->writeId(hprofNameId(f[i].name, f[i].offset));
+    w->write1(f[i].type);
+  }
+}
+
+void
+writeHprofInstance(HprofWriter* w, object o, object class_)
+{
+  Thread* t = w->t;
+
+  unsigned size = 0;
+  for (object c = class_; c; c = classSuper(t, c)) {
+    THREAD_RUNTIME_ARRAY(t, HprofField, fields, hprofFieldCapacity(t, c));
+    HprofField* f = RUNTIME_ARRAY_BODY(fields);
+    unsigned count = hprofInstanceFields(t, c, f);
+    for (unsigned i = 0; i < count; ++i) {
+      size += hprofTypeSize(f[i].type);
+    }
+  }
+
+  w->subrecord(1 + BytesPerWord + 4 + BytesPerWord + 4 + size);
+  w->write1(HprofInstanceDump);
+  w->writeId(o);
+  w->write4(HprofStackTraceSerial);
+  w->writeId(class_);
+  w->write4(size);
+
+  for (object c = class_; c; c = classSuper(t, c)) {
+    THREAD_RUNTIME_ARRAY(t, HprofField, fields, hprofFieldCapacity(t, c));
+    HprofField* f = RUNTIME_ARRAY_BODY(fields);
+    unsigned count = hprofInstanceFields(t, c, f);
+    for (unsigned i = 0; i < count; ++i) {
+      writeHprofValue(w, f[i].type, o, f[i].offset);
+    }
+  }
+}
+
+void
+writeHprofArray(HprofWriter* w, object o, object class_)
+{
+  Thread* t = w->t;
+
+  unsigned fixedSize = classFixedSize(t, class_);
+  unsigned length = fieldAtOffset<uintptr_t>(o, fixedSize - BytesPerWord);
+  unsigned type = hprofArrayType
+    (byteArrayBody(t, className(t, class_), 1));
+
+  if (type == HprofObject) {
+    w->subrecord(1 + BytesPerWord + 4 + 4 + BytesPerWord
+                 + length * BytesPerWord);
+    w->write1(HprofObjectArrayDump);
+    w->writeId(o);
+    w->write4(HprofStackTraceSerial);
+    w->write4(length);
+    w->writeId(class_);
+  } else {
+    w->subrecord(1 + BytesPerWord + 4 + 4 + 1
+                 + length * hprofTypeSize(type));
+    w->write1(HprofPrimitiveArrayDump);
+    w->writeId(o);
+    w->write4(HprofStackTraceSerial);
+    w->write4(length);
+    w->write1(type);
+  }
+
+  unsigned elementSize = classArrayElementSize(t, class_);
+  if (type == HprofByte or type == HprofBoolean) {
+    w->write(&fieldAtOffset<uint8_t>(o, fixedSize), length);
+  } else {
+    for (unsigned i = 0; i < length; ++i) {
+      writeHprofValue(w, type, o, fixedSize + (i * elementSize));
+    }
+  }
+}
+
+void
+writeHprofOpaque(HprofWriter* w, object o, object class_)
+{
+  Thread* t = w->t;
+
+  unsigned count = referenceCount(t, o);
+  if (count) {
+    w->subrecord(1 + BytesPerWord + 4 + 4 + BytesPerWord
+                 + count * BytesPerWord);
+    w->write1(HprofObjectArrayDump);
+    w->writeId(o);
+    w->write4(HprofStackTraceSerial);
+    w->write4(count);
+    w->writeId(class_);
+
+    for (int offset = walkNext(t, o, 0); offset != -1;
+         offset = walkNext(t, o, offset))
+    {
+      w->writeId(maskAlignedPointer
+                 (fieldAtOffset<object>(o, offset * BytesPerWord)));
+    }
+  } else {
+    unsigned length = (objectSize(t, o) - 1) * BytesPerWord;
+    w->subrecord(1 + BytesPerWord + 4 + 4 + 1 + length);
+    w->write1(HprofPrimitiveArrayDump);
+    w->writeId(o);
+    w->write4(HprofStackTraceSerial);
+    w->write4(length);
+    w->write1(HprofByte);
+    w->write(&fieldAtOffset<uint8_t>(o, BytesPerWord), length);
+  }
+}
+
+void
+writeHprofRoot(HprofWriter* w, object o)
+{
+  w->pendingRoot = false;
+
+  w->subrecord(1 + BytesPerWord);
+  w->write1(objectClass(w->t, o) == type(w->t, Machine::ClassType)
+            ? HprofRootStickyClass : HprofRootUnknown);
+  w->writeId(o);
+}
+
+
+class HistogramEntry {
+ public:
+  object class_;
+  uint64_t count;
+  uint64_t bytes;
+  uint64_t retained;
+};
+
+// counts objects by class, in an open-addressed table keyed by class
+class Histogram {
+ public:
+  Histogram(Thread* t):
+    t(t), entries(0), size(0), capacity(0)
+  {
+    grow();
+  }
+
+  void dispose() {
+    t->m->heap->free(entries, capacity * sizeof(HistogramEntry));
+  }
+
+  // returns the index of the entry for class_ plus one
+  unsigned find(object class_) {
+    unsigned mask = capacity - 1;
+    for (unsigned i = (reinterpret_cast<uintptr_t>(class_) >> 4) & mask;;
+         i = (i + 1) & mask)
+    {
+      HistogramEntry* e = entries + i;
+      if (e->class_ == class_) {
+        return i + 1;
+      } else if (e->class_ == 0) {
+        if ((size + 1) * 4 > capacity * 3) {
+          grow();
+          return find(class_);
+        }
+
+        e->class_ = class_;
+        ++ size;
+        return i + 1;
+      }
+    }
+  }
+
+  void grow() {
+    HistogramEntry* old = entries;
+    unsigned oldCapacity = capacity;
+
+    capacity = capacity ? capacity * 2 : 1024;
+    entries = static_cast<HistogramEntry*>
+      (t->m->heap->allocate(capacity * sizeof(HistogramEntry)));
+    memset(entries, 0, capacity * sizeof(HistogramEntry));
+    size = 0;
+
+    for (unsigned i = 0; i < oldCapacity; ++i) {
+      if (old[i].class_) {
+        HistogramEntry* e = entries + find(old[i].class_) - 1;
+        e->count = old[i].count;
+        e->bytes = old[i].bytes;
+        e->retained = old[i].retained;
+      }
+    }
+
+    if (old) {
+      t->m->heap->free(old, oldCapacity * sizeof(HistogramEntry));
+    }
+  }
+
+  Thread* t;
+  HistogramEntry* entries;
+  unsigned size;
+  unsigned capacity;
+};
+
+// an object on the path the heap walker took to reach the current one,
+// with the total size of it and the objects first reached through it
+class HistogramFrame {
+ public:
+  unsigned entry;
+  uint64_t size;
+};
+
+int
+compareHistogramEntries(const void* a, const void* b)
+{
+  uint64_t x = (*static_cast<HistogramEntry* const*>(a))->bytes;
+  uint64_t y = (*static_cast<HistogramEntry* const*>(b))->bytes;
+  return x > y ? -1 : (x < y ? 1 : 0);
+}
+
 } // namespace local
 
 } // namespace
@@ -117,4 +838,280 @@ dumpHeap(Thread* t, FILE* out)
   w->dispose();
 }
 
+
+bool
+dumpHprof(Thread* t, const char* path, bool compress)
+{
+  FILE* out = vm::fopen(path, "wb");
+  if (out == 0) {
+    return false;
+  }
+
+  class Visitor: public HeapVisitor {
+   public:
+    Visitor(local::HprofWriter* w): w(w), t(w->t), nextNumber(1) { }
+
+    virtual void root() {
+      w->pendingRoot = true;
+    }
+
+    virtual unsigned visitNew(object p) {
+      if (p) {
+        if (w->pendingRoot) {
+          local::writeHprofRoot(w, p);
+        }
+
+        object class_ = objectClass(t, p);
+        if (class_ == type(t, Machine::ClassType)) {
+          local::writeHprofClass(w, p);
+        } else if (local::isJavaArray(t, class_)) {
+          local::writeHprofArray(w, p, class_);
+        } else if (local::isOpaque(t, class_)) {
+          local::writeHprofOpaque(w, p, class_);
+        } else {
+          local::writeHprofInstance(w, p, class_);
+        }
+
+        return nextNumber++;
+      } else {
+        return 0;
+      }
+    }
+
+    virtual void visitOld(object p, unsigned) {
+      if (w->pendingRoot and p) {
+        local::writeHprofRoot(w, p);
+      }
+    }
+
+    virtual void push(object, unsigned, unsigned) {
+      w->pendingRoot = false;
+    }
+
+    virtual void pop() { }
+
+    local::HprofWriter* w;
+    Thread* t;
+    unsigned nextNumber;
+  };
+
+  local::HprofWriter w(t, out, compress);
+
+  const char magic[] = "JAVA PROFILE 1.0.2";
+  w.write(magic, sizeof(magic));
+  w.write4(BytesPerWord);
+  w.write8(t->m->system->now());
+
+  w.record(local::HprofStackTrace, 4 + 4 + 4);
+  w.write4(local::HprofStackTraceSerial);
+  w.write4(0);
+  w.write4(0);
+
+  Visitor visitor(&w);
+  HeapWalker* walker = makeHeapWalker(t, &visitor);
+  walker->visitAllRoots();
+  walker->dispose();
+
+  w.finish();
+  w.dispose();
+
+  fclose(out);
+
+  return true;
+}
+
+char*
+classHistogram(Thread* t, unsigned limit, bool retained, unsigned* size)
+{
+  // The walker visits each reachable object once, depth first, pushing
+  // and popping as it follows references, so alongside it we keep a
+  // stack of the objects on its path.  When one is popped, the objects
+  // first reached through it are done, and its size and theirs are
+  // added to what its parent keeps alive.  Objects reachable some
+  // other way are counted only for whichever path found them first,
+  // so this estimates retained sizes rather than computing dominators.
+  class Visitor: public HeapVisitor {
+   public:
+    Visitor(Thread* t, local::Histogram* histogram, bool retained):
+      t(t), histogram(histogram), retained(retained), frames(0),
+      frameCount(0), frameCapacity(0), lastClass(0), lastEntry(0)
+    { }
+
+    void dispose() {
+      if (frames) {
+        t->m->heap->free
+          (frames, frameCapacity * sizeof(local::HistogramFrame));
+      }
+    }
+
+    void pushFrame(unsigned entry, uint64_t size) {
+      if (frameCount == frameCapacity) {
+        unsigned capacity = frameCapacity ? frameCapacity * 2 : 1024;
+        local::HistogramFrame* a = static_cast<local::HistogramFrame*>
+          (t->m->heap->allocate(capacity * sizeof(local::HistogramFrame)));
+
+        if (frames) {
+          memcpy(a, frames, frameCount * sizeof(local::HistogramFrame));
+          t->m->heap->free
+            (frames, frameCapacity * sizeof(local::HistogramFrame));
+        }
+
+        frames = a;
+        frameCapacity = capacity;
+      }
+
+      local::HistogramFrame* f = frames + (frameCount++);
+      f->entry = entry;
+      f->size = size;
+    }
+
+    void popFrame() {
+      local::HistogramFrame* f = frames + (--frameCount);
+      local::HistogramFrame* parent = frameCount ? f - 1 : 0;
+
+      // the parent's total will include this one, so an instance
+      // reached through another of its class isn't counted twice
+      if (f->entry and (parent == 0 or parent->entry != f->entry)) {
+        histogram->entries[f->entry - 1].retained += f->size;
+      }
+
+      if (parent) {
+        parent->size += f->size;
+      }
+    }
+
+    void finish() {
+      while (frameCount) {
+        popFrame();
+      }
+    }
+
+    virtual void root() {
+      if (retained) {
+        finish();
+      }
+    }
+
+    virtual unsigned visitNew(object p) {
+      if (p) {
+        object class_ = objectClass(t, p);
+        if (class_ != lastClass) {
+          lastClass = class_;
+          lastEntry = histogram->find(class_);
+        }
+
+        unsigned size = local::objectSize(t, p);
+
+        local::HistogramEntry* e = histogram->entries + lastEntry - 1;
+        ++ e->count;
+        e->bytes += size;
+
+        if (retained) {
+          pushFrame(lastEntry, size);
+        }
+      } else if (retained) {
+        pushFrame(0, 0);
+      }
+
+      return 1;
+    }
+
+    virtual void visitOld(object, unsigned) {
+      if (retained) {
+        pushFrame(0, 0);
+      }
+    }
+
+    virtual void push(object, unsigned, unsigned) { }
+
+    virtual void pop() {
+      if (retained) {
+        popFrame();
+      }
+    }
+
+    Thread* t;
+    local::Histogram* histogram;
+    bool retained;
+    local::HistogramFrame* frames;
+    unsigned frameCount;
+    unsigned frameCapacity;
+    object lastClass;
+    unsigned lastEntry;
+  };
+
+  local::Histogram histogram(t);
+
+  Visitor visitor(t, &histogram, retained);
+
+  HeapWalker* walker = makeHeapWalker(t, &visitor);
+  walker->visitAllRoots();
+  walker->dispose();
+
+  visitor.finish();
+  visitor.dispose();
+
+  unsigned count = histogram.size;
+  unsigned entriesSize = max(count, 1U) * sizeof(local::HistogramEntry*);
+  local::HistogramEntry** entries = static_cast<local::HistogramEntry**>
+    (t->m->heap->allocate(entriesSize));
+
+  uint64_t totalCount = 0;
+  uint64_t totalBytes = 0;
+  unsigned j = 0;
+  for (unsigned i = 0; i < histogram.capacity; ++i) {
+    local::HistogramEntry* e = histogram.entries + i;
+    if (e->class_) {
+      entries[j++] = e;
+      totalCount += e->count;
+      totalBytes += e->bytes;
+    }
+  }
+
+  qsort(entries, count, sizeof(local::HistogramEntry*),
+        local::compareHistogramEntries);
+
+  if (limit and limit < count) {
+    count = limit;
+  }
+
+  // room for three 64-bit numbers and the spaces between them
+  const unsigned LineOverhead = 72;
+
+  *size = LineOverhead + 1;
+  for (unsigned i = 0; i < count; ++i) {
+    object name = className(t, entries[i]->class_);
+    *size += (name ? byteArrayLength(t, name) - 1 : 1) + LineOverhead;
+  }
+
+  char* report = static_cast<char*>(t->m->heap->allocate(*size));
+  unsigned length = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    local::HistogramEntry* e = entries[i];
+    object name = className(t, e->class_);
+    const char* n = name
+      ? reinterpret_cast<const char*>(&byteArrayBody(t, name, 0)) : "?";
+
+    if (retained) {
+      length += sprintf(report + length, "%" LLD " %" LLD " %" LLD " %s\n",
+                        static_cast<int64_t>(e->count),
+                        static_cast<int64_t>(e->bytes),
+                        static_cast<int64_t>(e->retained), n);
+    } else {
+      length += sprintf(report + length, "%" LLD " %" LLD " %s\n",
+                        static_cast<int64_t>(e->count),
+                        static_cast<int64_t>(e->bytes), n);
+    }
+  }
+
+  length += sprintf(report + length, "%" LLD " %" LLD " total\n",
+                    static_cast<int64_t>(totalCount),
+                    static_cast<int64_t>(totalBytes));
+
+  t->m->heap->free(entries, entriesSize);
+  histogram.dispose();
+
+  return report;
+}
+
 } // namespace vm
@@ -28,6 +28,20 @@ const unsigned FrameMethodOffset = 2;
 const unsigned FrameIpOffset = 3;
 const unsigned FrameFootprint = 4;
 
+const unsigned DefaultHotThreshold = 10000;
+
+// when true, count how often each pair of instructions is executed in
+// sequence and print the most frequent pairs when the VM exits, as a
+// guide to choosing superinstructions
+const bool ProfileSequences = false;
+
+const unsigned ReportedSequenceCount = 32;
+
+// the number of times the inline cache of an invokeinterface_quick
+// site may be replaced after a miss before the site is considered
+// megamorphic and left to look up each target anew
+const unsigned MaxInlineCacheUpdates = 4;
+
 class Thread: public vm::Thread {
  public:
   class ReferenceFrame {
@@ -226,6 +240,26 @@ pokeInt(Thread* t, unsigned index, uint32_t value)
   t->stack[(index * 2) + 1] = value;
 }
 
+inline uint32_t
+topInt(Thread* t)
+{
+  assert(t, t->stack[(t->sp - 1) * 2] == IntTag);
+  return t->stack[((t->sp - 1) * 2) + 1];
+}
+
+// overwrites the int on top of the operand stack in place, leaving its
+// tag and the stack pointer untouched
+inline void
+replaceInt(Thread* t, uint32_t value)
+{
+  if (DebugStack) {
+    fprintf(stderr, "replace int %d at %d\n", value, t->sp - 1);
+  }
+
+  assert(t, t->stack[(t->sp - 1) * 2] == IntTag);
+  t->stack[((t->sp - 1) * 2) + 1] = value;
+}
+
 inline void
 pokeLong(Thread* t, unsigned index, uint64_t value)
 {
@@ -297,6 +331,21 @@ setLocalObject(Thread* t, unsigned index, object value)
   pokeObject(t, frameBase(t, t->frame) + index, value);
 }
 
+void
+profile(Thread* t, object method, bool backEdge);
+
+void
+recordSequence(Thread* t, unsigned previous, unsigned instruction);
+
+inline void
+takeBranch(Thread* t, int32_t offset)
+{
+  if (offset <= 0) {
+    pollSafepoint(t);
+    profile(t, frameMethod(t, t->frame), true);
+  }
+}
+
 inline void
 setLocalInt(Thread* t, unsigned index, uint32_t value)
 {
@@ -336,6 +385,8 @@ pushFrame(Thread* t, object method)
   t->ip = 0;
 
   if ((methodFlags(t, method) & ACC_NATIVE) == 0) {
+    profile(t, method, false);
+
     t->code = methodCode(t, method);
 
     locals = codeMaxLocals(t, t->code);
@@ -642,7 +693,7 @@ invokeNative(Thread* t, object method)
   resolveNative(t, method);
 
   object native = methodRuntimeDataNative(t, getMethodRuntimeData(t, method));
-  if (nativeFast(t, native)) {
+  if (nativeFast(t, native) or nativeCritical(t, native)) {
     pushFrame(t, method);
 
     uint64_t result;
@@ -660,8 +711,13 @@ invokeNative(Thread* t, object method)
       marshalArguments
         (t, RUNTIME_ARRAY_BODY(args) + argOffset, 0, sp, method, true);
 
-      result = reinterpret_cast<FastNativeFunction>
-        (nativeFunction(t, native))(t, method, RUNTIME_ARRAY_BODY(args));
+      if (nativeCritical(t, native)) {
+        result = invokeCriticalNative
+          (t, method, nativeFunction(t, native), RUNTIME_ARRAY_BODY(args));
+      } else {
+        result = reinterpret_cast<FastNativeFunction>
+          (nativeFunction(t, native))(t, method, RUNTIME_ARRAY_BODY(args));
+      }
     }
 
     pushResult(t, methodReturnCode(t, method), result, false);
@@ -762,7 +818,7 @@ pushField(Thread* t, object target, object field)
 
   case DoubleField:
   case LongField:
-    pushLong(t, fieldAtOffset<int64_t>(target, fieldOffset(t, field)));
+    pushLong(t, getWideField(t, field, target));
     break;
 
   case ObjectField:
@@ -774,16 +830,252 @@ pushField(Thread* t, object target, object field)
   }
 }
 
+void
+popField(Thread* t, object field)
+{
+  switch (fieldCode(t, field)) {
+  case ByteField:
+  case BooleanField:
+  case CharField:
+  case ShortField:
+  case FloatField:
+  case IntField: {
+    int32_t value = popInt(t);
+    object o = popObject(t);
+    if (LIKELY(o)) {
+      switch (fieldCode(t, field)) {
+      case ByteField:
+      case BooleanField:
+        fieldAtOffset<int8_t>(o, fieldOffset(t, field)) = value;
+        break;
+            
+      case CharField:
+      case ShortField:
+        fieldAtOffset<int16_t>(o, fieldOffset(t, field)) = value;
+        break;
+            
+      case FloatField:
+      case IntField:
+        fieldAtOffset<int32_t>(o, fieldOffset(t, field)) = value;
+        break;
+      }
+    } else {
+      t->exception = makeThrowable(t, Machine::NullPointerExceptionType);
+    }
+  } break;
+
+  case DoubleField:
+  case LongField: {
+    int64_t value = popLong(t);
+    object o = popObject(t);
+    if (LIKELY(o)) {
+      setWideField(t, field, o, value);
+    } else {
+      t->exception = makeThrowable(t, Machine::NullPointerExceptionType);
+    }
+  } break;
+
+  case ObjectField: {
+    object value = popObject(t);
+    object o = popObject(t);
+    if (LIKELY(o)) {
+      set(t, o, fieldOffset(t, field), value);
+    } else {
+      t->exception = makeThrowable(t, Machine::NullPointerExceptionType);
+    }
+  } break;
+
+  default: abort(t);
+  }
+}
+
+void
+quicken(Thread* t, object code, unsigned ip, uint8_t instruction)
+{
+  // the operand (a constant pool index) is left as is and the pool
+  // entry has already been resolved, so a thread which reads either
+  // version of the opcode will execute it correctly
+  storeStoreMemoryBarrier();
+
+  codeBody(t, code, ip) = instruction;
+}
+
+inline object
+quickReference(Thread* t, object code, unsigned index)
+{
+  object o = singletonObject(t, codePool(t, code), index - 1);
+
+  loadMemoryBarrier();
+
+  return o;
+}
+
+// gives the invokeinterface at ip an entry in the inline caches of its
+// code and quickens it.  The number of the entry is kept in the two
+// bytes after the constant pool index, which hold a count and a zero
+// the interpreter otherwise skips, so a thread which reads either
+// version of the opcode will still execute it correctly.
+void
+quickenInterfaceCall(Thread* t, object code, unsigned ip)
+{
+  PROTECT(t, code);
+
+  ACQUIRE(t, t->m->classLock);
+
+  if (codeBody(t, code, ip) != invokeinterface) {
+    // another thread got here first
+    return;
+  }
+
+  // a method has room for fewer than 2^16 five-byte instructions, so
+  // the number fits
+  object old = codeInlineCaches(t, code);
+  unsigned site = old ? arrayLength(t, old) : 0;
+
+  object caches = makeArray(t, site + 1);
+  for (unsigned i = 0; i < site; ++i) {
+    set(t, caches, ArrayBody + (i * BytesPerWord), arrayBody(t, old, i));
+  }
+
+  set(t, code, CodeInlineCaches, caches);
+
+  codeBody(t, code, ip + 3) = site >> 8;
+  codeBody(t, code, ip + 4) = site & 0xFF;
+
+  quicken(t, code, ip, invokeinterface_quick);
+}
+
+// looks up the implementation of the specified interface method for
+// instances of the specified class and, unless the site has missed
+// too often already, remembers it in its inline cache
+object
+interfaceCacheMiss(Thread* t, object code, unsigned site, object method,
+                   object class_)
+{
+  object target = findInterfaceMethod(t, method, class_);
+
+  object caches = codeInlineCaches(t, code);
+  object cache = arrayBody(t, caches, site);
+  unsigned updates = cache ? inlineCacheUpdates(t, cache) : 0;
+  if (updates < MaxInlineCacheUpdates) {
+    PROTECT(t, target);
+    PROTECT(t, caches);
+
+    cache = makeInlineCache(t, class_, target, updates + 1);
+
+    // the class and method must be visible to other threads before
+    // the cache is
+    storeStoreMemoryBarrier();
+
+    set(t, caches, ArrayBody + (site * BytesPerWord), cache);
+  }
+
+  return target;
+}
+
+// with GCC and Clang, each instruction handler jumps directly to the
+// next one through a table of label addresses, which gives the branch
+// predictor a separate indirect branch per opcode; otherwise we loop
+// back to a single switch statement
+#if (defined __GNUC__) && (! defined AVIAN_SWITCH_DISPATCH)
+#  define AVIAN_THREADED_DISPATCH
+#endif
+
+#ifdef AVIAN_THREADED_DISPATCH
+#  define CASE(x) case vm::x: label_##x
+#  define DEFAULT default: label_default
+#  define DISPATCH                                      \
+  do {                                                  \
+    if (DebugRun or ProfileSequences) goto loop;        \
+    instruction = codeBody(t, code, ip++);              \
+    goto *dispatchTable[instruction];                   \
+  } while (0)
+#else
+#  define CASE(x) case vm::x
+#  define DEFAULT default
+#  define DISPATCH goto loop
+#endif
+
 object
 interpret3(Thread* t, const int base)
 {
   unsigned instruction = nop;
+  unsigned previous = nop;
   unsigned& ip = t->ip;
   unsigned& sp = t->sp;
   int& frame = t->frame;
   object& code = t->code;
   object& exception = t->exception;
   uintptr_t* stack = t->stack;
+#ifdef AVIAN_THREADED_DISPATCH
+  // indexed by opcode; see OpCode in constants.h
+  static void* const dispatchTable[] = {
+    &&label_nop, &&label_aconst_null, &&label_iconst_m1, &&label_iconst_0,
+    &&label_iconst_1, &&label_iconst_2, &&label_iconst_3, &&label_iconst_4,
+    &&label_iconst_5, &&label_lconst_0, &&label_lconst_1, &&label_fconst_0,
+    &&label_fconst_1, &&label_fconst_2, &&label_dconst_0, &&label_dconst_1,
+    &&label_bipush, &&label_sipush, &&label_ldc, &&label_ldc_w,
+    &&label_ldc2_w, &&label_iload, &&label_lload, &&label_fload,
+    &&label_dload, &&label_aload, &&label_iload_0, &&label_iload_1,
+    &&label_iload_2, &&label_iload_3, &&label_lload_0, &&label_lload_1,
+    &&label_lload_2, &&label_lload_3, &&label_fload_0, &&label_fload_1,
+    &&label_fload_2, &&label_fload_3, &&label_dload_0, &&label_dload_1,
+    &&label_dload_2, &&label_dload_3, &&label_aload_0, &&label_aload_1,
+    &&label_aload_2, &&label_aload_3, &&label_iaload, &&label_laload,
+    &&label_faload, &&label_daload, &&label_aaload, &&label_baload,
+    &&label_caload, &&label_saload, &&label_istore, &&label_lstore,
+    &&label_fstore, &&label_dstore, &&label_astore, &&label_istore_0,
+    &&label_istore_1, &&label_istore_2, &&label_istore_3, &&label_lstore_0,
+    &&label_lstore_1, &&label_lstore_2, &&label_lstore_3, &&label_fstore_0,
+    &&label_fstore_1, &&label_fstore_2, &&label_fstore_3, &&label_dstore_0,
+    &&label_dstore_1, &&label_dstore_2, &&label_dstore_3, &&label_astore_0,
+    &&label_astore_1, &&label_astore_2, &&label_astore_3, &&label_iastore,
+    &&label_lastore, &&label_fastore, &&label_dastore, &&label_aastore,
+    &&label_bastore, &&label_castore, &&label_sastore, &&label_pop_,
+    &&label_pop2, &&label_dup, &&label_dup_x1, &&label_dup_x2, &&label_dup2,
+    &&label_dup2_x1, &&label_dup2_x2, &&label_swap, &&label_iadd,
+    &&label_ladd, &&label_fadd, &&label_dadd, &&label_isub, &&label_lsub,
+    &&label_fsub, &&label_dsub, &&label_imul, &&label_lmul, &&label_fmul,
+    &&label_dmul, &&label_idiv, &&label_ldiv_, &&label_fdiv, &&label_ddiv,
+    &&label_irem, &&label_lrem, &&label_frem, &&label_drem, &&label_ineg,
+    &&label_lneg, &&label_fneg, &&label_dneg, &&label_ishl, &&label_lshl,
+    &&label_ishr, &&label_lshr, &&label_iushr, &&label_lushr, &&label_iand,
+    &&label_land, &&label_ior, &&label_lor, &&label_ixor, &&label_lxor,
+    &&label_iinc, &&label_i2l, &&label_i2f, &&label_i2d, &&label_l2i,
+    &&label_l2f, &&label_l2d, &&label_f2i, &&label_f2l, &&label_f2d,
+    &&label_d2i, &&label_d2l, &&label_d2f, &&label_i2b, &&label_i2c,
+    &&label_i2s, &&label_lcmp, &&label_fcmpl, &&label_fcmpg, &&label_dcmpl,
+    &&label_dcmpg, &&label_ifeq, &&label_ifne, &&label_iflt, &&label_ifge,
+    &&label_ifgt, &&label_ifle, &&label_if_icmpeq, &&label_if_icmpne,
+    &&label_if_icmplt, &&label_if_icmpge, &&label_if_icmpgt,
+    &&label_if_icmple, &&label_if_acmpeq, &&label_if_acmpne, &&label_goto_,
+    &&label_jsr, &&label_ret, &&label_tableswitch, &&label_lookupswitch,
+    &&label_ireturn, &&label_lreturn, &&label_freturn, &&label_dreturn,
+    &&label_areturn, &&label_return_, &&label_getstatic, &&label_putstatic,
+    &&label_getfield, &&label_putfield, &&label_invokevirtual,
+    &&label_invokespecial, &&label_invokestatic, &&label_invokeinterface,
+    &&label_default, &&label_new_, &&label_newarray, &&label_anewarray,
+    &&label_arraylength, &&label_athrow, &&label_checkcast,
+    &&label_instanceof, &&label_monitorenter, &&label_monitorexit,
+    &&label_wide, &&label_multianewarray, &&label_ifnull, &&label_ifnonnull,
+    &&label_goto_w, &&label_jsr_w, &&label_default, &&label_getfield_quick,
+    &&label_putfield_quick, &&label_invokevirtual_quick,
+    &&label_aload_0_getfield, &&label_iinc_goto, &&label_invokeinterface_quick,
+    &&label_default, &&label_default, &&label_default, &&label_default,
+    &&label_default, &&label_default, &&label_default, &&label_default,
+    &&label_default, &&label_default, &&label_default, &&label_default,
+    &&label_default, &&label_default, &&label_default, &&label_default,
+    &&label_default, &&label_default, &&label_default, &&label_default,
+    &&label_default, &&label_default, &&label_default, &&label_default,
+    &&label_default, &&label_default, &&label_default, &&label_default,
+    &&label_default, &&label_default, &&label_default, &&label_default,
+    &&label_default, &&label_default, &&label_default, &&label_default,
+    &&label_default, &&label_default, &&label_default, &&label_default,
+    &&label_default, &&label_default, &&label_default, &&label_default,
+    &&label_default, &&label_impdep1, &&label_default
+  };
+#endif
+
 
   code = methodCode(t, frameMethod(t, frame));
 
@@ -794,6 +1086,11 @@ interpret3(Thread* t, const int base)
  loop:
   instruction = codeBody(t, code, ip++);
 
+  if (ProfileSequences) {
+    recordSequence(t, previous, instruction);
+    previous = instruction;
+  }
+
   if (DebugRun) {
     fprintf(stderr, "ip: %d; instruction: 0x%x in %s.%s ",
             ip - 1,
@@ -817,7 +1114,7 @@ interpret3(Thread* t, const int base)
   }
 
   switch (instruction) {
-  case aaload: {
+  CASE(aaload): {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -836,9 +1133,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case aastore: {
+  CASE(aastore): {
     object value = popObject(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -847,7 +1144,21 @@ interpret3(Thread* t, const int base)
       if (LIKELY(index >= 0 and
                  static_cast<uintptr_t>(index) < objectArrayLength(t, array)))
       {
-        set(t, array, ArrayBody + (index * BytesPerWord), value);
+        if (value == 0 or LIKELY(quickArrayStoreCheck(t, array, value))) {
+          set(t, array, ArrayBody + (index * BytesPerWord), value);
+        } else {
+          PROTECT(t, array);
+          PROTECT(t, value);
+
+          if (checkArrayStore(t, array, value)) {
+            set(t, array, ArrayBody + (index * BytesPerWord), value);
+          } else {
+            exception = makeThrowable
+              (t, Machine::ArrayStoreExceptionType, "%s",
+               &byteArrayBody(t, className(t, objectClass(t, value)), 0));
+            goto throw_;
+          }
+        }
       } else {
         exception = makeThrowable
           (t, Machine::ArrayIndexOutOfBoundsExceptionType, "%d not in [0,%d)",
@@ -858,33 +1169,49 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case aconst_null: {
+  CASE(aconst_null): {
     pushObject(t, 0);
-  } goto loop;
+  } DISPATCH;
 
-  case aload: {
+  CASE(aload): {
     pushObject(t, localObject(t, codeBody(t, code, ip++)));
-  } goto loop;
+  } DISPATCH;
+
+  CASE(aload_0): {
+    if (codeBody(t, code, ip) == getfield_quick) {
+      quicken(t, code, ip - 1, aload_0_getfield);
+    }
 
-  case aload_0: {
     pushObject(t, localObject(t, 0));
-  } goto loop;
+  } DISPATCH;
+
+  CASE(aload_0_getfield): {
+    object target = localObject(t, 0);
+    if (LIKELY(target)) {
+      ++ ip;
+      pushField(t, target, quickReference
+                (t, code, codeReadInt16(t, code, ip)));
+    } else {
+      // let the getfield_quick which follows throw the exception
+      pushObject(t, target);
+    }
+  } DISPATCH;
 
-  case aload_1: {
+  CASE(aload_1): {
     pushObject(t, localObject(t, 1));
-  } goto loop;
+  } DISPATCH;
 
-  case aload_2: {
+  CASE(aload_2): {
     pushObject(t, localObject(t, 2));
-  } goto loop;
+  } DISPATCH;
 
-  case aload_3: {
+  CASE(aload_3): {
     pushObject(t, localObject(t, 3));
-  } goto loop;
+  } DISPATCH;
 
-  case anewarray: {
+  CASE(anewarray): {
     int32_t count = popInt(t);
 
     if (LIKELY(count >= 0)) {
@@ -898,20 +1225,20 @@ interpret3(Thread* t, const int base)
         (t, Machine::NegativeArraySizeExceptionType, "%d", count);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case areturn: {
+  CASE(areturn): {
     object result = popObject(t);
     if (frame > base) {
       popFrame(t);
       pushObject(t, result);
-      goto loop;
+      DISPATCH;
     } else {
       return result;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case arraylength: {
+  CASE(arraylength): {
     object array = popObject(t);
     if (LIKELY(array)) {
       pushInt(t, fieldAtOffset<uintptr_t>(array, BytesPerWord));
@@ -919,36 +1246,36 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case astore: {
+  CASE(astore): {
     store(t, codeBody(t, code, ip++));
-  } goto loop;
+  } DISPATCH;
 
-  case astore_0: {
+  CASE(astore_0): {
     store(t, 0);
-  } goto loop;
+  } DISPATCH;
 
-  case astore_1: {
+  CASE(astore_1): {
     store(t, 1);
-  } goto loop;
+  } DISPATCH;
 
-  case astore_2: {
+  CASE(astore_2): {
     store(t, 2);
-  } goto loop;
+  } DISPATCH;
 
-  case astore_3: {
+  CASE(astore_3): {
     store(t, 3);
-  } goto loop;
+  } DISPATCH;
 
-  case athrow: {
+  CASE(athrow): {
     exception = popObject(t);
     if (UNLIKELY(exception == 0)) {
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
     }
   } goto throw_;
 
-  case baload: {
+  CASE(baload): {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -982,9 +1309,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case bastore: {
+  CASE(bastore): {
     int8_t value = popInt(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -1018,13 +1345,13 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case bipush: {
+  CASE(bipush): {
     pushInt(t, static_cast<int8_t>(codeBody(t, code, ip++)));
-  } goto loop;
+  } DISPATCH;
 
-  case caload: {
+  CASE(caload): {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -1043,9 +1370,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case castore: {
+  CASE(castore): {
     uint16_t value = popInt(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -1065,9 +1392,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case checkcast: {
+  CASE(checkcast): {
     uint16_t index = codeReadInt16(t, code, ip);
 
     if (peekObject(t, sp - 1)) {
@@ -1083,13 +1410,13 @@ interpret3(Thread* t, const int base)
         goto throw_;
       }
     }
-  } goto loop;
+  } DISPATCH;
 
-  case d2f: {
+  CASE(d2f): {
     pushFloat(t, static_cast<float>(popDouble(t)));
-  } goto loop;
+  } DISPATCH;
 
-  case d2i: {
+  CASE(d2i): {
     double f = popDouble(t);
     switch (fpclassify(f)) {
     case FP_NAN: pushInt(t, 0); break;
@@ -1099,9 +1426,9 @@ interpret3(Thread* t, const int base)
          : (f <= INT32_MIN ? INT32_MIN : static_cast<int32_t>(f)));
       break;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case d2l: {
+  CASE(d2l): {
     double f = popDouble(t);
     switch (fpclassify(f)) {
     case FP_NAN: pushLong(t, 0); break;
@@ -1111,16 +1438,16 @@ interpret3(Thread* t, const int base)
          : (f <= INT64_MIN ? INT64_MIN : static_cast<int64_t>(f)));
       break;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case dadd: {
+  CASE(dadd): {
     double b = popDouble(t);
     double a = popDouble(t);
     
     pushDouble(t, a + b);
-  } goto loop;
+  } DISPATCH;
 
-  case daload: {
+  CASE(daload): {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -1139,9 +1466,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case dastore: {
+  CASE(dastore): {
     double value = popDouble(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -1161,9 +1488,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case dcmpg: {
+  CASE(dcmpg): {
     double b = popDouble(t);
     double a = popDouble(t);
     
@@ -1178,9 +1505,9 @@ interpret3(Thread* t, const int base)
     } else {
       pushInt(t, 1);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case dcmpl: {
+  CASE(dcmpl): {
     double b = popDouble(t);
     double a = popDouble(t);
     
@@ -1195,60 +1522,60 @@ interpret3(Thread* t, const int base)
     } else {
       pushInt(t, static_cast<unsigned>(-1));
     }
-  } goto loop;
+  } DISPATCH;
 
-  case dconst_0: {
+  CASE(dconst_0): {
     pushDouble(t, 0);
-  } goto loop;
+  } DISPATCH;
 
-  case dconst_1: {
+  CASE(dconst_1): {
     pushDouble(t, 1);
-  } goto loop;
+  } DISPATCH;
 
-  case ddiv: {
+  CASE(ddiv): {
     double b = popDouble(t);
     double a = popDouble(t);
     
     pushDouble(t, a / b);
-  } goto loop;
+  } DISPATCH;
 
-  case dmul: {
+  CASE(dmul): {
     double b = popDouble(t);
     double a = popDouble(t);
     
     pushDouble(t, a * b);
-  } goto loop;
+  } DISPATCH;
 
-  case dneg: {
+  CASE(dneg): {
     double a = popDouble(t);
     
     pushDouble(t, - a);
-  } goto loop;
+  } DISPATCH;
 
-  case vm::drem: {
+  CASE(drem): {
     double b = popDouble(t);
     double a = popDouble(t);
     
     pushDouble(t, fmod(a, b));
-  } goto loop;
+  } DISPATCH;
 
-  case dsub: {
+  CASE(dsub): {
     double b = popDouble(t);
     double a = popDouble(t);
     
     pushDouble(t, a - b);
-  } goto loop;
+  } DISPATCH;
 
-  case dup: {
+  CASE(dup): {
     if (DebugStack) {
       fprintf(stderr, "dup\n");
     }
 
     memcpy(stack + ((sp    ) * 2), stack + ((sp - 1) * 2), BytesPerWord * 2);
     ++ sp;
-  } goto loop;
+  } DISPATCH;
 
-  case dup_x1: {
+  CASE(dup_x1): {
     if (DebugStack) {
       fprintf(stderr, "dup_x1\n");
     }
@@ -1257,9 +1584,9 @@ interpret3(Thread* t, const int base)
     memcpy(stack + ((sp - 1) * 2), stack + ((sp - 2) * 2), BytesPerWord * 2);
     memcpy(stack + ((sp - 2) * 2), stack + ((sp    ) * 2), BytesPerWord * 2);
     ++ sp;
-  } goto loop;
+  } DISPATCH;
 
-  case dup_x2: {
+  CASE(dup_x2): {
     if (DebugStack) {
       fprintf(stderr, "dup_x2\n");
     }
@@ -1269,18 +1596,18 @@ interpret3(Thread* t, const int base)
     memcpy(stack + ((sp - 2) * 2), stack + ((sp - 3) * 2), BytesPerWord * 2);
     memcpy(stack + ((sp - 3) * 2), stack + ((sp    ) * 2), BytesPerWord * 2);
     ++ sp;
-  } goto loop;
+  } DISPATCH;
 
-  case dup2: {
+  CASE(dup2): {
     if (DebugStack) {
       fprintf(stderr, "dup2\n");
     }
 
     memcpy(stack + ((sp    ) * 2), stack + ((sp - 2) * 2), BytesPerWord * 4);
     sp += 2;
-  } goto loop;
+  } DISPATCH;
 
-  case dup2_x1: {
+  CASE(dup2_x1): {
     if (DebugStack) {
       fprintf(stderr, "dup2_x1\n");
     }
@@ -1290,9 +1617,9 @@ interpret3(Thread* t, const int base)
     memcpy(stack + ((sp - 1) * 2), stack + ((sp - 3) * 2), BytesPerWord * 2);
     memcpy(stack + ((sp - 3) * 2), stack + ((sp    ) * 2), BytesPerWord * 4);
     sp += 2;
-  } goto loop;
+  } DISPATCH;
 
-  case dup2_x2: {
+  CASE(dup2_x2): {
     if (DebugStack) {
       fprintf(stderr, "dup2_x2\n");
     }
@@ -1303,13 +1630,13 @@ interpret3(Thread* t, const int base)
     memcpy(stack + ((sp - 2) * 2), stack + ((sp - 4) * 2), BytesPerWord * 2);
     memcpy(stack + ((sp - 4) * 2), stack + ((sp    ) * 2), BytesPerWord * 4);
     sp += 2;
-  } goto loop;
+  } DISPATCH;
 
-  case f2d: {
+  CASE(f2d): {
     pushDouble(t, popFloat(t));
-  } goto loop;
+  } DISPATCH;
 
-  case f2i: {
+  CASE(f2i): {
     float f = popFloat(t);
     switch (fpclassify(f)) {
     case FP_NAN: pushInt(t, 0); break;
@@ -1318,9 +1645,9 @@ interpret3(Thread* t, const int base)
                      : (f <= INT32_MIN ? INT32_MIN : static_cast<int32_t>(f)));
       break;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case f2l: {
+  CASE(f2l): {
     float f = popFloat(t);
     switch (fpclassify(f)) {
     case FP_NAN: pushLong(t, 0); break;
@@ -1328,16 +1655,16 @@ interpret3(Thread* t, const int base)
       break;
     default: pushLong(t, static_cast<int64_t>(f)); break;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case fadd: {
+  CASE(fadd): {
     float b = popFloat(t);
     float a = popFloat(t);
     
     pushFloat(t, a + b);
-  } goto loop;
+  } DISPATCH;
 
-  case faload: {
+  CASE(faload): {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -1356,9 +1683,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case fastore: {
+  CASE(fastore): {
     float value = popFloat(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -1378,9 +1705,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case fcmpg: {
+  CASE(fcmpg): {
     float b = popFloat(t);
     float a = popFloat(t);
     
@@ -1395,9 +1722,9 @@ interpret3(Thread* t, const int base)
     } else {
       pushInt(t, 1);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case fcmpl: {
+  CASE(fcmpl): {
     float b = popFloat(t);
     float a = popFloat(t);
     
@@ -1412,55 +1739,55 @@ interpret3(Thread* t, const int base)
     } else {
       pushInt(t, static_cast<unsigned>(-1));
     }
-  } goto loop;
+  } DISPATCH;
 
-  case fconst_0: {
+  CASE(fconst_0): {
     pushFloat(t, 0);
-  } goto loop;
+  } DISPATCH;
 
-  case fconst_1: {
+  CASE(fconst_1): {
     pushFloat(t, 1);
-  } goto loop;
+  } DISPATCH;
 
-  case fconst_2: {
+  CASE(fconst_2): {
     pushFloat(t, 2);
-  } goto loop;
+  } DISPATCH;
 
-  case fdiv: {
+  CASE(fdiv): {
     float b = popFloat(t);
     float a = popFloat(t);
     
     pushFloat(t, a / b);
-  } goto loop;
+  } DISPATCH;
 
-  case fmul: {
+  CASE(fmul): {
     float b = popFloat(t);
     float a = popFloat(t);
     
     pushFloat(t, a * b);
-  } goto loop;
+  } DISPATCH;
 
-  case fneg: {
+  CASE(fneg): {
     float a = popFloat(t);
     
     pushFloat(t, - a);
-  } goto loop;
+  } DISPATCH;
 
-  case frem: {
+  CASE(frem): {
     float b = popFloat(t);
     float a = popFloat(t);
     
     pushFloat(t, fmodf(a, b));
-  } goto loop;
+  } DISPATCH;
 
-  case fsub: {
+  CASE(fsub): {
     float b = popFloat(t);
     float a = popFloat(t);
     
     pushFloat(t, a - b);
-  } goto loop;
+  } DISPATCH;
 
-  case getfield: {
+  CASE(getfield): {
     if (LIKELY(peekObject(t, sp - 1))) {
       uint16_t index = codeReadInt16(t, code, ip);
     
@@ -1470,6 +1797,10 @@ interpret3(Thread* t, const int base)
 
       PROTECT(t, field);
 
+      if ((fieldFlags(t, field) & ACC_VOLATILE) == 0) {
+        quicken(t, code, ip - 3, getfield_quick);
+      }
+
       ACQUIRE_FIELD_FOR_READ(t, field);
 
       pushField(t, popObject(t), field);
@@ -1477,9 +1808,19 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case getstatic: {
+  CASE(getfield_quick): {
+    if (LIKELY(peekObject(t, sp - 1))) {
+      pushField(t, popObject(t), quickReference
+                (t, code, codeReadInt16(t, code, ip)));
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(getstatic): {
     uint16_t index = codeReadInt16(t, code, ip);
 
     object field = resolveField(t, frameMethod(t, frame), index - 1);
@@ -1493,50 +1834,52 @@ interpret3(Thread* t, const int base)
     ACQUIRE_FIELD_FOR_READ(t, field);
 
     pushField(t, classStaticTable(t, fieldClass(t, field)), field);
-  } goto loop;
+  } DISPATCH;
 
-  case goto_: {
+  CASE(goto_): {
     int16_t offset = codeReadInt16(t, code, ip);
     ip = (ip - 3) + offset;
-  } goto loop;
+    takeBranch(t, offset);
+  } DISPATCH;
     
-  case goto_w: {
+  CASE(goto_w): {
     int32_t offset = codeReadInt32(t, code, ip);
     ip = (ip - 5) + offset;
-  } goto loop;
+    takeBranch(t, offset);
+  } DISPATCH;
 
-  case i2b: {
-    pushInt(t, static_cast<int8_t>(popInt(t)));
-  } goto loop;
+  CASE(i2b): {
+    replaceInt(t, static_cast<int8_t>(topInt(t)));
+  } DISPATCH;
 
-  case i2c: {
-    pushInt(t, static_cast<uint16_t>(popInt(t)));
-  } goto loop;
+  CASE(i2c): {
+    replaceInt(t, static_cast<uint16_t>(topInt(t)));
+  } DISPATCH;
 
-  case i2d: {
+  CASE(i2d): {
     pushDouble(t, static_cast<double>(static_cast<int32_t>(popInt(t))));
-  } goto loop;
+  } DISPATCH;
 
-  case i2f: {
+  CASE(i2f): {
     pushFloat(t, static_cast<float>(static_cast<int32_t>(popInt(t))));
-  } goto loop;
+  } DISPATCH;
 
-  case i2l: {
+  CASE(i2l): {
     pushLong(t, static_cast<int32_t>(popInt(t)));
-  } goto loop;
+  } DISPATCH;
 
-  case i2s: {
-    pushInt(t, static_cast<int16_t>(popInt(t)));
-  } goto loop;
+  CASE(i2s): {
+    replaceInt(t, static_cast<int16_t>(topInt(t)));
+  } DISPATCH;
 
-  case iadd: {
+  CASE(iadd): {
     int32_t b = popInt(t);
-    int32_t a = popInt(t);
+    int32_t a = topInt(t);
     
-    pushInt(t, a + b);
-  } goto loop;
+    replaceInt(t, a + b);
+  } DISPATCH;
 
-  case iaload: {
+  CASE(iaload): {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -1555,16 +1898,16 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case iand: {
+  CASE(iand): {
     int32_t b = popInt(t);
-    int32_t a = popInt(t);
+    int32_t a = topInt(t);
     
-    pushInt(t, a & b);
-  } goto loop;
+    replaceInt(t, a & b);
+  } DISPATCH;
 
-  case iastore: {
+  CASE(iastore): {
     int32_t value = popInt(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -1584,37 +1927,37 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case iconst_m1: {
+  CASE(iconst_m1): {
     pushInt(t, static_cast<unsigned>(-1));
-  } goto loop;
+  } DISPATCH;
 
-  case iconst_0: {
+  CASE(iconst_0): {
     pushInt(t, 0);
-  } goto loop;
+  } DISPATCH;
 
-  case iconst_1: {
+  CASE(iconst_1): {
     pushInt(t, 1);
-  } goto loop;
+  } DISPATCH;
 
-  case iconst_2: {
+  CASE(iconst_2): {
     pushInt(t, 2);
-  } goto loop;
+  } DISPATCH;
 
-  case iconst_3: {
+  CASE(iconst_3): {
     pushInt(t, 3);
-  } goto loop;
+  } DISPATCH;
 
-  case iconst_4: {
+  CASE(iconst_4): {
     pushInt(t, 4);
-  } goto loop;
+  } DISPATCH;
 
-  case iconst_5: {
+  CASE(iconst_5): {
     pushInt(t, 5);
-  } goto loop;
+  } DISPATCH;
 
-  case idiv: {
+  CASE(idiv): {
     int32_t b = popInt(t);
     int32_t a = popInt(t);
 
@@ -1624,9 +1967,9 @@ interpret3(Thread* t, const int base)
     }
     
     pushInt(t, a / b);
-  } goto loop;
+  } DISPATCH;
 
-  case if_acmpeq: {
+  CASE(if_acmpeq): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     object b = popObject(t);
@@ -1634,10 +1977,11 @@ interpret3(Thread* t, const int base)
     
     if (a == b) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case if_acmpne: {
+  CASE(if_acmpne): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     object b = popObject(t);
@@ -1645,10 +1989,11 @@ interpret3(Thread* t, const int base)
     
     if (a != b) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case if_icmpeq: {
+  CASE(if_icmpeq): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     int32_t b = popInt(t);
@@ -1656,10 +2001,11 @@ interpret3(Thread* t, const int base)
     
     if (a == b) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case if_icmpne: {
+  CASE(if_icmpne): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     int32_t b = popInt(t);
@@ -1667,10 +2013,11 @@ interpret3(Thread* t, const int base)
     
     if (a != b) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case if_icmpgt: {
+  CASE(if_icmpgt): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     int32_t b = popInt(t);
@@ -1678,10 +2025,11 @@ interpret3(Thread* t, const int base)
     
     if (a > b) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case if_icmpge: {
+  CASE(if_icmpge): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     int32_t b = popInt(t);
@@ -1689,10 +2037,11 @@ interpret3(Thread* t, const int base)
     
     if (a >= b) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case if_icmplt: {
+  CASE(if_icmplt): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     int32_t b = popInt(t);
@@ -1700,10 +2049,11 @@ interpret3(Thread* t, const int base)
     
     if (a < b) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case if_icmple: {
+  CASE(if_icmple): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     int32_t b = popInt(t);
@@ -1711,117 +2061,142 @@ interpret3(Thread* t, const int base)
     
     if (a <= b) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ifeq: {
+  CASE(ifeq): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (popInt(t) == 0) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ifne: {
+  CASE(ifne): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (popInt(t)) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ifgt: {
+  CASE(ifgt): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (static_cast<int32_t>(popInt(t)) > 0) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ifge: {
+  CASE(ifge): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (static_cast<int32_t>(popInt(t)) >= 0) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case iflt: {
+  CASE(iflt): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (static_cast<int32_t>(popInt(t)) < 0) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ifle: {
+  CASE(ifle): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (static_cast<int32_t>(popInt(t)) <= 0) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ifnonnull: {
+  CASE(ifnonnull): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (popObject(t)) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ifnull: {
+  CASE(ifnull): {
     int16_t offset = codeReadInt16(t, code, ip);
 
     if (popObject(t) == 0) {
       ip = (ip - 3) + offset;
+      takeBranch(t, offset);
+    }
+  } DISPATCH;
+
+  CASE(iinc): {
+    if (codeBody(t, code, ip + 2) == goto_) {
+      quicken(t, code, ip - 1, iinc_goto);
     }
-  } goto loop;
 
-  case iinc: {
     uint8_t index = codeBody(t, code, ip++);
     int8_t c = codeBody(t, code, ip++);
     
     setLocalInt(t, index, localInt(t, index) + c);
-  } goto loop;
+  } DISPATCH;
+
+  CASE(iinc_goto): {
+    uint8_t index = codeBody(t, code, ip++);
+    int8_t c = codeBody(t, code, ip++);
+    
+    setLocalInt(t, index, localInt(t, index) + c);
 
-  case iload:
-  case fload: {
+    ++ ip;
+    int16_t offset = codeReadInt16(t, code, ip);
+    ip = (ip - 3) + offset;
+    takeBranch(t, offset);
+  } DISPATCH;
+
+  CASE(iload):
+  CASE(fload): {
     pushInt(t, localInt(t, codeBody(t, code, ip++)));
-  } goto loop;
+  } DISPATCH;
 
-  case iload_0:
-  case fload_0: {
+  CASE(iload_0):
+  CASE(fload_0): {
     pushInt(t, localInt(t, 0));
-  } goto loop;
+  } DISPATCH;
 
-  case iload_1:
-  case fload_1: {
+  CASE(iload_1):
+  CASE(fload_1): {
     pushInt(t, localInt(t, 1));
-  } goto loop;
+  } DISPATCH;
 
-  case iload_2:
-  case fload_2: {
+  CASE(iload_2):
+  CASE(fload_2): {
     pushInt(t, localInt(t, 2));
-  } goto loop;
+  } DISPATCH;
 
-  case iload_3:
-  case fload_3: {
+  CASE(iload_3):
+  CASE(fload_3): {
     pushInt(t, localInt(t, 3));
-  } goto loop;
+  } DISPATCH;
 
-  case imul: {
+  CASE(imul): {
     int32_t b = popInt(t);
-    int32_t a = popInt(t);
+    int32_t a = topInt(t);
     
-    pushInt(t, a * b);
-  } goto loop;
+    replaceInt(t, a * b);
+  } DISPATCH;
 
-  case ineg: {
-    pushInt(t, - popInt(t));
-  } goto loop;
+  CASE(ineg): {
+    replaceInt(t, - topInt(t));
+  } DISPATCH;
 
-  case instanceof: {
+  CASE(instanceof): {
     uint16_t index = codeReadInt16(t, code, ip);
 
     if (peekObject(t, sp - 1)) {
@@ -1836,14 +2211,17 @@ interpret3(Thread* t, const int base)
       popObject(t);
       pushInt(t, 0);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case invokeinterface: {
+  CASE(invokeinterface): {
     uint16_t index = codeReadInt16(t, code, ip);
     
     ip += 2;
 
     object method = resolveMethod(t, frameMethod(t, frame), index - 1);
+    PROTECT(t, method);
+
+    quickenInterfaceCall(t, code, ip - 5);
     
     unsigned parameterFootprint = methodParameterFootprint(t, method);
     if (LIKELY(peekObject(t, sp - parameterFootprint))) {
@@ -1854,9 +2232,34 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
+
+  CASE(invokeinterface_quick): {
+    // the operands and the inline caches of the code were written
+    // before the opcode; see quickenInterfaceCall
+    loadMemoryBarrier();
+
+    object method = quickReference(t, code, codeReadInt16(t, code, ip));
+    uint16_t site = codeReadInt16(t, code, ip);
+
+    unsigned parameterFootprint = methodParameterFootprint(t, method);
+    object receiver = peekObject(t, sp - parameterFootprint);
+    if (LIKELY(receiver)) {
+      object class_ = objectClass(t, receiver);
+      object cache = arrayBody(t, codeInlineCaches(t, code), site);
+      if (LIKELY(cache and inlineCacheClass(t, cache) == class_)) {
+        code = inlineCacheMethod(t, cache);
+      } else {
+        code = interfaceCacheMiss(t, code, site, method, class_);
+      }
+      goto invoke;
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
 
-  case invokespecial: {
+  CASE(invokespecial): {
     uint16_t index = codeReadInt16(t, code, ip);
 
     object method = resolveMethod(t, frameMethod(t, frame), index - 1);
@@ -1881,9 +2284,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case invokestatic: {
+  CASE(invokestatic): {
     uint16_t index = codeReadInt16(t, code, ip);
 
     object method = resolveMethod(t, frameMethod(t, frame), index - 1);
@@ -1894,10 +2297,12 @@ interpret3(Thread* t, const int base)
     code = method;
   } goto invoke;
 
-  case invokevirtual: {
+  CASE(invokevirtual): {
     uint16_t index = codeReadInt16(t, code, ip);
 
     object method = resolveMethod(t, frameMethod(t, frame), index - 1);
+
+    quicken(t, code, ip - 3, invokevirtual_quick);
     
     unsigned parameterFootprint = methodParameterFootprint(t, method);
     if (LIKELY(peekObject(t, sp - parameterFootprint))) {
@@ -1911,16 +2316,33 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
+
+  CASE(invokevirtual_quick): {
+    object method = quickReference(t, code, codeReadInt16(t, code, ip));
+    
+    unsigned parameterFootprint = methodParameterFootprint(t, method);
+    if (LIKELY(peekObject(t, sp - parameterFootprint))) {
+      object class_ = objectClass(t, peekObject(t, sp - parameterFootprint));
+      PROTECT(t, method);
+      PROTECT(t, class_);
 
-  case ior: {
+      code = findVirtualMethod(t, method, class_);
+      goto invoke;
+    } else {
+      exception = makeThrowable(t, Machine::NullPointerExceptionType);
+      goto throw_;
+    }
+  } DISPATCH;
+
+  CASE(ior): {
     int32_t b = popInt(t);
-    int32_t a = popInt(t);
+    int32_t a = topInt(t);
     
-    pushInt(t, a | b);
-  } goto loop;
+    replaceInt(t, a | b);
+  } DISPATCH;
 
-  case irem: {
+  CASE(irem): {
     int32_t b = popInt(t);
     int32_t a = popInt(t);
     
@@ -1930,114 +2352,114 @@ interpret3(Thread* t, const int base)
     }
     
     pushInt(t, a % b);
-  } goto loop;
+  } DISPATCH;
 
-  case ireturn:
-  case freturn: {
+  CASE(ireturn):
+  CASE(freturn): {
     int32_t result = popInt(t);
     if (frame > base) {
       popFrame(t);
       pushInt(t, result);
-      goto loop;
+      DISPATCH;
     } else {
       return makeInt(t, result);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ishl: {
+  CASE(ishl): {
     int32_t b = popInt(t);
-    int32_t a = popInt(t);
+    int32_t a = topInt(t);
     
-    pushInt(t, a << (b & 0x1F));
-  } goto loop;
+    replaceInt(t, a << (b & 0x1F));
+  } DISPATCH;
 
-  case ishr: {
+  CASE(ishr): {
     int32_t b = popInt(t);
-    int32_t a = popInt(t);
+    int32_t a = topInt(t);
     
-    pushInt(t, a >> (b & 0x1F));
-  } goto loop;
+    replaceInt(t, a >> (b & 0x1F));
+  } DISPATCH;
 
-  case istore:
-  case fstore: {
+  CASE(istore):
+  CASE(fstore): {
     setLocalInt(t, codeBody(t, code, ip++), popInt(t));
-  } goto loop;
+  } DISPATCH;
 
-  case istore_0:
-  case fstore_0: {
+  CASE(istore_0):
+  CASE(fstore_0): {
     setLocalInt(t, 0, popInt(t));
-  } goto loop;
+  } DISPATCH;
 
-  case istore_1:
-  case fstore_1: {
+  CASE(istore_1):
+  CASE(fstore_1): {
     setLocalInt(t, 1, popInt(t));
-  } goto loop;
+  } DISPATCH;
 
-  case istore_2:
-  case fstore_2: {
+  CASE(istore_2):
+  CASE(fstore_2): {
     setLocalInt(t, 2, popInt(t));
-  } goto loop;
+  } DISPATCH;
 
-  case istore_3:
-  case fstore_3: {
+  CASE(istore_3):
+  CASE(fstore_3): {
     setLocalInt(t, 3, popInt(t));
-  } goto loop;
+  } DISPATCH;
 
-  case isub: {
+  CASE(isub): {
     int32_t b = popInt(t);
-    int32_t a = popInt(t);
+    int32_t a = topInt(t);
     
-    pushInt(t, a - b);
-  } goto loop;
+    replaceInt(t, a - b);
+  } DISPATCH;
 
-  case iushr: {
+  CASE(iushr): {
     int32_t b = popInt(t);
-    uint32_t a = popInt(t);
+    uint32_t a = topInt(t);
     
-    pushInt(t, a >> (b & 0x1F));
-  } goto loop;
+    replaceInt(t, a >> (b & 0x1F));
+  } DISPATCH;
 
-  case ixor: {
+  CASE(ixor): {
     int32_t b = popInt(t);
-    int32_t a = popInt(t);
+    int32_t a = topInt(t);
     
-    pushInt(t, a ^ b);
-  } goto loop;
+    replaceInt(t, a ^ b);
+  } DISPATCH;
 
-  case jsr: {
+  CASE(jsr): {
     uint16_t offset = codeReadInt16(t, code, ip);
 
     pushInt(t, ip);
     ip = (ip - 3) + static_cast<int16_t>(offset);
-  } goto loop;
+  } DISPATCH;
 
-  case jsr_w: {
+  CASE(jsr_w): {
     uint32_t offset = codeReadInt32(t, code, ip);
 
     pushInt(t, ip);
     ip = (ip - 5) + static_cast<int32_t>(offset);
-  } goto loop;
+  } DISPATCH;
 
-  case l2d: {
+  CASE(l2d): {
     pushDouble(t, static_cast<double>(static_cast<int64_t>(popLong(t))));
-  } goto loop;
+  } DISPATCH;
 
-  case l2f: {
+  CASE(l2f): {
     pushFloat(t, static_cast<float>(static_cast<int64_t>(popLong(t))));
-  } goto loop;
+  } DISPATCH;
 
-  case l2i: {
+  CASE(l2i): {
     pushInt(t, static_cast<int32_t>(popLong(t)));
-  } goto loop;
+  } DISPATCH;
 
-  case ladd: {
+  CASE(ladd): {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
     pushLong(t, a + b);
-  } goto loop;
+  } DISPATCH;
 
-  case laload: {
+  CASE(laload): {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -2056,16 +2478,16 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case land: {
+  CASE(land): {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
     pushLong(t, a & b);
-  } goto loop;
+  } DISPATCH;
 
-  case lastore: {
+  CASE(lastore): {
     int64_t value = popLong(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -2085,25 +2507,25 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case lcmp: {
+  CASE(lcmp): {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
     pushInt(t, a > b ? 1 : a == b ? 0 : -1);
-  } goto loop;
+  } DISPATCH;
 
-  case lconst_0: {
+  CASE(lconst_0): {
     pushLong(t, 0);
-  } goto loop;
+  } DISPATCH;
 
-  case lconst_1: {
+  CASE(lconst_1): {
     pushLong(t, 1);
-  } goto loop;
+  } DISPATCH;
 
-  case ldc:
-  case ldc_w: {
+  CASE(ldc):
+  CASE(ldc_w): {
     uint16_t index;
 
     if (instruction == ldc) {
@@ -2129,9 +2551,9 @@ interpret3(Thread* t, const int base)
     } else {
       pushInt(t, singletonValue(t, pool, index - 1));
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ldc2_w: {
+  CASE(ldc2_w): {
     uint16_t index = codeReadInt16(t, code, ip);
 
     object pool = codePool(t, code);
@@ -2139,9 +2561,9 @@ interpret3(Thread* t, const int base)
     uint64_t v;
     memcpy(&v, &singletonValue(t, pool, index - 1), 8);
     pushLong(t, v);
-  } goto loop;
+  } DISPATCH;
 
-  case ldiv_: {
+  CASE(ldiv_): {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
@@ -2151,45 +2573,45 @@ interpret3(Thread* t, const int base)
     }
     
     pushLong(t, a / b);
-  } goto loop;
+  } DISPATCH;
 
-  case lload:
-  case dload: {
+  CASE(lload):
+  CASE(dload): {
     pushLong(t, localLong(t, codeBody(t, code, ip++)));
-  } goto loop;
+  } DISPATCH;
 
-  case lload_0:
-  case dload_0: {
+  CASE(lload_0):
+  CASE(dload_0): {
     pushLong(t, localLong(t, 0));
-  } goto loop;
+  } DISPATCH;
 
-  case lload_1:
-  case dload_1: {
+  CASE(lload_1):
+  CASE(dload_1): {
     pushLong(t, localLong(t, 1));
-  } goto loop;
+  } DISPATCH;
 
-  case lload_2:
-  case dload_2: {
+  CASE(lload_2):
+  CASE(dload_2): {
     pushLong(t, localLong(t, 2));
-  } goto loop;
+  } DISPATCH;
 
-  case lload_3:
-  case dload_3: {
+  CASE(lload_3):
+  CASE(dload_3): {
     pushLong(t, localLong(t, 3));
-  } goto loop;
+  } DISPATCH;
 
-  case lmul: {
+  CASE(lmul): {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
     pushLong(t, a * b);
-  } goto loop;
+  } DISPATCH;
 
-  case lneg: {
+  CASE(lneg): {
     pushLong(t, - popLong(t));
-  } goto loop;
+  } DISPATCH;
 
-  case lookupswitch: {
+  CASE(lookupswitch): {
     int32_t base = ip - 1;
 
     ip += 3;
@@ -2214,21 +2636,21 @@ interpret3(Thread* t, const int base)
         bottom = middle + 1;
       } else {
         ip = base + codeReadInt32(t, code, index);
-        goto loop;
+        DISPATCH;
       }
     }
 
     ip = base + default_;
-  } goto loop;
+  } DISPATCH;
 
-  case lor: {
+  CASE(lor): {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
     pushLong(t, a | b);
-  } goto loop;
+  } DISPATCH;
 
-  case lrem: {
+  CASE(lrem): {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
@@ -2238,81 +2660,81 @@ interpret3(Thread* t, const int base)
     }
     
     pushLong(t, a % b);
-  } goto loop;
+  } DISPATCH;
 
-  case lreturn:
-  case dreturn: {
+  CASE(lreturn):
+  CASE(dreturn): {
     int64_t result = popLong(t);
     if (frame > base) {
       popFrame(t);
       pushLong(t, result);
-      goto loop;
+      DISPATCH;
     } else {
       return makeLong(t, result);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case lshl: {
+  CASE(lshl): {
     int32_t b = popInt(t);
     int64_t a = popLong(t);
     
     pushLong(t, a << (b & 0x3F));
-  } goto loop;
+  } DISPATCH;
 
-  case lshr: {
+  CASE(lshr): {
     int32_t b = popInt(t);
     int64_t a = popLong(t);
     
     pushLong(t, a >> (b & 0x3F));
-  } goto loop;
+  } DISPATCH;
 
-  case lstore:
-  case dstore: {
+  CASE(lstore):
+  CASE(dstore): {
     setLocalLong(t, codeBody(t, code, ip++), popLong(t));
-  } goto loop;
+  } DISPATCH;
 
-  case lstore_0: 
-  case dstore_0:{
+  CASE(lstore_0): 
+  CASE(dstore_0):{
     setLocalLong(t, 0, popLong(t));
-  } goto loop;
+  } DISPATCH;
 
-  case lstore_1: 
-  case dstore_1: {
+  CASE(lstore_1): 
+  CASE(dstore_1): {
     setLocalLong(t, 1, popLong(t));
-  } goto loop;
+  } DISPATCH;
 
-  case lstore_2: 
-  case dstore_2: {
+  CASE(lstore_2): 
+  CASE(dstore_2): {
     setLocalLong(t, 2, popLong(t));
-  } goto loop;
+  } DISPATCH;
 
-  case lstore_3: 
-  case dstore_3: {
+  CASE(lstore_3): 
+  CASE(dstore_3): {
     setLocalLong(t, 3, popLong(t));
-  } goto loop;
+  } DISPATCH;
 
-  case lsub: {
+  CASE(lsub): {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
     pushLong(t, a - b);
-  } goto loop;
+  } DISPATCH;
 
-  case lushr: {
+  CASE(lushr): {
     int64_t b = popInt(t);
     uint64_t a = popLong(t);
     
     pushLong(t, a >> (b & 0x3F));
-  } goto loop;
+  } DISPATCH;
 
-  case lxor: {
+  CASE(lxor): {
     int64_t b = popLong(t);
     int64_t a = popLong(t);
     
     pushLong(t, a ^ b);
-  } goto loop;
+  } DISPATCH;
 
-  case monitorenter: {
+  CASE(monitorenter): {
     object o = popObject(t);
     if (LIKELY(o)) {
       acquire(t, o);
@@ -2320,9 +2742,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case monitorexit: {
+  CASE(monitorexit): {
     object o = popObject(t);
     if (LIKELY(o)) {
       release(t, o);
@@ -2330,9 +2752,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case multianewarray: {
+  CASE(multianewarray): {
     uint16_t index = codeReadInt16(t, code, ip);
     uint8_t dimensions = codeBody(t, code, ip++);
 
@@ -2357,9 +2779,9 @@ interpret3(Thread* t, const int base)
     populateMultiArray(t, array, RUNTIME_ARRAY_BODY(counts), 0, dimensions);
 
     pushObject(t, array);
-  } goto loop;
+  } DISPATCH;
 
-  case new_: {
+  CASE(new_): {
     uint16_t index = codeReadInt16(t, code, ip);
     
     object class_ = resolveClassInPool(t, frameMethod(t, frame), index - 1);
@@ -2368,9 +2790,9 @@ interpret3(Thread* t, const int base)
     initClass(t, class_);
 
     pushObject(t, make(t, class_));
-  } goto loop;
+  } DISPATCH;
 
-  case newarray: {
+  CASE(newarray): {
     int32_t count = popInt(t);
 
     if (LIKELY(count >= 0)) {
@@ -2420,19 +2842,19 @@ interpret3(Thread* t, const int base)
         (t, Machine::NegativeArraySizeExceptionType, "%d", count);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case nop: goto loop;
+  CASE(nop): DISPATCH;
 
-  case pop_: {
+  CASE(pop_): {
     -- sp;
-  } goto loop;
+  } DISPATCH;
 
-  case pop2: {
+  CASE(pop2): {
     sp -= 2;
-  } goto loop;
+  } DISPATCH;
 
-  case putfield: {
+  CASE(putfield): {
     uint16_t index = codeReadInt16(t, code, ip);
     
     object field = resolveField(t, frameMethod(t, frame), index - 1);
@@ -2440,70 +2862,29 @@ interpret3(Thread* t, const int base)
     assert(t, (fieldFlags(t, field) & ACC_STATIC) == 0);
     PROTECT(t, field);
 
-    { ACQUIRE_FIELD_FOR_WRITE(t, field);
+    if ((fieldFlags(t, field) & ACC_VOLATILE) == 0) {
+      quicken(t, code, ip - 3, putfield_quick);
+    }
 
-      switch (fieldCode(t, field)) {
-      case ByteField:
-      case BooleanField:
-      case CharField:
-      case ShortField:
-      case FloatField:
-      case IntField: {
-        int32_t value = popInt(t);
-        object o = popObject(t);
-        if (LIKELY(o)) {
-          switch (fieldCode(t, field)) {
-          case ByteField:
-          case BooleanField:
-            fieldAtOffset<int8_t>(o, fieldOffset(t, field)) = value;
-            break;
-            
-          case CharField:
-          case ShortField:
-            fieldAtOffset<int16_t>(o, fieldOffset(t, field)) = value;
-            break;
-            
-          case FloatField:
-          case IntField:
-            fieldAtOffset<int32_t>(o, fieldOffset(t, field)) = value;
-            break;
-          }
-        } else {
-          exception = makeThrowable(t, Machine::NullPointerExceptionType);
-        }
-      } break;
-
-      case DoubleField:
-      case LongField: {
-        int64_t value = popLong(t);
-        object o = popObject(t);
-        if (LIKELY(o)) {
-          fieldAtOffset<int64_t>(o, fieldOffset(t, field)) = value;
-        } else {
-          exception = makeThrowable(t, Machine::NullPointerExceptionType);
-        }
-      } break;
+    { ACQUIRE_FIELD_FOR_WRITE(t, field);
 
-      case ObjectField: {
-        object value = popObject(t);
-        object o = popObject(t);
-        if (LIKELY(o)) {
-          set(t, o, fieldOffset(t, field), value);
-        } else {
-          exception = makeThrowable(t, Machine::NullPointerExceptionType);
-        }
-      } break;
+      popField(t, field);
+    }
 
-      default: abort(t);
-      }
+    if (UNLIKELY(exception)) {
+      goto throw_;
     }
+  } DISPATCH;
+
+  CASE(putfield_quick): {
+    popField(t, quickReference(t, code, codeReadInt16(t, code, ip)));
 
     if (UNLIKELY(exception)) {
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case putstatic: {
+  CASE(putstatic): {
     uint16_t index = codeReadInt16(t, code, ip);
 
     object field = resolveField(t, frameMethod(t, frame), index - 1);
@@ -2546,7 +2927,7 @@ interpret3(Thread* t, const int base)
 
     case DoubleField:
     case LongField: {
-      fieldAtOffset<int64_t>(table, fieldOffset(t, field)) = popLong(t);
+      setWideField(t, field, table, popLong(t));
     } break;
 
     case ObjectField: {
@@ -2555,13 +2936,13 @@ interpret3(Thread* t, const int base)
 
     default: abort(t);
     }
-  } goto loop;
+  } DISPATCH;
 
-  case ret: {
+  CASE(ret): {
     ip = localInt(t, codeBody(t, code, ip));
-  } goto loop;
+  } DISPATCH;
 
-  case return_: {
+  CASE(return_): {
     object method = frameMethod(t, frame);
     if ((methodFlags(t, method) & ConstructorFlag)
         and (classVmFlags(t, methodClass(t, method)) & HasFinalMemberFlag))
@@ -2571,13 +2952,13 @@ interpret3(Thread* t, const int base)
 
     if (frame > base) {
       popFrame(t);
-      goto loop;
+      DISPATCH;
     } else {
       return 0;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case saload: {
+  CASE(saload): {
     int32_t index = popInt(t);
     object array = popObject(t);
 
@@ -2596,9 +2977,9 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case sastore: {
+  CASE(sastore): {
     int16_t value = popInt(t);
     int32_t index = popInt(t);
     object array = popObject(t);
@@ -2618,20 +2999,20 @@ interpret3(Thread* t, const int base)
       exception = makeThrowable(t, Machine::NullPointerExceptionType);
       goto throw_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case sipush: {
+  CASE(sipush): {
     pushInt(t, static_cast<int16_t>(codeReadInt16(t, code, ip)));
-  } goto loop;
+  } DISPATCH;
 
-  case swap: {
+  CASE(swap): {
     uintptr_t tmp[2];
     memcpy(tmp                   , stack + ((sp - 1) * 2), BytesPerWord * 2);
     memcpy(stack + ((sp - 1) * 2), stack + ((sp - 2) * 2), BytesPerWord * 2);
     memcpy(stack + ((sp - 2) * 2), tmp                   , BytesPerWord * 2);
-  } goto loop;
+  } DISPATCH;
 
-  case tableswitch: {
+  CASE(tableswitch): {
     int32_t base = ip - 1;
 
     ip += 3;
@@ -2649,11 +3030,11 @@ interpret3(Thread* t, const int base)
     } else {
       ip = base + default_;
     }
-  } goto loop;
+  } DISPATCH;
 
-  case wide: goto wide;
+  CASE(wide): goto wide;
 
-  case impdep1: {
+  CASE(impdep1): {
     // this means we're invoking a virtual method on an instance of a
     // bootstrap class, so we need to load the real class to get the
     // real method and call it.
@@ -2675,9 +3056,9 @@ interpret3(Thread* t, const int base)
                  className(t, class_));
 
     ip -= 3;
-  } goto loop;
+  } DISPATCH;
 
-  default: abort(t);
+  DEFAULT: abort(t);
   }
 
  wide:
@@ -2749,6 +3130,10 @@ interpret3(Thread* t, const int base)
   return 0;
 }
 
+#undef CASE
+#undef DEFAULT
+#undef DISPATCH
+
 uint64_t
 interpret2(vm::Thread* t, uintptr_t* arguments)
 {
@@ -2961,7 +3346,8 @@ invoke(Thread* t, object method)
 class MyProcessor: public Processor {
  public:
   MyProcessor(System* s, Allocator* allocator):
-    s(s), allocator(allocator)
+    s(s), allocator(allocator), hotThreshold(0), profileLog(0),
+    sequenceCounts(0)
   { }
 
   virtual vm::Thread*
@@ -3015,7 +3401,8 @@ class MyProcessor: public Processor {
     return vm::makeClass
       (t, flags, vmFlags, fixedSize, arrayElementSize, arrayDimensions, 0,
        objectMask, name, sourceFile, super, interfaceTable, virtualTable,
-       fieldTable, methodTable, addendum, staticTable, loader, 0, 0);
+       fieldTable, methodTable, addendum, staticTable, loader, 0, 0, 0, 0,
+       0);
   }
 
   virtual void
@@ -3025,7 +3412,13 @@ class MyProcessor: public Processor {
   }
 
   virtual void
-  visitObjects(vm::Thread* vmt, Heap::Visitor* v)
+  methodOverridden(vm::Thread* t, object method)
+  {
+    methodVmFlags(t, method) |= OverriddenFlag;
+  }
+
+  virtual void
+  visitObjects(vm::Thread* vmt, Heap::Visitor* v, unsigned)
   {
     Thread* t = static_cast<Thread*>(vmt);
 
@@ -3051,6 +3444,13 @@ class MyProcessor: public Processor {
     walker.walk(v);
   }
 
+  virtual void
+  requestSafepoint(vm::Thread*, vm::Thread*)
+  {
+    // nothing to do, since the interpreter polls Machine::exclusive
+    // directly at backward branches
+  }
+
   virtual int
   lineNumber(vm::Thread* t, object method, int ip)
   {
@@ -3148,6 +3548,38 @@ class MyProcessor: public Processor {
     return local::invoke(t, method);
   }
 
+  virtual uint64_t
+  invokeUnboxed(vm::Thread* t, object method, object this_,
+                const jvalue* arguments)
+  {
+    // the interpreter boxes results as it returns them, so the best we
+    // can do is unbox here
+    object r = invokeArray(t, method, this_, arguments);
+
+    switch (methodReturnCode(t, method)) {
+    case ByteField:
+    case BooleanField:
+    case CharField:
+    case ShortField:
+    case FloatField:
+    case IntField:
+      return intValue(t, r);
+
+    case LongField:
+    case DoubleField:
+      return longValue(t, r);
+
+    case ObjectField:
+      return reinterpret_cast<uintptr_t>(r);
+
+    case VoidField:
+      return 0;
+
+    default:
+      abort(t);
+    }
+  }
+
   virtual object
   invokeList(vm::Thread* vmt, object method, object this_,
              bool indirectObjects, va_list arguments)
@@ -3198,9 +3630,36 @@ class MyProcessor: public Processor {
     return local::invoke(t, method);
   }
 
-  virtual object getStackTrace(vm::Thread* t, vm::Thread*) {
-    // not implemented
-    return makeObjectArray(t, 0);
+  virtual object getStackTrace(vm::Thread* t, vm::Thread* target) {
+    class Visitor: public vm::Thread::Handshake {
+     public:
+      Visitor(vm::Thread* t): trace(0), protector(t, &trace) { }
+
+      virtual void run(vm::Thread* t, vm::Thread* target) {
+        trace = makeTrace(t, target);
+      }
+
+      object trace;
+      vm::Thread::SingleProtector protector;
+    } visitor(t);
+
+    handshake(t, target, &visitor);
+
+    return visitor.trace ? visitor.trace : makeObjectArray(t, 0);
+  }
+
+  virtual bool sampleStack(vm::Thread*, vm::Thread*, StackVisitor*) {
+    // a running interpreter updates its frames without regard for
+    // anyone reading them, so they can only be walked at a handshake
+    return false;
+  }
+
+  virtual unsigned compilationReport(vm::Thread*, char*, unsigned) {
+    return 0;
+  }
+
+  virtual unsigned codeFootprint() {
+    return 0;
   }
 
   virtual void initialize(BootImage*, uint8_t*, unsigned) {
@@ -3229,8 +3688,27 @@ class MyProcessor: public Processor {
     abort(s);
   }
 
-  virtual void boot(vm::Thread*, BootImage* image, uint8_t* code) {
+  virtual void boot(vm::Thread* t, BootImage* image, uint8_t* code) {
     expect(s, image == 0 and code == 0);
+
+    if (ProfileSequences) {
+      sequenceCounts = static_cast<uint32_t*>
+        (allocator->allocate(SequenceCountsSize));
+      memset(sequenceCounts, 0, SequenceCountsSize);
+    }
+
+    const char* path = findProperty(t, "avian.interpret.profile");
+    if (path) {
+      profileLog = vm::fopen(path, "wb");
+      if (profileLog) {
+        const char* threshold = findProperty
+          (t, "avian.interpret.hotThreshold");
+        hotThreshold = threshold ? atoi(threshold) : DefaultHotThreshold;
+        if (hotThreshold == 0) {
+          hotThreshold = 1;
+        }
+      }
+    }
   }
   
 
@@ -3261,13 +3739,88 @@ class MyProcessor: public Processor {
   }
 
   virtual void dispose() {
+    if (profileLog) {
+      fclose(profileLog);
+    }
+
+    if (sequenceCounts) {
+      reportSequences();
+      allocator->free(sequenceCounts, SequenceCountsSize);
+    }
+
     allocator->free(this, sizeof(*this));
   }
   
+  void reportSequences() {
+    fprintf(stderr, "most frequent instruction pairs:\n");
+    for (unsigned i = 0; i < ReportedSequenceCount; ++i) {
+      unsigned best = 0;
+      for (unsigned j = 1; j < 256 * 256; ++j) {
+        if (sequenceCounts[j] > sequenceCounts[best]) {
+          best = j;
+        }
+      }
+
+      if (sequenceCounts[best] == 0) {
+        break;
+      }
+
+      fprintf(stderr, "  0x%02x 0x%02x %u\n", best / 256, best % 256,
+              sequenceCounts[best]);
+
+      sequenceCounts[best] = 0;
+    }
+  }
+
+  static const unsigned SequenceCountsSize = 256 * 256 * sizeof(uint32_t);
+  
   System* s;
   Allocator* allocator;
+  unsigned hotThreshold;
+  FILE* profileLog;
+  uint32_t* sequenceCounts;
 };
 
+void
+recordSequence(Thread* t, unsigned previous, unsigned instruction)
+{
+  // unsynchronized, so counts are approximate when several threads
+  // are running
+  ++ static_cast<MyProcessor*>(t->m->processor)->sequenceCounts
+    [(previous * 256) + instruction];
+}
+
+void
+profile(Thread* t, object method, bool backEdge)
+{
+  MyProcessor* p = static_cast<MyProcessor*>(t->m->processor);
+  if (LIKELY(p->hotThreshold == 0)) {
+    return;
+  }
+
+  object data = getMethodRuntimeData(t, method);
+
+  // these counters are only used to decide which methods are worth
+  // compiling, so an occasional lost update from a race is harmless
+  if (backEdge) {
+    ++ methodRuntimeDataBackEdgeCount(t, data);
+  } else {
+    ++ methodRuntimeDataInvocationCount(t, data);
+  }
+
+  if (methodRuntimeDataInvocationCount(t, data)
+      + methodRuntimeDataBackEdgeCount(t, data) == p->hotThreshold)
+  {
+    fprintf(p->profileLog, "%s.%s%s %d %d\n",
+            &byteArrayBody(t, className(t, methodClass(t, method)), 0),
+            &byteArrayBody(t, methodName(t, method), 0),
+            &byteArrayBody(t, methodSpec(t, method), 0),
+            methodRuntimeDataInvocationCount(t, data),
+            methodRuntimeDataBackEdgeCount(t, data));
+    fflush(p->profileLog);
+  }
+}
+
 } // namespace
 
 namespace vm {
@@ -22,12 +22,37 @@ namespace {
 
 namespace local {
 
+// Returns the thread this native thread last detached, if attachments
+// are cached.  It keeps the daemon status it was first attached with.
+Thread*
+unparkThread(Machine* m)
+{
+  if (m->parkedThread) {
+    Thread* t = static_cast<Thread*>(m->parkedThread->get());
+    if (t) {
+      m->parkedThread->set(0);
+      m->localThread->set(t);
+
+      if ((t->flags & Thread::DaemonFlag) == 0) {
+        ACQUIRE_RAW(t, m->stateLock);
+
+        -- m->daemonCount;
+      }
+    }
+    return t;
+  }
+  return 0;
+}
+
 jint JNICALL
 AttachCurrentThread(Machine* m, Thread** t, void*)
 {
   *t = static_cast<Thread*>(m->localThread->get());
   if (*t == 0) {
-    *t = attachThread(m, false);
+    *t = unparkThread(m);
+    if (*t == 0) {
+      *t = attachThread(m, false);
+    }
   }
   return 0;
 }
@@ -37,7 +62,10 @@ AttachCurrentThreadAsDaemon(Machine* m, Thread** t, void*)
 {
   *t = static_cast<Thread*>(m->localThread->get());
   if (*t == 0) {
-    *t = attachThread(m, true);
+    *t = unparkThread(m);
+    if (*t == 0) {
+      *t = attachThread(m, true);
+    }
   }
   return 0;
 }
@@ -51,7 +79,20 @@ DetachCurrentThread(Machine* m)
     // problems which I haven't yet had a chance to investigate
     // thoroughly.  Meanwhile, we just ignore requests to detach it,
     // which leaks a bit of memory but should be harmless otherwise.
-    if (m->rootThread != t) {
+    if (m->rootThread != t and m->parkedThread) {
+      // keep the thread, still idle, for the next attach.  While parked
+      // it counts as a daemon so it doesn't hold up DestroyJavaVM.
+      m->localThread->set(0);
+      m->parkedThread->set(t);
+
+      if ((t->flags & Thread::DaemonFlag) == 0) {
+        ACQUIRE_RAW(t, m->stateLock);
+
+        ++ m->daemonCount;
+
+        m->stateLock->notifyAll(t->systemThread);
+      }
+    } else if (m->rootThread != t) {
       m->localThread->set(0);
 
       ACQUIRE_RAW(t, t->m->stateLock);
@@ -93,7 +134,7 @@ destroyJavaVM(Thread* t, uintptr_t*)
       t->m->stateLock->wait(t->systemThread, 0);
     }
 
-    enter(t, Thread::ExclusiveState);
+    enter(t, Thread::ExclusiveState, "shutdown");
   }
 
   shutDown(t);
@@ -260,8 +301,22 @@ newString(Thread* t, uintptr_t* arguments)
   const jchar* chars = reinterpret_cast<const jchar*>(arguments[0]);
   jsize size = arguments[1];
 
-  object a = makeCharArray(t, size);
-  if (size) {
+  bool ascii = true;
+  for (jsize i = 0; i < size; ++i) {
+    if (chars[i] >= 0x80) {
+      ascii = false;
+      break;
+    }
+  }
+
+  object a;
+  if (ascii) {
+    a = makeByteArray(t, size);
+    for (jsize i = 0; i < size; ++i) {
+      byteArrayBody(t, a, i) = chars[i];
+    }
+  } else {
+    a = makeCharArray(t, size);
     memcpy(&charArrayBody(t, a, 0), chars, size * sizeof(jchar));
   }
 
@@ -714,7 +769,8 @@ callObjectMethodA(Thread* t, uintptr_t* arguments)
 
   return reinterpret_cast<uint64_t>
     (makeLocalReference
-     (t, t->m->processor->invokeArray(t, getMethod(t, m), *o, a)));
+     (t, reinterpret_cast<object>
+      (t->m->processor->invokeUnboxed(t, getMethod(t, m), *o, a))));
 }
 
 jobject JNICALL
@@ -768,8 +824,8 @@ callIntMethodA(Thread* t, uintptr_t* arguments)
   jmethodID m = arguments[1];
   const jvalue* a = reinterpret_cast<const jvalue*>(arguments[2]);
 
-  return intValue
-     (t, t->m->processor->invokeArray(t, getMethod(t, m), *o, a));
+  return static_cast<int32_t>
+    (t->m->processor->invokeUnboxed(t, getMethod(t, m), *o, a));
 }
 
 jboolean JNICALL
@@ -955,8 +1011,7 @@ callLongMethodA(Thread* t, uintptr_t* arguments)
   jmethodID m = arguments[1];
   const jvalue* a = reinterpret_cast<const jvalue*>(arguments[2]);
 
-  return longValue
-     (t, t->m->processor->invokeArray(t, getMethod(t, m), *o, a));
+  return t->m->processor->invokeUnboxed(t, getMethod(t, m), *o, a);
 }
 
 jlong JNICALL
@@ -1075,7 +1130,7 @@ callVoidMethodA(Thread* t, uintptr_t* arguments)
   jmethodID m = arguments[1];
   const jvalue* a = reinterpret_cast<const jvalue*>(arguments[2]);
 
-  t->m->processor->invokeArray(t, getMethod(t, m), *o, a);
+  t->m->processor->invokeUnboxed(t, getMethod(t, m), *o, a);
 
   return 0;
 }
@@ -1142,7 +1197,8 @@ callStaticObjectMethodA(Thread* t, uintptr_t* arguments)
 
   return reinterpret_cast<uint64_t>
     (makeLocalReference
-     (t, t->m->processor->invokeArray(t, getStaticMethod(t, m), 0, a)));
+     (t, reinterpret_cast<object>
+      (t->m->processor->invokeUnboxed(t, getStaticMethod(t, m), 0, a))));
 }
 
 jobject JNICALL
@@ -1190,8 +1246,8 @@ callStaticIntMethodA(Thread* t, uintptr_t* arguments)
   jmethodID m = arguments[0];
   const jvalue* a = reinterpret_cast<const jvalue*>(arguments[1]);
 
-  return intValue
-     (t, t->m->processor->invokeArray(t, getStaticMethod(t, m), 0, a));
+  return static_cast<int32_t>
+    (t->m->processor->invokeUnboxed(t, getStaticMethod(t, m), 0, a));
 }
 
 jboolean JNICALL
@@ -1355,8 +1411,7 @@ callStaticLongMethodA(Thread* t, uintptr_t* arguments)
   jmethodID m = arguments[0];
   const jvalue* a = reinterpret_cast<const jvalue*>(arguments[1]);
 
-  return longValue
-     (t, t->m->processor->invokeArray(t, getStaticMethod(t, m), 0, a));
+  return t->m->processor->invokeUnboxed(t, getStaticMethod(t, m), 0, a);
 }
 
 jlong JNICALL
@@ -1461,7 +1516,7 @@ callStaticVoidMethodA(Thread* t, uintptr_t* arguments)
   jmethodID m = arguments[0];
   const jvalue* a = reinterpret_cast<const jvalue*>(arguments[1]);
 
-  t->m->processor->invokeArray(t, getStaticMethod(t, m), 0, a);
+  t->m->processor->invokeUnboxed(t, getStaticMethod(t, m), 0, a);
 
   return 0;
 }
@@ -1677,7 +1732,7 @@ getLongField(Thread* t, uintptr_t* arguments)
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_READ(t, field);
 
-  return fieldAtOffset<jlong>(*o, fieldOffset(t, field));
+  return getWideField(t, field, *o);
 }
 
 jlong JNICALL
@@ -1719,7 +1774,7 @@ getDoubleField(Thread* t, uintptr_t* arguments)
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_READ(t, field);
 
-  return doubleToBits(fieldAtOffset<jdouble>(*o, fieldOffset(t, field)));
+  return getWideField(t, field, *o);
 }
 
 jdouble JNICALL
@@ -1891,7 +1946,7 @@ setLongField(Thread* t, uintptr_t* arguments)
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_WRITE(t, field);
   
-  fieldAtOffset<jlong>(*o, fieldOffset(t, field)) = v;
+  setWideField(t, field, *o, v);
   
   return 1;
 }
@@ -1942,7 +1997,7 @@ setDoubleField(Thread* t, uintptr_t* arguments)
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_WRITE(t, field);
   
-  fieldAtOffset<jdouble>(*o, fieldOffset(t, field)) = v;
+  setWideField(t, field, *o, doubleToBits(v));
   
   return 1;
 }
@@ -2134,8 +2189,7 @@ getStaticLongField(Thread* t, uintptr_t* arguments)
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_READ(t, field);
 
-  return fieldAtOffset<jlong>
-    (classStaticTable(t, jclassVmClass(t, *c)), fieldOffset(t, field));
+  return getWideField(t, field, classStaticTable(t, jclassVmClass(t, *c)));
 }
 
 jlong JNICALL
@@ -2185,9 +2239,7 @@ getStaticDoubleField(Thread* t, uintptr_t* arguments)
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_READ(t, field);
 
-  return doubleToBits
-    (fieldAtOffset<jdouble>
-     (classStaticTable(t, jclassVmClass(t, *c)), fieldOffset(t, field)));
+  return getWideField(t, field, classStaticTable(t, jclassVmClass(t, *c)));
 }
 
 jdouble JNICALL
@@ -2386,8 +2438,7 @@ setStaticLongField(Thread* t, uintptr_t* arguments)
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_WRITE(t, field);
   
-  fieldAtOffset<jlong>
-    (classStaticTable(t, jclassVmClass(t, *c)), fieldOffset(t, field)) = v;
+  setWideField(t, field, classStaticTable(t, jclassVmClass(t, *c)), v);
   
   return 1;
 }
@@ -2445,8 +2496,8 @@ setStaticDoubleField(Thread* t, uintptr_t* arguments)
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_WRITE(t, field);
   
-  fieldAtOffset<jdouble>
-    (classStaticTable(t, jclassVmClass(t, *c)), fieldOffset(t, field)) = v;
+  setWideField
+    (t, field, classStaticTable(t, jclassVmClass(t, *c)), doubleToBits(v));
   
   return 1;
 }
@@ -2478,7 +2529,8 @@ newGlobalRef(Thread* t, jobject o, bool weak)
       }
     }
 
-    Reference* r = new (t->m->heap->allocate(sizeof(Reference)))
+    Reference* r = new
+      (categoryAllocator(t->m, ReferenceMemory)->allocate(sizeof(Reference)))
       Reference(*o, &(t->m->jniReferences), weak);
 
     acquire(t, r);
@@ -3164,22 +3216,39 @@ GetPrimitiveArrayCritical(Thread* t, jarray array, jboolean* isCopy)
     enter(t, Thread::ActiveState);
   }
 
-  ++ t->criticalLevel;
-  
   if (isCopy) {
     *isCopy = true;
   }
 
   expect(t, *array);
 
-  return reinterpret_cast<uintptr_t*>(*array) + 2;
+  void* body = reinterpret_cast<uintptr_t*>(*array) + 2;
+
+  // fixed objects never move, and this one stays reachable through
+  // the reference we were passed, so there's no need to hold off
+  // collections until it is released.  Arrays too large for a thread
+  // heap are always fixed, so this covers the long-running cases.
+  if (objectFixed(t, *array)) {
+    if (t->criticalLevel == 0) {
+      enter(t, Thread::IdleState);
+    }
+  } else {
+    ++ t->criticalLevel;
+  }
+
+  return body;
 }
 
 void JNICALL
-ReleasePrimitiveArrayCritical(Thread* t, jarray, void*, jint)
-{
-  if ((-- t->criticalLevel) == 0) {
-    enter(t, Thread::IdleState);
+ReleasePrimitiveArrayCritical(Thread* t, jarray array, void*, jint)
+{
+  // a critical level of zero means no movable array is held, so this
+  // one must be fixed.  Otherwise we are in the active state and may
+  // look at the array.
+  if (t->criticalLevel and (not objectFixed(t, *array))) {
+    if ((-- t->criticalLevel) == 0) {
+      enter(t, Thread::IdleState);
+    }
   }
 }
 
@@ -3509,6 +3578,28 @@ parseSize(const char* s)
   }
 }
 
+// parses the number of threads for minor collections, warning about
+// and ignoring anything but a positive number, and limiting that to
+// MaxGcThreads
+unsigned
+parseGcThreads(const char* s, unsigned defaultValue)
+{
+  const long MaxGcThreads = 64;
+
+  char* end;
+  long n = strtol(s, &end, 10);
+  if (end == s or *end or n < 1) {
+    fprintf(stderr, "ignoring malformed -X" GC_THREADS_OPTION ":%s\n", s);
+    return defaultValue;
+  } else if (n > MaxGcThreads) {
+    fprintf(stderr, "limiting -X" GC_THREADS_OPTION ":%s to %ld\n", s,
+            MaxGcThreads);
+    return MaxGcThreads;
+  } else {
+    return n;
+  }
+}
+
 void
 append(char** p, const char* value, unsigned length, char tail)
 {
@@ -3560,11 +3651,120 @@ boot(Thread* t, uintptr_t*)
     t->m->processor->invoke(t, method, 0, host, atoi(port));
   }
 
+  const char* profile = findProperty(t, "avian.profile");
+  if (profile and not startCpuProfiler(t, profile)) {
+    fprintf(stderr, "ignoring malformed avian.profile: %s\n", profile);
+  }
+
   enter(t, Thread::IdleState);
 
   return 1;
 }
 
+// a list of primitive fields and where each goes in a native struct;
+// the entries follow the header in memory
+class FieldLayout {
+ public:
+  class Entry {
+   public:
+    jfieldID field;
+    unsigned offset;
+    unsigned structOffset;
+    unsigned size;
+    bool volatile_;
+  };
+
+  Entry* entries() {
+    return reinterpret_cast<Entry*>(this + 1);
+  }
+
+  unsigned count;
+  unsigned footprint;
+};
+
+uint64_t
+makeFieldLayout(Thread* t, uintptr_t* arguments)
+{
+  const jfieldID* fields = reinterpret_cast<const jfieldID*>(arguments[0]);
+  jint count = arguments[1];
+
+  if (count < 0 or (count and fields == 0)) {
+    throwNew(t, Machine::IllegalArgumentExceptionType, "%d", count);
+  }
+
+  for (jint i = 0; i < count; ++i) {
+    if (fields[i] == 0 or fieldCode(t, getField(t, fields[i])) == ObjectField)
+    {
+      throwNew(t, Machine::IllegalArgumentExceptionType, "field %d", i);
+    }
+  }
+
+  FieldLayout* layout = static_cast<FieldLayout*>
+    (t->m->heap->allocate
+     (sizeof(FieldLayout) + (count * sizeof(FieldLayout::Entry))));
+
+  layout->count = count;
+
+  // each field is placed at its natural alignment, in order, as a C
+  // compiler would lay out a struct with the same members
+  unsigned structOffset = 0;
+  for (jint i = 0; i < count; ++i) {
+    object field = getField(t, fields[i]);
+
+    FieldLayout::Entry* e = layout->entries() + i;
+    e->field = fields[i];
+    e->offset = fieldOffset(t, field);
+    e->size = fieldSize(t, field);
+    e->structOffset = pad(structOffset, e->size);
+    e->volatile_ = (fieldFlags(t, field) & ACC_VOLATILE) != 0;
+
+    structOffset = e->structOffset + e->size;
+  }
+
+  layout->footprint = structOffset;
+
+  return reinterpret_cast<uintptr_t>(layout);
+}
+
+void
+copyFields(Thread* t, object o, FieldLayout* layout, uint8_t* dst,
+           const uint8_t* src)
+{
+  for (unsigned i = 0; i < layout->count; ++i) {
+    FieldLayout::Entry* e = layout->entries() + i;
+    uint8_t* p = &fieldAtOffset<uint8_t>(o, e->offset);
+
+    if (UNLIKELY(e->volatile_)) {
+      object field = getField(t, e->field);
+      if (volatileWideField(t, field)) {
+        if (dst) {
+          acquireFieldForRead(t, field);
+          uint64_t v = getWideField(t, field, o);
+          memcpy(dst + e->structOffset, &v, 8);
+          releaseFieldForRead(t, field);
+        } else {
+          acquireFieldForWrite(t, field);
+          uint64_t v; memcpy(&v, src + e->structOffset, 8);
+          setWideField(t, field, o, v);
+          releaseFieldForWrite(t, field);
+        }
+      } else if (dst) {
+        acquireFieldForRead(t, field);
+        memcpy(dst + e->structOffset, p, e->size);
+        releaseFieldForRead(t, field);
+      } else {
+        acquireFieldForWrite(t, field);
+        memcpy(p, src + e->structOffset, e->size);
+        releaseFieldForWrite(t, field);
+      }
+    } else if (dst) {
+      memcpy(dst + e->structOffset, p, e->size);
+    } else {
+      memcpy(p, src + e->structOffset, e->size);
+    }
+  }
+}
+
 } // namespace local
 
 } // namespace
@@ -3805,6 +4005,10 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
 
   unsigned heapLimit = 0;
   unsigned stackLimit = 0;
+  unsigned gcThreads = 1;
+  unsigned gcTargetFootprint = 0;
+  bool largePages = false;
+  bool memoryTracking = false;
   const char* bootLibraries = 0;
   const char* classpath = 0;
   const char* javaHome = AVIAN_JAVA_HOME;
@@ -3813,6 +4017,10 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
   const char* bootClasspath = 0;
   const char* bootClasspathAppend = "";
   const char* crashDumpDirectory = 0;
+  unsigned finderCacheBudget = 0;
+  bool finderCacheStatistics = false;
+  const char* finderPrefetchList = 0;
+  unsigned finderPrefetchThreads = 2;
 
   unsigned propertyCount = 0;
 
@@ -3823,6 +4031,11 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
         heapLimit = local::parseSize(p + 2);
       } else if (strncmp(p, "ss", 2) == 0) {
         stackLimit = local::parseSize(p + 2);
+      } else if (strncmp(p, GC_THREADS_OPTION ":",
+                         sizeof(GC_THREADS_OPTION)) == 0)
+      {
+        gcThreads = local::parseGcThreads
+          (p + sizeof(GC_THREADS_OPTION), gcThreads);
       } else if (strncmp(p, BOOTCLASSPATH_PREPEND_OPTION ":",
                          sizeof(BOOTCLASSPATH_PREPEND_OPTION)) == 0)
       {
@@ -3866,6 +4079,39 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
                          sizeof(EMBED_PREFIX_PROPERTY)) == 0)
       {
         embedPrefix = p + sizeof(EMBED_PREFIX_PROPERTY);
+      } else if (strncmp(p, FINDER_CACHE_PROPERTY "=",
+                         sizeof(FINDER_CACHE_PROPERTY)) == 0)
+      {
+        finderCacheBudget = local::parseSize
+          (p + sizeof(FINDER_CACHE_PROPERTY));
+      } else if (strncmp(p, FINDER_CACHE_STATISTICS_PROPERTY "=",
+                         sizeof(FINDER_CACHE_STATISTICS_PROPERTY)) == 0)
+      {
+        finderCacheStatistics = strcmp
+          (p + sizeof(FINDER_CACHE_STATISTICS_PROPERTY), "true") == 0;
+      } else if (strncmp(p, FINDER_PREFETCH_PROPERTY "=",
+                         sizeof(FINDER_PREFETCH_PROPERTY)) == 0)
+      {
+        finderPrefetchList = p + sizeof(FINDER_PREFETCH_PROPERTY);
+      } else if (strncmp(p, FINDER_PREFETCH_THREADS_PROPERTY "=",
+                         sizeof(FINDER_PREFETCH_THREADS_PROPERTY)) == 0)
+      {
+        finderPrefetchThreads = atoi
+          (p + sizeof(FINDER_PREFETCH_THREADS_PROPERTY));
+      } else if (strncmp(p, GC_TARGET_FOOTPRINT_PROPERTY "=",
+                         sizeof(GC_TARGET_FOOTPRINT_PROPERTY)) == 0)
+      {
+        gcTargetFootprint = local::parseSize
+          (p + sizeof(GC_TARGET_FOOTPRINT_PROPERTY));
+      } else if (strncmp(p, LARGE_PAGES_PROPERTY "=",
+                         sizeof(LARGE_PAGES_PROPERTY)) == 0)
+      {
+        largePages = strcmp(p + sizeof(LARGE_PAGES_PROPERTY), "true") == 0;
+      } else if (strncmp(p, MEMORY_TRACKING_PROPERTY "=",
+                         sizeof(MEMORY_TRACKING_PROPERTY)) == 0)
+      {
+        memoryTracking = strcmp
+          (p + sizeof(MEMORY_TRACKING_PROPERTY), "true") == 0;
       }
 
       ++ propertyCount;
@@ -3879,9 +4125,15 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
   if (classpath == 0) classpath = ".";
   
   System* s = makeSystem(crashDumpDirectory);
-  Heap* h = makeHeap(s, heapLimit);
+  Heap* h = makeHeap(s, heapLimit, gcThreads, gcTargetFootprint, largePages);
   Classpath* c = makeClasspath(s, h, javaHome, embedPrefix);
 
+  // the finders are made before the machine, so the tracker is too
+  MemoryTracker* tracker = memoryTracking
+    ? new (h->allocate(sizeof(MemoryTracker))) MemoryTracker(h) : 0;
+  Allocator* finderAllocator = tracker
+    ? &(tracker->allocators[ClassPathMemory]) : static_cast<Allocator*>(h);
+
   if (bootClasspath == 0) {
     bootClasspath = c->bootClasspath();
   }
@@ -3908,11 +4160,28 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
   if(bootLibraryEnd)
     *bootLibraryEnd = 0;
 
+  // there's no thread to record events yet, so we time the steps
+  // before it exists and record them afterward
+  int64_t finderStart = s->nanoTime();
+
   Finder* bf = makeFinder
-    (s, h, RUNTIME_ARRAY_BODY(bootClasspathBuffer), bootLibrary);
-  Finder* af = makeFinder(s, h, classpath, bootLibrary);
+    (s, finderAllocator, RUNTIME_ARRAY_BODY(bootClasspathBuffer),
+     bootLibrary, finderCacheBudget, finderCacheStatistics);
+  Finder* af = makeFinder
+    (s, finderAllocator, classpath, bootLibrary, finderCacheBudget,
+     finderCacheStatistics);
+
+  if (finderPrefetchList) {
+    // the list may name both system and application classes; each
+    // finder skips the names it doesn't contain
+    bf->prefetch(finderPrefetchList, finderPrefetchThreads);
+    af->prefetch(finderPrefetchList, finderPrefetchThreads);
+  }
   if(bootLibrary)
     free(bootLibrary);
+
+  int64_t finderEnd = s->nanoTime();
+
   Processor* p = makeProcessor(s, h, true);
 
   const char** properties = static_cast<const char**>
@@ -3932,14 +4201,83 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
     *(argumentPointer++) = a->options[i].optionString;
   }
 
+  int64_t machineStart = s->nanoTime();
+
   *m = new (h->allocate(sizeof(Machine))) Machine
     (s, h, bf, af, p, c, properties, propertyCount, arguments, a->nOptions,
      stackLimit);
 
+  (*m)->memoryTracker = tracker;
+
+  int64_t machineEnd = s->nanoTime();
+
   *t = p->makeThread(*m, 0, 0);
 
+  if ((*t)->events) {
+    recordInterval(*t, StartupEvent, finderStart, finderEnd, 0, 0,
+                   "make finders");
+    recordInterval(*t, StartupEvent, machineStart, machineEnd, 0, 0,
+                   "make machine");
+    recordEvent(*t, StartupEvent, machineEnd, 0, 0, "make thread");
+  }
+
   enter(*t, Thread::ActiveState);
   enter(*t, Thread::IdleState);
 
-  return run(*t, local::boot, 0) ? 0 : -1;
+  int64_t start = eventStart(*t);
+
+  bool success = run(*t, local::boot, 0);
+
+  if (start) {
+    recordEvent(*t, StartupEvent, start, 0, 0, "boot class library");
+  }
+
+  return success ? 0 : -1;
+}
+
+// Avian extensions for copying many primitive fields between an object
+// and a native struct in a single call; see include/avian/jni-fields.h
+
+extern "C" JNIEXPORT void* JNICALL
+AvianMakeFieldLayout(Thread* t, const jfieldID* fields, jint count)
+{
+  uintptr_t arguments[] = { reinterpret_cast<uintptr_t>(fields),
+                            static_cast<uintptr_t>(count) };
+
+  return reinterpret_cast<void*>(run(t, local::makeFieldLayout, arguments));
+}
+
+extern "C" JNIEXPORT jint JNICALL
+AvianFieldLayoutSize(Thread*, void* layout)
+{
+  return static_cast<local::FieldLayout*>(layout)->footprint;
+}
+
+extern "C" JNIEXPORT void JNICALL
+AvianDisposeFieldLayout(Thread* t, void* layout)
+{
+  local::FieldLayout* l = static_cast<local::FieldLayout*>(layout);
+  t->m->heap->free
+    (l, sizeof(local::FieldLayout)
+     + (l->count * sizeof(local::FieldLayout::Entry)));
+}
+
+extern "C" JNIEXPORT void JNICALL
+AvianGetFields(Thread* t, jobject o, void* layout, void* dst)
+{
+  ENTER(t, Thread::ActiveState);
+
+  local::copyFields
+    (t, *o, static_cast<local::FieldLayout*>(layout),
+     static_cast<uint8_t*>(dst), 0);
+}
+
+extern "C" JNIEXPORT void JNICALL
+AvianSetFields(Thread* t, jobject o, void* layout, const void* src)
+{
+  ENTER(t, Thread::ActiveState);
+
+  local::copyFields
+    (t, *o, static_cast<local::FieldLayout*>(layout), 0,
+     static_cast<const uint8_t*>(src));
 }
@@ -24,33 +24,351 @@ read4(const uint8_t* in)
     |    (static_cast<int32_t>(in[0])      );
 }
 
+void
+decodeStream(System* s, ISzAlloc* allocator, uint8_t* out, unsigned outSize,
+             uint8_t* in, unsigned inSize)
+{
+  expect(s, inSize >= LzmaHeaderSize);
+
+  SizeT outSizeT = outSize;
+  SizeT inSizeT = inSize - LzmaHeaderSize;
+
+  ELzmaStatus status;
+  int result = LzmaDecode
+    (out, &outSizeT, in + LzmaHeaderSize, &inSizeT, in, LzmaPropHeaderSize,
+     LZMA_FINISH_END, &status, allocator);
+
+  expect(s, result == SZ_OK);
+  expect(s, status == LZMA_STATUS_FINISHED_WITH_MARK);
+  expect(s, outSizeT == outSize);
+}
+
+// Decodes the chunks of a chunked stream, claiming them one at a time
+// so that any number of threads may share the work.
+class ChunkDecoder {
+ public:
+  ChunkDecoder(System* s, Allocator* a, uint8_t* out, uint8_t* in,
+               unsigned* offsets, unsigned outSize, unsigned chunkSize,
+               unsigned chunkCount):
+    s(s), inner(a), out(out), in(in), offsets(offsets), outSize(outSize),
+    chunkSize(chunkSize), chunkCount(chunkCount), next(0)
+  {
+    allocator.Alloc = allocate;
+    allocator.Free = free;
+    expect(s, s->success(s->make(&lock)));
+  }
+
+  void run() {
+    while (true) {
+      unsigned i;
+      { lock->acquire();
+        i = next++;
+        lock->release();
+      }
+
+      if (i >= chunkCount) {
+        break;
+      }
+
+      unsigned start = i * chunkSize;
+      decodeStream
+        (s, &allocator, out + start,
+         start + chunkSize > outSize ? outSize - start : chunkSize,
+         in + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+  }
+
+  void dispose() {
+    lock->dispose();
+  }
+
+  // the allocator may not be safe to use from more than one thread
+  // at a time
+  static void* allocate(void* allocator, size_t size) {
+    ChunkDecoder* d = static_cast<ChunkDecoder*>(allocator);
+    d->lock->acquire();
+    void* p = LzmaAllocator::allocate(&(d->inner), size);
+    d->lock->release();
+    return p;
+  }
+
+  static void free(void* allocator, void* address) {
+    ChunkDecoder* d = static_cast<ChunkDecoder*>(allocator);
+    d->lock->acquire();
+    LzmaAllocator::free(&(d->inner), address);
+    d->lock->release();
+  }
+
+  ISzAlloc allocator;
+  System* s;
+  LzmaAllocator inner;
+  uint8_t* out;
+  uint8_t* in;
+  unsigned* offsets;
+  unsigned outSize;
+  unsigned chunkSize;
+  unsigned chunkCount;
+  unsigned next;
+  System::Mutex* lock;
+};
+
+class Worker: public System::Runnable {
+ public:
+  Worker(ChunkDecoder* decoder): decoder(decoder), thread(0) { }
+
+  virtual void attach(System::Thread* t) {
+    thread = t;
+  }
+
+  virtual void run() {
+    decoder->run();
+  }
+
+  virtual bool interrupted() {
+    return false;
+  }
+
+  virtual void setInterrupted(bool) { }
+
+  ChunkDecoder* decoder;
+  System::Thread* thread;
+};
+
+// Reads the chunk table of a chunked stream, returning the offset of
+// each chunk followed by the end of the last one.
+unsigned*
+chunkOffsets(System* s, Allocator* a, uint8_t* in, unsigned inSize,
+             unsigned* outSize, unsigned* chunkSize, unsigned* chunkCount)
+{
+  expect(s, inSize >= LzmaChunkedHeaderSize);
+
+  int32_t outSize32 = read4(in + 4);
+  int32_t chunkSize32 = read4(in + 8);
+  int32_t chunkCount32 = read4(in + 12);
+  expect(s, outSize32 >= 0 and chunkSize32 > 0 and chunkCount32 > 0);
+  expect(s, inSize >= LzmaChunkedHeaderSize + (chunkCount32 * 4));
+
+  unsigned* offsets = static_cast<unsigned*>
+    (a->allocate((chunkCount32 + 1) * sizeof(unsigned)));
+
+  offsets[0] = LzmaChunkedHeaderSize + (chunkCount32 * 4);
+  for (int32_t i = 0; i < chunkCount32; ++i) {
+    offsets[i + 1] = offsets[i]
+      + read4(in + LzmaChunkedHeaderSize + (i * 4));
+    expect(s, offsets[i + 1] <= inSize);
+  }
+
+  *outSize = outSize32;
+  *chunkSize = chunkSize32;
+  *chunkCount = chunkCount32;
+
+  return offsets;
+}
+
+uint8_t*
+decodeChunks(System* s, Allocator* a, uint8_t* in, unsigned inSize,
+             unsigned* outSize)
+{
+  unsigned outSize32;
+  unsigned chunkSize;
+  unsigned chunkCount;
+  unsigned* offsets = chunkOffsets
+    (s, a, in, inSize, &outSize32, &chunkSize, &chunkCount);
+  unsigned offsetsSize = (chunkCount + 1) * sizeof(unsigned);
+
+  uint8_t* out = static_cast<uint8_t*>(a->allocate(outSize32));
+
+  ChunkDecoder decoder
+    (s, a, out, in, offsets, outSize32, chunkSize, chunkCount);
+
+  // the calling thread decodes as well, so up to one fewer helper
+  // than there are processors is started
+  unsigned workerCount = s->processorCount();
+  if (workerCount > chunkCount) {
+    workerCount = chunkCount;
+  }
+  workerCount = workerCount ? workerCount - 1 : 0;
+
+  Worker* workers = static_cast<Worker*>
+    (a->allocate(sizeof(Worker) * (workerCount + 1)));
+
+  unsigned started = 0;
+  for (; started < workerCount; ++started) {
+    Worker* w = new (workers + started) Worker(&decoder);
+    if (not s->success(s->start(w))) {
+      break;
+    }
+  }
+
+  decoder.run();
+
+  for (unsigned i = 0; i < started; ++i) {
+    workers[i].thread->join();
+    workers[i].thread->dispose();
+  }
+
+  a->free(workers, sizeof(Worker) * (workerCount + 1));
+  a->free(offsets, offsetsSize);
+  decoder.dispose();
+
+  *outSize = outSize32;
+
+  return out;
+}
+
+// A chunk cache entry, which holds no chunk while index is negative.
+class ChunkSlot {
+ public:
+  int index;
+  unsigned lastUse;
+  uint8_t* data;
+};
+
+class MyLzmaChunks: public LzmaChunks {
+ public:
+  MyLzmaChunks(System* s, Allocator* a, uint8_t* in, unsigned* offsets,
+               unsigned outSize, unsigned chunkSize, unsigned chunkCount,
+               unsigned cacheCount, ChunkSlot* slots):
+    s(s), a(a), allocator(a), in(in), offsets(offsets), outSize(outSize),
+    chunkSize(chunkSize), chunkCount(chunkCount), cacheCount(cacheCount),
+    clock(0), slots(slots)
+  {
+    for (unsigned i = 0; i < cacheCount; ++i) {
+      slots[i].index = -1;
+      slots[i].lastUse = 0;
+      slots[i].data = 0;
+    }
+    expect(s, s->success(s->make(&lock)));
+  }
+
+  virtual unsigned length() {
+    return outSize;
+  }
+
+  virtual void read(unsigned offset, unsigned length, uint8_t* out) {
+    expect(s, offset <= outSize and length <= outSize - offset);
+
+    lock->acquire();
+
+    while (length) {
+      unsigned i = offset / chunkSize;
+      unsigned start = offset - (i * chunkSize);
+      unsigned n = chunkSize - start;
+      if (n > length) {
+        n = length;
+      }
+
+      memcpy(out, chunk(i) + start, n);
+
+      out += n;
+      offset += n;
+      length -= n;
+    }
+
+    lock->release();
+  }
+
+  // the decoded chunk numbered i, which replaces the least recently
+  // used one in the cache if it is not already there
+  uint8_t* chunk(unsigned i) {
+    ChunkSlot* victim = slots;
+    for (unsigned j = 0; j < cacheCount; ++j) {
+      ChunkSlot* slot = slots + j;
+      if (slot->index == static_cast<int>(i)) {
+        slot->lastUse = ++clock;
+        return slot->data;
+      } else if (slot->lastUse < victim->lastUse) {
+        victim = slot;
+      }
+    }
+
+    if (victim->data == 0) {
+      victim->data = static_cast<uint8_t*>(a->allocate(chunkSize));
+    }
+
+    unsigned start = i * chunkSize;
+    decodeStream
+      (s, &(allocator.allocator), victim->data,
+       start + chunkSize > outSize ? outSize - start : chunkSize,
+       in + offsets[i], offsets[i + 1] - offsets[i]);
+
+    victim->index = i;
+    victim->lastUse = ++clock;
+    return victim->data;
+  }
+
+  virtual void dispose() {
+    for (unsigned i = 0; i < cacheCount; ++i) {
+      if (slots[i].data) {
+        a->free(slots[i].data, chunkSize);
+      }
+    }
+    lock->dispose();
+    a->free(offsets, (chunkCount + 1) * sizeof(unsigned));
+    a->free(this, sizeof(*this) + (cacheCount * sizeof(ChunkSlot)));
+  }
+
+  System* s;
+  Allocator* a;
+  LzmaAllocator allocator;
+  uint8_t* in;
+  unsigned* offsets;
+  unsigned outSize;
+  unsigned chunkSize;
+  unsigned chunkCount;
+  unsigned cacheCount;
+  unsigned clock;
+  ChunkSlot* slots;
+  System::Mutex* lock;
+};
+
 } // namespace
 
 namespace vm {
 
+LzmaChunks*
+openLZMAChunks(System* s, Allocator* a, uint8_t* in, unsigned inSize,
+               unsigned cacheCount)
+{
+  if (inSize == 0 or in[0] != LzmaChunkedMarker) {
+    return 0;
+  }
+
+  unsigned outSize;
+  unsigned chunkSize;
+  unsigned chunkCount;
+  unsigned* offsets = chunkOffsets
+    (s, a, in, inSize, &outSize, &chunkSize, &chunkCount);
+
+  if (cacheCount == 0) {
+    cacheCount = 1;
+  }
+
+  uint8_t* p = static_cast<uint8_t*>
+    (a->allocate(sizeof(MyLzmaChunks) + (cacheCount * sizeof(ChunkSlot))));
+
+  return new (p) MyLzmaChunks
+    (s, a, in, offsets, outSize, chunkSize, chunkCount, cacheCount,
+     reinterpret_cast<ChunkSlot*>(p + sizeof(MyLzmaChunks)));
+}
+
 uint8_t*
 decodeLZMA(System* s, Allocator* a, uint8_t* in, unsigned inSize,
            unsigned* outSize)
 {
-  const unsigned PropHeaderSize = 5;
-  const unsigned HeaderSize = 13;
+  if (inSize and in[0] == LzmaChunkedMarker) {
+    return decodeChunks(s, a, in, inSize, outSize);
+  }
+
+  expect(s, inSize >= LzmaHeaderSize);
 
-  int32_t outSize32 = read4(in + PropHeaderSize);
+  int32_t outSize32 = read4(in + LzmaPropHeaderSize);
   expect(s, outSize32 >= 0);
-  SizeT outSizeT = outSize32;
 
   uint8_t* out = static_cast<uint8_t*>(a->allocate(outSize32));
 
-  SizeT inSizeT = inSize;
   LzmaAllocator allocator(a);
-
-  ELzmaStatus status;
-  int result = LzmaDecode
-    (out, &outSizeT, in + HeaderSize, &inSizeT, in, PropHeaderSize,
-     LZMA_FINISH_END, &status, &(allocator.allocator));
-
-  expect(s, result == SZ_OK);
-  expect(s, status == LZMA_STATUS_FINISHED_WITH_MARK);
+  decodeStream(s, &(allocator.allocator), out, outSize32, in, inSize);
 
   *outSize = outSize32;
 
@@ -58,4 +376,3 @@ decodeLZMA(System* s, Allocator* a, uint8_t* in, unsigned inSize,
 }
 
 } // namespace vm
-
@@ -10,8 +10,10 @@
 
 #include "avian/lzma-util.h"
 #include "C/LzmaEnc.h"
+#include <avian/util/math.h>
 
 using namespace vm;
+using namespace avian::util;
 
 namespace {
 
@@ -21,6 +23,41 @@ myProgress(void*, UInt64, UInt64)
   return SZ_OK;
 }
 
+void
+write4(uint8_t* out, int32_t v)
+{
+  memcpy(out, &v, 4);
+}
+
+// Compresses in as a single LZMA stream into out, which must have
+// room for (inSize * 2) + LzmaHeaderSize bytes, returning the number
+// of bytes written.
+unsigned
+encodeStream(System* s, LzmaAllocator* allocator, uint8_t* out, uint8_t* in,
+             unsigned inSize)
+{
+  CLzmaEncProps props;
+  LzmaEncProps_Init(&props);
+  props.level = 9;
+  props.writeEndMark = 1;
+
+  ICompressProgress progress = { myProgress };
+
+  SizeT propsSize = LzmaPropHeaderSize;
+
+  write4(out + LzmaPropHeaderSize, inSize);
+
+  SizeT outSizeT = inSize * 2;
+  int result = LzmaEncode
+    (out + LzmaHeaderSize, &outSizeT, in, inSize, &props, out,
+     &propsSize, 1, &progress, &(allocator->allocator),
+     &(allocator->allocator));
+
+  expect(s, result == SZ_OK);
+
+  return outSizeT + LzmaHeaderSize;
+}
+
 } // namespace
 
 namespace vm {
@@ -29,38 +66,43 @@ uint8_t*
 encodeLZMA(System* s, Allocator* a, uint8_t* in, unsigned inSize,
            unsigned* outSize)
 {
-  const unsigned PropHeaderSize = 5;
-  const unsigned HeaderSize = 13;
+  LzmaAllocator allocator(a);
 
-  unsigned bufferSize = inSize * 2;
+  unsigned chunkCount = ceilingDivide(inSize, LzmaChunkSize);
+  unsigned tableSize = LzmaChunkedHeaderSize + (chunkCount * 4);
+  unsigned bufferSize = tableSize + (inSize * 2)
+    + ((chunkCount + 1) * LzmaHeaderSize);
 
   uint8_t* buffer = static_cast<uint8_t*>(a->allocate(bufferSize));
 
-  LzmaAllocator allocator(a);
+  unsigned size;
+  if (chunkCount > 1) {
+    memset(buffer, 0, LzmaChunkedHeaderSize);
+    buffer[0] = LzmaChunkedMarker;
+    write4(buffer + 4, inSize);
+    write4(buffer + 8, LzmaChunkSize);
+    write4(buffer + 12, chunkCount);
 
-  CLzmaEncProps props;
-  LzmaEncProps_Init(&props);
-  props.level = 9;
-  props.writeEndMark = 1;
+    size = tableSize;
+    for (unsigned i = 0; i < chunkCount; ++i) {
+      unsigned offset = i * LzmaChunkSize;
+      unsigned length = offset + LzmaChunkSize > inSize
+        ? inSize - offset : LzmaChunkSize;
 
-  ICompressProgress progress = { myProgress };
+      unsigned chunkSize = encodeStream
+        (s, &allocator, buffer + size, in + offset, length);
 
-  SizeT propsSize = PropHeaderSize;
+      write4(buffer + LzmaChunkedHeaderSize + (i * 4), chunkSize);
+      size += chunkSize;
+    }
+  } else {
+    size = encodeStream(s, &allocator, buffer, in, inSize);
+  }
 
-  int32_t inSize32 = inSize;
-  memcpy(buffer + PropHeaderSize, &inSize32, 4);
-          
-  SizeT outSizeT = bufferSize;
-  int result = LzmaEncode
-    (buffer + HeaderSize, &outSizeT, in, inSize, &props, buffer,
-     &propsSize, 1, &progress, &(allocator.allocator), &(allocator.allocator));
+  *outSize = size;
 
-  expect(s, result == SZ_OK);
-
-  *outSize = outSizeT + HeaderSize;
-
-  uint8_t* out = static_cast<uint8_t*>(a->allocate(*outSize));
-  memcpy(out, buffer, *outSize);
+  uint8_t* out = static_cast<uint8_t*>(a->allocate(size));
+  memcpy(out, buffer, size);
 
   a->free(buffer, bufferSize);
 
@@ -68,4 +110,3 @@ encodeLZMA(System* s, Allocator* a, uint8_t* in, unsigned inSize,
 }
 
 } // namespace vm
-
@@ -44,12 +44,65 @@ myProgress(void*, UInt64, UInt64)
   return SZ_OK;
 }
 
+const unsigned PropHeaderSize = 5;
+const unsigned HeaderSize = 13;
+
+// see LzmaChunkedMarker in src/avian/lzma-util.h
+const uint8_t ChunkedMarker = 0xFF;
+const unsigned ChunkedHeaderSize = 16;
+
+void
+write4(uint8_t* out, uint32_t v)
+{
+  out[0] = v;
+  out[1] = v >> 8;
+  out[2] = v >> 16;
+  out[3] = v >> 24;
+}
+
+// compresses in as a single stream into out, which must have room for
+// (inSize * 2) + HeaderSize bytes
+int
+encodeStream(uint8_t* out, SizeT* outSize, uint8_t* in, SizeT inSize,
+             ISzAlloc* allocator)
+{
+  CLzmaEncProps props;
+  LzmaEncProps_Init(&props);
+  props.level = 9;
+  props.writeEndMark = 1;
+
+  ICompressProgress progress = { myProgress };
+
+  SizeT propsSize = PropHeaderSize;
+
+  write4(out + PropHeaderSize, inSize);
+
+  *outSize = inSize * 2;
+  int result = LzmaEncode
+    (out + HeaderSize, outSize, in, inSize, &props, out, &propsSize, 1,
+     &progress, allocator, allocator);
+
+  *outSize += HeaderSize;
+
+  return result;
+}
+
+int
+decodeStream(uint8_t* out, SizeT* outSize, uint8_t* in, SizeT inSize,
+             ISzAlloc* allocator, ELzmaStatus* status)
+{
+  inSize -= HeaderSize;
+  return LzmaDecode
+    (out, outSize, in + HeaderSize, &inSize, in, PropHeaderSize,
+     LZMA_FINISH_END, status, allocator);
+}
+
 void
 usageAndExit(const char* program)
 {
   fprintf(stderr,
           "usage: %s {encode|decode} <input file> <output file> "
-          "[<uncompressed size>]", program);
+          "[<chunk size>|<uncompressed size>]", program);
   exit(-1);
 }
 
@@ -102,14 +155,28 @@ main(int argc, const char** argv)
   bool success = false;
 
   if (data) {
-    const unsigned PropHeaderSize = 5;
-    const unsigned HeaderSize = 13;
+    bool chunked = (not encode) and size >= ChunkedHeaderSize
+      and data[0] == ChunkedMarker;
+
+    unsigned chunkSize = 0;
+    unsigned chunkCount = 0;
+    if (encode and argc == 5) {
+      chunkSize = atoi(argv[4]);
+      if (chunkSize) {
+        chunkCount = (size + chunkSize - 1) / chunkSize;
+        chunked = chunkCount > 0;
+      }
+    } else if (chunked) {
+      chunkSize = read4(data + 8);
+      chunkCount = read4(data + 12);
+    }
 
     SizeT outSize;
     if (encode) {
-      outSize = size * 2;
+      outSize = (size * 2) + ((chunkCount + 1) * HeaderSize)
+        + (chunked ? ChunkedHeaderSize + (chunkCount * 4) : 0);
     } else {
-      int32_t outSize32 = read4(data + PropHeaderSize);
+      int32_t outSize32 = read4(data + (chunked ? 4 : PropHeaderSize));
       if (outSize32 >= 0) {
         outSize = outSize32;
       } else if (argc == 5) {
@@ -125,29 +192,48 @@ main(int argc, const char** argv)
         SizeT inSize = size;
         ISzAlloc allocator = { myAllocate, myFree };
         ELzmaStatus status = LZMA_STATUS_NOT_SPECIFIED;
-        int result;
-        if (encode) {
-          CLzmaEncProps props;
-          LzmaEncProps_Init(&props);
-          props.level = 9;
-          props.writeEndMark = 1;
-
-          ICompressProgress progress = { myProgress };
+        int result = SZ_OK;
+        if (chunked) {
+          // each chunk is an independent stream, behind a table of
+          // their compressed sizes, so a reader may decode just the
+          // ones it needs
+          unsigned table = ChunkedHeaderSize + (chunkCount * 4);
+          unsigned position = encode ? table : 0;
+          unsigned in = encode ? 0 : table;
+          for (unsigned i = 0; result == SZ_OK and i < chunkCount; ++i) {
+            unsigned start = i * chunkSize;
+            unsigned length = start + chunkSize > size
+              ? size - start : chunkSize;
 
-          SizeT propsSize = PropHeaderSize;
-
-          int32_t inSize32 = inSize;
-          memcpy(out + PropHeaderSize, &inSize32, 4);
-          
-          result = LzmaEncode
-            (out + HeaderSize, &outSize, data, inSize, &props, out,
-             &propsSize, 1, &progress, &allocator, &allocator);
+            if (encode) {
+              SizeT n;
+              result = encodeStream
+                (out + position, &n, data + start, length, &allocator);
+              write4(out + ChunkedHeaderSize + (i * 4), n);
+              position += n;
+            } else {
+              SizeT n = read4(data + ChunkedHeaderSize + (i * 4));
+              SizeT m = outSize - start;
+              result = decodeStream
+                (out + start, &m, data + in, n, &allocator, &status);
+              in += n;
+              position = start + m;
+            }
+          }
 
-          outSize += HeaderSize;
+          if (encode) {
+            memset(out, 0, ChunkedHeaderSize);
+            out[0] = ChunkedMarker;
+            write4(out + 4, size);
+            write4(out + 8, chunkSize);
+            write4(out + 12, chunkCount);
+          }
+          outSize = position;
+        } else if (encode) {
+          result = encodeStream(out, &outSize, data, inSize, &allocator);
         } else {
-          result = LzmaDecode
-            (out, &outSize, data + HeaderSize, &inSize, data, PropHeaderSize,
-             LZMA_FINISH_END, &status, &allocator);
+          result = decodeStream
+            (out, &outSize, data, inSize, &allocator, &status);
         }
 
         if (result == SZ_OK) {
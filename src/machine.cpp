@@ -19,6 +19,7 @@
 
 #include <avian/util/runtime-array.h>
 #include <avian/util/math.h>
+#include <avian/util/string.h>
 
 #if defined(PLATFORM_WINDOWS)
 #  define WIN32_LEAN_AND_MEAN
@@ -32,8 +33,25 @@ namespace {
 
 const bool DebugClassReader = false;
 
+const bool DebugStringDeduplication = false;
+
+const bool DebugSafepoints = false;
+
+// maximum number of strings considered for deduplication per major
+// collection (see deduplicateStrings)
+const unsigned StringDeduplicationBudget = 4096;
+
 const unsigned NoByte = 0xFFFF;
 
+// deepest stack and longest collapsed form kept per sample
+const unsigned StackSampleMaximumDepth = 64;
+
+const unsigned StackSampleCapacity = 4096;
+
+// classes implementing at least this many interfaces get a hashed
+// interface table; below it a linear scan is as fast
+const unsigned HashedInterfaceThreshold = 6;
+
 #ifdef USE_ATOMIC_OPERATIONS
 void
 atomicIncrement(uint32_t* p, int v)
@@ -166,6 +184,20 @@ visitAll(Thread* m, Thread* o, void (*visit)(Thread*, Thread*))
   visit(m, o);
 }
 
+void
+requestSafepoint(Thread* t, Thread* o)
+{
+  for (Thread* p = o; p; p = p->peer) {
+    if (p != t and p->state == Thread::ActiveState) {
+      t->m->processor->requestSafepoint(t, p);
+    }
+
+    if (p->child) {
+      requestSafepoint(t, p->child);
+    }
+  }
+}
+
 void
 disposeNoRemove(Thread* m, Thread* o)
 {
@@ -180,6 +212,481 @@ interruptDaemon(Thread* m, Thread* o)
   }
 }
 
+uint32_t
+nextAllocationSampleInterval(Machine* m)
+{
+  // xorshift, giving intervals uniformly distributed around the mean so
+  // that periodic allocation patterns don't alias with the sampler
+  uint32_t x = m->allocationSampleSeed;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  m->allocationSampleSeed = x;
+
+  return (m->allocationSampleInterval / 2)
+    + (x % m->allocationSampleInterval);
+}
+
+uint32_t
+hashStackSample(const char* stack, unsigned length)
+{
+  uint32_t h = 2166136261u;
+  for (unsigned i = 0; i < length; ++i) {
+    h = (h ^ static_cast<uint8_t>(stack[i])) * 16777619u;
+  }
+  return h;
+}
+
+StackSample*
+makeStackSample(Machine* m, const char* stack, unsigned length)
+{
+  StackSample* s = static_cast<StackSample*>
+    (m->heap->allocate(sizeof(StackSample) + length + 1));
+
+  s->next = 0;
+  s->target = 0;
+  s->count = 0;
+  s->bytes = 0;
+  s->hash = hashStackSample(stack, length);
+  s->length = length;
+  memcpy(s->stack(), stack, length);
+  s->stack()[length] = 0;
+
+  return s;
+}
+
+void
+disposeStackSample(Machine* m, StackSample* s)
+{
+  m->heap->free(s, sizeof(StackSample) + s->length + 1);
+}
+
+void
+addStackSample(Machine* m, StackSample** table, const char* stack,
+               unsigned length, uint64_t count, uint64_t bytes)
+{
+  uint32_t hash = hashStackSample(stack, length);
+  StackSample** p = table + (hash % StackSampleBucketCount);
+
+  StackSample* s = *p;
+  while (s and (s->hash != hash
+                or s->length != length
+                or memcmp(s->stack(), stack, length) != 0))
+  {
+    s = s->next;
+  }
+
+  if (s == 0) {
+    s = makeStackSample(m, stack, length);
+    s->next = *p;
+    *p = s;
+  }
+
+  s->count += count;
+  s->bytes += bytes;
+}
+
+// Records the class of each pending sample and merges it into the
+// table.  The sampled objects may already be dead, so this must run
+// before their memory can be reused: at the start of a collection or
+// once the last thread is exiting.
+void
+resolveAllocationSamples(Thread* t)
+{
+  Machine* m = t->m;
+  while (m->pendingAllocationSamples) {
+    StackSample* s = m->pendingAllocationSamples;
+    m->pendingAllocationSamples = s->next;
+
+    const char* name = "?";
+    object class_ = objectClass(t, s->target);
+    if (class_ and className(t, class_)) {
+      name = reinterpret_cast<const char*>
+        (&byteArrayBody(t, className(t, class_), 0));
+    }
+
+    char key[StackSampleCapacity * 2];
+    unsigned length = s->length;
+    memcpy(key, s->stack(), length);
+    key[length++] = ';';
+    unsigned nameLength = min
+      (static_cast<unsigned>(strlen(name)), static_cast<unsigned>
+       (sizeof(key) - length));
+    memcpy(key + length, name, nameLength);
+    length += nameLength;
+
+    addStackSample(m, m->allocationSamples, key, length, s->count, s->bytes);
+
+    disposeStackSample(m, s);
+  }
+}
+
+// Writes each sample in the table to out, if it's not null, with its
+// byte count or else its sample count, and empties the table.
+void
+writeStackSamples(Machine* m, StackSample** table, FILE* out, bool bytes)
+{
+  for (unsigned i = 0; i < StackSampleBucketCount; ++i) {
+    for (StackSample* s = table[i]; s;) {
+      if (out) {
+        fprintf(out, "%s %" LLD "\n", s->stack(),
+                static_cast<int64_t>(bytes ? s->bytes : s->count));
+      }
+
+      StackSample* next = s->next;
+      disposeStackSample(m, s);
+      s = next;
+    }
+    table[i] = 0;
+  }
+}
+
+FILE*
+openProfile(const char* path)
+{
+  return ::strcmp(path, "-") == 0 ? stderr : vm::fopen(path, "wb");
+}
+
+void
+closeProfile(FILE* out)
+{
+  if (out and out != stderr) {
+    fclose(out);
+  }
+}
+
+void
+dumpAllocationProfile(Thread* t)
+{
+  Machine* m = t->m;
+
+  resolveAllocationSamples(t);
+
+  FILE* out = openProfile(findProperty(t, "avian.alloc.profile"));
+
+  writeStackSamples(m, m->allocationSamples, out, true);
+
+  closeProfile(out);
+}
+
+// Returns how many sampling intervals elapse with this slow-path
+// allocation.  Bytes are counted as the thread heap is retired and
+// as fixed objects are allocated, so the allocation either crossing
+// the end of a thread heap or too big for one is the one sampled,
+// with a likelihood that grows with its size.
+unsigned
+countAllocationSamples(Thread* t, Machine::AllocationType type,
+                       unsigned sizeInBytes)
+{
+  if (t->flags & (Thread::UseBackupHeapFlag | Thread::TracingFlag)
+      or t->m->collecting)
+  {
+    return 0;
+  }
+
+  unsigned bytes;
+  if (type != Machine::MovableAllocation) {
+    bytes = sizeInBytes;
+  } else if (t->heapIndex + ceilingDivide(sizeInBytes, BytesPerWord)
+             > ThreadHeapSizeInWords)
+  {
+    bytes = t->heapIndex * BytesPerWord;
+  } else {
+    return 0;
+  }
+
+  Machine* m = t->m;
+  ACQUIRE_RAW(t, m->allocationSampleLock);
+
+  unsigned crossings = 0;
+  for (m->allocationSampleCountdown -= bytes;
+       m->allocationSampleCountdown <= 0;
+       m->allocationSampleCountdown += nextAllocationSampleInterval(m))
+  {
+    ++ crossings;
+  }
+
+  return crossings;
+}
+
+// collects the methods of the innermost frames of a stack
+class StackSampleVisitor: public Processor::StackVisitor {
+ public:
+  StackSampleVisitor(): count(0) { }
+
+  virtual bool visit(Processor::StackWalker* walker) {
+    methods[count++] = walker->method();
+    return count < StackSampleMaximumDepth;
+  }
+
+  object methods[StackSampleMaximumDepth];
+  unsigned count;
+};
+
+// Writes the collapsed form of the stack seen by v to stack, which
+// must hold StackSampleCapacity chars, and returns its length.
+unsigned
+collapseStack(Thread* t, StackSampleVisitor* v, char* stack)
+{
+  // frames are written outermost first, dropping the outermost ones
+  // if the innermost won't otherwise fit
+  unsigned frames = 0;
+  unsigned length = 0;
+  for (; frames < v->count; ++frames) {
+    object method = v->methods[frames];
+    unsigned frameLength = (frames ? 1 : 0)
+      + byteArrayLength(t, className(t, methodClass(t, method))) - 1
+      + 1 + byteArrayLength(t, methodName(t, method)) - 1;
+
+    if (length + frameLength > StackSampleCapacity) {
+      break;
+    }
+    length += frameLength;
+  }
+
+  length = 0;
+  for (unsigned i = frames; i > 0; --i) {
+    object method = v->methods[i - 1];
+    object class_ = className(t, methodClass(t, method));
+    object name = methodName(t, method);
+
+    if (i != frames) {
+      stack[length++] = ';';
+    }
+    memcpy(stack + length, &byteArrayBody(t, class_, 0),
+           byteArrayLength(t, class_) - 1);
+    length += byteArrayLength(t, class_) - 1;
+    stack[length++] = '.';
+    memcpy(stack + length, &byteArrayBody(t, name, 0),
+           byteArrayLength(t, name) - 1);
+    length += byteArrayLength(t, name) - 1;
+  }
+
+  if (length == 0) {
+    // the VM itself, outside of any Java frame
+    memcpy(stack, "(vm)", 4);
+    length = 4;
+  }
+
+  return length;
+}
+
+void
+recordAllocationSample(Thread* t, object o, unsigned crossings)
+{
+  StackSampleVisitor v;
+  t->m->processor->walkStack(t, &v);
+
+  char stack[StackSampleCapacity];
+  unsigned length = collapseStack(t, &v, stack);
+
+  Machine* m = t->m;
+  ACQUIRE_RAW(t, m->allocationSampleLock);
+
+  StackSample* s = makeStackSample(m, stack, length);
+  s->target = o;
+  s->count = crossings;
+  s->bytes = static_cast<uint64_t>(crossings) * m->allocationSampleInterval;
+  s->next = m->pendingAllocationSamples;
+  m->pendingAllocationSamples = s;
+}
+
+const char*
+lockName(Machine* m, System::Monitor* lock)
+{
+  if (lock == m->stateLock) {
+    return "stateLock";
+  } else if (lock == m->heapLock) {
+    return "heapLock";
+  } else if (lock == m->classLock) {
+    return "classLock";
+  } else if (lock == m->referenceLock) {
+    return "referenceLock";
+  } else if (lock == m->shutdownLock) {
+    return "shutdownLock";
+  } else {
+    return "(vm)";
+  }
+}
+
+// Adds one blocking of the given duration to the contention profile at
+// the innermost Java frame on t's stack, locking the named lock.
+// Writes the innermost frame of target's stack, as "Class.method:line",
+// or "(vm)" if it has no Java frames, to buffer, truncating it to fit
+// in capacity bytes.  Target must be t or stopped.  Returns the length
+// written.
+unsigned
+describeTopFrame(Thread* t, Thread* target, char* buffer, unsigned capacity)
+{
+  class Visitor: public Processor::StackVisitor {
+   public:
+    Visitor(): method(0), ip(0) { }
+
+    virtual bool visit(Processor::StackWalker* walker) {
+      method = walker->method();
+      ip = walker->ip();
+      return false;
+    }
+
+    object method;
+    int ip;
+  } v;
+
+  t->m->processor->walkStack(target, &v);
+
+  int length;
+  if (v.method) {
+    const char* class_ = reinterpret_cast<const char*>
+      (&byteArrayBody(t, className(t, methodClass(t, v.method)), 0));
+    const char* name = reinterpret_cast<const char*>
+      (&byteArrayBody(t, methodName(t, v.method), 0));
+    int line = t->m->processor->lineNumber(t, v.method, v.ip);
+
+    length = line >= 0
+      ? vm::snprintf(buffer, capacity, "%s.%s:%d", class_, name, line)
+      : vm::snprintf(buffer, capacity, "%s.%s", class_, name);
+  } else {
+    length = vm::snprintf(buffer, capacity, "(vm)");
+  }
+
+  if (length < 0 or length >= static_cast<int>(capacity)) {
+    length = strlen(buffer);
+  }
+
+  return length;
+}
+
+void
+addContentionSample(Thread* t, int64_t nanoseconds, const char* lock)
+{
+  char key[StackSampleCapacity];
+  unsigned length = describeTopFrame(t, t, key, sizeof(key));
+  appendReport(key, sizeof(key), &length, " %s", lock);
+
+  ACQUIRE_RAW(t, t->m->contentionLock);
+
+  addStackSample(t->m, t->m->contentionSamples, key, length, 1,
+                 nanoseconds);
+}
+
+int
+compareSampleBytes(const void* a, const void* b)
+{
+  uint64_t x = (*static_cast<StackSample* const*>(a))->bytes;
+  uint64_t y = (*static_cast<StackSample* const*>(b))->bytes;
+  return x > y ? -1 : (x < y ? 1 : 0);
+}
+
+void
+dumpContentionProfile(Thread* t)
+{
+  FILE* out = openProfile(findProperty(t, "avian.contention.profile"));
+  if (out) {
+    unsigned size;
+    char* report = contentionReport(t, 0, &size);
+    fputs(report, out);
+    t->m->heap->free(report, size);
+
+    closeProfile(out);
+  }
+}
+
+void
+sampleThread(Thread* t, Thread* o)
+{
+  StackSampleVisitor v;
+  if (t->m->processor->sampleStack(t, o, &v)) {
+    char stack[StackSampleCapacity];
+    unsigned length = collapseStack(t, &v, stack);
+
+    ACQUIRE_RAW(t, t->m->cpuSampleLock);
+
+    if (t->m->cpuProfilePath) {
+      addStackSample(t->m, t->m->cpuSamples, stack, length, 1, 0);
+    }
+  }
+}
+
+// samples each thread other than t in the tree rooted at o which is
+// running Java or VM code
+void
+sampleThreads(Thread* t, Thread* o)
+{
+  for (Thread* p = o; p; p = p->peer) {
+    if (p != t and p->state == Thread::ActiveState) {
+      sampleThread(t, p);
+    }
+
+    if (p->child) {
+      sampleThreads(t, p->child);
+    }
+  }
+}
+
+void
+runCpuSampler(Machine* m)
+{
+  Thread* t = attachThread(m, true);
+  if (t == 0) {
+    return;
+  }
+
+  enter(t, Thread::ActiveState);
+
+  while (true) {
+    bool sampling;
+
+    // the lock is released before we become active again, since
+    // threads hold it while active and may wait for it that way
+    { ENTER(t, Thread::IdleState);
+      ACQUIRE_RAW(t, m->cpuSampleLock);
+
+      if (m->alive) {
+        m->cpuSampleLock->waitAndClearInterrupted
+          (t->systemThread, m->cpuProfilePath ? m->cpuSampleInterval : 0);
+      }
+
+      sampling = m->cpuProfilePath != 0;
+    }
+
+    if (not m->alive) {
+      break;
+    }
+
+    if (sampling) {
+      // holding the state lock while active keeps the other threads
+      // from exiting and the collector from moving their frames'
+      // methods until their stacks are collapsed
+      ACQUIRE_RAW(t, m->stateLock);
+
+      sampleThreads(t, m->rootThread);
+    }
+  }
+
+  m->localThread->set(0);
+
+  ACQUIRE_RAW(t, m->stateLock);
+
+  threadPeer(t, t->javaThread) = 0;
+
+  enter(t, Thread::ZombieState);
+
+  t->state = Thread::JoinedState;
+}
+
+void
+dumpMemoryReport(Thread* t)
+{
+  FILE* out = openProfile(findProperty(t, "avian.memory.report"));
+  if (out) {
+    char report[MemoryReportCapacity];
+    memoryReport(t, report, MemoryReportCapacity);
+    fputs(report, out);
+
+    closeProfile(out);
+  }
+}
+
 void
 turnOffTheLights(Thread* t)
 {
@@ -187,6 +694,16 @@ turnOffTheLights(Thread* t)
 
   visitAll(t, t->m->rootThread, join);
 
+  if (t->m->allocationSampleInterval) {
+    dumpAllocationProfile(t);
+  }
+
+  if (t->m->contentionLock) {
+    dumpContentionProfile(t);
+  }
+
+  dumpMemoryReport(t);
+
   enter(t, Thread::ExitState);
 
   { object p = 0;
@@ -245,6 +762,7 @@ turnOffTheLights(Thread* t)
   Classpath* c = m->classpath;
   Finder* bf = m->bootFinder;
   Finder* af = m->appFinder;
+  MemoryTracker* tracker = m->memoryTracker;
 
   c->dispose();
   h->disposeFixies();
@@ -252,6 +770,13 @@ turnOffTheLights(Thread* t)
   p->dispose();
   bf->dispose();
   af->dispose();
+
+  // the finders free what they allocated through the tracker as they
+  // are disposed, so it goes last
+  if (tracker) {
+    h->free(tracker, sizeof(MemoryTracker));
+  }
+
   h->dispose();
   s->dispose();
 }
@@ -293,25 +818,66 @@ footprint(Thread* t)
   return n;
 }
 
+void
+visitThreadRoots(Thread* t, Heap::Visitor* v, unsigned worker)
+{
+  v->visit(&(t->javaThread));
+  v->visit(&(t->exception));
+
+  t->m->processor->visitObjects(t, v, worker);
+
+  for (Thread::Protector* p = t->protector; p; p = p->next) {
+    p->visit(v);
+  }
+}
+
 void
 visitRoots(Thread* t, Heap::Visitor* v)
 {
   if (t->state != Thread::ZombieState) {
-    v->visit(&(t->javaThread));
-    v->visit(&(t->exception));
+    visitThreadRoots(t, v, 0);
+  }
 
-    t->m->processor->visitObjects(t, v);
+  for (Thread* c = t->child; c; c = c->peer) {
+    visitRoots(c, v);
+  }
+}
 
-    for (Thread::Protector* p = t->protector; p; p = p->next) {
-      p->visit(v);
-    }
+unsigned
+liveThreadCount(Thread* t)
+{
+  unsigned n = t->state == Thread::ZombieState ? 0 : 1;
+  for (Thread* c = t->child; c; c = c->peer) {
+    n += liveThreadCount(c);
   }
+  return n;
+}
 
+Thread**
+listLiveThreads(Thread* t, Thread** threads)
+{
+  if (t->state != Thread::ZombieState) {
+    *(threads++) = t;
+  }
   for (Thread* c = t->child; c; c = c->peer) {
-    visitRoots(c, v);
+    threads = listLiveThreads(c, threads);
   }
+  return threads;
 }
 
+// each thread's roots as a group, so the stacks of a great many
+// threads may be scanned by several collector threads at once
+class ThreadRootGroups: public Heap::RootGroups {
+ public:
+  ThreadRootGroups(Thread** threads): threads(threads) { }
+
+  virtual void visit(Heap::Visitor* v, unsigned group, unsigned worker) {
+    visitThreadRoots(threads[group], v, worker);
+  }
+
+  Thread** threads;
+};
+
 bool
 walk(Thread*, Heap::Walker* w, uint32_t* mask, unsigned fixedSize,
      unsigned arrayElementSize, unsigned arrayLength, unsigned start)
@@ -321,10 +887,13 @@ walk(Thread*, Heap::Walker* w, uint32_t* mask, unsigned fixedSize,
     = ceilingDivide(arrayElementSize, BytesPerWord);
 
   for (unsigned i = start; i < fixedSizeInWords; ++i) {
-    if (mask[i / 32] & (static_cast<uint32_t>(1) << (i % 32))) {
-      if (not w->visit(i)) {
-        return false;
-      }
+    uint32_t bits = mask[i / 32] >> (i % 32);
+    if (bits == 0) {
+      // no more references among the fields this word of the mask
+      // covers, so skip to the next one
+      i |= 31;
+    } else if ((bits & 1) and not w->visit(i)) {
+      return false;
     }
   }
 
@@ -349,14 +918,23 @@ walk(Thread*, Heap::Walker* w, uint32_t* mask, unsigned fixedSize,
       elementStart = 0;
     }
 
-    for (unsigned i = arrayStart; i < arrayLength; ++i) {
-      for (unsigned j = elementStart; j < arrayElementSizeInWords; ++j) {
-        unsigned k = fixedSizeInWords + j;
-        if (mask[k / 32] & (static_cast<uint32_t>(1) << (k % 32))) {
-          if (not w->visit
-              (fixedSizeInWords + (i * arrayElementSizeInWords) + j))
-          {
-            return false;
+    if (arrayElementSizeInWords == 1) {
+      // an array of references, which needs no mask tests
+      for (unsigned i = arrayStart; i < arrayLength; ++i) {
+        if (not w->visit(fixedSizeInWords + i)) {
+          return false;
+        }
+      }
+    } else {
+      for (unsigned i = arrayStart; i < arrayLength; ++i) {
+        for (unsigned j = elementStart; j < arrayElementSizeInWords; ++j) {
+          unsigned k = fixedSizeInWords + j;
+          if (mask[k / 32] & (static_cast<uint32_t>(1) << (k % 32))) {
+            if (not w->visit
+                (fixedSizeInWords + (i * arrayElementSizeInWords) + j))
+            {
+              return false;
+            }
           }
         }
       }
@@ -401,6 +979,7 @@ finalizerTargetUnreachable(Thread* t, Heap::Visitor* v, object* p)
     set(t, finalizer, FinalizerQueueTarget, finalizerTarget(t, finalizer));
     set(t, finalizer, FinalizerQueueNext, root(t, Machine::ObjectsToFinalize));
     setRoot(t, Machine::ObjectsToFinalize, finalizer);
+    ++ t->m->finalizeBacklog;
   }
 }
 
@@ -421,6 +1000,7 @@ referenceTargetUnreachable(Thread* t, Heap::Visitor* v, object* p)
 
     set(t, reference, CleanerQueueNext, root(t, Machine::ObjectsToClean));
     setRoot(t, Machine::ObjectsToClean, reference);
+    ++ t->m->finalizeBacklog;
   } else {
     if (jreferenceQueue(t, *p)
         and t->m->heap->status(jreferenceQueue(t, *p)) != Heap::Unreachable)
@@ -502,8 +1082,36 @@ clearTargetIfFinalizable(Thread* t, object r)
   }
 }
 
+// keeps the targets of the soft references in the specified list
+// which have been read recently enough for the current collection, so
+// that nothing which follows sees them as unreachable
 void
-postVisit(Thread* t, Heap::Visitor* v)
+retainSoftReferences(Thread* t, Heap::Visitor* v, object* p)
+{
+  Machine* m = t->m;
+
+  while (*p) {
+    object r = static_cast<object>(m->heap->follow(*p));
+    object c = static_cast<object>(m->heap->follow(objectClass(t, r)));
+
+    if ((classVmFlags(t, c) & SoftReferenceFlag)
+        and m->heap->status(*p) != Heap::Unreachable
+        and m->heap->status(jreferenceTarget(t, r)) == Heap::Unreachable
+        and m->softReferenceClock
+        - static_cast<int64_t>(softReferenceTimestamp(t, r))
+        <= m->softReferenceAllowance)
+    {
+      v->visit(p);
+      v->visit(&jreferenceTarget(t, *p));
+      r = *p;
+    }
+
+    p = &jreferenceVmNext(t, r);
+  }
+}
+
+void
+postVisit(Thread* t, Heap::Visitor* v)
 {
   Machine* m = t->m;
   bool major = m->heap->collectionType() == Heap::MajorCollection;
@@ -512,6 +1120,13 @@ postVisit(Thread* t, Heap::Visitor* v)
 
   m->heap->postVisit();
 
+  if (m->softReferenceAllowance >= 0) {
+    retainSoftReferences(t, v, &(m->weakReferences));
+    if (major) {
+      retainSoftReferences(t, v, &(m->tenuredWeakReferences));
+    }
+  }
+
   for (object p = m->weakReferences; p;) {
     object r = static_cast<object>(m->heap->follow(p));
     p = jreferenceVmNext(t, r);
@@ -688,6 +1303,10 @@ postVisit(Thread* t, Heap::Visitor* v)
 void
 postCollect(Thread* t)
 {
+  if (t->heapIndex < ThreadHeapSizeInWords) {
+    t->allocatedBytes += t->heapIndex * BytesPerWord;
+  }
+
 #ifdef VM_STRESS
   t->m->heap->free(t->defaultHeap, ThreadHeapSizeInBytes);
   t->defaultHeap = static_cast<uintptr_t*>
@@ -704,6 +1323,8 @@ postCollect(Thread* t)
 
   t->heapOffset = 0;
 
+  clearMonitorCache(t);
+
   if (t->m->heap->limitExceeded()) {
     // if we're out of memory, pretend the thread-local heap is
     // already full so we don't make things worse:
@@ -763,6 +1384,31 @@ finalizeObject(Thread* t, object o, const char* name)
   abort(t);
 }
 
+bool
+isAscii(const uint8_t* data, unsigned length)
+{
+  // check a word at a time, since nearly all strings in class files
+  // and JNI calls are plain ASCII
+  const uintptr_t high = static_cast<uintptr_t>(-1) / 0xFF * 0x80;
+
+  unsigned i = 0;
+  for (; i + BytesPerWord <= length; i += BytesPerWord) {
+    uintptr_t word;
+    memcpy(&word, data + i, BytesPerWord);
+    if (word & high) {
+      return false;
+    }
+  }
+
+  for (; i < length; ++i) {
+    if (data[i] & 0x80) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 unsigned
 readByte(AbstractStream& s, unsigned* value)
 {
@@ -883,14 +1529,37 @@ removeByteArray(Thread* t, object o)
     (t, root(t, Machine::ByteArrayMap), o, byteArrayHash, objectEqual);
 }
 
+// Look up an interned object without holding referenceLock.  Inserts
+// publish their nodes after a store-store barrier, and entries are
+// only removed during collection, so a match found here is always
+// valid.  A concurrent resize may relink a chain while we walk it,
+// which can cause a spurious miss; callers retry misses under the
+// lock.
+object
+findInterned(Thread* t, object map, object key,
+             uint32_t (*hash)(Thread*, object),
+             bool (*equal)(Thread*, object, object))
+{
+  assert(t, t->state == Thread::ActiveState
+         or t->state == Thread::ExclusiveState);
+
+  return hashMapFindNode(t, map, key, hash, equal);
+}
+
 object
 internByteArray(Thread* t, object array)
 {
+  object n = findInterned
+    (t, root(t, Machine::ByteArrayMap), array, byteArrayHash, byteArrayEqual);
+  if (n) {
+    return jreferenceTarget(t, tripleFirst(t, n));
+  }
+
   PROTECT(t, array);
 
   ACQUIRE(t, t->m->referenceLock);
 
-  object n = hashMapFindNode
+  n = hashMapFindNode
     (t, root(t, Machine::ByteArrayMap), array, byteArrayHash, byteArrayEqual);
   if (n) {
     return jreferenceTarget(t, tripleFirst(t, n));
@@ -1123,7 +1792,7 @@ getClassAddendum(Thread* t, object class_, object pool)
   if (addendum == 0) {
     PROTECT(t, class_);
 
-    addendum = makeClassAddendum(t, pool, 0, 0, 0, 0, 0, 0, 0);
+    addendum = makeClassAddendum(t, pool, 0, 0, 0, 0, 0, 0, 0, 0);
     set(t, class_, ClassAddendum, addendum);
   }
   return addendum;
@@ -1203,8 +1872,177 @@ parseInterfaceTable(Thread* t, Stream& s, object class_, object pool,
   set(t, class_, ClassInterfaceTable, interfaceTable);
 }
 
+// instance field groups, in the order parseFieldTable lays them out
+enum FieldRank {
+  ReferenceRank,
+  LongRank,
+  IntRank,
+  ShortRank,
+  ByteRank,
+  ContendedRank,
+  RankCount
+};
+
+unsigned
+fieldRank(unsigned code)
+{
+  switch (code) {
+  case ObjectField:
+    return ReferenceRank;
+
+  case LongField:
+  case DoubleField:
+    return LongRank;
+
+  case IntField:
+  case FloatField:
+    return IntRank;
+
+  case CharField:
+  case ShortField:
+    return ShortRank;
+
+  default:
+    return ByteRank;
+  }
+}
+
+void
+placeField(Thread* t, object field, unsigned* memberOffset)
+{
+  unsigned size = fieldSize(t, fieldCode(t, field));
+  while (*memberOffset % size) {
+    ++ *memberOffset;
+  }
+
+  fieldOffset(t, field) = *memberOffset;
+
+  *memberOffset += size;
+}
+
+bool
+skipElementValue(const uint8_t** p, const uint8_t* end);
+
+bool
+skipAnnotation(const uint8_t** p, const uint8_t* end)
+{
+  if (*p + 4 > end) {
+    return false;
+  }
+
+  unsigned pairCount = ((*p)[2] << 8) | (*p)[3];
+  *p += 4;
+
+  for (unsigned i = 0; i < pairCount; ++i) {
+    *p += 2;
+    if (*p > end or not skipElementValue(p, end)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool
+skipElementValue(const uint8_t** p, const uint8_t* end)
+{
+  if (*p >= end) {
+    return false;
+  }
+
+  switch (*((*p)++)) {
+  case 'e':
+    *p += 4;
+    return *p <= end;
+
+  case '@':
+    return skipAnnotation(p, end);
+
+  case '[': {
+    if (*p + 2 > end) {
+      return false;
+    }
+
+    unsigned count = ((*p)[0] << 8) | (*p)[1];
+    *p += 2;
+
+    for (unsigned i = 0; i < count; ++i) {
+      if (not skipElementValue(p, end)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  default:
+    *p += 2;
+    return *p <= end;
+  }
+}
+
+// returns true if the named attribute of a class, field or method is
+// only needed by reflection, so it may be left in the class file
+// until then (see LazyReflectionFlag)
+bool
+reflectionAttribute(Thread* t, object name)
+{
+  const char* const names[] = {
+    "Signature",
+    "RuntimeVisibleAnnotations",
+    "RuntimeVisibleParameterAnnotations",
+    "AnnotationDefault",
+    "Exceptions",
+    "EnclosingMethod"
+  };
+
+  for (unsigned i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+    if (vm::strcmp(reinterpret_cast<const int8_t*>(names[i]),
+                   &byteArrayBody(t, name, 0)) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// returns true if a RuntimeVisibleAnnotations attribute includes
+// sun.misc.Contended
+bool
+hasContendedAnnotation(Thread* t, object pool, const uint8_t* annotations,
+                       unsigned length)
+{
+  const uint8_t* p = annotations;
+  const uint8_t* end = annotations + length;
+
+  if (p + 2 > end) {
+    return false;
+  }
+
+  unsigned count = (p[0] << 8) | p[1];
+  p += 2;
+
+  for (unsigned i = 0; i < count; ++i) {
+    if (p + 2 > end) {
+      return false;
+    }
+
+    object type = singletonObject(t, pool, ((p[0] << 8) | p[1]) - 1);
+    if (vm::strcmp(reinterpret_cast<const int8_t*>("Lsun/misc/Contended;"),
+                   &byteArrayBody(t, type, 0)) == 0)
+    {
+      return true;
+    }
+
+    if (not skipAnnotation(&p, end)) {
+      return false;
+    }
+  }
+
+  return false;
+}
+
 void
-parseFieldTable(Thread* t, Stream& s, object class_, object pool)
+parseFieldTable(Thread* t, Stream& s, object class_, object pool, bool lazy)
 {
   PROTECT(t, class_);
   PROTECT(t, pool);
@@ -1229,6 +2067,9 @@ parseFieldTable(Thread* t, Stream& s, object class_, object pool)
     PROTECT(t, addendum);
 
     THREAD_RUNTIME_ARRAY(t, uint8_t, staticTypes, count);
+    THREAD_RUNTIME_ARRAY(t, unsigned, memberIndexes, count);
+    THREAD_RUNTIME_ARRAY(t, uint8_t, memberRanks, count);
+    unsigned memberCount = 0;
 
     for (unsigned i = 0; i < count; ++i) {
       unsigned flags = s.read2();
@@ -1236,6 +2077,7 @@ parseFieldTable(Thread* t, Stream& s, object class_, object pool)
       unsigned spec = s.read2();
 
       unsigned value = 0;
+      bool contended = false;
 
       addendum = 0;
 
@@ -1251,6 +2093,18 @@ parseFieldTable(Thread* t, Stream& s, object class_, object pool)
                        &byteArrayBody(t, name, 0)) == 0)
         {
           value = s.read2();
+        } else if (lazy and reflectionAttribute(t, name)) {
+          if (vm::strcmp(reinterpret_cast<const int8_t*>
+                         ("RuntimeVisibleAnnotations"),
+                         &byteArrayBody(t, name, 0)) == 0)
+          {
+            const uint8_t* annotations = s.current();
+            s.skip(length);
+            contended = hasContendedAnnotation(t, pool, annotations, length);
+          } else {
+            s.skip(length);
+          }
+          classVmFlags(t, class_) |= LazyReflectionFlag;
         } else if (vm::strcmp(reinterpret_cast<const int8_t*>("Signature"),
                               &byteArrayBody(t, name, 0)) == 0)
         {
@@ -1273,6 +2127,10 @@ parseFieldTable(Thread* t, Stream& s, object class_, object pool)
                  length);
 
           set(t, addendum, AddendumAnnotationTable, body);
+
+          contended = hasContendedAnnotation
+            (t, pool, reinterpret_cast<uint8_t*>(&byteArrayBody(t, body, 0)),
+             length);
         } else {
           s.skip(length);
         }
@@ -1308,13 +2166,9 @@ parseFieldTable(Thread* t, Stream& s, object class_, object pool)
           classVmFlags(t, class_) |= HasFinalMemberFlag;
         }
 
-        while (memberOffset % size) {
-          ++ memberOffset;
-        }
-
-        fieldOffset(t, field) = memberOffset;
-
-        memberOffset += size;
+        RUNTIME_ARRAY_BODY(memberIndexes)[memberCount] = i;
+        RUNTIME_ARRAY_BODY(memberRanks)[memberCount++] = contended
+          ? static_cast<unsigned>(ContendedRank) : fieldRank(code);
       }
 
       set(t, fieldTable, ArrayBody + (i * BytesPerWord), field);
@@ -1322,6 +2176,71 @@ parseFieldTable(Thread* t, Stream& s, object class_, object pool)
 
     set(t, class_, ClassFieldTable, fieldTable);
 
+    // unless the class is described in types.def, whose generated
+    // accessors expect declaration order, group references together so
+    // the collector scans one run of them, then pack primitives largest
+    // first so no space is lost to alignment padding
+    object bootstrapClassMap = root(t, Machine::BootstrapClassMap);
+    bool pack = bootstrapClassMap
+      and hashMapFind(t, bootstrapClassMap, className(t, class_),
+                      byteArrayHash, byteArrayEqual) == 0;
+
+    if (pack) {
+      bool haveLongs = false;
+      for (unsigned i = 0; i < memberCount; ++i) {
+        if (RUNTIME_ARRAY_BODY(memberRanks)[i] == LongRank) {
+          haveLongs = true;
+        }
+      }
+
+      for (unsigned rank = 0; rank < ContendedRank; ++rank) {
+        if (rank == LongRank and haveLongs and memberOffset % 8) {
+          // where words are smaller than longs, fill the gap before the
+          // first long with a four byte field if there is one
+          for (unsigned i = 0; i < memberCount; ++i) {
+            if (RUNTIME_ARRAY_BODY(memberRanks)[i] == IntRank) {
+              placeField(t, arrayBody
+                         (t, fieldTable, RUNTIME_ARRAY_BODY(memberIndexes)[i]),
+                         &memberOffset);
+              RUNTIME_ARRAY_BODY(memberRanks)[i] = RankCount;
+              break;
+            }
+          }
+        }
+
+        for (unsigned i = 0; i < memberCount; ++i) {
+          if (RUNTIME_ARRAY_BODY(memberRanks)[i] == rank) {
+            placeField(t, arrayBody
+                       (t, fieldTable, RUNTIME_ARRAY_BODY(memberIndexes)[i]),
+                       &memberOffset);
+          }
+        }
+      }
+
+      // give each contended field cache lines of its own, padding after
+      // the last one so the next object in memory can't share them
+      bool sawContended = false;
+      for (unsigned i = 0; i < memberCount; ++i) {
+        if (RUNTIME_ARRAY_BODY(memberRanks)[i] == ContendedRank) {
+          memberOffset += ContendedPaddingInBytes;
+          placeField(t, arrayBody
+                     (t, fieldTable, RUNTIME_ARRAY_BODY(memberIndexes)[i]),
+                     &memberOffset);
+          sawContended = true;
+        }
+      }
+
+      if (sawContended) {
+        memberOffset += ContendedPaddingInBytes;
+      }
+    } else {
+      for (unsigned i = 0; i < memberCount; ++i) {
+        placeField(t, arrayBody
+                   (t, fieldTable, RUNTIME_ARRAY_BODY(memberIndexes)[i]),
+                   &memberOffset);
+      }
+    }
+
     if (staticCount) {
       unsigned footprint = ceilingDivide(staticOffset - (BytesPerWord * 2),
                                    BytesPerWord);
@@ -1821,7 +2740,7 @@ parseCode(Thread* t, Stream& s, object pool)
     fprintf(stderr, "    code: maxStack %d maxLocals %d length %d\n", maxStack, maxLocals, length);
   }
 
-  object code = makeCode(t, pool, 0, 0, 0, 0, maxStack, maxLocals, length);
+  object code = makeCode(t, pool, 0, 0, 0, 0, 0, maxStack, maxLocals, length);
   s.read(&codeBody(t, code, 0), length);
   PROTECT(t, code);
 
@@ -1894,9 +2813,9 @@ addInterfaceMethods(Thread* t, object class_, object virtualMap,
       if (vtable) {
         for (unsigned j = 0; j < arrayLength(t, vtable); ++j) {
           method = arrayBody(t, vtable, j);
-          object n = hashMapFindNode
-            (t, virtualMap, method, methodHash, methodEqual);
-          if (n == 0) {
+          if (probeMapFindIndex
+              (t, virtualMap, method, methodHash, methodEqual) < 0)
+          {
             method = makeMethod
               (t,
                methodVmFlags(t, method),
@@ -1913,7 +2832,7 @@ addInterfaceMethods(Thread* t, object class_, object virtualMap,
                class_,
                0);
 
-            hashMapInsert(t, virtualMap, method, method, methodHash);
+            probeMapInsert(t, virtualMap, method, method, methodHash);
 
             if (makeList) {
               if (list == 0) {
@@ -1933,12 +2852,12 @@ addInterfaceMethods(Thread* t, object class_, object virtualMap,
 }
 
 void
-parseMethodTable(Thread* t, Stream& s, object class_, object pool)
+parseMethodTable(Thread* t, Stream& s, object class_, object pool, bool lazy)
 {
   PROTECT(t, class_);
   PROTECT(t, pool);
 
-  object virtualMap = makeHashMap(t, 0, 0);
+  object virtualMap = makeProbeMap(t, 0, 0, 0);
   PROTECT(t, virtualMap);
 
   unsigned virtualCount = 0;
@@ -1958,7 +2877,7 @@ parseMethodTable(Thread* t, Stream& s, object class_, object pool)
       virtualCount = arrayLength(t, superVirtualTable);
       for (unsigned i = 0; i < virtualCount; ++i) {
         object method = arrayBody(t, superVirtualTable, i);
-        hashMapInsert(t, virtualMap, method, method, methodHash);
+        probeMapInsert(t, virtualMap, method, method, methodHash);
       }
     }
   }
@@ -2005,6 +2924,9 @@ parseMethodTable(Thread* t, Stream& s, object class_, object pool)
                        &byteArrayBody(t, attributeName, 0)) == 0)
         {
           code = parseCode(t, s, pool);
+        } else if (lazy and reflectionAttribute(t, attributeName)) {
+          s.skip(length);
+          classVmFlags(t, class_) |= LazyReflectionFlag;
         } else if (vm::strcmp(reinterpret_cast<const int8_t*>("Exceptions"),
                               &byteArrayBody(t, attributeName, 0)) == 0)
         {
@@ -2096,19 +3018,28 @@ parseMethodTable(Thread* t, Stream& s, object class_, object pool)
       if (methodVirtual(t, method)) {
         ++ declaredVirtualCount;
 
-        object p = hashMapFindNode
+        int p = probeMapFindIndex
           (t, virtualMap, method, methodHash, methodEqual);
 
-        if (p) {
-          methodOffset(t, method) = methodOffset(t, tripleFirst(t, p));
+        if (p >= 0) {
+          object overridden = arrayBody(t, probeMapKeys(t, virtualMap), p);
+          if ((classFlags(t, class_) & ACC_INTERFACE) == 0
+              and (methodVmFlags(t, overridden) & OverriddenFlag) == 0)
+          {
+            t->m->processor->methodOverridden(t, overridden);
+          }
 
-          set(t, p, TripleSecond, method);
+          methodOffset(t, method) = methodOffset
+            (t, arrayBody(t, probeMapKeys(t, virtualMap), p));
+
+          set(t, probeMapValues(t, virtualMap), ArrayBody + (p * BytesPerWord),
+              method);
         } else {
           methodOffset(t, method) = virtualCount++;
 
           listAppend(t, newVirtuals, method);
 
-          hashMapInsert(t, virtualMap, method, method, methodHash);
+          probeMapInsert(t, virtualMap, method, method, methodHash);
         }
 
         if (UNLIKELY((classFlags(t, class_) & ACC_INTERFACE) == 0
@@ -2189,12 +3120,15 @@ parseMethodTable(Thread* t, Stream& s, object class_, object pool)
     if (classFlags(t, class_) & ACC_INTERFACE) {
       PROTECT(t, vtable);
 
-      for (HashMapIterator it(t, virtualMap); it.hasMore();) {
-        object method = tripleFirst(t, it.next());
-        assert(t, arrayBody(t, vtable, methodOffset(t, method)) == 0);
-        set(t, vtable, ArrayBody + (methodOffset(t, method) * BytesPerWord),
-            method);
-        ++ i;
+      object keys = probeMapKeys(t, virtualMap);
+      for (unsigned j = 0; j < arrayLength(t, keys); ++j) {
+        object method = arrayBody(t, keys, j);
+        if (method) {
+          assert(t, arrayBody(t, vtable, methodOffset(t, method)) == 0);
+          set(t, vtable, ArrayBody + (methodOffset(t, method) * BytesPerWord),
+              method);
+          ++ i;
+        }
       }
     } else {
       populateInterfaceVtables = true;
@@ -2202,7 +3136,8 @@ parseMethodTable(Thread* t, Stream& s, object class_, object pool)
       if (superVirtualTable) {
         for (; i < arrayLength(t, superVirtualTable); ++i) {
           object method = arrayBody(t, superVirtualTable, i);
-          method = hashMapFind(t, virtualMap, method, methodHash, methodEqual);
+          method = probeMapFind
+            (t, virtualMap, method, methodHash, methodEqual);
 
           set(t, vtable, ArrayBody + (i * BytesPerWord), method);
         }
@@ -2269,7 +3204,7 @@ parseMethodTable(Thread* t, Stream& s, object class_, object pool)
         
           for (unsigned j = 0; j < arrayLength(t, ivtable); ++j) {
             object method = arrayBody(t, ivtable, j);
-            method = hashMapFind
+            method = probeMapFind
               (t, virtualMap, method, methodHash, methodEqual);
             assert(t, method);
               
@@ -2282,7 +3217,60 @@ parseMethodTable(Thread* t, Stream& s, object class_, object pool)
 }
 
 void
-parseAttributeTable(Thread* t, Stream& s, object class_, object pool)
+makeInterfaceHashTable(Thread* t, object class_, object pool)
+{
+  object itable = classInterfaceTable(t, class_);
+  if ((classFlags(t, class_) & ACC_INTERFACE)
+      or itable == 0
+      or arrayLength(t, itable) / 2 < HashedInterfaceThreshold)
+  {
+    return;
+  }
+
+  PROTECT(t, class_);
+  PROTECT(t, itable);
+
+  object table = 0;
+  object super = classSuper(t, class_);
+  if (super and classInterfaceTable(t, super) == itable
+      and classAddendum(t, super))
+  {
+    // the interface table is inherited, so the hash table can be too
+    table = classAddendumInterfaceHashTable(t, classAddendum(t, super));
+  }
+
+  if (table == 0) {
+    // keep the table at most half full so probe runs stay short
+    unsigned slotCount = 1;
+    while (slotCount < arrayLength(t, itable)) {
+      slotCount <<= 1;
+    }
+
+    table = makeArray(t, slotCount * 2);
+
+    unsigned mask = slotCount - 1;
+    for (unsigned i = 0; i < arrayLength(t, itable); i += 2) {
+      object interface = arrayBody(t, itable, i);
+      unsigned j = interfaceHash(t, interface) & mask;
+      while (arrayBody(t, table, j * 2)) {
+        j = (j + 1) & mask;
+      }
+
+      set(t, table, ArrayBody + (j * 2 * BytesPerWord), interface);
+      set(t, table, ArrayBody + (((j * 2) + 1) * BytesPerWord),
+          arrayBody(t, itable, i + 1));
+    }
+  }
+
+  PROTECT(t, table);
+
+  object addendum = getClassAddendum(t, class_, pool);
+  set(t, addendum, ClassAddendumInterfaceHashTable, table);
+}
+
+void
+parseAttributeTable(Thread* t, Stream& s, object class_, object pool,
+                    bool lazy)
 {
   PROTECT(t, class_);
   PROTECT(t, pool);
@@ -2296,6 +3284,30 @@ parseAttributeTable(Thread* t, Stream& s, object class_, object pool)
                    &byteArrayBody(t, name, 0)) == 0)
     {
       set(t, class_, ClassSourceFile, singletonObject(t, pool, s.read2() - 1));
+    } else if (lazy and reflectionAttribute(t, name)) {
+      s.skip(length);
+      classVmFlags(t, class_) |= LazyReflectionFlag;
+    } else if (lazy and vm::strcmp
+               (reinterpret_cast<const int8_t*>("InnerClasses"),
+                &byteArrayBody(t, name, 0)) == 0)
+    {
+      // the class's own entry gives its flags as written in the source,
+      // which are needed now, while the table can wait
+      unsigned innerClassCount = s.read2();
+      for (unsigned i = 0; i < innerClassCount; ++i) {
+        int16_t inner = s.read2();
+        s.skip(4);
+        int16_t flags = s.read2();
+
+        if (inner and 0 == strcmp
+            (&byteArrayBody(t, className(t, class_), 0),
+             &byteArrayBody
+             (t, referenceName(t, singletonObject(t, pool, inner - 1)), 0)))
+        {
+          classFlags(t, class_) = flags;
+        }
+      }
+      classVmFlags(t, class_) |= LazyReflectionFlag;
     } else if (vm::strcmp(reinterpret_cast<const int8_t*>("Signature"),
                           &byteArrayBody(t, name, 0)) == 0)
     {
@@ -2364,41 +3376,251 @@ parseAttributeTable(Thread* t, Stream& s, object class_, object pool)
   }
 }
 
-void
-updateClassTables(Thread* t, object newClass, object oldClass)
+object
+parseAttributeBody(Thread* t, Stream& s, unsigned length)
 {
-  object fieldTable = classFieldTable(t, newClass);
-  if (fieldTable) {
-    for (unsigned i = 0; i < arrayLength(t, fieldTable); ++i) {
-      set(t, arrayBody(t, fieldTable, i), FieldClass, newClass);
-    }
-  }
+  object body = makeByteArray(t, length);
+  s.read(reinterpret_cast<uint8_t*>(&byteArrayBody(t, body, 0)), length);
+  return body;
+}
 
-  object staticTable = classStaticTable(t, newClass);
-  if (staticTable) {
-    set(t, staticTable, SingletonBody, newClass);
-  }
+// reads the attributes of a field or method which parseFieldTable or
+// parseMethodTable left for loadReflectionData, returning an addendum
+// holding them, or zero if there were none
+object
+parseMemberReflectionAttributes(Thread* t, Stream& s, object pool,
+                                bool method)
+{
+  PROTECT(t, pool);
 
-  if (classFlags(t, newClass) & ACC_INTERFACE) {
-    object virtualTable = classVirtualTable(t, newClass);
-    if (virtualTable) {
-      for (unsigned i = 0; i < arrayLength(t, virtualTable); ++i) {
-        if (methodClass(t, arrayBody(t, virtualTable, i)) == oldClass) {
-          set(t, arrayBody(t, virtualTable, i), MethodClass, newClass);
-        }
-      }
+  object addendum = 0;
+  PROTECT(t, addendum);
+
+  unsigned attributeCount = s.read2();
+  for (unsigned j = 0; j < attributeCount; ++j) {
+    object name = singletonObject(t, pool, s.read2() - 1);
+    unsigned length = s.read4();
+
+    bool signature = vm::strcmp
+      (reinterpret_cast<const int8_t*>("Signature"),
+       &byteArrayBody(t, name, 0)) == 0;
+
+    bool annotations = vm::strcmp
+      (reinterpret_cast<const int8_t*>("RuntimeVisibleAnnotations"),
+       &byteArrayBody(t, name, 0)) == 0;
+
+    if (not (reflectionAttribute(t, name)
+             and (method or signature or annotations)))
+    {
+      s.skip(length);
+      continue;
     }
-  }
 
-  object methodTable = classMethodTable(t, newClass);
-  if (methodTable) {
-    for (unsigned i = 0; i < arrayLength(t, methodTable); ++i) {
-      set(t, arrayBody(t, methodTable, i), MethodClass, newClass);
+    if (addendum == 0) {
+      addendum = method
+        ? makeMethodAddendum(t, pool, 0, 0, 0, 0, 0)
+        : makeFieldAddendum(t, pool, 0, 0);
     }
-  }
-}
 
-void
+    if (signature) {
+      set(t, addendum, AddendumSignature,
+          singletonObject(t, pool, s.read2() - 1));
+    } else if (annotations) {
+      object body = parseAttributeBody(t, s, length);
+      set(t, addendum, AddendumAnnotationTable, body);
+    } else if (vm::strcmp(reinterpret_cast<const int8_t*>
+                          ("RuntimeVisibleParameterAnnotations"),
+                          &byteArrayBody(t, name, 0)) == 0)
+    {
+      object body = parseAttributeBody(t, s, length);
+      set(t, addendum, MethodAddendumParameterAnnotationTable, body);
+    } else if (vm::strcmp(reinterpret_cast<const int8_t*>
+                          ("AnnotationDefault"),
+                          &byteArrayBody(t, name, 0)) == 0)
+    {
+      object body = parseAttributeBody(t, s, length);
+      set(t, addendum, MethodAddendumAnnotationDefault, body);
+    } else if (vm::strcmp(reinterpret_cast<const int8_t*>("Exceptions"),
+                          &byteArrayBody(t, name, 0)) == 0)
+    {
+      unsigned exceptionCount = s.read2();
+      object body = makeShortArray(t, exceptionCount);
+      for (unsigned i = 0; i < exceptionCount; ++i) {
+        shortArrayBody(t, body, i) = s.read2();
+      }
+      set(t, addendum, MethodAddendumExceptionTable, body);
+    } else {
+      s.skip(length);
+    }
+  }
+
+  return addendum;
+}
+
+// reads the class attributes which parseAttributeTable left for
+// loadReflectionData
+void
+parseClassReflectionAttributes(Thread* t, Stream& s, object class_,
+                               object pool)
+{
+  PROTECT(t, class_);
+  PROTECT(t, pool);
+
+  unsigned attributeCount = s.read2();
+  for (unsigned j = 0; j < attributeCount; ++j) {
+    object name = singletonObject(t, pool, s.read2() - 1);
+    unsigned length = s.read4();
+
+    if (vm::strcmp(reinterpret_cast<const int8_t*>("Signature"),
+                   &byteArrayBody(t, name, 0)) == 0)
+    {
+      object addendum = getClassAddendum(t, class_, pool);
+      set(t, addendum, AddendumSignature,
+          singletonObject(t, pool, s.read2() - 1));
+    } else if (vm::strcmp(reinterpret_cast<const int8_t*>("InnerClasses"),
+                          &byteArrayBody(t, name, 0)) == 0)
+    {
+      unsigned innerClassCount = s.read2();
+      object table = makeArray(t, innerClassCount);
+      PROTECT(t, table);
+
+      for (unsigned i = 0; i < innerClassCount; ++i) {
+        int16_t inner = s.read2();
+        int16_t outer = s.read2();
+        int16_t name = s.read2();
+        int16_t flags = s.read2();
+
+        object reference = makeInnerClassReference
+          (t,
+           inner ? referenceName(t, singletonObject(t, pool, inner - 1)) : 0,
+           outer ? referenceName(t, singletonObject(t, pool, outer - 1)) : 0,
+           name ? singletonObject(t, pool, name - 1) : 0,
+           flags);
+
+        set(t, table, ArrayBody + (i * BytesPerWord), reference);
+      }
+
+      object addendum = getClassAddendum(t, class_, pool);
+      set(t, addendum, ClassAddendumInnerClassTable, table);
+    } else if (vm::strcmp(reinterpret_cast<const int8_t*>
+                          ("RuntimeVisibleAnnotations"),
+                          &byteArrayBody(t, name, 0)) == 0)
+    {
+      object body = parseAttributeBody(t, s, length);
+      PROTECT(t, body);
+
+      object addendum = getClassAddendum(t, class_, pool);
+      set(t, addendum, AddendumAnnotationTable, body);
+    } else if (vm::strcmp(reinterpret_cast<const int8_t*>
+                          ("EnclosingMethod"),
+                          &byteArrayBody(t, name, 0)) == 0)
+    {
+      int16_t enclosingClass = s.read2();
+      int16_t enclosingMethod = s.read2();
+
+      object addendum = getClassAddendum(t, class_, pool);
+
+      set(t, addendum, ClassAddendumEnclosingClass,
+          referenceName(t, singletonObject(t, pool, enclosingClass - 1)));
+
+      set(t, addendum, ClassAddendumEnclosingMethod, enclosingMethod
+          ? singletonObject(t, pool, enclosingMethod - 1) : 0);
+    } else {
+      s.skip(length);
+    }
+  }
+}
+
+// returns true if the constant pools parsed from the same class file
+// agree on every name, so that either may be used with the indexes
+// in that file
+bool
+samePool(Thread* t, object a, object b)
+{
+  if (singletonCount(t, a) != singletonCount(t, b)) {
+    return false;
+  }
+
+  for (unsigned i = 0; i < singletonCount(t, a); ++i) {
+    if (singletonIsObject(t, a, i) != singletonIsObject(t, b, i)) {
+      return false;
+    }
+
+    if (singletonIsObject(t, a, i)) {
+      object x = singletonObject(t, a, i);
+      object y = singletonObject(t, b, i);
+      // names are interned, while other entries may have been resolved
+      // since a was parsed
+      if (objectClass(t, x) == type(t, Machine::ByteArrayType)
+          and objectClass(t, y) == type(t, Machine::ByteArrayType)
+          and x != y)
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+// Sets the display of class_: the class and its superclasses, root
+// first, so a class at depth d in the hierarchy is at index d of the
+// display of each of its subclasses.  See isAssignableFrom.
+void
+makeDisplay(Thread* t, object class_)
+{
+  PROTECT(t, class_);
+
+  unsigned depth = 0;
+  for (object c = classSuper(t, class_); c; c = classSuper(t, c)) {
+    ++ depth;
+  }
+
+  object display = makeArray(t, depth + 1);
+
+  unsigned i = depth + 1;
+  for (object c = class_; c; c = classSuper(t, c)) {
+    set(t, display, ArrayBody + ((-- i) * BytesPerWord), c);
+  }
+
+  set(t, class_, ClassDisplay, display);
+}
+
+void
+updateClassTables(Thread* t, object newClass, object oldClass)
+{
+  object fieldTable = classFieldTable(t, newClass);
+  if (fieldTable) {
+    for (unsigned i = 0; i < arrayLength(t, fieldTable); ++i) {
+      set(t, arrayBody(t, fieldTable, i), FieldClass, newClass);
+    }
+  }
+
+  object staticTable = classStaticTable(t, newClass);
+  if (staticTable) {
+    set(t, staticTable, SingletonBody, newClass);
+  }
+
+  if (classFlags(t, newClass) & ACC_INTERFACE) {
+    object virtualTable = classVirtualTable(t, newClass);
+    if (virtualTable) {
+      for (unsigned i = 0; i < arrayLength(t, virtualTable); ++i) {
+        if (methodClass(t, arrayBody(t, virtualTable, i)) == oldClass) {
+          set(t, arrayBody(t, virtualTable, i), MethodClass, newClass);
+        }
+      }
+    }
+  }
+
+  object methodTable = classMethodTable(t, newClass);
+  if (methodTable) {
+    for (unsigned i = 0; i < arrayLength(t, methodTable); ++i) {
+      set(t, arrayBody(t, methodTable, i), MethodClass, newClass);
+    }
+  }
+}
+
+void
 updateBootstrapClass(Thread* t, object bootstrapClass, object class_)
 {
   expect(t, bootstrapClass != class_);
@@ -2413,7 +3635,11 @@ updateBootstrapClass(Thread* t, object bootstrapClass, object class_)
   PROTECT(t, bootstrapClass);
   PROTECT(t, class_);
 
-  ENTER(t, Thread::ExclusiveState);
+  // the display of class_ ends with class_ itself, so bootstrapClass
+  // needs its own
+  makeDisplay(t, bootstrapClass);
+
+  ENTER_EXCLUSIVE(t, "class update");
 
   classVmFlags(t, bootstrapClass) &= ~BootstrapFlag;
   classVmFlags(t, bootstrapClass) |= classVmFlags(t, class_);
@@ -2474,6 +3700,8 @@ makeArrayClass(Thread* t, object loader, unsigned dimensions, object spec,
 
   t->m->processor->initVtable(t, c);
 
+  makeDisplay(t, c);
+
   return c;
 }
 
@@ -2754,7 +3982,7 @@ boot(Thread* t)
   classVmFlags(t, type(t, Machine::WeakReferenceType))
     |= ReferenceFlag | WeakReferenceFlag;
   classVmFlags(t, type(t, Machine::SoftReferenceType))
-    |= ReferenceFlag | WeakReferenceFlag;
+    |= ReferenceFlag | WeakReferenceFlag | SoftReferenceFlag;
   classVmFlags(t, type(t, Machine::PhantomReferenceType))
     |= ReferenceFlag | WeakReferenceFlag;
 
@@ -2794,6 +4022,10 @@ boot(Thread* t)
   set(t, type(t, Machine::DoubleArrayType), ClassStaticTable,
       type(t, Machine::JdoubleType));
 
+  for (unsigned i = 0; i < TypeCount; ++i) {
+    makeDisplay(t, type(t, static_cast<Machine::Type>(i)));
+  }
+
   { object map = makeHashMap(t, 0, 0);
     set(t, root(t, Machine::BootLoader), ClassLoaderMap, map);
   }
@@ -2834,7 +4066,7 @@ boot(Thread* t)
 
   m->processor->boot(t, 0, 0);
 
-  { object bootCode = makeCode(t, 0, 0, 0, 0, 0, 0, 0, 1);
+  { object bootCode = makeCode(t, 0, 0, 0, 0, 0, 0, 0, 0, 1);
     codeBody(t, bootCode, 0) = impdep1;
     object bootMethod = makeMethod
       (t, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, bootCode);
@@ -2848,6 +4080,68 @@ boot(Thread* t)
   }
 }
 
+unsigned
+stringDataSize(Thread* t, object data)
+{
+  return arrayLength(t, data) * classArrayElementSize(t, objectClass(t, data));
+}
+
+bool
+stringDataEqual(Thread* t, object a, object b)
+{
+  return objectClass(t, a) == objectClass(t, b)
+    and arrayLength(t, a) == arrayLength(t, b)
+    and memcmp(&byteArrayBody(t, a, 0), &byteArrayBody(t, b, 0),
+               stringDataSize(t, a)) == 0;
+}
+
+// Called after a major collection with the world still stopped: any
+// string copied during the collection whose backing array has the
+// same contents as an earlier candidate's is repointed at that array,
+// leaving its own copy to be reclaimed by the next collection.
+void
+deduplicateStrings(Thread* t)
+{
+  Machine* m = t->m;
+  const unsigned capacity = StringDeduplicationBudget * 2;
+
+  object* table = static_cast<object*>
+    (m->heap->tryAllocate(capacity * BytesPerWord));
+  if (table == 0) {
+    return;
+  }
+  memset(table, 0, capacity * BytesPerWord);
+
+  unsigned saved = 0;
+  for (unsigned i = 0; i < m->stringCandidateCount; ++i) {
+    object s = m->stringCandidates[i];
+    object data = stringData(t, s);
+    if (data == 0 or objectFixed(t, data) or hashTaken(t, data)) {
+      continue;
+    }
+
+    unsigned size = stringDataSize(t, data);
+    unsigned index = hash(&byteArrayBody(t, data, 0), size) & (capacity - 1);
+    while (table[index] and not stringDataEqual(t, table[index], data)) {
+      index = (index + 1) & (capacity - 1);
+    }
+
+    if (table[index] == 0) {
+      table[index] = data;
+    } else if (table[index] != data) {
+      set(t, s, StringData, table[index]);
+      saved += pad(ArrayBody + size);
+    }
+  }
+
+  m->heap->free(table, capacity * BytesPerWord);
+  m->stringCandidateCount = 0;
+
+  if (DebugStringDeduplication) {
+    fprintf(stderr, "string deduplication saved %d bytes\n", saved);
+  }
+}
+
 class HeapClient: public Heap::Client {
  public:
   HeapClient(Machine* m): m(m) { }
@@ -2918,6 +4212,13 @@ class HeapClient: public Heap::Client {
       alias(dst, 0) |= ExtendedMark;
       extendedWord(t, dst, base) = takeHash(t, src);
     }
+
+    if (m->stringClass
+        and m->stringCandidateCount < StringDeduplicationBudget
+        and class_ == m->heap->follow(m->stringClass))
+    {
+      m->stringCandidates[m->stringCandidateCount++] = dst;
+    }
   }
 
   virtual void walk(void* p, Heap::Walker* w) {
@@ -2933,73 +4234,310 @@ class HeapClient: public Heap::Client {
   Machine* m;
 };
 
-void
-doCollect(Thread* t, Heap::CollectionType type, int pendingAllocation)
+unsigned
+collectionPauseBucket(int64_t microseconds)
 {
-  expect(t, not t->m->collecting);
-
-  t->m->collecting = true;
-  THREAD_RESOURCE0(t, t->m->collecting = false);
+  if (microseconds < static_cast<int64_t>(CollectionPauseSubBuckets)) {
+    return microseconds < 0 ? 0 : microseconds;
+  }
 
-#ifdef VM_STRESS
-  bool stress = (t->flags & Thread::StressFlag) != 0;
-  if (not stress) atomicOr(&(t->flags), Thread::StressFlag);
-#endif
+  // 2^k <= microseconds < 2^(k + 1), with k >= 2
+  unsigned k = 0;
+  while ((microseconds >> (k + 1)) != 0) ++ k;
 
-  Machine* m = t->m;
+  unsigned bucket = ((k - 1) * CollectionPauseSubBuckets)
+    + ((microseconds >> (k - 2)) & (CollectionPauseSubBuckets - 1));
 
-  m->unsafe = true;
-  m->heap->collect(type, footprint(m->rootThread), pendingAllocation
-                   - (t->m->heapPoolIndex * ThreadHeapSizeInWords));
-  m->unsafe = false;
+  return min(bucket, CollectionPauseBucketCount - 1);
+}
 
-  postCollect(m->rootThread);
+void
+logCollection(Thread* t, const char* cause, int64_t microseconds)
+{
+  const Heap::CollectionStatistics* s = t->m->heap->lastCollection();
+
+  fprintf(t->m->collectionLog,
+          "gc type=%s cause=%s upgrade=%s pause=%dus"
+          " gen1=%u->%u gen2=%u->%u fixies=%u->%u fixieBytes=%u->%u"
+          " promoted=%u\n",
+          s->type == Heap::MajorCollection ? "major" : "minor",
+          cause,
+          s->upgradeCause ? s->upgradeCause : "none",
+          static_cast<int>(microseconds),
+          s->gen1Before, s->gen1After,
+          s->gen2Before, s->gen2After,
+          s->fixieCountBefore, s->fixieCountAfter,
+          s->fixieFootprintBefore, s->fixieFootprintAfter,
+          s->type == Heap::MinorCollection
+          ? s->gen2After - s->gen2Before : 0);
+
+  fflush(t->m->collectionLog);
+}
 
-  killZombies(t, m->rootThread);
+uint32_t
+eventSequence(uintptr_t position)
+{
+  uint32_t sequence = static_cast<uint32_t>(position) + 1;
+  return sequence ? sequence : 1;
+}
 
-  for (unsigned i = 0; i < m->heapPoolIndex; ++i) {
-    m->heap->free(m->heapPool[i], ThreadHeapSizeInBytes);
-  }
-  m->heapPoolIndex = 0;
+void
+writeEvent(Thread* t, EventType type, int64_t start, int64_t end,
+           uint64_t a, uint64_t b, const char* name)
+{
+  uintptr_t position = t->eventCount;
+  Event* e = t->events + (position % t->m->eventCapacity);
+
+  // mark the slot as being written first, so a thread dumping it
+  // meanwhile discards what it sees
+  e->sequence = 0;
+  storeStoreMemoryBarrier();
+
+  e->time = start;
+  e->duration = end - start;
+  e->a = a;
+  e->b = b;
+  e->thread = 0;
+  e->type = type;
+
+  unsigned length = name ? min
+    (static_cast<unsigned>(strlen(name)), EventNameCapacity - 1) : 0;
+  memcpy(e->name, name, length);
+  e->name[length] = 0;
+
+  storeStoreMemoryBarrier();
+  e->sequence = eventSequence(position);
+
+  t->eventCount = position + 1;
+}
 
-  if (m->heap->limitExceeded()) {
-    // if we're out of memory, disallow further allocations of fixed
-    // objects:
-    m->fixedFootprint = FixedFootprintThresholdInBytes;
-  } else {
-    m->fixedFootprint = 0;
-  }
+void
+recordCollection(Thread* t, int64_t start, const char* cause)
+{
+  const Heap::CollectionStatistics* s = t->m->heap->lastCollection();
+  uint64_t major = s->type == Heap::MajorCollection;
+  int64_t end = t->m->system->nanoTime();
+
+  writeEvent(t, CollectionPhaseEvent, s->traceStart, s->sweepStart, major,
+             0, "trace");
+  writeEvent(t, CollectionPhaseEvent, s->sweepStart, s->end, major, 0,
+             "sweep");
+  // processing of weak references, finalizers, and dead threads
+  writeEvent(t, CollectionPhaseEvent, s->end, end, major, 0,
+             "post-collect");
+  writeEvent(t, CollectionEvent, start, end, major,
+             s->gen1After + s->gen2After + s->fixieFootprintAfter, cause);
+}
 
-#ifdef VM_STRESS
-  if (not stress) atomicAnd(&(t->flags), ~Thread::StressFlag);
-#endif
+// Copies the event at position in o's history to e if it is still
+// in o's buffer and isn't being overwritten, returning whether it is.
+bool
+copyEvent(Thread* o, uintptr_t position, Event* e)
+{
+  Event* p = o->events + (position % o->m->eventCapacity);
 
-  object finalizeQueue = t->m->finalizeQueue;
-  t->m->finalizeQueue = 0;
-  for (; finalizeQueue; finalizeQueue = finalizerNext(t, finalizeQueue)) {
-    void (*function)(Thread*, object);
-    memcpy(&function, &finalizerFinalize(t, finalizeQueue), BytesPerWord);
-    function(t, finalizerTarget(t, finalizeQueue));
-  }
+  uint32_t sequence = p->sequence;
+  loadMemoryBarrier();
 
-  if ((root(t, Machine::ObjectsToFinalize) or root(t, Machine::ObjectsToClean))
-      and m->finalizeThread == 0
-      and t->state != Thread::ExitState)
-  {
-    m->finalizeThread = m->processor->makeThread
-      (m, root(t, Machine::FinalizerThread), m->rootThread);
-    
-    addThread(t, m->finalizeThread);
+  memcpy(e, p, sizeof(Event));
 
-    if (not startThread(t, m->finalizeThread)) {
-      removeThread(t, m->finalizeThread);
-      m->finalizeThread = 0;
-    }
+  loadMemoryBarrier();
+  if (sequence != eventSequence(position) or p->sequence != sequence) {
+    return false;
   }
+
+  e->sequence = sequence;
+  e->thread = reinterpret_cast<uintptr_t>(o);
+  e->name[EventNameCapacity - 1] = 0;
+  return true;
 }
 
-uint64_t
-invokeLoadClass(Thread* t, uintptr_t* arguments)
+void
+writeEvents(Thread* o, FILE* out, uint32_t* count)
+{
+  for (Thread* p = o; p; p = p->peer) {
+    if (p->events) {
+      uintptr_t end = p->eventCount;
+      loadMemoryBarrier();
+
+      unsigned capacity = p->m->eventCapacity;
+      for (uintptr_t i = end > capacity ? end - capacity : 0; i < end; ++i) {
+        Event e;
+        if (copyEvent(p, i, &e) and fwrite(&e, sizeof(Event), 1, out) == 1) {
+          ++ *count;
+        }
+      }
+    }
+
+    if (p->child) {
+      writeEvents(p->child, out, count);
+    }
+  }
+}
+
+bool
+writeEvents(Machine* m, const char* path)
+{
+  FILE* out = vm::fopen(path, "wb");
+  if (out == 0) {
+    return false;
+  }
+
+  EventFileHeader header
+    = { EventFileMagic, EventFileVersion, sizeof(Event), 0 };
+
+  bool success = fwrite(&header, sizeof(header), 1, out) == 1;
+  if (success) {
+    writeEvents(m->rootThread, out, &(header.eventCount));
+
+    // now that we know how many events made it
+    success = fseek(out, 0, SEEK_SET) == 0
+      and fwrite(&header, sizeof(header), 1, out) == 1;
+  }
+
+  return fclose(out) == 0 and success;
+}
+
+// the bytes of the heap limit left free by the last collection
+unsigned
+freeHeap(Machine* m)
+{
+  const Heap::CollectionStatistics* s = m->heap->lastCollection();
+  uint64_t live = static_cast<uint64_t>(s->gen1After) + s->gen2After
+    + s->fixieFootprintAfter;
+
+  return live < m->heap->limit() ? m->heap->limit() - live : 0;
+}
+
+bool
+underMemoryPressure(Machine* m)
+{
+  return freeHeap(m) < static_cast<uint64_t>(m->heap->limit())
+    * m->freeHeapTarget / 100;
+}
+
+int64_t
+softReferenceAllowance(Machine* m)
+{
+  if (underMemoryPressure(m)) {
+    return static_cast<int64_t>(freeHeap(m) / (1024 * 1024))
+      * SoftReferenceMillisecondsPerFreeMegabyte;
+  } else {
+    // every soft reference whose target is otherwise unreachable is
+    // kept, however long it has gone unread
+    return INT64_MAX;
+  }
+}
+
+void
+doCollect(Thread* t, Heap::CollectionType type, int pendingAllocation,
+          const char* cause)
+{
+  expect(t, not t->m->collecting);
+
+  int64_t then = t->m->system->nanoTime();
+
+  t->m->collecting = true;
+  ++ t->m->collectionCount;
+  THREAD_RESOURCE0(t, t->m->collecting = false);
+
+#ifdef VM_STRESS
+  bool stress = (t->flags & Thread::StressFlag) != 0;
+  if (not stress) atomicOr(&(t->flags), Thread::StressFlag);
+#endif
+
+  Machine* m = t->m;
+
+  if (m->stringCandidates and type == Heap::MajorCollection and m->types) {
+    m->stringClass = vm::type(t, Machine::StringType);
+    m->stringCandidateCount = 0;
+  }
+
+  if (m->pendingAllocationSamples) {
+    resolveAllocationSamples(t);
+  }
+
+  m->unsafe = true;
+  m->heap->collect(type, footprint(m->rootThread), pendingAllocation
+                   - (t->m->heapPoolIndex * ThreadHeapSizeInWords));
+  m->unsafe = false;
+
+  if (m->stringClass) {
+    m->stringClass = 0;
+    deduplicateStrings(m->rootThread);
+  }
+
+  postCollect(m->rootThread);
+
+  // soft references read from now on record the end of this collection
+  m->softReferenceClock = m->system->now();
+  if (m->softReferenceClockOffset > 0) {
+    fieldAtOffset<int64_t>
+      (classStaticTable(t, vm::type(t, Machine::SoftReferenceType)),
+       m->softReferenceClockOffset) = m->softReferenceClock;
+  }
+
+  if (m->memoryPressureWatched and underMemoryPressure(m)) {
+    m->memoryPressurePending = true;
+  }
+
+  killZombies(t, m->rootThread);
+
+  for (unsigned i = 0; i < m->heapPoolIndex; ++i) {
+    m->heap->free(m->heapPool[i], ThreadHeapSizeInBytes);
+  }
+  m->heapPoolIndex = 0;
+
+  if (m->heap->limitExceeded()) {
+    // if we're out of memory, disallow further allocations of fixed
+    // objects:
+    m->fixedFootprint = fixedFootprintThreshold(t);
+  } else {
+    m->fixedFootprint = 0;
+  }
+
+  int64_t microseconds = (m->system->nanoTime() - then) / 1000;
+  ++ m->collectionPauseHistogram[collectionPauseBucket(microseconds)];
+
+  if (m->collectionLog) {
+    logCollection(t, cause, microseconds);
+  }
+
+  if (t->events) {
+    recordCollection(t, then, cause);
+  }
+
+#ifdef VM_STRESS
+  if (not stress) atomicAnd(&(t->flags), ~Thread::StressFlag);
+#endif
+
+  object finalizeQueue = t->m->finalizeQueue;
+  t->m->finalizeQueue = 0;
+  for (; finalizeQueue; finalizeQueue = finalizerNext(t, finalizeQueue)) {
+    void (*function)(Thread*, object);
+    memcpy(&function, &finalizerFinalize(t, finalizeQueue), BytesPerWord);
+    function(t, finalizerTarget(t, finalizeQueue));
+  }
+
+  if ((root(t, Machine::ObjectsToFinalize) or root(t, Machine::ObjectsToClean)
+       or m->memoryPressurePending)
+      and m->finalizeThread == 0
+      and t->state != Thread::ExitState)
+  {
+    m->finalizeThread = m->processor->makeThread
+      (m, root(t, Machine::FinalizerThread), m->rootThread);
+    
+    addThread(t, m->finalizeThread);
+
+    if (not startThread(t, m->finalizeThread)) {
+      removeThread(t, m->finalizeThread);
+      m->finalizeThread = 0;
+    }
+  }
+}
+
+uint64_t
+invokeLoadClass(Thread* t, uintptr_t* arguments)
 {
   object method = reinterpret_cast<object>(arguments[0]);
   object loader = reinterpret_cast<object>(arguments[1]);
@@ -3052,10 +4590,508 @@ findInTable(Thread* t, object table, object name, object spec,
   return 0;
 }
 
+object
+fieldForOffsetInClass(Thread* t, object c, unsigned offset)
+{
+  object super = classSuper(t, c);
+  if (super) {
+    object field = fieldForOffsetInClass(t, super, offset);
+    if (field) {
+      return field;
+    }
+  }
+
+  object table = classFieldTable(t, c);
+  if (table) {
+    for (unsigned i = 0; i < objectArrayLength(t, table); ++i) {
+      object field = objectArrayBody(t, table, i);
+      if ((fieldFlags(t, field) & ACC_STATIC) == 0
+          and fieldOffset(t, field) == offset)
+      {
+        return field;
+      }
+    }
+  }
+
+  return 0;
+}
+
+// finds the static field through which soft references learn the
+// time of the last collection, which the class has been initialized
+// far enough to have by the time the first is made
+void
+findSoftReferenceClock(Thread* t)
+{
+  object c = type(t, Machine::SoftReferenceType);
+  PROTECT(t, c);
+
+  object name = makeByteArray(t, "clock");
+  PROTECT(t, name);
+
+  object field = findFieldInClass(t, c, name, makeByteArray(t, "J"));
+
+  ACQUIRE(t, t->m->referenceLock);
+
+  if (t->m->softReferenceClockOffset < 0) {
+    if (field and (fieldFlags(t, field) & ACC_STATIC)) {
+      t->m->softReferenceClockOffset = fieldOffset(t, field);
+      fieldAtOffset<int64_t>
+        (classStaticTable(t, c), t->m->softReferenceClockOffset)
+        = t->m->softReferenceClock;
+    } else {
+      t->m->softReferenceClockOffset = 0;
+    }
+  }
+}
+
+uint64_t
+invokeMemoryPressureHandlers(Thread* t, uintptr_t*)
+{
+  object method = resolveMethod
+    (t, root(t, Machine::BootLoader), "avian/Machine", "memoryPressure",
+     "()V");
+
+  t->m->processor->invoke(t, method, 0);
+
+  return 0;
+}
+
 } // namespace
 
 namespace vm {
 
+// samples running threads on behalf of startCpuProfiler
+class CpuSampler: public System::Runnable {
+ public:
+  CpuSampler(Machine* m): m(m) { }
+
+  virtual void attach(System::Thread*) {
+    // ignore
+  }
+
+  virtual void run() {
+    runCpuSampler(m);
+  }
+
+  virtual bool interrupted() {
+    return false;
+  }
+
+  virtual void setInterrupted(bool) {
+    // ignore
+  }
+
+  Machine* m;
+};
+
+const unsigned TimerSlotBits = 6;
+const unsigned TimerSlotCount = 1 << TimerSlotBits;
+const unsigned TimerSlotMask = TimerSlotCount - 1;
+const unsigned TimerLevelCount = 4;
+
+// Times the long timed waits of every thread with one of its own, so
+// a process with thousands of waiters doesn't have the kernel keep a
+// timer for each.  Timers are kept in a hierarchy of wheels in the
+// style of Varghese and Lauck: the first has a slot for each of the
+// next TimerSlotCount ticks, and each of the others a slot for each
+// turn of the one before, so a timer is moved to the next wheel down
+// whenever its slot comes around and is fired from the first.
+//
+// A timer is fired without the wheel's lock held, since notifying a
+// monitor waiter means acquiring a lock the waiter held while
+// scheduling the timer.  Until it has been, the timer is Firing, and
+// cancelTimer waits for it to become Idle before letting it go.
+class TimerWheel: public System::Runnable {
+ public:
+  TimerWheel(Machine* m):
+    m(m),
+    lock(0),
+    thread(0),
+    base(m->system->nanoTime()),
+    current(0),
+    wakeTick(0),
+    count(0),
+    started(false),
+    running(true)
+  {
+    memset(slots, 0, sizeof(slots));
+
+    if (not m->system->success(m->system->make(&lock))) {
+      m->system->abort();
+    }
+  }
+
+  virtual void attach(System::Thread* t) {
+    thread = t;
+  }
+
+  virtual void run() {
+    lock->acquire(thread);
+
+    while (running) {
+      Timer* fired = 0;
+      if (count) {
+        fired = advance(ticks());
+      } else {
+        current = ticks();
+      }
+
+      if (fired) {
+        fireAll(fired);
+      } else {
+        unsigned delay = count ? ticksUntilNext() : 0;
+        wakeTick = delay ? current + delay : 0;
+
+        lock->wait
+          (thread, delay * TimerWheelTickInNanoseconds / (1000 * 1000));
+
+        wakeTick = 0;
+      }
+    }
+
+    // wake anyone still waiting rather than leave them to wait forever
+    Timer* fired = 0;
+    for (unsigned level = 0; level < TimerLevelCount; ++level) {
+      for (unsigned i = 0; i < TimerSlotCount; ++i) {
+        Timer* list = slots[level][i];
+        slots[level][i] = 0;
+        while (list) {
+          Timer* timer = list;
+          list = list->next;
+          fired = firing(timer, fired);
+        }
+      }
+    }
+
+    if (fired) {
+      fireAll(fired);
+    }
+
+    lock->release(thread);
+  }
+
+  virtual bool interrupted() {
+    return false;
+  }
+
+  virtual void setInterrupted(bool) {
+    // ignore
+  }
+
+  bool schedule(Timer* timer, int64_t nanoseconds) {
+    uint64_t tick = (m->system->nanoTime() - base + nanoseconds
+                     + TimerWheelTickInNanoseconds - 1)
+      / TimerWheelTickInNanoseconds;
+
+    System::MonitorResource r(timer->thread, lock);
+
+    if (running and not started) {
+      started = true;
+      if (not m->system->success(m->system->start(this))) {
+        running = false;
+      }
+    }
+
+    if (not running) {
+      return false;
+    }
+
+    timer->tick = tick;
+    timer->state = Timer::Pending;
+    insert(timer);
+    ++ count;
+
+    if (wakeTick == 0 or tick < wakeTick) {
+      lock->notifyAll(timer->thread);
+    }
+
+    return true;
+  }
+
+  void cancel(Thread* t, Timer* timer) {
+    lock->acquire(timer->thread);
+
+    if (timer->state == Timer::Pending) {
+      unlink(timer);
+      timer->state = Timer::Idle;
+      -- count;
+    } else if (timer->state == Timer::Firing) {
+      lock->release(timer->thread);
+
+      // the wheel won't be long, but it may have to wait for a thread
+      // which is waiting for a collection
+      ENTER(t, Thread::IdleState);
+
+      lock->acquire(timer->thread);
+      while (timer->state == Timer::Firing) {
+        lock->wait(timer->thread, 0);
+      }
+      lock->release(timer->thread);
+      return;
+    }
+
+    lock->release(timer->thread);
+  }
+
+  void stop(System::Thread* context) {
+    { System::MonitorResource r(context, lock);
+
+      running = false;
+      lock->notifyAll(context);
+    }
+
+    if (thread) {
+      thread->join();
+      thread->dispose();
+      thread = 0;
+    }
+  }
+
+  void dispose() {
+    lock->dispose();
+    m->heap->free(this, sizeof(*this));
+  }
+
+ private:
+  // the number of ticks covered by a turn of the specified number of
+  // wheels
+  static uint64_t span(unsigned levels) {
+    return static_cast<uint64_t>(1) << (TimerSlotBits * levels);
+  }
+
+  // the number of whole ticks since the wheel was made
+  uint64_t ticks() {
+    return (m->system->nanoTime() - base) / TimerWheelTickInNanoseconds;
+  }
+
+  void insert(Timer* timer) {
+    // a timer whose tick has passed fires at the next one
+    uint64_t tick = timer->tick > current ? timer->tick : current + 1;
+    uint64_t delta = tick - current;
+
+    unsigned level = 0;
+    while (level < TimerLevelCount - 1 and delta >= span(level + 1)) {
+      ++ level;
+    }
+
+    if (delta >= span(TimerLevelCount)) {
+      // beyond the last wheel, so park it in the slot which comes
+      // around last and move it again from there
+      tick = current + span(TimerLevelCount) - 1;
+    }
+
+    Timer** slot = slots[level]
+      + ((tick >> (TimerSlotBits * level)) & TimerSlotMask);
+
+    timer->next = *slot;
+    timer->previous = slot;
+    if (*slot) {
+      (*slot)->previous = &(timer->next);
+    }
+    *slot = timer;
+  }
+
+  void unlink(Timer* timer) {
+    *(timer->previous) = timer->next;
+    if (timer->next) {
+      timer->next->previous = timer->previous;
+    }
+    timer->next = 0;
+    timer->previous = 0;
+  }
+
+  // moves the wheels on to the specified tick, returning a list of
+  // the timers which are due, linked by Timer::next
+  Timer* advance(uint64_t now) {
+    Timer* fired = 0;
+    while (current < now) {
+      ++ current;
+
+      for (unsigned level = 1; level < TimerLevelCount; ++level) {
+        if (current & (span(level) - 1)) {
+          break;
+        }
+
+        Timer** slot = slots[level]
+          + ((current >> (TimerSlotBits * level)) & TimerSlotMask);
+        Timer* list = *slot;
+        *slot = 0;
+        while (list) {
+          Timer* timer = list;
+          list = list->next;
+          insert(timer);
+        }
+      }
+
+      Timer** slot = slots[0] + (current & TimerSlotMask);
+      Timer* list = *slot;
+      *slot = 0;
+      while (list) {
+        Timer* timer = list;
+        list = list->next;
+        if (timer->tick <= current) {
+          fired = firing(timer, fired);
+        } else {
+          insert(timer);
+        }
+      }
+    }
+    return fired;
+  }
+
+  // the number of ticks until the next one at which a timer may be
+  // due, which is never beyond the next turn of the first wheel
+  unsigned ticksUntilNext() {
+    unsigned boundary = TimerSlotCount - (current & TimerSlotMask);
+    for (unsigned i = 1; i < boundary; ++i) {
+      if (slots[0][(current + i) & TimerSlotMask]) {
+        return i;
+      }
+    }
+    return boundary;
+  }
+
+  // adds timer, which has been taken from its slot, to a list of those
+  // about to be fired
+  Timer* firing(Timer* timer, Timer* list) {
+    timer->next = list;
+    timer->previous = 0;
+    timer->state = Timer::Firing;
+    -- count;
+    return timer;
+  }
+
+  // fires the timers in list, which is entered and left with the lock
+  // held
+  void fireAll(Timer* list) {
+    lock->release(thread);
+
+    for (Timer* t = list; t; t = t->next) {
+      fire(t);
+    }
+
+    lock->acquire(thread);
+
+    for (Timer* t = list; t;) {
+      Timer* next = t->next;
+      t->next = 0;
+      t->state = Timer::Idle;
+      t = next;
+    }
+
+    lock->notifyAll(thread);
+  }
+
+  void fire(Timer* timer) {
+    if (timer->monitor) {
+      timer->monitor->acquire(thread);
+      timer->monitor->notify(thread);
+      timer->monitor->release(thread);
+    } else {
+      timer->thread->unpark();
+    }
+  }
+
+  Machine* m;
+  System::Monitor* lock;
+  System::Thread* thread;
+  int64_t base;
+  // the last tick whose timers have been fired
+  uint64_t current;
+  // the tick the wheel's thread will wake at, or zero if it isn't
+  // waiting for one
+  uint64_t wakeTick;
+  unsigned count;
+  bool started;
+  bool running;
+  Timer* slots[TimerLevelCount][TimerSlotCount];
+};
+
+// asks for a class histogram when the process gets SIGQUIT; see
+// avian.heap.histogramOnQuit
+class QuitHandler: public System::SignalHandler {
+ public:
+  QuitHandler(Machine* m): m(m) { }
+
+  virtual bool handleSignal(void**, void**, void**, void**) {
+    m->histogramRequested = true;
+    return false;
+  }
+
+  Machine* m;
+};
+
+// Opens the libraries named by avian.jni.preload on a background thread
+// while the VM boots, so that the loading, relocation and initializer
+// work is already done when System.loadLibrary asks for them.  These
+// handles are kept apart from Machine::libraries: they only hold the
+// libraries open, and native methods are resolved exactly as before,
+// after the application loads each library.
+class LibraryPreloader: public System::Runnable {
+ public:
+  LibraryPreloader(System* s, Allocator* allocator, const char* list):
+    s(s),
+    allocator(allocator),
+    list(static_cast<char*>(allocator->allocate(strlen(list) + 1))),
+    libraries(0),
+    thread(0)
+  {
+    memcpy(this->list, list, strlen(list) + 1);
+  }
+
+  virtual void attach(System::Thread* t) {
+    thread = t;
+  }
+
+  virtual void run() {
+    System::Library* last = 0;
+    for (Tokenizer tokenizer(list, s->pathSeparator()); tokenizer.hasMore();) {
+      String token(tokenizer.next());
+
+      RUNTIME_ARRAY(char, name, token.length + 1);
+      memcpy(RUNTIME_ARRAY_BODY(name), token.text, token.length);
+      RUNTIME_ARRAY_BODY(name)[token.length] = 0;
+
+      System::Library* lib;
+      if (s->success(s->load(&lib, RUNTIME_ARRAY_BODY(name)))) {
+        if (last) {
+          last->setNext(lib);
+        } else {
+          libraries = lib;
+        }
+        last = lib;
+      }
+    }
+  }
+
+  virtual bool interrupted() {
+    return false;
+  }
+
+  virtual void setInterrupted(bool) { }
+
+  void dispose() {
+    if (thread) {
+      thread->join();
+      thread->dispose();
+    }
+
+    if (libraries) {
+      libraries->disposeAll();
+    }
+
+    allocator->free(list, strlen(list) + 1);
+    allocator->free(this, sizeof(*this));
+  }
+
+  System* s;
+  Allocator* allocator;
+  char* list;
+  System::Library* libraries;
+  System::Thread* thread;
+};
+
+
 Machine::Machine(System* system, Heap* heap, Finder* bootFinder,
                  Finder* appFinder, Processor* processor, Classpath* classpath,
                  const char** properties, unsigned propertyCount,
@@ -3072,7 +5108,12 @@ Machine::Machine(System* system, Heap* heap, Finder* bootFinder,
   classpath(classpath),
   rootThread(0),
   exclusive(0),
+  handshakeTarget(0),
   finalizeThread(0),
+  finalizeThreadLimit(1),
+  finalizeHelperCount(0),
+  finalizeBacklog(0),
+  fastThrowCount(0),
   jniReferences(0),
   properties(properties),
   propertyCount(propertyCount),
@@ -3082,9 +5123,17 @@ Machine::Machine(System* system, Heap* heap, Finder* bootFinder,
   activeCount(0),
   liveCount(0),
   daemonCount(0),
+  safepointCount(0),
+  safepointTime(0),
+  safepointMaxTime(0),
+  safepointMaxReason(0),
+  safepointStraggler(0),
+  safepointLogThreshold(0),
   fixedFootprint(0),
   stackSizeInBytes(stackSizeInBytes),
   localThread(0),
+  parkedThread(0),
+  libraryPreloader(0),
   stateLock(0),
   heapLock(0),
   classLock(0),
@@ -3100,13 +5149,48 @@ Machine::Machine(System* system, Heap* heap, Finder* bootFinder,
   finalizeQueue(0),
   weakReferences(0),
   tenuredWeakReferences(0),
+  freeHeapTarget(DefaultFreeHeapTargetPercent),
+  softReferenceClock(0),
+  softReferenceClockOffset(-1),
+  softReferenceAllowance(0),
+  memoryPressureWatched(false),
+  memoryPressurePending(false),
+  collectionCount(0),
+  lazyReflection(true),
   unsafe(false),
   collecting(false),
   triedBuiltinOnLoad(false),
   dumpedHeapOnOOM(false),
   alive(true),
-  heapPoolIndex(0)
+  stringCandidates(0),
+  stringCandidateCount(0),
+  stringClass(0),
+  collectionLog(0),
+  allocationSampleLock(0),
+  pendingAllocationSamples(0),
+  allocationSampleCountdown(0),
+  allocationSampleInterval(0),
+  allocationSampleSeed(0),
+  cpuSampleLock(0),
+  cpuProfilePath(0),
+  cpuSampleInterval(DefaultCpuSampleIntervalInMilliseconds),
+  cpuSampler(0),
+  timerWheel(0),
+  eventPath(0),
+  eventCapacity(0),
+  contentionLock(0),
+  quitHandler(0),
+  histogramRequested(false),
+  histogramLimit(0),
+  memoryTracker(0),
+  heapPoolIndex(0),
+  localHeaps(false)
 {
+  memset(collectionPauseHistogram, 0, sizeof(collectionPauseHistogram));
+  memset(allocationSamples, 0, sizeof(allocationSamples));
+  memset(cpuSamples, 0, sizeof(cpuSamples));
+  memset(contentionSamples, 0, sizeof(contentionSamples));
+
   heap->setClient(heapClient);
 
   populateJNITables(&javaVMVTable, &jniEnvVTable);
@@ -3119,38 +5203,150 @@ Machine::Machine(System* system, Heap* heap, Finder* bootFinder,
   if (codeLibraryName && (codeLibraryNameEnd = strchr(codeLibraryName, system->pathSeparator())))
     *codeLibraryNameEnd = 0;
 
-  if (not system->success(system->make(&localThread)) or
-      not system->success(system->make(&stateLock)) or
-      not system->success(system->make(&heapLock)) or
-      not system->success(system->make(&classLock)) or
-      not system->success(system->make(&referenceLock)) or
-      not system->success(system->make(&shutdownLock)) or
-      not system->success
-      (system->load(&libraries, bootstrapPropertyDup)))
-  {
+  if (not system->success(system->make(&localThread)) or
+      not system->success(system->make(&stateLock)) or
+      not system->success(system->make(&heapLock)) or
+      not system->success(system->make(&classLock)) or
+      not system->success(system->make(&referenceLock)) or
+      not system->success(system->make(&shutdownLock)) or
+      not system->success
+      (system->load(&libraries, bootstrapPropertyDup)))
+  {
+    system->abort();
+  }
+
+  System::Library* additionalLibrary = 0;
+  while (codeLibraryNameEnd && codeLibraryNameEnd + 1 < bootstrapPropertyEnd) {
+    codeLibraryName = codeLibraryNameEnd + 1;
+    codeLibraryNameEnd = strchr(codeLibraryName, system->pathSeparator());
+    if (codeLibraryNameEnd)
+      *codeLibraryNameEnd = 0;
+
+    if (!system->success(system->load(&additionalLibrary, codeLibraryName)))
+      system->abort();
+    libraries->setNext(additionalLibrary);
+  }
+
+  if(bootstrapPropertyDup)
+    free((void*)bootstrapPropertyDup);
+
+  const char* dedup = findProperty(this, "avian.gc.deduplicateStrings");
+  if (dedup and ::strcmp(dedup, "true") == 0) {
+    stringCandidates = static_cast<object*>
+      (heap->allocate(StringDeduplicationBudget * BytesPerWord));
+  }
+
+  const char* finalizerThreads = findProperty(this, "avian.finalizer.threads");
+  if (finalizerThreads and atoi(finalizerThreads) > 0) {
+    finalizeThreadLimit = min(static_cast<unsigned>(atoi(finalizerThreads)),
+                              MaximumFinalizeThreadCount);
+  }
+
+  const char* preload = findProperty(this, "avian.jni.preload");
+  if (preload) {
+    libraryPreloader = new (heap->allocate(sizeof(LibraryPreloader)))
+      LibraryPreloader(system, heap, preload);
+
+    if (not system->success(system->start(libraryPreloader))) {
+      libraryPreloader->dispose();
+      libraryPreloader = 0;
+    }
+  }
+
+  if (findProperty(this, "avian.jni.cacheAttachments")) {
+    if (not system->success(system->make(&parkedThread))) {
+      system->abort();
+    }
+  }
+
+  const char* gcLog = findProperty(this, "avian.gc.log");
+  if (gcLog) {
+    collectionLog = ::strcmp(gcLog, "-") == 0 ? stderr : vm::fopen(gcLog, "wb");
+  }
+
+  if (findProperty(this, "avian.alloc.profile")) {
+    if (not system->success(system->make(&allocationSampleLock))) {
+      system->abort();
+    }
+
+    const char* interval = findProperty(this, "avian.alloc.sampleInterval");
+    allocationSampleInterval = interval and atoi(interval) > 0
+      ? atoi(interval) : DefaultAllocationSampleIntervalInBytes;
+    allocationSampleSeed = static_cast<uint32_t>(system->now()) | 1;
+    allocationSampleCountdown = nextAllocationSampleInterval(this);
+  }
+
+  if (not system->success(system->make(&cpuSampleLock))) {
     system->abort();
   }
 
-  System::Library* additionalLibrary = 0;
-  while (codeLibraryNameEnd && codeLibraryNameEnd + 1 < bootstrapPropertyEnd) {
-    codeLibraryName = codeLibraryNameEnd + 1;
-    codeLibraryNameEnd = strchr(codeLibraryName, system->pathSeparator());
-    if (codeLibraryNameEnd)
-      *codeLibraryNameEnd = 0;
+  const char* cpuInterval = findProperty(this, "avian.profile.interval");
+  if (cpuInterval and atoi(cpuInterval) > 0) {
+    cpuSampleInterval = atoi(cpuInterval);
+  }
 
-    if (!system->success(system->load(&additionalLibrary, codeLibraryName)))
+  const char* events = findProperty(this, "avian.events");
+  if (events) {
+    unsigned length = strlen(events) + 1;
+    eventPath = static_cast<char*>(heap->allocate(length));
+    memcpy(eventPath, events, length);
+
+    const char* capacity = findProperty(this, "avian.events.capacity");
+    eventCapacity = capacity and atoi(capacity) > 0
+      ? atoi(capacity) : DefaultEventCapacity;
+  }
+
+  if (findProperty(this, "avian.contention.profile")) {
+    if (not system->success(system->make(&contentionLock))) {
       system->abort();
-    libraries->setNext(additionalLibrary);
+    }
   }
 
-  if(bootstrapPropertyDup)
-    free((void*)bootstrapPropertyDup);
+  const char* wheel = findProperty(this, "avian.timer.wheel");
+  if (wheel == 0 or ::strcmp(wheel, "false") != 0) {
+    timerWheel = new (heap->allocate(sizeof(TimerWheel))) TimerWheel(this);
+  }
+
+  const char* numa = findProperty(this, "avian.heap.numa");
+  localHeaps = numa and ::strcmp(numa, "true") == 0;
+
+  const char* freeTarget = findProperty(this, "avian.heap.freeTarget");
+  if (freeTarget and atoi(freeTarget) >= 0 and atoi(freeTarget) <= 100) {
+    freeHeapTarget = atoi(freeTarget);
+  }
+
+  softReferenceClock = system->now();
+
+  const char* threshold = findProperty(this, "avian.safepoint.threshold");
+  if (threshold and atoi(threshold) > 0) {
+    safepointLogThreshold = static_cast<int64_t>(atoi(threshold))
+      * 1000 * 1000;
+  }
+
+#ifdef AVIAN_HEAPDUMP
+  const char* histogram = findProperty(this, "avian.heap.histogramOnQuit");
+  if (histogram and atoi(histogram) > 0) {
+    histogramLimit = atoi(histogram);
+    quitHandler = new (heap->allocate(sizeof(QuitHandler))) QuitHandler(this);
+    if (not system->success(system->handleQuit(quitHandler))) {
+      heap->free(quitHandler, sizeof(QuitHandler));
+      quitHandler = 0;
+    }
+  }
+#endif
 }
 
 void
 Machine::dispose()
 {
+  if (libraryPreloader) {
+    libraryPreloader->dispose();
+  }
+
   localThread->dispose();
+  if (parkedThread) {
+    parkedThread->dispose();
+  }
   stateLock->dispose();
   heapLock->dispose();
   classLock->dispose();
@@ -3164,7 +5360,7 @@ Machine::dispose()
   for (Reference* r = jniReferences; r;) {
     Reference* tmp = r;
     r = r->next;
-    heap->free(tmp, sizeof(*tmp));
+    categoryAllocator(this, ReferenceMemory)->free(tmp, sizeof(*tmp));
   }
 
   for (unsigned i = 0; i < heapPoolIndex; ++i) {
@@ -3175,6 +5371,49 @@ Machine::dispose()
     heap->free(bootimage, bootimageSize);
   }
 
+  if (stringCandidates) {
+    heap->free(stringCandidates, StringDeduplicationBudget * BytesPerWord);
+  }
+
+  if (collectionLog and collectionLog != stderr) {
+    fclose(collectionLog);
+  }
+
+  if (allocationSampleLock) {
+    allocationSampleLock->dispose();
+  }
+
+  writeStackSamples(this, cpuSamples, 0, false);
+
+  if (cpuProfilePath) {
+    heap->free(cpuProfilePath, strlen(cpuProfilePath) + 1);
+  }
+
+  if (cpuSampler) {
+    heap->free(cpuSampler, sizeof(CpuSampler));
+  }
+
+  if (timerWheel) {
+    timerWheel->dispose();
+  }
+
+  cpuSampleLock->dispose();
+
+  if (eventPath) {
+    heap->free(eventPath, strlen(eventPath) + 1);
+  }
+
+  writeStackSamples(this, contentionSamples, 0, false);
+
+  if (contentionLock) {
+    contentionLock->dispose();
+  }
+
+  if (quitHandler) {
+    system->handleQuit(0);
+    heap->free(quitHandler, sizeof(QuitHandler));
+  }
+
   heap->free(arguments, sizeof(const char*) * argumentCount);
 
   heap->free(properties, sizeof(const char*) * propertyCount);
@@ -3184,6 +5423,33 @@ Machine::dispose()
   heap->free(this, sizeof(*this));
 }
 
+#ifdef AVIAN_HEAPDUMP
+void
+printRequestedHistogram(Thread* t)
+{
+  // the signal handler can't do this itself, so the next thread to
+  // take the allocation slow path does, unless it's in the middle of
+  // something which mustn't be interrupted
+  if (t->state == Thread::ActiveState
+      and t->criticalLevel == 0
+      and (t->flags & (Thread::UseBackupHeapFlag | Thread::TracingFlag))
+      == 0)
+  {
+    ENTER_EXCLUSIVE(t, "class histogram");
+
+    if (t->m->histogramRequested) {
+      t->m->histogramRequested = false;
+
+      unsigned size;
+      char* histogram = classHistogram(t, t->m->histogramLimit, true, &size);
+      fputs(histogram, stderr);
+      fflush(stderr);
+      t->m->heap->free(histogram, size);
+    }
+  }
+}
+#endif//AVIAN_HEAPDUMP
+
 Thread::Thread(Machine* m, object javaThread, Thread* parent):
   vtable(&(m->jniEnvVTable)),
   m(m),
@@ -3206,8 +5472,19 @@ Thread::Thread(Machine* m, object javaThread, Thread* parent):
               (m->heap->allocate(ThreadHeapSizeInBytes))),
   heap(defaultHeap),
   backupHeapIndex(0),
-  flags(ActiveFlag)
-{ }
+  flags(ActiveFlag),
+  events(0),
+  eventCount(0),
+  allocatedBytes(0)
+{
+  clearMonitorCache(this);
+
+  if (m->eventCapacity) {
+    events = static_cast<Event*>
+      (m->heap->allocate(m->eventCapacity * sizeof(Event)));
+    memset(events, 0, m->eventCapacity * sizeof(Event));
+  }
+}
 
 void
 Thread::init()
@@ -3226,6 +5503,8 @@ Thread::init()
       abort(this);
     }
 
+    int64_t start = eventStart(this);
+
     BootImage* image = 0;
     uint8_t* code = 0;
     const char* imageFunctionName = findProperty(m, "avian.bootimage");
@@ -3268,8 +5547,14 @@ Thread::init()
 
     m->unsafe = false;
 
+    if (image and start) {
+      recordEvent(this, StartupEvent, start, 0, 0, "load boot image");
+    }
+
     enter(this, ActiveState);
 
+    start = eventStart(this);
+
     if (image and code) {
       m->processor->boot(this, image, code);
       makeArrayInterfaceTable(this);
@@ -3277,6 +5562,11 @@ Thread::init()
       boot(this);
     }
 
+    if (start) {
+      recordEvent(this, StartupEvent, start, 0, 0, image and code
+                  ? "fix up boot image" : "make types");
+    }
+
     setRoot(this, Machine::ByteArrayMap, makeWeakHashMap(this, 0, 0));
     setRoot(this, Machine::MonitorMap, makeWeakHashMap(this, 0, 0));
 
@@ -3297,7 +5587,7 @@ Thread::exit()
   if (state != Thread::ExitState and
       state != Thread::ZombieState)
   {
-    enter(this, Thread::ExclusiveState);
+    enter(this, Thread::ExclusiveState, "exit");
 
     if (m->liveCount == 1) {
       turnOffTheLights(this);
@@ -3324,6 +5614,10 @@ Thread::dispose()
 
   m->heap->free(defaultHeap, ThreadHeapSizeInBytes);
 
+  if (events) {
+    m->heap->free(events, m->eventCapacity * sizeof(Event));
+  }
+
   m->processor->dispose(this);
 }
 
@@ -3371,8 +5665,9 @@ shutDown(Thread* t)
       t->m->finalizeThread = 0;
       t->m->stateLock->notifyAll(t->systemThread);
 
-      while (finalizeThread->state != Thread::ZombieState
-             and finalizeThread->state != Thread::JoinedState)
+      while ((finalizeThread->state != Thread::ZombieState
+              and finalizeThread->state != Thread::JoinedState)
+             or t->m->finalizeHelperCount)
       {
         ENTER(t, Thread::IdleState);
         t->m->stateLock->wait(t->systemThread, 0);      
@@ -3390,10 +5685,321 @@ shutDown(Thread* t)
 
     visitAll(t, t->m->rootThread, interruptDaemon);
   }
+
+  stopCpuProfiler(t);
+
+  if (t->m->timerWheel) {
+    t->m->timerWheel->stop(t->systemThread);
+  }
+
+  if (t->m->eventPath) {
+    dumpEvents(t, 0);
+  }
+}
+
+bool
+startCpuProfiler(Thread* t, const char* spec)
+{
+  if (strncmp(spec, "cpu:", 4) != 0 or spec[4] == 0) {
+    return false;
+  }
+
+  const char* path = spec + 4;
+  Machine* m = t->m;
+
+  { ACQUIRE_RAW(t, m->cpuSampleLock);
+
+    if (m->cpuProfilePath or not m->alive) {
+      return false;
+    }
+
+    unsigned length = strlen(path) + 1;
+    m->cpuProfilePath = static_cast<char*>(m->heap->allocate(length));
+    memcpy(m->cpuProfilePath, path, length);
+
+    if (m->cpuSampler) {
+      m->cpuSampleLock->notifyAll(t->systemThread);
+      return true;
+    }
+
+    m->cpuSampler = new (m->heap->allocate(sizeof(CpuSampler)))
+      CpuSampler(m);
+  }
+
+  expect(t, m->system->success(m->system->start(m->cpuSampler)));
+
+  return true;
+}
+
+bool
+scheduleTimer(Thread* t, Timer* timer, int64_t nanoseconds)
+{
+  return t->m->timerWheel
+    and nanoseconds >= MinimumWheelTimeoutInNanoseconds
+    and nanoseconds <= MaximumWheelTimeoutInNanoseconds
+    and t->m->timerWheel->schedule(timer, nanoseconds);
+}
+
+void
+cancelTimer(Thread* t, Timer* timer)
+{
+  t->m->timerWheel->cancel(t, timer);
+}
+
+bool
+stopCpuProfiler(Thread* t)
+{
+  Machine* m = t->m;
+  char* path;
+  StackSample* samples[StackSampleBucketCount];
+
+  { ACQUIRE_RAW(t, m->cpuSampleLock);
+
+    path = m->cpuProfilePath;
+    if (path == 0) {
+      return false;
+    }
+
+    m->cpuProfilePath = 0;
+    memcpy(samples, m->cpuSamples, sizeof(samples));
+    memset(m->cpuSamples, 0, sizeof(m->cpuSamples));
+  }
+
+  FILE* out = openProfile(path);
+
+  writeStackSamples(m, samples, out, false);
+
+  closeProfile(out);
+
+  m->heap->free(path, strlen(path) + 1);
+
+  return out != 0;
+}
+
+void
+recordEvent(Thread* t, EventType type, int64_t start, uint64_t a,
+            uint64_t b, const char* name)
+{
+  writeEvent(t, type, start, t->m->system->nanoTime(), a, b, name);
+}
+
+void
+recordInterval(Thread* t, EventType type, int64_t start, int64_t end,
+               uint64_t a, uint64_t b, const char* name)
+{
+  writeEvent(t, type, start, end, a, b, name);
+}
+
+void
+recordMethodEvent(Thread* t, EventType type, int64_t start, uint64_t a,
+                  uint64_t b, object method)
+{
+  object class_ = className(t, methodClass(t, method));
+  object name = methodName(t, method);
+
+  char buffer[EventNameCapacity];
+  unsigned length = min(static_cast<unsigned>(byteArrayLength(t, class_) - 1),
+                        EventNameCapacity - 2);
+  memcpy(buffer, &byteArrayBody(t, class_, 0), length);
+  buffer[length++] = '.';
+
+  unsigned nameLength = min
+    (static_cast<unsigned>(byteArrayLength(t, name) - 1),
+     EventNameCapacity - 1 - length);
+  memcpy(buffer + length, &byteArrayBody(t, name, 0), nameLength);
+  buffer[length + nameLength] = 0;
+
+  recordEvent(t, type, start, a, b, buffer);
+}
+
+void
+acquireAndRecord(Thread* t, object o, object m)
+{
+  PROTECT(t, o);
+
+  int64_t start = t->m->system->nanoTime();
+
+  monitorAcquire(t, m);
+
+  object name = className(t, objectClass(t, o));
+  const char* lock = name
+    ? reinterpret_cast<const char*>(&byteArrayBody(t, name, 0)) : "?";
+
+  if (t->events) {
+    recordEvent(t, MonitorContentionEvent, start, 0, 0, lock);
+  }
+
+  if (t->m->contentionLock) {
+    addContentionSample(t, t->m->system->nanoTime() - start, lock);
+  }
+}
+
+void
+recordContention(Thread* t, System::Monitor* lock, int64_t start)
+{
+  const char* name = lockName(t->m, lock);
+
+  if (t->events) {
+    recordEvent(t, MonitorContentionEvent, start, 0, 0, name);
+  }
+
+  // the contention lock itself is only acquired raw, so we can't
+  // be here waiting for it
+  if (t->m->contentionLock) {
+    addContentionSample(t, t->m->system->nanoTime() - start, name);
+  }
+}
+
+char*
+contentionReport(Thread* t, unsigned limit, unsigned* size)
+{
+  Machine* m = t->m;
+  ACQUIRE_RAW(t, m->contentionLock);
+
+  unsigned count = 0;
+  for (unsigned i = 0; i < StackSampleBucketCount; ++i) {
+    for (StackSample* s = m->contentionSamples[i]; s; s = s->next) {
+      ++ count;
+    }
+  }
+
+  unsigned samplesSize = max(count, 1U) * sizeof(StackSample*);
+  StackSample** samples = static_cast<StackSample**>
+    (m->heap->allocate(samplesSize));
+
+  count = 0;
+  for (unsigned i = 0; i < StackSampleBucketCount; ++i) {
+    for (StackSample* s = m->contentionSamples[i]; s; s = s->next) {
+      samples[count++] = s;
+    }
+  }
+
+  qsort(samples, count, sizeof(StackSample*), compareSampleBytes);
+
+  if (limit and limit < count) {
+    count = limit;
+  }
+
+  // room for two 64-bit numbers and the punctuation around them
+  const unsigned LineOverhead = 48;
+
+  *size = 1;
+  for (unsigned i = 0; i < count; ++i) {
+    *size += samples[i]->length + LineOverhead;
+  }
+
+  char* report = static_cast<char*>(m->heap->allocate(*size));
+  unsigned length = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    length += sprintf(report + length, "%" LLD "us %" LLD " %s\n",
+                      static_cast<int64_t>(samples[i]->bytes / 1000),
+                      static_cast<int64_t>(samples[i]->count),
+                      samples[i]->stack());
+  }
+  report[length] = 0;
+
+  m->heap->free(samples, samplesSize);
+
+  return report;
+}
+
+unsigned
+safepointReport(Thread* t, char* buffer, unsigned capacity)
+{
+  Machine* m = t->m;
+  ACQUIRE_RAW(t, m->stateLock);
+
+  unsigned length = 0;
+  buffer[0] = 0;
+  appendReport(buffer, capacity, &length,
+               "safepoints %u total %" LLD "us max %" LLD "us for %s\n",
+               m->safepointCount,
+               static_cast<int64_t>(m->safepointTime / 1000),
+               static_cast<int64_t>(m->safepointMaxTime / 1000),
+               m->safepointMaxReason ? m->safepointMaxReason : "nothing");
+
+  return length;
+}
+
+unsigned
+memoryReport(Thread* t, char* buffer, unsigned capacity)
+{
+  // in the order of MemoryCategory
+  const char* const names[] = { "compiler", "classpath", "references" };
+
+  Machine* m = t->m;
+  unsigned length = 0;
+  buffer[0] = 0;
+
+  if (m->memoryTracker) {
+    for (unsigned i = 0; i < MemoryCategoryCount; ++i) {
+      TrackingAllocator* a = m->memoryTracker->allocators + i;
+      appendReport(buffer, capacity, &length, "%s %" LLD " peak %" LLD "\n",
+                   names[i], static_cast<int64_t>(a->footprint),
+                   static_cast<int64_t>(a->peak));
+    }
+  }
+
+  appendReport(buffer, capacity, &length, "fixed %u\n", m->fixedFootprint);
+
+  appendReport(buffer, capacity, &length, "code %u\n",
+               m->processor->codeFootprint());
+
+  // threads may have asked for stacks of other sizes, so this is only
+  // an estimate
+  unsigned threadCount = m->threadCount;
+  appendReport(buffer, capacity, &length, "stacks %" LLD " threads %u\n",
+               static_cast<int64_t>(threadCount) * m->stackSizeInBytes,
+               threadCount);
+
+  return length;
+}
+
+void
+appendReport(char* buffer, unsigned capacity, unsigned* length,
+             const char* format, ...)
+{
+  if (*length + 1 >= capacity) {
+    return;
+  }
+
+  va_list a;
+  va_start(a, format);
+  int r = vm::vsnprintf(buffer + *length, capacity - *length, format, a);
+  va_end(a);
+
+  if (r < 0 or *length + r >= capacity) {
+    *length = capacity - 1;
+    buffer[*length] = 0;
+  } else {
+    *length += r;
+  }
+}
+
+bool
+dumpEvents(Thread* t, const char* path)
+{
+  if (t->m->eventPath == 0) {
+    return false;
+  }
+
+  // holding the state lock while active keeps threads from exiting,
+  // and their buffers from being freed, meanwhile
+  ACQUIRE_RAW(t, t->m->stateLock);
+
+  return writeEvents(t->m, path ? path : t->m->eventPath);
+}
+
+void
+dumpEventsOnCrash(Machine* m)
+{
+  if (m->eventPath) {
+    writeEvents(m, m->eventPath);
+  }
 }
 
 void
-enter(Thread* t, Thread::State s)
+enter(Thread* t, Thread::State s, const char* reason)
 {
   stress(t);
 
@@ -3418,6 +6024,8 @@ enter(Thread* t, Thread::State s)
 
   switch (s) {
   case Thread::ExclusiveState: {
+    int64_t start = eventStart(t);
+
     ACQUIRE_LOCK;
 
     while (t->m->exclusive) {
@@ -3441,8 +6049,65 @@ enter(Thread* t, Thread::State s)
     
     STORE_LOAD_MEMORY_BARRIER;
 
-    while (t->m->activeCount > 1) {
-      t->m->stateLock->wait(t->systemThread, 0);
+    unsigned waited = t->m->activeCount - 1;
+    int64_t time = 0;
+
+    if (reason == 0) {
+      reason = "other";
+    }
+
+    if (t->m->activeCount > 1) {
+      // ask threads running compiled code to stop at their next
+      // safepoint poll rather than waiting for them to allocate
+      requestSafepoint(t, t->m->rootThread);
+
+      t->m->safepointStraggler = 0;
+
+      int64_t then = t->m->system->nanoTime();
+
+      while (t->m->activeCount > 1) {
+        t->m->stateLock->wait(t->systemThread, 0);
+      }
+
+      time = t->m->system->nanoTime() - then;
+      ++ t->m->safepointCount;
+      t->m->safepointTime += time;
+
+      if (time > t->m->safepointMaxTime) {
+        t->m->safepointMaxTime = time;
+        t->m->safepointMaxReason = reason;
+      }
+
+      if (DebugSafepoints) {
+        fprintf(stderr, "time to safepoint: %4dms; "
+                "total: %4dms over %d safepoints\n",
+                static_cast<int>(time / (1000 * 1000)),
+                static_cast<int>(t->m->safepointTime / (1000 * 1000)),
+                t->m->safepointCount);
+      }
+
+      // we still hold stateLock, so the straggler, which is idle now,
+      // can't exit while we look at its stack
+      Thread* last = t->m->safepointStraggler;
+      if (t->m->safepointLogThreshold
+          and time > t->m->safepointLogThreshold)
+      {
+        char frame[StackSampleCapacity];
+        if (last) {
+          describeTopFrame(t, last, frame, sizeof(frame));
+        } else {
+          frame[0] = 0;
+        }
+
+        fprintf(stderr, "safepoint: waited %" LLD "us for %u threads "
+                "to stop for %s; last was %p in %s\n",
+                static_cast<int64_t>(time / 1000), waited, reason,
+                static_cast<void*>(last), last ? frame : "(unknown)");
+      }
+    }
+
+    if (start) {
+      recordEvent(t, ExclusiveEvent, start, waited, time, reason);
     }
   } break;
 
@@ -3450,13 +6115,21 @@ enter(Thread* t, Thread::State s)
     if (LIKELY(t->state == Thread::ActiveState)) {
       // fast path
       assert(t, t->m->activeCount > 0);
-      INCREMENT(&(t->m->activeCount), -1);
 
+      // update the state before the count so that a thread which
+      // sets handshakeTarget and then checks our state (see
+      // handshake) can't miss both
       t->state = s;
 
-      if (t->m->exclusive) {
+      INCREMENT(&(t->m->activeCount), -1);
+
+      if (t->m->exclusive or t->m->handshakeTarget == t) {
         ACQUIRE_LOCK;
 
+        if (t->m->exclusive and t->m->activeCount == 1) {
+          t->m->safepointStraggler = t;
+        }
+
         t->m->stateLock->notifyAll(t->systemThread);
       }
 
@@ -3497,15 +6170,18 @@ enter(Thread* t, Thread::State s)
   } break;
 
   case Thread::ActiveState:
-    if (LIKELY(t->state == Thread::IdleState and t->m->exclusive == 0)) {
+    if (LIKELY(t->state == Thread::IdleState and t->m->exclusive == 0
+               and t->m->handshakeTarget != t))
+    {
       // fast path
-      INCREMENT(&(t->m->activeCount), 1);
-
       t->state = s;
 
-      if (t->m->exclusive) {
-        // another thread has entered the exclusive state, so we
-        // return to idle and use the slow path to become active
+      INCREMENT(&(t->m->activeCount), 1);
+
+      if (t->m->exclusive or t->m->handshakeTarget == t) {
+        // another thread has entered the exclusive state or is
+        // running a handshake with us, so we return to idle and use
+        // the slow path to become active
         enter(t, Thread::IdleState);
       } else {
         break;
@@ -3526,7 +6202,7 @@ enter(Thread* t, Thread::State s)
 
       case Thread::NoState:
       case Thread::IdleState: {
-        while (t->m->exclusive) {
+        while (t->m->exclusive or t->m->handshakeTarget == t) {
           t->m->stateLock->wait(t->systemThread, 0);
         }
 
@@ -3572,6 +6248,58 @@ enter(Thread* t, Thread::State s)
   }
 }
 
+bool
+handshake(Thread* t, Thread* target, Thread::Handshake* h)
+{
+  assert(t, t != target);
+
+  bool stopped;
+  { // we may have to wait below, so don't hold up collections while
+    // doing so
+    ENTER(t, Thread::IdleState);
+
+    ACQUIRE_RAW(t, t->m->stateLock);
+
+    while (t->m->handshakeTarget) {
+      t->m->stateLock->wait(t->systemThread, 0);
+    }
+
+    t->m->handshakeTarget = target;
+
+    storeLoadMemoryBarrier();
+
+    // once handshakeTarget is set, the target can't become active,
+    // so we only need to wait for it to reach its next safepoint
+    // poll if it is already running
+    if (target->state == Thread::ActiveState
+        or target->state == Thread::ExclusiveState)
+    {
+      t->m->processor->requestSafepoint(t, target);
+
+      while (target->state == Thread::ActiveState
+             or target->state == Thread::ExclusiveState)
+      {
+        t->m->stateLock->wait(t->systemThread, 0);
+      }
+    }
+
+    stopped = target->state == Thread::IdleState;
+  }
+
+  THREAD_RESOURCE0(t, {
+      ACQUIRE_RAW(t, t->m->stateLock);
+
+      t->m->handshakeTarget = 0;
+      t->m->stateLock->notifyAll(t->systemThread);
+    });
+
+  if (stopped) {
+    h->run(t, target);
+  }
+
+  return stopped;
+}
+
 object
 allocate2(Thread* t, unsigned sizeInBytes, bool objectMask)
 {
@@ -3582,9 +6310,60 @@ allocate2(Thread* t, unsigned sizeInBytes, bool objectMask)
      sizeInBytes, objectMask);
 }
 
+bool
+tryRefillThreadHeap(Thread* t)
+{
+  // A collection can't start while we're in the active state, so the
+  // only thing we need to coordinate with other allocating threads is
+  // the pool index, which we claim with a CAS instead of taking
+  // stateLock.  We defer to the slow path whenever another thread is
+  // waiting for exclusive access or the pool is exhausted.
+  if (t->state != Thread::ActiveState
+      or t->m->exclusive
+      or t->m->heapPoolIndex >= ThreadHeapPoolSize
+      or t->m->heap->limitExceeded())
+  {
+    return false;
+  }
+
+  uintptr_t* heap = static_cast<uintptr_t*>
+    (t->m->heap->tryAllocate(ThreadHeapSizeInBytes));
+
+  if (heap == 0) {
+    return false;
+  }
+
+  if (t->m->localHeaps) {
+    t->m->system->bindToLocalNode(heap, ThreadHeapSizeInBytes);
+  }
+
+  while (true) {
+    uint32_t index = t->m->heapPoolIndex;
+    if (index >= ThreadHeapPoolSize) {
+      t->m->heap->free(heap, ThreadHeapSizeInBytes);
+      return false;
+    }
+
+    if (atomicCompareAndSwap32(&(t->m->heapPoolIndex), index, index + 1)) {
+      t->m->heapPool[index] = heap;
+      break;
+    }
+  }
+
+  memset(heap, 0, ThreadHeapSizeInBytes);
+
+  t->heap = heap;
+  t->allocatedBytes += t->heapIndex * BytesPerWord;
+  t->heapOffset += t->heapIndex;
+  t->heapIndex = 0;
+
+  return true;
+}
+
 object
-allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
-          unsigned sizeInBytes, bool objectMask)
+allocateUnsampled(Thread* t, Allocator* allocator,
+                  Machine::AllocationType type, unsigned sizeInBytes,
+                  bool objectMask)
 {
   expect(t, t->criticalLevel == 0);
 
@@ -3602,6 +6381,15 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
     return allocateSmall(t, sizeInBytes);
   }
 
+  if (type == Machine::MovableAllocation
+      and t->heapIndex + ceilingDivide(sizeInBytes, BytesPerWord)
+      > ThreadHeapSizeInWords
+      and ceilingDivide(sizeInBytes, BytesPerWord) <= ThreadHeapSizeInWords
+      and tryRefillThreadHeap(t))
+  {
+    return allocateSmall(t, sizeInBytes);
+  }
+
   ACQUIRE_RAW(t, t->m->stateLock);
 
   while (t->m->exclusive and t->m->exclusive != t) {
@@ -3628,9 +6416,13 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
             (t->m->heap->tryAllocate(ThreadHeapSizeInBytes));
 
           if (t->heap) {
+            if (t->m->localHeaps) {
+              t->m->system->bindToLocalNode(t->heap, ThreadHeapSizeInBytes);
+            }
             memset(t->heap, 0, ThreadHeapSizeInBytes);
 
             t->m->heapPool[t->m->heapPoolIndex++] = t->heap;
+            t->allocatedBytes += t->heapIndex * BytesPerWord;
             t->heapOffset += t->heapIndex;
             t->heapIndex = 0;
           }
@@ -3639,7 +6431,7 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
       break;
 
     case Machine::FixedAllocation:
-      if (t->m->fixedFootprint + sizeInBytes > FixedFootprintThresholdInBytes)
+      if (t->m->fixedFootprint + sizeInBytes > fixedFootprintThreshold(t))
       {
         t->heap = 0;
       }
@@ -3681,6 +6473,8 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
     
     t->m->fixedFootprint += t->m->heap->fixedFootprint
       (ceilingDivide(sizeInBytes, BytesPerWord), objectMask);
+
+    t->allocatedBytes += sizeInBytes;
       
     return o;
   }
@@ -3694,6 +6488,8 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
 
     alias(o, 0) = FixedMark;
 
+    t->allocatedBytes += sizeInBytes;
+
     return o;
   }
 
@@ -3701,24 +6497,65 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
   }
 }
 
+object
+allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
+          unsigned sizeInBytes, bool objectMask)
+{
+#ifdef AVIAN_HEAPDUMP
+  if (UNLIKELY(t->m->histogramRequested)) {
+    printRequestedHistogram(t);
+  }
+#endif
+
+  if (UNLIKELY(t->m->allocationSampleInterval)) {
+    unsigned crossings = countAllocationSamples(t, type, sizeInBytes);
+    if (crossings) {
+      object o = allocateUnsampled
+        (t, allocator, type, sizeInBytes, objectMask);
+
+      recordAllocationSample(t, o, crossings);
+
+      AVIAN_PROBE3(object__alloc, t, sizeInBytes,
+                   static_cast<uint64_t>(crossings)
+                   * t->m->allocationSampleInterval);
+
+      return o;
+    }
+  }
+
+  return allocateUnsampled(t, allocator, type, sizeInBytes, objectMask);
+}
+
 void
 collect(Thread* t, Heap::CollectionType type, int pendingAllocation)
 {
-  ENTER(t, Thread::ExclusiveState);
+  ENTER_EXCLUSIVE(t, "collection");
 
   unsigned pending = pendingAllocation
     - (t->m->heapPoolIndex * ThreadHeapSizeInWords);
 
+  const char* cause;
   if (t->m->heap->limitExceeded(pending)) {
     type = Heap::MajorCollection;
+    cause = "limit";
+  } else if (type == Heap::MajorCollection) {
+    cause = "requested";
+  } else {
+    // the thread heap pool or the fixed-allocation budget ran out
+    cause = "allocation";
   }
 
-  doCollect(t, type, pendingAllocation);
+  t->m->softReferenceAllowance = softReferenceAllowance(t->m);
+
+  doCollect(t, type, pendingAllocation, cause);
 
   if (t->m->heap->limitExceeded(pending)) {
     // try once more, giving the heap a chance to squeeze everything
-    // into the smallest possible space:
-    doCollect(t, Heap::MajorCollection, pendingAllocation);
+    // into the smallest possible space, with every soft reference
+    // cleared:
+    t->m->softReferenceAllowance = -1;
+
+    doCollect(t, Heap::MajorCollection, pendingAllocation, "retry");
   }
 }
 
@@ -3733,6 +6570,12 @@ makeNewGeneral(Thread* t, object class_)
   PROTECT(t, instance);
 
   if (classVmFlags(t, class_) & WeakReferenceFlag) {
+    if ((classVmFlags(t, class_) & SoftReferenceFlag)
+        and t->m->softReferenceClockOffset < 0)
+    {
+      findSoftReferenceClock(t);
+    }
+
     ACQUIRE(t, t->m->referenceLock);
     
     jreferenceVmNext(t, instance) = t->m->weakReferences;
@@ -3803,7 +6646,10 @@ makeString(Thread* t, const char* format, ...)
     va_end(a);
 
     if (s) {
-      return t->m->classpath->makeString(t, s, 0, byteArrayLength(t, s) - 1);
+      // byte-backed strings must be ASCII, so decode anything else
+      s = parseUtf8(t, s);
+      return t->m->classpath->makeString
+        (t, s, 0, fieldAtOffset<uintptr_t>(s, BytesPerWord) - 1);
     } else {
       size *= 2;
     }
@@ -3935,11 +6781,19 @@ isAssignableFrom(Thread* t, object a, object b)
       }
     }
 
+    // code which checks for one interface tends to check for it again
+    // and again, so b remembers the last one found, unless b is in the
+    // boot image (see setCache)
+    if (classSecondarySuper(t, b) == a) {
+      return true;
+    }
+
     object itable = classInterfaceTable(t, b);
     if (itable) {
       unsigned stride = (classFlags(t, b) & ACC_INTERFACE) ? 1 : 2;
       for (unsigned i = 0; i < arrayLength(t, itable); i += stride) {
         if (arrayBody(t, itable, i) == a) {
+          setCache(t, b, ClassSecondarySuper, a);
           return true;
         }
       }
@@ -3952,6 +6806,14 @@ isAssignableFrom(Thread* t, object a, object b)
   } else if ((classVmFlags(t, a) & PrimitiveFlag)
              == (classVmFlags(t, b) & PrimitiveFlag))
   {
+    object aDisplay = classDisplay(t, a);
+    object bDisplay = classDisplay(t, b);
+    if (LIKELY(aDisplay and bDisplay)) {
+      unsigned depth = arrayLength(t, aDisplay) - 1;
+      return depth < arrayLength(t, bDisplay)
+        and arrayBody(t, bDisplay, depth) == a;
+    }
+
     for (; b; b = classSuper(t, b)) {
       if (b == a) {
         return true;
@@ -3962,6 +6824,25 @@ isAssignableFrom(Thread* t, object a, object b)
   return false;
 }
 
+bool
+checkArrayStore(Thread* t, object array, object value)
+{
+  object arrayClass = objectClass(t, array);
+  PROTECT(t, arrayClass);
+
+  object valueClass = objectClass(t, value);
+  PROTECT(t, valueClass);
+
+  if (isAssignableFrom(t, classStaticTable(t, arrayClass), valueClass)) {
+    // stores into one array tend to be of one class, so the next may
+    // pass quickArrayStoreCheck
+    setCache(t, arrayClass, ClassLastStored, valueClass);
+    return true;
+  } else {
+    return false;
+  }
+}
+
 bool
 instanceOf(Thread* t, object class_, object o)
 {
@@ -4070,10 +6951,12 @@ primitiveSize(Thread* t, unsigned code)
 
 object
 parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
-           Machine::Type throwType)
+           Machine::Type throwType, bool lazyReflection)
 {
   PROTECT(t, loader);
 
+  int64_t start = eventStart(t);
+
   class Client: public Stream::Client {
    public:
     Client(Thread* t): t(t) { }
@@ -4122,6 +7005,9 @@ parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
                             0, // static table
                             loader,
                             0, // source
+                            0, // display
+                            0, // secondary super
+                            0, // last stored
                             0);// vtable length
   PROTECT(t, class_);
   
@@ -4135,8 +7021,8 @@ parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
 
     classVmFlags(t, class_)
       |= (classVmFlags(t, sc)
-          & (ReferenceFlag | WeakReferenceFlag | HasFinalizerFlag
-             | NeedInitFlag));
+          & (ReferenceFlag | WeakReferenceFlag | SoftReferenceFlag
+             | HasFinalizerFlag | NeedInitFlag));
   }
 
   if(DebugClassReader) {
@@ -4145,11 +7031,13 @@ parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
   
   parseInterfaceTable(t, s, class_, pool, throwType);
 
-  parseFieldTable(t, s, class_, pool);
+  parseFieldTable(t, s, class_, pool, lazyReflection);
+
+  parseMethodTable(t, s, class_, pool, lazyReflection);
 
-  parseMethodTable(t, s, class_, pool);
+  makeInterfaceHashTable(t, class_, pool);
 
-  parseAttributeTable(t, s, class_, pool);
+  parseAttributeTable(t, s, class_, pool, lazyReflection);
 
   object vtable = classVirtualTable(t, class_);
   unsigned vtableLength = (vtable ? arrayLength(t, vtable) : 0);
@@ -4178,6 +7066,8 @@ parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
 
   t->m->processor->initVtable(t, real);
 
+  makeDisplay(t, real);
+
   updateClassTables(t, real, class_);
 
   if (root(t, Machine::PoolMap)) {
@@ -4190,6 +7080,15 @@ parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
        pool, objectHash);
   }
 
+  AVIAN_PROBE2(class__load,
+               &byteArrayBody(t, className(t, real), 0), size);
+
+  if (start) {
+    recordEvent(t, ClassLoadEvent, start, size, 0,
+                reinterpret_cast<const char*>
+                (&byteArrayBody(t, className(t, real), 0)));
+  }
+
   return real;
 }
 
@@ -4199,9 +7098,11 @@ runParseClass(Thread* t, uintptr_t* arguments)
   object loader = reinterpret_cast<object>(arguments[0]);
   System::Region* region = reinterpret_cast<System::Region*>(arguments[1]);
   Machine::Type throwType = static_cast<Machine::Type>(arguments[2]);
+  bool lazyReflection = arguments[3];
 
   return reinterpret_cast<uintptr_t>
-    (parseClass(t, loader, region->start(), region->length(), throwType));
+    (parseClass(t, loader, region->start(), region->length(), throwType,
+                lazyReflection));
 }
 
 object
@@ -4227,6 +7128,8 @@ resolveSystemClass(Thread* t, object loader, object spec, bool throw_,
       }
     }
 
+    int64_t start = eventStart(t);
+
     if (byteArrayBody(t, spec, 0) == '[') {
       class_ = resolveArrayClass(t, loader, spec, throw_, throwType);
     } else {
@@ -4238,10 +7141,34 @@ resolveSystemClass(Thread* t, object loader, object spec, bool throw_,
              ".class",
              7);
 
+      // finders do their own locking, so release classLock while
+      // reading (and possibly inflating) the class file to let other
+      // threads resolve classes in the meantime.  If this thread
+      // holds classLock recursively, it simply stays held.
+      release(t, t->m->classLock);
+
       System::Region* region = static_cast<Finder*>
         (systemClassLoaderFinder(t, loader))->find
         (RUNTIME_ARRAY_BODY(file));
 
+      if (start) {
+        recordEvent(t, ClassFindEvent, start, region ? region->length() : 0,
+                    0, RUNTIME_ARRAY_BODY(file));
+      }
+
+      acquire(t, t->m->classLock);
+
+      class_ = hashMapFind
+        (t, classLoaderMap(t, loader), spec, byteArrayHash, byteArrayEqual);
+
+      if (class_) {
+        // another thread loaded it while we weren't holding the lock
+        if (region) {
+          region->dispose();
+        }
+        return class_;
+      }
+
       if (region) {
         if (Verbose) {
           fprintf(stderr, "parsing %s\n", &byteArrayBody(t, spec, 0));
@@ -4251,7 +7178,8 @@ resolveSystemClass(Thread* t, object loader, object spec, bool throw_,
 
           uintptr_t arguments[] = { reinterpret_cast<uintptr_t>(loader),
                                     reinterpret_cast<uintptr_t>(region),
-                                    static_cast<uintptr_t>(throwType) };
+                                    static_cast<uintptr_t>(throwType),
+                                    t->m->lazyReflection };
 
           // parse class file
           class_ = reinterpret_cast<object>
@@ -4306,6 +7234,12 @@ resolveSystemClass(Thread* t, object loader, object spec, bool throw_,
       hashMapInsert(t, classLoaderMap(t, loader), spec, class_, byteArrayHash);
 
       t->m->classpath->updatePackageMap(t, class_);
+
+      if (start) {
+        recordEvent(t, ClassResolveEvent, start, 0, 0,
+                    reinterpret_cast<const char*>
+                    (&byteArrayBody(t, spec, 0)));
+      }
     } else if (throw_) {
       throwNew(t, throwType, "%s", &byteArrayBody(t, spec, 0));
     }
@@ -4556,7 +7490,15 @@ initClass(Thread* t, object c)
     if (initializer) {
       Thread::ClassInitStack stack(t, c);
 
+      int64_t start = eventStart(t);
+
       t->m->processor->invoke(t, initializer, 0);
+
+      if (start) {
+        recordEvent(t, ClassInitEvent, start, 0, 0,
+                    reinterpret_cast<const char*>
+                    (&byteArrayBody(t, className(t, c), 0)));
+      }
     }
   }
 }
@@ -4624,6 +7566,34 @@ findFieldInClass(Thread* t, object class_, object name, object spec)
     (t, classFieldTable(t, class_), name, spec, fieldName, fieldSpec);
 }
 
+object
+fieldForOffset(Thread* t, object o, unsigned offset)
+{
+  object c = objectClass(t, o);
+  if (classVmFlags(t, c) & SingletonFlag) {
+    c = singletonObject(t, o, 0);
+    object table = classFieldTable(t, c);
+    if (table) {
+      for (unsigned i = 0; i < objectArrayLength(t, table); ++i) {
+        object field = objectArrayBody(t, table, i);
+        if ((fieldFlags(t, field) & ACC_STATIC)
+            and fieldOffset(t, field) == offset)
+        {
+          return field;
+        }
+      }
+    }
+    abort(t);
+  } else {
+    object field = fieldForOffsetInClass(t, c, offset);
+    if (field) {
+      return field;
+    } else {
+      abort(t);
+    }
+  }
+}
+
 object
 findMethodInClass(Thread* t, object class_, object name, object spec)
 {
@@ -4715,7 +7685,7 @@ objectMonitor(Thread* t, object o, bool createNew)
     PROTECT(t, o);
     PROTECT(t, m);
 
-    { ENTER(t, Thread::ExclusiveState);
+    { ENTER_EXCLUSIVE(t, "monitor inflation");
 
       m = hashMapFind
         (t, root(t, Machine::MonitorMap), o, objectHash, objectEqual);
@@ -4751,11 +7721,17 @@ objectMonitor(Thread* t, object o, bool createNew)
 object
 intern(Thread* t, object s)
 {
+  object n = findInterned
+    (t, root(t, Machine::StringMap), s, stringHash, stringEqual);
+  if (n) {
+    return jreferenceTarget(t, tripleFirst(t, n));
+  }
+
   PROTECT(t, s);
 
   ACQUIRE(t, t->m->referenceLock);
 
-  object n = hashMapFindNode
+  n = hashMapFindNode
     (t, root(t, Machine::StringMap), s, stringHash, stringEqual);
 
   if (n) {
@@ -4831,8 +7807,28 @@ visitRoots(Machine* m, Heap::Visitor* v)
   v->visit(&(m->types));
   v->visit(&(m->roots));
 
+  unsigned count = 0;
   for (Thread* t = m->rootThread; t; t = t->peer) {
-    ::visitRoots(t, v);
+    count += liveThreadCount(t);
+  }
+
+  Thread** threads = static_cast<Thread**>
+    (count > 1 ? m->system->tryAllocate(count * sizeof(Thread*)) : 0);
+
+  if (threads) {
+    Thread** end = threads;
+    for (Thread* t = m->rootThread; t; t = t->peer) {
+      end = listLiveThreads(t, end);
+    }
+
+    ThreadRootGroups groups(threads);
+    m->heap->visitRootGroups(v, &groups, count);
+
+    m->system->free(threads);
+  } else {
+    for (Thread* t = m->rootThread; t; t = t->peer) {
+      ::visitRoots(t, v);
+    }
   }
 
   for (Reference* r = m->jniReferences; r; r = r->next) {
@@ -4976,6 +7972,49 @@ makeTrace(Thread* t, Thread* target)
   return v.trace ? v.trace : makeObjectArray(t, 0);
 }
 
+object
+takeFinalizeBatch(Thread* t, Machine::Root queue, unsigned nextOffset)
+{
+  object first = root(t, queue);
+  if (first == 0) {
+    return 0;
+  }
+
+  object last = first;
+  unsigned count = 1;
+  while (count < FinalizeBatchSize and fieldAtOffset<object>(last, nextOffset))
+  {
+    last = fieldAtOffset<object>(last, nextOffset);
+    ++ count;
+  }
+
+  setRoot(t, queue, fieldAtOffset<object>(last, nextOffset));
+  set(t, last, nextOffset, 0);
+
+  t->m->finalizeBacklog -= count;
+
+  return first;
+}
+
+void
+startFinalizeHelper(Thread* t)
+{
+  object javaThread = t->m->classpath->makeThread(t, t->m->rootThread);
+  threadDaemon(t, javaThread) = true;
+
+  Thread* p = t->m->processor->makeThread(t->m, javaThread, t->m->rootThread);
+  p->flags |= Thread::FinalizerFlag;
+
+  addThread(t, p);
+
+  if (not startThread(t, p)) {
+    removeThread(t, p);
+
+    ACQUIRE(t, t->m->stateLock);
+    -- t->m->finalizeHelperCount;
+  }
+}
+
 void
 runFinalizeThread(Thread* t)
 {
@@ -4986,27 +8025,62 @@ runFinalizeThread(Thread* t)
   PROTECT(t, cleanList);
 
   while (true) {
+    bool startHelper = false;
+    bool memoryPressure = false;
+
     { ACQUIRE(t, t->m->stateLock);
 
       while (t->m->finalizeThread
              and root(t, Machine::ObjectsToFinalize) == 0
-             and root(t, Machine::ObjectsToClean) == 0)
+             and root(t, Machine::ObjectsToClean) == 0
+             and not t->m->memoryPressurePending)
       {
         ENTER(t, Thread::IdleState);
         t->m->stateLock->wait(t->systemThread, 0);
       }
 
       if (t->m->finalizeThread == 0) {
+        if (t->flags & Thread::FinalizerFlag) {
+          -- t->m->finalizeHelperCount;
+          t->m->stateLock->notifyAll(t->systemThread);
+        }
         return;
       } else {
-        finalizeList = root(t, Machine::ObjectsToFinalize);
-        setRoot(t, Machine::ObjectsToFinalize, 0);
+        memoryPressure = t->m->memoryPressurePending;
+        t->m->memoryPressurePending = false;
+
+        finalizeList = takeFinalizeBatch
+          (t, Machine::ObjectsToFinalize, FinalizerQueueNext);
 
-        cleanList = root(t, Machine::ObjectsToClean);
-        setRoot(t, Machine::ObjectsToClean, 0);
+        cleanList = takeFinalizeBatch
+          (t, Machine::ObjectsToClean, CleanerQueueNext);
+
+        if (t->m->finalizeBacklog) {
+          // wake any idle helpers to take the rest, and start another
+          // if we're still allowed to:
+          t->m->stateLock->notifyAll(t->systemThread);
+
+          if (t == t->m->finalizeThread
+              and t->m->finalizeHelperCount + 1 < t->m->finalizeThreadLimit)
+          {
+            ++ t->m->finalizeHelperCount;
+            startHelper = true;
+          }
+        }
       }
     }
 
+    if (startHelper) {
+      startFinalizeHelper(t);
+    }
+
+    if (memoryPressure) {
+      // the handlers may free enough that the next collection needn't
+      // clear many soft references, so they go before the finalizers
+      run(t, invokeMemoryPressureHandlers, 0);
+      t->exception = 0;
+    }
+
     for (; finalizeList; finalizeList = finalizerQueueNext(t, finalizeList)) {
       finalizeObject(t, finalizerQueueTarget(t, finalizeList), "finalize");
     }
@@ -5020,6 +8094,12 @@ runFinalizeThread(Thread* t)
 object
 parseUtf8(Thread* t, const char* data, unsigned length)
 {
+  if (isAscii(reinterpret_cast<const uint8_t*>(data), length)) {
+    object value = makeByteArray(t, length + 1);
+    memcpy(&byteArrayBody(t, value, 0), data, length);
+    return value;
+  }
+
   class Client: public Stream::Client {
    public:
     Client(Thread* t): t(t) { }
@@ -5040,15 +8120,12 @@ parseUtf8(Thread* t, const char* data, unsigned length)
 object
 parseUtf8(Thread* t, object array)
 {
-  for (unsigned i = 0; i < byteArrayLength(t, array) - 1; ++i) {
-    if (byteArrayBody(t, array, i) & 0x80) {
-      goto slow_path;
-    }
+  if (isAscii(reinterpret_cast<const uint8_t*>(&byteArrayBody(t, array, 0)),
+              byteArrayLength(t, array) - 1))
+  {
+    return array;
   }
 
-  return array;
-
- slow_path:
   class Client: public Stream::Client {
    public:
     Client(Thread* t): t(t) { }
@@ -5165,6 +8242,132 @@ defineClass(Thread* t, object loader, const uint8_t* buffer, unsigned length)
   return c;
 }
 
+void
+loadReflectionData(Thread* t, object class_)
+{
+  PROTECT(t, class_);
+
+  ACQUIRE(t, t->m->classLock);
+
+  if ((classVmFlags(t, class_) & LazyReflectionFlag) == 0) {
+    // another thread got here first
+    return;
+  }
+
+  unsigned nameLength = byteArrayLength(t, className(t, class_));
+  THREAD_RUNTIME_ARRAY(t, char, file, nameLength + 6);
+  memcpy(RUNTIME_ARRAY_BODY(file), &byteArrayBody(t, className(t, class_), 0),
+         nameLength - 1);
+  memcpy(RUNTIME_ARRAY_BODY(file) + nameLength - 1, ".class", 7);
+
+  System::Region* region = static_cast<Finder*>
+    (systemClassLoaderFinder(t, classLoader(t, class_)))->find
+    (RUNTIME_ARRAY_BODY(file));
+
+  if (region) {
+    THREAD_RESOURCE(t, System::Region*, region, region->dispose());
+
+    class Client: public Stream::Client {
+     public:
+      Client(Thread* t): t(t) { }
+
+      virtual void NO_RETURN handleError() {
+        abort(t);
+      }
+
+     private:
+      Thread* t;
+    } client(t);
+
+    Stream s(&client, region->start(), region->length());
+
+    s.skip(8); // magic and version
+
+    object pool = parsePool(t, s);
+    PROTECT(t, pool);
+
+    // the class addendum was made with the pool parsed when the class
+    // was, so use that one if nothing has changed since then
+    object addendum = classAddendum(t, class_);
+    if (addendum) {
+      if (not samePool(t, addendumPool(t, addendum), pool)) {
+        // a different class file is found by that name now; leave the
+        // class without reflection data rather than mix them up
+        classVmFlags(t, class_) &= ~LazyReflectionFlag;
+        return;
+      }
+      pool = addendumPool(t, addendum);
+    }
+
+    s.skip(6); // flags, this class and super class
+    s.skip(s.read2() * 2); // interfaces
+
+    object fieldTable = classFieldTable(t, class_);
+    PROTECT(t, fieldTable);
+
+    unsigned fieldCount = s.read2();
+    for (unsigned i = 0; i < fieldCount; ++i) {
+      s.skip(2); // flags
+      object name = singletonObject(t, pool, s.read2() - 1);
+      object spec = singletonObject(t, pool, s.read2() - 1);
+
+      object field = 0;
+      for (unsigned j = 0; fieldTable and j < arrayLength(t, fieldTable);
+           ++j)
+      {
+        object f = arrayBody(t, fieldTable, (i + j) % arrayLength
+                             (t, fieldTable));
+        if (fieldName(t, f) == name and fieldSpec(t, f) == spec) {
+          field = f;
+          break;
+        }
+      }
+      PROTECT(t, field);
+
+      object addendum = parseMemberReflectionAttributes(t, s, pool, false);
+      if (field and addendum) {
+        set(t, field, FieldAddendum, addendum);
+      }
+    }
+
+    object methodTable = classMethodTable(t, class_);
+    PROTECT(t, methodTable);
+
+    unsigned methodCount = s.read2();
+    for (unsigned i = 0; i < methodCount; ++i) {
+      s.skip(2); // flags
+      object name = singletonObject(t, pool, s.read2() - 1);
+      object spec = singletonObject(t, pool, s.read2() - 1);
+
+      object method = 0;
+      for (unsigned j = 0; methodTable and j < arrayLength(t, methodTable);
+           ++j)
+      {
+        object m = arrayBody(t, methodTable, (i + j) % arrayLength
+                             (t, methodTable));
+        if (methodName(t, m) == name and methodSpec(t, m) == spec) {
+          method = m;
+          break;
+        }
+      }
+      PROTECT(t, method);
+
+      object addendum = parseMemberReflectionAttributes(t, s, pool, true);
+      if (method and addendum) {
+        set(t, method, MethodAddendum, addendum);
+      }
+    }
+
+    parseClassReflectionAttributes(t, s, class_, pool);
+  }
+
+  // make the addenda visible before the flag is cleared; see
+  // ensureReflectionData
+  storeStoreMemoryBarrier();
+
+  classVmFlags(t, class_) &= ~LazyReflectionFlag;
+}
+
 void
 populateMultiArray(Thread* t, object array, int32_t* counts,
                    unsigned index, unsigned dimensions)
@@ -5175,27 +8378,42 @@ populateMultiArray(Thread* t, object array, int32_t* counts,
 
   PROTECT(t, array);
 
-  object spec = className(t, objectClass(t, array));
-  PROTECT(t, spec);
-
-  object elementSpec = makeByteArray(t, byteArrayLength(t, spec) - 1);
-  memcpy(&byteArrayBody(t, elementSpec, 0),
-         &byteArrayBody(t, spec, 1),
-         byteArrayLength(t, spec) - 1);
-
-  object class_ = resolveClass
-    (t, classLoader(t,  objectClass(t, array)), elementSpec);
+  // an array class keeps its element class in its static table (see
+  // makeArrayClass), so there's nothing to resolve
+  object class_ = classStaticTable(t, objectClass(t, array));
+  assert(t, class_ and classArrayDimensions(t, class_));
   PROTECT(t, class_);
 
-  for (int32_t i = 0; i < counts[index]; ++i) {
-    object a = makeArray
-      (t, ceilingDivide
-       (counts[index + 1] * classArrayElementSize(t, class_), BytesPerWord));
-    arrayLength(t, a) = counts[index + 1];
-    setObjectClass(t, a, class_);
-    set(t, array, ArrayBody + (i * BytesPerWord), a);
-    
-    populateMultiArray(t, a, counts, index + 1, dimensions);
+  unsigned length = counts[index + 1];
+  unsigned sizeInBytes = ArrayBody + (ceilingDivide
+    (length * classArrayElementSize(t, class_), BytesPerWord) * BytesPerWord);
+  bool objectMask = classObjectMask(t, class_) != 0;
+
+  // as many sub-arrays as fit in a thread heap are allocated at once,
+  // as if one after another, and any larger one by itself
+  unsigned sizeInWords = sizeInBytes / BytesPerWord;
+  unsigned perBlock = sizeInWords <= ThreadHeapSizeInWords
+    ? ThreadHeapSizeInWords / sizeInWords : 1;
+
+  for (unsigned i = 0; i < static_cast<unsigned>(counts[index]);) {
+    unsigned n = min(perBlock, counts[index] - i);
+    uint8_t* block = reinterpret_cast<uint8_t*>
+      (allocate(t, n * sizeInBytes, objectMask));
+
+    unsigned first = i;
+    for (unsigned j = 0; j < n; ++j) {
+      object a = reinterpret_cast<object>(block + (j * sizeInBytes));
+      setObjectClass(t, a, class_);
+      arrayLength(t, a) = length;
+      set(t, array, ArrayBody + ((i++) * BytesPerWord), a);
+    }
+
+    if (index + 2 < dimensions and length) {
+      for (unsigned j = first; j < i; ++j) {
+        populateMultiArray
+          (t, arrayBody(t, array, j), counts, index + 1, dimensions);
+      }
+    }
   }
 }
 
@@ -205,17 +205,102 @@ resolveNativeMethod(Thread* t, object method, const char* prefix,
   return 0;
 }
 
+bool
+primitiveArraySpec(const char* s)
+{
+  if (s[0] != '[') {
+    return false;
+  }
+
+  switch (s[1]) {
+  case 'B': case 'C': case 'D': case 'F':
+  case 'I': case 'J': case 'S': case 'Z':
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+// A static, unsynchronized method whose parameters are all primitives
+// or one-dimensional primitive arrays, and whose result is primitive,
+// may be implemented by a JavaCritical_ function.  Such a function gets
+// no JNIEnv or class argument, and each array is passed as a length
+// followed by a pointer to its elements.  It must not call back into
+// the VM, since the thread stays in the active state while it runs.
+bool
+criticalCandidate(Thread* t, object method)
+{
+  if ((methodFlags(t, method) & ACC_STATIC) == 0
+      or (methodFlags(t, method) & ACC_SYNCHRONIZED)
+      or methodReturnCode(t, method) == ObjectField)
+  {
+    return false;
+  }
+
+  MethodSpecIterator it
+    (t, reinterpret_cast<const char*>
+     (&byteArrayBody(t, methodSpec(t, method), 0)));
+
+  while (it.hasNext()) {
+    const char* s = it.next();
+    if (*s == 'L' or (*s == '[' and not primitiveArraySpec(s))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// size in words of the native arguments of a critical method
+unsigned
+criticalFootprint(Thread* t, object method)
+{
+  unsigned footprint = 0;
+
+  MethodSpecIterator it
+    (t, reinterpret_cast<const char*>
+     (&byteArrayBody(t, methodSpec(t, method), 0)));
+
+  while (it.hasNext()) {
+    switch (*it.next()) {
+    case 'J':
+    case 'D':
+      footprint += 8 / BytesPerWord;
+      break;
+
+    case '[':
+      footprint += 2;
+      break;
+
+    default:
+      ++ footprint;
+      break;
+    }
+  }
+
+  return footprint;
+}
+
 object
 resolveNativeMethod(Thread* t, object method)
 {
   void* p = resolveNativeMethod(t, method, "Avian_", 6, 3);
   if (p) {
-    return makeNative(t, p, true);
+    return makeNative(t, p, true, false);
+  }
+
+  if (criticalCandidate(t, method)) {
+    p = resolveNativeMethod
+      (t, method, "JavaCritical_", 13, criticalFootprint(t, method));
+    if (p) {
+      return makeNative(t, p, false, true);
+    }
   }
 
   p = resolveNativeMethod(t, method, "Java_", 5, -1);
   if (p) {
-    return makeNative(t, p, false);
+    return makeNative(t, p, false, false);
   }
 
   return 0;
@@ -255,6 +340,108 @@ resolveNative(Thread* t, object method)
   } 
 }
 
+uint64_t
+invokeCriticalNative(Thread* t, object method, void* function,
+                     uintptr_t* arguments)
+{
+  unsigned footprint = criticalFootprint(t, method);
+  unsigned count = methodParameterCount(t, method);
+  { MethodSpecIterator it
+      (t, reinterpret_cast<const char*>
+       (&byteArrayBody(t, methodSpec(t, method), 0)));
+
+    while (it.hasNext()) {
+      if (*it.next() == '[') {
+        ++ count;
+      }
+    }
+  }
+
+  THREAD_RUNTIME_ARRAY(t, uintptr_t, args, footprint);
+  unsigned argOffset = 0;
+  THREAD_RUNTIME_ARRAY(t, uint8_t, types, count);
+  unsigned typeOffset = 0;
+
+  uintptr_t* sp = arguments;
+
+  MethodSpecIterator it
+    (t, reinterpret_cast<const char*>
+     (&byteArrayBody(t, methodSpec(t, method), 0)));
+
+  while (it.hasNext()) {
+    const char* s = it.next();
+    unsigned type = fieldType(t, fieldCode(t, *s));
+
+    switch (type) {
+    case INT8_TYPE:
+    case INT16_TYPE:
+    case INT32_TYPE:
+    case FLOAT_TYPE:
+      RUNTIME_ARRAY_BODY(types)[typeOffset++] = type;
+      RUNTIME_ARRAY_BODY(args)[argOffset++] = *(sp++);
+      break;
+
+    case INT64_TYPE:
+    case DOUBLE_TYPE:
+      RUNTIME_ARRAY_BODY(types)[typeOffset++] = type;
+      memcpy(RUNTIME_ARRAY_BODY(args) + argOffset, sp, 8);
+      argOffset += (8 / BytesPerWord);
+      sp += 2;
+      break;
+
+    case POINTER_TYPE: {
+      object array = reinterpret_cast<object>(*(sp++));
+
+      RUNTIME_ARRAY_BODY(types)[typeOffset++] = INT32_TYPE;
+      RUNTIME_ARRAY_BODY(args)[argOffset++] = array
+        ? fieldAtOffset<uintptr_t>(array, BytesPerWord) : 0;
+
+      RUNTIME_ARRAY_BODY(types)[typeOffset++] = POINTER_TYPE;
+      RUNTIME_ARRAY_BODY(args)[argOffset++] = array
+        ? reinterpret_cast<uintptr_t>
+        (reinterpret_cast<uintptr_t*>(array) + 2) : 0;
+    } break;
+
+    default: abort(t);
+    }
+  }
+
+  unsigned returnCode = methodReturnCode(t, method);
+
+  uint64_t result = t->m->system->call
+    (function,
+     RUNTIME_ARRAY_BODY(args),
+     RUNTIME_ARRAY_BODY(types),
+     count,
+     footprint * BytesPerWord,
+     fieldType(t, returnCode));
+
+  switch (returnCode) {
+  case ByteField:
+  case BooleanField:
+    return static_cast<int8_t>(result);
+
+  case CharField:
+    return static_cast<uint16_t>(result);
+
+  case ShortField:
+    return static_cast<int16_t>(result);
+
+  case FloatField:
+  case IntField:
+    return static_cast<int32_t>(result);
+
+  case LongField:
+  case DoubleField:
+    return result;
+
+  case VoidField:
+    return 0;
+
+  default: abort(t);
+  }
+}
+
 int
 findLineNumber(Thread* t, object method, unsigned ip)
 {
@@ -29,6 +29,16 @@ THUNK(negateFloat)
 THUNK(absoluteFloat)
 THUNK(absoluteLong)
 THUNK(absoluteInt)
+THUNK(popCountLong)
+THUNK(popCountInt)
+THUNK(leadingZerosLong)
+THUNK(leadingZerosInt)
+THUNK(trailingZerosLong)
+THUNK(trailingZerosInt)
+THUNK(byteSwapLong)
+THUNK(byteSwapInt)
+THUNK(floorDouble)
+THUNK(ceilingDouble)
 THUNK(divideLong)
 THUNK(divideInt)
 THUNK(moduloLong)
@@ -45,6 +55,18 @@ THUNK(makeBlankObjectArrayFromReference)
 THUNK(makeBlankArray)
 THUNK(lookUpAddress)
 THUNK(setMaybeNull)
+THUNK(setObjectArrayElement)
+THUNK(copyArray)
+THUNK(nanoTime64)
+THUNK(fillByteArray)
+THUNK(fillCharArray)
+THUNK(fillIntArray)
+THUNK(equalStrings)
+THUNK(compareStrings)
+THUNK(indexOfChar)
+THUNK(compareAndSwapInt)
+THUNK(compareAndSwapWord)
+THUNK(compareAndSwapObject)
 THUNK(acquireMonitorForObject)
 THUNK(acquireMonitorForObjectOnEntrance)
 THUNK(releaseMonitorForObject)
@@ -59,14 +81,18 @@ THUNK(setStaticFieldValueFromReference)
 THUNK(setFieldValueFromReference)
 THUNK(setStaticLongFieldValueFromReference)
 THUNK(setLongFieldValueFromReference)
+THUNK(getVolatileWideField)
+THUNK(setVolatileWideField)
 THUNK(setStaticObjectFieldValueFromReference)
 THUNK(setObjectFieldValueFromReference)
 THUNK(instanceOf64)
 THUNK(instanceOfFromReference)
 THUNK(makeNewGeneral64)
 THUNK(makeNew64)
+THUNK(makeNewInitialized64)
 THUNK(makeNewFromReference)
 THUNK(set)
 THUNK(getJClass64)
 THUNK(getJClassFromReference)
 THUNK(gcIfNecessary)
+THUNK(safepoint)
@@ -0,0 +1,474 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include "avian/constants.h"
+#include "avian/target.h"
+
+#include <avian/util/runtime-array.h>
+
+#include <avian/vm/codegen/lir.h>
+#include <avian/vm/codegen/architecture.h>
+#include <avian/vm/codegen/compiler.h>
+
+#include "corpus.h"
+
+using namespace vm;
+
+namespace avian {
+namespace codegen {
+namespace audit {
+
+namespace {
+
+const unsigned MaxNativeCallFootprint = TargetBytesPerWord == 8 ? 4 : 5;
+
+// static int sum(int n) {
+//   int s = 0; for (int i = 0; i < n; ++i) s += i; return s;
+// }
+const uint8_t sumCode[] = {
+  iconst_0, istore_1, iconst_0, istore_2,
+  iload_2, iload_0, if_icmpge, 0, 13,
+  iload_1, iload_2, iadd, istore_1,
+  iinc, 2, 1,
+  goto_, 0xff, 0xf4,
+  iload_1, ireturn
+};
+
+// static long factorial(int n) {
+//   long r = 1; while (n > 1) r *= n--; return r;
+// }
+const uint8_t factorialCode[] = {
+  lconst_1, lstore_1,
+  iload_0, iconst_1, if_icmple, 0, 14,
+  lload_1, iload_0, iinc, 0, 0xff, i2l, lmul, lstore_1,
+  goto_, 0xff, 0xf3,
+  lload_1, lreturn
+};
+
+// static int max(int a, int b) { return a > b ? a : b; }
+const uint8_t maxCode[] = {
+  iload_0, iload_1, if_icmple, 0, 7,
+  iload_0, goto_, 0, 4,
+  iload_1, ireturn
+};
+
+// static int gcd(int a, int b) {
+//   while (b != 0) { int t = a % b; a = b; b = t; } return a;
+// }
+const uint8_t gcdCode[] = {
+  iload_1, ifeq, 0, 14,
+  iload_0, iload_1, irem, istore_2,
+  iload_1, istore_0, iload_2, istore_1,
+  goto_, 0xff, 0xf4,
+  iload_0, ireturn
+};
+
+// static int mix(int x) { return x << 3 ^ x >>> 5 | x & 0xff; }
+const uint8_t mixCode[] = {
+  iload_0, iconst_3, ishl,
+  iload_0, iconst_5, iushr, ixor,
+  iload_0, sipush, 0, 0xff, iand, ior,
+  ireturn
+};
+
+// static double dot(double a, double b, double c, double d) {
+//   return a * c + b * d;
+// }
+const uint8_t dotCode[] = {
+  dload_0, dload, 4, dmul,
+  dload_2, dload, 6, dmul,
+  dadd, dreturn
+};
+
+// static int total(int[] a) {
+//   int s = 0; for (int i = 0; i < a.length; ++i) s += a[i]; return s;
+// }
+const uint8_t totalCode[] = {
+  iconst_0, istore_1, iconst_0, istore_2,
+  iload_2, aload_0, arraylength, if_icmpge, 0, 15,
+  iload_1, aload_0, iload_2, iaload, iadd, istore_1,
+  iinc, 2, 1,
+  goto_, 0xff, 0xf1,
+  iload_1, ireturn
+};
+
+// static void fill(int[] a, int v) {
+//   for (int i = 0; i < a.length; ++i) a[i] = v;
+// }
+const uint8_t fillCode[] = {
+  iconst_0, istore_2,
+  iload_2, aload_0, arraylength, if_icmpge, 0, 13,
+  aload_0, iload_2, iload_1, iastore,
+  iinc, 2, 1,
+  goto_, 0xff, 0xf3,
+  return_
+};
+
+// static int twice(int x) { int y = f(x); return y + x; }
+const uint8_t twiceCode[] = {
+  iload_0, invokestatic, 0, 1, istore_1,
+  iload_1, iload_0, iadd, ireturn
+};
+
+#define METHOD(name, spec, stack, locals) \
+  { #name, spec, stack, locals, sizeof(name##Code), name##Code }
+
+unsigned
+parameterFootprint(const char* spec)
+{
+  unsigned footprint = 0;
+  for (const char* p = spec + 1; *p != ')'; ++p) {
+    switch (*p) {
+    case 'J':
+    case 'D':
+      footprint += 2;
+      break;
+
+    case '[':
+      while (*p == '[') ++ p;
+      if (*p == 'L') while (*p != ';') ++ p;
+      ++ footprint;
+      break;
+
+    case 'L':
+      while (*p != ';') ++ p;
+      ++ footprint;
+      break;
+
+    default:
+      ++ footprint;
+      break;
+    }
+  }
+  return footprint;
+}
+
+Compiler::OperandType
+operandType(char c)
+{
+  switch (c) {
+  case 'L':
+  case '[':
+    return Compiler::ObjectType;
+
+  case 'F':
+  case 'D':
+    return Compiler::FloatType;
+
+  default:
+    return Compiler::IntegerType;
+  }
+}
+
+// a stripped-down version of the translation loop in compile.cpp
+class Translator {
+ public:
+  Translator(Compiler* c, const Method* method, uint8_t* visited,
+             intptr_t thunk):
+    c(c), method(method), visited(visited), thunk(thunk),
+    parameterFootprint(audit::parameterFootprint(method->spec)),
+    leaf(true)
+  { }
+
+  unsigned translateLocalIndex(unsigned footprint, unsigned index) {
+    if (index < parameterFootprint) {
+      return parameterFootprint - index - footprint;
+    } else {
+      return index;
+    }
+  }
+
+  void load(unsigned footprint, unsigned index) {
+    c->push(footprint, c->loadLocal
+            (footprint, translateLocalIndex(footprint, index)));
+  }
+
+  void store(unsigned footprint, unsigned index) {
+    c->storeLocal(footprint, c->pop(footprint),
+                  translateLocalIndex(footprint, index));
+  }
+
+  // the corpus only has small loops, all of which compile.cpp would
+  // align
+  Compiler::Operand* branchTarget(unsigned ip, unsigned newIp) {
+    if (newIp <= ip) {
+      c->markLoopHeader(newIp);
+    }
+
+    return c->promiseConstant(c->machineIp(newIp), Compiler::AddressType);
+  }
+
+  int16_t readInt16(unsigned ip) {
+    return static_cast<int16_t>
+      ((method->code[ip] << 8) | method->code[ip + 1]);
+  }
+
+  void compile(unsigned ip) {
+    while (ip < method->length) {
+      if (visited[ip] ++) {
+        c->visitLogicalIp(ip);
+        return;
+      }
+
+      c->startLogicalIp(ip);
+
+      unsigned instruction = method->code[ip++];
+      switch (instruction) {
+      case iconst_0: case iconst_1: case iconst_2: case iconst_3:
+      case iconst_4: case iconst_5:
+        c->push(1, c->constant(instruction - iconst_0,
+                               Compiler::IntegerType));
+        break;
+
+      case lconst_0: case lconst_1:
+        c->push(2, c->constant(instruction - lconst_0,
+                               Compiler::IntegerType));
+        break;
+
+      case sipush:
+        c->push(1, c->constant(readInt16(ip), Compiler::IntegerType));
+        ip += 2;
+        break;
+
+      case iload: case aload:
+        load(1, method->code[ip++]);
+        break;
+
+      case iload_0: case iload_1: case iload_2: case iload_3:
+        load(1, instruction - iload_0);
+        break;
+
+      case aload_0: case aload_1: case aload_2: case aload_3:
+        load(1, instruction - aload_0);
+        break;
+
+      case lload: case dload:
+        load(2, method->code[ip++]);
+        break;
+
+      case lload_0: case lload_1: case lload_2: case lload_3:
+        load(2, instruction - lload_0);
+        break;
+
+      case dload_0: case dload_1: case dload_2: case dload_3:
+        load(2, instruction - dload_0);
+        break;
+
+      case istore_0: case istore_1: case istore_2: case istore_3:
+        store(1, instruction - istore_0);
+        break;
+
+      case lstore_0: case lstore_1: case lstore_2: case lstore_3:
+        store(2, instruction - lstore_0);
+        break;
+
+      case iinc: {
+        unsigned index = method->code[ip++];
+        int8_t count = method->code[ip++];
+
+        c->storeLocal
+          (1, c->add(4, c->constant(count, Compiler::IntegerType),
+                     c->loadLocal(1, translateLocalIndex(1, index))),
+           translateLocalIndex(1, index));
+      } break;
+
+      case iadd: case isub: case imul: case irem: case iand: case ior:
+      case ixor: case ishl: case ishr: case iushr: {
+        Compiler::Operand* a = c->pop(1);
+        Compiler::Operand* b = c->pop(1);
+        Compiler::Operand* r;
+        switch (instruction) {
+        case iadd: r = c->add(4, a, b); break;
+        case isub: r = c->sub(4, a, b); break;
+        case imul: r = c->mul(4, a, b); break;
+        case irem: r = c->rem(4, a, b); break;
+        case iand: r = c->and_(4, a, b); break;
+        case ior: r = c->or_(4, a, b); break;
+        case ixor: r = c->xor_(4, a, b); break;
+        case ishl: r = c->shl(4, a, b); break;
+        case ishr: r = c->shr(4, a, b); break;
+        default: r = c->ushr(4, a, b); break;
+        }
+        c->push(1, r);
+      } break;
+
+      case lmul: {
+        Compiler::Operand* a = c->pop(2);
+        Compiler::Operand* b = c->pop(2);
+        c->push(2, c->mul(8, a, b));
+      } break;
+
+      case dadd: case dmul: {
+        Compiler::Operand* a = c->pop(2);
+        Compiler::Operand* b = c->pop(2);
+        c->push(2, instruction == dadd
+                ? c->fadd(8, a, b) : c->fmul(8, a, b));
+      } break;
+
+      case i2l:
+        c->push(2, c->load(TargetBytesPerWord, 4, c->pop(1), 8));
+        break;
+
+      case arraylength:
+        c->push(1, c->load
+                (TargetBytesPerWord, TargetBytesPerWord, c->memory
+                 (c->pop(1), Compiler::IntegerType, TargetArrayLength, 0,
+                  1), TargetBytesPerWord));
+        break;
+
+      case iaload: {
+        Compiler::Operand* index = c->pop(1);
+        Compiler::Operand* array = c->pop(1);
+
+        c->checkBounds(array, TargetArrayLength, index, thunk);
+
+        c->push(1, c->load
+                (4, 4, c->memory
+                 (array, Compiler::IntegerType, TargetArrayBody, index, 4),
+                 TargetBytesPerWord));
+      } break;
+
+      case iastore: {
+        Compiler::Operand* value = c->pop(1);
+        Compiler::Operand* index = c->pop(1);
+        Compiler::Operand* array = c->pop(1);
+
+        c->checkBounds(array, TargetArrayLength, index, thunk);
+
+        c->store(TargetBytesPerWord, value, 4, c->memory
+                 (array, Compiler::IntegerType, TargetArrayBody, index, 4));
+      } break;
+
+      case ifeq: case ifne: case if_icmpge: case if_icmple: {
+        unsigned newIp = ip - 1 + readInt16(ip);
+        ip += 2;
+
+        Compiler::Operand* a;
+        Compiler::Operand* b;
+        if (instruction == ifeq or instruction == ifne) {
+          a = c->constant(0, Compiler::IntegerType);
+          b = c->pop(1);
+        } else {
+          a = c->pop(1);
+          b = c->pop(1);
+        }
+
+        Compiler::Operand* target = branchTarget(ip - 3, newIp);
+
+        switch (instruction) {
+        case ifeq: c->jumpIfEqual(4, a, b, target); break;
+        case ifne: c->jumpIfNotEqual(4, a, b, target); break;
+        case if_icmpge: c->jumpIfGreaterOrEqual(4, a, b, target); break;
+        default: c->jumpIfLessOrEqual(4, a, b, target); break;
+        }
+
+        Compiler::State* state = c->saveState();
+        compile(newIp);
+        c->restoreState(state);
+      } break;
+
+      case goto_: {
+        unsigned newIp = ip - 1 + readInt16(ip);
+
+        c->jmp(branchTarget(ip - 1, newIp));
+        ip = newIp;
+      } break;
+
+      case invokestatic: {
+        // every callee in the corpus is of type (I)I
+        leaf = false;
+        ip += 2;
+
+        Compiler::Operand* result = c->stackCall
+          (c->constant(thunk, Compiler::AddressType), 0, 0, 4,
+           Compiler::IntegerType, 1);
+
+        c->popped(1);
+        c->push(1, result);
+      } break;
+
+      case ireturn:
+        c->return_(4, c->pop(1));
+        return;
+
+      case lreturn: case dreturn:
+        c->return_(8, c->pop(2));
+        return;
+
+      case return_:
+        c->return_(0, 0);
+        return;
+
+      default:
+        abort();
+      }
+    }
+  }
+
+  Compiler* c;
+  const Method* method;
+  uint8_t* visited;
+  intptr_t thunk;
+  unsigned parameterFootprint;
+  bool leaf;
+};
+
+} // namespace
+
+const Method corpus[] = {
+  METHOD(sum, "(I)I", 2, 3),
+  METHOD(factorial, "(I)J", 4, 3),
+  METHOD(max, "(II)I", 2, 2),
+  METHOD(gcd, "(II)I", 2, 3),
+  METHOD(mix, "(I)I", 3, 1),
+  METHOD(dot, "(DDDD)D", 4, 8),
+  METHOD(total, "([I)I", 3, 3),
+  METHOD(fill, "([II)V", 3, 3),
+  METHOD(twice, "(I)I", 2, 2)
+};
+
+const unsigned corpusSize = sizeof(corpus) / sizeof(Method);
+
+void
+compileMethod(Architecture* arch, Compiler* c, const Method* method,
+              intptr_t thunk)
+{
+  unsigned footprint = parameterFootprint(method->spec);
+
+  c->init(method->length, footprint, method->maxLocals,
+          arch->alignFrameSize
+          (method->maxLocals - footprint + method->maxStack
+           + arch->frameFootprint(MaxNativeCallFootprint)));
+
+  unsigned index = footprint;
+  for (const char* p = method->spec + 1; *p != ')'; ++p) {
+    if (*p == 'J' or *p == 'D') {
+      index -= 2;
+      c->initLocal(2, index, operandType(*p));
+    } else {
+      -- index;
+      c->initLocal(1, index, operandType(*p));
+      while (*p == '[') ++ p;
+      if (*p == 'L') while (*p != ';') ++ p;
+    }
+  }
+
+  RUNTIME_ARRAY(uint8_t, visited, method->length);
+  memset(RUNTIME_ARRAY_BODY(visited), 0, method->length);
+
+  Translator translator(c, method, RUNTIME_ARRAY_BODY(visited), thunk);
+  translator.compile(0);
+
+  c->compile(translator.leaf ? 0 : thunk, 0);
+}
+
+} // namespace audit
+} // namespace codegen
+} // namespace avian
@@ -0,0 +1,50 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#ifndef AVIAN_TOOLS_AUDIT_CODEGEN_CORPUS_H
+#define AVIAN_TOOLS_AUDIT_CODEGEN_CORPUS_H
+
+#include "avian/common.h"
+
+namespace avian {
+namespace codegen {
+
+class Architecture;
+class Compiler;
+
+namespace audit {
+
+// a static method as javac would compile it, restricted to the
+// opcodes the translator in corpus.cpp understands
+class Method {
+ public:
+  const char* name;
+  const char* spec;
+  unsigned maxStack;
+  unsigned maxLocals;
+  unsigned length;
+  const uint8_t* code;
+};
+
+extern const Method corpus[];
+extern const unsigned corpusSize;
+
+// feeds the bytecode of the specified method to the compiler the same
+// way compile.cpp does, leaving it ready to be resolved.  Every call,
+// including those to thunks, is directed to the specified address.
+void
+compileMethod(Architecture* arch, Compiler* c, const Method* method,
+              intptr_t thunk);
+
+} // namespace audit
+} // namespace codegen
+} // namespace avian
+
+#endif // AVIAN_TOOLS_AUDIT_CODEGEN_CORPUS_H
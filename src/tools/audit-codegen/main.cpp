@@ -14,11 +14,18 @@
 
 #include <avian/vm/codegen/lir.h>
 #include <avian/vm/codegen/assembler.h>
+#include <avian/vm/codegen/architecture.h>
+#include <avian/vm/codegen/compiler.h>
 #include <avian/vm/codegen/targets.h>
 #include <avian/vm/codegen/registers.h>
 
 #include <avian/vm/heap/heap.h>
 
+#include "avian/zone.h"
+#include "avian/target.h"
+
+#include "corpus.h"
+
 // since we aren't linking against libstdc++, we must implement this
 // ourselves:
 extern "C" void __cxa_pure_virtual(void) { abort(); }
@@ -27,6 +34,9 @@ using namespace vm;
 using namespace avian::codegen;
 using namespace avian::util;
 
+const unsigned CodeCapacity = 64 * 1024;
+const unsigned MaxNameLength = 64;
+
 class BasicEnv {
 public:
   System* s;
@@ -35,7 +45,7 @@ public:
 
   BasicEnv():
     s(makeSystem(0)),
-    heap(makeHeap(s, 32 * 1024)),
+    heap(makeHeap(s, 1024 * 1024)),
     arch(makeArchitectureNative(s, true))
   {
     arch->acquire();
@@ -43,74 +53,333 @@ public:
 
   ~BasicEnv() {
     arch->release();
+    heap->dispose();
     s->dispose();
   }
 };
 
-class Asm {
+class Metrics {
 public:
-  Zone zone;
-  Assembler* a;
+  Metrics(): operations(0), spills(0), codeBytes(0), frameBytes(0) { }
 
-  Asm(BasicEnv& env):
-    zone(env.s, env.heap, 8192),
-    a(env.arch->makeAssembler(env.heap, &zone))
+  unsigned operations;
+  unsigned spills;
+  unsigned codeBytes;
+  unsigned frameBytes;
+};
+
+// forwards everything to the native assembler, counting the
+// operations it is asked to emit.  A spill is a move between a
+// register and a slot in the stack frame.
+class AuditAssembler: public Assembler {
+public:
+  AuditAssembler(Assembler* a, Metrics* metrics):
+    a(a), metrics(metrics)
   { }
 
-  ~Asm() {
+  bool isFrameSlot(const OperandInfo& o) {
+    return o.type == lir::MemoryOperand
+      and static_cast<lir::Memory*>(o.operand)->base == a->arch()->stack();
+  }
+
+  bool isSpill(lir::BinaryOperation op, const OperandInfo& a,
+               const OperandInfo& b)
+  {
+    switch (op) {
+    case lir::Move:
+    case lir::MoveLow:
+    case lir::MoveHigh:
+    case lir::MoveZ:
+      return (a.type == lir::RegisterOperand and isFrameSlot(b))
+        or (b.type == lir::RegisterOperand and isFrameSlot(a));
+
+    default:
+      return false;
+    }
+  }
+
+  virtual void setClient(Client* client) {
+    a->setClient(client);
+  }
+
+  virtual Architecture* arch() {
+    return a->arch();
+  }
+
+  virtual void checkStackOverflow(uintptr_t handler,
+                                  unsigned stackLimitOffsetFromThread)
+  {
+    ++ metrics->operations;
+    a->checkStackOverflow(handler, stackLimitOffsetFromThread);
+  }
+
+  virtual void saveFrame(unsigned stackOffset, unsigned ipOffset) {
+    ++ metrics->operations;
+    a->saveFrame(stackOffset, ipOffset);
+  }
+
+  virtual void pushFrame(unsigned, ...) {
+    // only used by thunks, which the corpus does not include
+    abort();
+  }
+
+  virtual void allocateFrame(unsigned footprint) {
+    ++ metrics->operations;
+    metrics->frameBytes = footprint * TargetBytesPerWord;
+    a->allocateFrame(footprint);
+  }
+
+  virtual void adjustFrame(unsigned difference) {
+    ++ metrics->operations;
+    a->adjustFrame(difference);
+  }
+
+  virtual void popFrame(unsigned footprint) {
+    ++ metrics->operations;
+    a->popFrame(footprint);
+  }
+
+  virtual void popFrameForTailCall(unsigned footprint, int offset,
+                                   int returnAddressSurrogate,
+                                   int framePointerSurrogate)
+  {
+    ++ metrics->operations;
+    a->popFrameForTailCall
+      (footprint, offset, returnAddressSurrogate, framePointerSurrogate);
+  }
+
+  virtual void popFrameAndPopArgumentsAndReturn(unsigned frameFootprint,
+                                                unsigned argumentFootprint)
+  {
+    ++ metrics->operations;
+    a->popFrameAndPopArgumentsAndReturn(frameFootprint, argumentFootprint);
+  }
+
+  virtual void popFrameAndUpdateStackAndReturn(unsigned frameFootprint,
+                                               unsigned stackOffsetFromThread)
+  {
+    ++ metrics->operations;
+    a->popFrameAndUpdateStackAndReturn(frameFootprint, stackOffsetFromThread);
+  }
+
+  virtual void apply(lir::Operation op) {
+    ++ metrics->operations;
+    a->apply(op);
+  }
+
+  virtual void apply(lir::UnaryOperation op, OperandInfo a) {
+    ++ metrics->operations;
+    this->a->apply(op, a);
+  }
+
+  virtual void apply(lir::BinaryOperation op, OperandInfo a, OperandInfo b) {
+    ++ metrics->operations;
+    if (isSpill(op, a, b)) {
+      ++ metrics->spills;
+    }
+    this->a->apply(op, a, b);
+  }
+
+  virtual void apply(lir::TernaryOperation op, OperandInfo a, OperandInfo b,
+                     OperandInfo c)
+  {
+    ++ metrics->operations;
+    this->a->apply(op, a, b, c);
+  }
+
+  virtual void setDestination(uint8_t* dst) {
+    a->setDestination(dst);
+  }
+
+  virtual void write() {
+    a->write();
+  }
+
+  virtual Promise* offset(bool forTrace) {
+    return a->offset(forTrace);
+  }
+
+  virtual Block* endBlock(bool startNew) {
+    return a->endBlock(startNew);
+  }
+
+  virtual void endEvent() {
+    a->endEvent();
+  }
+
+  virtual unsigned length() {
+    return a->length();
+  }
+
+  virtual unsigned footerSize() {
+    return a->footerSize();
+  }
+
+  virtual void dispose() {
     a->dispose();
   }
+
+  Assembler* a;
+  Metrics* metrics;
 };
 
-void generateCode(BasicEnv& env) {
-  Asm a(env);
-  for(RegisterIterator it(env.arch->registerFile()->generalRegisters); it.hasNext(); ) {
-    int r = it.next();
-    lir::Register reg(r);
-    a.a->apply(lir::Add,
-      OperandInfo(4, lir::RegisterOperand, &reg),
-      OperandInfo(4, lir::RegisterOperand, &reg),
-      OperandInfo(4, lir::RegisterOperand, &reg));
-  }
-  unsigned length = a.a->endBlock(false)->resolve(0, 0);
-  printf("length: %d\n", length);
-  uint8_t* data = static_cast<uint8_t*>(env.s->tryAllocate(length));
-  a.a->setDestination(data);
-  a.a->write();
-  for(unsigned i = 0; i < length; i++) {
-    printf("%02x ", data[i]);
-  }
-  printf("\n");
-  env.s->free(data);
+// the generated code is never run, so every thunk may share an
+// address, as long as it is within reach of the code
+class AuditClient: public Compiler::Client {
+public:
+  AuditClient(intptr_t thunk): thunk(thunk) { }
+
+  virtual intptr_t getThunk(lir::UnaryOperation, unsigned) {
+    return thunk;
+  }
+
+  virtual intptr_t getThunk(lir::BinaryOperation, unsigned, unsigned) {
+    return thunk;
+  }
+
+  virtual intptr_t getThunk(lir::TernaryOperation, unsigned, unsigned,
+                            bool* threadParameter)
+  {
+    *threadParameter = false;
+    return thunk;
+  }
+
+  intptr_t thunk;
+};
+
+void measure(BasicEnv& env, uint8_t* code, const audit::Method* method,
+           Metrics* metrics)
+{
+  Zone zone(env.s, env.heap, 8192);
+  AuditAssembler assembler
+    (env.arch->makeAssembler(env.heap, &zone), metrics);
+  AuditClient client(reinterpret_cast<intptr_t>(code));
+  Compiler* c = makeCompiler(env.s, &assembler, &zone, &client);
+
+  audit::compileMethod(env.arch, c, method, client.thunk);
+
+  unsigned codeSize = c->resolve(code);
+  unsigned total = pad(codeSize, TargetBytesPerWord) + c->poolSize();
+  expect(env.s, total <= CodeCapacity);
+
+  c->write();
+  metrics->codeBytes = total;
+
+  c->dispose();
+  assembler.dispose();
+}
+
+void report(FILE* out, const audit::Method* method, const Metrics& m) {
+  fprintf(out, "%s %u %u %u %u\n", method->name, m.operations, m.spills,
+          m.codeBytes, m.frameBytes);
+}
+
+bool compare(const char* name, unsigned value, unsigned baseline,
+             const char* method)
+{
+  if (value != baseline) {
+    printf("%s: %s %u -> %u (%+d)\n", method, name, baseline, value,
+           static_cast<int>(value - baseline));
+  }
+  return value <= baseline;
+}
+
+// returns false if any method has regressed relative to the baseline
+bool check(FILE* baseline, const audit::Method* method, const Metrics& m) {
+  char line[256];
+  rewind(baseline);
+  while (fgets(line, sizeof(line), baseline)) {
+    char name[MaxNameLength];
+    Metrics b;
+    if (line[0] != '#'
+        and sscanf(line, "%63s %u %u %u %u", name, &b.operations, &b.spills,
+                   &b.codeBytes, &b.frameBytes) == 5
+        and strcmp(name, method->name) == 0)
+    {
+      bool ok = compare("operations", m.operations, b.operations,
+                        method->name);
+      ok = compare("spills", m.spills, b.spills, method->name) and ok;
+      ok = compare("code bytes", m.codeBytes, b.codeBytes, method->name)
+        and ok;
+      return compare("frame bytes", m.frameBytes, b.frameBytes, method->name)
+        and ok;
+    }
+  }
+
+  printf("%s: missing from baseline\n", method->name);
+  return false;
 }
 
 class Arguments {
 public:
   const char* output;
-  const char* outputFormat;
+  const char* baseline;
 
   Arguments(int argc, char** argv) {
     ArgParser parser;
-    Arg out(parser, true, "output", "<output object file>");
-    Arg format(parser, true, "format", "<format of output object file>");
+    Arg out(parser, true, "output", "<report file>");
+    Arg base(parser, false, "baseline", "<report to compare against>");
 
     if(!parser.parse(argc, argv)) {
+      parser.printUsage(argv[0]);
       exit(1);
     }
 
     output = out.value;
-    outputFormat = format.value;
-
-    // TODO: sanitize format values
+    baseline = base.value;
   }
 };
 
 int main(int argc, char** argv) {
   Arguments args(argc, argv);
 
+  FILE* out = vm::fopen(args.output, "wb");
+  if (out == 0) {
+    fprintf(stderr, "unable to open %s\n", args.output);
+    return -1;
+  }
+
+  FILE* baseline = 0;
+  if (args.baseline) {
+    baseline = vm::fopen(args.baseline, "rb");
+    if (baseline == 0) {
+      fprintf(stderr, "unable to open %s\n", args.baseline);
+      return -1;
+    }
+  }
+
   BasicEnv env;
 
-  generateCode(env);
+  // align the code buffer so that any padding the assembler inserts
+  // does not depend on where the buffer happens to be allocated
+  uint8_t* buffer = static_cast<uint8_t*>
+    (env.s->tryAllocate(CodeCapacity + 64));
+  uint8_t* code = buffer + (64 - (reinterpret_cast<uintptr_t>(buffer) % 64));
+
+  fprintf(out, "# method operations spills code-bytes frame-bytes\n");
+
+  bool ok = true;
+  for (unsigned i = 0; i < audit::corpusSize; ++i) {
+    Metrics metrics;
+    measure(env, code, audit::corpus + i, &metrics);
+    report(out, audit::corpus + i, metrics);
+
+    if (baseline) {
+      ok = check(baseline, audit::corpus + i, metrics) and ok;
+    }
+  }
+
+  env.s->free(buffer);
+  fclose(out);
+
+  if (baseline) {
+    fclose(baseline);
+
+    if (not ok) {
+      printf("code quality has regressed relative to %s\n", args.baseline);
+      return 1;
+    }
+  }
 
   return 0;
-}
\ No newline at end of file
+}
@@ -174,6 +174,44 @@ endsWith(const char* suffix, const char* s, unsigned length)
     and memcmp(suffix, s + (length - suffixLength), suffixLength) == 0;
 }
 
+// appends the instance fields of c in the order the VM laid them
+// out, which need not be declaration order
+object
+appendNonStaticFields(Thread* t, object c, object fields, unsigned* count)
+{
+  PROTECT(t, c);
+  PROTECT(t, fields);
+
+  object table = classFieldTable(t, c);
+  if (table) {
+    unsigned last = 0;
+    while (true) {
+      object next = 0;
+      for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+        object field = arrayBody(t, table, i);
+
+        if ((fieldFlags(t, field) & ACC_STATIC) == 0
+            and fieldOffset(t, field) > last
+            and (next == 0 or fieldOffset(t, field) < fieldOffset(t, next)))
+        {
+          next = field;
+        }
+      }
+
+      if (next == 0) {
+        break;
+      }
+
+      last = fieldOffset(t, next);
+      ++ (*count);
+      fields = vectorAppend(t, fields, next);
+      table = classFieldTable(t, c);
+    }
+  }
+
+  return fields;
+}
+
 object
 getNonStaticFields(Thread* t, object typeMaps, object c, object fields,
                    unsigned* count, object* array)
@@ -193,16 +231,7 @@ getNonStaticFields(Thread* t, object typeMaps, object c, object fields,
         (t, typeMaps, classSuper(t, c), fields, count, array);
     }
 
-    if (classFieldTable(t, c)) {
-      for (unsigned i = 0; i < arrayLength(t, classFieldTable(t, c)); ++i) {
-        object field = arrayBody(t, classFieldTable(t, c), i);
-
-        if ((fieldFlags(t, field) & ACC_STATIC) == 0) {
-          ++ (*count);
-          fields = vectorAppend(t, fields, field);
-        }
-      }
-    }
+    fields = appendNonStaticFields(t, c, fields, count);
   }
 
   return vectorAppend(t, fields, 0);
@@ -236,13 +265,17 @@ allFields(Thread* t, object typeMaps, object c, unsigned* count, object* array)
     for (unsigned i = 0; i < arrayLength(t, classFieldTable(t, c)); ++i) {
       object field = arrayBody(t, classFieldTable(t, c), i);
 
-      if (includeMembers or (fieldFlags(t, field) & ACC_STATIC)) {
+      if (fieldFlags(t, field) & ACC_STATIC) {
         ++ (*count);
         fields = vectorAppend(t, fields, field);
       }
     }
   }
 
+  if (includeMembers) {
+    fields = appendNonStaticFields(t, c, fields, count);
+  }
+
   return fields;
 }
 
@@ -278,13 +311,188 @@ targetFieldOffset(Thread* t, object typeMaps, object field)
     ->targetFixedOffsets()[fieldOffset(t, field)];
 }
 
+// Reads a list of methods, one per line, as written to avian.jit.log
+// by a training run ("<start>,<end> <class>.<name><spec>") or as just
+// "<class>.<name><spec>".  The result is a vector of the names in the
+// order they appear.
+object
+readProfile(Thread* t, FILE* in)
+{
+  object profile = makeVector(t, 0, 0);
+  PROTECT(t, profile);
+
+  char line[4096];
+  while (fgets(line, sizeof(line), in)) {
+    const char* start = strchr(line, ' ');
+    start = start ? start + 1 : line;
+
+    int length = static_cast<int>(strcspn(start, "\r\n"));
+    if (length) {
+      object key = makeByteArray(t, "%.*s", length, start);
+      profile = vectorAppend(t, profile, key);
+    }
+  }
+
+  return profile;
+}
+
+// Returns the node for method in a map built from a profile, or null
+// if the profile doesn't list it.
+object
+profileNode(Thread* t, object profiled, object method)
+{
+  object key = makeByteArray
+    (t, "%s.%s%s",
+     &byteArrayBody(t, className(t, methodClass(t, method)), 0),
+     &byteArrayBody(t, methodName(t, method), 0),
+     &byteArrayBody(t, methodSpec(t, method), 0));
+
+  return hashMapFindNode(t, profiled, key, byteArrayHash, byteArrayEqual);
+}
+
+// Reads a list of class names, one per line, in either internal or
+// dotted form.
+object
+readRoots(Thread* t, FILE* in, object roots)
+{
+  PROTECT(t, roots);
+
+  char line[4096];
+  while (fgets(line, sizeof(line), in)) {
+    int length = static_cast<int>(strcspn(line, "\r\n"));
+    if (length) {
+      for (int i = 0; i < length; ++i) {
+        if (line[i] == '.') {
+          line[i] = '/';
+        }
+      }
+
+      object name = makeByteArray(t, "%.*s", length, line);
+      roots = makePair(t, name, roots);
+    }
+  }
+
+  return roots;
+}
+
+// Returns the name of the class a constant pool entry refers to, with
+// any array dimensions removed, or null if there is none.
+object
+referencedClassName(Thread* t, object o)
+{
+  object name;
+  if (objectClass(t, o) == type(t, Machine::ReferenceType)) {
+    name = referenceClass(t, o) ? referenceClass(t, o) : referenceName(t, o);
+  } else if (objectClass(t, o) == type(t, Machine::ClassType)) {
+    name = className(t, o);
+  } else {
+    return 0;
+  }
+
+  const char* spec = reinterpret_cast<const char*>(&byteArrayBody(t, name, 0));
+  if (*spec != '[') {
+    return name;
+  }
+
+  while (*spec == '[') {
+    ++ spec;
+  }
+
+  if (*spec != 'L') {
+    return 0;
+  }
+
+  return makeByteArray
+    (t, "%.*s", static_cast<int>(strlen(spec)) - 2, spec + 1);
+}
+
+// Returns the set of classes reachable from the named roots through
+// the class references in each class's constant pool (which include
+// its superclass and interfaces), keyed by name.  Classes which can't
+// be found are left out, and will fail to load at runtime if used.
+object
+reachableClasses(Thread* t, object roots)
+{
+  object reached = makeHashMap(t, 0, 0);
+  PROTECT(t, reached);
+
+  object queue = roots;
+  PROTECT(t, queue);
+
+  while (queue) {
+    object name = pairFirst(t, queue);
+    queue = pairSecond(t, queue);
+
+    if (hashMapFind(t, reached, name, byteArrayHash, byteArrayEqual)) {
+      continue;
+    }
+
+    PROTECT(t, name);
+
+    object c = resolveSystemClass
+      (t, root(t, Machine::BootLoader), name, false);
+    if (c == 0) {
+      continue;
+    }
+
+    PROTECT(t, c);
+
+    hashMapInsert(t, reached, name, c, byteArrayHash);
+
+    object pool = hashMapFind
+      (t, root(t, Machine::PoolMap), c, objectHash, objectEqual);
+    if (pool) {
+      PROTECT(t, pool);
+
+      for (unsigned i = 0; i < singletonCount(t, pool); ++i) {
+        if (singletonIsObject(t, pool, i) and singletonObject(t, pool, i)) {
+          object n = referencedClassName(t, singletonObject(t, pool, i));
+          if (n) {
+            queue = makePair(t, n, queue);
+          }
+        }
+      }
+    }
+  }
+
+  return reached;
+}
+
+bool
+includeClass(Thread* t, object reachable, const char* className,
+             const char* name, unsigned nameSize)
+{
+  if (reachable) {
+    object key = makeByteArray
+      (t, "%.*s", static_cast<int>(nameSize) - 6, name);
+    return hashMapFind(t, reachable, key, byteArrayHash, byteArrayEqual) != 0;
+  } else {
+    return className == 0 or strncmp(name, className, nameSize - 6) == 0;
+  }
+}
+
 object
 makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
               const char* className, const char* methodName,
-              const char* methodSpec, object typeMaps)
+              const char* methodSpec, object profile, object reachable,
+              object typeMaps)
 {
+  PROTECT(t, profile);
+  PROTECT(t, reachable);
   PROTECT(t, typeMaps);
 
+  // maps each name in the profile to its method once that is found
+  object profiled = 0;
+  PROTECT(t, profiled);
+
+  if (profile) {
+    profiled = makeHashMap(t, 0, 0);
+    for (unsigned i = 0; i < vectorSize(t, profile); ++i) {
+      hashMapInsert
+        (t, profiled, vectorBody(t, profile, i), 0, byteArrayHash);
+    }
+  }
+
   t->m->classpath->interceptMethods(t);
 
   object constants = 0;
@@ -317,7 +525,7 @@ makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
     const char* name = it.next(&nameSize);
 
     if (endsWith(".class", name, nameSize)
-        and (className == 0 or strncmp(name, className, nameSize - 6) == 0))
+        and includeClass(t, reachable, className, name, nameSize))
     {
       // fprintf(stderr, "pass 1 %.*s\n", nameSize - 6, name);
       object c = resolveSystemClass
@@ -433,11 +641,13 @@ makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
 
         unsigned memberIndex;
         unsigned buildMemberOffset;
+        unsigned buildMemberEnd;
         unsigned targetMemberOffset;
 
         if (array) {
           memberIndex = 0;
           buildMemberOffset = 0;
+          buildMemberEnd = 0;
           targetMemberOffset = 0;
 
           TypeMap* map = reinterpret_cast<TypeMap*>
@@ -448,6 +658,7 @@ makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
 
             RUNTIME_ARRAY_BODY(memberFields)[memberIndex] = *f;
 
+            buildMemberEnd = f->buildOffset + f->buildSize;
             targetMemberOffset = f->targetOffset + f->targetSize;
 
             ++ memberIndex;
@@ -458,6 +669,7 @@ makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
 
           memberIndex = 1;
           buildMemberOffset = BytesPerWord;
+          buildMemberEnd = BytesPerWord;
           targetMemberOffset = TargetBytesPerWord;
         }
 
@@ -531,12 +743,20 @@ makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
 
               ++ staticIndex;
             } else {
+              buildMemberOffset = fieldOffset(t, field);
+
+              // reproduce the padding the VM put around contended fields
+              if (buildMemberOffset
+                  >= buildMemberEnd + ContendedPaddingInBytes)
+              {
+                targetMemberOffset += ContendedPaddingInBytes;
+              }
+              buildMemberEnd = buildMemberOffset + buildSize;
+
               while (targetMemberOffset % targetSize) {
                 ++ targetMemberOffset;
               }
 
-              buildMemberOffset = fieldOffset(t, field);
-
               init(new (RUNTIME_ARRAY_BODY(memberFields) + memberIndex) Field,
                    type, buildMemberOffset, buildSize, targetMemberOffset,
                    targetSize);
@@ -549,6 +769,10 @@ makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
             targetMemberOffset = pad(targetMemberOffset, TargetBytesPerWord);
           }
         }
+
+        if (classFixedSize(t, c) >= buildMemberEnd + ContendedPaddingInBytes) {
+          targetMemberOffset += ContendedPaddingInBytes;
+        }
      
         if (hashMapFind(t, typeMaps, c, objectHash, objectEqual) == 0) {
           object array = makeByteArray
@@ -606,7 +830,7 @@ makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
     const char* name = it.next(&nameSize);
 
     if (endsWith(".class", name, nameSize)
-        and (className == 0 or strncmp(name, className, nameSize - 6) == 0))
+        and includeClass(t, reachable, className, name, nameSize))
     {
       // fprintf(stderr, "pass 2 %.*s\n", nameSize - 6, name);
       object c = resolveSystemClass
@@ -615,10 +839,15 @@ makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
 
       PROTECT(t, c);
 
+      // a method named by -entry only limits what is compiled in the
+      // entry class itself
+      bool entryClass = className
+        and strncmp(name, className, nameSize - 6) == 0;
+
       if (classMethodTable(t, c)) {
         for (unsigned i = 0; i < arrayLength(t, classMethodTable(t, c)); ++i) {
           object method = arrayBody(t, classMethodTable(t, c), i);
-          if (((methodName == 0
+          if (((not entryClass) or ((methodName == 0
                 or ::strcmp
                 (reinterpret_cast<char*>
                  (&byteArrayBody
@@ -628,13 +857,20 @@ makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
                     (reinterpret_cast<char*>
                      (&byteArrayBody
                       (t, vm::methodSpec(t, method), 0)), methodSpec)
-                    == 0)))
+                    == 0))))
           {
-            if (methodCode(t, method)
-                or (methodFlags(t, method) & ACC_NATIVE))
+            PROTECT(t, method);
+
+            if (methodCode(t, method) and profiled) {
+              // compiled below, in profile order; methods left out of
+              // the profile are compiled lazily at runtime instead
+              object node = profileNode(t, profiled, method);
+              if (node) {
+                set(t, node, TripleSecond, method);
+              }
+            } else if (methodCode(t, method)
+                       or (methodFlags(t, method) & ACC_NATIVE))
             {
-              PROTECT(t, method);
-
               t->m->processor->compileMethod
                 (t, zone, &constants, &calls, &addresses, method, &resolver);
 
@@ -673,6 +909,30 @@ makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
     }
   }
 
+  if (profile) {
+    // code is laid out in the order it is compiled, so following the
+    // profile keeps the code which runs at startup together and puts
+    // each method next to the callees it first invoked
+    for (unsigned i = 0; i < vectorSize(t, profile); ++i) {
+      object node = hashMapFindNode
+        (t, profiled, vectorBody(t, profile, i), byteArrayHash,
+         byteArrayEqual);
+
+      object method = tripleSecond(t, node);
+      if (method) {
+        PROTECT(t, method);
+
+        // a name may be listed more than once
+        set(t, node, TripleSecond, 0);
+
+        t->m->processor->compileMethod
+          (t, zone, &constants, &calls, &addresses, method, &resolver);
+
+        methods = makePair(t, method, methods);
+      }
+    }
+  }
+
   for (; calls; calls = tripleThird(t, calls)) {
     object method = tripleFirst(t, calls);
     uintptr_t address;
@@ -1283,6 +1543,7 @@ void
 writeBootImage2(Thread* t, OutputStream* bootimageOutput, OutputStream* codeOutput,
                 BootImage* image, uint8_t* code, const char* className,
                 const char* methodName, const char* methodSpec,
+                FILE* profileInput, FILE* rootsInput,
                 const char* bootimageStart, const char* bootimageEnd,
                 const char* codeimageStart, const char* codeimageEnd,
                 bool useLZMA)
@@ -1475,8 +1736,20 @@ writeBootImage2(Thread* t, OutputStream* bootimageOutput, OutputStream* codeOutp
          objectHash);
     }
 
+    object profile = profileInput ? readProfile(t, profileInput) : 0;
+    PROTECT(t, profile);
+
+    object reachable = 0;
+    if (rootsInput) {
+      object roots = className ? makePair
+        (t, makeByteArray(t, "%s", className), 0) : 0;
+
+      reachable = reachableClasses(t, readRoots(t, rootsInput, roots));
+    }
+
     constants = makeCodeImage
-      (t, &zone, image, code, className, methodName, methodSpec, typeMaps);
+      (t, &zone, image, code, className, methodName, methodSpec, profile,
+       reachable, typeMaps);
 
     PROTECT(t, constants);
 
@@ -1716,11 +1989,13 @@ writeBootImage(Thread* t, uintptr_t* arguments)
   const char* codeimageStart = reinterpret_cast<const char*>(arguments[9]);
   const char* codeimageEnd = reinterpret_cast<const char*>(arguments[10]);
   bool useLZMA = arguments[11];
+  FILE* profileInput = reinterpret_cast<FILE*>(arguments[12]);
+  FILE* rootsInput = reinterpret_cast<FILE*>(arguments[13]);
 
   writeBootImage2
     (t, bootimageOutput, codeOutput, image, code, className, methodName,
-     methodSpec, bootimageStart, bootimageEnd, codeimageStart, codeimageEnd,
-     useLZMA);
+     methodSpec, profileInput, rootsInput, bootimageStart, bootimageEnd,
+     codeimageStart, codeimageEnd, useLZMA);
 
   return 1;
 }
@@ -1746,6 +2021,9 @@ public:
   char* entryMethod;
   char* entrySpec;
 
+  const char* profile;
+  const char* roots;
+
   char* bootimageStart;
   char* bootimageEnd;
 
@@ -1771,6 +2049,8 @@ public:
     entryClass(0),
     entryMethod(0),
     entrySpec(0),
+    profile(0),
+    roots(0),
     bootimageStart(0),
     bootimageEnd(0),
     codeimageStart(0),
@@ -1781,6 +2061,8 @@ public:
     Arg bootimage(parser, true, "bootimage", "<bootimage file>");
     Arg codeimage(parser, true, "codeimage", "<codeimage file>");
     Arg entry(parser, false, "entry", "<class name>[.<method name>[<method spec>]]");
+    Arg profile(parser, false, "profile", "<method list file>");
+    Arg roots(parser, false, "roots", "<class list file>");
     Arg bootimageSymbols(parser, false, "bootimage-symbols", "<start symbol name>:<end symbol name>");
     Arg codeimageSymbols(parser, false, "codeimage-symbols", "<start symbol name>:<end symbol name>");
     Arg useLZMA(parser, false, "use-lzma", 0);
@@ -1794,6 +2076,8 @@ public:
     this->bootimage = bootimage.value;
     this->codeimage = codeimage.value;
     this->useLZMA = useLZMA.value != 0;
+    this->profile = profile.value;
+    this->roots = roots.value;
 
     if(entry.value) {
       if(const char* entryClassEnd = strchr(entry.value, '.')) {
@@ -1867,6 +2151,8 @@ public:
       "entryClass = %s\n"
       "entryMethod = %s\n"
       "entrySpec = %s\n"
+      "profile = %s\n"
+      "roots = %s\n"
       "bootimageStart = %s\n"
       "bootimageEnd = %s\n"
       "codeimageStart = %s\n"
@@ -1877,6 +2163,8 @@ public:
       entryClass,
       entryMethod,
       entrySpec,
+      profile,
+      roots,
       bootimageStart,
       bootimageEnd,
       codeimageStart,
@@ -1916,6 +2204,11 @@ main(int ac, const char** av)
 
   Machine* m = new (h->allocate(sizeof(Machine))) Machine
     (s, h, f, 0, p, c, 0, 0, 0, 0, 128 * 1024);
+
+  // the image is written from the classes as parsed, and its finder
+  // won't be around to read them again at runtime
+  m->lazyReflection = false;
+
   Thread* t = p->makeThread(m, 0, 0);
   
   enter(t, Thread::ActiveState);
@@ -1933,6 +2226,24 @@ main(int ac, const char** av)
     return -1;
   }
 
+  FILE* profileInput = 0;
+  if (args.profile) {
+    profileInput = vm::fopen(args.profile, "rb");
+    if (profileInput == 0) {
+      fprintf(stderr, "unable to open %s\n", args.profile);
+      return -1;
+    }
+  }
+
+  FILE* rootsInput = 0;
+  if (args.roots) {
+    rootsInput = vm::fopen(args.roots, "rb");
+    if (rootsInput == 0) {
+      fprintf(stderr, "unable to open %s\n", args.roots);
+      return -1;
+    }
+  }
+
   uintptr_t arguments[] = {
     reinterpret_cast<uintptr_t>(&bootimageOutput),
     reinterpret_cast<uintptr_t>(&codeOutput),
@@ -1945,11 +2256,21 @@ main(int ac, const char** av)
     reinterpret_cast<uintptr_t>(args.bootimageEnd),
     reinterpret_cast<uintptr_t>(args.codeimageStart),
     reinterpret_cast<uintptr_t>(args.codeimageEnd),
-    static_cast<uintptr_t>(args.useLZMA)
+    static_cast<uintptr_t>(args.useLZMA),
+    reinterpret_cast<uintptr_t>(profileInput),
+    reinterpret_cast<uintptr_t>(rootsInput)
   };
 
   run(t, writeBootImage, arguments);
 
+  if (profileInput) {
+    fclose(profileInput);
+  }
+
+  if (rootsInput) {
+    fclose(rootsInput);
+  }
+
   if (t->exception) {
     printTrace(t, t->exception);
     return -1;
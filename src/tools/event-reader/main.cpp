@@ -0,0 +1,228 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+// Converts a file written by the flight recorder (see
+// src/avian/events.h) to the JSON trace event format read by
+// chrome://tracing and Perfetto, with one complete ("X") event per
+// recorded event, timestamps in microseconds since the earliest one,
+// and threads numbered in order of appearance.
+
+#include "avian/events.h"
+
+using namespace vm;
+
+namespace {
+
+const char* const Categories[] = {
+  "gc",                  // CollectionEvent
+  "gc",                  // CollectionPhaseEvent
+  "compile",             // CompileEvent
+  "class-load",          // ClassLoadEvent
+  "monitor-contention",  // MonitorContentionEvent
+  "exclusive",           // ExclusiveEvent
+  "park",                // ParkEvent
+  "startup",             // StartupEvent
+  "class-load",          // ClassResolveEvent
+  "class-load",          // ClassFindEvent
+  "class-init"           // ClassInitEvent
+};
+
+int
+compareEvents(const void* a, const void* b)
+{
+  const Event* x = static_cast<const Event*>(a);
+  const Event* y = static_cast<const Event*>(b);
+
+  // an event which encloses another starting at the same time comes
+  // first, so viewers nest them properly
+  if (x->time != y->time) {
+    return x->time < y->time ? -1 : 1;
+  } else {
+    return x->duration > y->duration ? -1
+      : (x->duration < y->duration ? 1 : 0);
+  }
+}
+
+void
+writeString(FILE* out, const char* s)
+{
+  fputc('"', out);
+  for (; *s; ++s) {
+    unsigned char c = *s;
+    if (c == '"' or c == '\\') {
+      fprintf(out, "\\%c", c);
+    } else if (c < 0x20) {
+      fprintf(out, "\\u%04x", c);
+    } else {
+      fputc(c, out);
+    }
+  }
+  fputc('"', out);
+}
+
+void
+writeArgs(FILE* out, const Event* e)
+{
+  switch (e->type) {
+  case CollectionEvent:
+    fprintf(out, "\"major\":%s,\"cause\":", e->a ? "true" : "false");
+    writeString(out, e->name);
+    fprintf(out, ",\"heapBytes\":%" LLD, static_cast<int64_t>(e->b));
+    break;
+
+  case CollectionPhaseEvent:
+    fprintf(out, "\"major\":%s", e->a ? "true" : "false");
+    break;
+
+  case CompileEvent:
+    fprintf(out, "\"codeBytes\":%" LLD, static_cast<int64_t>(e->a));
+    break;
+
+  case ClassLoadEvent:
+    fprintf(out, "\"classFileBytes\":%" LLD, static_cast<int64_t>(e->a));
+    break;
+
+  case ExclusiveEvent:
+    fprintf(out, "\"threadsWaitedFor\":%" LLD ",\"waitNanoseconds\":%" LLD,
+            static_cast<int64_t>(e->a), static_cast<int64_t>(e->b));
+    break;
+
+  case ParkEvent:
+    fprintf(out, "\"timeoutNanoseconds\":%" LLD, static_cast<int64_t>(e->a));
+    break;
+
+  case ClassFindEvent:
+    fprintf(out, "\"classFileBytes\":%" LLD, static_cast<int64_t>(e->a));
+    break;
+
+  default:
+    break;
+  }
+}
+
+bool
+convert(FILE* in, FILE* out)
+{
+  EventFileHeader header;
+  if (fread(&header, sizeof(header), 1, in) != 1
+      or header.magic != EventFileMagic)
+  {
+    fprintf(stderr, "not an event file\n");
+    return false;
+  }
+
+  if (header.version != EventFileVersion
+      or header.eventSize != sizeof(Event))
+  {
+    fprintf(stderr, "unsupported event file version %d\n", header.version);
+    return false;
+  }
+
+  Event* events = static_cast<Event*>
+    (malloc((header.eventCount ? header.eventCount : 1) * sizeof(Event)));
+  uint64_t* threads = static_cast<uint64_t*>
+    (malloc((header.eventCount ? header.eventCount : 1) * sizeof(uint64_t)));
+  if (events == 0 or threads == 0) {
+    fprintf(stderr, "out of memory\n");
+    return false;
+  }
+
+  unsigned count = fread(events, sizeof(Event), header.eventCount, in);
+  if (count != header.eventCount) {
+    fprintf(stderr, "warning: expected %d events but found %d\n",
+            header.eventCount, count);
+  }
+
+  qsort(events, count, sizeof(Event), compareEvents);
+
+  unsigned threadCount = 0;
+  bool first = true;
+
+  fprintf(out, "{\"traceEvents\":[");
+  for (unsigned i = 0; i < count; ++i) {
+    const Event* e = events + i;
+    if (e->type >= EventTypeCount) {
+      continue;
+    }
+
+    unsigned thread = 0;
+    while (thread < threadCount and threads[thread] != e->thread) {
+      ++ thread;
+    }
+    if (thread == threadCount) {
+      threads[threadCount++] = e->thread;
+    }
+
+    fprintf(out, "%s\n{\"name\":", first ? "" : ",");
+    first = false;
+    if (e->type == CollectionEvent or e->name[0] == 0) {
+      writeString(out, Categories[e->type]);
+    } else {
+      writeString(out, e->name);
+    }
+
+    fprintf(out, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f"
+            ",\"pid\":1,\"tid\":%d,\"args\":{",
+            Categories[e->type],
+            static_cast<double>(e->time - events[0].time) / 1000,
+            static_cast<double>(e->duration) / 1000,
+            thread + 1);
+    writeArgs(out, e);
+    fprintf(out, "}}");
+  }
+  fprintf(out, "\n]}\n");
+
+  free(threads);
+  free(events);
+
+  return true;
+}
+
+void
+usageAndExit(const char* name)
+{
+  fprintf(stderr, "usage: %s <event file> [<output file>]\n", name);
+  exit(-1);
+}
+
+} // namespace
+
+int
+main(int ac, const char** av)
+{
+  if (ac < 2 or ac > 3) {
+    usageAndExit(av[0]);
+  }
+
+  FILE* in = vm::fopen(av[1], "rb");
+  if (in == 0) {
+    fprintf(stderr, "unable to open %s\n", av[1]);
+    return -1;
+  }
+
+  FILE* out = stdout;
+  if (ac == 3) {
+    out = vm::fopen(av[2], "wb");
+    if (out == 0) {
+      fprintf(stderr, "unable to open %s\n", av[2]);
+      fclose(in);
+      return -1;
+    }
+  }
+
+  bool success = convert(in, out);
+
+  fclose(in);
+  if (out != stdout and fclose(out) != 0) {
+    success = false;
+  }
+
+  return success ? 0 : -1;
+}
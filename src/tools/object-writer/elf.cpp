@@ -49,6 +49,7 @@
 #define EM_386 3
 #define EM_X86_64 62
 #define EM_ARM 40
+#define EM_AARCH64 183
 #define EM_PPC 20
 
 #define SHT_PROGBITS 1
@@ -130,6 +131,8 @@ unsigned getElfPlatform(PlatformInfo::Architecture arch) {
     return EM_386;
   case PlatformInfo::Arm:
     return EM_ARM;
+  case PlatformInfo::Arm64:
+    return EM_AARCH64;
   case PlatformInfo::PowerPC:
     return EM_PPC;
   default:
@@ -377,5 +380,6 @@ ElfPlatform<uint32_t> elfX86Platform(PlatformInfo::x86);
 ElfPlatform<uint32_t> elfArmPlatform(PlatformInfo::Arm);
 ElfPlatform<uint32_t, false> elfPowerPCPlatform(PlatformInfo::PowerPC);
 ElfPlatform<uint64_t> elfX86_64Platform(PlatformInfo::x86_64);
+ElfPlatform<uint64_t> elfArm64Platform(PlatformInfo::Arm64);
 
 } // namespace
@@ -34,11 +34,13 @@
 #define CPU_TYPE_X86_64 (CPU_TYPE_I386 | CPU_ARCH_ABI64)
 #define CPU_TYPE_POWERPC 18
 #define CPU_TYPE_ARM 12
+#define CPU_TYPE_ARM64 (CPU_TYPE_ARM | CPU_ARCH_ABI64)
 
 #define CPU_SUBTYPE_I386_ALL 3
 #define CPU_SUBTYPE_X86_64_ALL CPU_SUBTYPE_I386_ALL
 #define CPU_SUBTYPE_POWERPC_ALL 0
 #define CPU_SUBTYPE_ARM_V7 9 
+#define CPU_SUBTYPE_ARM64_ALL 0
 
 namespace {
 
@@ -161,6 +163,10 @@ public:
       cpuType = CPU_TYPE_ARM;
       cpuSubType = CPU_SUBTYPE_ARM_V7;
       break;
+    case PlatformInfo::Arm64:
+      cpuType = CPU_TYPE_ARM64;
+      cpuSubType = CPU_SUBTYPE_ARM64_ALL;
+      break;
     default:
       // should never happen (see MachOPlatform declarations at bottom)
       fprintf(stderr, "unsupported architecture: %d\n", info.arch);
@@ -295,5 +301,6 @@ MachOPlatform<uint32_t> darwinx86Platform(PlatformInfo::x86);
 MachOPlatform<uint32_t> darwinArmPlatform(PlatformInfo::Arm);
 MachOPlatform<uint32_t, false> darwinPowerPCPlatform(PlatformInfo::PowerPC);
 MachOPlatform<uint64_t> darwinx86_64Platform(PlatformInfo::x86_64);
+MachOPlatform<uint64_t> darwinArm64Platform(PlatformInfo::Arm64);
 
 } // namespace
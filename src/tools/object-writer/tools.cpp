@@ -112,6 +112,8 @@ PlatformInfo::Architecture PlatformInfo::archFromString(const char* arch) {
     return PowerPC;
   } else if(strcmp(arch, "arm") == 0) {
     return Arm;
+  } else if(strcmp(arch, "arm64") == 0) {
+    return Arm64;
   } else {
     return UnknownArch;
   }
@@ -395,7 +395,9 @@ hashMapResize(Thread* t, object map, uint32_t (*hash)(Thread*, object),
       }
     }
   }
-  
+
+  storeStoreMemoryBarrier();
+
   set(t, map, HashMapArray, newArray);
 }
 
@@ -448,6 +450,11 @@ hashMapInsert(Thread* t, object map, object key, object value,
   unsigned index = h & (arrayLength(t, array) - 1);
 
   set(t, n, TripleThird, arrayBody(t, array, index));
+
+  // make sure the node is fully initialized before it becomes visible
+  // to lock-free readers (see intern in machine.cpp)
+  storeStoreMemoryBarrier();
+
   set(t, array, ArrayBody + (index * BytesPerWord), n);
 
   if (hashMapSize(t, map) <= arrayLength(t, array) / 3) {
@@ -512,6 +519,88 @@ hashMapRemove(Thread* t, object map, object key,
   return o;
 }
 
+int
+probeMapFindIndex(Thread* t, object map, object key,
+                  uint32_t (*hash)(Thread*, object),
+                  bool (*equal)(Thread*, object, object))
+{
+  object keys = probeMapKeys(t, map);
+  if (keys) {
+    unsigned mask = arrayLength(t, keys) - 1;
+    for (unsigned i = hash(t, key) & mask; arrayBody(t, keys, i);
+         i = (i + 1) & mask)
+    {
+      if (equal(t, key, arrayBody(t, keys, i))) {
+        return i;
+      }
+    }
+  }
+  return -1;
+}
+
+void
+probeMapResize(Thread* t, object map, uint32_t (*hash)(Thread*, object),
+               unsigned length)
+{
+  PROTECT(t, map);
+
+  object keys = makeArray(t, length);
+  PROTECT(t, keys);
+
+  object values = makeArray(t, length);
+
+  object oldKeys = probeMapKeys(t, map);
+  if (oldKeys) {
+    object oldValues = probeMapValues(t, map);
+    unsigned mask = length - 1;
+    for (unsigned i = 0; i < arrayLength(t, oldKeys); ++i) {
+      object k = arrayBody(t, oldKeys, i);
+      if (k) {
+        unsigned j = hash(t, k) & mask;
+        while (arrayBody(t, keys, j)) {
+          j = (j + 1) & mask;
+        }
+
+        set(t, keys, ArrayBody + (j * BytesPerWord), k);
+        set(t, values, ArrayBody + (j * BytesPerWord),
+            arrayBody(t, oldValues, i));
+      }
+    }
+  }
+
+  set(t, map, ProbeMapKeys, keys);
+  set(t, map, ProbeMapValues, values);
+}
+
+void
+probeMapInsert(Thread* t, object map, object key, object value,
+               uint32_t (*hash)(Thread*, object))
+{
+  object keys = probeMapKeys(t, map);
+
+  // keep the load factor at or below one half so probe sequences stay
+  // short
+  if (keys == 0 or (probeMapSize(t, map) + 1) * 2 > arrayLength(t, keys)) {
+    PROTECT(t, map);
+    PROTECT(t, key);
+    PROTECT(t, value);
+
+    probeMapResize(t, map, hash, keys ? arrayLength(t, keys) * 2 : 16);
+
+    keys = probeMapKeys(t, map);
+  }
+
+  unsigned mask = arrayLength(t, keys) - 1;
+  unsigned i = hash(t, key) & mask;
+  while (arrayBody(t, keys, i)) {
+    i = (i + 1) & mask;
+  }
+
+  set(t, keys, ArrayBody + (i * BytesPerWord), key);
+  set(t, probeMapValues(t, map), ArrayBody + (i * BytesPerWord), value);
+  ++ probeMapSize(t, map);
+}
+
 void
 listAppend(Thread* t, object list, object value)
 {
@@ -15,6 +15,8 @@
 #include "sys/types.h"
 #ifdef __APPLE__
 #  include "CoreFoundation/CoreFoundation.h"
+#  include "mach/mach.h"
+#  include "mach/mach_time.h"
 #  include "sys/ucontext.h"
 #  undef assert
 #elif defined(__ANDROID__)
@@ -44,10 +46,18 @@
 #include "errno.h"
 #include "unistd.h"
 #include "pthread.h"
+#include "limits.h"
 #include "signal.h"
 #include "stdint.h"
 #include "dirent.h"
 #include "sched.h"
+#ifdef __linux__
+#  include <linux/futex.h>
+#  include <sys/syscall.h>
+#  ifndef __ANDROID__
+#    define AVIAN_AFFINITY
+#  endif
+#endif
 #include "avian/arch.h"
 #include <avian/vm/system/system.h>
 
@@ -75,6 +85,45 @@ class MutexResource {
   pthread_mutex_t* m;
 };
 
+// Timed waits on conditions made here measure their deadlines by the
+// monotonic clock where pthreads allows it, so that stepping the wall
+// clock neither cuts them short nor stretches them out.
+void
+initCondition(pthread_cond_t* condition)
+{
+#ifdef __APPLE__
+  pthread_cond_init(condition, 0);
+#else
+  pthread_condattr_t attributes;
+  pthread_condattr_init(&attributes);
+  pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+  pthread_cond_init(condition, &attributes);
+  pthread_condattr_destroy(&attributes);
+#endif
+}
+
+// the absolute time, by the clock initCondition chose, at which a
+// wait of the specified length should end
+timespec
+deadline(int64_t nanoseconds)
+{
+#ifdef __APPLE__
+  timeval tv = { 0, 0 };
+  gettimeofday(&tv, 0);
+  int64_t then = (static_cast<int64_t>(tv.tv_sec) * 1000000000)
+    + (static_cast<int64_t>(tv.tv_usec) * 1000) + nanoseconds;
+#else
+  timespec now = { 0, 0 };
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  int64_t then = (static_cast<int64_t>(now.tv_sec) * 1000000000)
+    + now.tv_nsec + nanoseconds;
+#endif
+
+  timespec ts = { static_cast<time_t>(then / 1000000000),
+                  static_cast<long>(then % 1000000000) };
+  return ts;
+}
+
 const int InvalidSignal = -1;
 const int VisitSignal = SIGUSR1;
 const unsigned VisitSignalIndex = 0;
@@ -92,28 +141,82 @@ const int PipeSignal = SIGPIPE;
 const unsigned PipeSignalIndex = 4;
 const int DivideByZeroSignal = SIGFPE;
 const unsigned DivideByZeroSignalIndex = 5;
+const int QuitSignal = SIGQUIT;
+const unsigned QuitSignalIndex = 6;
 
 const int signals[] = { VisitSignal,
                         SegFaultSignal,
                         InterruptSignal,
                         AltSegFaultSignal,
                         PipeSignal,
-                        DivideByZeroSignal };
+                        DivideByZeroSignal,
+                        QuitSignal };
+
+const unsigned SignalCount = 7;
+
+// the x86 and ARM huge page size; large mappings are rounded up to,
+// and aligned on, multiples of this
+const unsigned LargePageSizeInBytes = 2 * 1024 * 1024;
+
+void*
+mapLarge(unsigned sizeInBytes, int protection, int flags)
+{
+  sizeInBytes = pad(sizeInBytes, LargePageSizeInBytes);
+
+#ifdef MAP_HUGETLB
+  // use explicitly reserved hugetlbfs pages if the administrator has
+  // set any aside.  These must be reserved up front, since touching
+  // an unreserved one raises SIGBUS rather than failing cleanly.
+  void* p = mmap(0, sizeInBytes, protection,
+                 (flags & ~MAP_NORESERVE) | MAP_HUGETLB, -1, 0);
+  if (p != MAP_FAILED) {
+    return p;
+  }
+#endif
 
-const unsigned SignalCount = 6;
+  // otherwise, map an extra large page's worth so we can trim the
+  // region to a large page boundary, which transparent huge pages
+  // require
+  uint8_t* base = static_cast<uint8_t*>
+    (mmap(0, sizeInBytes + LargePageSizeInBytes, protection, flags, -1, 0));
+  if (base == MAP_FAILED) {
+    return 0;
+  }
+
+  uint8_t* start = reinterpret_cast<uint8_t*>
+    ((reinterpret_cast<uintptr_t>(base) + LargePageSizeInBytes - 1)
+     & ~static_cast<uintptr_t>(LargePageSizeInBytes - 1));
+
+  if (start > base) {
+    munmap(base, start - base);
+  }
+
+  uint8_t* end = base + sizeInBytes + LargePageSizeInBytes;
+  if (end > start + sizeInBytes) {
+    munmap(start + sizeInBytes, end - (start + sizeInBytes));
+  }
+
+#ifdef MADV_HUGEPAGE
+  // failure here just means transparent huge pages are unavailable,
+  // in which case we get normal pages
+  madvise(start, sizeInBytes, MADV_HUGEPAGE);
+#endif
+
+  return start;
+}
 
 class MySystem;
 MySystem* system;
 
+// guards the creation and disposal of the system, which every machine
+// in the process shares
+pthread_mutex_t systemMutex = PTHREAD_MUTEX_INITIALIZER;
+
 void
 handleSignal(int signal, siginfo_t* info, void* context);
 
 void*
-run(void* r)
-{
-  static_cast<System::Runnable*>(r)->run();
-  return 0;
-}
+runCarrier(void* c);
 
 void
 pathOfExecutable(System* s, const char** retBuf, unsigned* size)
@@ -142,6 +245,30 @@ pathOfExecutable(System* s, const char** retBuf, unsigned* size)
 const bool Verbose = false;
 
 const unsigned Notified = 1 << 0;
+const unsigned Finished = 1 << 1;
+const unsigned Pinned = 1 << 2;
+
+#ifdef __linux__
+// the values of MPOL_LOCAL and MPOL_MF_MOVE, which older kernel
+// headers lack
+const int LocalMemoryPolicy = 4;
+const unsigned MoveMemoryFlag = 1 << 1;
+#endif
+
+// bounds on how many idle native threads we keep for reuse by
+// System::start, and for how long each waits for work before exiting
+const unsigned MaximumIdleCarriers = 64;
+const int64_t CarrierKeepAliveInNanoseconds = 30LL * 1000 * 1000 * 1000;
+
+// bounds on the number of iterations a contended Monitor::acquire
+// spins before blocking; the actual limit adapts per monitor
+const unsigned MinimumSpinCount = 16;
+const unsigned MaximumSpinCount = 1024;
+
+// values of Thread::parkState
+const uint32_t ParkEmpty = 0;
+const uint32_t ParkPermit = 1;
+const uint32_t ParkWaiting = 2;
 
 class MySystem: public System {
  public:
@@ -151,10 +278,13 @@ class MySystem: public System {
       s(s),
       r(r),
       next(0),
-      flags(0)
+      flags(0),
+      parkState(ParkEmpty),
+      cpuBase(0)
     {
       pthread_mutex_init(&mutex, 0);
-      pthread_cond_init(&condition, 0);
+      initCondition(&condition);
+      initCondition(&joinCondition);
     }
 
     virtual void interrupt() {
@@ -162,6 +292,12 @@ class MySystem: public System {
 
       r->setInterrupted(true);
 
+#ifdef __linux__
+      unpark();
+#else
+      parkState = ParkPermit;
+#endif
+
       pthread_kill(thread, InterruptSignal);
 
       // pthread_kill won't necessarily wake a thread blocked in
@@ -181,24 +317,145 @@ class MySystem: public System {
       return interrupted;
     }
 
+    // the native thread may go on to run other tasks, so we wait for
+    // this one to finish rather than for pthread_join
     virtual void join() {
-      int rv UNUSED = pthread_join(thread, 0);
+      ACQUIRE(mutex);
+
+      while ((flags & Finished) == 0) {
+        int rv UNUSED = pthread_cond_wait(&joinCondition, &mutex);
+        expect(s, rv == 0);
+      }
+    }
+
+    void finish() {
+      ACQUIRE(mutex);
+
+      flags |= Finished;
+
+      int rv UNUSED = pthread_cond_broadcast(&joinCondition);
       expect(s, rv == 0);
     }
 
+#ifdef __linux__
+    // The permit is handed over with a CAS, and we only enter the
+    // kernel when the parker is actually waiting.  FUTEX_WAIT measures
+    // its relative timeout against the monotonic clock, so timeouts
+    // are neither rounded to milliseconds nor affected by changes to
+    // the time of day.
+
+    uint32_t exchangeParkState(uint32_t v) {
+      uint32_t old;
+      do {
+        old = parkState;
+      } while (not atomicCompareAndSwap32(&parkState, old, v));
+      return old;
+    }
+
+    virtual void park(int64_t nanoseconds) {
+      if (atomicCompareAndSwap32(&parkState, ParkPermit, ParkEmpty)) {
+        return;
+      }
+
+      if (atomicCompareAndSwap32(&parkState, ParkEmpty, ParkWaiting)) {
+        timespec ts = { static_cast<time_t>(nanoseconds / 1000000000),
+                        static_cast<long>(nanoseconds % 1000000000) };
+
+        // a spurious return (e.g. EINTR) is permitted by callers
+        syscall(SYS_futex, &parkState, FUTEX_WAIT_PRIVATE, ParkWaiting,
+                nanoseconds > 0 ? &ts : 0, 0, 0);
+      }
+
+      exchangeParkState(ParkEmpty);
+    }
+
+    virtual void unpark() {
+      if (exchangeParkState(ParkPermit) == ParkWaiting) {
+        syscall(SYS_futex, &parkState, FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+      }
+    }
+#else
+    virtual void park(int64_t nanoseconds) {
+      ACQUIRE(mutex);
+
+      if (parkState != ParkPermit) {
+        if (nanoseconds > 0) {
+          timespec ts = deadline(nanoseconds);
+          int rv UNUSED = pthread_cond_timedwait(&condition, &mutex, &ts);
+          expect(s, rv == 0 or rv == ETIMEDOUT or rv == EINTR);
+        } else {
+          int rv UNUSED = pthread_cond_wait(&condition, &mutex);
+          expect(s, rv == 0 or rv == EINTR);
+        }
+      }
+
+      parkState = ParkEmpty;
+    }
+
+    virtual void unpark() {
+      ACQUIRE(mutex);
+
+      parkState = ParkPermit;
+
+      int rv UNUSED = pthread_cond_signal(&condition);
+      expect(s, rv == 0);
+    }
+#endif
+
+    virtual int64_t cpuTime() {
+      int64_t time = carrierCpuTime();
+      return time < 0 ? time : time - cpuBase;
+    }
+
+    // the CPU time used by the native thread, which a carrier may
+    // have spent on earlier tasks
+    int64_t carrierCpuTime() {
+#ifdef __APPLE__
+      thread_basic_info_data_t info;
+      mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+      if (thread_info(pthread_mach_thread_np(thread), THREAD_BASIC_INFO,
+                      reinterpret_cast<thread_info_t>(&info), &count)
+          != KERN_SUCCESS)
+      {
+        return -1;
+      }
+      return ((static_cast<int64_t>(info.user_time.seconds)
+               + info.system_time.seconds) * 1000 * 1000 * 1000)
+        + ((static_cast<int64_t>(info.user_time.microseconds)
+            + info.system_time.microseconds) * 1000);
+#else
+      clockid_t clock;
+      timespec ts;
+      if (pthread_getcpuclockid(thread, &clock) != 0
+          or clock_gettime(clock, &ts) != 0)
+      {
+        return -1;
+      }
+      return (static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000)
+        + ts.tv_nsec;
+#endif
+    }
+
+    virtual bool setAffinity(const unsigned* cpus, unsigned count);
+
     virtual void dispose() {
       pthread_mutex_destroy(&mutex);
       pthread_cond_destroy(&condition);
+      pthread_cond_destroy(&joinCondition);
       ::free(this);
     }
 
     pthread_t thread;
     pthread_mutex_t mutex;
     pthread_cond_t condition;
+    pthread_cond_t joinCondition;
     System* s;
     System::Runnable* r;
     Thread* next;
     unsigned flags;
+    uint32_t parkState;
+    // what carrierCpuTime returned when this thread's task began
+    int64_t cpuBase;
   };
 
   class Mutex: public System::Mutex {
@@ -226,7 +483,10 @@ class MySystem: public System {
 
   class Monitor: public System::Monitor {
    public:
-    Monitor(System* s): s(s), owner_(0), first(0), last(0), depth(0) {
+    Monitor(System* s):
+      s(s), owner_(0), first(0), last(0), depth(0),
+      spinCount(MinimumSpinCount)
+    {
       pthread_mutex_init(&mutex, 0);    
     }
 
@@ -256,12 +516,38 @@ class MySystem: public System {
       Thread* t = static_cast<Thread*>(context);
 
       if (owner_ != t) {
-        pthread_mutex_lock(&mutex);
+        if (pthread_mutex_trylock(&mutex) != 0) {
+          contendedAcquire();
+        }
         owner_ = t;
       }
       ++ depth;
     }
 
+    // Spins briefly before blocking, since critical sections are often
+    // shorter than a context switch.  The spin limit doubles each time
+    // spinning succeeds and halves each time it fails, so monitors held
+    // for long periods (or contended on a uniprocessor) quickly stop
+    // wasting cycles.
+    void contendedAcquire() {
+      unsigned limit = spinCount;
+      for (unsigned i = 0; i < limit; ++i) {
+        spinLoopHint();
+
+        // only try the lock when it looks free, to avoid bouncing its
+        // cache line between spinning processors
+        if (*static_cast<Thread* volatile*>(&owner_) == 0
+            and pthread_mutex_trylock(&mutex) == 0)
+        {
+          spinCount = min(limit * 2, MaximumSpinCount);
+          return;
+        }
+      }
+
+      spinCount = max(limit / 2, MinimumSpinCount);
+      pthread_mutex_lock(&mutex);
+    }
+
     virtual void release(System::Thread* context) {
       Thread* t = static_cast<Thread*>(context);
 
@@ -357,12 +643,10 @@ class MySystem: public System {
           pthread_mutex_unlock(&mutex);
 
           if (not interrupted) {
-            // pretend anything greater than one million years (in
+            // pretend anything greater than one hundred years (in
             // milliseconds) is infinity so as to avoid overflow:
-            if (time and time < INT64_C(31536000000000000)) {
-              int64_t then = s->now() + time;
-              timespec ts = { static_cast<long>(then / 1000),
-                              static_cast<long>((then % 1000) * 1000 * 1000) };
+            if (time and time < INT64_C(3153600000000)) {
+              timespec ts = deadline(time * 1000 * 1000);
               int rv UNUSED = pthread_cond_timedwait
                 (&(t->condition), &(t->mutex), &ts);
               expect(s, rv == 0 or rv == ETIMEDOUT or rv == EINTR);
@@ -383,7 +667,7 @@ class MySystem: public System {
         pthread_mutex_lock(&mutex);
 
         { ACQUIRE(t->mutex);
-          t->flags = 0;
+          t->flags &= ~Notified;
         }
 
         if (not notified) {
@@ -463,6 +747,7 @@ class MySystem: public System {
     Thread* first;
     Thread* last;
     unsigned depth;
+    unsigned spinCount;
   };
 
   class Local: public System::Local {
@@ -599,13 +884,59 @@ class MySystem: public System {
     System::Library* next_;
   };
 
+  // A native thread which runs one Thread after another.  Carriers
+  // started with the default stack size return to the idle list when
+  // their task finishes, so short-lived threads needn't pay for
+  // pthread_create and a fresh stack each time.
+  class Carrier {
+   public:
+    Carrier(MySystem* s, Thread* task, bool reusable):
+      s(s),
+      task(task),
+      next(0),
+      reusable(reusable)
+    {
+      initCondition(&condition);
+    }
+
+    void dispose() {
+      pthread_cond_destroy(&condition);
+      ::free(this);
+    }
+
+    MySystem* s;
+    Thread* task;
+    Carrier* next;
+    pthread_t self;
+    pthread_cond_t condition;
+    bool reusable;
+  };
+
   MySystem():
     threadVisitor(0),
-    visitTarget(0)
+    visitTarget(0),
+    idleCarriers(0),
+    idleCarrierCount(0),
+    returningCarrierCount(0),
+    references(1),
+    disposed(false),
+    bindUnsupported(false)
   {
     expect(this, system == 0);
     system = this;
 
+#ifdef AVIAN_AFFINITY
+    if (sched_getaffinity(0, sizeof(processAffinity), &processAffinity)) {
+      CPU_ZERO(&processAffinity);
+      for (unsigned i = 0; i < CPU_SETSIZE; ++i) {
+        CPU_SET(i, &processAffinity);
+      }
+    }
+#endif
+
+    pthread_mutex_init(&carrierMutex, 0);
+    initCondition(&carrierCondition);
+
     memset(handlers, 0, sizeof(handlers));
 
     registerHandler(&nullHandler, InterruptSignalIndex);
@@ -642,7 +973,43 @@ class MySystem: public System {
     if (p) ::free(const_cast<void*>(p));
   }
 
-  virtual void* tryAllocateExecutable(unsigned sizeInBytes) {
+  virtual void* tryAllocateLarge(unsigned sizeInBytes) {
+    return mapLarge
+      (sizeInBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON);
+  }
+
+  virtual void freeLarge(const void* p, unsigned sizeInBytes) {
+    munmap(const_cast<void*>(p), pad(sizeInBytes, LargePageSizeInBytes));
+  }
+
+  virtual void bindToLocalNode(void* p UNUSED, unsigned sizeInBytes UNUSED) {
+#ifdef __linux__
+    if (bindUnsupported) {
+      return;
+    }
+
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (reinterpret_cast<uintptr_t>(p) + page - 1)
+      & ~(page - 1);
+    uintptr_t end = (reinterpret_cast<uintptr_t>(p) + sizeInBytes)
+      & ~(page - 1);
+
+    // the range is usually part of the malloc heap, so we only bind
+    // the pages nothing else shares
+    if (start < end
+        and syscall(SYS_mbind, start, end - start, LocalMemoryPolicy, 0, 0,
+                    MoveMemoryFlag) != 0
+        and (errno == ENOSYS or errno == EINVAL))
+    {
+      // the kernel was built without NUMA support or predates
+      // MPOL_LOCAL; another thread may also get here, which is harmless
+      bindUnsupported = true;
+    }
+#endif
+  }
+
+  virtual void* tryAllocateExecutable(unsigned sizeInBytes, bool largePages)
+  {
 #ifdef MAP_32BIT
     // map to the lower 32 bits of memory when possible so as to avoid
     // expensive relative jumps
@@ -651,8 +1018,22 @@ class MySystem: public System {
     const unsigned Extra = 0;
 #endif
 
-    void* p = mmap(0, sizeInBytes, PROT_EXEC | PROT_READ | PROT_WRITE,
-                   MAP_PRIVATE | MAP_ANON | Extra, -1, 0);
+#ifdef MAP_NORESERVE
+    // pages are only committed as code is written to them, so don't
+    // charge the whole reservation against the commit limit
+    const unsigned NoReserve = MAP_NORESERVE;
+#else
+    const unsigned NoReserve = 0;
+#endif
+
+    const int protection = PROT_EXEC | PROT_READ | PROT_WRITE;
+    const int flags = MAP_PRIVATE | MAP_ANON | Extra | NoReserve;
+
+    if (largePages) {
+      return mapLarge(sizeInBytes, protection, flags);
+    }
+
+    void* p = mmap(0, sizeInBytes, protection, flags, -1, 0);
 
     if (p == MAP_FAILED) {
       return 0;
@@ -663,8 +1044,11 @@ class MySystem: public System {
     }
   }
 
-  virtual void freeExecutable(const void* p, unsigned sizeInBytes) {
-    munmap(const_cast<void*>(p), sizeInBytes);
+  virtual void freeExecutable(const void* p, unsigned sizeInBytes,
+                              bool largePages)
+  {
+    munmap(const_cast<void*>(p), largePages
+           ? pad(sizeInBytes, LargePageSizeInBytes) : sizeInBytes);
   }
 
   virtual bool success(Status s) {
@@ -678,14 +1062,105 @@ class MySystem: public System {
     return 0;
   }
 
-  virtual Status start(Runnable* r) {
+  virtual Status start(Runnable* r, unsigned stackSizeInBytes) {
     Thread* t = new (allocate(this, sizeof(Thread))) Thread(this, r);
     r->attach(t);
-    int rv UNUSED = pthread_create(&(t->thread), 0, run, r);
+
+    if (stackSizeInBytes == 0) {
+      ACQUIRE(carrierMutex);
+
+      if (idleCarriers) {
+        Carrier* c = idleCarriers;
+        idleCarriers = c->next;
+        -- idleCarrierCount;
+
+        t->thread = c->self;
+        // the carrier is waiting, so its time won't change until the
+        // task starts
+        int64_t base = t->carrierCpuTime();
+        t->cpuBase = base < 0 ? 0 : base;
+        c->task = t;
+
+        int rv UNUSED = pthread_cond_signal(&(c->condition));
+        expect(this, rv == 0);
+        return 0;
+      }
+    }
+
+    // pthreads reserves the stack with mmap and commits pages only as
+    // they are touched, with a guard page below, so a large request
+    // costs address space rather than memory
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    if (stackSizeInBytes) {
+      if (stackSizeInBytes < static_cast<unsigned>(PTHREAD_STACK_MIN)) {
+        stackSizeInBytes = PTHREAD_STACK_MIN;
+      }
+      long page = sysconf(_SC_PAGESIZE);
+      stackSizeInBytes = (stackSizeInBytes + page - 1) & ~(page - 1);
+      pthread_attr_setstacksize(&attributes, stackSizeInBytes);
+    }
+
+    Carrier* c = new (allocate(this, sizeof(Carrier)))
+      Carrier(this, t, stackSizeInBytes == 0);
+
+    int rv UNUSED = pthread_create(&(t->thread), &attributes, runCarrier, c);
+
+    pthread_attr_destroy(&attributes);
+
     expect(this, rv == 0);
     return 0;
   }
 
+  // called by a reusable carrier whose task has finished; returns its
+  // next task, or zero if it should exit
+  Thread* awaitTask(Carrier* c) {
+    ACQUIRE(carrierMutex);
+
+    -- returningCarrierCount;
+    c->task = 0;
+
+    if ((not disposed) and idleCarrierCount < MaximumIdleCarriers) {
+      c->next = idleCarriers;
+      idleCarriers = c;
+      ++ idleCarrierCount;
+
+      timespec ts = deadline(CarrierKeepAliveInNanoseconds);
+
+      while (c->task == 0 and not disposed) {
+        int rv = pthread_cond_timedwait(&(c->condition), &carrierMutex, &ts);
+        expect(this, rv == 0 or rv == ETIMEDOUT or rv == EINTR);
+        if (rv == ETIMEDOUT) {
+          break;
+        }
+      }
+
+      if (c->task == 0) {
+        // nobody claimed us, so we're still on the idle list
+        for (Carrier** p = &idleCarriers; *p; p = &((*p)->next)) {
+          if (*p == c) {
+            *p = c->next;
+            break;
+          }
+        }
+        -- idleCarrierCount;
+      }
+    }
+
+    if (disposed) {
+      int rv UNUSED = pthread_cond_broadcast(&carrierCondition);
+      expect(this, rv == 0);
+    }
+
+    return c->task;
+  }
+
+  void returning() {
+    ACQUIRE(carrierMutex);
+    ++ returningCarrierCount;
+  }
+
   virtual Status make(System::Mutex** m) {
     *m = new (allocate(this, sizeof(Mutex))) Mutex(this);
     return 0;
@@ -713,6 +1188,10 @@ class MySystem: public System {
     return registerHandler(handler, DivideByZeroSignalIndex);
   }
 
+  virtual Status handleQuit(SignalHandler* handler) {
+    return registerHandler(handler, QuitSignalIndex);
+  }
+
   virtual Status visit(System::Thread* st UNUSED, System::Thread* sTarget,
                        ThreadVisitor* visitor)
   {
@@ -922,10 +1401,30 @@ class MySystem: public System {
       (static_cast<int64_t>(tv.tv_usec) / 1000);
   }
 
+  virtual int64_t nanoTime() {
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+      mach_timebase_info(&timebase);
+    }
+    return static_cast<int64_t>
+      (mach_absolute_time() * timebase.numer / timebase.denom);
+#else
+    timespec ts = { 0, 0 };
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (static_cast<int64_t>(ts.tv_sec) * 1000000000) + ts.tv_nsec;
+#endif
+  }
+
   virtual void yield() {
     sched_yield();
   }
 
+  virtual unsigned processorCount() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? count : 1;
+  }
+
   virtual void exit(int code) {
     ::exit(code);
   }
@@ -935,6 +1434,30 @@ class MySystem: public System {
   }
 
   virtual void dispose() {
+    ACQUIRE(systemMutex);
+
+    if (-- references) {
+      return;
+    }
+
+    { ACQUIRE(carrierMutex);
+
+      // wait for idle carriers, and those about to become idle, to
+      // notice we're going away
+      disposed = true;
+
+      for (Carrier* c = idleCarriers; c; c = c->next) {
+        pthread_cond_signal(&(c->condition));
+      }
+
+      while (idleCarriers or returningCarrierCount) {
+        pthread_cond_wait(&carrierCondition, &carrierMutex);
+      }
+    }
+
+    pthread_mutex_destroy(&carrierMutex);
+    pthread_cond_destroy(&carrierCondition);
+
     visitLock->dispose();
 
     registerHandler(0, InterruptSignalIndex);
@@ -955,8 +1478,95 @@ class MySystem: public System {
   ThreadVisitor* threadVisitor;
   Thread* visitTarget;
   System::Monitor* visitLock;
+
+  pthread_mutex_t carrierMutex;
+  pthread_cond_t carrierCondition;
+  Carrier* idleCarriers;
+  unsigned idleCarrierCount;
+  unsigned returningCarrierCount;
+  // the number of machines using the system, guarded by systemMutex
+  unsigned references;
+  bool disposed;
+  // set once the kernel has refused to bind memory to a node
+  bool bindUnsupported;
+#ifdef AVIAN_AFFINITY
+  // the CPUs the process could use when the system was made, which
+  // unpinned threads are given back
+  cpu_set_t processAffinity;
+#endif
 };
 
+bool
+MySystem::Thread::setAffinity(const unsigned* cpus UNUSED,
+                              unsigned count UNUSED)
+{
+#ifdef AVIAN_AFFINITY
+  cpu_set_t set;
+  if (count) {
+    CPU_ZERO(&set);
+    for (unsigned i = 0; i < count; ++i) {
+      if (cpus[i] >= CPU_SETSIZE) {
+        return false;
+      }
+      CPU_SET(cpus[i], &set);
+    }
+  } else {
+    set = static_cast<MySystem*>(s)->processAffinity;
+  }
+
+  ACQUIRE(mutex);
+
+  if ((flags & Finished) or pthread_setaffinity_np(thread, sizeof(set), &set))
+  {
+    return false;
+  }
+
+  if (count) {
+    flags |= Pinned;
+  } else {
+    flags &= ~Pinned;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void*
+runCarrier(void* p)
+{
+  MySystem::Carrier* c = static_cast<MySystem::Carrier*>(p);
+  c->self = pthread_self();
+
+  MySystem::Thread* t = c->task;
+  while (t) {
+    t->r->run();
+
+    if (system != c->s) {
+      // the task was the last VM thread, and it disposed of the system
+      // (and itself) on the way out
+      break;
+    } else if (c->reusable) {
+      if (t->flags & Pinned) {
+        // don't let the next task inherit this one's CPUs
+        t->setAffinity(0, 0);
+      }
+
+      // count ourselves before the task is seen to finish, since the
+      // system may be disposed as soon as it is joined
+      c->s->returning();
+      t->finish();
+      t = c->s->awaitTask(c);
+    } else {
+      t->finish();
+      t = 0;
+    }
+  }
+
+  c->dispose();
+  return 0;
+}
+
 void
 handleSignal(int signal, siginfo_t*, void* context)
 {
@@ -1033,6 +1643,12 @@ handleSignal(int signal, siginfo_t*, void* context)
     index = PipeSignalIndex;
   } break;
 
+  case QuitSignal: {
+    index = QuitSignalIndex;
+
+    system->handlers[index]->handleSignal(&ip, &frame, &stack, &thread);
+  } break;
+
   default: abort();
   }
 
@@ -1040,6 +1656,7 @@ handleSignal(int signal, siginfo_t*, void* context)
   case VisitSignal:
   case InterruptSignal:
   case PipeSignal:
+  case QuitSignal:
     break;
 
   default:
@@ -1047,6 +1664,21 @@ handleSignal(int signal, siginfo_t*, void* context)
   }
 }
 
+System*
+shareSystem()
+{
+  ACQUIRE(systemMutex);
+
+  // signal handlers and carriers belong to the process, so a second
+  // machine gets the system the first made
+  if (system) {
+    ++ system->references;
+    return system;
+  }
+
+  return new (malloc(sizeof(MySystem))) MySystem();
+}
+
 } // namespace
 
 namespace vm {
@@ -1054,7 +1686,7 @@ namespace vm {
 JNIEXPORT System*
 makeSystem(const char*)
 {
-  return new (malloc(sizeof(MySystem))) MySystem();
+  return shareSystem();
 }
 
 } // namespace vm
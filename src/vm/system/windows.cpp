@@ -123,6 +123,30 @@ const unsigned HandlerCount = 2;
 class MySystem;
 MySystem* system;
 
+// guards the creation and disposal of the system, which every machine
+// in the process shares; it is a spin lock since there is no way to
+// initialize a mutex statically which works on every version we
+// support
+volatile LONG systemLock = 0;
+
+void
+acquireSystemLock()
+{
+  while (InterlockedCompareExchange(&systemLock, 1, 0) != 0) {
+#if !defined(WINAPI_FAMILY) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    SwitchToThread();
+#else
+    YieldProcessor();
+#endif
+  }
+}
+
+void
+releaseSystemLock()
+{
+  InterlockedExchange(&systemLock, 0);
+}
+
 #if !defined(WINAPI_FAMILY) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
 LONG CALLBACK
 handleException(LPEXCEPTION_POINTERS e);
@@ -140,6 +164,11 @@ const bool Verbose = false;
 const unsigned Waiting = 1 << 0;
 const unsigned Notified = 1 << 1;
 
+// bounds on the number of iterations a contended Monitor::acquire
+// spins before blocking; the actual limit adapts per monitor
+const unsigned MinimumSpinCount = 16;
+const unsigned MaximumSpinCount = 1024;
+
 class MySystem: public System {
  public:
   class Thread: public System::Thread {
@@ -155,6 +184,10 @@ class MySystem: public System {
 
       event = CreateEvent(0, true, false, 0);
       assert(s, event);
+
+      // auto-reset, so that a signal is consumed by exactly one park
+      parkEvent = CreateEvent(0, false, false, 0);
+      assert(s, parkEvent);
     }
 
     virtual void interrupt() {
@@ -166,6 +199,8 @@ class MySystem: public System {
         int r UNUSED = SetEvent(event);
         assert(s, r != 0);
       }
+
+      unpark();
     }
 
     virtual bool getAndClearInterrupted() {
@@ -183,7 +218,62 @@ class MySystem: public System {
       assert(s, r == WAIT_OBJECT_0);
     }
 
+    virtual void park(int64_t nanoseconds) {
+      // round up so short timeouts don't become zero (i.e. a poll);
+      // the wait is limited to the scheduler's tick in any case
+      DWORD milliseconds = INFINITE;
+      if (nanoseconds > 0) {
+        int64_t m = (nanoseconds + (1000 * 1000) - 1) / (1000 * 1000);
+        if (m < INFINITE) {
+          milliseconds = m;
+        }
+      }
+
+      int r UNUSED = WaitForSingleObject(parkEvent, milliseconds);
+      assert(s, r == WAIT_OBJECT_0 or r == WAIT_TIMEOUT);
+    }
+
+    virtual void unpark() {
+      int r UNUSED = SetEvent(parkEvent);
+      assert(s, r != 0);
+    }
+
+    virtual int64_t cpuTime() {
+      FILETIME creation, exit, kernel, user;
+      if (not GetThreadTimes(thread, &creation, &exit, &kernel, &user)) {
+        return -1;
+      }
+
+      // both times are in units of 100 nanoseconds
+      return ((static_cast<int64_t>(kernel.dwHighDateTime) << 32)
+              + kernel.dwLowDateTime
+              + (static_cast<int64_t>(user.dwHighDateTime) << 32)
+              + user.dwLowDateTime) * 100;
+    }
+
+    virtual bool setAffinity(const unsigned* cpus, unsigned count) {
+      DWORD_PTR mask = 0;
+      if (count) {
+        for (unsigned i = 0; i < count; ++i) {
+          if (cpus[i] >= sizeof(DWORD_PTR) * 8) {
+            return false;
+          }
+          mask |= static_cast<DWORD_PTR>(1) << cpus[i];
+        }
+      } else {
+        DWORD_PTR systemMask;
+        if (not GetProcessAffinityMask(GetCurrentProcess(), &mask,
+                                       &systemMask))
+        {
+          return false;
+        }
+      }
+
+      return SetThreadAffinityMask(thread, mask) != 0;
+    }
+
     virtual void dispose() {
+      CloseHandle(parkEvent);
       CloseHandle(event);
       CloseHandle(mutex);
       CloseHandle(thread);
@@ -193,6 +283,7 @@ class MySystem: public System {
     HANDLE thread;
     HANDLE mutex;
     HANDLE event;
+    HANDLE parkEvent;
     System* s;
     System::Runnable* r;
     Thread* next;
@@ -227,7 +318,10 @@ class MySystem: public System {
 
   class Monitor: public System::Monitor {
    public:
-    Monitor(System* s): s(s), owner_(0), first(0), last(0), depth(0) {
+    Monitor(System* s):
+      s(s), owner_(0), first(0), last(0), depth(0),
+      spinCount(MinimumSpinCount)
+    {
       mutex = CreateMutex(0, false, 0);
       assert(s, mutex);
     }
@@ -260,13 +354,36 @@ class MySystem: public System {
       assert(s, t);
 
       if (owner_ != t) {
-        int r UNUSED = WaitForSingleObject(mutex, INFINITE);
-        assert(s, r == WAIT_OBJECT_0);
+        if (WaitForSingleObject(mutex, 0) != WAIT_OBJECT_0) {
+          contendedAcquire();
+        }
         owner_ = t;
       }
       ++ depth;
     }
 
+    // see the POSIX implementation for details
+    void contendedAcquire() {
+      unsigned limit = spinCount;
+      for (unsigned i = 0; i < limit; ++i) {
+        spinLoopHint();
+
+        if (*static_cast<Thread* volatile*>(&owner_) == 0
+            and WaitForSingleObject(mutex, 0) == WAIT_OBJECT_0)
+        {
+          spinCount = (limit * 2 < MaximumSpinCount
+                       ? limit * 2 : MaximumSpinCount);
+          return;
+        }
+      }
+
+      spinCount = (limit / 2 > MinimumSpinCount
+                   ? limit / 2 : MinimumSpinCount);
+
+      int r UNUSED = WaitForSingleObject(mutex, INFINITE);
+      assert(s, r == WAIT_OBJECT_0);
+    }
+
     virtual void release(System::Thread* context) {
       Thread* t = static_cast<Thread*>(context);
       assert(s, t);
@@ -477,6 +594,7 @@ class MySystem: public System {
     Thread* first;
     Thread* last;
     unsigned depth;
+    unsigned spinCount;
   };
 
   class Local: public System::Local {
@@ -630,7 +748,10 @@ class MySystem: public System {
 #if !defined(WINAPI_FAMILY) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
     oldHandler(0),
 #endif
-    crashDumpDirectory(crashDumpDirectory)
+    crashDumpDirectory(crashDumpDirectory),
+    largePageSize_(0),
+    largePagesChecked(false),
+    references(1)
   {
     expect(this, system == 0);
     system = this;
@@ -696,13 +817,78 @@ class MySystem: public System {
     if (p) ::free(const_cast<void*>(p));
   }
 
+  SIZE_T largePageSize() {
+#if !defined(WINAPI_FAMILY) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    if (not largePagesChecked) {
+      largePagesChecked = true;
+
+      // large pages are only granted to processes holding
+      // SeLockMemoryPrivilege, which must be enabled explicitly
+      HANDLE token;
+      if (OpenProcessToken(GetCurrentProcess(),
+                           TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+      {
+        TOKEN_PRIVILEGES privileges;
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+        if (LookupPrivilegeValue
+            (0, SE_LOCK_MEMORY_NAME, &(privileges.Privileges[0].Luid))
+            and AdjustTokenPrivileges(token, false, &privileges, 0, 0, 0)
+            and GetLastError() == ERROR_SUCCESS)
+        {
+          largePageSize_ = GetLargePageMinimum();
+        }
+
+        CloseHandle(token);
+      }
+    }
+#endif
+
+    return largePageSize_;
+  }
+
+  void* allocateLarge(unsigned sizeInBytes, DWORD protection) {
+#if !defined(WINAPI_FAMILY) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    SIZE_T pageSize = largePageSize();
+    if (pageSize) {
+      void* p = VirtualAlloc
+        (0, (sizeInBytes + pageSize - 1) & ~(pageSize - 1),
+         MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, protection);
+      if (p) {
+        return p;
+      }
+    }
+#endif
+
+    return VirtualAlloc(0, sizeInBytes, MEM_COMMIT | MEM_RESERVE, protection);
+  }
+
+  virtual void* tryAllocateLarge(unsigned sizeInBytes) {
+    return allocateLarge(sizeInBytes, PAGE_READWRITE);
+  }
+
+  virtual void freeLarge(const void* p, unsigned) {
+    int r UNUSED = VirtualFree(const_cast<void*>(p), 0, MEM_RELEASE);
+    assert(this, r);
+  }
+
+  virtual void bindToLocalNode(void*, unsigned) {
+    // Windows only places memory on a node when it is committed
+  }
+
   #if !defined(AVIAN_AOT_ONLY)
-  virtual void* tryAllocateExecutable(unsigned sizeInBytes) {
+  virtual void* tryAllocateExecutable(unsigned sizeInBytes, bool largePages)
+  {
+    if (largePages) {
+      return allocateLarge(sizeInBytes, PAGE_EXECUTE_READWRITE);
+    }
+
     return VirtualAlloc
       (0, sizeInBytes, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
   }
 
-  virtual void freeExecutable(const void* p, unsigned) {
+  virtual void freeExecutable(const void* p, unsigned, bool) {
     int r UNUSED = VirtualFree(const_cast<void*>(p), 0, MEM_RELEASE);
     assert(this, r);
   }
@@ -722,11 +908,13 @@ class MySystem: public System {
     return 0;
   }
 
-  virtual Status start(Runnable* r) {
+  virtual Status start(Runnable* r, unsigned stackSizeInBytes) {
     Thread* t = new (allocate(this, sizeof(Thread))) Thread(this, r);
     r->attach(t);
     DWORD id;
-    t->thread = CreateThread(0, 0, run, r, 0, &id);
+    t->thread = CreateThread
+      (0, stackSizeInBytes, run, r,
+       stackSizeInBytes ? STACK_SIZE_PARAM_IS_A_RESERVATION : 0, &id);
     assert(this, t->thread);
     return 0;
   }
@@ -754,6 +942,11 @@ class MySystem: public System {
     return registerHandler(handler, DivideByZeroIndex);
   }
 
+  virtual Status handleQuit(SignalHandler*) {
+    // there's no SIGQUIT to handle
+    return 1;
+  }
+
   virtual Status visit(System::Thread* st UNUSED, System::Thread* sTarget,
                        ThreadVisitor* visitor)
   {
@@ -995,6 +1188,16 @@ class MySystem: public System {
              | time.dwLowDateTime) / 10000) - 11644473600000LL;
   }
 
+  virtual int64_t nanoTime() {
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return static_cast<int64_t>
+      ((static_cast<double>(counter.QuadPart) * 1000000000.0)
+       / frequency.QuadPart);
+  }
+
   virtual void yield() {
 #if !defined(WINAPI_FAMILY) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
     SwitchToThread();
@@ -1003,6 +1206,12 @@ class MySystem: public System {
 #endif
   }
 
+  virtual unsigned processorCount() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+  }
+
   virtual void exit(int code) {
     ::exit(code);
   }
@@ -1014,9 +1223,15 @@ class MySystem: public System {
   }
 
   virtual void dispose() {
-    system = 0;
-    CloseHandle(mutex);
-    ::free(this);
+    acquireSystemLock();
+
+    if (-- references == 0) {
+      system = 0;
+      CloseHandle(mutex);
+      ::free(this);
+    }
+
+    releaseSystemLock();
   }
 
   HANDLE mutex;
@@ -1025,6 +1240,10 @@ class MySystem: public System {
   LPTOP_LEVEL_EXCEPTION_FILTER oldHandler;
 #endif
   const char* crashDumpDirectory;
+  SIZE_T largePageSize_;
+  bool largePagesChecked;
+  // the number of machines using the system, guarded by systemLock
+  unsigned references;
 };
 
 #if !defined(WINAPI_FAMILY) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
@@ -1145,6 +1364,27 @@ handleException(LPEXCEPTION_POINTERS e)
 
 #endif
 
+System*
+shareSystem(const char* crashDumpDirectory)
+{
+  acquireSystemLock();
+
+  // the exception handlers belong to the process, so a second machine
+  // gets the system the first made, along with its crash dump
+  // directory
+  System* s;
+  if (system) {
+    ++ system->references;
+    s = system;
+  } else {
+    s = new (malloc(sizeof(MySystem))) MySystem(crashDumpDirectory);
+  }
+
+  releaseSystemLock();
+
+  return s;
+}
+
 } // namespace
 
 namespace vm {
@@ -1152,7 +1392,7 @@ namespace vm {
 JNIEXPORT System*
 makeSystem(const char* crashDumpDirectory)
 {
-  return new (malloc(sizeof(MySystem))) MySystem(crashDumpDirectory);
+  return shareSystem(crashDumpDirectory);
 }
 
 } // namespace vm
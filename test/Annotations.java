@@ -27,8 +27,39 @@ public class Annotations {
     Method noAnno = Annotations.class.getMethod("noAnnotation");
     expect(noAnno.getAnnotation(Test.class) == null);
     expect(noAnno.getAnnotations().length == 0);
+
+    Method bar = Annotations.class.getMethod("bar");
+    for (int i = 0; i < 100; ++i) {
+      expect(((Test) m.getAnnotation(Test.class)).value().equals("couscous"));
+      expect(((Test) bar.getAnnotation(Test.class)).value().equals("tagine"));
+    }
+
+    // each of these classes is first reflected on here, so its
+    // annotations may not have been read yet
+    expect(((Test) Pilaf.class.getAnnotation(Test.class)).value()
+           .equals("pilaf"));
+    expect(Pilaf.class.isAnnotationPresent(Test.class));
+
+    expect(Paella.class.getDeclaredAnnotations().length == 1);
+    expect(((TestInteger) Paella.class.getDeclaredAnnotations()[0]).value()
+           == 7);
+
+    expect(Risotto.class.getAnnotations().length == 2);
+
+    expect(Annotations.class.getDeclaredAnnotations().length == 0);
+    expect(Annotations.class.getAnnotation(Test.class) == null);
   }
 
+  @Test("pilaf")
+  private static class Pilaf { }
+
+  @TestInteger(7)
+  private static class Paella { }
+
+  @Test("risotto")
+  @TestEnum(Color.Red)
+  private static class Risotto { }
+
   @Test("couscous")
   @TestEnum(Color.Red)
   @TestInteger(42)
@@ -36,6 +67,11 @@ public class Annotations {
     
   }
   
+  @Test("tagine")
+  public static void bar() {
+
+  }
+
   public static void noAnnotation() {
     
   }
@@ -3,7 +3,199 @@ public class Arrays {
     if (! v) throw new RuntimeException();
   }
 
+  private static void testSort() {
+    java.util.Random random = new java.util.Random(42);
+
+    for (int length = 0; length < 20000; length = length * 3 + 1) {
+      int[] ints = new int[length];
+      long[] longs = new long[length];
+      char[] chars = new char[length];
+      byte[] bytes = new byte[length];
+      for (int i = 0; i < length; ++i) {
+        ints[i] = random.nextInt(length / 2 + 1);
+        longs[i] = random.nextLong();
+        chars[i] = (char) random.nextInt();
+        bytes[i] = (byte) random.nextInt();
+      }
+      int[] parallel = (int[]) ints.clone();
+
+      java.util.Arrays.sort(ints);
+      java.util.Arrays.sort(longs);
+      java.util.Arrays.sort(chars);
+      java.util.Arrays.sort(bytes);
+      java.util.Arrays.parallelSort(parallel);
+      for (int i = 1; i < length; ++i) {
+        expect(ints[i - 1] <= ints[i]);
+        expect(longs[i - 1] <= longs[i]);
+        expect(chars[i - 1] <= chars[i]);
+        expect(bytes[i - 1] <= bytes[i]);
+        expect(parallel[i] == ints[i]);
+      }
+    }
+
+    { double[] a = new double[] { 3.0, Double.NaN, 0.0, -0.0, -1.0, 0.0,
+                                  -0.0 };
+      java.util.Arrays.sort(a);
+      expect(a[0] == -1.0);
+      expect(Double.doubleToRawLongBits(a[1]) < 0);
+      expect(Double.doubleToRawLongBits(a[2]) < 0);
+      expect(a[3] == 0.0 && Double.doubleToRawLongBits(a[3]) == 0);
+      expect(a[4] == 0.0 && Double.doubleToRawLongBits(a[4]) == 0);
+      expect(a[5] == 3.0);
+      expect(a[6] != a[6]);
+    }
+
+    { int[] a = new int[] { 5, 4, 3, 2, 1 };
+      java.util.Arrays.sort(a, 1, 4);
+      expect(a[0] == 5 && a[1] == 2 && a[2] == 3 && a[3] == 4 && a[4] == 1);
+    }
+
+    // sorting objects must be stable
+    int length = 50000;
+    Integer[] keys = new Integer[length];
+    Integer[] values = new Integer[length];
+    for (int i = 0; i < length; ++i) {
+      keys[i] = i;
+      values[i] = random.nextInt(100);
+    }
+    final Integer[] sortBy = values;
+    java.util.Comparator<Integer> comparator
+      = new java.util.Comparator<Integer>() {
+      public int compare(Integer a, Integer b) {
+        return sortBy[a] - sortBy[b];
+      }
+    };
+    Integer[] parallel = (Integer[]) keys.clone();
+    java.util.Arrays.sort(keys, comparator);
+    java.util.Arrays.parallelSort(parallel, comparator);
+    for (int i = 1; i < length; ++i) {
+      expect(values[keys[i - 1]] < values[keys[i]]
+             || (values[keys[i - 1]].equals(values[keys[i]])
+                 && keys[i - 1] < keys[i]));
+      expect(parallel[i].equals(keys[i]));
+    }
+
+    java.util.List<String> list = new java.util.ArrayList<String>();
+    list.add("c");
+    list.add("a");
+    list.add("b");
+    java.util.Collections.sort(list);
+    expect(list.get(0).equals("a"));
+    expect(list.get(1).equals("b"));
+    expect(list.get(2).equals("c"));
+  }
+
+  // counted loops whose bounds checks the JIT may drop
+
+  private static int sumForward(int[] a) {
+    int sum = 0;
+    for (int i = 0; i < a.length; ++i) {
+      sum += a[i];
+    }
+    return sum;
+  }
+
+  private static void fillForward(int[] a) {
+    for (int i = 0; i < a.length; ++i) {
+      a[i] = i;
+    }
+  }
+
+  // the shape ecj gives a for loop, with the test at the bottom, only
+  // arises from class files it compiles; javac gives this one the
+  // same shape as sumForward
+  private static int sumWhile(int[] a) {
+    int sum = 0;
+    int i = 0;
+    while (i < a.length) {
+      sum += a[i];
+      i++;
+    }
+    return sum;
+  }
+
+  // loops which look counted but whose bounds checks must stay,
+  // each overrunning the array
+
+  private static void modifiedIndex(int[] a) {
+    for (int i = 0; i < a.length; ++i) {
+      ++ i;
+      a[i] = 0;
+    }
+  }
+
+  private static void inclusiveBound(int[] a) {
+    for (int i = 0; i <= a.length; ++i) {
+      a[i] = 0;
+    }
+  }
+
+  private static void countingDown(int[] a) {
+    for (int i = 0; i < a.length; --i) {
+      a[i] = 0;
+    }
+  }
+
+  private static void reassignedArray(int[] a) {
+    for (int i = 0; i < a.length; ++i) {
+      if (i == 2) {
+        a = new int[1];
+      }
+      a[i] = 0;
+    }
+  }
+
+  private static void otherIndex(int[] a) {
+    for (int i = 0; i < a.length; ++i) {
+      int j = i + 1;
+      a[j] = 0;
+    }
+  }
+
+  private static void otherArray(int[] a, int[] b) {
+    for (int i = 0; i < a.length; ++i) {
+      b[i] = a[i];
+    }
+  }
+
+  private static void expectOutOfBounds(int which, int[] a) {
+    Exception exception = null;
+    try {
+      switch (which) {
+      case 0: modifiedIndex(a); break;
+      case 1: inclusiveBound(a); break;
+      case 2: countingDown(a); break;
+      case 3: reassignedArray(a); break;
+      case 4: otherIndex(a); break;
+      case 5: otherArray(a, new int[a.length - 1]); break;
+      default: throw new RuntimeException();
+      }
+    } catch (ArrayIndexOutOfBoundsException e) {
+      exception = e;
+    }
+
+    expect(exception != null);
+  }
+
+  private static void testCountedLoops() {
+    int[] a = new int[5];
+    for (int n = 0; n < 4; ++n) {
+      fillForward(a);
+      expect(sumForward(a) == 10);
+      expect(sumWhile(a) == 10);
+      expect(sumForward(new int[0]) == 0);
+
+      for (int which = 0; which < 6; ++which) {
+        expectOutOfBounds(which, a);
+      }
+    }
+  }
+
   public static void main(String[] args) {
+    testSort();
+
+    testCountedLoops();
+
     { int[] array = new int[0];
       Exception exception = null;
       try {
@@ -47,6 +239,35 @@ public class Arrays {
       expect(array[0].length == 3);
     }
 
+    { // rows allocated several at a time, each distinct and zeroed
+      double[][] matrix = new double[100][300];
+      for (int i = 0; i < matrix.length; ++i) {
+        expect(matrix[i].length == 300);
+        expect(matrix[i][0] == 0 && matrix[i][299] == 0);
+        matrix[i][299] = i;
+      }
+      for (int i = 0; i < matrix.length; ++i) {
+        expect(matrix[i][299] == i);
+        expect(i == 0 || matrix[i] != matrix[i - 1]);
+      }
+
+      int[][][] cube = new int[3][4][5];
+      cube[2][3][4] = 42;
+      expect(cube[2].length == 4 && cube[2][3].length == 5);
+      expect(cube[2][3][4] == 42 && cube[1][3][4] == 0);
+
+      // rows too large to share a block
+      long[][] wide = new long[2][20000];
+      wide[1][19999] = 7;
+      expect(wide[0][19999] == 0 && wide[1][19999] == 7);
+
+      Object[][][] empty = new Object[3][0][2];
+      expect(empty[2].length == 0);
+
+      int[][][] partial = new int[2][3][];
+      expect(partial[1].length == 3 && partial[1][2] == null);
+    }
+
     { int j = 0;
       byte[] decodeTable = new byte[256];
       for (int i = 'A'; i <= 'Z'; ++i) decodeTable[i] = (byte) j++;
@@ -94,5 +315,73 @@ public class Arrays {
       java.util.Arrays.hashCode(a);
       java.util.Arrays.hashCode((Object[])null);
     }
+
+    { int[] a = new int[17];
+      java.util.Arrays.fill(a, 42);
+      expect(a[0] == 42);
+      expect(a[16] == 42);
+
+      char[] b = new char[33];
+      java.util.Arrays.fill(b, 'x');
+      expect(b[0] == 'x');
+      expect(b[32] == 'x');
+
+      Exception exception = null;
+      try {
+        java.util.Arrays.fill((int[]) null, 42);
+      } catch (NullPointerException e) {
+        exception = e;
+      }
+
+      expect(exception != null);
+    }
+
+    { int[] a = new int[] { 1, 2, 3, 4, 5 };
+      System.arraycopy(a, 0, a, 1, 4);
+      expect(a[0] == 1);
+      expect(a[1] == 1);
+      expect(a[4] == 4);
+
+      Exception exception = null;
+      try {
+        System.arraycopy(a, 0, a, 2, 4);
+      } catch (IndexOutOfBoundsException e) {
+        exception = e;
+      }
+
+      expect(exception != null);
+    }
+
+    { Object[] a = new Number[4];
+      a[0] = null;
+      a[1] = Integer.valueOf(1);
+      a[2] = Long.valueOf(2);
+      // again, now that the last class allowed is remembered
+      a[3] = Long.valueOf(3);
+      expect(a[1].equals(Integer.valueOf(1)) && a[3].equals(Long.valueOf(3)));
+
+      Exception exception = null;
+      try {
+        a[0] = "not a number";
+      } catch (ArrayStoreException e) {
+        exception = e;
+      }
+
+      expect(exception != null);
+      expect(a[0] == null);
+
+      Object[] b = new Comparable[1];
+      b[0] = "comparable";
+
+      exception = null;
+      try {
+        b[0] = new Object();
+      } catch (ArrayStoreException e) {
+        exception = e;
+      }
+
+      expect(exception != null);
+      expect("comparable".equals(b[0]));
+    }
   }
 }
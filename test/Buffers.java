@@ -37,6 +37,24 @@ public class Buffers {
         for (int i = 0; i < size / 8; ++i)
           expect(b1.getLong(i * 8) ==  0x1234567890ABCDEFL);
 
+        // big-endian order, aligned or not
+        b1.putInt(8, 0x01020304);
+        expect(b1.get(8) == 1 && b1.get(11) == 4);
+        b1.putInt(1, 0x05060708);
+        expect(b1.getInt(1) == 0x05060708);
+        expect(b1.get(1) == 5 && b1.get(4) == 8);
+        b1.putShort(2, (short) 0x0102);
+        expect(b1.get(2) == 1 && b1.getShort(2) == 0x0102);
+
+        // a bulk get advances the position
+        byte[] bytes = new byte[4];
+        b1.get(bytes);
+        expect(b1.position() == 4 && bytes[1] == 5 && bytes[2] == 1);
+        b1.position(0);
+
+        b1.putLong(0, 0x1234567890ABCDEFL);
+        b1.putLong(8, 0x1234567890ABCDEFL);
+
         ByteBuffer b2 = factory2.allocate(size);
         try {
           b2.put(b1);
@@ -1,11 +1,198 @@
 import java.util.Collection;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.IdentityHashMap;
+import java.util.Iterator;
 import java.util.Map;
 
 public class Collections {
   public static void main(String[] args) {
     testValues();
+    testIdentityHashMap();
+    testHashMap();
+    testHashSet();
+  }
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static void testIdentityHashMap() {
+    IdentityHashMap<Object, Integer> map = new IdentityHashMap<Object, Integer>();
+    Object[] keys = new Object[1000];
+    for (int i = 0; i < keys.length; ++i) {
+      keys[i] = new Object();
+      expect(map.put(keys[i], i) == null);
+    }
+
+    // equal but distinct keys are distinct entries
+    String a = new String("x");
+    String b = new String("x");
+    map.put(a, -1);
+    map.put(b, -2);
+    map.put(null, -3);
+    expect(map.size() == keys.length + 3);
+    expect(map.get(a) == -1 && map.get(b) == -2 && map.get(null) == -3);
+
+    for (int i = 0; i < keys.length; i += 2) {
+      expect(map.remove(keys[i]) == i);
+    }
+    for (int i = 0; i < keys.length; ++i) {
+      expect(map.containsKey(keys[i]) == (i % 2 == 1));
+      if (i % 2 == 1) expect(map.get(keys[i]) == i);
+    }
+
+    int count = 0;
+    for (Iterator<Map.Entry<Object, Integer>> it = map.entrySet().iterator();
+         it.hasNext();)
+    {
+      Map.Entry<Object, Integer> e = it.next();
+      expect(map.get(e.getKey()) == e.getValue());
+      if (e.getValue() < 0) {
+        it.remove();
+      }
+      ++ count;
+    }
+    expect(count == (keys.length / 2) + 3);
+    expect(map.size() == keys.length / 2);
+    expect(! map.containsKey(a) && ! map.containsKey(null));
+
+    map.clear();
+    expect(map.isEmpty() && map.get(keys[1]) == null);
   }
   
+  private static class Colliding implements Comparable<Colliding> {
+    private final int value;
+
+    public Colliding(int value) {
+      this.value = value;
+    }
+
+    public int hashCode() {
+      return 42;
+    }
+
+    public boolean equals(Object o) {
+      return o instanceof Colliding && ((Colliding) o).value == value;
+    }
+
+    public int compareTo(Colliding o) {
+      return value < o.value ? -1 : (value > o.value ? 1 : 0);
+    }
+  }
+
+  private static class CollidingObject {
+    private final int value;
+
+    public CollidingObject(int value) {
+      this.value = value;
+    }
+
+    public int hashCode() {
+      return 42;
+    }
+
+    public boolean equals(Object o) {
+      return o instanceof CollidingObject
+        && ((CollidingObject) o).value == value;
+    }
+  }
+
+  private static void testHashMap(Object[] keys, Object[] equalKeys) {
+    HashMap<Object, Integer> map = new HashMap<Object, Integer>();
+    for (int i = 0; i < keys.length; ++i) {
+      expect(map.put(keys[i], i) == null);
+    }
+    map.put(null, -1);
+    expect(map.size() == keys.length + 1);
+
+    for (int i = 0; i < keys.length; ++i) {
+      expect(map.get(equalKeys[i]) == i);
+    }
+    expect(map.get(null) == -1);
+
+    for (int i = 0; i < keys.length; i += 3) {
+      expect(map.remove(equalKeys[i]) == i);
+    }
+    for (int i = 0; i < keys.length; ++i) {
+      expect(map.containsKey(keys[i]) == (i % 3 != 0));
+    }
+
+    int count = 0;
+    for (Iterator<Map.Entry<Object, Integer>> it = map.entrySet().iterator();
+         it.hasNext();)
+    {
+      Map.Entry<Object, Integer> e = it.next();
+      expect(map.get(e.getKey()) == e.getValue());
+      if (e.getValue() % 2 == 0) {
+        it.remove();
+      }
+      ++ count;
+    }
+    expect(count == keys.length - ((keys.length + 2) / 3) + 1);
+    for (int i = 0; i < keys.length; ++i) {
+      expect(map.containsKey(equalKeys[i]) == (i % 3 != 0 && i % 2 != 0));
+    }
+    expect(map.containsKey(null));
+
+    map.clear();
+    expect(map.isEmpty() && map.get(keys[1]) == null);
+  }
+
+  private static void testHashMap() {
+    Object[] keys = new Object[300];
+    Object[] equalKeys = new Object[keys.length];
+
+    for (int i = 0; i < keys.length; ++i) {
+      keys[i] = new Integer(i * 1024);
+      equalKeys[i] = new Integer(i * 1024);
+    }
+    testHashMap(keys, equalKeys);
+
+    // keys which all share a hash code, compared naturally or not
+    for (int i = 0; i < keys.length; ++i) {
+      keys[i] = new Colliding(i);
+      equalKeys[i] = new Colliding(i);
+    }
+    testHashMap(keys, equalKeys);
+
+    for (int i = 0; i < keys.length; ++i) {
+      keys[i] = new CollidingObject(i);
+      equalKeys[i] = new CollidingObject(i);
+    }
+    testHashMap(keys, equalKeys);
+  }
+
+  private static void testHashSet() {
+    HashSet<Integer> set = new HashSet<Integer>();
+    for (int i = 0; i < 1000; ++i) {
+      expect(set.add(i));
+    }
+    expect(! set.add(7));
+    expect(set.add(null) && set.contains(null));
+    expect(set.size() == 1001);
+
+    for (int i = 0; i < 1000; i += 2) {
+      expect(set.remove(i));
+    }
+    expect(! set.remove(0));
+    expect(set.remove(null) && ! set.contains(null));
+
+    int count = 0;
+    for (Iterator<Integer> it = set.iterator(); it.hasNext();) {
+      int i = it.next();
+      expect(i % 2 == 1);
+      if (i % 3 == 0) {
+        it.remove();
+      }
+      ++ count;
+    }
+    expect(count == 500);
+    for (int i = 0; i < 1000; ++i) {
+      expect(set.contains(i) == (i % 2 == 1 && i % 3 != 0));
+    }
+  }
+
   @SuppressWarnings("rawtypes")
   private static void testValues() {
     Map testMap = java.util.Collections.unmodifiableMap(java.util.Collections.emptyMap());
@@ -0,0 +1,287 @@
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.BlockingQueue;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.Future;
+import java.util.concurrent.LinkedBlockingQueue;
+import java.util.concurrent.RecursiveTask;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.ScheduledFuture;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.locks.Condition;
+import java.util.concurrent.locks.LockSupport;
+import java.util.concurrent.locks.ReentrantLock;
+
+public class Concurrent {
+  private static final int ThreadCount = 4;
+  private static final int Iterations = 10000;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static void join(Thread[] threads) throws InterruptedException {
+    for (Thread t: threads) {
+      t.join();
+    }
+  }
+
+  private static void testAtomics() throws Exception {
+    final AtomicInteger i = new AtomicInteger();
+    final AtomicLong l = new AtomicLong(1L << 40);
+    Thread[] threads = new Thread[ThreadCount];
+    for (int j = 0; j < ThreadCount; ++j) {
+      (threads[j] = new Thread() {
+          public void run() {
+            for (int k = 0; k < Iterations; ++k) {
+              i.incrementAndGet();
+              l.getAndAdd(2);
+            }
+          }
+        }).start();
+    }
+    join(threads);
+
+    expect(i.get() == ThreadCount * Iterations);
+    expect(l.get() == (1L << 40) + (2L * ThreadCount * Iterations));
+    expect(! i.compareAndSet(0, 1));
+    expect(l.compareAndSet(l.get(), 7) && l.get() == 7);
+  }
+
+  private static int counter;
+
+  private static void testLocks() throws Exception {
+    final ReentrantLock lock = new ReentrantLock();
+    final Condition changed = lock.newCondition();
+    Thread[] threads = new Thread[ThreadCount];
+    for (int j = 0; j < ThreadCount; ++j) {
+      final int id = j;
+      (threads[j] = new Thread() {
+          public void run() {
+            // take turns, in order, Iterations / 10 times each
+            for (int k = 0; k < Iterations / 10; ++k) {
+              lock.lock();
+              try {
+                while (counter % ThreadCount != id) {
+                  changed.awaitUninterruptibly();
+                }
+                lock.lock();
+                ++ counter;
+                lock.unlock();
+                changed.signalAll();
+              } finally {
+                lock.unlock();
+              }
+            }
+          }
+        }).start();
+    }
+    join(threads);
+
+    expect(counter == ThreadCount * (Iterations / 10));
+    expect(! lock.isLocked());
+    expect(lock.tryLock());
+    expect(! changed.await(1, TimeUnit.MILLISECONDS));
+    lock.unlock();
+  }
+
+  private static void testQueue() throws Exception {
+    final BlockingQueue<Integer> queue = new LinkedBlockingQueue<Integer>(16);
+    Thread consumer = new Thread() {
+        public void run() {
+          try {
+            for (int i = 0; i < Iterations; ++i) {
+              expect(queue.take() == i);
+            }
+          } catch (InterruptedException e) {
+            throw new RuntimeException(e);
+          }
+        }
+      };
+    consumer.start();
+
+    for (int i = 0; i < Iterations; ++i) {
+      queue.put(i);
+    }
+    consumer.join();
+
+    expect(queue.isEmpty());
+    expect(queue.poll(1, TimeUnit.MILLISECONDS) == null);
+  }
+
+  private static void testMap() throws Exception {
+    final ConcurrentHashMap<Integer, Integer> map
+      = new ConcurrentHashMap<Integer, Integer>();
+    Thread[] threads = new Thread[ThreadCount];
+    for (int j = 0; j < ThreadCount; ++j) {
+      final int id = j;
+      (threads[j] = new Thread() {
+          public void run() {
+            for (int k = id; k < Iterations; k += ThreadCount) {
+              expect(map.putIfAbsent(k, k) == null);
+            }
+          }
+        }).start();
+    }
+    join(threads);
+
+    expect(map.size() == Iterations);
+    int count = 0;
+    for (Integer k: map.keySet()) {
+      expect(map.get(k).equals(k));
+      ++ count;
+    }
+    expect(count == Iterations);
+
+    for (int k = 0; k < Iterations; k += 2) {
+      expect(map.remove(k).equals(k));
+    }
+    expect(map.size() == Iterations / 2);
+    expect(map.replace(1, 1, -1) && map.get(1) == -1);
+    expect(! map.remove(3, 4) && map.containsKey(3));
+  }
+
+  private static void testExecutor() throws Exception {
+    ExecutorService executor = Executors.newFixedThreadPool(ThreadCount);
+    List<Future<Integer>> futures = new ArrayList<Future<Integer>>();
+    for (int i = 0; i < 100; ++i) {
+      final int n = i;
+      futures.add(executor.submit(new Callable<Integer>() {
+          public Integer call() {
+            return n * n;
+          }
+        }));
+    }
+
+    for (int i = 0; i < 100; ++i) {
+      expect(futures.get(i).get() == i * i);
+    }
+
+    executor.shutdown();
+    expect(executor.awaitTermination(10, TimeUnit.SECONDS));
+    expect(executor.isTerminated());
+  }
+
+  private static void testScheduledExecutor() throws Exception {
+    // timed waits end no earlier than asked, however they are timed
+    { long start = System.nanoTime();
+      Thread.sleep(20);
+      expect(System.nanoTime() - start >= 20L * 1000 * 1000);
+
+      start = System.nanoTime();
+      long deadline = start + (5L * 1000 * 1000);
+      while (System.nanoTime() < deadline) {
+        LockSupport.parkNanos(deadline - System.nanoTime());
+      }
+    }
+
+    ScheduledExecutorService executor = Executors.newScheduledThreadPool(2);
+
+    final List<Integer> order = new ArrayList<Integer>();
+    long start = System.nanoTime();
+    Future<?> late = executor.schedule(new Runnable() {
+        public void run() {
+          synchronized (order) {
+            order.add(2);
+          }
+        }
+      }, 60, TimeUnit.MILLISECONDS);
+    ScheduledFuture<Integer> early = executor.schedule(new Callable<Integer>() {
+        public Integer call() {
+          synchronized (order) {
+            order.add(1);
+          }
+          return 42;
+        }
+      }, 20, TimeUnit.MILLISECONDS);
+    ScheduledFuture<?> cancelled = executor.schedule(new Runnable() {
+        public void run() {
+          expect(false);
+        }
+      }, 40, TimeUnit.MILLISECONDS);
+
+    expect(cancelled.cancel(false));
+    expect(early.get() == 42);
+    expect(System.nanoTime() - start >= 20L * 1000 * 1000);
+    late.get();
+    expect(System.nanoTime() - start >= 60L * 1000 * 1000);
+    synchronized (order) {
+      expect(order.size() == 2 && order.get(0) == 1 && order.get(1) == 2);
+    }
+    expect(cancelled.isCancelled());
+
+    final AtomicInteger runs = new AtomicInteger();
+    ScheduledFuture<?> periodic = executor.scheduleAtFixedRate(new Runnable() {
+        public void run() {
+          runs.incrementAndGet();
+        }
+      }, 0, 5, TimeUnit.MILLISECONDS);
+    while (runs.get() < 3) {
+      Thread.sleep(5);
+    }
+    expect(periodic.cancel(false));
+
+    final AtomicInteger delayed = new AtomicInteger();
+    executor.scheduleWithFixedDelay(new Runnable() {
+        public void run() {
+          delayed.incrementAndGet();
+        }
+      }, 0, 5, TimeUnit.MILLISECONDS);
+    while (delayed.get() < 2) {
+      Thread.sleep(5);
+    }
+
+    // a delayed task still runs after shutdown, but a periodic one stops
+    Future<Integer> pending = executor.schedule(new Callable<Integer>() {
+        public Integer call() {
+          return 7;
+        }
+      }, 10, TimeUnit.MILLISECONDS);
+    executor.shutdown();
+    expect(pending.get() == 7);
+    expect(executor.awaitTermination(10, TimeUnit.SECONDS));
+  }
+
+  private static class Fibonacci extends RecursiveTask<Integer> {
+    private final int n;
+
+    public Fibonacci(int n) {
+      this.n = n;
+    }
+
+    protected Integer compute() {
+      if (n < 2) {
+        return n;
+      }
+
+      Fibonacci a = new Fibonacci(n - 1);
+      a.fork();
+      Fibonacci b = new Fibonacci(n - 2);
+      return b.compute() + a.join();
+    }
+  }
+
+  private static void testForkJoin() throws Exception {
+    ForkJoinPool pool = new ForkJoinPool(ThreadCount);
+    expect(pool.invoke(new Fibonacci(20)) == 6765);
+
+    pool.shutdown();
+    expect(pool.awaitTermination(10, TimeUnit.SECONDS));
+  }
+
+  public static void main(String[] args) throws Exception {
+    testAtomics();
+    testLocks();
+    testQueue();
+    testMap();
+    testExecutor();
+    testScheduledExecutor();
+    testForkJoin();
+  }
+}
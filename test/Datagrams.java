@@ -1,3 +1,4 @@
+import java.lang.reflect.Method;
 import java.net.SocketAddress;
 import java.net.InetSocketAddress;
 import java.net.ProtocolFamily;
@@ -21,7 +22,95 @@ public class Datagrams {
     return true;
   }
 
+  // the batch methods are Avian extensions, so they are found
+  // reflectively, and the test skipped where they don't exist
+  private static void testBatch() throws Exception {
+    Method send;
+    Method receive;
+    try {
+      send = DatagramChannel.class.getMethod
+        ("send", ByteBuffer[].class, int.class, int.class,
+         SocketAddress[].class);
+      receive = DatagramChannel.class.getMethod
+        ("receive", ByteBuffer[].class, int.class, int.class,
+         SocketAddress[].class);
+    } catch (NoSuchMethodException e) {
+      return;
+    }
+
+    final SocketAddress Address = new InetSocketAddress("localhost", 22044);
+    final int Count = 3;
+
+    DatagramChannel in = DatagramChannel.open();
+    try {
+      in.bind(Address);
+
+      DatagramChannel out = DatagramChannel.open();
+      try {
+        out.connect(Address);
+
+        ByteBuffer[] outBuffers = new ByteBuffer[Count];
+        for (int i = 0; i < Count; ++i) {
+          byte[] message = ("message " + i).getBytes();
+          outBuffers[i] = ByteBuffer.allocateDirect(message.length);
+          outBuffers[i].put(message);
+          outBuffers[i].flip();
+        }
+
+        int sent = 0;
+        while (sent < Count) {
+          sent += (Integer) send.invoke
+            (out, outBuffers, sent, Count - sent, null);
+        }
+        for (int i = 0; i < Count; ++i) {
+          expect(! outBuffers[i].hasRemaining());
+        }
+
+        ByteBuffer[] inBuffers = new ByteBuffer[Count];
+        for (int i = 0; i < Count; ++i) {
+          inBuffers[i] = ByteBuffer.allocateDirect(64);
+        }
+        SocketAddress[] senders = new SocketAddress[Count];
+
+        // a blocking receive may return as soon as one has arrived
+        int received = 0;
+        while (received < Count) {
+          received += (Integer) receive.invoke
+            (in, inBuffers, received, Count - received, senders);
+        }
+
+        for (int i = 0; i < Count; ++i) {
+          byte[] message = ("message " + i).getBytes();
+          inBuffers[i].flip();
+          expect(inBuffers[i].remaining() == message.length);
+          for (int j = 0; j < message.length; ++j) {
+            expect(inBuffers[i].get(j) == message[j]);
+          }
+          expect(senders[i] != null);
+        }
+
+        { boolean thrown = false;
+          try {
+            receive.invoke
+              (in, new ByteBuffer[] { ByteBuffer.allocate(8) }, 0, 1,
+               senders);
+          } catch (java.lang.reflect.InvocationTargetException e) {
+            // heap buffers can't be batched
+            thrown = e.getCause() instanceof IllegalArgumentException;
+          }
+          expect(thrown);
+        }
+      } finally {
+        out.close();
+      }
+    } finally {
+      in.close();
+    }
+  }
+
   public static void main(String[] args) throws Exception {
+    testBatch();
+
     final String Hostname = "localhost";
     final int Port = 22043;
     final SocketAddress Address = new InetSocketAddress(Hostname, Port);
@@ -12,12 +12,76 @@ public class Exceptions {
     moreDangerous();
   }
 
+  private static int checked(int x) {
+    if (x < 0) throw new IllegalArgumentException("negative: " + x);
+    if (x == zero()) throw new IllegalStateException();
+    return x + 1;
+  }
+
+  private static int zero() {
+    return 0;
+  }
+
+  private static int recovered(int x) {
+    int y;
+    try {
+      y = checked(x);
+    } catch (IllegalArgumentException e) {
+      return -2;
+    } catch (IllegalStateException e) {
+      return -3;
+    }
+    return y * 2;
+  }
+
+  private static int partlyRecovered(int x) {
+    try {
+      return checked(x);
+    } catch (IllegalArgumentException e) {
+      return -2;
+    }
+  }
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
   public static void main(String[] args) {
     try {
       dangerous();
     } catch (Exception e) {
       e.printStackTrace();
     }
+
+    // exception handlers and throwing paths are laid out out of line
+    for (int i = 0; i < 4; ++i) {
+      expect(recovered(i + 1) == (i + 2) * 2);
+      expect(recovered(- i - 1) == -2);
+      expect(recovered(0) == -3);
+    }
+
+    // the handler chosen for a call site depends on the exception's
+    // type, including when there is none in that frame
+    for (int i = 0; i < 4; ++i) {
+      expect(partlyRecovered(- i - 1) == -2);
+      try {
+        partlyRecovered(0);
+        expect(false);
+      } catch (IllegalStateException e) { }
+    }
+
+    // implicit exceptions keep their stack traces unless
+    // avian.jit.fastThrowLimit says otherwise
+    long fastThrows = avian.Machine.fastThrowCount();
+    int zero = 0;
+    for (int i = 0; i < 100; ++i) {
+      try {
+        expect(i / zero == 0);
+      } catch (ArithmeticException e) {
+        expect(e.getStackTrace().length > 0);
+      }
+    }
+    expect(avian.Machine.fastThrowCount() == fastThrows);
   }
 
 }
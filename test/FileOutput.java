@@ -2,6 +2,11 @@ import java.io.FileOutputStream;
 import java.io.FileInputStream;
 import java.io.File;
 import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.AsynchronousFileChannel;
+import java.nio.channels.CompletionHandler;
+import java.nio.channels.FileChannel;
 
 public class FileOutput {
   private static void expect(boolean v) {
@@ -37,11 +42,124 @@ public class FileOutput {
     }
   }
 
-  public static void main(String[] args) throws IOException {
+  private static void testChannels() throws IOException {
+    try {
+      FileOutputStream f = new FileOutputStream("test.txt");
+      f.write("Hello channels!".getBytes());
+      f.close();
+
+      FileInputStream in = new FileInputStream("test.txt");
+      FileChannel source = in.getChannel();
+      expect(source.size() == 15);
+
+      FileOutputStream out = new FileOutputStream("test2.txt");
+      expect(source.transferTo(6, 100, out.getChannel()) == 9);
+      out.close();
+      in.close();
+
+      in = new FileInputStream("test2.txt");
+      out = new FileOutputStream("test.txt");
+      expect(out.getChannel().transferFrom(in.getChannel(), 0, 8) == 8);
+      out.close();
+      in.close();
+
+      in = new FileInputStream("test.txt");
+      byte[] buffer = new byte[256];
+      int c;
+      int offset = 0;
+      while ((c = in.read(buffer, offset, buffer.length - offset)) != -1) {
+        offset += c;
+      }
+      in.close();
+
+      expect("channels".equals(new String(buffer, 0, offset)));
+    } finally {
+      expect(new File("test.txt").delete());
+      expect(new File("test2.txt").delete());
+    }
+  }
+
+  private static void testMap() throws IOException {
+    try {
+      FileOutputStream f = new FileOutputStream("test.txt");
+      f.write("Hello mapped world!".getBytes());
+      f.close();
+
+      FileInputStream in = new FileInputStream("test.txt");
+      MappedByteBuffer b = in.getChannel().map
+        (FileChannel.MapMode.READ_ONLY, 6, 6);
+      in.close();
+
+      expect(b.remaining() == 6);
+      byte[] buffer = new byte[6];
+      b.load().get(buffer);
+      expect("mapped".equals(new String(buffer)));
+    } finally {
+      // Windows won't delete a file that is still mapped, and the
+      // mapping lives until the buffer is collected
+      new File("test.txt").delete();
+    }
+  }
+
+  private static void testAsync() throws Exception {
+    try {
+      FileOutputStream f = new FileOutputStream("test.txt");
+      f.write("0123456789".getBytes());
+      f.close();
+
+      FileInputStream in = new FileInputStream("test.txt");
+      AsynchronousFileChannel channel = AsynchronousFileChannel.open
+        (in.getChannel());
+
+      final int[] pending = new int[] { 10 };
+      final byte[] result = new byte[10];
+      CompletionHandler<Integer, ByteBuffer> handler
+        = new CompletionHandler<Integer, ByteBuffer>() {
+        public void completed(Integer count, ByteBuffer b) {
+          synchronized (pending) {
+            if (count == 1) {
+              result[b.get(0) - '0'] = b.get(0);
+            }
+            -- pending[0];
+            pending.notifyAll();
+          }
+        }
+
+        public void failed(Throwable e, ByteBuffer b) {
+          synchronized (pending) {
+            -- pending[0];
+            pending.notifyAll();
+          }
+        }
+      };
+
+      for (int i = 9; i >= 0; --i) {
+        ByteBuffer b = ByteBuffer.allocate(1);
+        channel.read(b, i, b, handler);
+      }
+
+      synchronized (pending) {
+        while (pending[0] != 0) {
+          pending.wait();
+        }
+      }
+      channel.close();
+
+      expect("0123456789".equals(new String(result)));
+    } finally {
+      expect(new File("test.txt").delete());
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
     expect(new File("nonexistent-file").length() == 0);
 
     test(false);
     test(true);
+
+    testChannels();
+    testMap();
+    testAsync();
   }
 
 }
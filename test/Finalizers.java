@@ -1,6 +1,7 @@
 public class Finalizers {
   private static final Object lock = new Object();
   private static boolean finalized = false;
+  private static int finalizedCount = 0;
 
   private static void expect(boolean v) {
     if (! v) throw new RuntimeException();
@@ -37,8 +38,36 @@ public class Finalizers {
     }
 
     expect(finalized);
+
+    { final int count = 1000;
+      for (int i = 0; i < count; ++i) {
+        new Counted();
+      }
+
+      synchronized (lock) {
+        System.gc();
+        long deadline = System.currentTimeMillis() + 5000;
+        while (finalizedCount < count
+               && System.currentTimeMillis() < deadline)
+        {
+          lock.wait(100);
+        }
+      }
+
+      expect(finalizedCount == count);
+      expect(avian.Machine.finalizerBacklog() == 0);
+    }
   }
 
   private static class Finalizers2 extends Finalizers { }
 
+  private static class Counted {
+    protected void finalize() {
+      synchronized (lock) {
+        ++ finalizedCount;
+        lock.notifyAll();
+      }
+    }
+  }
+
 }
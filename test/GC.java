@@ -197,6 +197,17 @@ public class GC {
 
     stackMap8(true);
     stackMap8(false);
+
+    System.gc();
+
+    long collections = 0;
+    for (long n: avian.Machine.collectionPauseHistogram()) {
+      collections += n;
+    }
+    if (collections == 0) throw new RuntimeException();
+    if (avian.Machine.collectionPausePercentile(1.0) <= 0) {
+      throw new RuntimeException();
+    }
   }
 
   private static class DummyException extends RuntimeException { }
@@ -20,7 +20,117 @@ public class Integers {
     return m;
   }
 
+  // javac folds constant expressions, but not arithmetic on locals
+  // holding constants, so the operands here only become constant in
+  // the JIT, which must fold them as the VM would compute them
+  private static void testFolding() {
+    int one = 1;
+    int minusOne = -1;
+    int thirtyThree = 33;
+    int thirtyTwo = 32;
+    int twentyEight = 28;
+    int max = Integer.MAX_VALUE;
+    int min = Integer.MIN_VALUE;
+    int root = 46341;
+    int big = 0x10000;
+
+    expect((one << thirtyThree) == 2);
+    expect((one << thirtyTwo) == 1);
+    expect((one << minusOne) == Integer.MIN_VALUE);
+    expect((minusOne >>> twentyEight) == 15);
+    expect((minusOne >> twentyEight) == -1);
+    expect((min >> thirtyThree) == -0x40000000);
+    expect((min >>> thirtyThree) == 0x40000000);
+
+    expect(max + one == Integer.MIN_VALUE);
+    expect(min - one == Integer.MAX_VALUE);
+    expect(root * root == -2147479015);
+    expect(big * big == 0);
+    expect(min * minusOne == Integer.MIN_VALUE);
+
+    expect((big | minusOne) == -1);
+    expect((max & min) == 0);
+    expect((max ^ minusOne) == Integer.MIN_VALUE);
+
+    long oneL = 1;
+    long minusOneL = -1;
+    int sixtyFive = 65;
+    int sixty = 60;
+    long bigL = 0x100000000L;
+    long maxL = Long.MAX_VALUE;
+
+    expect((oneL << sixtyFive) == 2);
+    expect((oneL << thirtyThree) == 0x200000000L);
+    expect((minusOneL >>> sixty) == 15);
+    expect((minusOneL >> sixty) == -1);
+    expect(bigL * bigL == 0);
+    expect(maxL + oneL == Long.MIN_VALUE);
+    expect((bigL | oneL) == 0x100000001L);
+    expect((long) (one << thirtyTwo - one) == 0x80000000L - 0x100000000L);
+  }
+
   public static void main(String[] args) throws Exception {
+    testFolding();
+
+    { // small boxed values are shared, and the rest still box correctly
+      Integer a = 100, b = 100;
+      expect(a == b);
+      expect(Integer.valueOf(-128) == Integer.valueOf(-128));
+      expect(Integer.valueOf(1000).intValue() == 1000);
+      expect(Long.valueOf(-1) == Long.valueOf(-1));
+      expect(Long.valueOf(1L << 40).longValue() == 1L << 40);
+      expect(Short.valueOf((short) 127) == Short.valueOf((short) 127));
+      expect(Byte.valueOf((byte) -1).byteValue() == -1);
+      expect(Character.valueOf('a') == Character.valueOf('a'));
+      expect(Character.valueOf('\u1234').charValue() == '\u1234');
+    }
+
+    { // the JIT compiles these to instructions or thunks, depending on
+      // the processor, so check each at the edges
+      int zero = 0;
+      int one = 1;
+      int minus = -1;
+      int mixed = 0x12345678;
+      expect(Integer.bitCount(zero) == 0);
+      expect(Integer.bitCount(minus) == 32);
+      expect(Integer.bitCount(mixed) == 13);
+      expect(Integer.numberOfLeadingZeros(zero) == 32);
+      expect(Integer.numberOfLeadingZeros(one) == 31);
+      expect(Integer.numberOfLeadingZeros(minus) == 0);
+      expect(Integer.numberOfLeadingZeros(mixed) == 3);
+      expect(Integer.numberOfTrailingZeros(zero) == 32);
+      expect(Integer.numberOfTrailingZeros(Integer.MIN_VALUE) == 31);
+      expect(Integer.numberOfTrailingZeros(mixed) == 3);
+      expect(Integer.reverseBytes(mixed) == 0x78563412);
+      expect(Integer.rotateLeft(mixed, 8) == 0x34567812);
+      expect(Integer.rotateLeft(mixed, 40) == 0x34567812);
+      expect(Integer.rotateRight(mixed, 8) == 0x78123456);
+      expect(Integer.rotateRight(mixed, zero) == mixed);
+
+      long lzero = 0;
+      long lminus = -1;
+      long lmixed = 0x123456789ABCDEF0L;
+      expect(Long.bitCount(lzero) == 0);
+      expect(Long.bitCount(lminus) == 64);
+      expect(Long.bitCount(lmixed) == 32);
+      expect(Long.numberOfLeadingZeros(lzero) == 64);
+      expect(Long.numberOfLeadingZeros(lmixed) == 3);
+      expect(Long.numberOfLeadingZeros(lmixed >>> 40) == 43);
+      expect(Long.numberOfTrailingZeros(lzero) == 64);
+      expect(Long.numberOfTrailingZeros(lmixed) == 4);
+      expect(Long.numberOfTrailingZeros(1L << 40) == 40);
+      expect(Long.reverseBytes(lmixed) == 0xF0DEBC9A78563412L);
+      expect(Long.rotateLeft(lmixed, 4) == 0x23456789ABCDEF01L);
+      expect(Long.rotateRight(lmixed, 68) == 0x0123456789ABCDEFL);
+
+      double half = 2.5;
+      expect(Math.floor(half) == 2.0);
+      expect(Math.ceil(half) == 3.0);
+      expect(Math.floor(-half) == -3.0);
+      expect(Math.ceil(-half) == -2.0);
+      expect(Double.isNaN(Math.floor(Double.NaN)));
+    }
+
     { int foo = 1028;
       foo -= 1023;
       expect(foo == 5);
@@ -59,6 +59,20 @@ public class JNI {
 
   private static native Object testLocalRef(Object o);
 
+  // implemented only as a JavaCritical_ function
+  private static native long sum(byte[] array, long bias);
+
+  private static class Fields {
+    public byte b = 1;
+    public int i = 2;
+    public volatile long l = 3;
+    public short s = 4;
+    public double d = 5;
+    public Object o;
+  }
+
+  private static native boolean copyFields(Fields f);
+
   public static int method242() { return 242; }
   
   public static final int field950 = 950;
@@ -112,5 +126,13 @@ public class JNI {
     { Object o = new Object();
       expect(testLocalRef(o) == o);
     }
+
+    expect(sum(new byte[] { 1, 2, 3, -4 }, 1L << 40) == (1L << 40) + 2);
+    expect(sum(null, 42) == 42);
+
+    { Fields f = new Fields();
+      expect(copyFields(f));
+      expect(f.b == 6 && f.i == 7 && f.l == 8 && f.s == 9 && f.d == 10);
+    }
   }
 }
@@ -96,8 +96,85 @@ public class Logging {
     throw new Exception("Started here");
   }
 
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class CollectingHandler extends Handler {
+    public final java.util.List<String> messages
+      = new java.util.ArrayList<String>();
+    public int flushes;
+    public long delay;
+
+    public synchronized void publish(LogRecord r) {
+      if (delay > 0) {
+        try {
+          Thread.sleep(delay);
+        } catch (InterruptedException e) {
+          throw new RuntimeException(e);
+        }
+      }
+      messages.add(r.getMessage());
+    }
+
+    public synchronized void flush() {
+      ++ flushes;
+    }
+
+    public synchronized void close() { }
+  }
+
+  private static void testAsync() throws Exception {
+    final CollectingHandler target = new CollectingHandler();
+    final avian.AsyncLogHandler async = new avian.AsyncLogHandler
+      (target, 8, avian.AsyncLogHandler.Block);
+
+    final int threadCount = 4;
+    final int messageCount = 250;
+    Thread[] threads = new Thread[threadCount];
+    for (int i = 0; i < threadCount; ++i) {
+      final int id = i;
+      threads[i] = new Thread() {
+          public void run() {
+            for (int j = 0; j < messageCount; ++j) {
+              async.publish(new LogRecord(Level.INFO, id + ":" + j));
+            }
+          }
+        };
+      threads[i].start();
+    }
+    for (Thread t: threads) {
+      t.join();
+    }
+    async.flush();
+
+    synchronized (target) {
+      expect(target.messages.size() == threadCount * messageCount);
+      expect(target.flushes > 0);
+      // each thread's records arrive in the order it published them
+      int[] next = new int[threadCount];
+      for (String m: target.messages) {
+        int colon = m.indexOf(':');
+        int id = Integer.parseInt(m.substring(0, colon));
+        expect(Integer.parseInt(m.substring(colon + 1)) == next[id]++);
+      }
+    }
+    async.close();
+
+    CollectingHandler slow = new CollectingHandler();
+    slow.delay = 5;
+    avian.AsyncLogHandler dropping = new avian.AsyncLogHandler
+      (slow, 2, avian.AsyncLogHandler.Drop);
+    for (int i = 0; i < 100; ++i) {
+      dropping.publish(new LogRecord(Level.INFO, "m" + i));
+    }
+    dropping.close();
+    expect(dropping.getDroppedCount() > 0);
+    expect(slow.messages.size() + dropping.getDroppedCount() == 100);
+  }
+
   private static final boolean useCustomHandler = true;
-  public static void main(String args[]) {
+  public static void main(String args[]) throws Exception {
     if (useCustomHandler) {
       Logger root = Logger.getLogger("");
       root.addHandler(new MyHandler());
@@ -107,5 +184,7 @@ public class Logging {
 
     Logging me = new Logging();
     me.run();
+
+    testAsync();
   }
 }
@@ -19,6 +19,158 @@ public class Misc {
     }
   }
 
+  // enough interfaces to get a hashed interface table
+  private interface I1 { public int i1(); }
+  private interface I2 { public int i2(); }
+  private interface I3 { public int i3(); }
+  private interface I4 { public int i4(); }
+  private interface I5 { public int i5(); }
+  private interface I6 { public int i6(); }
+  private interface I7 { public int i7(); }
+  private interface I8 { public int i8(); }
+
+  private static class Many implements I1, I2, I3, I4, I5, I6, I7, I8 {
+    public int i1() { return 1; }
+    public int i2() { return 2; }
+    public int i3() { return 3; }
+    public int i4() { return 4; }
+    public int i5() { return 5; }
+    public int i6() { return 6; }
+    public int i7() { return 7; }
+    public int i8() { return 8; }
+  }
+
+  private static class MoreThanMany extends Many {
+    public int i5() { return 50; }
+  }
+
+  private static int callInterfaces(Object o) {
+    return ((I1) o).i1() + ((I2) o).i2() + ((I3) o).i3() + ((I4) o).i4()
+      + ((I5) o).i5() + ((I6) o).i6() + ((I7) o).i7() + ((I8) o).i8();
+  }
+
+  private static int callI1(I1 o) {
+    return o.i1();
+  }
+
+  // calls one site with one receiver class and then with enough others,
+  // in turn, to keep replacing what it remembers about the last one
+  private static void testInterfaceSites() {
+    I1 a = new I1() { public int i1() { return 10; } };
+    I1 b = new I1() { public int i1() { return 20; } };
+    I1 c = new I1() { public int i1() { return 30; } };
+
+    for (int i = 0; i < 4; ++i) {
+      expect(callI1(a) == 10);
+    }
+
+    I1[] receivers = { new Many(), a, b, c, new MoreThanMany() };
+    int[] values = { 1, 10, 20, 30, 1 };
+    for (int i = 0; i < 4; ++i) {
+      for (int j = 0; j < receivers.length; ++j) {
+        expect(callI1(receivers[j]) == values[j]);
+      }
+    }
+
+    try {
+      callI1(null);
+      expect(false);
+    } catch (NullPointerException e) { }
+  }
+
+  public static class Single {
+    public int value() { return 1; }
+
+    public int sum(int a, long b, Object c) {
+      return a + (int) b + (c == null ? 0 : 1);
+    }
+
+    public int late(int a, Object b) {
+      return a + (b == null ? 0 : 1);
+    }
+  }
+
+  // loaded only by name, after callSingle, callSum and callLate have
+  // been compiled
+  public static class Overriding extends Single {
+    public int value() { return 2; }
+
+    public int sum(int a, long b, Object c) {
+      return 100 + a + (int) b + (c == null ? 0 : 1);
+    }
+
+    public int late(int a, Object b) {
+      return 200 + a + (b == null ? 0 : 1);
+    }
+  }
+
+  private static int callSingle(Single s) {
+    return s.value();
+  }
+
+  private static int callSum(Single s, Object o) {
+    return s.sum(1, 2L, o);
+  }
+
+  // the call is compiled with the rest of the method but not made
+  // until call is true
+  private static int callLate(Single s, Object o, boolean call) {
+    return call ? s.late(5, o) : -1;
+  }
+
+  private static void testDevirtualized() throws Exception {
+    Single single = new Single();
+    for (int i = 0; i < 4; ++i) {
+      expect(callSingle(single) == 1);
+      expect(callSum(single, single) == 4);
+      expect(callLate(single, single, false) == -1);
+    }
+
+    try {
+      callSingle(null);
+      expect(false);
+    } catch (NullPointerException e) { }
+
+    Single overriding = (Single)
+      Class.forName("Misc$Overriding").newInstance();
+
+    expect(callSingle(overriding) == 2);
+    expect(callSingle(single) == 1);
+
+    // the receiver isn't the last argument pushed here, so this checks
+    // that dispatch finds the receiver rather than an argument
+    expect(callSum(overriding, single) == 104);
+    expect(callSum(overriding, null) == 103);
+    expect(callSum(single, null) == 3);
+
+    // the first call through this site comes after the override, so it
+    // is resolved from the receiver while the target is compiled
+    expect(callLate(overriding, single, true) == 206);
+    expect(callLate(single, null, true) == 5);
+    expect(callLate(overriding, null, true) == 205);
+  }
+
+  private static int superclassInits;
+
+  public static class InitializingSuper {
+    static {
+      ++ superclassInits;
+    }
+  }
+
+  // has no static initializer of its own
+  public static class NotInitializing extends InitializingSuper { }
+
+  private static Object makeNotInitializing() {
+    return new NotInitializing();
+  }
+
+  private static void testSuperclassInit() {
+    expect(superclassInits == 0);
+    expect(makeNotInitializing() != null);
+    expect(superclassInits == 1);
+  }
+
   private static int alpha;
   private static int beta;
   private static byte byte1, byte2, byte3;
@@ -131,12 +283,23 @@ public class Misc {
     }
   }
 
-  public static void main(String[] args) {
+  public static void main(String[] args) throws Exception {
     zam();
 
     Bim bim = new Baz();
     expect(bim.baz() == 42);
 
+    for (int i = 0; i < 4; ++i) {
+      expect(callInterfaces(new Many()) == 36);
+      expect(callInterfaces(new MoreThanMany()) == 81);
+    }
+
+    testDevirtualized();
+
+    testSuperclassInit();
+
+    testInterfaceSites();
+
     expect(queryDefault(new Object()) != null);
 
     { Foo foo = new Foo();
@@ -257,6 +420,19 @@ public class Misc {
     expect(new Object[0] instanceof Cloneable);
     expect(new Object[0] instanceof java.io.Serializable);
 
+    { Object o = new MoreThanMany();
+      // alternate, so each check misses the interface found last
+      for (int i = 0; i < 2; ++i) {
+        expect(o instanceof I1);
+        expect(o instanceof I8);
+        expect(! (o instanceof Bar));
+      }
+
+      expect(o instanceof Many);
+      expect(! (o instanceof Single));
+      expect(! (((Object) new Many()) instanceof MoreThanMany));
+    }
+
     expect((Baz.class.getModifiers() & java.lang.reflect.Modifier.STATIC)
            != 0);
 
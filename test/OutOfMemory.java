@@ -1,3 +1,5 @@
+import java.lang.ref.SoftReference;
+
 public class OutOfMemory {
   // assume a 128MB heap size:
   private static final int Padding = 120 * 1024 * 1024;
@@ -37,7 +39,30 @@ public class OutOfMemory {
     }
   }
 
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static void softReferences() {
+    // soft references are cleared, rather than memory running out,
+    // before the cache outgrows the heap
+    SoftReference[] cache = new SoftReference[1024];
+    for (int i = 0; i < cache.length; ++i) {
+      cache[i] = new SoftReference(new byte[1024 * 1024]);
+    }
+
+    int cleared = 0;
+    for (int i = 0; i < cache.length; ++i) {
+      if (cache[i].get() == null) {
+        ++ cleared;
+      }
+    }
+    expect(cleared > 0);
+  }
+
   public static void main(String[] args) {
+    softReferences();
+
     try {
       bigObjects();
       throw new RuntimeException();
@@ -1,7 +1,33 @@
 import java.io.IOException;
+import java.lang.reflect.Method;
 
 public class Processes {
-  public static void main(String[] args) {
+  // exec(String[][]) is an Avian extension, so it is found
+  // reflectively, and the test skipped where it doesn't exist
+  private static void testBulk() throws Exception {
+    Method exec;
+    try {
+      exec = Runtime.class.getMethod("exec", String[][].class);
+    } catch (NoSuchMethodException e) {
+      return;
+    }
+
+    Process[] processes = (Process[]) exec.invoke
+      (Runtime.getRuntime(), (Object) new String[][] {
+        { "true" }, { "false" }, { "sh", "-c", "exit 3" } });
+
+    if (processes.length != 3
+        || processes[0].waitFor() != 0
+        || processes[1].waitFor() != 1
+        || processes[2].waitFor() != 3)
+    {
+      throw new RuntimeException("bulk exec failed");
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    testBulk();
+
     long start = System.currentTimeMillis();
     try {
       final Process p = Runtime.getRuntime().exec("sleep 10");
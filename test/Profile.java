@@ -0,0 +1,157 @@
+import java.io.File;
+
+public class Profile {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static int spin(long millis) {
+    int x = 0;
+    long end = System.currentTimeMillis() + millis;
+    while (System.currentTimeMillis() < end) {
+      for (int i = 0; i < 1000; ++i) {
+        x = (x * 31) + i;
+      }
+    }
+    return x;
+  }
+
+  public static void main(String[] args) throws Exception {
+    File file = new File("profile.txt");
+
+    avian.Machine.startProfiler("cpu:" + file.getPath());
+
+    { boolean thrown = false;
+      try {
+        avian.Machine.startProfiler("cpu:" + file.getPath());
+      } catch (RuntimeException e) {
+        // already profiling
+        thrown = true;
+      }
+      expect(thrown);
+    }
+
+    // busy threads other than this one, so they are running when the
+    // sampler looks at them
+    Thread[] threads = new Thread[2];
+    for (int i = 0; i < threads.length; ++i) {
+      threads[i] = new Thread() {
+          public void run() {
+            spin(200);
+          }
+        };
+      threads[i].start();
+    }
+    spin(200);
+    for (int i = 0; i < threads.length; ++i) {
+      threads[i].join();
+    }
+
+    avian.Machine.stopProfiler();
+
+    // the interpreter doesn't take samples, so the profile may be
+    // empty, but it must have been written
+    expect(file.exists());
+    expect(file.delete());
+
+    { boolean thrown = false;
+      try {
+        avian.Machine.stopProfiler();
+      } catch (RuntimeException e) {
+        // not profiling
+        thrown = true;
+      }
+      expect(thrown);
+    }
+
+    { boolean thrown = false;
+      try {
+        avian.Machine.startProfiler("heap:" + file.getPath());
+      } catch (RuntimeException e) {
+        // malformed
+        thrown = true;
+      }
+      expect(thrown);
+    }
+
+    { boolean thrown = false;
+      try {
+        avian.Machine.contentionReport(10);
+      } catch (RuntimeException e) {
+        // avian.contention.profile isn't set
+        thrown = true;
+      }
+      expect(thrown);
+    }
+
+    // null when interpreting, and otherwise counts what spin needed
+    String report = avian.Machine.compilationReport();
+    expect(report == null || report.startsWith("methods "));
+
+    // tracking is off, so only the derived sizes are given
+    expect(avian.Machine.memoryReport().startsWith("fixed "));
+
+    expect(avian.Machine.safepointReport().startsWith("safepoints "));
+
+    { Thread current = Thread.currentThread();
+      long before = avian.Machine.threadAllocatedBytes(current);
+      byte[][] arrays = new byte[16][];
+      for (int i = 0; i < arrays.length; ++i) {
+        arrays[i] = new byte[1024];
+      }
+      expect(avian.Machine.threadAllocatedBytes(current)
+             >= before + (arrays.length * 1024));
+
+      // spin used some, unless the platform can't say
+      long cpu = avian.Machine.threadCpuTime(current);
+      expect(cpu > 0 || cpu == -1);
+
+      // not every platform can pin threads, but one which can must be
+      // able to let a pinned thread go again
+      if (avian.Machine.setThreadAffinity(current, new int[] { 0 })) {
+        spin(10);
+        expect(avian.Machine.setThreadAffinity(current, null));
+      }
+
+      { boolean thrown = false;
+        try {
+          avian.Machine.setThreadAffinity(current, new int[] { -1 });
+        } catch (IllegalArgumentException e) {
+          thrown = true;
+        }
+        expect(thrown);
+      }
+    }
+
+    { final boolean[] called = new boolean[1];
+      Runnable handler = new Runnable() {
+          public void run() {
+            synchronized (called) {
+              called[0] = true;
+              called.notifyAll();
+            }
+          }
+        };
+      avian.Machine.addMemoryPressureHandler(handler);
+
+      // assume a 128MB heap, of which this leaves less than a quarter
+      // free
+      byte[][] ballast = new byte[100][];
+      for (int i = 0; i < ballast.length; ++i) {
+        ballast[i] = new byte[1024 * 1024];
+      }
+      System.gc();
+
+      synchronized (called) {
+        long end = System.currentTimeMillis() + 10000;
+        while (! called[0] && System.currentTimeMillis() < end) {
+          called.wait(100);
+        }
+      }
+      expect(called[0]);
+      expect(ballast[0] != null);
+
+      avian.Machine.removeMemoryPressureHandler(handler);
+    }
+  }
+}
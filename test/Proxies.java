@@ -31,6 +31,37 @@ public class Proxies {
     expect(foo.baz(42) == 43);
     expect(foo.bim(42L) == 41L);
     expect(foo.boom("hello").equals("ello"));
+
+    expect(Proxy.getProxyClass(Proxies.class.getClassLoader(), Foo.class)
+           == foo.getClass());
+
+    final Method[] methods = new Method[2];
+    Foo counter = (Foo) Proxy.newProxyInstance
+      (Proxies.class.getClassLoader(), new Class[] { Foo.class },
+       new InvocationHandler() {
+         public Object invoke(Object proxy, Method method, Object[] arguments)
+         {
+           if (method.getName().equals("bar")) {
+             expect(arguments == null);
+             expect(methods[0] == null || methods[0] == method);
+             methods[0] = method;
+             return "bar";
+           } else if (method.getName().equals("baz")) {
+             expect(methods[1] == null || methods[1] == method);
+             methods[1] = method;
+             return ((Integer) arguments[0]) * 2;
+           } else {
+             throw new IllegalArgumentException();
+           }
+         }
+       });
+
+    expect(counter.getClass() == foo.getClass());
+
+    for (int i = 0; i < 100; ++i) {
+      expect(counter.bar().equals("bar"));
+      expect(counter.baz(i) == i * 2);
+    }
   }
 
   private interface Foo {
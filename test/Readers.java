@@ -0,0 +1,142 @@
+import java.io.BufferedReader;
+import java.io.BufferedWriter;
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.InputStreamReader;
+import java.io.LineNumberReader;
+import java.io.OutputStreamWriter;
+import java.io.Reader;
+import java.io.StringReader;
+
+public class Readers {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  // returns at most one byte per read, so chars and lines are split
+  // across every possible boundary
+  private static class TrickleInputStream extends InputStream {
+    private final byte[] data;
+    private int position;
+
+    public TrickleInputStream(byte[] data) {
+      this.data = data;
+    }
+
+    public int read() {
+      return position < data.length ? data[position++] & 0xFF : -1;
+    }
+
+    public int read(byte[] b, int offset, int length) {
+      if (length == 0) {
+        return 0;
+      } else if (position < data.length) {
+        b[offset] = data[position++];
+        return 1;
+      } else {
+        return -1;
+      }
+    }
+  }
+
+  private static String readAll(Reader r, int chunk) throws IOException {
+    StringBuilder sb = new StringBuilder();
+    char[] buffer = new char[chunk];
+    int c;
+    while ((c = r.read(buffer, 0, chunk)) != -1) {
+      sb.append(buffer, 0, c);
+    }
+    return sb.toString();
+  }
+
+  private static byte[] encode(String s, int chunk) throws IOException {
+    ByteArrayOutputStream out = new ByteArrayOutputStream();
+    OutputStreamWriter w = new OutputStreamWriter(out);
+    for (int i = 0; i < s.length(); i += chunk) {
+      w.write(s.substring(i, Math.min(s.length(), i + chunk)));
+    }
+    w.flush();
+    return out.toByteArray();
+  }
+
+  private static void testDecoding() throws IOException {
+    String s = "plain, café, ♥, 😀 and \u0000 too";
+    byte[] utf8 = new byte[] {
+      'p', 'l', 'a', 'i', 'n', ',', ' ', 'c', 'a', 'f', (byte) 0xc3,
+      (byte) 0xa9, ',', ' ', (byte) 0xe2, (byte) 0x99, (byte) 0xa5, ',', ' ',
+      (byte) 0xf0, (byte) 0x9f, (byte) 0x98, (byte) 0x80, ' ', 'a', 'n',
+      'd', ' ', 0, ' ', 't', 'o', 'o' };
+
+    expect(java.util.Arrays.equals(encode(s, s.length()), utf8));
+
+    for (int chunk = 1; chunk < 5; ++chunk) {
+      expect(readAll(new InputStreamReader
+                     (new TrickleInputStream(utf8), "UTF-8"), chunk)
+             .equals(s));
+      expect(readAll(new InputStreamReader
+                     (new ByteArrayInputStream(utf8), "UTF-8"), chunk)
+             .equals(s));
+    }
+
+    StringBuilder sb = new StringBuilder();
+    for (int i = 0; i < 10000; ++i) {
+      sb.append((char) ('a' + (i % 26)));
+      if (i % 100 == 0) {
+        sb.append("é😀");
+      }
+    }
+    String mixed = sb.toString();
+    expect(readAll(new InputStreamReader
+                   (new ByteArrayInputStream(encode(mixed, 7)), "UTF-8"),
+                   1000)
+           .equals(mixed));
+  }
+
+  private static void testLines() throws IOException {
+    String text = "one\ntwo\r\nthree\rfour\r\n\nsix";
+    String[] lines = { "one", "two", "three", "four", "", "six" };
+
+    for (int size = 1; size < 8; ++size) {
+      BufferedReader r = new BufferedReader
+        (new InputStreamReader
+         (new TrickleInputStream(encode(text, 3)), "UTF-8"), size);
+      for (int i = 0; i < lines.length; ++i) {
+        expect(lines[i].equals(r.readLine()));
+      }
+      expect(r.readLine() == null);
+    }
+
+    // a "\r\n" split by a readLine must still count as one terminator
+    BufferedReader r = new BufferedReader(new StringReader("a\r\nb"), 2);
+    expect(r.readLine().equals("a"));
+    expect(r.read() == 'b');
+    expect(r.read() == -1);
+
+    LineNumberReader n = new LineNumberReader(new StringReader(text));
+    n.readLine();
+    expect(n.getLineNumber() == 1);
+    n.readLine();
+    expect(n.read() == 't');
+    expect(n.getLineNumber() == 2);
+  }
+
+  private static void testWriter() throws IOException {
+    ByteArrayOutputStream out = new ByteArrayOutputStream();
+    BufferedWriter w = new BufferedWriter(new OutputStreamWriter(out), 4);
+    w.write("café");
+    w.write(' ');
+    w.write("latte, au lait", 7, 7);
+    w.write(new char[] { '!', '?' }, 0, 1);
+    w.flush();
+    expect(new String(out.toByteArray(), "UTF-8").equals
+           ("café au lait!"));
+  }
+
+  public static void main(String[] args) throws IOException {
+    testDecoding();
+    testLines();
+    testWriter();
+  }
+}
@@ -2,10 +2,22 @@ import java.lang.ref.ReferenceQueue;
 import java.lang.ref.Reference;
 import java.lang.ref.WeakReference;
 import java.lang.ref.PhantomReference;
+import java.lang.ref.SoftReference;
 import java.util.WeakHashMap;
 
 public class References {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
   public static void main(String[] args) {
+    { // with most of the heap free, a soft reference outlives a
+      // collection which a weak one would not
+      SoftReference<Object> sr = new SoftReference<Object>(new Object());
+      System.gc();
+      expect(sr.get() != null);
+    }
+
     Object a = new Object();
     Object b = new Object();
     Object c = new Object();
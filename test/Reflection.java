@@ -1,5 +1,6 @@
 import java.lang.reflect.Method;
 import java.lang.reflect.Field;
+import java.lang.reflect.InvocationTargetException;
 
 public class Reflection {
   public static boolean booleanMethod() {
@@ -38,6 +39,70 @@ public class Reflection {
     if (! v) throw new RuntimeException();
   }
 
+  private interface Adder {
+    public long add(int a, long b);
+  }
+
+  private static class MyAdder implements Adder {
+    public long value;
+    public static String name;
+
+    public long add(int a, long b) {
+      return a + b + value;
+    }
+
+    private double scale(double d, String s) {
+      return d * s.length();
+    }
+
+    public void fail() {
+      throw new UnsupportedOperationException();
+    }
+  }
+
+  // makes enough calls to use both reflective paths, where the VM has
+  // two
+  private static void testRepeatedInvoke() throws Exception {
+    MyAdder adder = new MyAdder();
+    adder.value = 1;
+    Method add = Adder.class.getMethod("add", int.class, long.class);
+    Method scale = MyAdder.class.getDeclaredMethod
+      ("scale", double.class, String.class);
+    scale.setAccessible(true);
+    Method fail = MyAdder.class.getMethod("fail");
+    Field value = MyAdder.class.getField("value");
+    Field name = MyAdder.class.getField("name");
+
+    for (int i = 0; i < 100; ++i) {
+      expect((Long) add.invoke(adder, i, 1L << 40) == i + (1L << 40) + 1);
+      expect((Double) scale.invoke(adder, 0.5, "abcd") == 2.0);
+
+      try {
+        fail.invoke(adder);
+        expect(false);
+      } catch (InvocationTargetException e) {
+        expect(e.getCause() instanceof UnsupportedOperationException);
+      }
+
+      try {
+        add.invoke(adder, "one", 2L);
+        expect(false);
+      } catch (IllegalArgumentException e) { }
+
+      value.set(adder, (long) i << 33);
+      expect((Long) value.get(adder) == (long) i << 33);
+      expect(adder.value == (long) i << 33);
+
+      name.set(null, "x" + i);
+      expect(name.get(null).equals("x" + i));
+
+      try {
+        value.set(adder, "one");
+        expect(false);
+      } catch (IllegalArgumentException e) { }
+    }
+  }
+
   public static void main(String[] args) throws Exception {
     Class system = Class.forName("java.lang.System");
     Field out = system.getDeclaredField("out");
@@ -67,5 +132,7 @@ public class Reflection {
 
     expect(7.0 == (Double) Reflection.class.getMethod
            ("doubleMethod").invoke(null));
+
+    testRepeatedInvoke();
   }
 }
@@ -0,0 +1,226 @@
+import java.util.regex.Matcher;
+import java.util.regex.Pattern;
+import java.util.regex.PatternSyntaxException;
+
+public class Regex {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static boolean equal(Object a, Object b) {
+    return a == b || (a != null && a.equals(b));
+  }
+
+  private static boolean arraysEqual(Object[] a, Object[] b) {
+    if (a.length != b.length) {
+      return false;
+    }
+
+    for (int i = 0; i < a.length; ++i) {
+      if (! equal(a[i], b[i])) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  private static void expectMatch(String regex, String input) {
+    expect(Pattern.matches(regex, input));
+  }
+
+  private static void expectNoMatch(String regex, String input) {
+    expect(! Pattern.matches(regex, input));
+  }
+
+  // expects the first match of regex in input to have the specified
+  // groups, the first of which is the whole match
+  private static void expectGroups(String regex, String input,
+                                   String ... groups)
+  {
+    Matcher m = Pattern.compile(regex).matcher(input);
+    expect(m.find());
+    expect(m.groupCount() == groups.length - 1);
+    for (int i = 0; i < groups.length; ++i) {
+      expect(equal(m.group(i), groups[i]));
+    }
+  }
+
+  private static void expectSyntaxError(String regex) {
+    try {
+      Pattern.compile(regex);
+      expect(false);
+    } catch (PatternSyntaxException e) {
+      expect(e.getPattern().equals(regex));
+    }
+  }
+
+  private static void testMatches() {
+    expectMatch("abc", "abc");
+    expectNoMatch("abc", "abcd");
+    expectMatch("a.c", "abc");
+    expectNoMatch("a.c", "a\nc");
+    expectMatch("a*b+c?", "aaab");
+    expectMatch("a*b+c?", "bc");
+    expectNoMatch("a*b+c?", "ac");
+    expectMatch("(ab|cd)*", "abcdab");
+    expectNoMatch("(ab|cd)*", "abc");
+    expectMatch("a{2,3}", "aaa");
+    expectNoMatch("a{2,3}", "aaaa");
+    expectMatch("a{2,}", "aaaaa");
+    expectMatch("[a-c]+[^a-c]", "abcx");
+    expectNoMatch("[a-c]+[^a-c]", "abcc");
+    expectMatch("[a-z&&[^aeiou]]+", "xyz");
+    expectNoMatch("[a-z&&[^aeiou]]+", "xaz");
+    expectMatch("\\d+\\s\\w+", "42 is_it");
+    expectMatch("\\p{Upper}\\p{Lower}*", "Avian");
+    expectMatch("\\Q.*\\E", ".*");
+    expectNoMatch("\\Q.*\\E", "ab");
+    expectMatch("\\x41\\u0042\\0103\\t", "ABC\t");
+    expectMatch("(?i)hello", "HeLLo");
+    expectMatch("a(?i:b)c", "aBc");
+    expectNoMatch("a(?i:b)c", "aBC");
+    expectMatch("(a)\\1", "aa");
+    expectNoMatch("(a)\\1", "ab");
+    expectMatch("(?<x>b)\\k<x>", "bb");
+    expectMatch("a++b", "aab");
+    expectNoMatch("a++a", "aaa");
+    expectNoMatch("(?>a*)a", "aaa");
+    expectMatch("(?>a*)b", "aab");
+    expectMatch(".*", "");
+    expectMatch("", "");
+    expectNoMatch("", "a");
+
+    expect(Pattern.compile("A.C", Pattern.CASE_INSENSITIVE | Pattern.DOTALL)
+           .matcher("a\nc").matches());
+    expect(Pattern.compile("a b # comment", Pattern.COMMENTS)
+           .matcher("ab").matches());
+    expect(Pattern.compile("a.c", Pattern.LITERAL).matcher("a.c").matches());
+    expect(! Pattern.compile("a.c", Pattern.LITERAL)
+           .matcher("abc").matches());
+
+    expect(Pattern.compile("ab").matcher("abc").lookingAt());
+    expect(! Pattern.compile("bc").matcher("abc").lookingAt());
+  }
+
+  private static void testFind() {
+    expectGroups("b+", "abbbc", "bbb");
+    expectGroups("(a+)(b*)", "xaabby", "aabb", "aa", "bb");
+    expectGroups("(a)|(b)", "b", "b", null, "b");
+    expectGroups("(\\w+)@(\\w+)\\.com", "mail joe@example.com now",
+                 "joe@example.com", "joe", "example");
+    expectGroups("a.*?c", "abcbc", "abc");
+    expectGroups("a.*c", "abcbc", "abcbc");
+    expectGroups("(?<=a)b", "cbab", "b");
+    expectGroups("(?<!a)b", "abcb", "b");
+    expectGroups("b(?=c)", "babc", "b");
+    expectGroups("b(?!a)", "babc", "b");
+    expectGroups("\\bcat\\b", "concat cat", "cat");
+    expectGroups("x|", "abc", "");
+
+    Matcher m = Pattern.compile("^b").matcher("a\nb");
+    expect(! m.find());
+    m = Pattern.compile("^b", Pattern.MULTILINE).matcher("a\nb");
+    expect(m.find());
+    expect(m.start() == 2);
+    m = Pattern.compile("a$").matcher("a\n");
+    expect(m.find());
+    expect(m.start() == 0);
+
+    m = Pattern.compile("(?<number>\\d+)").matcher("a12b345");
+    expect(m.find());
+    expect(m.group("number").equals("12"));
+    expect(m.start(1) == 1 && m.end(1) == 3);
+    expect(m.find());
+    expect(m.group("number").equals("345"));
+    expect(! m.find());
+
+    m = Pattern.compile("a*").matcher("baaa");
+    expect(m.find() && m.start() == 0 && m.end() == 0);
+    expect(m.find() && m.start() == 1 && m.end() == 4);
+    expect(m.find() && m.start() == 4 && m.end() == 4);
+    expect(! m.find());
+
+    m = Pattern.compile("\\d").matcher("1a2b3");
+    expect(m.find(2) && m.start() == 2);
+    m.region(0, 2);
+    expect(m.find() && m.start() == 0);
+    expect(! m.find());
+
+    m = Pattern.compile("\\Ga").matcher("aab");
+    expect(m.find() && m.start() == 0);
+    expect(m.find() && m.start() == 1);
+    expect(! m.find());
+
+    StringBuilder sb = new StringBuilder();
+    for (int i = 0; i < 1000; ++i) {
+      sb.append("ab");
+    }
+    sb.append("abc");
+    m = Pattern.compile("(ab)+c").matcher(sb);
+    expect(m.find());
+    expect(m.start() == 0 && m.end() == sb.length());
+    expect(m.group(1).equals("ab"));
+    expect(m.start(1) == sb.length() - 3);
+  }
+
+  private static void testSplit() {
+    expect(arraysEqual(" a\tb  c ".split("\\s+"),
+                       new String[] { "", "a", "b", "c" }));
+    expect(arraysEqual("a|b||c".split("\\|"),
+                       new String[] { "a", "b", "", "c" }));
+    expect(arraysEqual("a1b22c333".split("\\d+"),
+                       new String[] { "a", "b", "c" }));
+    expect(arraysEqual("a1b22c333".split("\\d+", -1),
+                       new String[] { "a", "b", "c", "" }));
+    expect(arraysEqual("a1b22c333".split("\\d+", 2),
+                       new String[] { "a", "b22c333" }));
+    expect(arraysEqual("a, b ,c".split("\\s*,\\s*"),
+                       new String[] { "a", "b", "c" }));
+  }
+
+  private static void testReplace() {
+    expect("a1b22c".replaceAll("\\d+", "#").equals("a#b#c"));
+    expect("a1b22c".replaceFirst("\\d+", "#").equals("a#b22c"));
+    expect("john smith".replaceAll("(\\w+) (\\w+)", "$2, $1")
+           .equals("smith, john"));
+    expect("ab".replaceAll("(?<first>a)", "${first}$0").equals("aab"));
+    expect("a.b".replaceAll("\\.", "\\$").equals("a$b"));
+    expect("abc".replaceAll("x", "y").equals("abc"));
+    expect("abc".replaceAll("", "-").equals("-a-b-c-"));
+    expect("a$b".replaceAll("a", Matcher.quoteReplacement("$\\"))
+           .equals("$\\$b"));
+    expect("a.c".replaceAll(Pattern.quote("."), "b").equals("abc"));
+    expect("x\\Ey".matches(Pattern.quote("x\\Ey")));
+
+    Matcher m = Pattern.compile("(\\d)").matcher("a1b2c");
+    StringBuffer sb = new StringBuffer();
+    while (m.find()) {
+      m.appendReplacement(sb, "<$1>");
+    }
+    m.appendTail(sb);
+    expect(sb.toString().equals("a<1>b<2>c"));
+  }
+
+  private static void testSyntaxErrors() {
+    expectSyntaxError("(");
+    expectSyntaxError("a)");
+    expectSyntaxError("[a");
+    expectSyntaxError("*a");
+    expectSyntaxError("a{2");
+    expectSyntaxError("a{3,2}");
+    expectSyntaxError("\\");
+    expectSyntaxError("[b-a]");
+    expectSyntaxError("(?<=a*)b");
+    expectSyntaxError("\\k<missing>");
+    expectSyntaxError("(?z)");
+  }
+
+  public static void main(String[] args) {
+    testMatches();
+    testFind();
+    testSplit();
+    testReplace();
+    testSyntaxErrors();
+  }
+}
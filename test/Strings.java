@@ -105,11 +105,110 @@ public class Strings {
            (prematureEOS ? "\u00ae\ufffd" : "\u00ae\uaeaf"));
   }
 
+  private static void testComparisons() {
+    String fox = "the quick brown fox jumps over the lazy dog";
+    // a builder may return a string sharing its buffer, which is kept
+    // in a different form than a literal
+    StringBuilder sb = new StringBuilder();
+    for (int i = 0; i < fox.length(); ++i) {
+      sb.append(fox.charAt(i));
+    }
+    String built = sb.toString();
+
+    expect("hello".hashCode() == 99162322);
+    expect(fox.hashCode() == -2082818701);
+    expect(built.hashCode() == -2082818701);
+    expect("caf\u00e9 au lait".hashCode() == 2095405773);
+    expect("".hashCode() == 0);
+
+    expect(fox.equals(built) && built.equals(fox));
+    expect(fox.compareTo(built) == 0);
+    expect(! fox.equals(built.replace('g', 'G')));
+    expect(fox.compareTo(built.replace('g', 'G')) > 0);
+    expect("abc".compareTo("abd") < 0);
+    expect("abc".compareTo("ab") == 1);
+    expect("caf\u00e9".compareTo("cafe") > 0);
+    expect("caf\u00e9".equals("caf\u00e9"));
+
+    expect(fox.regionMatches(4, "quick", 0, 5));
+    expect(fox.regionMatches(4, "a quick", 2, 5));
+    expect(! fox.regionMatches(4, "quack", 0, 5));
+    expect(! fox.regionMatches(40, "dog!", 0, 4));
+    expect(! fox.regionMatches(-1, "the", 0, 3));
+    expect(fox.regionMatches(true, 4, "QUICK", 0, 5));
+    expect(built.startsWith("the") && built.startsWith("quick", 4));
+    expect(! built.startsWith("quick", -1) && ! "a".startsWith("ab"));
+    expect(built.endsWith("dog") && ! "a".endsWith("ba"));
+  }
+
+  private static void testStringBuilder() {
+    StringBuilder sb = new StringBuilder();
+    sb.append(0).append(' ').append(-7).append(' ').append(1234567890)
+      .append(' ').append(Integer.MIN_VALUE).append(' ')
+      .append(Integer.MAX_VALUE);
+    expect(sb.toString().equals
+           ("0 -7 1234567890 -2147483648 2147483647"));
+
+    sb = new StringBuilder();
+    sb.append(-1L).append(' ').append(12345678901L).append(' ')
+      .append(Long.MIN_VALUE).append(' ').append(Long.MAX_VALUE);
+    expect(sb.toString().equals
+           ("-1 12345678901 -9223372036854775808 9223372036854775807"));
+
+    // strings returned by toString must not see later changes
+    sb = new StringBuilder();
+    sb.append("0123456789abcdef");
+    String s = sb.toString();
+    sb.setCharAt(0, 'x');
+    sb.delete(1, 3);
+    sb.insert(1, '-');
+    expect(s.equals("0123456789abcdef"));
+    expect(sb.toString().equals("x-3456789abcdef"));
+
+    String t = sb.toString();
+    sb.setLength(2);
+    sb.append(true).append((Object) null).append(new char[] { 'a', 'b' }, 1, 1);
+    expect(t.equals("x-3456789abcdef"));
+    expect(sb.toString().equals("x-truenullb"));
+
+    sb = new StringBuilder();
+    for (int i = 0; i < 1000; ++i) {
+      sb.append((char) ('a' + (i % 26)));
+    }
+    expect(sb.length() == 1000);
+    expect(sb.charAt(999) == 'a' + (999 % 26));
+    sb.insert(500, "middle");
+    expect(sb.indexOf("middle") == 500);
+    expect(sb.substring(500, 506).equals("middle"));
+    sb.replace(0, 506, "");
+    expect(sb.length() == 500);
+    expect(sb.charAt(0) == 'a' + (500 % 26));
+
+    sb.setLength(0);
+    sb.append(sb).append(new StringBuilder("abc")).append("d", 0, 1);
+    sb.append((CharSequence) sb);
+    expect(sb.toString().equals("abcdabcd"));
+
+    sb.setLength(10);
+    expect(sb.length() == 10 && sb.charAt(9) == 0);
+  }
+
   public static void main(String[] args) throws Exception {
     expect(new String(new byte[] { 99, 111, 109, 46, 101, 99, 111, 118, 97,
                                    116, 101, 46, 110, 97, 116, 46, 98, 117,
                                    115, 46, 83, 121, 109, 98, 111, 108 })
       .equals("com.ecovate.nat.bus.Symbol"));
+
+    { String ascii = new String(new char[] { 'a', 'b', 'c' });
+      expect(ascii.equals("abc"));
+      expect(ascii.hashCode() == "abc".hashCode());
+      expect(ascii.intern() == "abc");
+
+      String latin = new String(new char[] { 'a', '\u00e9', 'c' });
+      expect(latin.equals("a\u00e9c"));
+      expect(latin.charAt(1) == '\u00e9');
+      expect(latin.hashCode() == "a\u00e9c".hashCode());
+    }
     
     final String months = "Jan\u00aeFeb\u00aeMar\u00ae";
     expect(months.split("\u00ae").length == 3);
@@ -162,6 +261,9 @@ public class Strings {
     expect(Character.forDigit(Character.digit('f', 16), 16) == 'f');
     expect(Character.forDigit(Character.digit('z', 36), 36) == 'z');
 
+    testStringBuilder();
+    testComparisons();
+
     testDecode(false);
     testDecode(true);
 
@@ -1,4 +1,6 @@
 public class Threads implements Runnable {
+  private static volatile boolean stop;
+
   public static void main(String[] args) {
     { Threads test = new Threads();
       Thread thread = new Thread(test);
@@ -33,9 +35,128 @@ public class Threads implements Runnable {
       System.out.println("\nInterrupted!");
     }
 
+    { // a collection must not wait forever for a thread spinning in
+      // a loop which never allocates
+      Thread thread = new Thread() {
+          public void run() {
+            while (! stop) { }
+          }
+        };
+      thread.start();
+
+      for (int i = 0; i < 4; ++i) {
+        System.gc();
+      }
+
+      stop = true;
+      try {
+        thread.join();
+      } catch (InterruptedException e) {
+        throw new RuntimeException(e);
+      }
+    }
+
+    { // a thread with a requested stack size must still report
+      // overflow rather than crash
+      final boolean[] overflowed = new boolean[1];
+      Thread thread = new Thread(null, new Runnable() {
+          public void run() {
+            try {
+              recurse(0);
+            } catch (StackOverflowError e) {
+              overflowed[0] = true;
+            }
+          }
+        }, "small stack", 64 * 1024);
+      thread.start();
+
+      try {
+        thread.join();
+      } catch (InterruptedException e) {
+        throw new RuntimeException(e);
+      }
+
+      if (! overflowed[0]) throw new RuntimeException();
+    }
+
+    { // many short-lived threads, each started after the last exits,
+      // so native threads are reused
+      final int[] count = new int[1];
+      for (int i = 0; i < 1000; ++i) {
+        Thread thread = new Thread() {
+            public void run() {
+              synchronized (count) {
+                ++ count[0];
+              }
+            }
+          };
+        thread.start();
+
+        try {
+          thread.join();
+        } catch (InterruptedException e) {
+          throw new RuntimeException(e);
+        }
+      }
+
+      if (count[0] != 1000) throw new RuntimeException();
+    }
+
+    { // many threads with identical stacks, each holding an object
+      // only its own stack refers to, across minor collections
+      final Object lock = new Object();
+      final boolean[] go = new boolean[1];
+      final int[] failures = new int[1];
+      Thread[] threads = new Thread[200];
+      for (int i = 0; i < threads.length; ++i) {
+        final int index = i;
+        threads[i] = new Thread() {
+            public void run() {
+              Integer[] mine = new Integer[] { new Integer(index) };
+              synchronized (lock) {
+                while (! go[0]) {
+                  try {
+                    lock.wait();
+                  } catch (InterruptedException e) {
+                    throw new RuntimeException(e);
+                  }
+                }
+                if (mine[0].intValue() != index) {
+                  ++ failures[0];
+                }
+              }
+            }
+          };
+        threads[i].start();
+      }
+
+      for (int i = 0; i < 1024; ++i) {
+        byte[] garbage = new byte[16 * 1024];
+      }
+
+      synchronized (lock) {
+        go[0] = true;
+        lock.notifyAll();
+      }
+
+      for (int i = 0; i < threads.length; ++i) {
+        try {
+          threads[i].join();
+        } catch (InterruptedException e) {
+          throw new RuntimeException(e);
+        }
+      }
+
+      if (failures[0] != 0) throw new RuntimeException();
+    }
+
     System.out.println("finished");
   }
 
+  private static int recurse(int depth) {
+    return recurse(depth + 1) + 1;
+  }
+
   public void run() {
     synchronized (this) {
       int i = 0;
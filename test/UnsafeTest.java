@@ -1,11 +1,29 @@
 import sun.misc.Unsafe;
 
 public class UnsafeTest {
+  private int count;
+  private Object value;
+
   private static void expect(boolean v) {
     if (! v) throw new RuntimeException();
   }
 
-  public static void main(String[] args) {
+  private static class Mixed {
+    byte b;
+    long l;
+    short s;
+    Object o;
+    int i;
+    char c;
+  }
+
+  private static class Padded {
+    int a;
+    @sun.misc.Contended int b;
+    int c;
+  }
+
+  public static void main(String[] args) throws Exception {
     Unsafe u = avian.Machine.getUnsafe();
 
     final long size = 64;
@@ -61,5 +79,95 @@ public class UnsafeTest {
     } finally {
       u.freeMemory(memory);
     }
+
+    UnsafeTest test = new UnsafeTest();
+    long countOffset = u.objectFieldOffset
+      (UnsafeTest.class.getDeclaredField("count"));
+    long valueOffset = u.objectFieldOffset
+      (UnsafeTest.class.getDeclaredField("value"));
+
+    expect(u.compareAndSwapInt(test, countOffset, 0, 42));
+    expect(! u.compareAndSwapInt(test, countOffset, 0, 43));
+    expect(test.count == 42);
+
+    u.putIntVolatile(test, countOffset, 7);
+    expect(test.count == 7);
+
+    u.putOrderedInt(test, countOffset, 8);
+    expect(test.count == 8);
+
+    Object o = new Object();
+    expect(u.compareAndSwapObject(test, valueOffset, null, o));
+    expect(! u.compareAndSwapObject(test, valueOffset, null, o));
+    expect(test.value == o);
+
+    // however fields are laid out, each must be aligned to its size and
+    // none may overlap another (references are at least four bytes)
+    String[] names = { "b", "l", "s", "o", "i", "c" };
+    int[] sizes = { 1, 8, 2, 4, 4, 2 };
+    long[] offsets = new long[names.length];
+    for (int i = 0; i < names.length; ++i) {
+      offsets[i] = u.objectFieldOffset
+        (Mixed.class.getDeclaredField(names[i]));
+      expect(offsets[i] % sizes[i] == 0);
+      for (int j = 0; j < i; ++j) {
+        expect(offsets[i] + sizes[i] <= offsets[j]
+               || offsets[j] + sizes[j] <= offsets[i]);
+      }
+    }
+
+    // references are grouped ahead of primitives, so the collector
+    // scans one contiguous run
+    expect(offsets[3] < offsets[1]);
+
+    long a = u.objectFieldOffset(Padded.class.getDeclaredField("a"));
+    long b = u.objectFieldOffset(Padded.class.getDeclaredField("b"));
+    long c = u.objectFieldOffset(Padded.class.getDeclaredField("c"));
+    expect(Math.abs(b - a) >= 64 && Math.abs(b - c) >= 64);
+
+    Mixed m = new Mixed();
+    m.b = -1;
+    m.l = 0x1234567890ABCDEFL;
+    m.s = -2;
+    m.o = o;
+    m.i = 0x12345678;
+    m.c = 'x';
+    expect(m.b == -1 && m.l == 0x1234567890ABCDEFL && m.s == -2
+           && m.o == o && m.i == 0x12345678 && m.c == 'x');
+
+    { // copies and fills large enough to be done in chunks, and to
+      // bypass the cache
+      final int length = 5 * 1024 * 1024;
+      long base = u.arrayBaseOffset(byte[].class);
+      byte[] array = new byte[length];
+      for (int i = 0; i < length; ++i) {
+        array[i] = (byte) i;
+      }
+
+      long big = u.allocateMemory(length);
+      try {
+        u.copyMemory(array, base, null, big, length);
+        for (int i = 0; i < length; i += 4093) {
+          expect(u.getByte(big + i) == (byte) i);
+        }
+
+        // overlapping, within one array, towards its end
+        u.copyMemory(array, base, array, base + 3, length - 3);
+        for (int i = 3; i < length; i += 4093) {
+          expect(array[i] == (byte) (i - 3));
+        }
+
+        u.setMemory(big, length, (byte) 7);
+        for (int i = 0; i < length; i += 4093) {
+          expect(u.getByte(big + i) == 7);
+        }
+
+        u.setMemory(array, base + 1, length - 2, (byte) 9);
+        expect(array[0] == 0 && array[1] == 9 && array[length - 2] == 9
+               && array[length - 1] == (byte) (length - 4));
+      } finally {
+        u.freeMemory(big);
+      }
+    }
   }
 }
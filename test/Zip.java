@@ -1,6 +1,12 @@
 import java.io.InputStream;
 import java.io.File;
+import java.nio.ByteBuffer;
 import java.util.Enumeration;
+import java.util.zip.Adler32;
+import java.util.zip.CRC32;
+import java.util.zip.Checksum;
+import java.util.zip.Deflater;
+import java.util.zip.Inflater;
 import java.util.zip.ZipFile;
 import java.util.zip.ZipEntry;
 
@@ -25,7 +31,121 @@ public class Zip {
     return null;
   }
   
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static void testBuffers() throws Exception {
+    byte[] data = new byte[10000];
+    for (int i = 0; i < data.length; ++i) {
+      data[i] = (byte) ((i * 7) % 13);
+    }
+
+    ByteBuffer input = ByteBuffer.allocateDirect(data.length);
+    input.put(data);
+    input.flip();
+
+    // run each twice, so the second pair reuses the pooled streams
+    for (int round = 0; round < 2; ++round) {
+      Deflater deflater = new Deflater();
+      deflater.setInput(input);
+      deflater.finish();
+      ByteBuffer compressed = ByteBuffer.allocateDirect(data.length);
+      while (! deflater.finished()) {
+        deflater.deflate(compressed);
+      }
+      deflater.end();
+      expect(input.remaining() == 0);
+      compressed.flip();
+
+      Inflater inflater = new Inflater();
+      inflater.setInput(compressed);
+      ByteBuffer direct = ByteBuffer.allocateDirect(data.length / 2);
+      byte[] array = new byte[data.length];
+      ByteBuffer heap = ByteBuffer.wrap(array);
+      // the first half goes to a direct buffer, the rest to an array
+      while (direct.hasRemaining()) {
+        inflater.inflate(direct);
+      }
+      while (! inflater.finished()) {
+        inflater.inflate(heap);
+      }
+      inflater.end();
+      expect(compressed.remaining() == 0);
+      expect(heap.position() == data.length / 2);
+
+      direct.flip();
+      for (int i = 0; i < data.length / 2; ++i) {
+        expect(direct.get() == data[i]);
+      }
+      for (int i = 0; i < data.length / 2; ++i) {
+        expect(array[i] == data[(data.length / 2) + i]);
+      }
+
+      input.rewind();
+    }
+  }
+
+  // checks that bulk updates, which are done natively once they are
+  // long enough, agree with byte-at-a-time ones
+  private static void testChecksum(Checksum bulk, Checksum single,
+                                   byte[] data)
+  {
+    for (int length = 0; length < data.length; length = (length * 2) + 1) {
+      bulk.reset();
+      single.reset();
+      bulk.update(data, 1, length);
+      for (int i = 1; i < length + 1; ++i) {
+        single.update(data[i]);
+      }
+      expect(bulk.getValue() == single.getValue());
+    }
+  }
+
+  private static void testChecksums() throws Exception {
+    byte[] check = "123456789".getBytes("UTF-8");
+
+    CRC32 crc = new CRC32();
+    crc.update(check);
+    expect(crc.getValue() == 0xCBF43926L);
+
+    Adler32 adler = new Adler32();
+    adler.update("Wikipedia".getBytes("UTF-8"));
+    expect(adler.getValue() == 0x11E60398L);
+
+    byte[] data = new byte[10000];
+    for (int i = 0; i < data.length; ++i) {
+      data[i] = (byte) ((i * 251) ^ (i >> 3));
+    }
+
+    testChecksum(new CRC32(), new CRC32(), data);
+    testChecksum(new Adler32(), new Adler32(), data);
+
+    ByteBuffer direct = ByteBuffer.allocateDirect(data.length);
+    direct.put(data);
+    direct.flip();
+
+    crc.reset();
+    crc.update(direct);
+    expect(direct.remaining() == 0);
+    long value = crc.getValue();
+    crc.reset();
+    crc.update(data);
+    expect(crc.getValue() == value);
+
+    direct.rewind();
+    adler.reset();
+    adler.update(direct);
+    value = adler.getValue();
+    adler.reset();
+    adler.update(data);
+    expect(adler.getValue() == value);
+  }
+
   public static void main(String[] args) throws Exception {
+    testBuffers();
+    testChecksums();
+
     ZipFile file = new ZipFile
       (findJar(new File(System.getProperty("user.dir"))));
 
@@ -0,0 +1,52 @@
+#!/bin/sh
+
+# Runs "make bench" for each combination of the build options which
+# affect calling conventions and collects the results as a single JSON
+# array, one entry per build.  Like ci.sh, extra make arguments may be
+# passed in ${flags}.  The interpreter ignores tails and continuations,
+# so only the default conventions are measured for it.  By default,
+# only the benchmarks whose names start with "calls." are run.
+
+set -e
+
+modes=${modes:-"fast small"}
+processes=${processes:-"compile interpret"}
+filter=${filter:-"calls."}
+output=${1:-build/bench.json}
+results=${output}.tmp
+
+mkdir -p $(dirname ${output})
+
+echo "[" >${output}
+separator=""
+
+for mode in ${modes}; do
+  for process in ${processes}; do
+    for tails in false true; do
+      for continuations in false true; do
+        if [ "${process}" != "compile" ] \
+            && [ "${tails}" = "true" -o "${continuations}" = "true" ]; then
+          continue
+        fi
+
+        make ${flags} mode=${mode} process=${process} tails=${tails} \
+          continuations=${continuations} bench-args="-filter ${filter}" \
+          bench-output=${results} bench
+
+        printf "%s{\"mode\": \"%s\", \"process\": \"%s\", " \
+          "${separator}" ${mode} ${process} >>${output}
+        printf "\"tails\": %s, \"continuations\": %s,\n \"benchmarks\": " \
+          ${tails} ${continuations} >>${output}
+        cat ${results} >>${output}
+        printf "}" >>${output}
+        separator=",
+"
+      done
+    done
+  done
+done
+
+printf "\n]\n" >>${output}
+rm -f ${results}
+
+echo "wrote ${output}"
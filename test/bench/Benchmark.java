@@ -0,0 +1,30 @@
+package bench;
+
+public abstract class Benchmark {
+  private final String name;
+
+  protected Benchmark(String name) {
+    this.name = name;
+  }
+
+  public String name() {
+    return name;
+  }
+
+  // Performs the operation being measured the specified number of
+  // times, returning a value which depends on all of them so the work
+  // can't be skipped.
+  public abstract int run(int operations);
+
+  // True if the harness should also record collection pauses, the
+  // allocation rate and peak memory use while this benchmark runs.
+  public boolean measuresMemory() {
+    return false;
+  }
+
+  // Returns the number of bytes allocated by threads other than the
+  // caller's on behalf of this benchmark since the last call.
+  public long otherAllocatedBytes() {
+    return 0;
+  }
+}
@@ -0,0 +1,195 @@
+package bench;
+
+// Call-heavy microbenchmarks for comparing the calling conventions
+// used by the tails=true and continuations=true builds with the
+// default ones, as well as the cost of virtual and interface dispatch.
+public class Calls {
+  // recursive benchmarks unwind after this many calls so builds
+  // which don't support tail calls won't overflow the stack
+  private static final int Depth = 100;
+
+  private static int add(int a, int b) {
+    return a + b;
+  }
+
+  private static int sum(int a, int b, int c, int d, int e, int f, int g,
+                         int h)
+  {
+    return a + b + c + d + e + f + g + h;
+  }
+
+  private static int countDown(int n, int accumulator) {
+    if (n == 0) {
+      return accumulator;
+    } else {
+      return countDown(n - 1, accumulator + 1);
+    }
+  }
+
+  private static int fib(int n) {
+    return n < 2 ? n : fib(n - 1) + fib(n - 2);
+  }
+
+  // the number of calls made by fib(n), including the outermost one
+  private static int fibCalls(int n) {
+    return n < 2 ? 1 : fibCalls(n - 1) + fibCalls(n - 2) + 1;
+  }
+
+  private interface Adder {
+    public int add(int a, int b);
+  }
+
+  private static class Plus implements Adder {
+    public int add(int a, int b) {
+      return a + b;
+    }
+  }
+
+  private static class Minus extends Plus {
+    public int add(int a, int b) {
+      return a - b;
+    }
+  }
+
+  private static class Times extends Plus {
+    public int add(int a, int b) {
+      return a * b;
+    }
+  }
+
+  private interface Bouncer {
+    public int bounce(int n);
+  }
+
+  // like test/extra/Tails.java, passes control between static,
+  // interface and virtual methods, always in tail position
+  private static class Bounce implements Bouncer {
+    public int bounce(int n) {
+      return n == 0 ? 0 : relay(n - 1, 1, 2, 3, 4, 5);
+    }
+
+    public int relay(int n, int a, int b, int c, int d, int e) {
+      return n == 0 ? a + b + c + d + e : bounceStatic(this, n - 1);
+    }
+  }
+
+  private static int bounceStatic(Bouncer b, int n) {
+    return n == 0 ? 0 : b.bounce(n - 1);
+  }
+
+  static Benchmark[] benchmarks() {
+    final Plus plus = new Plus();
+    final Adder adder = plus;
+    final Plus[] polymorphic = new Plus[] {
+      new Plus(), new Minus(), new Times() };
+    final Bounce bounce = new Bounce();
+
+    return new Benchmark[] {
+      new Benchmark("calls.static") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            x = add(x, i);
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("calls.static-8-arguments") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            x = sum(x, i, 1, 2, 3, 4, 5, 6);
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("calls.virtual") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            x = plus.add(x, i);
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("calls.virtual-polymorphic") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            x = polymorphic[i % 3].add(x, i);
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("calls.interface") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            x = adder.add(x, i);
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("calls.reflective") {
+        private final java.lang.reflect.Method method = method();
+
+        private java.lang.reflect.Method method() {
+          try {
+            return Plus.class.getMethod("add", int.class, int.class);
+          } catch (NoSuchMethodException e) {
+            throw new RuntimeException(e);
+          }
+        }
+
+        public int run(int operations) {
+          int x = 0;
+          try {
+            for (int i = 0; i < operations; ++i) {
+              x = (Integer) method.invoke(plus, x, i);
+            }
+          } catch (Exception e) {
+            throw new RuntimeException(e);
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("calls.tail-recursive") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; i += Depth) {
+            x += countDown(Depth, 0);
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("calls.tail-mutual") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; i += Depth) {
+            x += bounceStatic(bounce, Depth);
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("calls.recursive") {
+        private final int calls = fibCalls(15);
+
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; i += calls) {
+            x += fib(15);
+          }
+          return x;
+        }
+      }
+    };
+  }
+}
@@ -0,0 +1,129 @@
+package bench;
+
+// Array and string operations.  Each operation touches Length
+// elements or characters.
+public class Data {
+  private static final int Length = 256;
+
+  static Benchmark[] benchmarks() {
+    final int[] source = new int[Length];
+    final int[] destination = new int[Length];
+    for (int i = 0; i < Length; ++i) {
+      source[i] = i;
+    }
+
+    final int[] shuffled = new int[Length];
+    java.util.Random random = new java.util.Random(42);
+    for (int i = 0; i < Length; ++i) {
+      shuffled[i] = random.nextInt();
+    }
+
+    final char[] chars = new char[Length];
+    for (int i = 0; i < Length; ++i) {
+      chars[i] = (char) ('a' + (i % 26));
+    }
+    final String string = new String(chars);
+    final String copy = new String(chars);
+
+    return new Benchmark[] {
+      new Benchmark("data.array-sum") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            for (int j = 0; j < source.length; ++j) {
+              x += source[j];
+            }
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("data.array-fill") {
+        public int run(int operations) {
+          for (int i = 0; i < operations; ++i) {
+            for (int j = 0; j < destination.length; ++j) {
+              destination[j] = i;
+            }
+          }
+          return destination[0];
+        }
+      },
+
+      new Benchmark("data.array-copy") {
+        public int run(int operations) {
+          for (int i = 0; i < operations; ++i) {
+            System.arraycopy(source, 0, destination, 0, Length);
+          }
+          return destination[Length - 1];
+        }
+      },
+
+      new Benchmark("data.array-sort") {
+        public int run(int operations) {
+          for (int i = 0; i < operations; ++i) {
+            System.arraycopy(shuffled, 0, destination, 0, Length);
+            java.util.Arrays.sort(destination);
+          }
+          return destination[0];
+        }
+      },
+
+      new Benchmark("data.string-build") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            StringBuilder sb = new StringBuilder();
+            for (int j = 0; j < Length; ++j) {
+              sb.append(chars[j]);
+            }
+            x += sb.toString().length();
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("data.string-concatenate") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            x += ("item " + i + " of " + Length + ": " + (i * 31L)).length();
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("data.string-hash") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            // a new string each time, since the hash code is cached
+            x += new String(chars).hashCode();
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("data.string-equals") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            if (string.equals(copy)) {
+              ++ x;
+            }
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("data.string-index-of") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            x += string.indexOf('{');
+          }
+          return x;
+        }
+      }
+    };
+  }
+}
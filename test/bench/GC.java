@@ -0,0 +1,225 @@
+package bench;
+
+import java.lang.ref.Reference;
+import java.lang.ref.SoftReference;
+import java.lang.ref.WeakReference;
+import java.util.concurrent.atomic.AtomicInteger;
+
+// Allocation profiles for the garbage collector.  Unlike the other
+// suites, the harness also records collection pauses, the allocation
+// rate and peak memory use while these run (see Harness.measure).
+public class GC {
+  // the size of the objects kept reachable by gc.old-mutation, which
+  // is enough to be tenured and take up several megabytes
+  private static final int OldObjects = 256 * 1024;
+
+  // the number of references kept by gc.references
+  private static final int References = 4 * 1024;
+
+  // the most finalizable objects gc.finalizers leaves waiting for
+  // their finalizers before it stops to let them catch up
+  private static final int MaxPendingFinalizers = 16 * 1024;
+
+  private static final int Threads = 4;
+
+  // the size of each thread's local heap in the VM, below which arrays
+  // are allocated by bumping a pointer and above which they are not
+  private static final int ThreadHeapSizeInBytes = 64 * 1024;
+
+  private static class Node {
+    public Object value;
+    public Node next;
+
+    public Node(Node next) {
+      this.next = next;
+    }
+  }
+
+  private static class Finalizable {
+    private static final AtomicInteger finalized = new AtomicInteger();
+
+    protected void finalize() {
+      finalized.incrementAndGet();
+    }
+  }
+
+  private abstract static class Profile extends Benchmark {
+    protected Profile(String name) {
+      super(name);
+    }
+
+    public boolean measuresMemory() {
+      return true;
+    }
+  }
+
+  // allocates a list of sixteen objects which is garbage as soon as
+  // it is complete
+  private static int churn() {
+    Node n = null;
+    for (int i = 0; i < 16; ++i) {
+      n = new Node(n);
+    }
+    return n.next == null ? 0 : 1;
+  }
+
+  private static int next(int seed) {
+    return (seed * 1103515245) + 12345;
+  }
+
+  static Benchmark[] benchmarks() {
+    final Node[] old = new Node[OldObjects];
+    for (int i = 0; i < old.length; ++i) {
+      old[i] = new Node(i == 0 ? null : old[i - 1]);
+    }
+    // give the old generation a chance to be tenured before it is
+    // measured
+    for (int i = 0; i < 4; ++i) {
+      System.gc();
+    }
+
+    final Reference[] references = new Reference[References];
+    final Object[] referents = new Object[References];
+
+    final byte[][] arrays = new byte[8][];
+
+    final AtomicInteger created = new AtomicInteger();
+
+    return new Benchmark[] {
+      new Profile("gc.young-churn") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            x += churn();
+          }
+          return x;
+        }
+      },
+
+      // stores young objects and other old ones into old objects at
+      // random, so each minor collection has dirty cards to scan
+      new Profile("gc.old-mutation") {
+        public int run(int operations) {
+          int seed = operations;
+          for (int i = 0; i < operations; ++i) {
+            for (int j = 0; j < 16; ++j) {
+              seed = next(seed);
+              Node n = old[(seed >>> 8) % old.length];
+              if ((seed & 0x80) == 0) {
+                n.value = new Node(null);
+              } else {
+                n.value = old[(seed >>> 1) % old.length];
+              }
+            }
+          }
+          return old[seed >>> 16].value == null ? 0 : 1;
+        }
+      },
+
+      // replaces weak and soft references in turn, keeping half of the
+      // referents reachable
+      new Profile("gc.references") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            int index = i % References;
+            Reference r = references[index];
+            if (r != null && r.get() != null) {
+              ++ x;
+            }
+
+            Object referent = new Node(null);
+            referents[index] = (index & 2) == 0 ? referent : null;
+            if ((index & 1) == 0) {
+              references[index] = new WeakReference(referent);
+            } else {
+              references[index] = new SoftReference(referent);
+            }
+          }
+          return x;
+        }
+      },
+
+      new Profile("gc.finalizers") {
+        public int run(int operations) {
+          for (int i = 0; i < operations; ++i) {
+            new Finalizable();
+            int pending = created.incrementAndGet()
+              - Finalizable.finalized.get();
+
+            // wait a bounded time for the finalizer thread, so a VM
+            // which runs finalizers slowly is measured rather than
+            // run out of memory
+            for (int j = 0; pending > MaxPendingFinalizers && j < 100; ++j) {
+              System.gc();
+              Thread.yield();
+              pending = created.get() - Finalizable.finalized.get();
+            }
+          }
+          return Finalizable.finalized.get();
+        }
+      },
+
+      new Profile("gc.array-below-thread-heap") {
+        public int run(int operations) {
+          for (int i = 0; i < operations; ++i) {
+            arrays[i % arrays.length] = new byte[ThreadHeapSizeInBytes - 64];
+          }
+          return arrays[0] == null ? 0 : arrays[0].length;
+        }
+      },
+
+      new Profile("gc.array-above-thread-heap") {
+        public int run(int operations) {
+          for (int i = 0; i < operations; ++i) {
+            arrays[i % arrays.length] = new byte[ThreadHeapSizeInBytes + 64];
+          }
+          return arrays[0] == null ? 0 : arrays[0].length;
+        }
+      },
+
+      new Profile("gc.threads") {
+        private final AtomicInteger sum = new AtomicInteger();
+        private long allocated;
+
+        public int run(final int operations) {
+          Thread[] threads = new Thread[Threads];
+          for (int i = 0; i < threads.length; ++i) {
+            threads[i] = new Thread() {
+                public void run() {
+                  int x = 0;
+                  for (int j = 0; j < operations; j += Threads) {
+                    x += churn();
+                  }
+                  sum.addAndGet(x);
+
+                  long bytes = avian.Machine.threadAllocatedBytes(this);
+                  synchronized (sum) {
+                    allocated += bytes;
+                  }
+                }
+              };
+            threads[i].start();
+          }
+
+          for (int i = 0; i < threads.length; ++i) {
+            try {
+              threads[i].join();
+            } catch (InterruptedException e) {
+              throw new RuntimeException(e);
+            }
+          }
+          return sum.get();
+        }
+
+        public long otherAllocatedBytes() {
+          synchronized (sum) {
+            long bytes = allocated;
+            allocated = 0;
+            return bytes;
+          }
+        }
+      }
+    };
+  }
+}
@@ -0,0 +1,475 @@
+package bench;
+
+import java.io.BufferedReader;
+import java.io.FileOutputStream;
+import java.io.FileReader;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.io.PrintStream;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+
+// Runs the benchmarks in this package.  "make bench" starts a fresh VM
+// (a fork) several times with -samples, each of which appends one line
+// per benchmark to the specified file, and then aggregates the samples
+// of all forks with -report.  -compare prints the relative change in
+// median time between two reports.
+//
+// Times are kept in picoseconds per operation so that the samples and
+// reports are plain integers and decimals which format the same way on
+// every build.
+//
+// Benchmarks which measure memory (see Benchmark.measuresMemory) also
+// get the collection pause percentiles, allocation rate and peak
+// resident set size seen while taking their samples in their reports.
+public class Harness {
+  // each sample repeats its benchmark enough times to take at least
+  // this long, since the clock may be coarse
+  private static final long SampleMillis = 100;
+
+  // appended to a benchmark's name in the samples file for the line
+  // written by Measurement.finish
+  private static final String MemorySuffix = "#memory";
+
+  private static Benchmark[][] suites() {
+    return new Benchmark[][] {
+      Calls.benchmarks(),
+      Objects.benchmarks(),
+      Data.benchmarks(),
+      Natives.benchmarks(),
+      VM.benchmarks(),
+      GC.benchmarks()
+    };
+  }
+
+  private static int sink;
+
+  private static long time(Benchmark b, int operations) {
+    long start = System.currentTimeMillis();
+    sink += b.run(operations);
+    return System.currentTimeMillis() - start;
+  }
+
+  private static long picos(long millis, int operations) {
+    return (millis * 1000000000L) / operations;
+  }
+
+  private static void sample(String path, String filter, int warmups,
+                             int samples)
+    throws IOException
+  {
+    PrintStream out = new PrintStream(new FileOutputStream(path, true));
+    try {
+      Benchmark[][] suites = suites();
+      for (int i = 0; i < suites.length; ++i) {
+        for (int j = 0; j < suites[i].length; ++j) {
+          Benchmark b = suites[i][j];
+          if (filter != null && b.name().indexOf(filter) < 0) {
+            continue;
+          }
+
+          // calibration doubles as the first warm-up, giving the JIT
+          // compiler a chance to compile everything involved
+          int operations = 1;
+          while (time(b, operations) < SampleMillis) {
+            operations *= 2;
+          }
+
+          for (int k = 0; k < warmups; ++k) {
+            time(b, operations);
+          }
+
+          Measurement measurement = b.measuresMemory()
+            ? new Measurement(b) : null;
+
+          StringBuilder sb = new StringBuilder(b.name());
+          for (int k = 0; k < samples; ++k) {
+            sb.append(' ').append(picos(time(b, operations), operations));
+          }
+          out.println(sb.toString());
+
+          if (measurement != null) {
+            out.println(measurement.finish());
+          }
+        }
+      }
+    } finally {
+      out.close();
+    }
+  }
+
+  // the high water mark of this process's resident set size in
+  // kilobytes, or -1 if the system doesn't say
+  private static long peakResidentKilobytes() {
+    try {
+      BufferedReader in = new BufferedReader
+        (new FileReader("/proc/self/status"));
+      try {
+        String line;
+        while ((line = in.readLine()) != null) {
+          if (line.startsWith("VmHWM:")) {
+            String value = line.substring(6).trim();
+            int space = value.indexOf(' ');
+            return Long.parseLong
+              (space < 0 ? value : value.substring(0, space));
+          }
+        }
+      } finally {
+        in.close();
+      }
+    } catch (IOException e) {
+      // not Linux, or /proc isn't mounted
+    } catch (NumberFormatException e) {
+      // not in the expected format
+    }
+    return -1;
+  }
+
+  // lowers the high water mark above to the current resident set size
+  // where Linux allows it, so each benchmark's peak is its own rather
+  // than that of whatever ran before it
+  private static void resetPeakResidentSize() {
+    try {
+      OutputStream out = new FileOutputStream("/proc/self/clear_refs");
+      try {
+        out.write('5');
+      } finally {
+        out.close();
+      }
+    } catch (IOException e) {
+      // the peak will include earlier benchmarks
+    }
+  }
+
+  // Collection pauses, allocation and peak memory use while a
+  // benchmark takes its samples, written as one line of the samples
+  // file: the benchmark name followed by MemorySuffix, the elapsed
+  // milliseconds, the bytes allocated, the peak resident set size in
+  // kilobytes (or -1) and, for each nonempty bucket of
+  // avian.Machine.collectionPauseHistogram, <bucket>:<pauses>.
+  private static class Measurement {
+    private final Benchmark benchmark;
+    private final long[] pauses;
+    private final long allocated;
+    private final long start;
+
+    public Measurement(Benchmark benchmark) {
+      this.benchmark = benchmark;
+
+      // forget what the calibration and warm-ups allocated
+      benchmark.otherAllocatedBytes();
+
+      resetPeakResidentSize();
+      pauses = avian.Machine.collectionPauseHistogram();
+      allocated = avian.Machine.threadAllocatedBytes(Thread.currentThread());
+      start = System.currentTimeMillis();
+    }
+
+    public String finish() {
+      long millis = System.currentTimeMillis() - start;
+      long bytes = avian.Machine.threadAllocatedBytes(Thread.currentThread())
+        - allocated + benchmark.otherAllocatedBytes();
+      long[] histogram = avian.Machine.collectionPauseHistogram();
+
+      StringBuilder sb = new StringBuilder(benchmark.name())
+        .append(MemorySuffix).append(' ').append(millis)
+        .append(' ').append(bytes)
+        .append(' ').append(peakResidentKilobytes());
+      for (int i = 0; i < histogram.length; ++i) {
+        long n = histogram[i] - pauses[i];
+        if (n > 0) {
+          sb.append(' ').append(i).append(':').append(n);
+        }
+      }
+      return sb.toString();
+    }
+  }
+
+  // the measurements of one benchmark from every fork
+  private static class Usage {
+    private long millis;
+    private long bytes;
+    private long peakKilobytes = -1;
+    private long[] pauses = new long[0];
+
+    public void add(String[] fields) {
+      millis += Long.parseLong(fields[1]);
+      bytes += Long.parseLong(fields[2]);
+      peakKilobytes = Math.max(peakKilobytes, Long.parseLong(fields[3]));
+
+      for (int i = 4; i < fields.length; ++i) {
+        int colon = fields[i].indexOf(':');
+        int bucket = Integer.parseInt(fields[i].substring(0, colon));
+        if (bucket >= pauses.length) {
+          long[] array = new long[bucket + 1];
+          System.arraycopy(pauses, 0, array, 0, pauses.length);
+          pauses = array;
+        }
+        pauses[bucket] += Long.parseLong(fields[i].substring(colon + 1));
+      }
+    }
+
+    // an upper bound, in microseconds, on the specified percentage of
+    // the pauses
+    private long pause(long total, int percent) {
+      long rank = (total * percent + 99) / 100;
+      long sum = 0;
+      for (int i = 0; i < pauses.length; ++i) {
+        sum += pauses[i];
+        if (sum >= rank) {
+          return avian.Machine.collectionPauseBucketStart(i + 1);
+        }
+      }
+      return 0;
+    }
+
+    public void append(StringBuilder sb) {
+      long total = 0;
+      for (int i = 0; i < pauses.length; ++i) {
+        total += pauses[i];
+      }
+
+      sb.append(", \"pauses\": ").append(total);
+      if (total > 0) {
+        sb.append(", \"pause-p50-us\": ").append(pause(total, 50))
+          .append(", \"pause-p99-us\": ").append(pause(total, 99))
+          .append(", \"pause-max-us\": ").append(pause(total, 100));
+      }
+
+      sb.append(", \"allocated-mb-per-s\": ")
+        .append(millis == 0 ? 0 : (bytes * 1000) / (millis * 1024 * 1024))
+        .append(", \"max-rss-kb\": ").append(peakKilobytes);
+    }
+  }
+
+  private static void sort(long[] array) {
+    for (int i = 1; i < array.length; ++i) {
+      long v = array[i];
+      int j = i - 1;
+      for (; j >= 0 && array[j] > v; --j) {
+        array[j + 1] = array[j];
+      }
+      array[j + 1] = v;
+    }
+  }
+
+  // the smallest sample which is at least as large as the specified
+  // fraction of all of them
+  private static long percentile(long[] sorted, int percent) {
+    int rank = (sorted.length * percent + 99) / 100;
+    return sorted[rank == 0 ? 0 : rank - 1];
+  }
+
+  private static String nanos(long picos) {
+    String fraction = String.valueOf(1000 + (picos % 1000)).substring(1);
+    return (picos / 1000) + "." + fraction;
+  }
+
+  private static void report(String output, String[] paths, int start)
+    throws IOException
+  {
+    List<String> names = new ArrayList<String>();
+    Map<String, List<Long>> samples = new HashMap<String, List<Long>>();
+    Map<String, Integer> forks = new HashMap<String, Integer>();
+    Map<String, Usage> usages = new HashMap<String, Usage>();
+
+    for (int i = start; i < paths.length; ++i) {
+      BufferedReader in = new BufferedReader(new FileReader(paths[i]));
+      try {
+        String line;
+        while ((line = in.readLine()) != null) {
+          String[] fields = line.split(" ");
+          String name = fields[0];
+          if (name.endsWith(MemorySuffix)) {
+            name = name.substring(0, name.length() - MemorySuffix.length());
+            Usage usage = usages.get(name);
+            if (usage == null) {
+              usages.put(name, usage = new Usage());
+            }
+            usage.add(fields);
+            continue;
+          }
+
+          List<Long> list = samples.get(name);
+          if (list == null) {
+            names.add(name);
+            samples.put(name, list = new ArrayList<Long>());
+            forks.put(name, 0);
+          }
+          forks.put(name, forks.get(name) + 1);
+          for (int j = 1; j < fields.length; ++j) {
+            list.add(Long.parseLong(fields[j]));
+          }
+        }
+      } finally {
+        in.close();
+      }
+    }
+
+    StringBuilder sb = new StringBuilder();
+    sb.append("{\n  \"unit\": \"ns/op\",\n  \"results\": [");
+
+    for (int i = 0; i < names.size(); ++i) {
+      String name = names.get(i);
+      List<Long> list = samples.get(name);
+      long[] sorted = new long[list.size()];
+      long total = 0;
+      for (int j = 0; j < sorted.length; ++j) {
+        sorted[j] = list.get(j);
+        total += sorted[j];
+      }
+      sort(sorted);
+
+      sb.append(i == 0 ? "\n" : ",\n")
+        .append("    {\"name\": \"").append(name)
+        .append("\", \"forks\": ").append(forks.get(name))
+        .append(", \"samples\": ").append(sorted.length)
+        .append(", \"mean\": ").append(nanos(total / sorted.length))
+        .append(", \"p50\": ").append(nanos(percentile(sorted, 50)))
+        .append(", \"p99\": ").append(nanos(percentile(sorted, 99)));
+
+      Usage usage = usages.get(name);
+      if (usage != null) {
+        usage.append(sb);
+      }
+      sb.append("}");
+    }
+
+    sb.append("\n  ]\n}\n");
+
+    OutputStream out = new FileOutputStream(output);
+    try {
+      out.write(sb.toString().getBytes());
+    } finally {
+      out.close();
+    }
+  }
+
+  // reads the value of the specified field from each result in a
+  // report written by the report method above, one result per line
+  private static Map<String, String> read(String path, String field)
+    throws IOException
+  {
+    Map<String, String> values = new HashMap<String, String>();
+    BufferedReader in = new BufferedReader(new FileReader(path));
+    try {
+      String line;
+      while ((line = in.readLine()) != null) {
+        String name = value(line, "name");
+        if (name != null) {
+          values.put(name, value(line, field));
+        }
+      }
+    } finally {
+      in.close();
+    }
+    return values;
+  }
+
+  private static String value(String line, String field) {
+    String key = "\"" + field + "\": ";
+    int start = line.indexOf(key);
+    if (start < 0) {
+      return null;
+    }
+    start += key.length();
+
+    if (line.charAt(start) == '"') {
+      return line.substring(start + 1, line.indexOf('"', start + 1));
+    }
+
+    int end = start;
+    while (end < line.length() && ",}".indexOf(line.charAt(end)) < 0) {
+      ++ end;
+    }
+    return line.substring(start, end);
+  }
+
+  private static long picos(String nanos) {
+    int dot = nanos.indexOf('.');
+    return (Long.parseLong(nanos.substring(0, dot)) * 1000)
+      + Long.parseLong(nanos.substring(dot + 1));
+  }
+
+  private static void compare(String baseline, String current)
+    throws IOException
+  {
+    Map<String, String> before = read(baseline, "p50");
+
+    BufferedReader in = new BufferedReader(new FileReader(current));
+    try {
+      String line;
+      while ((line = in.readLine()) != null) {
+        String name = value(line, "name");
+        if (name == null) {
+          continue;
+        }
+
+        String old = before.get(name);
+        String new_ = value(line, "p50");
+        StringBuilder sb = new StringBuilder(name);
+        while (sb.length() < 32) {
+          sb.append(' ');
+        }
+
+        if (old == null) {
+          sb.append(new_).append(" (new)");
+        } else {
+          long a = picos(old);
+          long b = picos(new_);
+          sb.append(old).append(" -> ").append(new_);
+          if (a != 0) {
+            long permille = ((b - a) * 1000) / a;
+            long magnitude = Math.abs(permille);
+            sb.append(" (").append(permille < 0 ? "-" : "+")
+              .append(magnitude / 10).append('.').append(magnitude % 10)
+              .append("%)");
+          }
+        }
+        System.out.println(sb.toString());
+      }
+    } finally {
+      in.close();
+    }
+  }
+
+  private static void usage() {
+    System.err.println
+      ("usage: bench.Harness [-filter <substring>] [-warmups <count>]"
+       + " [-samples-per-fork <count>] -samples <file>\n"
+       + "       bench.Harness -report <output> <samples>...\n"
+       + "       bench.Harness -compare <baseline report> <report>");
+    System.exit(-1);
+  }
+
+  public static void main(String[] args) throws Exception {
+    String filter = null;
+    int warmups = 3;
+    int samples = 10;
+
+    for (int i = 0; i < args.length; ++i) {
+      if ("-filter".equals(args[i]) && i + 1 < args.length) {
+        filter = args[++i];
+      } else if ("-warmups".equals(args[i]) && i + 1 < args.length) {
+        warmups = Integer.parseInt(args[++i]);
+      } else if ("-samples-per-fork".equals(args[i]) && i + 1 < args.length) {
+        samples = Integer.parseInt(args[++i]);
+      } else if ("-samples".equals(args[i]) && i + 1 < args.length) {
+        sample(args[i + 1], filter, warmups, samples);
+        return;
+      } else if ("-report".equals(args[i]) && i + 2 < args.length) {
+        report(args[i + 1], args, i + 2);
+        return;
+      } else if ("-compare".equals(args[i]) && i + 2 < args.length) {
+        compare(args[i + 1], args[i + 2]);
+        return;
+      } else {
+        usage();
+      }
+    }
+
+    usage();
+  }
+}
@@ -0,0 +1,52 @@
+package bench;
+
+// Calls from Java to JNI methods in test/jni.cpp, and back again.
+public class Natives {
+  static {
+    System.loadLibrary("test");
+  }
+
+  private static native int nop();
+
+  private static native int add(int a, int b);
+
+  private static native int callBack(Class c, int n);
+
+  private static int identity(int n) {
+    return n;
+  }
+
+  static Benchmark[] benchmarks() {
+    return new Benchmark[] {
+      new Benchmark("natives.call") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            x += nop();
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("natives.call-arguments") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            x = add(x, i);
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("natives.call-back") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            x += callBack(Natives.class, i);
+          }
+          return x;
+        }
+      }
+    };
+  }
+}
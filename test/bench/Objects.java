@@ -0,0 +1,110 @@
+package bench;
+
+// Allocation, monitors and exceptions.
+public class Objects {
+  private static class Pair {
+    public final Object first;
+    public final Object second;
+
+    public Pair(Object first, Object second) {
+      this.first = first;
+      this.second = second;
+    }
+  }
+
+  private static class Counter {
+    private int value;
+
+    public synchronized int increment() {
+      return ++ value;
+    }
+  }
+
+  private static int check(int n) {
+    if (n < 0) {
+      throw new IllegalArgumentException();
+    }
+    return n;
+  }
+
+  private static int length(Object[] array) {
+    return array.length;
+  }
+
+  static Benchmark[] benchmarks() {
+    final Counter counter = new Counter();
+    final Object lock = new Object();
+
+    return new Benchmark[] {
+      new Benchmark("objects.allocate") {
+        public int run(int operations) {
+          Pair p = null;
+          for (int i = 0; i < operations; ++i) {
+            p = new Pair(p == null ? null : p.second, this);
+          }
+          return p == null ? 0 : 1;
+        }
+      },
+
+      new Benchmark("objects.allocate-array") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            x += new int[16].length;
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("objects.monitor-block") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            synchronized (lock) {
+              ++ x;
+            }
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("objects.monitor-method") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            x = counter.increment();
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("objects.throw") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            try {
+              x += check(-1);
+            } catch (IllegalArgumentException e) {
+              ++ x;
+            }
+          }
+          return x;
+        }
+      },
+
+      new Benchmark("objects.throw-implicit") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            try {
+              x += length(null);
+            } catch (NullPointerException e) {
+              ++ x;
+            }
+          }
+          return x;
+        }
+      }
+    };
+  }
+}
@@ -0,0 +1,86 @@
+package bench;
+
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+
+// Garbage collection pauses and class loading.
+public class VM {
+  // the number of objects kept reachable while collecting garbage
+  private static final int LiveObjects = 16 * 1024;
+
+  private static class Node {
+    public final Node next;
+
+    public Node(Node next) {
+      this.next = next;
+    }
+  }
+
+  public static class Loaded {
+    public int value() {
+      return 42;
+    }
+  }
+
+  private static class Loader extends ClassLoader {
+    public Loader() {
+      super(VM.class.getClassLoader());
+    }
+
+    public Class define(String name, byte[] bytes) {
+      return defineClass(name, bytes, 0, bytes.length);
+    }
+  }
+
+  private static byte[] read(String name) throws IOException {
+    InputStream in = VM.class.getResourceAsStream(name);
+    try {
+      ByteArrayOutputStream out = new ByteArrayOutputStream();
+      byte[] buffer = new byte[1024];
+      int c;
+      while ((c = in.read(buffer)) >= 0) {
+        out.write(buffer, 0, c);
+      }
+      return out.toByteArray();
+    } finally {
+      in.close();
+    }
+  }
+
+  static Benchmark[] benchmarks() {
+    final byte[] loaded;
+    try {
+      loaded = read("VM$Loaded.class");
+    } catch (IOException e) {
+      throw new RuntimeException(e);
+    }
+
+    return new Benchmark[] {
+      new Benchmark("vm.gc") {
+        public int run(int operations) {
+          Node live = null;
+          for (int i = 0; i < LiveObjects; ++i) {
+            live = new Node(live);
+          }
+
+          for (int i = 0; i < operations; ++i) {
+            System.gc();
+          }
+          return live == null ? 0 : 1;
+        }
+      },
+
+      new Benchmark("vm.define-class") {
+        public int run(int operations) {
+          int x = 0;
+          for (int i = 0; i < operations; ++i) {
+            x += new Loader().define("bench.VM$Loaded", loaded)
+              .getName().length();
+          }
+          return x;
+        }
+      }
+    };
+  }
+}
@@ -0,0 +1,80 @@
+package extra;
+
+import avian.Fiber;
+import avian.FiberScheduler;
+import java.util.concurrent.atomic.AtomicInteger;
+
+public class Fibers {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  public static void main(String[] args) throws Exception {
+    FiberScheduler scheduler = new FiberScheduler(2);
+
+    { final int fiberCount = 1000;
+      final int yieldCount = 10;
+      final AtomicInteger counter = new AtomicInteger();
+      Fiber[] fibers = new Fiber[fiberCount];
+      for (int i = 0; i < fiberCount; ++i) {
+        fibers[i] = scheduler.spawn(new Runnable() {
+            public void run() {
+              for (int j = 0; j < yieldCount; ++j) {
+                counter.incrementAndGet();
+                Fiber.yield();
+              }
+            }
+          });
+      }
+
+      for (Fiber f: fibers) {
+        f.join();
+        expect(f.getException() == null);
+      }
+      expect(counter.get() == fiberCount * yieldCount);
+    }
+
+    { // two fibers take turns, handing control back and forth with
+      // park and unpark
+      final int rounds = 100;
+      final int[] turn = new int[1];
+      final Fiber[] players = new Fiber[2];
+      for (int i = 0; i < 2; ++i) {
+        final int id = i;
+        players[i] = scheduler.spawn(new Runnable() {
+            public void run() {
+              while (players[1 - id] == null) {
+                Fiber.yield();
+              }
+
+              for (int j = 0; j < rounds; ++j) {
+                while (turn[0] != id) {
+                  Fiber.park();
+                }
+                turn[0] = 1 - id;
+                players[1 - id].unpark();
+              }
+            }
+          });
+      }
+
+      for (Fiber f: players) {
+        f.join();
+        expect(f.getException() == null);
+      }
+    }
+
+    { final RuntimeException e = new RuntimeException();
+      Fiber f = scheduler.spawn(new Runnable() {
+          public void run() {
+            throw e;
+          }
+        });
+      f.join();
+      expect(f.getException() == e);
+      expect(! f.isAlive());
+    }
+
+    scheduler.shutdown();
+  }
+}
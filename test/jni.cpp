@@ -1,5 +1,12 @@
 #include <jni.h>
 #include "jni-util.h"
+#include "avian/jni-fields.h"
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <dlfcn.h>
+#endif
 
 extern "C" JNIEXPORT jdouble JNICALL
 Java_JNI_addDoubles
@@ -107,6 +114,115 @@ Java_JNI_testLocalRef(JNIEnv* e, jclass, jobject o)
   return e->NewLocalRef(o);
 }
 
+extern "C" JNIEXPORT jlong JNICALL
+JavaCritical_JNI_sum(jint length, jbyte* array, jlong bias)
+{
+  jlong sum = bias;
+  for (jint i = 0; i < length; ++i) {
+    sum += array[i];
+  }
+  return sum;
+}
+
+// the field copy functions are exported by the VM rather than linked
+// into this library, so we find them at runtime
+void*
+vmFunction(const char* name)
+{
+#ifdef _WIN32
+  return reinterpret_cast<void*>(GetProcAddress(GetModuleHandle(0), name));
+#else
+  static void* vm = dlopen(0, RTLD_LAZY);
+  return dlsym(vm, name);
+#endif
+}
+
+typedef void* (JNICALL *MakeFieldLayoutFunction)
+  (JNIEnv*, const jfieldID*, jint);
+typedef jint (JNICALL *FieldLayoutSizeFunction)(JNIEnv*, void*);
+typedef void (JNICALL *DisposeFieldLayoutFunction)(JNIEnv*, void*);
+typedef void (JNICALL *GetFieldsFunction)(JNIEnv*, jobject, void*, void*);
+typedef void (JNICALL *SetFieldsFunction)
+  (JNIEnv*, jobject, void*, const void*);
+
+// expects the fields of o to hold 1 through 5, then sets them to 6
+// through 10
+extern "C" JNIEXPORT jboolean JNICALL
+Java_JNI_copyFields(JNIEnv* e, jclass, jobject o)
+{
+  MakeFieldLayoutFunction makeLayout = reinterpret_cast
+    <MakeFieldLayoutFunction>(vmFunction("AvianMakeFieldLayout"));
+  FieldLayoutSizeFunction layoutSize = reinterpret_cast
+    <FieldLayoutSizeFunction>(vmFunction("AvianFieldLayoutSize"));
+  DisposeFieldLayoutFunction disposeLayout = reinterpret_cast
+    <DisposeFieldLayoutFunction>(vmFunction("AvianDisposeFieldLayout"));
+  GetFieldsFunction getFields = reinterpret_cast
+    <GetFieldsFunction>(vmFunction("AvianGetFields"));
+  SetFieldsFunction setFields = reinterpret_cast
+    <SetFieldsFunction>(vmFunction("AvianSetFields"));
+
+  if (makeLayout == 0 or layoutSize == 0 or disposeLayout == 0
+      or getFields == 0 or setFields == 0)
+  {
+    return false;
+  }
+
+  jclass c = e->GetObjectClass(o);
+  jfieldID fields[] = { e->GetFieldID(c, "b", "B"),
+                        e->GetFieldID(c, "i", "I"),
+                        e->GetFieldID(c, "l", "J"),
+                        e->GetFieldID(c, "s", "S"),
+                        e->GetFieldID(c, "d", "D") };
+
+  // each field is at its natural alignment, whatever the C compiler
+  // would do with a jlong or jdouble member
+  const unsigned BOffset = 0;
+  const unsigned IOffset = 4;
+  const unsigned LOffset = 8;
+  const unsigned SOffset = 16;
+  const unsigned DOffset = 24;
+  const unsigned Size = 32;
+
+  if (makeLayout(e, fields, -1) or not e->ExceptionCheck()) {
+    return false;
+  }
+  e->ExceptionClear();
+
+  jfieldID object = e->GetFieldID(c, "o", "Ljava/lang/Object;");
+  if (makeLayout(e, &object, 1) or not e->ExceptionCheck()) {
+    return false;
+  }
+  e->ExceptionClear();
+
+  void* layout = makeLayout(e, fields, 5);
+  if (layout == 0 or layoutSize(e, layout) != Size) {
+    return false;
+  }
+
+  char buffer[Size];
+  getFields(e, o, layout, buffer);
+
+  jbyte b; memcpy(&b, buffer + BOffset, sizeof(b));
+  jint i; memcpy(&i, buffer + IOffset, sizeof(i));
+  jlong l; memcpy(&l, buffer + LOffset, sizeof(l));
+  jshort s; memcpy(&s, buffer + SOffset, sizeof(s));
+  jdouble d; memcpy(&d, buffer + DOffset, sizeof(d));
+
+  bool success = b == 1 and i == 2 and l == 3 and s == 4 and d == 5;
+
+  b = 6; memcpy(buffer + BOffset, &b, sizeof(b));
+  i = 7; memcpy(buffer + IOffset, &i, sizeof(i));
+  l = 8; memcpy(buffer + LOffset, &l, sizeof(l));
+  s = 9; memcpy(buffer + SOffset, &s, sizeof(s));
+  d = 10; memcpy(buffer + DOffset, &d, sizeof(d));
+
+  setFields(e, o, layout, buffer);
+
+  disposeLayout(e, layout);
+
+  return success;
+}
+
 extern "C" JNIEXPORT jobject JNICALL
 Java_Buffers_allocateNative(JNIEnv* e, jclass, jint capacity)
 {
@@ -121,3 +237,26 @@ Java_Buffers_freeNative(JNIEnv* e, jclass, jobject b)
 {
   free(e->GetDirectBufferAddress(b));
 }
+
+extern "C" JNIEXPORT jint JNICALL
+Java_bench_Natives_nop(JNIEnv*, jclass)
+{
+  return 1;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_bench_Natives_add(JNIEnv*, jclass, jint a, jint b)
+{
+  return a + b;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_bench_Natives_callBack(JNIEnv* e, jclass, jclass c, jint n)
+{
+  static jmethodID identity = 0;
+  if (identity == 0) {
+    identity = e->GetStaticMethodID(c, "identity", "(I)I");
+  }
+
+  return e->CallStaticIntMethod(c, identity, n);
+}
@@ -0,0 +1,149 @@
+#!/bin/sh
+
+# Runs "make startup" for each combination of the build options which
+# affect startup and collects the results as a single JSON array, one
+# entry per application and build.  Like ci.sh, extra make arguments
+# may be passed in ${flags}.  Builds with an LZMA-compressed boot image
+# are included when ${lzma} names the LZMA SDK, and builds using the
+# OpenJDK class library when ${openjdk} names a JDK (those with a boot
+# image also need ${openjdk_src}).  The bootimage=true builds are only
+# made with process=compile.
+#
+# If ${baseline} names the output of an earlier run, each result is
+# compared with the one for the same application and build there, and
+# the script fails if any median time, peak resident set size or page
+# fault count has grown by more than ${threshold} percent (10 by
+# default).  Times may also grow by ${slack} milliseconds (2 by
+# default), since they are measured to the millisecond.
+
+set -e
+
+processes=${processes:-"compile interpret"}
+threshold=${threshold:-10}
+slack=${slack:-2}
+output=${1:-build/startup.json}
+results=${output}.tmp
+
+classpaths="avian"
+if [ -n "${openjdk}" ]; then
+  classpaths="avian openjdk"
+fi
+
+lzmas="false"
+if [ -n "${lzma}" ]; then
+  lzmas="false true"
+fi
+
+mkdir -p $(dirname ${output})
+
+echo "[" >${output}
+separator=""
+
+for classpath in ${classpaths}; do
+  for process in ${processes}; do
+    for bootimage in false true; do
+      for compressed in ${lzmas}; do
+        if [ "${bootimage}" = "true" ] && [ "${process}" != "compile" ]; then
+          continue
+        fi
+        if [ "${compressed}" = "true" ] && [ "${bootimage}" != "true" ]; then
+          continue
+        fi
+
+        options="process=${process} bootimage=${bootimage}"
+        if [ "${compressed}" = "true" ]; then
+          options="${options} lzma=${lzma}"
+        fi
+        if [ "${classpath}" = "openjdk" ]; then
+          if [ "${bootimage}" = "true" ]; then
+            if [ -z "${openjdk_src}" ]; then
+              continue
+            fi
+            options="${options} openjdk-src=${openjdk_src}"
+          fi
+          options="${options} openjdk=${openjdk}"
+        fi
+
+        make ${flags} ${options} startup-output=${results} startup
+
+        build="\"classpath\": \"${classpath}\", \"process\": \"${process}\""
+        build="${build}, \"bootimage\": ${bootimage}, \"lzma\": ${compressed}"
+        grep '"app"' ${results} | sed -e 's/^[ ,]*{//' >${results}.lines
+        while read -r line; do
+          printf "%s  {%s, %s\n" "${separator}" "${build}" "${line}" \
+            >>${output}
+          separator=","
+        done <${results}.lines
+        rm -f ${results}.lines
+      done
+    done
+  done
+done
+
+echo "]" >>${output}
+rm -f ${results}
+
+echo "wrote ${output}"
+
+if [ -z "${baseline}" ]; then
+  exit 0
+fi
+
+awk -v threshold=${threshold} -v slack=${slack} '
+  function field(name, line) {
+    if (match(line, "\"" name "\": [^,}]*")) {
+      return substr(line, RSTART + length(name) + 4,
+                    RLENGTH - length(name) - 4)
+    }
+    return ""
+  }
+
+  function key(line) {
+    return field("classpath", line) " " field("process", line) \
+      " bootimage=" field("bootimage", line) \
+      " lzma=" field("lzma", line) " " field("app", line)
+  }
+
+  BEGIN {
+    split("time-to-main-ms time-to-response-ms peak-rss-kb page-faults",
+          measures)
+    failed = 0
+  }
+
+  ! /"app"/ { next }
+
+  FNR == NR {
+    for (i in measures) {
+      before[key($0), measures[i]] = field(measures[i], $0)
+    }
+    next
+  }
+
+  {
+    k = key($0)
+    for (i in measures) {
+      m = measures[i]
+      if (! ((k, m) in before)) {
+        continue
+      }
+
+      old = before[k, m] + 0
+      new = field(m, $0) + 0
+      if (old < 0 || new < 0) {
+        continue
+      }
+
+      limit = old + (old * threshold / 100)
+      if (m ~ /-ms$/) {
+        limit += slack
+      }
+
+      if (new > limit) {
+        print "regression: " k " " m " " old " -> " new
+        failed = 1
+      }
+    }
+  }
+
+  END { exit failed }
+' ${baseline} ${output}
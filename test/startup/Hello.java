@@ -0,0 +1,11 @@
+package startup;
+
+// The smallest application.  Its time to main is that of starting the
+// VM itself, and it responds as soon as it has printed one line.
+public class Hello {
+  public static void main(String[] args) {
+    System.out.println("main " + System.currentTimeMillis());
+    System.out.println("hello, world!");
+    System.out.println("response " + System.currentTimeMillis());
+  }
+}
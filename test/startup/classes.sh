@@ -0,0 +1,74 @@
+#!/bin/sh
+
+# Writes the sources of startup.Classes, an application which loads,
+# initializes and calls each of ${2} (3000 by default) generated
+# classes before it responds, to the directory ${1}.  Each class has a
+# static initializer and implements a common interface, so starting
+# the application means resolving thousands of classes, interface
+# tables and methods, like a mid-size program would.
+
+set -e
+
+directory=${1}/startup
+count=${2:-3000}
+# the calls per method of Classes, to keep each well short of the
+# limit on the size of a method
+chunk=250
+
+mkdir -p ${directory}
+
+cat >${directory}/Item.java <<END
+package startup;
+
+public interface Item {
+  int value(int x);
+}
+END
+
+i=0
+while [ ${i} -lt ${count} ]; do
+  cat >${directory}/C${i}.java <<END
+package startup;
+
+public class C${i} implements Item {
+  private static final int[] table = { ${i}, $((i * 31)) };
+
+  public int value(int x) {
+    return (x * 31) + table[x & 1];
+  }
+}
+END
+  i=$((i + 1))
+done
+
+{
+  echo "package startup;"
+  echo
+  echo "public class Classes {"
+
+  i=0
+  while [ ${i} -lt ${count} ]; do
+    echo "  private static int run$((i / chunk))(int x) {"
+    end=$((i + chunk))
+    while [ ${i} -lt ${count} ] && [ ${i} -lt ${end} ]; do
+      echo "    x = new C${i}().value(x);"
+      i=$((i + 1))
+    done
+    echo "    return x;"
+    echo "  }"
+    echo
+  done
+
+  echo "  public static void main(String[] args) {"
+  echo "    System.out.println(\"main \" + System.currentTimeMillis());"
+  echo "    int x = 0;"
+  i=0
+  while [ $((i * chunk)) -lt ${count} ]; do
+    echo "    x = run${i}(x);"
+    i=$((i + 1))
+  done
+  echo "    System.out.println(\"result \" + x);"
+  echo "    System.out.println(\"response \" + System.currentTimeMillis());"
+  echo "  }"
+  echo "}"
+} >${directory}/Classes.java
@@ -0,0 +1,64 @@
+#!/bin/sh
+
+# Runs the command given as arguments ${runs} times (20 by default),
+# expecting it to print "main <time>" when its main method starts and
+# "response <time>" when it has done its first piece of work, each
+# time in milliseconds since the epoch.  Prints a JSON object with
+# ${app} as its name and the median of each of the time to main, the
+# time to the response, the peak resident set size and the number of
+# page faults over the runs.  The times need GNU date.  The other two
+# need GNU time as /usr/bin/time, and are -1 without it.
+
+set -e
+
+runs=${runs:-20}
+app=${app:-unknown}
+
+time=/usr/bin/time
+if ! ${time} -f "%M" -o /dev/null true >/dev/null 2>&1; then
+  time=
+fi
+
+output=$(mktemp)
+usage=$(mktemp)
+samples=$(mktemp)
+trap 'rm -f ${output} ${usage} ${samples}' EXIT
+
+i=0
+while [ ${i} -lt ${runs} ]; do
+  start=$(($(date +%s%N) / 1000000))
+  if [ -n "${time}" ]; then
+    ${time} -f "%M %R %F" -o ${usage} env "$@" >${output}
+  else
+    echo "-1 -1 -1" >${usage}
+    env "$@" >${output}
+  fi
+
+  main=$(sed -n 's/^main //p' ${output})
+  response=$(sed -n 's/^response //p' ${output})
+  if [ -z "${main}" ] || [ -z "${response}" ]; then
+    echo "unexpected output from $*:" >&2
+    cat ${output} >&2
+    exit 1
+  fi
+
+  read rss minor major <${usage}
+  faults=-1
+  if [ ${rss} -ge 0 ]; then
+    faults=$((minor + major))
+  fi
+
+  echo "$((main - start)) $((response - start)) ${rss} ${faults}" \
+    >>${samples}
+  i=$((i + 1))
+done
+
+median() {
+  cut -d ' ' -f ${1} ${samples} | sort -n | sed -n "$(((runs + 1) / 2))p"
+}
+
+printf "  {\"app\": \"%s\", \"runs\": %d, \"time-to-main-ms\": %d" \
+  ${app} ${runs} $(median 1)
+printf ", \"time-to-response-ms\": %d, \"peak-rss-kb\": %d" \
+  $(median 2) $(median 3)
+printf ", \"page-faults\": %d}\n" $(median 4)
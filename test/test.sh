@@ -25,16 +25,19 @@ fi
 
 echo
 
-printf "%12s------- Java tests -------\n" ""
-for test in ${tests}; do
-  printf "%24s: " "${test}"
+run() {
+  name=${1}; shift
+  test_flags=${1}; shift
+  test=${1}; shift
+
+  printf "%24s: " "${name}"
 
   case ${mode} in
     debug|debug-fast|fast|small )
-      ${vm} ${flags} ${test} >>${log} 2>&1;;
+      ${vm} ${test_flags} ${test} >>${log} 2>&1;;
 
     stress* )
-      ${vg} ${vm} ${flags} ${test} \
+      ${vg} ${vm} ${test_flags} ${test} \
         >>${log} 2>&1;;
 
     * )
@@ -48,6 +51,25 @@ for test in ${tests}; do
     echo "fail"
     trouble=1
   fi
+}
+
+printf "%12s------- Java tests -------\n" ""
+for test in ${tests}; do
+  run "${test}" "${flags}" ${test}
+done
+
+echo
+
+# these also run with several minor collection threads, so that the
+# parallel collector and its root groups are exercised
+parallel_gc_tests="GC Threads"
+
+printf "%12s------- Parallel GC -------\n" ""
+for test in ${tests}; do
+  case " ${parallel_gc_tests} " in
+    *" ${test} "* )
+      run "${test}" "-Xgcthreads:4 ${flags}" ${test};;
+  esac
 done
 
 echo
@@ -127,3 +127,34 @@
 -keepclassmembers class java.lang.ClassLoader {
    public java.lang.Class loadClass(java.lang.String);
  }
+
+# these classes look up fields by name in their static initializers
+# to find the offsets used with sun.misc.Unsafe:
+
+-keepclassmembers class java.util.concurrent.atomic.Atomic* {
+   private volatile *** value;
+ }
+
+-keepclassmembers class java.util.concurrent.locks.ReentrantLock {
+   private volatile int state;
+ }
+
+-keepclassmembers class java.util.concurrent.locks.ReentrantLock$Waiter {
+   public volatile int waiting;
+ }
+
+-keepclassmembers class java.util.concurrent.FutureTask {
+   private volatile int state;
+ }
+
+-keepclassmembers class java.util.concurrent.ForkJoinTask {
+   private volatile int status;
+ }
+
+-keepclassmembers class java.util.concurrent.ForkJoinPool$WorkQueue {
+   volatile int top;
+ }
+
+-keepclassmembers class java.util.concurrent.ForkJoinWorkerThread {
+   volatile int parked;
+ }